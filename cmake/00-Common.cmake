@@ -13,6 +13,13 @@ set( CMAKE_CXX_FLAGS_RELWITHDEBINFO "-DNDEBUG"                      )
 # Determine which platform we are on and set flags accordingly
 #
 if( UNIX )
+	#
+	# molib threads and mutexes (moThread, moMutex) use pthreads; this
+	# changes the molib headers so it is defined for everything
+	#
+	set( MO_THREAD ON BOOL FORCE )
+	add_definitions( -DMO_THREAD=1 )
+
 	#
 	# Linux
 	#
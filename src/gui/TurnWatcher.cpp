@@ -34,8 +34,10 @@
 // LOCAL
 //
 #include "base/common.h"
+#include "base/ConfigWatcher.h"
 #include "base/LegacyApp.h"
 #include "base/LegacyCharacter.h"
+#include "base/StartupLoader.h"
 #include "ui/MainWindow.h"
 #include "ui/Splash.h"
 #include "version.h"
@@ -112,18 +114,31 @@ int real_main(int argc, char *argv[])
 	//
     Gtk::Main kit( argc, argv );
 
-	// Get application settings, which creates the singleton manager.
-	// Then update the user path.
+	// Load the configuration files and create the managers which
+	// depend on them.
+	//
+	Application::StartupLoader::Run();
+#ifdef DEBUG
+	Application::StartupLoader::Report( std::cerr );
+#endif
+
+	// Get application settings, then update the user path.
 	//
 	auto appSettings(Application::AppSettings::Instance().lock());
 	assert(appSettings);
 	appSettings->UserPath( application->GetUserPath().c_str() );
 
+	// Reload the configuration files edited by other programs
+	//
+	Application::ConfigWatcher::Start();
+
 	// Show the UI
 	//
 	UI::MainWindow	mainWindow;
 	Gtk::Main::run( mainWindow );
 
+	Application::ConfigWatcher::Stop();
+
 	return 0;
 }
   
@@ -153,6 +168,7 @@ int main(int argc, char *argv[])
     Combatant::CharacterModel::Instance        ().lock()->Release();
     Initiative::InitiativeManager::Instance    ().lock()->Release();
     Attribute::StatManager::Instance           ().lock()->Release();
+    Transactions::CombatJournal::Instance      ().lock()->Release();
     Transactions::TransactionManager::Instance ().lock()->Release();
 
 	moNamePool::Done();
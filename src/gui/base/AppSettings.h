@@ -32,6 +32,8 @@
 namespace Application
 {
 
+class AppSettingsSchema;
+
 class AppSettings
 {
 public:
@@ -134,6 +136,8 @@ public:
 	VoidSignal			signal_changed() 						{ return f_changedSignal; }
 
 private:
+	friend class AppSettingsSchema;
+
 	typedef std::shared_ptr<AppSettings> private_pointer_t;
     static private_pointer_t f_instance;
 
@@ -173,38 +177,8 @@ private:
 	// Names
 	//
 	molib::moName f_mainBagName              ;
-	molib::moName f_toolbarPosPropName       ;
-	molib::moName f_rollInitOnStartPropName  ;
-	molib::moName f_manualInitiativePropName ;
-
-	molib::moName f_windowXPropName          ;
-	molib::moName f_windowYPropName          ;
-	molib::moName f_windowHeightPropName     ;
-	molib::moName f_windowWidthPropName      ;
-
-	molib::moName f_hudXPropName             ;
-	molib::moName f_hudYPropName             ;
-	molib::moName f_hudHeightPropName        ;
-	molib::moName f_hudWidthPropName         ;
-
-	molib::moName f_currentFolderPropName    ;
-	molib::moName f_ultraInitPropName        ;
-	molib::moName f_showToolbarPropName      ;
-	molib::moName f_bleedOutDyingPropName    ;
-	molib::moName f_skipDeadPropName         ;
-	molib::moName f_altDeathPropName         ;
-	molib::moName f_notifyExpiredEffectsName ;
-	molib::moName f_panePositionPropName     ;
-	molib::moName f_getDCPropName            ;
-	molib::moName f_lastDCPropName           ;
 	molib::moName f_versionPropName          ;
-	molib::moName f_showEffectsPropName      ;
-	molib::moName f_showInfoPropName         ;
-	molib::moName f_showHUDPropName          ;
-	molib::moName f_deathThresholdPropName   ;
 	molib::moName f_initDieStringsPropName   ;
-	molib::moName f_combatantListFontName    ;
-	molib::moName f_altCombatantListFontName ;
 
 	// Singleton only
 	//
@@ -22,6 +22,8 @@
 #include "base/StatManager.h"
 #include "transactions/CharacterEntry.h"
 
+#include <algorithm>
+
 using namespace molib;
 using namespace Attribute;
 
@@ -231,6 +233,80 @@ void CharacterManager::SaveCharacters( moPropBagRef& charBag )
 }
 
 
+/// \brief Apply a characters.conf modified by another program.
+///
+/// Only the characters whose saved bag differs from the one in the file
+/// are updated (in place, so the initiative order and the views keep
+/// their pointers); the characters missing from the file are removed
+/// and the new ones added.
+///
+void CharacterManager::ReloadCharacters( moPropBagRef& charBag )
+{
+	moPropArrayRef	array(f_arrayBagName);
+	array.Link( charBag );
+	if( !array.HasProp() ) return;
+
+	char_list_t loaded;
+	const int count = array.CountIndexes();
+	for( int idx = 0; idx < count; ++idx )
+	{
+		moPropSPtr		prop_ptr( array.Get( array.ItemNoAtIndex( idx ) ) );
+		const moProp	*item	( static_cast<moProp *>(prop_ptr) );
+		if( item == 0 || dynamic_cast<const moPropBag *>( item ) == 0 )
+		{
+			continue;
+		}
+		// refer to the item itself, the loaded bag is not kept
+		moPropBagRef	propBag( moPropRef( 0, item ) );
+
+		Combatant::Character::pointer_t ch( new Combatant::Character() );
+		ch->Load( propBag );
+		loaded.push_back( ch );
+
+		auto current( FindCharacter( ch->name() ) );
+		if( !current )
+		{
+			Insert( ch );
+			continue;
+		}
+
+		moPropBagRef currentBag( "CHARACTER" );
+		currentBag.NewProp();
+		current->Save( currentBag );
+		if( Common::BagChanged( currentBag, propBag ) )
+		{
+			current->Copy( ch );
+			current->signal_changed().emit();
+		}
+	}
+
+	char_list_t removed;
+	for( auto ch : f_chars )
+	{
+		const auto found = std::find_if( loaded.begin(), loaded.end(),
+				[&ch]( const char_pointer_t& l ) { return l->name() == ch->name(); } );
+		if( found == loaded.end() )
+		{
+			removed.push_back( ch );
+		}
+	}
+	for( auto ch : removed )
+	{
+		Remove( ch );
+	}
+}
+
+
+void CharacterManager::DirectoryChanged( const moWCString& /*directory*/, const moWCString& filename, unsigned long /*changes*/ )
+{
+	if( !Common::ConfigFileChanged( "characters.conf", filename ) ) return;
+
+	moPropBagRef propBag( f_propBagName );
+	if( !Common::ReloadBagFromFile( "characters.conf", propBag ) ) return;
+	ReloadCharacters( propBag );
+}
+
+
 void CharacterManager::Insert( Combatant::Character::pointer_t ch, const bool signal )
 {
 	ch->deleted( false );
@@ -28,12 +28,13 @@
 #include "base/character.h"
 #include "base/transaction.h"
 #include "base/LegacyCharacter.h"
+#include "mo/mo_directory_watcher.h"
 #include "mo/mo_props.h"
 
 namespace Combatant
 {
 
-class CharacterManager
+class CharacterManager : public molib::moDirectoryWatcherEvent
 {
 public:
     typedef std::weak_ptr<CharacterManager> pointer_t;
@@ -60,6 +61,11 @@ public:
 						, const bool emit_signals = true
 						);
 	void SaveCharacters( molib::moPropBagRef& charBag );
+	void ReloadCharacters( molib::moPropBagRef& charBag );
+
+	// moDirectoryWatcherEvent
+	//
+	virtual void DirectoryChanged( const molib::moWCString& directory, const molib::moWCString& filename, unsigned long changes );
 
 	const char_list_t &		GetCharacters() const	{ return f_chars; }
 	//
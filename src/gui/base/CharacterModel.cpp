@@ -75,10 +75,11 @@ CharacterModel::CharacterModel()
 
 	// Character manager signals
 	//
-	CharacterManager::Instance().lock()->signal_character_added()    .connect( sigc::mem_fun( *this, &CharacterModel::insertCharacter ) );
+	CharacterManager::Instance().lock()->signal_character_added()    .connect( sigc::mem_fun( *this, &CharacterModel::addCharacter    ) );
 	CharacterManager::Instance().lock()->signal_character_removed()  .connect( sigc::mem_fun( *this, &CharacterModel::removeCharacter ) );
 	CharacterManager::Instance().lock()->signal_cleared()            .connect( sigc::mem_fun( *this, &CharacterModel::clear           ) );
 
+	f_computedStats.Compile();
     init();
 }
 
@@ -130,9 +131,22 @@ void CharacterModel::clear()
 	{
 		f_store->clear();
 	}
+	f_computedStats.Clear();
 }
 
 
+void CharacterModel::addCharacter( Combatant::Character::pointer_t ch )
+{
+	f_computedStats.Update( Combatant::Character::list_t( 1, ch ) );
+	insertCharacter( ch );
+}
+
+
+/// \brief Add a row for the character.
+///
+/// The computed stats of the character must be up to date, the row
+/// only reads the results of the last ComputedStats::Update().
+///
 void CharacterModel::insertCharacter( Combatant::Character::pointer_t ch )
 {
     assert(f_store);
@@ -171,6 +185,8 @@ void CharacterModel::removeCharacter( Combatant::Character::pointer_t ch )
 		//
 		f_store->erase( iter );
 	}
+
+	f_computedStats.Forget( ch );
 }
 
 
@@ -181,6 +197,9 @@ void CharacterModel::updateCharacter( Combatant::Character::pointer_t ch )
     iterator_t iter( findCharacter( ch ) );
 	if( iter != f_store->children().end() )
 	{
+		// Only re-evaluates the computed stats whose inputs changed
+		//
+		f_computedStats.Update( Combatant::Character::list_t( 1, ch ) );
 		updateRow( *iter );
 	}
 }
@@ -310,10 +329,17 @@ void CharacterModel::updateSoftColumns( const Gtk::TreeRow& row, const QString&
 	{
 		auto stat( statPair.second );
 		auto id  ( stat->id() );
-		const int  roll ( ch->getRoll( id ) );
+		int  roll ( ch->peekRoll( id ) );
 		std::stringstream	ss;
 		ss << roll << std::ends;
-		const QString text( ss.str().c_str() );
+		QString text( ss.str().c_str() );
+		//
+		ComputedStats::Result computed;
+		if( stat->computed() && f_computedStats.GetResult( ch, id, computed ) )
+		{
+			roll = computed.f_value;
+			text = computed.f_text;
+		}
 #if 0
 		bool show = true;
 		//
@@ -431,7 +457,7 @@ void CharacterModel::updateRow( const Gtk::TreeRow& row )
 	//
 	row[f_columns->GetBackgroundColor()] = default_background_color;
 
-	const int  init		= ch->getRoll( StatManager::Instance().lock()->initId() );
+	const int  init		= ch->peekRoll( StatManager::Instance().lock()->initId() );
 	const bool editable	= false;
 
 	row[f_columns->GetStyle      ()] = style;
@@ -616,6 +642,12 @@ void CharacterModel::on_stats_changed()
 {
     init();
 
+	// Evaluate the computed stats of the whole roster in one pass, the
+	// rows added below then find their results in the cache
+	//
+	f_computedStats.Compile();
+	f_computedStats.Update( CharacterManager::Instance().lock()->GetCharacters() );
+
 	// Re-add the character entires from the character manager
 	//
 	for( auto ch : CharacterManager::Instance().lock()->GetCharacters() )
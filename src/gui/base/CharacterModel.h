@@ -26,6 +26,7 @@
 //
 #include "base/character.h"
 #include "base/CharacterColumns.h"
+#include "base/ComputedStats.h"
 #include "base/stat.h"
 
 namespace Combatant
@@ -107,6 +108,7 @@ private:
 	tree_model_sort_t                      			f_initSort;
 	path_t                                 			f_currentPath;
 	CharacterColumns::pointer_t 					f_columns;
+	Attribute::ComputedStats						f_computedStats;
 	pixbuf_t                               			f_pixbufArrow;
 	pixbuf_t                               			f_pixbufMonster;
 	pixbuf_t                               			f_pixbufCharacter;
@@ -124,6 +126,7 @@ private:
 
 	// Private methods
 	//
+	void		addCharacter   ( character_t ch );
 	void		insertCharacter( character_t ch );
 	void 		removeCharacter( character_t ch );
 	void		updateCharacter( character_t ch );
@@ -0,0 +1,426 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+// LOCAL
+//
+#include "base/CombatJournal.h"
+#include "base/CharacterManager.h"
+#include "base/InitiativeManager.h"
+
+#include "mo/mo_application.h"
+#include "mo/mo_props_binary.h"
+
+#include <iostream>
+
+using namespace molib;
+
+namespace Transactions
+{
+
+
+namespace
+{
+	const char*		g_journalFilename	= "combat.journal";
+	const char*		g_stateBagName		= "COMBAT";
+	const char*		g_initBagName		= "INITIATIVE";
+
+	// Each record starts with one of these followed by a binary prop bag
+	//
+	const unsigned char	g_fullRecord	= 'F';
+	const unsigned char	g_deltaRecord	= 'D';
+
+	// Force a checkpoint when the journal grows too large or gets too old
+	//
+	const unsigned long	g_checkpointSize	= 256 * 1024;
+	const time_t		g_checkpointSecs	= 5 * 60;
+
+	moPropBag& Bag( const moPropBagRef& ref )
+	{
+		return dynamic_cast<moPropBag&>(*ref.GetProperty());
+	}
+
+
+	/// \brief Rebuild the last journaled state from the records
+	//
+	// A full record replaces the state, a delta record is merged in it.
+	//
+	class StateReplay : public moJournal::moReplayHandler
+	{
+	public:
+		StateReplay() : f_state( g_stateBagName ), f_count(0) {}
+
+		virtual bool Record( moJournal::sequence_t sequence, const moBuffer& data )
+		{
+			void*			ptr;
+			unsigned long	size;
+			data.Get( ptr, size );
+			if( size < 1 ) return false;
+			//
+			const unsigned char* p( static_cast<const unsigned char*>(ptr) );
+			moBuffer bagData;
+			bagData.Append( p + 1, size - 1 );
+			//
+			moPropBagRef bag( g_stateBagName );
+			bag.NewProp();
+			if( moBinaryLoadPropBag( bagData, bag ) != 0 ) return false;
+			//
+			if( p[0] == g_fullRecord )
+			{
+				f_state = bag;
+			}
+			else if( p[0] == g_deltaRecord && f_state.HasProp() )
+			{
+				Bag( f_state ).Merge( Bag( bag ) );
+			}
+			else
+			{
+				// a delta without a full record is of no use
+				return false;
+			}
+			++f_count;
+			return true;
+		}
+
+		moPropBagRef	f_state;
+		int				f_count;
+	};
+}
+
+
+CombatJournal::private_pointer_t	CombatJournal::f_instance;
+
+
+/// \brief Constructor
+//
+// Opens (or creates) the journal in the user's private directory and
+// records the combat state each time the transaction manager changes it.
+//
+CombatJournal::CombatJournal()
+	: f_state			( g_stateBagName )
+	, f_lastGeneration	( 0 )
+	, f_needFullRecord	( true )
+	, f_recordCount		( 0 )
+	, f_lastCheckpoint	( time(0) )
+{
+	f_state.NewProp();
+	//
+	const moWCString filename( moApplication::Instance()->GetPrivateUserPath( false /*append_version*/ ).FilenameChild( g_journalFilename ) );
+	if( !f_journal.Open( filename ) )
+	{
+		std::cerr << "warning: cannot open the combat journal \"" << filename.c_str() << "\"; changes will only be saved on checkpoints" << std::endl;
+	}
+	//
+	f_updateConnection = TransactionManager::Instance().lock()->signal_update().connect( sigc::mem_fun( *this, &CombatJournal::Record ) );
+}
+
+
+CombatJournal::~CombatJournal()
+{
+	f_updateConnection.disconnect();
+	for( auto& c : f_charConnections )
+	{
+		c.disconnect();
+	}
+	f_journal.Close();
+}
+
+
+CombatJournal::pointer_t CombatJournal::Instance()
+{
+	if( !f_instance )
+	{
+		f_instance.reset( new CombatJournal );
+	}
+	return f_instance;
+}
+
+
+void CombatJournal::Release()
+{
+	f_instance.reset();
+}
+
+
+/// \brief Collect the current characters and initiative state in one bag
+//
+void CombatJournal::BuildState( moPropBagRef& stateBag )
+{
+	auto charMgr( Combatant::CharacterManager::Instance().lock() );
+	assert(charMgr);
+	auto initMgr( Initiative::InitiativeManager::Instance().lock() );
+	assert(initMgr);
+
+	charMgr->SaveCharacters( stateBag );
+	//
+	moPropBagRef initBag( g_initBagName );
+	initBag.NewProp();
+	initMgr->SaveInitData( initBag );
+	stateBag.Set( g_initBagName, initBag );
+}
+
+
+/// \brief Merge the current state in f_state
+//
+// Only the properties which really changed get a new generation, which is
+// what makes the delta records small.
+//
+void CombatJournal::MergeState()
+{
+	moPropBagRef stateBag( g_stateBagName );
+	stateBag.NewProp();
+	BuildState( stateBag );
+	Bag( f_state ).Merge( Bag( stateBag ), true /*remove_missing*/ );
+	WatchCharacters();
+}
+
+
+/// \brief Remember which characters f_state holds and listen to their changes
+//
+void CombatJournal::WatchCharacters()
+{
+	auto charMgr( Combatant::CharacterManager::Instance().lock() );
+	assert(charMgr);
+
+	for( auto& c : f_charConnections )
+	{
+		c.disconnect();
+	}
+	f_charConnections.clear();
+	f_charIndex.clear();
+	f_dirtyChars.clear();
+
+	f_stateChars = charMgr->GetCharacters();
+	int idx = 0;
+	for( auto ch : f_stateChars )
+	{
+		f_charIndex[ch.get()] = idx++;
+		f_charConnections.push_back( ch->signal_changed().connect( sigc::bind( sigc::mem_fun( *this, &CombatJournal::OnCharacterChanged ), ch.get() ) ) );
+	}
+}
+
+
+void CombatJournal::OnCharacterChanged( Combatant::Character* ch )
+{
+	f_dirtyChars.insert( ch );
+}
+
+
+/// \brief Update f_state with what changed since the previous record
+//
+// The transactions emit Character::signal_changed() for the characters they
+// modify. The characters in the initiative list are always saved again since
+// moving in the initiative changes their position without a signal. When the
+// list of characters itself changed, the whole state is merged again.
+//
+void CombatJournal::UpdateState()
+{
+	auto charMgr( Combatant::CharacterManager::Instance().lock() );
+	assert(charMgr);
+	auto initMgr( Initiative::InitiativeManager::Instance().lock() );
+	assert(initMgr);
+
+	if( charMgr->GetCharacters() != f_stateChars )
+	{
+		MergeState();
+		return;
+	}
+
+	for( auto ch : initMgr->GetCharacterList() )
+	{
+		f_dirtyChars.insert( ch.get() );
+	}
+
+	moPropArrayRef array( "CHARACTERS" );
+	array.Link( f_state );
+	for( auto ch : f_dirtyChars )
+	{
+		const auto found( f_charIndex.find( ch ) );
+		if( found == f_charIndex.end() || !array.HasProp() )
+		{
+			continue;
+		}
+		moPropBagRef charBag( "CHARACTER" );
+		charBag.NewProp();
+		ch->Save( charBag );
+		//
+		moPropSPtr item( array.Get( found->second ) );
+		moPropBag* itemBag( dynamic_cast<moPropBag*>(static_cast<moProp*>(item)) );
+		if( itemBag != 0 )
+		{
+			itemBag->Merge( Bag( charBag ), true /*remove_missing*/ );
+		}
+		else
+		{
+			array.Set( found->second, charBag );
+		}
+	}
+	f_dirtyChars.clear();
+
+	moPropBagRef initBag( g_initBagName );
+	initBag.NewProp();
+	initMgr->SaveInitData( initBag );
+	moPropBagRef stateInit( g_initBagName );
+	stateInit.Link( f_state );
+	if( stateInit.HasProp() )
+	{
+		Bag( stateInit ).Merge( Bag( initBag ), true /*remove_missing*/ );
+	}
+	else
+	{
+		f_state.Set( g_initBagName, initBag );
+	}
+}
+
+
+/// \brief Append the current combat state to the journal
+//
+// Called after each transaction is applied, undone or redone. Only the
+// properties modified since the previous record are saved unless something
+// was removed (a delta cannot express that) in which case the whole state
+// is saved. The record is committed immediately; the data sync is batched
+// by the journal (group commit).
+//
+void CombatJournal::Record()
+{
+	++f_recordCount;
+	if( !f_journal.IsOpen() ) return;
+
+	UpdateState();
+	//
+	const moProp::generation_t generation( f_state.GetProperty()->GetGeneration() );
+	if( generation <= f_lastGeneration ) return;		// nothing changed
+
+	const bool full( f_needFullRecord || f_state.GetProperty()->GetRemovalGeneration() > f_lastGeneration );
+	//
+	moBuffer bagData;
+	if( moBinarySavePropBag( bagData, f_state, full ? 0 : f_lastGeneration ) != 0 ) return;
+	//
+	moBuffer record;
+	const unsigned char type( full ? g_fullRecord : g_deltaRecord );
+	record.Append( &type, 1 );
+	record.Append( static_cast<const void*>(bagData), bagData.GetSize() );
+	//
+	f_journal.Append( record );
+	if( f_journal.Commit() )
+	{
+		f_lastGeneration = moProp::CurrentGeneration();
+		f_needFullRecord = false;
+	}
+	else
+	{
+		f_needFullRecord = true;
+	}
+}
+
+
+/// \brief Sync the journal records which were written but not yet synced
+//
+// Call this from a timer so a quiet period does not leave records unsynced.
+//
+void CombatJournal::Sync()
+{
+	f_journal.Sync();
+}
+
+
+/// \brief Whether the managers should do a full save now
+//
+// Only when something changed since the last checkpoint; without a journal,
+// every change needs a full save.
+//
+bool CombatJournal::CheckpointDue() const
+{
+	return f_recordCount > 0
+		&& ( !f_journal.IsOpen()
+		  || f_journal.GetSize() >= g_checkpointSize
+		  || time(0) - f_lastCheckpoint >= g_checkpointSecs );
+}
+
+
+/// \brief The managers were saved, the journal is not needed anymore
+//
+// The current state is merged so the next record is only written if
+// something changes after the checkpoint.
+//
+void CombatJournal::Checkpoint()
+{
+	f_lastCheckpoint = time(0);
+	f_recordCount = 0;
+	if( !f_journal.IsOpen() ) return;
+
+	MergeState();
+	f_journal.Truncate();
+	f_lastGeneration = moProp::CurrentGeneration();
+	f_needFullRecord = true;
+}
+
+
+/// \brief Replay the journal left behind by a crash
+//
+// The managers have already loaded the last checkpoint. If the journal
+// includes records, the last recorded state replaces what the managers
+// loaded; the managers are then saved and the journal truncated.
+//
+/// \return true if a state was recovered from the journal
+//
+bool CombatJournal::Recover()
+{
+	if( !f_journal.IsOpen() ) return false;
+
+	StateReplay replay;
+	f_journal.Replay( replay );
+	if( replay.f_count == 0 || !replay.f_state.HasProp() )
+	{
+		return false;
+	}
+
+	auto charMgr( Combatant::CharacterManager::Instance().lock() );
+	assert(charMgr);
+	auto initMgr( Initiative::InitiativeManager::Instance().lock() );
+	assert(initMgr);
+
+	moPropArrayRef charArray( "CHARACTERS" );
+	charArray.Link( replay.f_state );
+	if( charArray.HasProp() )
+	{
+		charMgr->PermanentClear();
+		charMgr->LoadCharacters( replay.f_state );
+	}
+	//
+	moPropBagRef initBag( g_initBagName );
+	initBag.Link( replay.f_state );
+	if( initBag.HasProp() )
+	{
+		initMgr->LoadInitData( initBag );
+	}
+
+	// Make the recovered state the new checkpoint
+	//
+	charMgr->Save();
+	initMgr->Save();
+	Checkpoint();
+
+	return true;
+}
+
+
+}
+// namespace Transactions
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
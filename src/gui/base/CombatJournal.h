@@ -0,0 +1,112 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+#pragma once
+
+// STL
+//
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include <time.h>
+
+// molib
+//
+#include "mo/mo_journal.h"
+#include "mo/mo_props.h"
+
+// sigc++
+//
+#include <sigc++/sigc++.h>
+
+// LOCAL
+//
+#include "base/character.h"
+#include "base/transaction.h"
+
+namespace Transactions
+{
+
+/// \brief Write-ahead journal of the combat state
+//
+// Every time the TransactionManager applies, undoes or redoes a transaction,
+// the characters and initiative state is appended to a binary journal (only
+// the properties which changed since the previous record). The managers' full
+// Save() becomes a checkpoint which truncates the journal. On startup,
+// Recover() replays what was journaled since the last checkpoint.
+//
+// Only the characters which signaled a change and the characters in the
+// initiative list are serialized again for a record, so the cost of a
+// record does not grow with the size of the character library.
+//
+class CombatJournal
+{
+public:
+	typedef std::weak_ptr<CombatJournal>	pointer_t;
+
+	static pointer_t Instance();
+	static void Release();
+	~CombatJournal();
+
+	bool	Recover();
+	void	Record();
+	void	Sync();
+	bool	CheckpointDue() const;
+	void	Checkpoint();
+
+private:
+	typedef std::shared_ptr<CombatJournal>	private_pointer_t;
+	static private_pointer_t f_instance;
+
+	// Non-copyable
+	//
+	CombatJournal();
+	CombatJournal( const CombatJournal& );
+	CombatJournal& operator =( const CombatJournal& );
+
+	// Data members
+	//
+	typedef std::map<Combatant::Character*, int>	char_index_t;
+	typedef std::set<Combatant::Character*>			char_set_t;
+
+	molib::moJournal				f_journal;
+	molib::moPropBagRef				f_state;
+	molib::moProp::generation_t		f_lastGeneration;
+	bool							f_needFullRecord;
+	unsigned long					f_recordCount;		// records since the last checkpoint
+	time_t							f_lastCheckpoint;
+	sigc::connection				f_updateConnection;
+	Combatant::Character::list_t	f_stateChars;		// characters in f_state, in order
+	char_index_t					f_charIndex;
+	char_set_t						f_dirtyChars;
+	std::vector<sigc::connection>	f_charConnections;
+
+	// Private methods
+	//
+	void	BuildState( molib::moPropBagRef& stateBag );
+	void	MergeState();
+	void	UpdateState();
+	void	WatchCharacters();
+	void	OnCharacterChanged( Combatant::Character* ch );
+};
+
+}
+// namespace Transactions
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
@@ -0,0 +1,359 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+// LOCAL
+//
+#include "base/ComputedStats.h"
+#include "base/StatManager.h"
+
+// STL
+//
+#include <cmath>
+
+using namespace molib;
+using namespace Combatant;
+
+namespace Attribute
+{
+
+namespace
+{
+	/// \brief Transform a stat name in a moExpr identifier.
+	///
+	/// Anything which is not an ASCII letter or digit becomes an
+	/// underscore so "Move Silently" is available as Move_Silently.
+	///
+	std::string MakeIdentifier( const QString& name )
+	{
+		std::string id( name.toUtf8().data() );
+		for( auto& c : id )
+		{
+			const unsigned char u( static_cast<unsigned char>(c) );
+			if( u >= 0x80 || !isalnum( u ) )
+			{
+				c = '_';
+			}
+		}
+		return id;
+	}
+}
+// no name namespace
+
+
+ComputedStats::ComputedStats()
+{
+}
+
+
+/// \brief Compile the expressions of all the computed stats.
+///
+/// This must be called whenever the stats change. All the cached results
+/// are dropped so the next Update() evaluates every row.
+///
+/// A computed stat cannot be the input of another one; its name is
+/// left undefined and the expression fails to evaluate.
+///
+void ComputedStats::Compile()
+{
+	f_sources.clear();
+	f_columns.clear();
+	f_rows.clear();
+
+	const auto& stats( StatManager::Instance().lock()->GetStats() );
+
+	name_map_t stat_names;
+	for( auto statPair : stats )
+	{
+		auto stat( statPair.second );
+		if( !stat->deleted() && !stat->computed() )
+		{
+			stat_names[MakeIdentifier( stat->name() )] = stat->id();
+		}
+	}
+
+	for( auto statPair : stats )
+	{
+		auto stat( statPair.second );
+		if( stat->deleted() || !stat->computed() )
+		{
+			continue;
+		}
+
+		Column column;
+		column.f_id      = stat->id();
+		column.f_program = moExprProgram::Compile( moWCString( stat->expression().toUtf8().data() ) );
+
+		const unsigned long count( column.f_program->InputCount() );
+		for( unsigned long idx = 0; idx < count; ++idx )
+		{
+			column.f_sources.push_back( AddSource( column.f_program->InputName( idx ), stat_names ) );
+		}
+
+		f_columns.push_back( column );
+	}
+}
+
+
+/// \brief Find or add the source of the input named \p name.
+///
+/// \return the index of the source in f_sources
+///
+int ComputedStats::AddSource( const moWCString& name, const name_map_t& stat_names )
+{
+	Source source;
+	source.f_type = Source::UNKNOWN;
+	source.f_stat = moName( "UNNAMED" );
+
+	const std::string id( name.c_str() );
+	if     ( id == "hp"         ) source.f_type = Source::HIT_POINTS;
+	else if( id == "max_hp"     ) source.f_type = Source::MAX_HP;
+	else if( id == "temp_hp"    ) source.f_type = Source::TEMP_HP;
+	else if( id == "hp_percent" ) source.f_type = Source::HP_PERCENT;
+	else if( id == "damage"     ) source.f_type = Source::DAMAGE;
+	else if( id == "monster"    ) source.f_type = Source::MONSTER;
+	else
+	{
+		auto iter( stat_names.find( id ) );
+		if( iter != stat_names.end() )
+		{
+			source.f_type = Source::STAT_ROLL;
+			source.f_stat = iter->second;
+		}
+		else if( id.size() > 4 && id.compare( id.size() - 4, 4, "_mod" ) == 0 )
+		{
+			iter = stat_names.find( id.substr( 0, id.size() - 4 ) );
+			if( iter != stat_names.end() )
+			{
+				source.f_type = Source::STAT_MOD;
+				source.f_stat = iter->second;
+			}
+		}
+	}
+
+	for( size_t idx = 0; idx < f_sources.size(); ++idx )
+	{
+		if( f_sources[idx] == source )
+		{
+			return static_cast<int>(idx);
+		}
+	}
+	f_sources.push_back( source );
+	return static_cast<int>(f_sources.size() - 1);
+}
+
+
+int ComputedStats::GetSourceValue( Character::pointer_t ch, const Source& source ) const
+{
+	switch( source.f_type )
+	{
+		case Source::STAT_ROLL:		return ch->peekRoll( source.f_stat );
+		case Source::STAT_MOD:		return ch->peekMod ( source.f_stat );
+		case Source::HIT_POINTS:	return ch->hitpoints() + ch->tempHP();
+		case Source::MAX_HP:		return ch->maxHP();
+		case Source::TEMP_HP:		return ch->tempHP();
+		case Source::DAMAGE:		return ch->damage();
+		case Source::MONSTER:		return ch->monster() ? 1 : 0;
+
+		case Source::HP_PERCENT:
+		{
+			const int max_hp( ch->maxHP() );
+			return max_hp > 0 ? (ch->hitpoints() + ch->tempHP()) * 100 / max_hp : 0;
+		}
+
+		default:
+			return 0;
+	}
+}
+
+
+/// \brief Evaluate the computed stats of the characters in \p roster.
+///
+/// The inputs of all the programs are first gathered for the whole roster
+/// in one table. Then each program is run over the rows where one of its
+/// own inputs changed (or which were never evaluated) so editing the HP of
+/// one character does not re-run the expressions which only use its AC,
+/// nor anything for the other characters.
+///
+void ComputedStats::Update( const Character::list_t& roster )
+{
+	if( f_columns.empty() )
+	{
+		return;
+	}
+
+	const size_t width( f_sources.size() );
+	const size_t height( roster.size() );
+
+	std::vector<int> values( width * height );
+	for( size_t r = 0; r < height; ++r )
+	{
+		int *row_values( values.data() + r * width );
+		for( size_t s = 0; s < width; ++s )
+		{
+			row_values[s] = GetSourceValue( roster[r], f_sources[s] );
+		}
+	}
+
+	// a row which was never evaluated has all of its inputs changed
+	std::vector<char> changed( width * height, 1 );
+	std::vector<char> fresh( height, 0 );
+	std::vector<Row *> rows( height );
+	for( size_t r = 0; r < height; ++r )
+	{
+		Row& row( f_rows[roster[r].get()] );
+		rows[r] = &row;
+		if( row.f_results.size() != f_columns.size() || row.f_values.size() != width )
+		{
+			row.f_results.resize( f_columns.size() );
+			fresh[r] = 1;
+			continue;
+		}
+		for( size_t s = 0; s < width; ++s )
+		{
+			changed[r * width + s] = row.f_values[s] != values[r * width + s];
+		}
+	}
+
+	std::vector<moExprValue> inputs;
+	for( size_t c = 0; c < f_columns.size(); ++c )
+	{
+		const Column& column( f_columns[c] );
+		const size_t count( column.f_sources.size() );
+		inputs.resize( count );
+
+		for( size_t r = 0; r < height; ++r )
+		{
+			bool dirty( fresh[r] != 0 );
+			for( size_t i = 0; i < count && !dirty; ++i )
+			{
+				dirty = changed[r * width + column.f_sources[i]] != 0;
+			}
+			if( !dirty )
+			{
+				continue;
+			}
+
+			for( size_t i = 0; i < count; ++i )
+			{
+				const int s( column.f_sources[i] );
+				if( f_sources[s].f_type == Source::UNKNOWN )
+				{
+					inputs[i].SetUndefined();
+				}
+				else
+				{
+					inputs[i].SetInteger( values[r * width + s] );
+				}
+			}
+
+			moExprValue value;
+			Result& result( rows[r]->f_results[c] );
+			if( column.f_program->Evaluate( value, inputs.data(), count ) != moExpr::MO_EXPR_ERROR_NONE )
+			{
+				result.f_value = 0;
+				result.f_text  = "ERROR";
+				result.f_valid = false;
+				continue;
+			}
+
+			switch( value.Type() )
+			{
+				case moExprValue::MO_EXPR_VALUE_INTEGER:
+					result.f_value = static_cast<int>(value.Integer());
+					break;
+
+				case moExprValue::MO_EXPR_VALUE_FLOAT:
+					result.f_value = static_cast<int>(lround( value.Float() ));
+					break;
+
+				default:
+					result.f_value = 0;
+					break;
+			}
+			result.f_text  = value.ToString().c_str();
+			result.f_valid = true;
+		}
+	}
+
+	for( size_t r = 0; r < height; ++r )
+	{
+		rows[r]->f_values.assign( values.begin() + r * width, values.begin() + (r + 1) * width );
+	}
+}
+
+
+/// \brief Drop the cached results of a character removed from the roster.
+///
+void ComputedStats::Forget( Character::pointer_t ch )
+{
+	f_rows.erase( ch.get() );
+}
+
+
+/// \brief Drop all the cached results, the programs are kept.
+///
+void ComputedStats::Clear()
+{
+	f_rows.clear();
+}
+
+
+bool ComputedStats::IsComputed( const mo_name_t id ) const
+{
+	for( const auto& column : f_columns )
+	{
+		if( column.f_id == id )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/// \brief Retrieve the result computed by the last Update() of \p ch.
+///
+/// \return false if \p id is not a computed stat or the character was not
+/// part of an Update() since the last Compile()
+///
+bool ComputedStats::GetResult( Character::pointer_t ch, const mo_name_t id, Result& result ) const
+{
+	auto row( f_rows.find( ch.get() ) );
+	if( row == f_rows.end() )
+	{
+		return false;
+	}
+	for( size_t c = 0; c < f_columns.size(); ++c )
+	{
+		if( f_columns[c].f_id == id )
+		{
+			if( c >= row->second.f_results.size() )
+			{
+				return false;
+			}
+			result = row->second.f_results[c];
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+// namespace Attribute
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
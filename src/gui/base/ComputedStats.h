@@ -0,0 +1,120 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+#pragma once
+
+// Local includes
+//
+#include "base/character.h"
+
+// molib
+//
+#include "mo/mo_expr.h"
+#include "mo/mo_name.h"
+
+// QT
+//
+#include <QString>
+
+// STL
+//
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Attribute
+{
+
+/// \brief Evaluate the computed stats over the whole roster.
+///
+/// A computed stat has a moExpr expression instead of a stored value.
+/// Compile() turns the expressions of all the stats into programs once,
+/// and Update() evaluates them over a list of characters.
+///
+/// The inputs of the programs are named after the stats ("AC", "Dex_mod")
+/// or a few character values ("hp", "max_hp", "hp_percent"...). Update()
+/// gathers these values for all the characters in one flat table and only
+/// evaluates the programs of the rows where one of their inputs changed
+/// since the previous call; the other rows keep their cached result.
+///
+class ComputedStats
+{
+public:
+	typedef std::shared_ptr<ComputedStats>	pointer_t;
+
+	/// \brief The cached result of one computed stat for one character.
+	struct Result
+	{
+		Result() : f_value(0), f_valid(false) {}
+
+		int			f_value;	// numeric value, used to sort and compare with the DC
+		QString		f_text;		// what the column shows
+		bool		f_valid;	// false when the expression failed
+	};
+
+	ComputedStats();
+
+	void			Compile();
+	void			Update( const Combatant::Character::list_t& roster );
+	void			Forget( Combatant::Character::pointer_t ch );
+	void			Clear();
+
+	bool			IsComputed( const molib::mo_name_t id ) const;
+	bool			GetResult( Combatant::Character::pointer_t ch, const molib::mo_name_t id, Result& result ) const;
+
+private:
+	/// \brief Where the value of one program input comes from.
+	struct Source
+	{
+		enum type_t { STAT_ROLL, STAT_MOD, HIT_POINTS, MAX_HP, TEMP_HP, HP_PERCENT, DAMAGE, MONSTER, UNKNOWN };
+
+		bool operator == ( const Source& rhs ) const { return f_type == rhs.f_type && f_stat == rhs.f_stat; }
+
+		type_t				f_type;
+		molib::mo_name_t	f_stat;
+	};
+
+	struct Column
+	{
+		molib::mo_name_t			f_id;
+		molib::moExprProgramSPtr	f_program;
+		std::vector<int>			f_sources;	// index in f_sources of each program input
+	};
+
+	struct Row
+	{
+		std::vector<int>	f_values;	// the gathered sources at the last Update()
+		std::vector<Result>	f_results;	// one per column
+	};
+
+	typedef std::map<const Combatant::Character *, Row>	row_map_t;
+	typedef std::map<std::string, molib::mo_name_t>			name_map_t;
+
+	int				AddSource( const molib::moWCString& name, const name_map_t& stat_names );
+	int				GetSourceValue( Combatant::Character::pointer_t ch, const Source& source ) const;
+
+	std::vector<Source>			f_sources;
+	std::vector<Column>			f_columns;
+	row_map_t					f_rows;
+};
+
+}
+// namespace Attribute
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
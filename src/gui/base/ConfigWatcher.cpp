@@ -0,0 +1,144 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+#include "base/ConfigWatcher.h"
+#include "base/CharacterManager.h"
+#include "base/StatManager.h"
+
+// MOLIB
+//
+#include "mo/mo_application.h"
+#include "mo/mo_directory_watcher.h"
+
+// GLIB
+//
+#include <glibmm/main.h>
+
+using namespace molib;
+
+namespace Application
+{
+
+namespace
+{
+	/// \brief Forward the changes to the managers.
+	///
+	/// The stats go first since the characters refer to them.
+	///
+	class Receiver : public moEventReceiver, public moDirectoryWatcherEvent
+	{
+	public:
+		virtual void DirectoryChanged( const moWCString& directory, const moWCString& filename, unsigned long changes )
+		{
+			Attribute::StatManager::Instance().lock()->DirectoryChanged( directory, filename, changes );
+			Combatant::CharacterManager::Instance().lock()->DirectoryChanged( directory, filename, changes );
+		}
+	};
+
+	// a change is posted at most 4 delays after it happened, keep
+	// polling a little longer than that after the last activity
+	const int							IDLE_TICKS = 5;
+
+	moSmartPtr<moEventPipeBroadcast>	g_pipe;
+	moSmartPtr<Receiver>				g_receiver;
+	moDirectoryWatcherSPtr				g_watcher;
+	sigc::connection					g_ioConnection;
+	sigc::connection					g_timerConnection;
+	int									g_idleTicks = 0;
+
+	unsigned long Dispatch()
+	{
+		const unsigned long posted = g_watcher->Poll( 0 );
+		moEventSPtr event;
+		while( g_pipe->Peek( event, true ) );
+		return posted;
+	}
+
+	bool OnTimer()
+	{
+		if( Dispatch() > 0 )
+		{
+			g_idleTicks = 0;
+		}
+		else if( ++g_idleTicks >= IDLE_TICKS )
+		{
+			// nothing pending anymore, wait for the next change
+			g_timerConnection.disconnect();
+			return false;
+		}
+		return true;
+	}
+
+	bool OnChanges( Glib::IOCondition /*condition*/ )
+	{
+		Dispatch();
+		g_idleTicks = 0;
+		if( !g_timerConnection.connected() )
+		{
+			g_timerConnection = Glib::signal_timeout().connect( sigc::ptr_fun( &OnTimer ), g_watcher->GetDelay() );
+		}
+		return true;
+	}
+}
+// no name namespace
+
+
+/// \brief Start watching the configuration files.
+///
+/// Call once the managers were created. Without inotify (or on other
+/// systems) nothing is watched and the files are only read at startup.
+///
+void ConfigWatcher::Start()
+{
+	if( g_watcher ) return;
+
+	g_pipe     = new moEventPipeBroadcast;
+	g_receiver = new Receiver;
+	g_pipe->AddReceiver( g_receiver );
+	g_watcher  = new moDirectoryWatcher( g_pipe );
+
+	const moWCString path( moApplication::Instance()->GetPrivateUserPath( false /*append_version*/ ) );
+	if( !g_watcher->Watch( path, "*.conf*" ) || g_watcher->GetFileDescriptor() < 0 )
+	{
+		Stop();
+		return;
+	}
+
+	g_ioConnection = Glib::signal_io().connect( sigc::ptr_fun( &OnChanges ), g_watcher->GetFileDescriptor(), Glib::IO_IN );
+}
+
+
+/// \brief Stop watching, before the managers get released.
+///
+void ConfigWatcher::Stop()
+{
+	g_ioConnection.disconnect();
+	g_timerConnection.disconnect();
+	if( g_pipe )
+	{
+		g_pipe->RemoveAllReceivers();
+	}
+	g_watcher  = 0;
+	g_receiver = 0;
+	g_pipe     = 0;
+}
+
+}
+// namespace Application
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
@@ -0,0 +1,42 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+#pragma once
+
+namespace Application
+{
+
+/// \brief Reload the configuration files modified by other programs.
+///
+/// Start() watches the private user folder with a molib::moDirectoryWatcher
+/// polled from the Glib main loop, so nothing runs while the files do not
+/// change (i.e. a shared folder costs nothing while idle). Each change is
+/// given to the managers deriving from molib::moDirectoryWatcherEvent,
+/// which reload only their own file and only the entries that changed.
+///
+class ConfigWatcher
+{
+public:
+	static void				Start();
+	static void				Stop();
+};
+
+}
+// namespace Application
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
@@ -592,13 +592,8 @@ bool InitiativeManager::Load()
 }
 
 
-bool InitiativeManager::Save()
+void InitiativeManager::SaveInitData( molib::moPropBagRef& mainPropBag )
 {
-	// Create sub-bag
-	//
-	moPropBagRef mainPropBag( f_mainBagName );
-	mainPropBag.NewProp();
-
 	// Local properties
 	//
 	mainPropBag += f_inRoundsProp;
@@ -636,6 +631,16 @@ bool InitiativeManager::Save()
 	}
 	//
 	mainPropBag += array;
+}
+
+
+bool InitiativeManager::Save()
+{
+	// Create sub-bag
+	//
+	moPropBagRef mainPropBag( f_mainBagName );
+	mainPropBag.NewProp();
+	SaveInitData( mainPropBag );
 
 	// Save file
 	//
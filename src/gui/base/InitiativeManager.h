@@ -114,6 +114,7 @@ public:
 	// Persistence
 	//
     void							LoadInitData( molib::moPropBagRef& initBag );
+    void							SaveInitData( molib::moPropBagRef& initBag );
     bool							Load();
     bool							Save();
 
@@ -22,6 +22,7 @@
 #include "base/AppSettings.h"
 #include "base/CharacterManager.h"
 #include "base/CharacterModel.h"
+#include "base/CombatJournal.h"
 #include "base/InitiativeManager.h"
 #include "base/StatManager.h"
 #include "base/transaction.h"
@@ -49,6 +50,7 @@ protected:
     std::weak_ptr<Initiative::InitiativeManager>    GetInitMgr        () const { return Initiative::InitiativeManager::Instance    (); }
     std::weak_ptr<Attribute::StatManager>           GetStatMgr        () const { return Attribute::StatManager::Instance           (); }
     std::weak_ptr<Transactions::TransactionManager> GetTransactionMgr () const { return Transactions::TransactionManager::Instance (); }
+    std::weak_ptr<Transactions::CombatJournal>      GetCombatJournal  () const { return Transactions::CombatJournal::Instance      (); }
 };
 
 
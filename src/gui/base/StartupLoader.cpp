@@ -0,0 +1,266 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+// LOCAL
+//
+#include "base/StartupLoader.h"
+#include "base/common.h"
+#include "base/AppSettings.h"
+#include "base/CharacterManager.h"
+#include "base/InitiativeManager.h"
+#include "base/StatManager.h"
+
+// MOLIB
+//
+#include "mo/mo_props_xml.h"
+#include "mo/mo_thread.h"
+
+// STL
+//
+#include <chrono>
+#include <map>
+#include <string>
+
+using namespace molib;
+
+namespace Application
+{
+
+namespace
+{
+	typedef std::chrono::steady_clock	clock_type;
+
+	long long ElapsedUSec( const clock_type::time_point& start )
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>( clock_type::now() - start ).count();
+	}
+
+
+	/// \brief Parse one configuration file into a detached bag.
+	///
+	/// The runner only touches its own file object and bag; the loader
+	/// waits on done_mutex until all the runners decremented pending.
+	///
+	class BagLoader : public moThread::moRunner
+	{
+	public:
+		BagLoader( const moXMLPropBagFileSPtr& file, moMutex& done_mutex, int& pending )
+			: f_file(file)
+			, f_bag("STARTUP")
+			, f_loaded(false)
+			, f_usec(0)
+			, f_doneMutex(done_mutex)
+			, f_pending(pending)
+		{
+		}
+
+		virtual bool Run()
+		{
+			const clock_type::time_point start( clock_type::now() );
+			f_loaded = f_file->Load( f_bag ) > -1;
+			f_usec = ElapsedUSec( start );
+
+			moLockMutex lock( f_doneMutex );
+			--f_pending;
+			f_doneMutex.Signal();
+			return true;
+		}
+
+		moPropBagRef		Bag()		const { return f_bag;		}
+		bool				Loaded()	const { return f_loaded;	}
+		long long			USec()		const { return f_usec;		}
+
+	private:
+		moXMLPropBagFileSPtr	f_file;
+		moPropBagRef			f_bag;
+		bool					f_loaded;
+		long long				f_usec;
+		moMutex&				f_doneMutex;
+		int&					f_pending;
+	};
+
+	typedef moSmartPtr<BagLoader>	BagLoaderSPtr;
+
+
+	/// \brief The files read at startup, in the order the managers need them.
+	///
+	const char * const g_confFiles[] =
+	{
+		"turnwatcher.conf",
+		"stats.conf",
+		"characters.conf",
+		"initiative.conf"
+	};
+
+	typedef std::map<std::string, moPropBagRef>	prefetched_t;
+	prefetched_t					g_prefetched;
+	StartupLoader::timings_t		g_timings;
+
+
+	void AddTiming( const QString& phase, const long long usec )
+	{
+		StartupLoader::Timing timing;
+		timing.f_phase	= phase;
+		timing.f_usec	= usec;
+		g_timings.push_back( timing );
+	}
+
+
+	/// \brief Parse all the configuration files into g_prefetched.
+	///
+	/// The file names are resolved here on the main thread since the
+	/// bag file map and moApplication are not thread safe. Without
+	/// thread support in molib (or when a thread fails to start) the
+	/// runner is called directly, which is the same as the old
+	/// sequential load.
+	///
+	void Prefetch()
+	{
+		const size_t count( sizeof(g_confFiles) / sizeof(g_confFiles[0]) );
+
+		clock_type::time_point start( clock_type::now() );
+		std::vector<moXMLPropBagFileSPtr> files;
+		for( size_t idx = 0; idx < count; ++idx )
+		{
+			files.push_back( Common::GetBagFile( g_confFiles[idx] ) );
+		}
+		AddTiming( "resolve", ElapsedUSec( start ) );
+
+		start = clock_type::now();
+		moMutex						doneMutex;
+		int							pending( static_cast<int>(count) );
+		std::vector<BagLoaderSPtr>	loaders;
+		std::vector<moThreadSPtr>	threads;
+		const bool					threaded( moThread::ThreadingAvailable() );
+		for( size_t idx = 0; idx < count; ++idx )
+		{
+			BagLoaderSPtr loader( new BagLoader( files[idx], doneMutex, pending ) );
+			loaders.push_back( loader );
+			if( threaded )
+			{
+				moThreadSPtr thread( new moThread( g_confFiles[idx], loader ) );
+				if( thread->Start() )
+				{
+					threads.push_back( thread );
+					continue;
+				}
+			}
+			loader->Run();
+		}
+
+		{
+			moLockMutex lock( doneMutex );
+			while( pending > 0 )
+			{
+				doneMutex.Wait();
+			}
+		}
+		// the runners are done, let the threads finish their cleanup
+		// so releasing them does not have to wait on their death
+		for( auto thread : threads )
+		{
+			thread->Wait();
+		}
+		AddTiming( threads.empty() ? "parse (sequential)" : "parse (parallel)", ElapsedUSec( start ) );
+
+		for( size_t idx = 0; idx < count; ++idx )
+		{
+			AddTiming( QString("parse %1").arg(g_confFiles[idx]), loaders[idx]->USec() );
+			if( loaders[idx]->Loaded() )
+			{
+				g_prefetched.insert( std::make_pair( std::string(g_confFiles[idx]), loaders[idx]->Bag() ) );
+			}
+		}
+	}
+
+
+	template <class T> void Apply( const QString& name )
+	{
+		const clock_type::time_point start( clock_type::now() );
+		T::Instance();
+		AddTiming( "apply " + name, ElapsedUSec( start ) );
+	}
+}
+// no name namespace
+
+
+/// \brief Load the configuration and create the managers.
+///
+/// The managers load their file from their constructor, so creating
+/// them in dependency order applies the prefetched bags: the stats are
+/// needed by the characters, and the initiative refers to both the
+/// settings and the characters.
+///
+void StartupLoader::Run()
+{
+	g_timings.clear();
+
+	const clock_type::time_point start( clock_type::now() );
+	Prefetch();
+
+	Apply<AppSettings>                  ( "AppSettings"       );
+	Apply<Attribute::StatManager>       ( "StatManager"       );
+	Apply<Combatant::CharacterManager>  ( "CharacterManager"  );
+	Apply<Initiative::InitiativeManager>( "InitiativeManager" );
+
+	// whatever was not used (i.e. a manager already existed) must not
+	// be picked up by a later reload
+	g_prefetched.clear();
+
+	AddTiming( "total", ElapsedUSec( start ) );
+}
+
+
+/// \brief Retrieve the bag parsed by Run() for this file.
+///
+/// The bag is given to the caller and forgotten, so the next load
+/// of the same file reads it from disk again.
+///
+/// \return false when the file was not prefetched or failed to load
+///
+bool StartupLoader::TakePrefetchedBag( const moWCString& conf_file_basename, moPropBagRef& propBag )
+{
+	auto iter( g_prefetched.find( conf_file_basename.c_str() ) );
+	if( iter == g_prefetched.end() )
+	{
+		return false;
+	}
+	propBag = iter->second;
+	g_prefetched.erase( iter );
+	return true;
+}
+
+
+const StartupLoader::timings_t& StartupLoader::Timings()
+{
+	return g_timings;
+}
+
+
+void StartupLoader::Report( std::ostream& out )
+{
+	for( const auto& timing : g_timings )
+	{
+		out << "startup: " << timing.f_phase.toUtf8().data() << ": " << timing.f_usec << "us" << std::endl;
+	}
+}
+
+}
+// namespace Application
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
@@ -0,0 +1,68 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+#pragma once
+
+// MOLIB
+//
+#include "mo/mo_props.h"
+
+// QT
+//
+#include <QString>
+
+// STL
+//
+#include <iostream>
+#include <vector>
+
+namespace Application
+{
+
+/// \brief Load the configuration files of the managers at startup.
+///
+/// Run() parses all the configuration files into detached property bags,
+/// in parallel when molib was compiled with thread support, then creates
+/// the singletons on the main thread in dependency order. Their Load()
+/// functions pick up the prefetched bags through Common::LoadBagFromFile()
+/// instead of reading the files again.
+///
+/// The time spent in each phase is recorded so startup regressions can
+/// be spotted with Report().
+///
+class StartupLoader
+{
+public:
+	struct Timing
+	{
+		QString		f_phase;
+		long long	f_usec;
+	};
+	typedef std::vector<Timing> timings_t;
+
+	static void				Run();
+	static bool				TakePrefetchedBag( const molib::moWCString& conf_file_basename, molib::moPropBagRef& propBag );
+
+	static const timings_t&	Timings();
+	static void				Report( std::ostream& out );
+};
+
+}
+// namespace Application
+
+// vim: ts=4 sw=4 syntax=cpp.doxygen
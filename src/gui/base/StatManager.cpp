@@ -22,6 +22,8 @@
 #include "base/AppSettings.h"
 
 #include <algorithm>
+#include <set>
+#include <vector>
 
 #include "mo/mo_application.h"
 #include "mo/mo_props_xml.h"
@@ -350,6 +352,101 @@ bool StatManager::LoadStats( moPropBagRef& propBag )
 }
 
 
+/// \brief Apply a stats.conf modified by another program.
+///
+/// The stats are updated in place (the characters keep pointers to
+/// them) and only when their bag in the file differs from what they
+/// would save; signal_changed() is emitted once if anything changed.
+/// All the stats are parsed before any gets applied so a file which
+/// fails to load leaves the current stats untouched.
+///
+void StatManager::ReloadStats( moPropBagRef& propBag )
+{
+	moPropArrayRef	array( f_arrayName );
+	array.Link( propBag );
+	if( !array.HasProp() ) return;
+
+	typedef std::pair<Stat::pointer_t, moPropBagRef> loaded_stat_t;
+	std::vector<loaded_stat_t> stats;
+	const unsigned long end = array.CountIndexes();
+	for( unsigned long idx = 0; idx < end; ++idx )
+	{
+		moPropSPtr		prop_ptr( array.Get( array.ItemNoAtIndex( idx ) ) );
+		const moProp	*item	( static_cast<moProp *>(prop_ptr) );
+		if( item == 0 || dynamic_cast<const moPropBag *>( item ) == 0 )
+		{
+			continue;
+		}
+		moPropBagRef	prop( moPropRef( 0, item ) );
+
+		Stat::pointer_t stat( new Stat );
+		try
+		{
+			stat->Load( prop );
+		}
+		catch( const moError& x )
+		{
+			// Keep what we have, the file may still be edited
+			//
+			std::cerr << "StatManager::ReloadStats(): Caught moError: " << x.Message() << std::endl;
+			return;
+		}
+		stats.push_back( loaded_stat_t( stat, prop ) );
+	}
+
+	bool changed = false;
+	std::set<mo_name_t> loaded;
+	for( auto& entry : stats )
+	{
+		Stat::pointer_t stat( entry.first );
+		const mo_name_t id = stat->id();
+		loaded.insert( id );
+
+		Stat::pointer_t current( GetStat( id ) );
+		if( !current )
+		{
+			f_statMap[id] = stat;
+			changed = true;
+			continue;
+		}
+
+		moPropBagRef currentBag( "STAT" );
+		currentBag.NewProp();
+		current->Save( currentBag );
+		if( Common::BagChanged( currentBag, entry.second ) )
+		{
+			current->Copy( stat );
+			changed = true;
+		}
+	}
+
+	for( auto iter = f_statMap.begin(); iter != f_statMap.end(); )
+	{
+		if( loaded.find( iter->first ) == loaded.end() )
+		{
+			iter = f_statMap.erase( iter );
+			changed = true;
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	if( changed ) f_statsChanged.emit();
+}
+
+
+void StatManager::DirectoryChanged( const moWCString& /*directory*/, const moWCString& filename, unsigned long /*changes*/ )
+{
+	if( !Common::ConfigFileChanged( "stats.conf", filename ) ) return;
+
+	moPropBagRef propBag( f_propBagName );
+	if( !Common::ReloadBagFromFile( "stats.conf", propBag ) ) return;
+	ReloadStats( propBag );
+}
+
+
 /// \brief Load stats from a property bag
 //
 bool StatManager::Load()
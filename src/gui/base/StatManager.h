@@ -32,12 +32,13 @@
 
 // molib
 //
+#include "mo/mo_directory_watcher.h"
 #include "mo/mo_props.h"
 
 namespace Attribute
 {
 
-class StatManager
+class StatManager : public molib::moDirectoryWatcherEvent
 {
 public:
 	typedef std::weak_ptr<StatManager>	pointer_t;
@@ -82,9 +83,14 @@ public:
 	void		AddDefaultColumns();
 
 	bool		LoadStats( molib::moPropBagRef& propBag );
+	void		ReloadStats( molib::moPropBagRef& propBag );
 	bool		Load();
 	bool		Save();
 
+	// moDirectoryWatcherEvent
+	//
+	virtual void DirectoryChanged( const molib::moWCString& directory, const molib::moWCString& filename, unsigned long changes );
+
 private:
     typedef std::shared_ptr<StatManager>	private_pointer_t;
 	static private_pointer_t f_instance;
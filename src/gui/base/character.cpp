@@ -21,6 +21,7 @@
 #include "base/character.h"
 #include "base/AppSettings.h"
 #include "base/StatManager.h"
+#include "CharacterSchema.h"
 
 // MOLIB
 //
@@ -79,23 +80,9 @@ namespace
 	const moWCString NAME_STATS  ("STATS");
 	const moWCString NAME_VALUE  ("VALUE");
 
-	// moNames for each attribute to save
+	// moNames of the sub-bags (the other attributes are in CharacterSchema.schema)
 	//
-	const moWCString g_name        ("NAME");
-	const moWCString g_publicName  ("PUBLIC_NAME");
-	const moWCString g_notes       ("NOTES");
-	const moWCString g_monster     ("MONSTER");
-	const moWCString g_hitDice     ("HITDICE");
-	const moWCString g_baseHP      ("BASEHP");
-	const moWCString g_tempHP      ("TEMPHP");
-	const moWCString g_damage      ("DAMAGE");
-	const moWCString g_stabilized  ("STABILIZED");
-	const moWCString g_justdropped ("JUSTDROPPED");
-	const moWCString g_status      ("STATUS");
 	const moWCString g_effectsBag  ("EFFECTS");
-	const moWCString g_position    ("POSITION");
-	const moWCString g_subPosition ("SUBPOSITION");
-	const moWCString g_manualPos   ("MANUALPOS");
 }
 
 
@@ -112,19 +99,12 @@ Character::Character() :
 	f_subPosition   (0),
 	f_manualPos     (0),
 	f_forcePosition (-1),
-	f_deleted       (false)
+	f_deleted       (false),
+	f_pendingStats  (NAME_STATS),
+	f_statsMaterialized(false),
+	f_pendingIndex  (PendingNotIndexed)
 {
-	auto statMgr( StatManager::Instance().lock() );
-	assert( statMgr );
-
-	OnStatsChanged();
-
-	// Listen for changes in supported stats
-	//
-	f_statConnection = statMgr
-					 ->signal_changed().connect(
-					 sigc::mem_fun( *this, &Character::OnStatsChanged )
-					 );
+	// the stat values are created by MaterializeStats() on first use
 }
 
 
@@ -240,10 +220,61 @@ void Character::SaveEffects( moPropBagRef effectsBag )
 #endif
 
 
+/// \brief Create the stat values on first use.
+///
+/// The defaults of all the stats known by the StatManager are created
+/// first, then the values saved with the character (if any) replace
+/// them. From then on the character follows the StatManager changes.
+///
+void Character::MaterializeStats()
+{
+	if( f_statsMaterialized )
+	{
+		return;
+	}
+	// set first, AddStat() goes through GetStat()
+	f_statsMaterialized = true;
+
+	auto statMgr( StatManager::Instance().lock() );
+	assert( statMgr );
+
+	AddStat();
+
+#if !defined(DEMO_VERSION)
+	if( f_pendingStats.HasProp() )
+	{
+		LoadStatValues( f_pendingStats );
+		f_pendingStats.ClearRef();
+		f_pendingValues.clear();
+	}
+#endif
+
+	// Listen for changes in supported stats
+	//
+	f_statConnection = statMgr
+					 ->signal_changed().connect(
+					 sigc::mem_fun( *this, &Character::OnStatsChanged )
+					 );
+}
+
+
 void Character::CopyStats( Character::pointer_t ch )
 {
 	assert(ch);
 	//
+	if( !ch->f_statsMaterialized )
+	{
+		// Share the serialized stats; they are never modified so
+		// each copy materializes its own values when needed
+		//
+		f_statConnection.disconnect();
+		f_values.clear();
+		f_statsMaterialized = false;
+		SetPendingStats( ch->f_pendingStats );
+		return;
+	}
+
+	MaterializeStats();
 	f_values.clear();
 
 	for( auto& pair : ch->f_values )
@@ -272,7 +303,22 @@ void Character::LoadStats( moPropBagRef& propBag )
 	array = propBag.Get( NAME_STATS );
 
 	if( !array.HasProp() ) return;
-	//
+
+	if( f_statsMaterialized )
+	{
+		LoadStatValues( array );
+	}
+	else
+	{
+		// keep a reference to the array; the values are created
+		// on the first access to a stat
+		SetPendingStats( array );
+	}
+}
+
+
+void Character::LoadStatValues( moPropArrayRef& array )
+{
 	const unsigned long count = array.CountIndexes();
 	for( unsigned long idx = 0; idx < count; ++idx )
 	{
@@ -308,6 +354,19 @@ void Character::LoadStats( moPropBagRef& propBag )
 
 void Character::SaveStats( moPropBagRef& propBag )
 {
+	if( !f_statsMaterialized )
+	{
+		// Nothing could have changed; save the stats as they were
+		// loaded (or not at all for a new character.) Stats removed
+		// from the StatManager meanwhile are dropped on the next load.
+		//
+		if( f_pendingStats.HasProp() )
+		{
+			propBag += f_pendingStats;
+		}
+		return;
+	}
+
 	moPropArrayRef	array( NAME_STATS );
 	array.NewProp();
 	//
@@ -336,48 +395,96 @@ void Character::SaveStats( moPropBagRef& propBag )
 #endif // !defined(DEMO_VERSION)
 
 
+/// \brief Replace the serialized stats of a character not yet materialized.
+///
+/// The values indexed by IndexPendingStats() are dropped with the
+/// previous array.
+///
+void Character::SetPendingStats( const moPropArrayRef& array )
+{
+	f_pendingStats = array;
+	f_pendingValues.clear();
+	f_pendingIndex = PendingNotIndexed;
+}
+
+
+/// \brief Index the modifier and roll of the serialized stats by id.
+///
+/// This is done once per array; it costs one small map entry per stat
+/// instead of a Value object each, plus the StatManager connection.
+///
+/// \return false if the array uses the legacy format; the stat ids then
+/// come from the StatManager so the stats have to be materialized
+///
+bool Character::IndexPendingStats()
+{
+	if( f_pendingIndex == PendingNotIndexed )
+	{
+		f_pendingIndex = PendingIndexed;
+		if( f_pendingStats.HasProp() )
+		{
+			const Attribute::Value	reader;
+			const unsigned long count = f_pendingStats.CountIndexes();
+			for( unsigned long idx = 0; idx < count; ++idx )
+			{
+				moPropSPtr		prop_ptr( f_pendingStats.Get( f_pendingStats.ItemNoAtIndex( idx ) ) );
+				const moProp	*item	( static_cast<moProp *>(prop_ptr) );
+				if( item == 0 || dynamic_cast<const moPropBag *>( item ) == 0 )
+				{
+					continue;
+				}
+				// refer to the item itself, reading does not need a copy
+				moPropBagRef	prop( moPropRef( 0, item ) );
+				mo_name_t		id;
+				PendingValue	value;
+				if( !reader.Peek( prop, id, value.f_mod, value.f_roll ) )
+				{
+					f_pendingValues.clear();
+					f_pendingIndex = PendingLegacy;
+					break;
+				}
+				f_pendingValues[id] = value;
+			}
+		}
+	}
+
+	return f_pendingIndex == PendingIndexed;
+}
+
+
+int Character::peekMod( const mo_name_t id )
+{
+	if( !f_statsMaterialized && IndexPendingStats() )
+	{
+		auto iter( f_pendingValues.find( id ) );
+		return iter == f_pendingValues.end() ? 0 : iter->second.f_mod;
+	}
+	return getMod( id );
+}
+
+
+int Character::peekRoll( const mo_name_t id )
+{
+	if( !f_statsMaterialized && IndexPendingStats() )
+	{
+		auto iter( f_pendingValues.find( id ) );
+		return iter == f_pendingValues.end() ? 0 : iter->second.f_roll;
+	}
+	return getRoll( id );
+}
+
+
 void Character::Load( moPropBagRef& propBag )
 {
 #if defined(DEMO_VERSION)
       // No saving allowed for demo version!
       return;
 #else
-	moPropStringRef	name		(g_name			); // name of character
-	moPropStringRef	publicName	(g_publicName	); // public name of character (on HUD)
-	moPropStringRef	notes		(g_notes  		); // Misc notes
-	moPropIntRef	monster		(g_monster		); // is this character a monster or pc?
-	moPropIntRef	hitDice		(g_hitDice		); // Hitdice for the character
-	moPropIntRef	baseHP		(g_baseHP		); // Base hitpoints the character has
-	moPropIntRef	tempHP		(g_tempHP		); 
-	moPropIntRef	damage		(g_damage		); // Current damage
-	moPropIntRef	stabilized	(g_stabilized	); // If dying, character may be stabilized
-	moPropIntRef	justdropped	(g_justdropped	); // If true, character just dropped below 0 hitpoints
-	moPropIntRef	status		(g_status		); // normal, delayed or readied action
-	moPropIntRef	position	(g_position		); // the real initiative position (1 based, if 0, not sorted)
-	moPropIntRef	subPosition	(g_subPosition	); // tie-breaker for similar initiatives.
-	moPropIntRef	manualPos	(g_manualPos	); // if the character is moved manually in initiative order (delayed, readied or move)
 	moPropBagRef	effectsBag	(g_effectsBag	); // Bag containing running effects
 
-	name        .Link( propBag ); if( name        .HasProp() ) f_name        = static_cast<moWCString>(name).c_str();
-	notes       .Link( propBag ); if( notes       .HasProp() ) f_notes       = static_cast<moWCString>(notes).c_str();
-	monster     .Link( propBag ); if( monster     .HasProp() ) f_monster     = monster?     true: false;
-	hitDice     .Link( propBag ); if( hitDice     .HasProp() ) f_hitDice     = hitDice;
-	baseHP      .Link( propBag ); if( baseHP      .HasProp() ) f_baseHP      = baseHP;
-	tempHP      .Link( propBag ); if( tempHP      .HasProp() ) f_tempHP      = tempHP;
-	damage      .Link( propBag ); if( damage      .HasProp() ) f_damage      = damage;
-	stabilized  .Link( propBag ); if( stabilized  .HasProp() ) f_stabilized  = stabilized?  true: false;
-	justdropped .Link( propBag ); if( justdropped .HasProp() ) f_justdropped = justdropped? true: false;
-	status      .Link( propBag ); if( status      .HasProp() ) f_status      = static_cast<Status>(static_cast<int>(status));
-	position    .Link( propBag ); if( position    .HasProp() ) f_position    = position;
-	subPosition .Link( propBag ); if( subPosition .HasProp() ) f_subPosition = subPosition;
-	manualPos   .Link( propBag ); if( manualPos   .HasProp() ) f_manualPos   = manualPos;
+	const CharacterSchema::mask_t found = CharacterSchema::Load( *this, propBag );
 	//
-	publicName.Link( propBag );
-	if( publicName.HasProp() )
-	{
-        f_publicName = static_cast<moWCString>(publicName).c_str();
-	}
-	else if( name.HasProp() )
+	if( (found & CharacterSchema::MASK_PUBLIC_NAME) == 0 && (found & CharacterSchema::MASK_NAME) != 0 )
 	{
 		if( f_monster )
 		{
@@ -385,7 +492,7 @@ void Character::Load( moPropBagRef& propBag )
 		}
 		else
 		{
-            f_publicName = static_cast<moWCString>(name).c_str();
+			f_publicName = f_name;
 		}
 	}
 	//
@@ -417,53 +524,11 @@ void Character::Save( moPropBagRef& propBag )
 		return;
 	}
 
-	moPropStringRef	name		(g_name			); // name of character
-	moPropStringRef	publicName	(g_publicName	); // name of character on HUD
-	moPropStringRef	notes		(g_notes  		); // Misc notes
-	moPropIntRef	monster		(g_monster		); // is this character a monster or pc?
-	moPropIntRef	hitDice		(g_hitDice		); // Hitdice for the character
-	moPropIntRef	baseHP		(g_baseHP		); // Base hitpoints the character has
-	moPropIntRef	tempHP		(g_tempHP		); 
-	moPropIntRef	damage		(g_damage		); // Current damage
-	moPropIntRef	stabilized	(g_stabilized	); // If dying, character may be stabilized
-	moPropIntRef	justdropped	(g_justdropped	); // If true, character just dropped below 0 hitpoints
-	moPropIntRef	status		(g_status		); // normal, delayed or readied action
-	moPropIntRef	position	(g_position		); // the real initiative position (1 based, if 0, not sorted)
-	moPropIntRef	subPosition	(g_subPosition	); // tie-breaker for similar initiatives.
-	moPropIntRef	manualPos	(g_manualPos	); // if the character is moved manually in initiative order (delayed, readied or move)
 	moPropBagRef	effectsBag	(g_effectsBag	); // Bag containing running effects
 
 	// Save properties in bag for later retrieval
 	//
-    name        .NewProp(); name        = f_name         		;
-    publicName  .NewProp(); publicName  = f_publicName		    ;
-	notes       .NewProp(); notes       = f_notes        		;
-	monster     .NewProp(); monster     = f_monster? 1: 0		;
-	hitDice     .NewProp(); hitDice     = f_hitDice      		;
-	baseHP      .NewProp(); baseHP      = f_baseHP       		;
-	tempHP      .NewProp(); tempHP      = f_tempHP       		;
-	damage      .NewProp(); damage      = f_damage       		;
-	stabilized  .NewProp(); stabilized  = f_stabilized?  1: 0	;
-	justdropped .NewProp(); justdropped = f_justdropped? 1: 0	;
-	status      .NewProp(); status      = (int) f_status 		;
-	position    .NewProp(); position    = f_position     		;
-	subPosition .NewProp(); subPosition = f_subPosition  		;
-	manualPos   .NewProp(); manualPos   = f_manualPos    		;
-	//
-	propBag += name;
-	propBag += publicName;
-	propBag += notes;
-	propBag += monster;
-	propBag += hitDice;
-	propBag += baseHP;
-	propBag += tempHP;
-	propBag += damage;
-	propBag += stabilized;
-	propBag += justdropped;
-	propBag += status;
-	propBag += position;
-	propBag += subPosition;
-	propBag += manualPos;
+	CharacterSchema::Save( *this, propBag );
 
 	SaveStats( propBag );
 
@@ -604,6 +669,8 @@ int Character::makeRoll( const mo_name_t id )
 
 void Character::makeAllRolls()
 {
+	MaterializeStats();
+
 	ValueMap::const_iterator iter = f_values.begin();
 	ValueMap::const_iterator end  = f_values.end();
 
@@ -875,6 +942,8 @@ int Character::maxHP()
 
 Attribute::Value::pointer_t Character::GetStat( const mo_name_t id )
 {
+	MaterializeStats();
+
 	Attribute::Value::pointer_t value( f_values[id] );
 	//
 	if( !value )
@@ -45,6 +45,8 @@ typedef enum { HNormal, Stabilized, Disabled, Dying, Dead }	Health;
 typedef enum { Normal, Delayed, Readied }					Status;
 
 
+class CharacterSchema;
+
 class Character
 {
 public:
@@ -90,6 +92,11 @@ public:
 	int					getRoll( const molib::mo_name_t id )						{ return getRoll( GetStat( id ) ); }
 	int					getRoll( Attribute::Value::pointer_t stat );
 	//
+	// Same as getMod()/getRoll() without materializing the stats, to show
+	// the whole roster without creating the values of every character
+	int					peekMod ( const molib::mo_name_t id );
+	int					peekRoll( const molib::mo_name_t id );
+	//
 	void				setRoll( const molib::mo_name_t id, const int roll )		{ setRoll( GetStat( id ), roll ); }
 	void				setRoll( Attribute::Value::pointer_t stat, const int roll );
 	
@@ -138,6 +145,8 @@ public:
 	VoidSignal			signal_changed() { return f_signalChanged; }
 
 private:
+	friend class CharacterSchema;
+
 	// These are maps of character stats. These can be ability scores, saves or skill checks.
 	// It also holds the initiative roll. You can use the StatName enum here, or use a negative
 	// number to represent a custom stat.
@@ -146,8 +155,28 @@ private:
 
 	// Character stats
 	//
+	// The values are only created on the first access to a stat (see
+	// MaterializeStats()); until then the STATS array read by Load()
+	// is kept as is in f_pendingStats so that characters which never
+	// enter a combat cost a header and a pointer.
+	//
 	sigc::connection				f_statConnection;
 	ValueMap						f_values;
+	molib::moPropArrayRef			f_pendingStats;
+	bool							f_statsMaterialized;
+
+	// Modifier and roll of f_pendingStats by stat id, filled by
+	// IndexPendingStats() on the first peekMod()/peekRoll()
+	//
+	struct PendingValue
+	{
+		int		f_mod;
+		int		f_roll;
+	};
+	typedef std::map<molib::mo_name_t,PendingValue>	PendingMap;
+	enum PendingIndex { PendingNotIndexed, PendingIndexed, PendingLegacy };
+	PendingMap						f_pendingValues;
+	PendingIndex					f_pendingIndex;
 
 	// Signals
 	// 
@@ -192,8 +221,12 @@ private:
 	void	LoadEffects( molib::moPropBagRef _effectsBag );
 	void	SaveEffects( molib::moPropBagRef _effectsBag );
 
+	void	MaterializeStats();
 	void	CopyStats( pointer_t ch );
 	void	LoadStats( molib::moPropBagRef& propBag );
+	void	LoadStatValues( molib::moPropArrayRef& array );
+	void	SetPendingStats( const molib::moPropArrayRef& array );
+	bool	IndexPendingStats();
 	void	SaveStats( molib::moPropBagRef& propBag );
 	void	AddStat();
 
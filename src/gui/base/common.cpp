@@ -17,6 +17,7 @@
 //===============================================================================
 
 #include "common.h"
+#include "StartupLoader.h"
 #include "mo/mo_application.h"
 #include "mo/mo_file.h"
 #include "mo/mo_props_xml.h"
@@ -24,6 +25,10 @@
 
 #include <math.h>
 
+#include <map>
+#include <string>
+
+#include <QDateTime>
 #include <QFileInfo>
 
 using namespace molib;
@@ -50,12 +55,14 @@ QString GetFullPathnameForImage( const QString& basename )
         return filename.c_str();
 	}
 
-	// test from the application folder...
+	// test from the application folder (through FindFile() so the
+	// result gets cached like the other folders)
 	moApplicationSPtr application = moApplication::Instance();
-    moWCString path = application->GetApplicationPath();
-    path = path.FilenameChild("images").FilenameChild(basename);
+    moWCString path = moFile::FindFile(
+        application->GetApplicationPath().FilenameChild("images"),
+        basename, moFile::MO_ACCESS_READ);
 
-	if( moFile::Access( path, moFile::MO_ACCESS_READ ) )
+	if( !path.IsEmpty() )
 	{
         return path.c_str();
 	}
@@ -445,17 +452,140 @@ void ShowDocumentation( QString const & index )
 }
 
 
-bool LoadBagFromFile( const moWCString& conf_file_basename, moPropBagRef& propBag )
+/// \brief Get the incremental file handling a configuration file.
+///
+/// The managers rebuild their bag on each save; the moXMLPropBagFile
+/// merges it with the previously saved bag and only writes the
+/// sub-bags that changed to a sidecar file (compacted periodically),
+/// so saving after each turn does not rewrite the whole file.
+///
+/// \note Not thread safe; the startup loader resolves the files on the
+/// main thread before handing them to its workers.
+///
+moXMLPropBagFileSPtr GetBagFile( const moWCString& conf_file_basename )
 {
+	typedef std::map<std::string, moXMLPropBagFileSPtr> file_map_t;
+	static file_map_t files;
+
 	const moWCString fullpath( moApplication::Instance()->GetPrivateUserPath( false /*append_version*/ ).FilenameChild( conf_file_basename ) );
-	return moXMLLoadPropBag( fullpath, propBag ) > -1;
+	moXMLPropBagFileSPtr& file( files[fullpath.c_str()] );
+	if( !file )
+	{
+		file = new moXMLPropBagFile( fullpath );
+	}
+	return file;
+}
+
+
+namespace
+{
+	/// \brief Size and modification time of a file ("-" when it does not exist).
+	///
+	QString GetFileStamp( const moWCString& filename )
+	{
+		QFileInfo info( filename.c_str() );
+		return info.exists()
+			? QString("%1:%2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch())
+			: QString("-");
+	}
+
+	/// \brief Stamps of a configuration file and of its sidecar.
+	///
+	struct file_stamps_t
+	{
+		QString	f_main;
+		QString	f_delta;
+	};
+
+	typedef std::map<std::string, file_stamps_t> stamp_map_t;
+	stamp_map_t	g_stamps;	// stamps of the files as we last loaded or saved them
+
+	void RecordFileStamp( const moWCString& conf_file_basename )
+	{
+		const moXMLPropBagFileSPtr file( GetBagFile( conf_file_basename ) );
+		file_stamps_t& stamps( g_stamps[conf_file_basename.c_str()] );
+		stamps.f_main  = GetFileStamp( file->GetFilename() );
+		stamps.f_delta = GetFileStamp( file->GetDeltaFilename() );
+	}
+}
+// no name namespace
+
+
+bool LoadBagFromFile( const moWCString& conf_file_basename, moPropBagRef& propBag )
+{
+	if( Application::StartupLoader::TakePrefetchedBag( conf_file_basename, propBag ) )
+	{
+		RecordFileStamp( conf_file_basename );
+		return true;
+	}
+	const bool loaded = GetBagFile( conf_file_basename )->Load( propBag ) > -1;
+	RecordFileStamp( conf_file_basename );
+	return loaded;
 }
 
 
 bool SaveBagToFile( const moWCString& conf_file_basename, moPropBagRef& propBag )
 {
-	const moWCString fullpath( moApplication::Instance()->GetPrivateUserPath( false /*append_version*/ ).FilenameChild( conf_file_basename ) );
-	return moXMLSavePropBag( fullpath, propBag ) > -1;
+	const bool saved = GetBagFile( conf_file_basename )->Save( propBag ) > -1;
+	RecordFileStamp( conf_file_basename );
+	return saved;
+}
+
+
+/// \brief Check whether another program modified a configuration file.
+///
+/// \p filename is the name received by a molib::moDirectoryWatcherEvent;
+/// the main file and its ".delta" sidecar both belong to
+/// \p conf_file_basename. Our own saves also trigger the watcher, so the
+/// sizes and modification times are compared with the ones recorded by
+/// the last LoadBagFromFile() or SaveBagToFile().
+///
+bool ConfigFileChanged( const moWCString& conf_file_basename, const moWCString& filename )
+{
+	if( filename != conf_file_basename && filename != conf_file_basename + ".delta" )
+	{
+		return false;
+	}
+	const moXMLPropBagFileSPtr file( GetBagFile( conf_file_basename ) );
+	const file_stamps_t& stamps( g_stamps[conf_file_basename.c_str()] );
+	return GetFileStamp( file->GetFilename() ) != stamps.f_main
+		|| GetFileStamp( file->GetDeltaFilename() ) != stamps.f_delta;
+}
+
+
+/// \brief Load a configuration file modified by another program.
+///
+/// When the main file itself was rewritten, our ".delta" sidecar was
+/// saved against its previous version and merging it would override
+/// the new values with stale ones. The sidecar is then discarded, so
+/// the main file wins, and the next SaveBagToFile() compacts.
+///
+bool ReloadBagFromFile( const moWCString& conf_file_basename, moPropBagRef& propBag )
+{
+	const moXMLPropBagFileSPtr file( GetBagFile( conf_file_basename ) );
+	if( GetFileStamp( file->GetFilename() ) != g_stamps[conf_file_basename.c_str()].f_main )
+	{
+		file->DiscardDelta();
+	}
+	const bool loaded = file->Load( propBag ) > -1;
+	RecordFileStamp( conf_file_basename );
+	return loaded;
+}
+
+
+/// \brief Check whether a bag loaded from a file differs from the current one.
+///
+/// \p loaded is merged in \p current; only the properties receiving a
+/// new value are touched so the generation of \p current tells whether
+/// anything changed. Used to reload only the entries edited outside of
+/// Turn Watcher.
+///
+bool BagChanged( moPropBagRef& current, moPropBagRef& loaded )
+{
+	const moProp::generation_t generation = moProp::CurrentGeneration();
+	dynamic_cast<moPropBag&>(*current.GetProperty()).Merge(
+			dynamic_cast<const moPropBag&>(*loaded.GetProperty()), true );
+	return current.GetProperty()->GetGeneration() > generation;
 }
 
 
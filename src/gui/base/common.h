@@ -21,6 +21,7 @@
 #include <libintl.h>
 
 #include "mo/mo_props.h"
+#include "mo/mo_props_xml.h"
 
 #include <QString>
 
@@ -55,8 +56,12 @@ namespace Common
 
     void				ShowDocumentation( QString const & index );
 
+    molib::moXMLPropBagFileSPtr	GetBagFile( const molib::moWCString& conf_file_basename );
     bool				LoadBagFromFile ( const QString& conf_file_basename, molib::moPropBagRef& propBag );
     bool				SaveBagToFile   ( const QString& conf_file_basename, molib::moPropBagRef& propBag );
+    bool				ConfigFileChanged( const molib::moWCString& conf_file_basename, const molib::moWCString& filename );
+    bool				ReloadBagFromFile( const molib::moWCString& conf_file_basename, molib::moPropBagRef& propBag );
+    bool				BagChanged      ( molib::moPropBagRef& current, molib::moPropBagRef& loaded );
 
     bool				FileExists( QString const & path );
 }
@@ -18,26 +18,13 @@
 
 #include "effect.h"
 #include "character.h"
+#include "EffectSchema.h"
 
 using namespace molib;
 
 namespace Effects
 {
 
-namespace
-{
-	const moWCString g_name        ("NAME");
-	const moWCString g_description ("DESCRIPTION");
-	const moWCString g_totalRounds ("TOTALROUNDS");
-	const moWCString g_startIn     ("STARTIN");
-	const moWCString g_tempHP      ("TEMPHP");
-	const moWCString g_hpBoost     ("HPBOOST");
-	const moWCString g_roundsUsed  ("ROUNDSUSED");
-	const moWCString g_type        ("TYPE");
-	const moWCString g_isActive    ("ACTIVE");
-}
-
-
 Effect::Effect() :
 	f_totalRounds(10),
 	f_roundsUsed(0),
@@ -52,48 +39,13 @@ Effect::Effect() :
 
 void	Effect::Load( moPropBagRef propBag )
 {
-	moPropStringRef name        ( g_name        ); // name of effect
-	moPropStringRef description ( g_description ); // description of the effect
-	moPropIntRef    totalRounds ( g_totalRounds ); // number of rounds the effect lasts
-	moPropIntRef    startIn     ( g_startIn     ); // number of rounds until start of effect
-	moPropIntRef    tempHP      ( g_tempHP      ); // temp hp to apply
-	moPropIntRef    hpBoost     ( g_hpBoost     ); // boost to hp
-	moPropIntRef    roundsUsed  ( g_roundsUsed  ); // number of rounds left on the effect
-	moPropIntRef    type        ( g_type        ); // true if spell effect
-	moPropIntRef    isActive    ( g_isActive    ); // true if effect is running
-
-	name.Link(        propBag ); if( name.HasProp()        ) { f_name        = static_cast<moWCString>(name).c_str(); }
-	description.Link( propBag ); if( description.HasProp() ) { f_description = static_cast<moWCString>(description).c_str(); }
-	totalRounds.Link( propBag ); if( totalRounds.HasProp() ) { f_totalRounds = totalRounds; }
-	startIn.Link(     propBag ); if( startIn.HasProp()     ) { f_startIn     = startIn;     }
-	tempHP.Link(      propBag ); if( tempHP.HasProp()      ) { f_tempHP      = tempHP;      }
-	hpBoost.Link(     propBag ); if( hpBoost.HasProp()     ) { f_hpBoost     = hpBoost;     }
-	roundsUsed.Link(  propBag ); if( roundsUsed.HasProp()  ) { f_roundsUsed  = roundsUsed;  }
-	type.Link(        propBag ); if( type.HasProp()        ) { f_type        = static_cast<Type>(static_cast<int>(type)); }
-	isActive.Link(    propBag ); if( isActive.HasProp()    ) { f_isActive    = static_cast<bool>(isActive); }
+	EffectSchema::Load( *this, propBag );
 }
 
 
 void	Effect::Save( moPropBagRef propBag )
 {
-	moPropStringRef	name   		( g_name		);	// name of effect
-	moPropStringRef	description	( g_description	);	// description of the effect
-	moPropIntRef	totalRounds	( g_totalRounds	);	// number of rounds the effect lasts
-	moPropIntRef	startIn		( g_startIn		);	// number of rounds until the effect starts
-	moPropIntRef	tempHP		( g_tempHP		);	// temporary hp to apply
-	moPropIntRef	hpBoost		( g_hpBoost		);	// boost to HP
-	moPropIntRef	roundsUsed	( g_roundsUsed	);	// number of rounds left on the effect
-	moPropIntRef	type		( g_type		);	// true if spell effect
-	moPropIntRef	isActive	( g_isActive	);	// true if effect is active
-
-    name.NewProp();        name        = f_name;        		 propBag += name;
-    description.NewProp(); description = f_description; 		 propBag += description;
-	totalRounds.NewProp(); totalRounds = f_totalRounds;          propBag += totalRounds;
-	startIn.NewProp();     startIn     = f_startIn;              propBag += startIn;
-	hpBoost.NewProp();     hpBoost     = f_hpBoost;              propBag += hpBoost;
-	roundsUsed.NewProp();  roundsUsed  = f_roundsUsed;           propBag += roundsUsed;
-	type.NewProp();        type        = (int) f_type;           propBag += type;
-	isActive.NewProp();    isActive    = (int) f_isActive? 1: 0; propBag += isActive;
+	EffectSchema::Save( *this, propBag );
 }
 
 
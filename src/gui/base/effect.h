@@ -40,6 +40,8 @@ namespace Combatant
 namespace Effects
 {
 
+class EffectSchema;
+
 class Effect
 {
 public:
@@ -84,6 +86,8 @@ public:
 	void			unapply ( std::shared_ptr<Combatant::Character> ch );
 	
 private:
+	friend class EffectSchema;
+
     QString			f_name;
     QString			f_description;
 	int				f_totalRounds;
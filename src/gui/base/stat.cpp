@@ -23,6 +23,7 @@
 //
 #include "base/stat.h"
 #include "base/StatManager.h"
+#include "StatSchema.h"
 
 using namespace molib;
 
@@ -30,23 +31,7 @@ namespace Attribute
 {
 
 Stat::Stat()
-	: f_idName               ( "STAT_ID"             )
-	, f_abilityIdName        ( "ABILITY_ID"          )
-	, f_legacyIdName         ( "ID"                  )
-	, f_legacyTypeName       ( "TYPE"                )
-	, f_nameName             ( "NAME"                )
-	, f_diceName             ( "DICE"                )
-	, f_facesName            ( "FACES"               )
-	, f_modifierName         ( "MODIFIER"            )
-	, f_deletedName          ( "DELETED"             )
-	, f_accelName            ( "ACCEL"               )
-	, f_showOnToolbarName    ( "SHOW_ON_TOOLBAR"     )
-	, f_showOnHUDName        ( "SHOW_ON_HUD"         )
-	, f_showMonsterOnHUDName ( "SHOW_MONSTER_ON_HUD" )
-	, f_internalName         ( "IS_INTERNAL"         )
-	, f_abilityName          ( "IS_ABILITY"          )
-	, f_orderName            ( "ORDER"               )
-	, f_id                   ( "UNNAMED"             )
+	: f_id                   ( "UNNAMED"             )
 	, f_abilityId            ( "UNNAMED"             )
 	, f_name                 ( "Unnamed"             )
 	, f_legacyId             ( -1                    )
@@ -79,6 +64,7 @@ void Stat::showMonsterOnHUD ( const bool           val ) { f_showMonsterOnHUD =
 void Stat::internal         ( const bool           val ) { f_internal         = val; f_statChanged.emit(); }
 void Stat::ability          ( const bool           val ) { f_ability          = val; f_statChanged.emit(); }
 void Stat::order            ( const int            val ) { f_order            = val; f_statChanged.emit(); }
+void Stat::expression       ( const QString& val ) { f_expression       = val; f_statChanged.emit(); }
 
 
 void Stat::Copy( const pointer_t copy )
@@ -99,92 +85,41 @@ void Stat::Copy( const pointer_t copy )
 	f_internal         = copy->f_internal;
 	f_ability          = copy->f_ability;
 	f_order            = copy->f_order;
+	f_expression       = copy->f_expression;
 }
 
 
 void Stat::Load( moPropBagRef& propBag )
 {
-	moPropStringRef id               ( f_idName               );
-	moPropStringRef abilityId        ( f_abilityIdName        );
-	moPropIntRef    legacyId         ( f_legacyIdName         );
-	moPropIntRef    legacyType       ( f_legacyTypeName       );
-	moPropStringRef name             ( f_nameName             );
-	moPropIntRef    dice             ( f_diceName             );
-	moPropIntRef    faces            ( f_facesName            );
-	moPropIntRef    modifier         ( f_modifierName         );
-	moPropIntRef    deleted          ( f_deletedName          );
-	moPropStringRef accel            ( f_accelName            );
-	moPropIntRef    showOnToolbar    ( f_showOnToolbarName    );
-	moPropIntRef    showOnHUD        ( f_showOnHUDName        );
-	moPropIntRef    showMonsterOnHUD ( f_showMonsterOnHUDName );
-	moPropIntRef    internal         ( f_internalName         );
-	moPropIntRef    ability          ( f_abilityName          );
-	moPropIntRef    order            ( f_orderName            );
-
-	id       			.Link( propBag );
-	abilityId			.Link( propBag );
-	legacyId 			.Link( propBag );
-	legacyType			.Link( propBag );
-	name     			.Link( propBag );
-	dice     			.Link( propBag );
-	faces    			.Link( propBag );
-	modifier 			.Link( propBag );
-	deleted  			.Link( propBag );
-	accel    			.Link( propBag );
-	showOnToolbar		.Link( propBag );
-	showOnHUD			.Link( propBag );
-	showMonsterOnHUD	.Link( propBag );
-	internal			.Link( propBag );
-	ability				.Link( propBag );
-	order				.Link( propBag );
-
-	if( id.HasProp() )
+	// the legacy id/type are only used when the stat has no id and
+	// the three "show" flags are only used when all are defined
+	const int  legacyId         = f_legacyId;
+	const int  legacyType       = f_legacyType;
+	const bool showOnToolbar    = f_showOnToolbar;
+	const bool showOnHUD        = f_showOnHUD;
+	const bool showMonsterOnHUD = f_showMonsterOnHUD;
+
+	const StatSchema::mask_t found = StatSchema::Load( *this, propBag );
+
+	const StatSchema::mask_t legacy = StatSchema::MASK_ID | StatSchema::MASK_TYPE;
+	if( found & StatSchema::MASK_STAT_ID )
 	{
-		f_id 			= moName( static_cast<moWCString>(id) );
+		f_legacyId   = legacyId;
+		f_legacyType = legacyType;
 	}
-	else if( legacyId.HasProp() && legacyType.HasProp() )
-	{
-		f_legacyId 		= legacyId;
-		f_legacyType	= legacyType;
-	}
-	else
+	else if( (found & legacy) != legacy )
 	{
 		throw moError( "Bad Stat data for object!" );
 	}
 
-	if( abilityId.HasProp() )
+	const StatSchema::mask_t show = StatSchema::MASK_SHOW_ON_TOOLBAR | StatSchema::MASK_SHOW_ON_HUD | StatSchema::MASK_SHOW_MONSTER_ON_HUD;
+	if( (found & show) != show )
 	{
-		f_abilityId = moName( static_cast<moWCString>(abilityId) );
-	}
-	else
-	{
-		f_abilityId = moName( "UNNAMED" );
-	}
-	
-	f_name     = static_cast<moWCString>(name).c_str();
-	f_dice     = dice;
-	f_faces    = faces;
-	f_modifier = modifier;
-	f_deleted  = deleted? true: false;
-	//
-	if( showMonsterOnHUD.HasProp() && showOnToolbar.HasProp() && showOnHUD.HasProp() )
-	{
-		f_showOnToolbar		= showOnToolbar? true: false;
-		f_showOnHUD			= showOnHUD? true: false;
-		f_showMonsterOnHUD	= showMonsterOnHUD? true: false;
-	}
-	//
-	if( accel.HasProp() )	
-	{
-		// This is a bug in moProps--if a blank string, then we should have a property
-		//
-		f_accel = static_cast<moWCString>(accel).c_str();
+		f_showOnToolbar    = showOnToolbar;
+		f_showOnHUD        = showOnHUD;
+		f_showMonsterOnHUD = showMonsterOnHUD;
 	}
 
-	if( internal.HasProp() ) f_internal = internal;
-	if( ability.HasProp()  ) f_ability  = ability;
-	if( order.HasProp()    ) f_order    = order;
-	
 	if( f_legacyId != -1 )
 	{
 		f_showMonsterOnHUD = f_showOnToolbar = f_showOnHUD = f_internal = f_ability = false;
@@ -222,67 +157,7 @@ void Stat::Save( moPropBagRef& propBag )
 	//
 	if( f_deleted ) return;
 
-	moPropStringRef id               ( f_idName               );
-	moPropStringRef abilityId        ( f_abilityIdName        );
-	moPropStringRef name             ( f_nameName             );
-	moPropIntRef    dice             ( f_diceName             );
-	moPropIntRef    faces            ( f_facesName            );
-	moPropIntRef    modifier         ( f_modifierName         );
-	moPropIntRef    deleted          ( f_deletedName          );
-	moPropStringRef accel            ( f_accelName            );
-	moPropIntRef    showMonsterOnHUD ( f_showMonsterOnHUDName );
-	moPropIntRef    showOnToolbar    ( f_showOnToolbarName    );
-	moPropIntRef    showOnHUD        ( f_showOnHUDName        );
-	moPropIntRef    internal         ( f_internalName         );
-	moPropIntRef    ability          ( f_abilityName          );
-	moPropIntRef    order            ( f_orderName            );
-
-	// Create the properties first
-	//
-	id        		.NewProp();
-	abilityId 		.NewProp();
-	name      		.NewProp();
-	dice      		.NewProp();
-	faces     		.NewProp();
-	modifier  		.NewProp();
-	deleted   		.NewProp();
-	accel     		.NewProp();
-	showMonsterOnHUD.NewProp();
-	showOnToolbar	.NewProp();
-	showOnHUD		.NewProp();
-	internal		.NewProp();
-	ability			.NewProp();
-	order			.NewProp();
-	//
-	id        		= static_cast<moWCString>(moName(f_id));
-	abilityId 		= static_cast<moWCString>(moName(f_abilityId));
-    name      		= f_name.toUtf8().data();
-	dice      		= f_dice;
-	faces     		= f_faces;
-	modifier  		= f_modifier;
-	deleted   		= f_deleted? 1: 0;
-    accel     		= f_accel.toUtf8().data();
-	showMonsterOnHUD= f_showMonsterOnHUD;
-	showOnToolbar	= f_showOnToolbar;
-	showOnHUD		= f_showOnHUD;
-	internal		= f_internal;
-	ability			= f_ability;
-	order			= f_order;
-
-	propBag += id;
-	propBag += abilityId;
-	propBag += name;
-	propBag += dice;
-	propBag += faces;
-	propBag += modifier;
-	propBag += deleted;
-	propBag += accel;
-	propBag += showMonsterOnHUD;
-	propBag += showOnToolbar;
-	propBag += showOnHUD;
-	propBag += internal;
-	propBag += ability;
-	propBag	+= order;
+	StatSchema::Save( *this, propBag );
 }
 
 
@@ -418,6 +293,43 @@ bool Value::Load( moPropBagRef& propBag )
 }
 
 
+/// \brief Read the stat id, modifier and roll saved in a property bag
+//
+// Unlike Load(), this does not search the stat in the StatManager and
+// does not change this value; it is used to show the stats of characters
+// which were not materialized yet.
+//
+/// \param propBag	Bag containing properties to read
+/// \param id		The id of the stat
+/// \param mod		The modifier, 0 if not saved
+/// \param roll		The roll, 0 if not saved
+//
+/// \sa Load
+/// \return false if the bag is in the legacy format (no stat id)
+//
+bool Value::Peek( moPropBagRef& propBag, mo_name_t& id, int& mod, int& roll ) const
+{
+	moPropStringRef statRef( f_statName );
+	moPropIntRef    modRef ( f_modName  );
+	moPropIntRef    rollRef( f_rollName );
+	//
+	statRef.Link( propBag );
+	modRef .Link( propBag );
+	rollRef.Link( propBag );
+
+	if( !statRef.HasProp() )
+	{
+		return false;
+	}
+	//
+	id   = static_cast<moName>(statRef);
+	mod  = modRef .HasProp() ? static_cast<int>(modRef)  : 0;
+	roll = rollRef.HasProp() ? static_cast<int>(rollRef) : 0;
+
+	return true;
+}
+
+
 /// \brief Save values to property bag for persistence
 //
 /// \param propBag	Bag containing properties to load
@@ -41,6 +41,8 @@
 namespace Attribute
 {
 
+class StatSchema;
+
 class Stat
 {
 public:
@@ -102,6 +104,13 @@ public:
 	int					order() const					{ return f_order; }
 	void				order( const int val );
 
+	// A computed stat shows the result of this moExpr expression
+	// instead of a stored value (see ComputedStats)
+	//
+	QString				expression() const				{ return f_expression; }
+	void				expression( const QString& val );
+	bool				computed() const				{ return !f_expression.isEmpty(); }
+
 	virtual void		Copy( const pointer_t copy );
 	virtual void		Load( molib::moPropBagRef& propBag );
 	virtual void		Save( molib::moPropBagRef& propBag );
@@ -110,23 +119,8 @@ public:
 	StatSignal					SignalChanged()	{ return f_statChanged; }	// Stat changed
 
 private:
-	molib::moName		f_idName;
-	molib::moName		f_abilityIdName;
-	molib::moName		f_legacyIdName;
-	molib::moName		f_legacyTypeName;
-	molib::moName		f_nameName;
-	molib::moName		f_diceName;
-	molib::moName		f_facesName;
-	molib::moName		f_modifierName;
-	molib::moName		f_deletedName;
-	molib::moName		f_accelName;
-	molib::moName		f_showOnToolbarName;
-	molib::moName		f_showOnHUDName;
-	molib::moName		f_showMonsterOnHUDName;
-	molib::moName		f_internalName;
-	molib::moName		f_abilityName;
-	molib::moName		f_orderName;
-	//
+	friend class StatSchema;
+
 	molib::moName		f_id;
 	int					f_legacyId;
 	int					f_legacyType;
@@ -143,6 +137,7 @@ private:
 	bool				f_internal;			// If true, then this stat cannot be altered.
 	bool				f_ability;			// If true, then this is an ability stat (e.g. Str, Dex, etc.).
 	int					f_order;			// Order of stats as they appear on the UI
+	QString				f_expression;		// moExpr expression of a computed stat, empty for a stored stat
 
 	StatSignal			f_statChanged;
 };
@@ -173,6 +168,7 @@ public:
 
 	void			Copy( const pointer_t copy );
 	bool			Load( molib::moPropBagRef& propBag );
+	bool			Peek( molib::moPropBagRef& propBag, molib::mo_name_t& id, int& mod, int& roll ) const;
 	void			Save( molib::moPropBagRef& propBag );
 
 private:
@@ -265,10 +265,26 @@ bool MainWindow::OnTimer()
 	auto appSettings(GetAppSettings().lock());
 	assert(appSettings);
 
-	if( appSettings->Modified() )
+	// The combat state is journaled after each transaction, so a full
+	// save is only needed once in a while (a checkpoint); the settings
+	// and stats are not journaled and get saved right away
+	//
+	auto journal( GetCombatJournal().lock() );
+	assert(journal);
+	journal->Sync();
+
+	const bool checkpoint( journal->CheckpointDue() );
+	if( appSettings->Modified() || checkpoint )
 	{
 		f_statusBox.PushMessage( "Saving..." );
-		Save();
+		if( checkpoint )
+		{
+			Save();
+		}
+		else
+		{
+			SaveSettings();
+		}
 		f_statusBox.PopMessage();
 		appSettings->Modified( false );
 	}
@@ -883,6 +899,10 @@ void MainWindow::Load()
 	auto statMgr( GetStatMgr().lock() );
 	assert(statMgr);
 
+	// Replay the combat journal in case we crashed since the last save
+	//
+	GetCombatJournal().lock()->Recover();
+
 	// Alert the entire app that the StatManager has new values
 	//
 	statMgr->signal_changed().emit();
@@ -904,12 +924,29 @@ void MainWindow::Load()
 
 
 void MainWindow::Save()
+{
+	f_isSaving = true;
+
+	SaveSettings();
+	//
+	GetCharacterMgr().lock()->Save();
+	GetInitMgr().lock()->Save();
+	GetCombatJournal().lock()->Checkpoint();
+	//
+	f_isSaving = false;
+}
+
+
+/// \brief Save the settings and the stats
+//
+// These are not journaled (see Transactions::CombatJournal) so they are saved
+// as soon as they are modified.
+//
+void MainWindow::SaveSettings()
 {
 	auto appSettings(GetAppSettings().lock());
 	assert(appSettings);
 
-	f_isSaving = true;
-
 	// Store window position
 	//
 	int x, y;
@@ -938,12 +975,7 @@ void MainWindow::Save()
 #endif
 	//
 	appSettings->Save();
-	//
-	GetCharacterMgr().lock()->Save();
-	GetInitMgr().lock()->Save();
 	GetStatMgr().lock()->Save();
-	//
-	f_isSaving = false;
 }
 
 
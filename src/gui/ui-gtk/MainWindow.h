@@ -245,6 +245,7 @@ private:
 	//
 	void		Load();
 	void		Save();
+	void		SaveSettings();
 	void 		CreateEffectsFrame();
 	void 		FillMainBox();
 	void		InstallMenu();
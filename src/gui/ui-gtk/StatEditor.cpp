@@ -22,6 +22,10 @@
 #include "StatEditor.h"
 #include "StatManager.h"
 
+// MOLIB
+//
+#include "mo/mo_expr.h"
+
 using namespace molib;
 
 namespace UI
@@ -48,6 +52,7 @@ StatEditor::StatEditor()
 	append_column_editable( "Name",	f_columns.f_name	);
 	AddDieFacesColumn();
 	AddAccelKeyColumn();
+	append_column_editable( "Expression",					f_columns.f_expression );
 	append_column_editable( "Show on Toolbar",    			f_columns.f_showOnToolbar );
 	append_column_editable( "Show on Player HUD", 			f_columns.f_showOnHUD );
 	append_column_editable( "Show in Monster Stat on HUD",  f_columns.f_showMonsterOnHUD );
@@ -83,6 +88,13 @@ StatEditor::StatEditor()
 	col->add_attribute( rend->property_sensitive(), f_columns.f_showOnToolbar );
 	col->add_attribute( rend->property_editable() , f_columns.f_showOnToolbar );
 	//
+	// Expression (a computed stat when not empty)
+	//
+	col = f_expressionColumn = get_column( col_num++ );
+	col->set_sort_column( f_columns.f_expression );
+	rend = dynamic_cast<Gtk::CellRendererText*>(*(col->get_cell_renderers().begin()));
+	rend->signal_edited().connect( sigc::mem_fun( *this, &StatEditor::OnExpressionEdited ) );
+	//
 	// Show on Toolbar
 	//
 	col = get_column( col_num++ );
@@ -403,6 +415,41 @@ void StatEditor::OnAccelKeyEdited( const QString& path, const QString& new_text
 }
 
 
+void StatEditor::OnExpressionEdited( const QString& path, const QString& new_text )
+{
+	assert(f_store);
+	Gtk::TreeModel::iterator	iter	( f_store->get_iter( path ) );
+	const Gtk::TreeModel::Row& 	row		( *(iter) );
+	//
+	Attribute::Stat::pointer_t stat = GetOrCreateStat( row );
+	assert(stat);
+	//
+	// An empty expression turns the stat back into a stored stat
+	//
+	bool valid = true;
+	if( !new_text.isEmpty() )
+	{
+		moExprProgramSPtr program( moExprProgram::Compile( moWCString( new_text.toUtf8().data() ) ) );
+		valid = program->CompileError() == moExpr::MO_EXPR_ERROR_NONE;
+	}
+	//
+	if( !valid )
+	{
+		Gtk::MessageDialog dialog( 
+			"Invalid expression. Please enter a valid expression or clear the field.",
+			false, Gtk::MESSAGE_ERROR );
+		dialog.run();
+		set_cursor( Gtk::TreePath(path), *f_expressionColumn, true );
+	}
+	else
+	{
+		stat->expression( new_text );
+	}
+	//
+	PopulateRow( iter );
+}
+
+
 void StatEditor::OnShowMonsterOnHUDToggled( const QString& path )
 {
 	assert(f_store);
@@ -456,6 +503,7 @@ bool StatEditor::PopulateRow( const Gtk::TreeModel::iterator& iter )
 
 	row[f_columns.f_order]				= stat->order();
 	row[f_columns.f_name]				= stat->name();
+	row[f_columns.f_expression]			= stat->expression();
 	row[f_columns.f_showOnToolbar]		= stat->showOnToolbar();
 	row[f_columns.f_showOnHUD]			= stat->showOnHUD();
 	row[f_columns.f_showMonsterOnHUD]	= stat->showMonsterOnHUD();
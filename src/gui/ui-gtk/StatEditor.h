@@ -58,6 +58,7 @@ private:
 		Gtk::TreeModelColumn<QString>			f_name;
 		Gtk::TreeModelColumn<QString>			f_dieFaces;
 		Gtk::TreeModelColumn<QString>			f_accelKey;
+		Gtk::TreeModelColumn<QString>			f_expression;
 		Gtk::TreeModelColumn<bool>					f_showOnToolbar;
 		Gtk::TreeModelColumn<bool>					f_showOnHUD;
 		Gtk::TreeModelColumn<bool>					f_showMonsterOnHUD;
@@ -69,6 +70,7 @@ private:
 			add( f_name					);
 			add( f_dieFaces				);
 			add( f_accelKey				);
+			add( f_expression			);
 			add( f_showOnToolbar		);
 			add( f_showOnHUD			);
 			add( f_showMonsterOnHUD		);
@@ -100,6 +102,7 @@ private:
 	StatList					f_statsCopy;
 	
 	Gtk::TreeView::Column*		f_nameColumn;
+	Gtk::TreeView::Column*		f_expressionColumn;
 
 	void	Clear();
 	void	FixOrderings();
@@ -118,6 +121,7 @@ private:
 	void	OnNameEdited( const QString& path, const QString& new_text );
 	void	OnDieFacesEdited( const QString& path, const QString& new_text );
 	void	OnAccelKeyEdited( const QString& path, const QString& new_text );
+	void	OnExpressionEdited( const QString& path, const QString& new_text );
 	void	OnShowMonsterOnHUDToggled( const QString& path );
 	void	OnShowOnToolbarToggled( const QString& path );
 	void	OnShowOnHUDToggled( const QString& path );
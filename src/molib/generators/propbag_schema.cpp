@@ -0,0 +1,930 @@
+//
+// File:	generators/propbag_schema.c++
+// Object:	Generate typed property bag (de)serializers from a .schema file
+//
+// Copyright:	Copyright (c) 2005-2017 Made to Order Software Corp.
+//		All Rights Reserved.
+//
+//		This software and its associated documentation contains
+//		proprietary, confidential and trade secret information
+//		of Made to Order Software Corp. and except as provided by
+//		written agreement with Made to Order Software Corp.
+//
+//		a) no part may be disclosed, distributed, reproduced,
+//		   transmitted, transcribed, stored in a retrieval system,
+//		   adapted or translated in any form or by any means
+//		   electronic, mechanical, magnetic, optical, chemical,
+//		   manual or otherwise,
+//
+//		and
+//
+//		b) the recipient is not entitled to discover through reverse
+//		   engineering or reverse compiling or other such techniques
+//		   or processes the trade secrets contained therein or in the
+//		   documentation.
+//
+// Usage:
+//
+// 	propbag_schema [-f] [-o <path>] file.schema ...
+//
+// Each file.schema generates a file.h and a file.c++ with one class
+// per schema. The class has a static Load() and a static Save()
+// function which copy the fields of an object from/to a property bag
+// without going through the moProp...Ref objects: the property names
+// are transformed to mo_name_t once and the bag is walked in a single
+// pass (the bag and the fields are both sorted by name number.)
+//
+// The syntax of a .schema file is line based:
+//
+//	// comment (also # comment)
+//	include "base/effect.h"
+//
+//	schema Effects::Effect EffectSchema
+//	{
+//		string	f_name		NAME
+//		int	f_totalRounds	TOTALROUNDS
+//		bool	f_isActive	ACTIVE		load
+//		name	f_abilityId	ABILITY_ID	= molib::moName("UNNAMED")
+//	}
+//
+// The include lines are copied in the .c++ file. The class named on
+// the schema line is forward declared in the .h file and the schema
+// class is created in the same namespace. Since the generated code
+// accesses the fields directly, the class needs to declare the
+// schema class as a friend.
+//
+// The types are:
+//
+//	int	an moPropInt; the field is cast to/from int32_t so it
+//		can be any integer type or an enumeration
+//	bool	an moPropInt set to 0 or 1
+//	string	an moPropString; the field is expected to be a QString
+//	name	an moPropString; the field is expected to be an moName
+//
+// A field can be followed by "load" or "save" in which case it is
+// only loaded or only saved. The "= <expr>" is a C++ expression
+// assigned to the field when the bag does not include that property.
+//
+
+#include	<stdlib.h>
+#include	<stdio.h>
+#ifndef _MSC_VER
+#include	<unistd.h>
+#endif
+#include	<string.h>
+#include	<errno.h>
+#include	<ctype.h>
+#include	<string>
+#include	<vector>
+
+
+#ifdef _MSC_VER
+#pragma warning(disable: 4996)
+#endif
+
+
+bool		g_force;
+std::string	g_output = "./";
+int		g_errcnt;
+const char	g_auto_generated[] = "/* this file was auto-generated by the propbag_schema tool */";
+
+// the mask used to return the fields found by Load()
+const unsigned int	FIELD_MAX = 64;
+
+
+enum field_type_t {
+	FIELD_TYPE_INT,
+	FIELD_TYPE_BOOL,
+	FIELD_TYPE_STRING,
+	FIELD_TYPE_NAME
+};
+
+struct field_t {
+	field_type_t		f_type;
+	std::string		f_member;
+	std::string		f_prop_name;
+	std::string		f_default;
+	bool			f_load;
+	bool			f_save;
+};
+
+struct schema_t {
+	long			f_line;
+	std::vector<std::string> f_namespaces;
+	std::string		f_class;
+	std::string		f_name;
+	std::vector<field_t>	f_fields;
+};
+
+struct file_t {
+	std::vector<std::string> f_includes;
+	std::vector<schema_t>	f_schemas;
+};
+
+
+void setoutput(const char *output)
+{
+	// can't accept empty output path
+	if(output == 0 || *output == '\0') {
+		output = "./";
+	}
+
+	g_output = output;
+	if(g_output[g_output.length() - 1] != '/') {
+		g_output += '/';
+	}
+}
+
+
+FILE *open_output(const std::string& basename, const char *ext)
+{
+	FILE		*f;
+	size_t		l;
+	char		buf[256];
+
+	std::string name(g_output + basename + ext);
+	if(!g_force) {
+		f = fopen(name.c_str(), "rb");
+		if(f != 0) {
+			// the file already exists, let's make sure we're not
+			// overwriting some random user file
+			l = fread(buf, 1, sizeof(g_auto_generated) - 1, f);
+			fclose(f);
+			if(l != sizeof(g_auto_generated) - 1
+			|| memcmp(buf, g_auto_generated, sizeof(g_auto_generated) - 1) != 0) {
+				fprintf(stderr, "%s:1: error: cannot overwrite file; it does not look like an auto-generated file\n", name.c_str());
+				g_errcnt++;
+				return 0;
+			}
+		}
+	}
+
+	f = fopen(name.c_str(), "wb");
+	if(f == 0) {
+		fprintf(stderr, "%s:0: error: cannot open file\n", name.c_str());
+		g_errcnt++;
+		return 0;
+	}
+
+	// always write that at the very beginning
+	if(fprintf(f, "%s\n", g_auto_generated) < static_cast<int>(sizeof(g_auto_generated))) {
+		fclose(f);
+		remove(name.c_str());
+		fprintf(stderr, "%s:1: error: cannot write into output file\n", name.c_str());
+		g_errcnt++;
+		return 0;
+	}
+
+	return f;
+}
+
+
+bool read_input(const char *filename, std::vector<std::string>& lines)
+{
+	FILE		*f;
+	char		buf[1024];
+	std::string	line;
+	size_t		l;
+
+	f = fopen(filename, "rb");
+	if(f == 0) {
+		fprintf(stderr, "%s:0: error: cannot open file\n", filename);
+		g_errcnt++;
+		return false;
+	}
+	while(fgets(buf, sizeof(buf), f) != 0) {
+		line += buf;
+		l = line.length();
+		if(l > 0 && line[l - 1] != '\n' && !feof(f)) {
+			// line longer than our buffer
+			continue;
+		}
+		// remove the \n and \r
+		while(!line.empty() && (line[line.length() - 1] == '\n' || line[line.length() - 1] == '\r')) {
+			line.erase(line.length() - 1);
+		}
+		lines.push_back(line);
+		line.clear();
+	}
+	if(ferror(f)) {
+		int e = errno;
+		fprintf(stderr, "%s:%ld: error: ", filename, static_cast<long>(lines.size() + 1));
+		errno = e;
+		perror(0);
+		g_errcnt++;
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+
+	return true;
+}
+
+
+// break a line in words; a comment ends the line and a quoted string
+// is one word (without the quotes); "=" stops the parsing and the
+// rest of the line is returned in expr
+void split(const std::string& line, std::vector<std::string>& words, std::string& expr)
+{
+	std::string::size_type	p, s, max;
+
+	words.clear();
+	expr.clear();
+	max = line.length();
+	p = 0;
+	for(;;) {
+		while(p < max && isspace(static_cast<unsigned char>(line[p]))) {
+			++p;
+		}
+		if(p >= max || line[p] == '#'
+		|| (line[p] == '/' && p + 1 < max && line[p + 1] == '/')) {
+			return;
+		}
+		if(line[p] == '=') {
+			expr = line.substr(p + 1);
+			// trim the expression
+			s = expr.find_first_not_of(" \t");
+			if(s == std::string::npos) {
+				expr.clear();
+			}
+			else {
+				expr = expr.substr(s, expr.find_last_not_of(" \t") - s + 1);
+			}
+			return;
+		}
+		if(line[p] == '"') {
+			s = ++p;
+			while(p < max && line[p] != '"') {
+				++p;
+			}
+			words.push_back(line.substr(s, p - s));
+			if(p < max) {
+				++p;
+			}
+			continue;
+		}
+		if(line[p] == '{' || line[p] == '}') {
+			words.push_back(line.substr(p, 1));
+			++p;
+			continue;
+		}
+		s = p;
+		while(p < max && !isspace(static_cast<unsigned char>(line[p]))
+				&& line[p] != '{' && line[p] != '}' && line[p] != '=') {
+			++p;
+		}
+		words.push_back(line.substr(s, p - s));
+	}
+}
+
+
+bool is_identifier(const std::string& name)
+{
+	std::string::size_type	p, max;
+
+	max = name.length();
+	if(max == 0 || (!isalpha(static_cast<unsigned char>(name[0])) && name[0] != '_')) {
+		return false;
+	}
+	for(p = 1; p < max; ++p) {
+		if(!isalnum(static_cast<unsigned char>(name[p])) && name[p] != '_') {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// the enumeration name of a field is built from its property name
+std::string field_name(const field_t& field)
+{
+	std::string		result;
+	std::string::size_type	p, max;
+
+	max = field.f_prop_name.length();
+	for(p = 0; p < max; ++p) {
+		char c = field.f_prop_name[p];
+		if(isalnum(static_cast<unsigned char>(c))) {
+			result += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+		}
+		else {
+			result += '_';
+		}
+	}
+
+	return result;
+}
+
+
+bool parse_field(const char *filename, long line, const std::vector<std::string>& words, const std::string& expr, schema_t& schema)
+{
+	field_t		field;
+	size_t		idx;
+
+	if(words.size() < 3 || words.size() > 4) {
+		fprintf(stderr, "%s:%ld: error: a field is defined as: <type> <member> <property name> [load|save] [= <default>]\n", filename, line);
+		return false;
+	}
+
+	if(words[0] == "int") {
+		field.f_type = FIELD_TYPE_INT;
+	}
+	else if(words[0] == "bool") {
+		field.f_type = FIELD_TYPE_BOOL;
+	}
+	else if(words[0] == "string") {
+		field.f_type = FIELD_TYPE_STRING;
+	}
+	else if(words[0] == "name") {
+		field.f_type = FIELD_TYPE_NAME;
+	}
+	else {
+		fprintf(stderr, "%s:%ld: error: unknown field type \"%s\"; expected int, bool, string or name\n", filename, line, words[0].c_str());
+		return false;
+	}
+
+	if(!is_identifier(words[1])) {
+		fprintf(stderr, "%s:%ld: error: \"%s\" is not a valid member name\n", filename, line, words[1].c_str());
+		return false;
+	}
+	field.f_member = words[1];
+
+	if(words[2].empty()) {
+		fprintf(stderr, "%s:%ld: error: the property name of a field cannot be empty\n", filename, line);
+		return false;
+	}
+	field.f_prop_name = words[2];
+
+	field.f_load = true;
+	field.f_save = true;
+	if(words.size() == 4) {
+		if(words[3] == "load") {
+			field.f_save = false;
+		}
+		else if(words[3] == "save") {
+			field.f_load = false;
+		}
+		else {
+			fprintf(stderr, "%s:%ld: error: unknown field flag \"%s\"; expected load or save\n", filename, line, words[3].c_str());
+			return false;
+		}
+	}
+	field.f_default = expr;
+	if(!field.f_default.empty() && !field.f_load) {
+		fprintf(stderr, "%s:%ld: error: a default value is useless on a field which is not loaded\n", filename, line);
+		return false;
+	}
+
+	for(idx = 0; idx < schema.f_fields.size(); ++idx) {
+		if(schema.f_fields[idx].f_prop_name == field.f_prop_name) {
+			fprintf(stderr, "%s:%ld: error: property \"%s\" defined twice in schema %s\n", filename, line, field.f_prop_name.c_str(), schema.f_name.c_str());
+			return false;
+		}
+		if(field_name(schema.f_fields[idx]) == field_name(field)) {
+			fprintf(stderr, "%s:%ld: error: properties \"%s\" and \"%s\" generate the same field name\n", filename, line, schema.f_fields[idx].f_prop_name.c_str(), field.f_prop_name.c_str());
+			return false;
+		}
+	}
+	if(schema.f_fields.size() >= FIELD_MAX) {
+		fprintf(stderr, "%s:%ld: error: a schema is limited to %u fields\n", filename, line, FIELD_MAX);
+		return false;
+	}
+
+	schema.f_fields.push_back(field);
+
+	return true;
+}
+
+
+bool parse_schema_name(const char *filename, long line, const std::vector<std::string>& words, schema_t& schema)
+{
+	std::string		name;
+	std::string::size_type	p, s;
+
+	if(words.size() != 3) {
+		fprintf(stderr, "%s:%ld: error: expected: schema <class> <schema name>\n", filename, line);
+		return false;
+	}
+
+	schema.f_line = line;
+	name = words[1];
+	s = 0;
+	for(;;) {
+		p = name.find("::", s);
+		if(p == std::string::npos) {
+			schema.f_class = name.substr(s);
+			break;
+		}
+		schema.f_namespaces.push_back(name.substr(s, p - s));
+		s = p + 2;
+	}
+	for(p = 0; p < schema.f_namespaces.size(); ++p) {
+		if(!is_identifier(schema.f_namespaces[p])) {
+			fprintf(stderr, "%s:%ld: error: \"%s\" is not a valid namespace name\n", filename, line, schema.f_namespaces[p].c_str());
+			return false;
+		}
+	}
+	if(!is_identifier(schema.f_class)) {
+		fprintf(stderr, "%s:%ld: error: \"%s\" is not a valid class name\n", filename, line, schema.f_class.c_str());
+		return false;
+	}
+	if(!is_identifier(words[2])) {
+		fprintf(stderr, "%s:%ld: error: \"%s\" is not a valid schema name\n", filename, line, words[2].c_str());
+		return false;
+	}
+	schema.f_name = words[2];
+
+	return true;
+}
+
+
+bool parse_file(const char *filename, const std::vector<std::string>& lines, file_t& file)
+{
+	enum state_t {
+		STATE_TOP,
+		STATE_OPEN,
+		STATE_FIELDS
+	};
+	std::vector<std::string>	words;
+	std::string			expr;
+	state_t				state;
+	size_t				idx;
+	long				line;
+	int				errcnt;
+
+	errcnt = 0;
+	state = STATE_TOP;
+	for(idx = 0; idx < lines.size(); ++idx) {
+		line = static_cast<long>(idx + 1);
+		split(lines[idx], words, expr);
+		if(words.empty()) {
+			if(!expr.empty()) {
+				fprintf(stderr, "%s:%ld: error: unexpected \"=\"\n", filename, line);
+				errcnt++;
+			}
+			continue;
+		}
+		switch(state) {
+		case STATE_TOP:
+			if(words[0] == "include" && words.size() == 2 && expr.empty()) {
+				file.f_includes.push_back(words[1]);
+			}
+			else if(words[0] == "schema" && expr.empty()) {
+				file.f_schemas.push_back(schema_t());
+				if(!parse_schema_name(filename, line, words, file.f_schemas.back())) {
+					errcnt++;
+				}
+				state = STATE_OPEN;
+			}
+			else {
+				fprintf(stderr, "%s:%ld: error: expected an include or a schema\n", filename, line);
+				errcnt++;
+			}
+			break;
+
+		case STATE_OPEN:
+			if(words.size() != 1 || words[0] != "{" || !expr.empty()) {
+				fprintf(stderr, "%s:%ld: error: expected a \"{\" after the schema definition\n", filename, line);
+				errcnt++;
+			}
+			state = STATE_FIELDS;
+			break;
+
+		case STATE_FIELDS:
+			if(words[0] == "}") {
+				if(words.size() != 1 || !expr.empty()) {
+					fprintf(stderr, "%s:%ld: error: unexpected data after \"}\"\n", filename, line);
+					errcnt++;
+				}
+				if(file.f_schemas.back().f_fields.empty()) {
+					fprintf(stderr, "%s:%ld: error: schema %s has no fields\n", filename, line, file.f_schemas.back().f_name.c_str());
+					errcnt++;
+				}
+				state = STATE_TOP;
+			}
+			else if(!parse_field(filename, line, words, expr, file.f_schemas.back())) {
+				errcnt++;
+			}
+			break;
+
+		}
+	}
+	if(state != STATE_TOP) {
+		fprintf(stderr, "%s:%ld: error: schema %s is not closed\n", filename, static_cast<long>(lines.size()), file.f_schemas.back().f_name.c_str());
+		errcnt++;
+	}
+	if(file.f_schemas.empty() && errcnt == 0) {
+		fprintf(stderr, "%s:%ld: error: no schema found\n", filename, static_cast<long>(lines.size()));
+		errcnt++;
+	}
+
+	g_errcnt += errcnt;
+	return errcnt == 0;
+}
+
+
+void open_namespaces(FILE *out, const schema_t& schema)
+{
+	size_t		idx;
+
+	for(idx = 0; idx < schema.f_namespaces.size(); ++idx) {
+		fprintf(out, "namespace %s\n{\n", schema.f_namespaces[idx].c_str());
+	}
+	if(!schema.f_namespaces.empty()) {
+		fprintf(out, "\n");
+	}
+}
+
+
+void close_namespaces(FILE *out, const schema_t& schema)
+{
+	size_t		idx;
+
+	for(idx = schema.f_namespaces.size(); idx > 0; --idx) {
+		fprintf(out, "}\n// namespace %s\n", schema.f_namespaces[idx - 1].c_str());
+	}
+	fprintf(out, "\n\n");
+}
+
+
+void generate_header(FILE *h, const std::string& guard, const file_t& file)
+{
+	size_t		idx, f;
+
+	fprintf(h, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+	fprintf(h, "#include \"mo/mo_props.h\"\n\n\n");
+
+	for(idx = 0; idx < file.f_schemas.size(); ++idx) {
+		const schema_t& schema(file.f_schemas[idx]);
+
+		open_namespaces(h, schema);
+		fprintf(h, "class %s;\n\n", schema.f_class.c_str());
+		fprintf(h, "class %s\n{\npublic:\n", schema.f_name.c_str());
+		fprintf(h, "\tenum field_t {\n");
+		for(f = 0; f < schema.f_fields.size(); ++f) {
+			fprintf(h, "\t\tFIELD_%s,\n", field_name(schema.f_fields[f]).c_str());
+		}
+		fprintf(h, "\n\t\tFIELD_max\n\t};\n\n");
+		fprintf(h, "\t// Load() returns a mask of the properties it found\n");
+		fprintf(h, "\ttypedef uint64_t\tmask_t;\n\n");
+		for(f = 0; f < schema.f_fields.size(); ++f) {
+			std::string n(field_name(schema.f_fields[f]));
+			fprintf(h, "\tstatic const mask_t\tMASK_%s = static_cast<mask_t>(1) << FIELD_%s;\n", n.c_str(), n.c_str());
+		}
+		fprintf(h, "\n");
+		fprintf(h, "\tstatic molib::mo_name_t\tName(field_t field);\n");
+		fprintf(h, "\tstatic mask_t\t\tLoad(%s& obj, const molib::moPropBagRef& bag);\n", schema.f_class.c_str());
+		fprintf(h, "\tstatic void\t\tSave(const %s& obj, molib::moPropBagRef& bag);\n", schema.f_class.c_str());
+		fprintf(h, "};\n\n");
+		close_namespaces(h, schema);
+	}
+
+	fprintf(h, "#endif\n");
+}
+
+
+void generate_load(FILE *cpp, const schema_t& schema)
+{
+	size_t		f;
+
+	fprintf(cpp, "%s::mask_t %s::Load(%s& obj, const molib::moPropBagRef& bag)\n{\n",
+			schema.f_name.c_str(), schema.f_name.c_str(), schema.f_class.c_str());
+	fprintf(cpp, "\tconst %sSlots& s(Get%sSlots());\n", schema.f_name.c_str(), schema.f_name.c_str());
+	fprintf(cpp, "\tmask_t found(0);\n\n");
+	fprintf(cpp, "\tmolib::moPropSPtr p(bag.GetProperty());\n");
+	fprintf(cpp, "\tconst molib::moPropBag *b = dynamic_cast<const molib::moPropBag *>(static_cast<molib::moProp *>(p));\n");
+	fprintf(cpp, "\tif(b != 0) {\n");
+	fprintf(cpp, "\t\t// both lists are sorted by name number so one pass is enough\n");
+	fprintf(cpp, "\t\tconst unsigned long max(b->Count());\n");
+	fprintf(cpp, "\t\tunsigned long idx(0);\n");
+	fprintf(cpp, "\t\tint order(0);\n");
+	fprintf(cpp, "\t\twhile(idx < max && order < FIELD_max) {\n");
+	fprintf(cpp, "\t\t\tconst molib::moPropSPtr prop(b->Get(static_cast<int>(idx)));\n");
+	fprintf(cpp, "\t\t\tconst molib::mo_name_t name(prop->GetName());\n");
+	fprintf(cpp, "\t\t\tconst int field(s.f_order[order]);\n");
+	fprintf(cpp, "\t\t\tif(name < s.f_names[field]) {\n\t\t\t\t++idx;\n\t\t\t\tcontinue;\n\t\t\t}\n");
+	fprintf(cpp, "\t\t\tif(name > s.f_names[field]) {\n\t\t\t\t++order;\n\t\t\t\tcontinue;\n\t\t\t}\n");
+	fprintf(cpp, "\t\t\t++idx;\n\t\t\t++order;\n");
+	fprintf(cpp, "\t\t\tswitch(prop->GetType()) {\n");
+
+	static const struct {
+		const char *	f_prop_type;
+		const char *	f_class;
+		bool		f_string;
+	} types[] = {
+		{ "MO_PROP_TYPE_INT", "molib::moPropInt", false },
+		{ "MO_PROP_TYPE_STRING", "molib::moPropString", true }
+	};
+	for(size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t) {
+		bool has_case = false;
+		for(f = 0; f < schema.f_fields.size(); ++f) {
+			const field_t& field(schema.f_fields[f]);
+			if(!field.f_load) {
+				continue;
+			}
+			bool is_string = field.f_type == FIELD_TYPE_STRING || field.f_type == FIELD_TYPE_NAME;
+			if(is_string != types[t].f_string) {
+				continue;
+			}
+			if(!has_case) {
+				has_case = true;
+				fprintf(cpp, "\t\t\tcase molib::moProp::%s:\n", types[t].f_prop_type);
+				if(types[t].f_string) {
+					fprintf(cpp, "\t\t\t\t{\n\t\t\t\t\tconst molib::moWCString& value(static_cast<const %s&>(*prop).Get());\n", types[t].f_class);
+				}
+				else {
+					fprintf(cpp, "\t\t\t\t{\n\t\t\t\t\tconst int32_t value(static_cast<const %s&>(*prop).Get());\n", types[t].f_class);
+				}
+				fprintf(cpp, "\t\t\t\t\tswitch(field) {\n");
+			}
+			std::string n(field_name(field));
+			fprintf(cpp, "\t\t\t\t\tcase FIELD_%s:\n", n.c_str());
+			switch(field.f_type) {
+			case FIELD_TYPE_INT:
+				fprintf(cpp, "\t\t\t\t\t\tobj.%s = static_cast<decltype(obj.%s)>(value);\n", field.f_member.c_str(), field.f_member.c_str());
+				break;
+
+			case FIELD_TYPE_BOOL:
+				fprintf(cpp, "\t\t\t\t\t\tobj.%s = value != 0;\n", field.f_member.c_str());
+				break;
+
+			case FIELD_TYPE_STRING:
+				fprintf(cpp, "\t\t\t\t\t\tobj.%s = value.c_str();\n", field.f_member.c_str());
+				break;
+
+			case FIELD_TYPE_NAME:
+				fprintf(cpp, "\t\t\t\t\t\tobj.%s = molib::moName(value);\n", field.f_member.c_str());
+				break;
+
+			}
+			fprintf(cpp, "\t\t\t\t\t\tfound |= MASK_%s;\n", n.c_str());
+			fprintf(cpp, "\t\t\t\t\t\tbreak;\n\n");
+		}
+		if(has_case) {
+			fprintf(cpp, "\t\t\t\t\tdefault:\n\t\t\t\t\t\t// property of another type\n\t\t\t\t\t\tbreak;\n\n");
+			fprintf(cpp, "\t\t\t\t\t}\n\t\t\t\t}\n\t\t\t\tbreak;\n\n");
+		}
+	}
+	fprintf(cpp, "\t\t\tdefault:\n\t\t\t\t// not a type used by this schema\n\t\t\t\tbreak;\n\n");
+	fprintf(cpp, "\t\t\t}\n\t\t}\n\t}\n\n");
+
+	for(f = 0; f < schema.f_fields.size(); ++f) {
+		const field_t& field(schema.f_fields[f]);
+		if(!field.f_default.empty()) {
+			fprintf(cpp, "\tif((found & MASK_%s) == 0) {\n\t\tobj.%s = %s;\n\t}\n",
+					field_name(field).c_str(), field.f_member.c_str(), field.f_default.c_str());
+		}
+	}
+
+	fprintf(cpp, "\treturn found;\n}\n\n\n");
+}
+
+
+void generate_save(FILE *cpp, const schema_t& schema)
+{
+	size_t		f;
+
+	fprintf(cpp, "void %s::Save(const %s& obj, molib::moPropBagRef& bag)\n{\n",
+			schema.f_name.c_str(), schema.f_class.c_str());
+	fprintf(cpp, "\tconst %sSlots& s(Get%sSlots());\n\n", schema.f_name.c_str(), schema.f_name.c_str());
+	fprintf(cpp, "\tif(!bag.HasProp()) {\n\t\tbag.NewProp();\n\t}\n");
+	fprintf(cpp, "\tmolib::moPropSPtr p(bag.GetProperty());\n");
+	fprintf(cpp, "\tmolib::moPropBag *b = dynamic_cast<molib::moPropBag *>(static_cast<molib::moProp *>(p));\n\n");
+	for(f = 0; f < schema.f_fields.size(); ++f) {
+		const field_t& field(schema.f_fields[f]);
+		if(!field.f_save) {
+			continue;
+		}
+		std::string n(field_name(field));
+		fprintf(cpp, "\t{\n");
+		switch(field.f_type) {
+		case FIELD_TYPE_INT:
+			fprintf(cpp, "\t\tmolib::moPropIntSPtr prop(new molib::moPropInt(s.f_names[FIELD_%s]));\n", n.c_str());
+			fprintf(cpp, "\t\tprop->Set(static_cast<int32_t>(obj.%s));\n", field.f_member.c_str());
+			break;
+
+		case FIELD_TYPE_BOOL:
+			fprintf(cpp, "\t\tmolib::moPropIntSPtr prop(new molib::moPropInt(s.f_names[FIELD_%s]));\n", n.c_str());
+			fprintf(cpp, "\t\tprop->Set(static_cast<int32_t>(obj.%s ? 1 : 0));\n", field.f_member.c_str());
+			break;
+
+		case FIELD_TYPE_STRING:
+			fprintf(cpp, "\t\tmolib::moSmartPtr<molib::moPropString> prop(new molib::moPropString(s.f_names[FIELD_%s]));\n", n.c_str());
+			fprintf(cpp, "\t\tprop->Set(molib::moWCString(obj.%s.toUtf8().data()));\n", field.f_member.c_str());
+			break;
+
+		case FIELD_TYPE_NAME:
+			fprintf(cpp, "\t\tmolib::moSmartPtr<molib::moPropString> prop(new molib::moPropString(s.f_names[FIELD_%s]));\n", n.c_str());
+			fprintf(cpp, "\t\tprop->Set(static_cast<molib::moWCString>(molib::moName(obj.%s)));\n", field.f_member.c_str());
+			break;
+
+		}
+		fprintf(cpp, "\t\tb->Set(s.f_names[FIELD_%s], *prop);\n", n.c_str());
+		fprintf(cpp, "\t}\n");
+	}
+	fprintf(cpp, "}\n\n\n");
+}
+
+
+void generate_cpp(FILE *cpp, const std::string& basename, const file_t& file)
+{
+	size_t		idx, f;
+
+	fprintf(cpp, "#include \"%s.h\"\n\n", basename.c_str());
+	for(idx = 0; idx < file.f_includes.size(); ++idx) {
+		fprintf(cpp, "#include \"%s\"\n", file.f_includes[idx].c_str());
+	}
+	fprintf(cpp, "\n#include <algorithm>\n\n\n");
+
+	for(idx = 0; idx < file.f_schemas.size(); ++idx) {
+		const schema_t& schema(file.f_schemas[idx]);
+
+		open_namespaces(cpp, schema);
+
+		// the names are transformed in numbers only once
+		fprintf(cpp, "namespace\n{\n\n");
+		fprintf(cpp, "const char * const g_%s_names[%s::FIELD_max] =\n{\n", schema.f_name.c_str(), schema.f_name.c_str());
+		for(f = 0; f < schema.f_fields.size(); ++f) {
+			fprintf(cpp, "\t\"%s\",\n", schema.f_fields[f].f_prop_name.c_str());
+		}
+		fprintf(cpp, "};\n\n");
+		fprintf(cpp, "struct %sSlots\n{\n", schema.f_name.c_str());
+		fprintf(cpp, "\t%sSlots(const char * const *names)\n\t{\n", schema.f_name.c_str());
+		fprintf(cpp, "\t\tconst molib::moNamePool& pool(molib::moNamePool::GetNamePool());\n");
+		fprintf(cpp, "\t\tfor(int idx = 0; idx < %s::FIELD_max; ++idx) {\n", schema.f_name.c_str());
+		fprintf(cpp, "\t\t\tf_names[idx] = pool[names[idx]];\n");
+		fprintf(cpp, "\t\t\tf_order[idx] = idx;\n\t\t}\n");
+		fprintf(cpp, "\t\t// a bag is sorted by name number, not alphabetically\n");
+		fprintf(cpp, "\t\tstd::sort(f_order, f_order + %s::FIELD_max, [this](int a, int b) { return f_names[a] < f_names[b]; });\n", schema.f_name.c_str());
+		fprintf(cpp, "\t}\n\n");
+		fprintf(cpp, "\tmolib::mo_name_t\tf_names[%s::FIELD_max];\n", schema.f_name.c_str());
+		fprintf(cpp, "\tint\t\t\tf_order[%s::FIELD_max];\n", schema.f_name.c_str());
+		fprintf(cpp, "};\n\n");
+		fprintf(cpp, "const %sSlots& Get%sSlots()\n{\n", schema.f_name.c_str(), schema.f_name.c_str());
+		fprintf(cpp, "\tstatic const %sSlots slots(g_%s_names);\n\treturn slots;\n}\n\n", schema.f_name.c_str(), schema.f_name.c_str());
+		fprintf(cpp, "}\n// no name namespace\n\n\n");
+
+		fprintf(cpp, "molib::mo_name_t %s::Name(field_t field)\n{\n", schema.f_name.c_str());
+		fprintf(cpp, "\treturn Get%sSlots().f_names[field];\n}\n\n\n", schema.f_name.c_str());
+
+		generate_load(cpp, schema);
+		generate_save(cpp, schema);
+
+		close_namespaces(cpp, schema);
+	}
+}
+
+
+void parse(const char *filename)
+{
+	FILE				*h, *cpp;
+	const char			*ext, *basename;
+	std::vector<std::string>	lines;
+	file_t				file;
+	std::string			base, guard;
+	std::string::size_type		idx;
+
+/* make sure the extension is .schema */
+	ext = strrchr(filename, '.');
+	if(ext == 0 || strcmp(".schema", ext) != 0) {
+		fprintf(stderr, "%s:0: error: expected a file with the .schema extension\n", filename);
+		g_errcnt++;
+		return;
+	}
+
+/* read and parse the input */
+	if(!read_input(filename, lines)
+	|| !parse_file(filename, lines, file)) {
+		return;
+	}
+
+/* open the output files */
+	basename = strrchr(filename, '/');
+	if(basename == 0) {
+		basename = strrchr(filename, '\\');
+		if(basename == 0) {
+			basename = filename;
+		}
+		else {
+			basename++;
+		}
+	}
+	else {
+		basename++;
+	}
+	base.assign(basename, ext - basename);
+
+	guard = "MO_SCHEMA_";
+	for(idx = 0; idx < base.length(); ++idx) {
+		if(isalnum(static_cast<unsigned char>(base[idx]))) {
+			guard += static_cast<char>(toupper(static_cast<unsigned char>(base[idx])));
+		}
+		else {
+			guard += '_';
+		}
+	}
+	guard += "_H";
+
+	h = open_output(base, ".h");
+	cpp = open_output(base, ".c++");
+	if(h != 0 && cpp != 0) {
+		generate_header(h, guard, file);
+		generate_cpp(cpp, base, file);
+	}
+	if(h != 0) {
+		fclose(h);
+	}
+	if(cpp != 0) {
+		fclose(cpp);
+	}
+}
+
+
+
+
+void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-opts] file ...\n", argv0);
+	fprintf(stderr, "where -opts is one or more of the following:\n");
+	fprintf(stderr, "  -f or --force          replace the output even if it is a user file\n");
+	fprintf(stderr, "  -h or --help           print out this usage screen\n");
+	fprintf(stderr, "  -o or --output <path>  a path where to save the output files (default: .)\n");
+	exit(1);
+}
+
+int main(int argc, const char *argv[])
+{
+	int		i;
+	size_t		j, max;
+	bool		filenames_only;
+
+	filenames_only = false;
+
+	for(i = 1; i < argc; ++i) {
+		if(argv[i][0] == '-' && !filenames_only) {
+			if(argv[i][1] == '-') {
+				// long options
+				if(argv[i][2] == '\0') {
+					filenames_only = true;
+				}
+				else if(strcmp(argv[i] + 2, "help") == 0) {
+					usage(argv[0]);
+					/*NOTREACHED*/
+				}
+				else if(strcmp(argv[i] + 2, "force") == 0) {
+					g_force = true;
+				}
+				else if(strcmp(argv[i] + 2, "output") == 0) {
+					i++;
+					if(i >= argc) {
+						fprintf(stderr, "<no file>:0: error: expected a path after --output\n");
+						usage(argv[0]);
+						/*NOTREACHED*/
+					}
+					setoutput(argv[i]);
+				}
+				else {
+					fprintf(stderr, "<no file>:0: error: unknown option '%s'\n", argv[i]);
+					usage(argv[0]);
+					/*NOTREACHED*/
+				}
+			}
+			else {
+				max = strlen(argv[i]);
+				for(j = 1; j < max; ++j) {
+					switch(argv[i][j]) {
+					case 'f':
+						g_force = true;
+						break;
+
+					case 'o':
+						i++;
+						if(i >= argc) {
+							fprintf(stderr, "<no file>:0: error: expected a path after -o\n");
+							usage(argv[0]);
+							/*NOTREACHED*/
+						}
+						setoutput(argv[i]);
+						j = max;
+						break;
+
+					default:
+						fprintf(stderr, "<no file>:0: error: unknown option '-%c'\n", argv[i][j]);
+					case 'h':
+						usage(argv[0]);
+						/*NOTREACHED*/
+
+					}
+				}
+			}
+		}
+		else {
+			parse(argv[i]);
+		}
+	}
+
+	return g_errcnt > 0 ? 1 : 0;
+}
+
+// vim: ts=8 sw=8
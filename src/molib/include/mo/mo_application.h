@@ -82,7 +82,7 @@ public:
 	void			SetRootPath(const moWCString& root_path);
 	const moWCString&	GetRootPath(void) const;
 	void			SetApplicationPath(const moWCString& application_path);
-	const moWCString	GetApplicationPath(bool docs = false);
+	const moWCString&	GetApplicationPath(bool docs = false);
 	const moWCString&	GetUserPath(void);
 	const moWCString&	GetPrivateUserPath(bool append_version = true);
 
@@ -143,6 +143,7 @@ private:
 	moWCString			f_application_filename;
 	moWCString			f_root_path;
 	moWCString			f_application_path;
+	moWCString			f_full_application_path;	// root + application path
 	moWCString			f_user_path;
 	moWCString			f_private_user_path;
 	moWCString			f_manufacturer;
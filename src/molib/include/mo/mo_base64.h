@@ -0,0 +1,94 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+#ifndef MO_BASE64_H
+#define	MO_BASE64_H
+#ifdef MO_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#ifndef MO_WCSTRING_H
+#include	"mo_string.h"
+#endif
+#ifndef MO_BUFFER_H
+#include	"mo_buffer.h"
+#endif
+
+
+namespace molib
+{
+
+
+// RFC 4648 base64; the encoder and decoder can be fed any number
+// of bytes at a time so a large buffer can be sent to a stream in
+// small chunks
+class MO_DLL_EXPORT moBase64Encoder
+{
+public:
+				moBase64Encoder(unsigned long line_length = 76);
+
+	static unsigned long	EncodedSize(unsigned long size, unsigned long line_length = 76);
+
+	void			Reset(void);
+	unsigned long		Encode(char *out, const void *in, unsigned long size);
+	unsigned long		Finish(char *out);
+
+private:
+	unsigned long		f_line_length;
+	unsigned long		f_column;
+	unsigned long		f_pending_size;
+	unsigned char		f_pending[2];
+};
+
+
+class MO_DLL_EXPORT moBase64Decoder
+{
+public:
+				moBase64Decoder(void);
+
+	static unsigned long	DecodedSize(unsigned long size);
+
+	void			Reset(void);
+	long			Decode(void *out, const char *in, unsigned long size);
+	long			Decode(void *out, const mowc::wc_t *in, unsigned long size);
+	long			Finish(void *out);
+
+private:
+	template<class C>
+	long			InternalDecode(unsigned char *out, const C *in, unsigned long size);
+
+	uint32_t		f_quad;
+	unsigned long		f_pending_size;
+	bool			f_padded;
+};
+
+
+MO_DLL_EXPORT_FUNC void moBase64Encode(moBuffer& out, const moBuffer& in, unsigned long line_length = 76);
+MO_DLL_EXPORT_FUNC bool moBase64Decode(moBuffer& out, const moBuffer& in);
+MO_DLL_EXPORT_FUNC bool moBase64Decode(moBuffer& out, const moWCString& in);
+
+
+
+
+};			// namespace molib;
+
+// vim: ts=8 sw=8
+#endif		// #ifndef MO_BASE64_H
+
@@ -55,6 +55,8 @@ public:
 	static const unsigned long	DIR_MAX_REENTRY		= 0x32000000;
 	// WARNING: the maximum for DIR_MAX_REENTRY is 0xFE000000
 
+	static const unsigned long	DIR_THREADS_AUTO	= 0;	// one per processor
+
 				moDirectory(void);
 				moDirectory(const moWCString& path, unsigned long flags = 0);
 
@@ -63,10 +65,13 @@ public:
 	virtual void		Append(const moListBase *list);
 	void			AppendEmpty(moDirectory& dir);
 
+	void			SetThreads(unsigned long threads);
+	unsigned long		Threads(void) const;
+
 	class moEntry : public moWCString
 	{
 	public:
-					moEntry(const moWCString& path, const moWCString& name);
+					moEntry(const moWCString& path, const moWCString& name, unsigned int type = 0);
 					moEntry(const moEntry& entry);
 
 		moWCString&		FullPath(void) const;
@@ -83,6 +88,11 @@ public:
 		bool			IsSock(void) const;
 
 	private:
+		unsigned int		FileType(bool follow) const;
+
+		// the file type (S_IFMT bits) found in the directory or 0
+		unsigned int		f_type;
+
 		// the mutable parameters are only place holders to
 		// avoid recomputing their values each time the corresponding
 		// function is called
@@ -101,6 +111,11 @@ public:
 
 private:
 	bool			ReadDir(const moWCString& path, const moWCString& pattern, unsigned long flags, moList& list);
+	bool			ReadTree(moEntry * const *roots, unsigned long count, unsigned long flags);
+	bool			Contains(const moEntry& entry) const;
+	unsigned long		Merge(moEntry **entries, unsigned long count);
+
+	unsigned long		f_threads;
 };
 
 
@@ -0,0 +1,122 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+#ifndef MO_DIRECTORY_WATCHER_H
+#define	MO_DIRECTORY_WATCHER_H
+#ifdef MO_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#ifndef MO_THREAD_H
+#include	"mo_thread.h"
+#endif
+
+
+namespace molib
+{
+
+
+// receivers of an moEventPipeBroadcast (i.e. the moApplication) which
+// also derive from this class are told about the changes of the
+// watched directories, one call per file
+class MO_DLL_EXPORT moDirectoryWatcherEvent
+{
+public:
+	virtual			~moDirectoryWatcherEvent();
+	virtual void		DirectoryChanged(const moWCString& directory, const moWCString& filename, unsigned long changes) = 0;
+};
+
+
+
+// watch directories (with inotify(7) under Linux) and post one event
+// per changed file once the burst of changes on that file is over
+class MO_DLL_EXPORT moDirectoryWatcher : public moThread::moRunner
+{
+public:
+	static const unsigned long	WATCH_CREATED		= 0x0001;	// created or moved in the directory
+	static const unsigned long	WATCH_MODIFIED		= 0x0002;	// closed after being written to
+	static const unsigned long	WATCH_DELETED		= 0x0004;	// deleted or moved out of the directory
+	static const unsigned long	WATCH_ATTRIB		= 0x0008;	// permissions, owner, timestamps changed
+	static const unsigned long	WATCH_OVERFLOW		= 0x0010;	// changes were lost, re-read the whole directory
+
+	static const unsigned long	WATCH_DELAY_DEFAULT	= 100;		// in ms
+	static const long		WATCH_RUN_TIMEOUT	= 250;		// in ms, how long Run() waits
+
+	class MO_DLL_EXPORT moEventChange : public moReceiversEvent
+	{
+	public:
+					moEventChange(const moWCString& directory, const moWCString& filename, unsigned long changes);
+					moEventChange(const moEventChange& event);
+
+		virtual const char *	moGetClassName(void) const;
+		virtual moEventSPtr	Duplicate(void) const;
+		virtual void		SendToReceivers(const moSortedList& receivers);
+
+		const moWCString&	GetDirectory(void) const;
+		const moWCString&	GetFilename(void) const;
+		moWCString		GetPath(void) const;
+		unsigned long		GetChanges(void) const;
+
+	private:
+		moWCString		f_directory;
+		moWCString		f_filename;
+		unsigned long		f_changes;
+	};
+
+	typedef moSmartPtr<moEventChange>	moEventChangeSPtr;
+
+				moDirectoryWatcher(moEventPipe *pipe);
+	virtual			~moDirectoryWatcher();
+
+	virtual const char *	moGetClassName(void) const;
+
+	bool			Watch(const moWCString& directory, const moWCString& pattern = "*");
+	bool			Unwatch(const moWCString& directory);
+	void			UnwatchAll(void);
+	unsigned long		Count(void) const;
+
+	void			SetDelay(unsigned long delay);
+	unsigned long		GetDelay(void) const;
+
+	int			GetFileDescriptor(void) const;
+	unsigned long		Poll(long timeout = 0);
+
+	virtual bool		Run(void);
+
+private:
+	class moWatches;
+
+				moDirectoryWatcher(const moDirectoryWatcher& watcher);
+	moDirectoryWatcher&	operator = (const moDirectoryWatcher& watcher);
+
+	moEventPipeSPtr		f_pipe;
+	moWatches *		f_watches;
+};
+
+typedef moSmartPtr<moDirectoryWatcher>	moDirectoryWatcherSPtr;
+
+
+
+
+};			// namespace molib;
+
+// vim: ts=8 sw=8
+#endif		// #ifndef MO_DIRECTORY_WATCHER_H
+
@@ -27,6 +27,9 @@
 #ifndef MO_STRING_H
 #include	"mo_string.h"
 #endif
+#ifndef MO_MUTEX_H
+#include	"mo_mutex.h"
+#endif
 
 
 namespace molib
@@ -79,6 +82,77 @@ private:
 
 
 
+// a value given to or returned by a compiled expression
+class MO_DLL_EXPORT moExprValue
+{
+public:
+	enum mo_expr_value_type_t {
+		MO_EXPR_VALUE_UNDEFINED = 0,
+		MO_EXPR_VALUE_INTEGER,
+		MO_EXPR_VALUE_FLOAT,
+		MO_EXPR_VALUE_STRING
+	};
+
+				moExprValue(void);
+
+	mo_expr_value_type_t	Type(void) const { return f_type; }
+	long			Integer(void) const { return f_integer; }
+	double			Float(void) const { return f_float; }
+	const moWCString&	String(void) const { return f_string; }
+	moWCString		ToString(void) const;
+
+	void			SetUndefined(void);
+	void			SetInteger(long value);
+	void			SetFloat(double value);
+	void			SetString(const moWCString& value);
+
+private:
+	mo_expr_value_type_t	f_type;
+	long			f_integer;
+	double			f_float;
+	moWCString		f_string;
+};
+
+
+// an expression compiled once and evaluated any number of times
+class MO_DLL_EXPORT moExprProgram : public moBase
+{
+public:
+	class moCode;		// the compiled form, defined in expr.cpp
+
+				moExprProgram(const moWCString& expression);
+	virtual			~moExprProgram();
+
+	virtual const char *	moGetClassName(void) const;
+
+	static moSmartPtr<moExprProgram> Compile(const moWCString& expression);
+	static void		SetCacheSize(unsigned long size);
+	static void		ClearCache(void);
+
+	const moWCString&	Expression(void) const;
+	moExpr::mo_expr_errno_t	CompileError(void) const;
+	bool			IsConstant(void) const;
+
+	unsigned long		InputCount(void) const;
+	const moWCString&	InputName(unsigned long index) const;
+	long			FindInput(const moWCString& name) const;
+
+	moExpr::mo_expr_errno_t	Evaluate(moExprValue& result, const moExprValue *inputs = 0, unsigned long count = 0) const;
+
+private:
+	// programs are shared through smart pointers, not copied
+				moExprProgram(const moExprProgram& program);
+	moExprProgram&		operator = (const moExprProgram& program);
+
+	const moWCString	f_expression;
+	moCode *		f_code;
+	mutable moMutex		f_mutex;
+};
+
+typedef moSmartPtr<moExprProgram>	moExprProgramSPtr;
+
+
+
 
 
 
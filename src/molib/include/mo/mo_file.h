@@ -36,6 +36,8 @@ namespace molib
 
 // we can accept FILE *f for the Accept function
 
+class MO_DLL_EXPORT moDirectoryWatcher;
+
 
 class MO_DLL_EXPORT moFile : public moIOStream
 {
@@ -102,6 +104,7 @@ public:
 	int			ClearError(void);
 	const moWCString&	WCFilename(void) const;
 	bool			Stat(struct stat& st) const;
+	int			FileDescriptor(void) const;
 
 	static moWCString	FindFile(const moWCString& path, const moWCString& filename, mo_access_t mode = MO_ACCESS_DEFAULT, const moWCString& separators = "");
 	static moWCString	FullPath(const moWCString& filename, bool real_path = false);
@@ -111,6 +114,11 @@ public:
 	static moWCString	TemporaryFilename(const moWCString& path, moWCString extension = ".tmp");
 	static bool		CopyFile(const moWCString& source, const moWCString& destination);
 
+	static void		SetFindFileCache(bool enable);
+	static void		SetFindFileWatcher(moDirectoryWatcher *watcher);
+	static void		InvalidateFindFileCache(const moWCString& directory = "");
+	static void		FindFileCacheCounters(unsigned long& hits, unsigned long& misses);
+
 protected:
 	virtual void		OnNewFD(int fd);
 
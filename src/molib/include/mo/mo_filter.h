@@ -0,0 +1,160 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+
+
+#ifndef MO_FILTER_H
+#define	MO_FILTER_H
+#ifdef MO_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#ifndef MO_FIFO_H
+#include	"mo_fifo.h"
+#endif
+
+
+namespace molib
+{
+
+
+// a set of same size buffers recycled between filter pipelines so
+// data can go through a pipeline without any per-chunk allocation
+class MO_DLL_EXPORT moFilterBufferPool : public moBase
+{
+public:
+	static const unsigned long	FILTER_BUFFER_SIZE_DEFAULT = 64 * 1024;
+	static const unsigned long	FILTER_BUFFER_KEEP_DEFAULT = 32;
+
+				moFilterBufferPool(unsigned long buffer_size = FILTER_BUFFER_SIZE_DEFAULT,
+						unsigned long keep = FILTER_BUFFER_KEEP_DEFAULT);
+	virtual			~moFilterBufferPool();
+
+	static moFilterBufferPool *	DefaultPool(void);
+
+	unsigned long		BufferSize(void) const;
+	unsigned char *		AcquireBuffer(void);
+	void			ReleaseBuffer(unsigned char *buffer);
+	unsigned long		Allocations(void) const;
+
+private:
+	struct buffer_t {
+		buffer_t *		f_next;
+	};
+
+				moFilterBufferPool(const moFilterBufferPool& pool);
+	moFilterBufferPool&	operator = (const moFilterBufferPool& pool);
+
+	mutable moMutex		f_mutex;
+	const unsigned long	f_buffer_size;
+	const unsigned long	f_keep;
+	unsigned long		f_free_count;
+	unsigned long		f_allocations;
+	buffer_t *		f_free;
+};
+
+typedef moSmartPtr<moFilterBufferPool>	moFilterBufferPoolSPtr;
+
+
+// one stage of a filter pipeline; it transforms a borrowed input
+// span into an output span owned by the caller
+class MO_DLL_EXPORT moFilterStage : public moBase
+{
+public:
+				moFilterStage(void);
+	virtual			~moFilterStage();
+
+	virtual int		Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size) = 0;
+	virtual int		Finish(void *output, unsigned long output_size);
+	virtual void		Reset(void);
+};
+
+typedef moSmartPtr<moFilterStage>	moFilterStageSPtr;
+
+
+// run an existing moFIFO filter (i.e. mowc::moIConv) as a stage
+class MO_DLL_EXPORT moFIFOFilterStage : public moFilterStage
+{
+public:
+				moFIFOFilterStage(moFIFO *fifo);
+	virtual			~moFIFOFilterStage();
+
+	virtual int		Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size);
+	virtual int		Finish(void *output, unsigned long output_size);
+	virtual void		Reset(void);
+
+	moFIFOSPtr		FIFO(void) const;
+
+private:
+	moFIFOSPtr		f_fifo;
+};
+
+
+// a chain of stages used as an moFIFO filter on a stream
+class MO_DLL_EXPORT moFilterPipeline : public moFIFO
+{
+public:
+				moFilterPipeline(moFilterBufferPool *pool = 0);
+	virtual			~moFilterPipeline();
+
+	bool			AddStage(moFilterStage *stage);
+	void			RemoveAllStages(void);
+	unsigned long		Count(void) const;
+	moFilterStageSPtr	GetStage(unsigned long index) const;
+	moFilterBufferPoolSPtr	Pool(void) const;
+
+	virtual void		Reset(void);
+	virtual unsigned long	MaxSize(void) const;
+	virtual unsigned long	Size(void) const;
+	virtual unsigned long	FreeSpace(void) const;
+
+	virtual bool		Flush(int64_t ustime = -1);
+	virtual int		Write(const void *buffer, unsigned long size);
+
+	virtual bool		WaitData(int64_t ustime = -1, unsigned long size = static_cast<unsigned long>(-1));
+	virtual int		Read(void *buffer, unsigned long size, bool peek = false);
+
+	bool			Finish(void);
+
+	void *			InputSpan(unsigned long& size);
+	void			CommitInput(unsigned long size);
+	const void *		OutputSpan(unsigned long& size);
+	void			ConsumeOutput(unsigned long size);
+
+private:
+	class moChain;
+
+				moFilterPipeline(const moFilterPipeline& pipeline);
+	moFilterPipeline&	operator = (const moFilterPipeline& pipeline);
+
+	moFilterBufferPoolSPtr	f_pool;
+	moChain *		f_chain;
+};
+
+typedef moSmartPtr<moFilterPipeline>	moFilterPipelineSPtr;
+
+
+
+
+};			// namespace molib;
+
+// vim: ts=8 sw=8
+#endif		// #ifndef MO_FILTER_H
+
@@ -32,6 +32,10 @@
 #include	"mo_string.h"
 #endif
 
+#ifndef MO_FILTER_H
+#include	"mo_filter.h"
+#endif
+
 namespace molib
 {
 
@@ -51,6 +55,10 @@ public:
 
 	static const unsigned long	GZIP_MODE_DEFAULT = GZIP_FILTER_DEFAULT | GZIP_LEVEL_MAX;
 
+	static const unsigned long	GZIP_THREADS_AUTO = 0;		// one per processor
+	static const size_t		GZIP_BLOCK_SIZE_MIN = 32 * 1024;
+	static const size_t		GZIP_BLOCK_SIZE_DEFAULT = 128 * 1024;
+
 	struct gzip_mode_t {
 					gzip_mode_t(void);
 					gzip_mode_t(unsigned long mode);
@@ -63,6 +71,18 @@ public:
 		unsigned long		f_mode;
 	};
 
+	struct gzip_statistics_t {
+					gzip_statistics_t(void);
+		double			Throughput(void) const;
+
+		unsigned long		f_threads;		// threads used to compress
+		unsigned long		f_blocks;		// blocks compressed in parallel mode
+		uint64_t		f_input_size;		// bytes written in the stream
+		uint64_t		f_output_size;		// bytes saved in the file
+		uint64_t		f_compress_usec;	// compression time of all the threads
+		uint64_t		f_elapsed_usec;		// time spent writing and closing
+	};
+
 				moGZip(void);
 				moGZip(const char *filename, gzip_mode_t mode = GZIP_MODE_DEFAULT, mowc::encoding_t encoding = mowc::MO_ENCODING_UTF8);
 				moGZip(const mowc::mc_t *filename, gzip_mode_t mode = GZIP_MODE_DEFAULT, mowc::encoding_t encoding = mowc::MO_ENCODING_UTF16_INTERNAL);
@@ -78,11 +98,26 @@ public:
 	bool			Open(const moWCString& filename, gzip_mode_t mode = GZIP_MODE_DEFAULT);
 	void			Close(void);
 
+	void			SetThreads(unsigned long threads);
+	unsigned long		Threads(void) const;
+	void			SetBlockSize(size_t size);
+	size_t			BlockSize(void) const;
+	const gzip_statistics_t& Statistics(void) const;
+
 private:
+	class moBlocks;
+
+				moGZip(const moGZip& gzip);
+	moGZip&			operator = (const moGZip& gzip);
+
 	void			Init(void);
 	virtual int		RawWrite(const void *buffer, size_t length);
 
 	gzFile			f_gz_file;
+	moBlocks *		f_blocks;
+	unsigned long		f_threads;
+	size_t			f_block_size;
+	gzip_statistics_t	f_statistics;
 };
 
 
@@ -91,6 +126,8 @@ private:
 class MO_DLL_EXPORT moGunZip : public moIStream
 {
 public:
+	static const size_t	GZIP_INDEX_SPAN_DEFAULT = 1024 * 1024;
+
 				moGunZip(void);
 				moGunZip(const char *filename, mowc::encoding_t encoding = mowc::MO_ENCODING_UTF8);
 				moGunZip(const mowc::mc_t *filename, mowc::encoding_t encoding = mowc::MO_ENCODING_UTF16_INTERNAL);
@@ -106,11 +143,75 @@ public:
 	bool			Open(const moWCString& filename);
 	void			Close(void);
 
+	bool			BuildIndex(size_t span = GZIP_INDEX_SPAN_DEFAULT);
+	bool			LoadIndex(const moWCString& filename);
+	bool			SaveIndex(const moWCString& filename) const;
+	bool			HasIndex(void) const;
+	bool			Seek(size_t position);
+
+	virtual	size_t		ReadPosition(void) const;
+	virtual	size_t		ReadPosition(size_t new_pos);
+	virtual size_t		InputSize(void) const;
+
 private:
+	class moIndex;
+
+				moGunZip(const moGunZip& gunzip);
+	moGunZip&		operator = (const moGunZip& gunzip);
+
 	void			Init(void);
 	virtual int		RawRead(void *buffer, size_t length);
 
 	gzFile			f_gz_file;
+	moIndex *		f_index;
+};
+
+
+
+// compress the data going through an moFilterPipeline
+class MO_DLL_EXPORT moGZipFilterStage : public moFilterStage
+{
+public:
+				moGZipFilterStage(moGZip::gzip_mode_t mode = moGZip::GZIP_MODE_DEFAULT);
+	virtual			~moGZipFilterStage();
+
+	virtual int		Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size);
+	virtual int		Finish(void *output, unsigned long output_size);
+	virtual void		Reset(void);
+
+private:
+				moGZipFilterStage(const moGZipFilterStage& stage);
+	moGZipFilterStage&	operator = (const moGZipFilterStage& stage);
+
+	bool			Init(void);
+
+	z_stream		f_stream;
+	moGZip::gzip_mode_t	f_mode;
+	bool			f_initialized;
+	bool			f_ended;
+};
+
+
+// uncompress the gzip (or zlib) data going through an moFilterPipeline
+class MO_DLL_EXPORT moGunZipFilterStage : public moFilterStage
+{
+public:
+				moGunZipFilterStage(void);
+	virtual			~moGunZipFilterStage();
+
+	virtual int		Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size);
+	virtual int		Finish(void *output, unsigned long output_size);
+	virtual void		Reset(void);
+
+private:
+				moGunZipFilterStage(const moGunZipFilterStage& stage);
+	moGunZipFilterStage&	operator = (const moGunZipFilterStage& stage);
+
+	z_stream		f_stream;
+	bool			f_initialized;
+	unsigned long		f_members;
+	bool			f_in_member;
+	bool			f_garbage;
 };
 
 
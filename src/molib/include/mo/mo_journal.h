@@ -0,0 +1,119 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+#ifndef MO_JOURNAL_H
+#define	MO_JOURNAL_H
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#ifndef MO_WCSTRING_H
+#include	"mo_string.h"
+#endif
+#ifndef MO_BUFFER_H
+#include	"mo_buffer.h"
+#endif
+#ifndef MO_MUTEX_H
+#include	"mo_mutex.h"
+#endif
+
+
+namespace molib
+{
+
+
+
+// an append-only write-ahead journal; records are written in
+// groups (group commit) and the data sync is batched so the
+// cost of the sync is shared between many records
+class MO_DLL_EXPORT moJournal : public moBase
+{
+public:
+	typedef uint64_t	sequence_t;
+
+	// derive from this class to replay the journal
+	class MO_DLL_EXPORT moReplayHandler
+	{
+	public:
+		virtual			~moReplayHandler() {}
+
+		// return false to stop the replay
+		virtual bool		Record(sequence_t sequence, const moBuffer& data) = 0;
+	};
+
+	struct stats_t
+	{
+		zuint64_t		f_records;		// records appended
+		zuint64_t		f_bytes;		// bytes written (including headers)
+		zuint64_t		f_commits;		// calls to write(2)
+		zuint64_t		f_syncs;		// calls to fdatasync(2)
+	};
+
+				moJournal(void);
+	virtual			~moJournal();
+
+	virtual const char *	moGetClassName(void) const;
+
+	bool			Open(const moWCString& filename);
+	void			Close(void);
+	bool			IsOpen(void) const { return f_fd != -1; }
+	const moWCString&	GetFilename(void) const { return f_filename; }
+
+	void			SetSyncInterval(int64_t usec);
+	void			SetGroupSize(unsigned long records);
+
+	sequence_t		Append(const moBuffer& data);
+	bool			Commit(bool sync = false);
+	bool			Sync(void);
+	bool			Replay(moReplayHandler& handler);
+	bool			Truncate(void);
+
+	sequence_t		GetLastSequence(void) const { return f_sequence; }
+	unsigned long		GetSize(void) const { return f_size; }
+	bool			HasUnsyncedData(void) const { return f_unsynced != 0; }
+	const stats_t&		GetStats(void) const { return f_stats; }
+
+private:
+	static int64_t		Now(void);
+	bool			WriteAll(const void *data, unsigned long size);
+
+	mutable moMutex		f_mutex;
+	moWCString		f_filename;
+	mint32_t		f_fd;
+	zuint64_t		f_sequence;		// last sequence number appended
+	zuint32_t		f_size;			// size of the journal on disk
+	moBuffer		f_pending;		// records waiting for Commit()
+	zuint32_t		f_pending_records;
+	zuint32_t		f_unsynced;		// records written but not yet synced
+	zint64_t		f_last_sync;
+	zint64_t		f_sync_interval;
+	zuint32_t		f_group_size;
+	stats_t			f_stats;
+};
+
+typedef moSmartPtr<moJournal>	moJournalSPtr;
+
+
+
+};			// namespace molib
+
+// vim: ts=8 sw=8
+#endif		// #ifndef MO_JOURNAL_H
@@ -0,0 +1,81 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+#ifndef MO_PATTERN_SET_H
+#define	MO_PATTERN_SET_H
+#ifdef MO_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#ifndef MO_REGEXPR_H
+#include	"mo_regexpr.h"
+#endif
+
+
+namespace molib
+{
+
+
+// a set of literals and regular expressions matched against a
+// subject in a single pass; the literals (and the literal each
+// regular expression requires) are compiled in one Aho-Corasick
+// automaton and only the regular expressions which found their
+// literal are run to confirm the match
+class MO_DLL_EXPORT moPatternSet : public moBase
+{
+public:
+	enum mo_pattern_t {
+		MO_PATTERN_LITERAL = 0,		// match the string as is
+		MO_PATTERN_REGEXPR		// an moRegularExpression
+	};
+
+				moPatternSet(void);
+	virtual			~moPatternSet();
+
+	int			Add(const moWCString& pattern, mo_pattern_t type = MO_PATTERN_REGEXPR);
+	void			Empty(void);
+	unsigned long		Count(void) const;
+
+	void			Scan(const moWCString& subject);
+	unsigned long		Match(const moWCString& subject);
+	bool			MayMatch(int index) const;
+	bool			Matched(int index);
+	int			GetStartPos(int index);
+	int			GetLastPos(int index);
+
+private:
+	class moAutomaton;
+
+				moPatternSet(const moPatternSet& set);
+	moPatternSet&		operator = (const moPatternSet& set);
+
+	moAutomaton *		f_automaton;
+};
+
+typedef moSmartPtr<moPatternSet>	moPatternSetSPtr;
+
+
+
+
+};			// namespace molib;
+
+// vim: ts=8 sw=8
+#endif		// #ifndef MO_PATTERN_SET_H
+
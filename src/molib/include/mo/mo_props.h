@@ -32,6 +32,9 @@
 #include	"mo_buffer.h"
 #endif
 
+#include	<atomic>
+#include	<vector>
+
 
 
 
@@ -130,6 +133,10 @@ public:
 		MO_PROP_TYPE_max	// end the enum
 	};
 
+	// every modification gets a new generation number; a bag
+	// generation is the generation of its latest modified child
+	typedef uint64_t	generation_t;
+
 				moProp(mo_name_t name);
 				moProp(const moProp& prop);
 	virtual			~moProp();
@@ -155,13 +162,39 @@ public:
 
 	void			Signal(void);
 
+	// dirty tracking (used by the moPropIO delta mode)
+	static generation_t	CurrentGeneration(void);
+	generation_t		GetGeneration(void) const { return f_generation; }
+	generation_t		GetRemovalGeneration(void) const { return f_removal_generation; }
+	void			Touch(bool removal = false);
+
+	// snapshots are frozen; they can be read without locks
+	// and any attempt to modify them throws
+	bool			IsFrozen(void) const { return f_frozen; }
+
 	// always sorted by name
 	virtual compare_t	Compare(const moBase& object) const;
 
 protected:
+	void			CheckWritable(void) const
+				{
+					if(f_frozen) {
+						ThrowFrozen();
+					}
+				}
+
 	mutable moMutex		f_mutex;
 
 private:
+	friend class moPropBag;
+	friend class moPropArray;
+	friend class moPropSignalBatch;
+
+	void			SetParent(moProp *parent);
+	void			ClearParent(const moProp *parent);
+	virtual void		Freeze(void);
+	void			ThrowFrozen(void) const;
+
 	class moHandler : public moBase
 	{
 	public:
@@ -187,11 +220,54 @@ private:
 	mutable moMutex		f_signal_mutex;		// we use this mutex to lock the property while signalling
 	bool			f_signal_list_changed;	// the same thread may change the list of signals while signalling
 	moListOfHandlers	f_handlers;
+
+	// the parent is not reference counted (it would create loops);
+	// the bag or array clears it when it releases this property
+	moProp *		f_parent;
+	std::atomic<generation_t> f_generation;
+	std::atomic<generation_t> f_removal_generation;
+	volatile bool		f_frozen;
 };
 
 //typedef moSmartPtr<moProp>	moPropSPtr; -- already declared
 
 
+// While a batch exists in a thread, the signals of the properties
+// modified by that thread are queued instead of being sent; each
+// (property, handler) pair is called once when the outermost batch
+// of that thread is destroyed (or Flush()'ed)
+class MO_DLL_EXPORT moPropSignalBatch
+{
+public:
+	struct stats_t {
+		zuint64_t		f_deferred;	// handler calls queued
+		zuint64_t		f_suppressed;	// queued calls dropped as duplicates
+		zuint64_t		f_delivered;	// queued calls sent at the end of a batch
+	};
+
+				moPropSignalBatch(void);
+				~moPropSignalBatch();
+
+	void			Flush(void);
+
+	static bool		IsActive(void);
+	static void		GetStats(stats_t& stats);
+	static void		ResetStats(void);
+
+private:
+	struct batch_t;
+	friend class moProp;
+
+	// no copies
+				moPropSignalBatch(const moPropSignalBatch& batch);
+	moPropSignalBatch&	operator = (const moPropSignalBatch& batch);
+
+	static batch_t&		Batch(void);
+	static bool		Defer(moProp *prop, moProp::moHandler *holder);
+	static void		Deliver(bool silent);
+};
+
+
 class MO_DLL_EXPORT moPropAutoLock
 {
 public:
@@ -243,27 +319,44 @@ public:
 	virtual prop_type_t	GetType(void) const { return MO_PROP_TYPE_PROP_BAG; }
 
 	unsigned long		Count(void) const { return f_props.Count(); }
-	void			Empty(void) { f_props.Empty(); }
+	void			Empty(void);
+	void			Merge(const moPropBag& bag, bool remove_missing = false);
 	void			Dump(unsigned int flags = DUMP_FLAG_RECURSIVE, const char *message = 0) const;
 
 	moPropSPtr		Get(int index_or_name) const;
 	bool			Set(int index_or_name, const moProp& prop, bool overwrite = true);
 	void			Delete(int index_or_name);
 
+	moSmartPtr<moPropBag>	Snapshot(void) const;
+	void			Pack(void);
+
 protected:
 	friend class moPropBagRef;
 				moPropBag(mo_name_t name);
 				moPropBag(const moPropBag& bag, bool recursive = false);
-	//virtual		~moPropBag(); -- no need
+	virtual			~moPropBag();
 
 private:
+	friend class moPropArray;
+
 	moPropBag&		operator = (const moPropBag& bag);
 
+	static moPropSPtr	MergeDuplicate(const moProp& prop);
+	static moPropSPtr	SnapshotDuplicate(const moProp& prop, const moProp *previous, generation_t previous_generation);
+
+	moPropSPtr		InternalGet(int index_or_name) const;
+	virtual void		Freeze(void);
+
 	void			DumpProps(unsigned int flags, unsigned int indent) const;
 	void			DumpProp(unsigned int flags, unsigned int indent, moPropSPtr prop) const;
 
 	typedef moTmplList<moProp, moSortedList>	moSortedListOfProps;
 	moSortedListOfProps	f_props;	// list of moProp *
+
+	// the last published snapshot; its generation is the
+	// generation of this bag at the time it was taken
+	mutable moMutex		f_snapshot_mutex;
+	mutable std::atomic<moPropBag *> f_snapshot;
 };
 
 typedef moSmartPtr<moPropBag>	moPropBagSPtr;
@@ -272,6 +365,37 @@ typedef moSmartPtr<moPropBag>	moPropBagSPtr;
 
 
 
+// used by the Copy() and Set() functions below so a property is not
+// marked as modified when it gets assigned the value it already has
+template<class T>
+inline bool moPropSameValue(T a, const T& b)
+{
+	// the controlled types only offer a non-const operator ==
+	return a == b;
+}
+
+inline bool moPropSameValue(const moWCString& a, const moWCString& b)
+{
+	return a.Compare(b) == moBase::MO_BASE_COMPARE_EQUAL;
+}
+
+inline bool moPropSameValue(const moBaseSPtr& a, const moBaseSPtr& b)
+{
+	return a == b;
+}
+
+inline bool moPropSameValue(const moBuffer& a, const moBuffer& b)
+{
+	void		*da, *db;
+	unsigned long	sa, sb;
+
+	a.Get(da, sa);
+	b.Get(db, sb);
+	return sa == sb && (sa == 0 || memcmp(da, db, sa) == 0);
+}
+
+
+
 // simple properties are integers, floating points, boolean, etc.
 // these don't require much at all
 template<class T, moProp::prop_type_t TYPE>
@@ -308,8 +432,22 @@ public:
 
 					moProp::Copy(prop);
 
+					CheckWritable();
 					const moPropSimple<T, TYPE>& simple = dynamic_cast<const moPropSimple<T, TYPE>&>(prop);
-					f_value = simple.f_value;
+					T value;
+					if(simple.IsFrozen()) {
+						value = simple.f_value;
+					}
+					else {
+						// the source may be getting modified
+						moLockMutex lock(simple.f_mutex);
+						value = simple.f_value;
+					}
+					moLockMutex lock(f_mutex);
+					if(!moPropSameValue(f_value, value)) {
+						f_value = value;
+						Touch();
+					}
 				}
 
 	virtual moPropSPtr	Duplicate(void) const
@@ -331,7 +469,14 @@ public:
 
 	void			Set(const T& value)
 				{
-					f_value = value;
+					CheckWritable();
+					{
+						moLockMutex lock(f_mutex);
+						if(!moPropSameValue(f_value, value)) {
+							f_value = value;
+							Touch();
+						}
+					}
 					Signal();
 				}
 
@@ -379,8 +524,21 @@ public:
 
 					moProp::Copy(prop);
 
+					CheckWritable();
 					const moPropObject<T, TYPE>& object = dynamic_cast<const moPropObject<T, TYPE>&>(prop);
-					f_value = object.f_value;
+					T value;
+					if(object.IsFrozen()) {
+						value = object.f_value;
+					}
+					else {
+						moLockMutex lock(object.f_mutex);
+						value = object.f_value;
+					}
+					moLockMutex lock(f_mutex);
+					if(!moPropSameValue(f_value, value)) {
+						f_value = value;
+						Touch();
+					}
 				}
 
 	virtual moPropSPtr	Duplicate(void) const
@@ -406,7 +564,15 @@ public:
 
 	void			Set(const T& value)
 				{
-					f_value = value;
+					CheckWritable();
+					{
+						// a snapshot may be copying this value
+						moLockMutex lock(f_mutex);
+						if(!moPropSameValue(f_value, value)) {
+							f_value = value;
+							Touch();
+						}
+					}
 					Signal();
 				}
 
@@ -444,6 +610,7 @@ public:
 	virtual moPropSPtr	Duplicate(void) const;
 
 	void			Empty(void);
+	void			Merge(const moPropArray& array, bool remove_missing = false);
 	moPropSPtr		Get(int item_no) const;
 	bool			Set(int item_no, const moProp *prop);
 	bool			Delete(int item_no);
@@ -454,29 +621,85 @@ public:
 	void			SetAtIndex(int index, const moProp *prop);
 	bool			DeleteAtIndex(int index);
 
+	void			Pack(void);
+	unsigned long		CountPacked(void) const;
+
 private:
-	class moItem : public moBase
+	virtual void		Freeze(void);
+	moPropSPtr		ItemProp(const moProp *prop) const;
+
+	// items of a simple type (int, long long, float and double)
+	// which nobody else references are kept as a packed value;
+	// the property object is only created when accessed
+	struct slot_t
 	{
-	public:
-					moItem(int item_no, const moProp *prop);
-		virtual			~moItem();
+					slot_t(void)
+						: f_item_no(0),
+						  f_name(0),
+						  f_type(MO_PROP_TYPE_UNKNOWN)
+					{
+						f_value.f_prop = 0;
+					}
+					slot_t(const slot_t& slot)
+						: f_item_no(slot.f_item_no),
+						  f_name(slot.f_name),
+						  f_value(slot.f_value),
+						  f_type(slot.f_type)
+					{
+						if(Prop() != 0) {
+							Prop()->AddRef();
+						}
+					}
+					~slot_t()
+					{
+						SetProp(0);
+					}
 
-		const char *		moGetClassName(void) const;
+		slot_t&			operator = (const slot_t& slot)
+					{
+						if(this != &slot) {
+							SetProp(slot.Prop());
+							f_item_no = slot.f_item_no;
+							f_name = slot.f_name;
+							f_value = slot.f_value;
+							f_type = slot.f_type;
+						}
+						return *this;
+					}
 
-		virtual compare_t	Compare(const moBase& object) const;
-		moItem&			operator = (const moItem& item);
-		int			GetItemNo(void) const;
-		moPropSPtr		Get(void) const;
+		bool			IsPacked(void) const { return f_type != MO_PROP_TYPE_UNKNOWN; }
+		moProp *		Prop(void) const { return IsPacked() ? 0 : f_value.f_prop; }
+		void			SetProp(moProp *prop)
+					{
+						if(prop != 0) {
+							prop->AddRef();
+						}
+						if(Prop() != 0) {
+							Prop()->Release();
+						}
+						f_value.f_prop = prop;
+						f_type = MO_PROP_TYPE_UNKNOWN;
+					}
 
-	private:
-		const int		f_item_no;
-		moPropSPtr		f_prop;
+		int32_t			f_item_no;
+		mo_name_t		f_name;
+		union {
+			moProp *	f_prop;		// when not packed
+			int32_t		f_int;
+			int64_t		f_long_long;
+			float		f_float;
+			double		f_double;
+		}			f_value;
+		unsigned char		f_type;		// MO_PROP_TYPE_UNKNOWN unless packed
 	};
+	typedef std::vector<slot_t>	slots_t;
 
-	typedef moSmartPtr<moItem>			moItemSPtr;
-	typedef moTmplList<moItem, moSortedList>	moSortedListOfItems;
+	slots_t::size_type	FindSlot(int item_no, bool& found) const;
+	moPropSPtr		SlotProp(slots_t::size_type pos) const;
+	bool			PackSlot(slot_t& slot) const;
 
-	moSortedListOfItems		f_array;
+	mutable slots_t			f_slots;
+	mutable slots_t::size_type	f_last_materialized;
 	const moProp::prop_type_t	f_type;
 };
 
@@ -560,6 +783,9 @@ public:
 	unsigned long		Count(void) const;
 	void			Dump(unsigned int flags = moPropBag::DUMP_FLAG_RECURSIVE, const char *message = 0) const;
 
+	// an immutable copy which can be read without locks
+	moPropBagRef		Snapshot(void) const;
+
 	moPropRef		Get(const moIndexOrName index_or_name) const;
 	moPropRef		operator [] (const moIndexOrName& index_or_name) const;
 
@@ -977,6 +1203,10 @@ public:
 
 	int			GetLastError(bool clear = true) const;
 
+	// when not zero, only properties modified after that generation are saved
+	void			SetDeltaGeneration(moProp::generation_t generation = 0);
+	moProp::generation_t	GetDeltaGeneration(void) const { return f_delta_generation; }
+
 	virtual const char *	moGetClassName(void) const;
 
 protected:
@@ -987,6 +1217,7 @@ protected:
 	moIStreamSPtr		f_input;
 	moOStreamSPtr		f_output;
 	zbool_t			f_save_pointers;
+	zuint64_t		f_delta_generation;
 
 private:
 	mutable int		f_errno;
@@ -0,0 +1,62 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+#ifndef MO_PROPS_BINARY_H
+#define	MO_PROPS_BINARY_H
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#ifndef MO_PROPS_H
+#include	"mo_props.h"
+#endif
+
+
+namespace molib
+{
+
+
+
+// a compact binary format for property bags; it is used where
+// the XML format is too slow or too large (i.e. journal records)
+class MO_DLL_EXPORT moPropIO_Binary : public moPropIO
+{
+public:
+				moPropIO_Binary(void);
+
+private:
+	virtual const char *	moGetClassName(void) const;
+
+	virtual int		InternalLoad(moPropBagRef& prop_bag);
+	virtual int		InternalSave(const moPropBagRef& prop_bag);
+};
+
+
+// helper functions to convert a property bag to and from a buffer
+MO_DLL_EXPORT_FUNC extern	int	moBinaryLoadPropBag(const moBuffer& buffer, moPropBagRef& prop_bag);
+MO_DLL_EXPORT_FUNC extern	int	moBinarySavePropBag(moBuffer& buffer, const moPropBagRef& prop_bag, moProp::generation_t delta_generation = 0);
+
+
+
+};			// namespace molib
+
+// vim: ts=8 sw=8
+#endif		// #ifndef MO_PROPS_BINARY_H
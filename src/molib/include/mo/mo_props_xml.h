@@ -46,6 +46,7 @@ public:
 		MO_XML_BINARY_MODE_UUENCODE = 0,	// this is the default (better compressed compatible with uuencode(1))
 		MO_XML_BINARY_MODE_HEX,			// 2 hex digits per character (humain readable, kinda)
 		MO_XML_BINARY_MODE_COMPACT,		// our own compression mode using all acceptable 8 bits XML characters (best compression, not compatible with anything)
+		MO_XML_BINARY_MODE_BASE64,		// RFC 4648 base64 (fastest, encoded while written)
 		MO_XML_BINARY_MODE_max
 	};
 
@@ -67,6 +68,39 @@ private:
 };
 
 
+// keeps an XML property bag file up to date writing only the
+// modified sub-bags in a sidecar which is compacted once in a while
+class MO_DLL_EXPORT moXMLPropBagFile : public moBase
+{
+public:
+				moXMLPropBagFile(const moWCString& filename);
+
+	virtual const char *	moGetClassName(void) const;
+
+	const moWCString&	GetFilename(void) const;
+	moWCString		GetDeltaFilename(void) const;
+	void			SetCompactInterval(int saves);
+
+	int			Load(moPropBagRef& prop_bag);
+	int			Save(const moPropBagRef& prop_bag);
+	int			Compact(const moPropBagRef& prop_bag);
+	int			DiscardDelta(void);
+
+private:
+	void			RecoverCompact(void);
+
+	const moWCString	f_filename;
+	moPropBagSPtr		f_bag;			// copy of the bag as saved
+	moPropBagSPtr		f_source;		// bag saved last when no copy is kept
+	zuint64_t		f_base_generation;	// generation of the last Compact()
+	zuint64_t		f_saved_generation;	// generation of the last Save()
+	zint32_t		f_delta_count;
+	zint32_t		f_compact_interval;
+};
+
+typedef moSmartPtr<moXMLPropBagFile>	moXMLPropBagFileSPtr;
+
+
 // helper functions to load & save property bags in XML
 MO_DLL_EXPORT_FUNC extern	int	moXMLLoadPropBag(const moWCString& filename, moPropBagRef& prop_bag);
 MO_DLL_EXPORT_FUNC extern	int	moXMLSavePropBag(const moWCString& filename, moPropBagRef& prop_bag, moPropIO_XML::binary_mode_t binary_mode = moPropIO_XML::MO_XML_BINARY_MODE_UUENCODE);
@@ -54,6 +54,11 @@ public:
 		MO_REGEXPR_ERROR_max
 	};
 
+	enum mo_regexpr_engine_t {
+		MO_REGEXPR_ENGINE_AUTO = 0,	// lazy DFA whenever the expression allows it
+		MO_REGEXPR_ENGINE_BACKTRACK	// always use the backtracking matcher
+	};
+
 				moRegularExpression(void);
 				moRegularExpression(const char *str, int length = -1, mowc::encoding_t encoding = mowc::MO_ENCODING_UTF8);
 				moRegularExpression(const mowc::mc_t *str, int length = -1, mowc::encoding_t encoding = mowc::MO_ENCODING_UTF16_INTERNAL);
@@ -75,8 +80,14 @@ public:
 	mo_regexpr_errno_t	LastError(void);
 	int			GetStartPos(void) const;
 	int			GetLastPos(void) const;
+	void			SetEngine(mo_regexpr_engine_t engine);
+	mo_regexpr_engine_t	GetEngine(void) const;
+	moWCString		RequiredLiteral(void);
 
 private:
+	class moDFA;
+	friend class moDFA;
+
 	enum mo_regexpr_t {
 		MO_REGEXPR_FREE = 0,	// a free node (usually unused)
 		MO_REGEXPR_LINK,	// just a node to link to other nodes
@@ -161,8 +172,13 @@ private:
 
 	zint32_t		f_start_pos;	// the position where the expression matched first
 	zint32_t		f_end_pos;	// the position where the expression matched last
+
+	mo_regexpr_engine_t	f_engine;	// which matcher MatchExpression() uses
+	moDFA *			f_dfa;		// the lazy DFA of the current nodes (built on first use)
 };
 
+typedef moSmartPtr<moRegularExpression>	moRegularExpressionSPtr;
+
 
 
 
@@ -144,11 +144,15 @@ public:
 
 		// For file actions
 		moFile			f_file;			// input or output file for R/W instructions
+
+		// Instruction following the label of a branch (set by Compile())
+		zint32_t		f_branch;
 	};
 	typedef moSmartPtr<moSedInstruction>		moSedInstructionSPtr;
 	typedef moTmplList<moSedInstruction, moList>	moListOfSedInstructions;
 
 				moSimpleEditor();
+	virtual			~moSimpleEditor();
 
 	int			SetInputEncoding(const char *encoding);
 	int			SetOutputEncoding(const char *encoding);
@@ -159,8 +163,17 @@ public:
 	void			Parse(const moWCString& input_filename, const moWCString& output_filename);
 	void			Parse(moIStream& input, moOStream& output);
 	void			Parse(moTextStream& text_stream);
+	void			ParseFiles(const moListOfWCStrings& input_filenames, const moListOfWCStrings& output_filenames);
 
 private:
+	class moCompiled;
+	class moSedStream;
+
+				moSimpleEditor(const moSimpleEditor& editor);
+	moSimpleEditor&		operator = (const moSimpleEditor& editor);
+
+	void			Compile(void);
+	void			Execute(moSedStream& stream);
 	void			StringToList(const moWCString& str, moListOfWCStrings& pattern, moWCString& line);
 	moWCString		ListToString(const moListOfWCStrings& list, const moWCString& line);
 	int			FindLabel(const moWCString& name);
@@ -168,6 +181,9 @@ private:
 	moListOfSedInstructions	f_instructions;
 	mowc::moIConv		f_input_convertor;
 	mowc::moIConv		f_output_convertor;
+	moWCString		f_input_encoding;	// as given to SetInputEncoding() (empty for UTF-8)
+	moWCString		f_output_encoding;
+	moCompiled *		f_compiled;
 };
 
 typedef moSmartPtr<moSimpleEditor>		moSimpleEditorSPtr;
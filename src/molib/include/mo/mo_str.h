@@ -151,6 +151,8 @@ MO_DLL_EXPORT_FUNC int		strlen(const wchar_t *s);
 
 MO_DLL_EXPORT_FUNC wc_t *		strchr(const wc_t *s, wc_t c);
 MO_DLL_EXPORT_FUNC wc_t *		strrchr(const wc_t *s, wc_t c);
+MO_DLL_EXPORT_FUNC wc_t *		memchr(const wc_t *s, wc_t c, size_t length);
+MO_DLL_EXPORT_FUNC wc_t *		strstr(const wc_t *s, const wc_t *needle);
 
 MO_DLL_EXPORT_FUNC wc_t		backslash_char(const wc_t *& s);
 MO_DLL_EXPORT_FUNC wc_t		backslash_char(wc_t *& s);
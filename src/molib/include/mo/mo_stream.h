@@ -34,6 +34,8 @@
 namespace molib
 {
 
+class moFilterPipeline;
+
 class MO_DLL_EXPORT moIStream : public virtual moBase
 {
 public:
@@ -103,6 +105,7 @@ protected:
 	mint32_t		f_input_endian;
 	zsize_t			f_input_position;
 	moFIFOSPtr		f_input_filter;
+	moFilterPipeline *	f_input_pipeline;	// f_input_filter when it is a pipeline
 	char *			f_input_filename;
 	zsize_t			f_input_unget_position;
 	unsigned char		f_input_unget[MAX_UNGET_SIZE];
@@ -163,6 +166,7 @@ public:
 
 	virtual int		SetOutputEndianess(int endian);
 	virtual moFIFOSPtr	SetOutputFilter(moFIFO *filter);
+	moFIFOSPtr		OutputFilter(void) const;
 
 	virtual int		Put(bool c);
 	virtual int		Put(signed char c);
@@ -197,6 +201,7 @@ protected:
 	mint32_t		f_output_endian;
 	zsize_t			f_output_position;
 	moFIFOSPtr		f_output_filter;
+	moFilterPipeline *	f_output_pipeline;	// f_output_filter when it is a pipeline
 	char *			f_output_filename;
 
 private:
@@ -206,6 +211,8 @@ private:
 					  f_output_endian(stream.f_output_endian)
 					{}
 	moOStream&		operator = (const moOStream& stream) { return *this; }
+
+	int			WritePipelineOutput(void);
 };
 
 typedef moSmartPtr<moOStream>	moOStreamSPtr;
@@ -230,6 +230,7 @@ public:
 	// test strings for matching patterns
 	// (see the moRegExpr for a full regular expression pattern matching)
 	bool			Glob(const moWCString& pattern) const;
+	bool			GlobLiterals(moWCString& prefix, moWCString& suffix) const;
 //#ifndef NO_MOSTRING_MATCH
 	bool			Match(const moWCString& pattern) const;
 //#endif
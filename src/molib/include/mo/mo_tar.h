@@ -157,10 +157,52 @@ protected:
 
 private:
 	void			Init(void);
+	bool			AppendDirParallel(const moTarHeader& header, const moDirectory& dir, const moWCString& root, unsigned long workers);
+	bool			WriteData(moIStream& input, size_t size);
+	bool			WritePadding(size_t size);
 
 	moOStreamSPtr		f_output;
 };
 
+// input (read) a tar file with random access to its members
+class MO_DLL_EXPORT moITar : public moTar
+{
+public:
+				moITar(void);
+				moITar(moIStream *input);
+	virtual			~moITar();
+
+	void			SetInput(moIStream *input);
+	bool			OpenFile(const moWCString& filename);
+	moIStreamSPtr		Input(void) const;
+
+	bool			ReadIndex(void);
+	bool			LoadIndex(const moWCString& filename);
+	bool			SaveIndex(const moWCString& filename) const;
+
+	unsigned long		Count(void) const;
+	long			Find(const moWCString& name) const;
+	const moWCString&	GetName(unsigned long index) const;
+	size_t			GetSize(unsigned long index) const;
+	bool			GetHeader(unsigned long index, moTarHeader& header) const;
+	moIStreamSPtr		OpenMember(unsigned long index) const;
+	const void *		MemberData(unsigned long index, size_t& size) const;
+
+	bool			Extract(unsigned long index, const moWCString& path) const;
+	bool			ExtractAll(const moWCString& path) const;
+
+private:
+	class moIndex;
+
+				moITar(const moITar& tar);
+	moITar&			operator = (const moITar& tar);
+
+	void			Init(void);
+
+	moIStreamSPtr		f_input;
+	moIndex *		f_index;
+};
+
 
 
 };			// namespace molib;
@@ -129,6 +129,7 @@ public:
 	virtual bool		IsRunning(void) const;
 	bool			Start(run_count_t run_count = RUN_COUNT_DEFAULT);
 	void			Stop(bool wait = false);
+	void			Wait(void) const;
 	bool			Continue(void) const;
 
 	void			AddDeathEventPipe(const moEventPipe& event_pipe);
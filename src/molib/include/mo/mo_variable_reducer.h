@@ -60,6 +60,7 @@ public:
 		virtual	unsigned long		MinimumParameterCount(void) const;
 		virtual	unsigned long		MaximumParameterCount(void) const;
 		virtual mo_vr_param_t		ParameterType(unsigned long index) const;
+		virtual bool			IsPure(void) const;
 
 	private:
 		virtual compare_t		Compare(const moBase& object) const;
@@ -68,6 +69,25 @@ public:
 	typedef moSmartPtr<moVariableReducerCommand> moVariableReducerCommandSPtr;
 	typedef moTmplList<moVariableReducerCommand, moSortedListUnique> moSortedListUniqueOfVariableReducerCommand;
 
+	class MO_DLL_EXPORT moTemplate : public moBase
+	{
+	public:
+					moTemplate(void);
+		virtual			~moTemplate();
+
+		void			Empty(void);
+		bool			IsEmpty(void) const;
+
+	private:
+		friend class moVariableReducer;
+		class moCompiled;
+
+					moTemplate(const moTemplate& tmpl);
+		moTemplate&		operator = (const moTemplate& tmpl);
+
+		moCompiled *		f_compiled;
+	};
+
 				moVariableReducer(void);
 	virtual			~moVariableReducer();
 
@@ -79,6 +99,10 @@ public:
 	bool			RegisterCommand(const moVariableReducerCommand& command);
 	bool			UnregisterCommand(const moVariableReducerCommand& command);
 	int			Command(const moWCString& command, const moListOfWCStrings& parameters, moWCString& result);
+	bool			IsPureCommand(const moWCString& command);
+
+	int			Compile(moTemplate& tmpl);
+	int			Expand(moTemplate& tmpl, moWCString& result);
 
 private:
 	void			Reducing(moWCString& result);
@@ -42,8 +42,11 @@ class MO_DLL_EXPORT moWords : public moList
 public:
 				moWords(void);
 				moWords(const moWCString& char_separators);
+				moWords(const moWords& words);
 	virtual			~moWords(void);
 
+	moWords&		operator = (const moWords& words);
+
 	void			CharSeparators(const moWCString& str);
 	void			StringSeparators(const moWCString& str);
 	void			ClearSeparators(void);
@@ -51,18 +54,27 @@ public:
 	void			AutoClip(bool status = true);
 	void			EmptyWords(bool status = true);
 	void			Quotes(const moWCString& str);
+	void			LazyWords(bool status = true);
 
+	virtual void		Empty(void);
 	virtual unsigned long	SetWords(const moWCString& words);
 	unsigned long		AddWords(const moWCString& words);
 
 	const moWCString&	AllWords(void) const;
 
+	unsigned long		WordCount(void) const;
+	unsigned long		WordOffset(int index) const;
+	unsigned long		WordLength(int index) const;
 	const moWCString&	Get(int index) const;
 	const moWCString&	operator [] (int index) const;
 
 private:
+	class moTokenizer;
+
 	void			Init(void);
 
+	moTokenizer *		f_tokenizer;
+	bool			f_lazy_words;
 	bool			f_auto_clip;
 	bool			f_empty_words;
 	moWCString		f_quotes;
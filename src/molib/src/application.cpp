@@ -372,6 +372,7 @@ void moApplication::DefineApplicationFilename()
  */
 void moApplication::SetRootPath(const moWCString& root_path)
 {
+	f_full_application_path.Empty();
 	if(root_path.IsEmpty()) {
 #if WIN32
 		f_root_path = "C:/";
@@ -466,6 +467,7 @@ const moWCString& moApplication::GetRootPath() const
 void moApplication::SetApplicationPath(const moWCString& application_path)
 {
 	f_application_path = application_path.FilenameClean();
+	f_full_application_path.Empty();
 }
 
 
@@ -475,12 +477,19 @@ void moApplication::SetApplicationPath(const moWCString& application_path)
  * data for the currently running instance. This is in general based
  * on the user and some other such parameters.
  *
+ * The result is computed once and kept until SetRootPath() or
+ * SetApplicationPath() gets called.
+ *
  * \return Returns a constant string reference to the application path.
  *
  * \sa SetApplicationPath
  */
-const moWCString moApplication::GetApplicationPath(bool docs)
+const moWCString& moApplication::GetApplicationPath(bool docs)
 {
+	if(!f_full_application_path.IsEmpty()) {
+		return f_full_application_path;
+	}
+
 	// TODO:
 	// should we automatically include the root path to the
 	// application path?! At this time, it is included only
@@ -544,10 +553,12 @@ const moWCString moApplication::GetApplicationPath(bool docs)
 
 #ifdef WIN32
 	// under MS we really cannot use a root path because of drive specifications
-	return f_application_path;
+	f_full_application_path = f_application_path;
 #else
-	return f_root_path.FilenameChild(f_application_path);
+	f_full_application_path = f_root_path.FilenameChild(f_application_path);
 #endif
+
+	return f_full_application_path;
 }
 
 
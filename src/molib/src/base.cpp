@@ -721,8 +721,13 @@ void *moBase::AllocObject(size_t size, bool array)
 	p->f_base  = 0;		// constructor not called yet
 	p->f_magic = MAGIC_VALUE;
 
+	// other threads may allocate objects before this one gets
+	// constructed so the list must be properly double linked
 	p->f_previous = 0;
 	p->f_next = g_new_buffers;
+	if(g_new_buffers != 0) {
+		g_new_buffers->f_previous = p;
+	}
 	g_new_buffers = p;
 
 	g_used++;
@@ -0,0 +1,597 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma implementation "mo/mo_base64.h"
+#endif
+
+#include	"mo/mo_base64.h"
+
+
+namespace molib
+{
+
+
+
+namespace
+{
+const char		g_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// any of these bits set means the character was not part of the alphabet
+const uint32_t		BASE64_INVALID = 0xFF000000;
+
+
+// The encoder converts 12 bits at a time with the pairs table and
+// the decoder converts 4 characters with 4 lookups and 3 ORs; the
+// result has one of the BASE64_INVALID bits set when one of the
+// characters is not a base64 digit (spaces, '=', garbage) in which
+// case the slow path handles the characters one by one
+struct base64_tables_t
+{
+	base64_tables_t(void)
+	{
+		int		i, j;
+
+		for(i = 0; i < 4096; ++i) {
+			f_pairs[i][0] = g_alphabet[i >> 6];
+			f_pairs[i][1] = g_alphabet[i & 0x3F];
+		}
+		for(j = 0; j < 4; ++j) {
+			for(i = 0; i < 256; ++i) {
+				f_decode[j][i] = BASE64_INVALID;
+			}
+			for(i = 0; i < 64; ++i) {
+				f_decode[j][static_cast<unsigned char>(g_alphabet[i])] = static_cast<uint32_t>(i) << (18 - j * 6);
+			}
+		}
+	}
+
+	char			f_pairs[4096][2];
+	uint32_t		f_decode[4][256];
+};
+
+const base64_tables_t& base64_tables(void)
+{
+	static const base64_tables_t tables;
+	return tables;
+}
+
+
+template<class C>
+inline unsigned char base64_index(C c)
+{
+	// wide characters out of the table are mapped to '\0' which is invalid
+	return static_cast<unsigned long>(c) < 256 ? static_cast<unsigned char>(c) : 0;
+}
+
+
+template<class C>
+inline bool base64_space(C c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+}		// no name namespace
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moBase64Encoder
+
+NAME
+
+	Constructor - initialize a base64 encoder
+	EncodedSize - compute the size of the encoded data
+	Reset - restart the encoder
+	Encode - encode a block of binary data
+	Finish - encode the last few bytes and padding
+
+SYNOPSIS
+
+	moBase64Encoder(unsigned long line_length = 76);
+	static unsigned long EncodedSize(unsigned long size, unsigned long line_length = 76);
+	void Reset(void);
+	unsigned long Encode(char *out, const void *in, unsigned long size);
+	unsigned long Finish(char *out);
+
+PARAMETERS
+
+	line_length - the number of characters per line, 0 for no new lines
+	size - the number of bytes to encode
+	out - the output buffer
+	in - the binary data to encode
+
+DESCRIPTION
+
+	The base64 encoder transforms binary data in ASCII as defined
+	in RFC 4648. Contrary to moUUEncode(), it writes to a plain
+	char buffer and it can be called any number of times with
+	consecutive blocks of the input so very large buffers can be
+	sent to a stream (or a file) without ever being encoded as a
+	whole.
+
+	The line length is rounded down to a multiple of 4. Each line
+	ends with a '\n'. Use 0 to get one long line.
+
+	The Encode() function encodes as many groups of 3 bytes as
+	possible. The 1 or 2 bytes which remain are kept until the
+	next call. The output buffer must be at least
+	EncodedSize(size + 2, line_length) characters.
+
+	The Finish() function encodes the remaining bytes with the
+	'=' padding and adds the last new line. The output buffer
+	must be at least 5 characters. The encoder is then ready to
+	encode another buffer.
+
+	The EncodedSize() function returns the exact number of
+	characters generated by encoding a buffer of size bytes
+	at once (Encode() + Finish().)
+
+RETURN VALUE
+
+	Encode() and Finish() return the number of characters written
+	in the output buffer
+
+	EncodedSize() returns the number of characters necessary to
+	encode a buffer of the specified size
+
+SEE ALSO
+
+	moBase64Decoder, moBase64Encode, moUUEncode
+
+*/
+moBase64Encoder::moBase64Encoder(unsigned long line_length)
+	: f_line_length(line_length & ~3UL),
+	  f_column(0),
+	  f_pending_size(0)
+{
+}
+
+
+unsigned long moBase64Encoder::EncodedSize(unsigned long size, unsigned long line_length)
+{
+	unsigned long	result;
+
+	line_length &= ~3UL;
+	result = (size + 2) / 3 * 4;
+	if(line_length != 0) {
+		result += (result + line_length - 1) / line_length;
+	}
+
+	return result;
+}
+
+
+void moBase64Encoder::Reset(void)
+{
+	f_column = 0;
+	f_pending_size = 0;
+}
+
+
+unsigned long moBase64Encoder::Encode(char *out, const void *in, unsigned long size)
+{
+	const base64_tables_t&	t = base64_tables();
+	const unsigned char	*s;
+	char			*d;
+	unsigned long		groups, room, n;
+	uint32_t		v;
+
+	s = static_cast<const unsigned char *>(in);
+	d = out;
+
+	// complete the group started by the previous call
+	if(f_pending_size > 0) {
+		unsigned char group[3];		/* Flawfinder: ignore */
+		memcpy(group, f_pending, f_pending_size);	/* Flawfinder: ignore */
+		while(f_pending_size < 3 && size > 0) {
+			group[f_pending_size] = *s++;
+			++f_pending_size;
+			--size;
+		}
+		if(f_pending_size < 3) {
+			memcpy(f_pending, group, f_pending_size);	/* Flawfinder: ignore */
+			return 0;
+		}
+		f_pending_size = 0;
+		d += Encode(d, group, 3);
+	}
+
+	while(size >= 3) {
+		groups = size / 3;
+		if(f_line_length != 0) {
+			room = (f_line_length - f_column) / 4;
+			if(groups > room) {
+				groups = room;
+			}
+		}
+		for(n = groups; n > 0; --n, s += 3, d += 4) {
+			v = (static_cast<uint32_t>(s[0]) << 16) | (static_cast<uint32_t>(s[1]) << 8) | s[2];
+			memcpy(d, t.f_pairs[v >> 12], 2);	/* Flawfinder: ignore */
+			memcpy(d + 2, t.f_pairs[v & 0xFFF], 2);	/* Flawfinder: ignore */
+		}
+		size -= groups * 3;
+		if(f_line_length != 0) {
+			f_column += groups * 4;
+			if(f_column >= f_line_length) {
+				*d++ = '\n';
+				f_column = 0;
+			}
+		}
+	}
+
+	// keep the last 1 or 2 bytes for the next call
+	memcpy(f_pending, s, size);	/* Flawfinder: ignore */
+	f_pending_size = size;
+
+	return static_cast<unsigned long>(d - out);
+}
+
+
+unsigned long moBase64Encoder::Finish(char *out)
+{
+	char		*d;
+	uint32_t	v;
+
+	d = out;
+	if(f_pending_size > 0) {
+		v = static_cast<uint32_t>(f_pending[0]) << 16;
+		if(f_pending_size == 2) {
+			v |= static_cast<uint32_t>(f_pending[1]) << 8;
+		}
+		d[0] = g_alphabet[v >> 18];
+		d[1] = g_alphabet[(v >> 12) & 0x3F];
+		d[2] = f_pending_size == 2 ? g_alphabet[(v >> 6) & 0x3F] : '=';
+		d[3] = '=';
+		d += 4;
+		f_column += 4;
+	}
+	if(f_line_length != 0 && f_column > 0) {
+		*d++ = '\n';
+	}
+
+	Reset();
+
+	return static_cast<unsigned long>(d - out);
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moBase64Decoder
+
+NAME
+
+	Constructor - initialize a base64 decoder
+	DecodedSize - compute the maximum size of the decoded data
+	Reset - restart the decoder
+	Decode - decode a block of base64 characters
+	Finish - decode the last characters
+
+SYNOPSIS
+
+	moBase64Decoder(void);
+	static unsigned long DecodedSize(unsigned long size);
+	void Reset(void);
+	long Decode(void *out, const char *in, unsigned long size);
+	long Decode(void *out, const mowc::wc_t *in, unsigned long size);
+	long Finish(void *out);
+
+	private:
+	template<class C>
+	long InternalDecode(unsigned char *out, const C *in, unsigned long size);
+
+PARAMETERS
+
+	size - the number of characters to decode
+	out - the output buffer
+	in - the base64 characters
+
+DESCRIPTION
+
+	The base64 decoder transforms the ASCII data generated by
+	the moBase64Encoder (or any RFC 4648 base64 encoder) back
+	into binary. It can be called any number of times with
+	consecutive blocks of the input. The input can be 8 bits
+	characters or wide characters (as found in an moWCString)
+	so XML data does not need to be converted first.
+
+	Spaces, tabs and new lines are ignored anywhere in the input.
+	The '=' padding is optional. Any other character is an error.
+
+	The Decode() function writes at most DecodedSize(size)
+	bytes in the output buffer.
+
+	The Finish() function writes the bytes of an unpadded last
+	group. The output buffer must be at least 2 bytes. The
+	decoder is then ready to decode another buffer.
+
+	The DecodedSize() function returns the maximum number of
+	bytes that decoding size characters can generate.
+
+RETURN VALUE
+
+	Decode() and Finish() return the number of bytes written
+	in the output buffer or -1 when the input is invalid
+
+	DecodedSize() returns the maximum size of the decoded data
+
+SEE ALSO
+
+	moBase64Encoder, moBase64Decode, moUUDecode
+
+*/
+moBase64Decoder::moBase64Decoder(void)
+	: f_quad(0),
+	  f_pending_size(0),
+	  f_padded(false)
+{
+}
+
+
+unsigned long moBase64Decoder::DecodedSize(unsigned long size)
+{
+	// +3 for the characters left by a previous call
+	return (size + 3) / 4 * 3 + 3;
+}
+
+
+void moBase64Decoder::Reset(void)
+{
+	f_quad = 0;
+	f_pending_size = 0;
+	f_padded = false;
+}
+
+
+long moBase64Decoder::Decode(void *out, const char *in, unsigned long size)
+{
+	return InternalDecode(static_cast<unsigned char *>(out), in, size);
+}
+
+
+long moBase64Decoder::Decode(void *out, const mowc::wc_t *in, unsigned long size)
+{
+	return InternalDecode(static_cast<unsigned char *>(out), in, size);
+}
+
+
+template<class C>
+long moBase64Decoder::InternalDecode(unsigned char *out, const C *in, unsigned long size)
+{
+	const base64_tables_t&	t = base64_tables();
+	const C			*end;
+	unsigned char		*d;
+	uint32_t		v;
+	C			c;
+
+	d = out;
+	end = in + size;
+	for(;;) {
+		if(f_pending_size == 0 && !f_padded) {
+			while(end - in >= 4) {
+				v = t.f_decode[0][base64_index(in[0])]
+				  | t.f_decode[1][base64_index(in[1])]
+				  | t.f_decode[2][base64_index(in[2])]
+				  | t.f_decode[3][base64_index(in[3])];
+				if((v & BASE64_INVALID) != 0) {
+					break;
+				}
+				d[0] = static_cast<unsigned char>(v >> 16);
+				d[1] = static_cast<unsigned char>(v >> 8);
+				d[2] = static_cast<unsigned char>(v);
+				d += 3;
+				in += 4;
+			}
+		}
+		if(in >= end) {
+			break;
+		}
+
+		// slow path, one character at a time
+		c = *in++;
+		if(base64_space(c)) {
+			continue;
+		}
+		if(c == '=') {
+			switch(f_pending_size) {
+			case 0:
+				if(!f_padded) {
+					return -1;
+				}
+				break;
+
+			case 2:
+				*d++ = static_cast<unsigned char>(f_quad >> 4);
+				break;
+
+			case 3:
+				*d++ = static_cast<unsigned char>(f_quad >> 10);
+				*d++ = static_cast<unsigned char>(f_quad >> 2);
+				break;
+
+			default:
+				return -1;
+
+			}
+			f_quad = 0;
+			f_pending_size = 0;
+			f_padded = true;
+			continue;
+		}
+		v = t.f_decode[3][base64_index(c)];
+		if(f_padded || (v & BASE64_INVALID) != 0) {
+			return -1;
+		}
+		f_quad = (f_quad << 6) | v;
+		++f_pending_size;
+		if(f_pending_size == 4) {
+			d[0] = static_cast<unsigned char>(f_quad >> 16);
+			d[1] = static_cast<unsigned char>(f_quad >> 8);
+			d[2] = static_cast<unsigned char>(f_quad);
+			d += 3;
+			f_quad = 0;
+			f_pending_size = 0;
+		}
+	}
+
+	return static_cast<long>(d - out);
+}
+
+
+long moBase64Decoder::Finish(void *out)
+{
+	unsigned char	*d;
+
+	d = static_cast<unsigned char *>(out);
+	switch(f_pending_size) {
+	case 0:
+		break;
+
+	case 2:
+		*d++ = static_cast<unsigned char>(f_quad >> 4);
+		break;
+
+	case 3:
+		*d++ = static_cast<unsigned char>(f_quad >> 10);
+		*d++ = static_cast<unsigned char>(f_quad >> 2);
+		break;
+
+	default:
+		Reset();
+		return -1;
+
+	}
+
+	Reset();
+
+	return static_cast<long>(d - static_cast<unsigned char *>(out));
+}
+
+
+
+
+/************************************************************ DOC:
+
+NAME
+
+	moBase64Encode - encode a buffer in base64
+	moBase64Decode - decode a base64 buffer or string
+
+SYNOPSIS
+
+	void moBase64Encode(moBuffer& out, const moBuffer& in, unsigned long line_length = 76);
+	bool moBase64Decode(moBuffer& out, const moBuffer& in);
+	bool moBase64Decode(moBuffer& out, const moWCString& in);
+
+PARAMETERS
+
+	out - the resulting buffer
+	in - the buffer or string to convert
+	line_length - the number of characters per line, 0 for no new lines
+
+DESCRIPTION
+
+	These functions encode or decode a whole buffer at once using
+	the moBase64Encoder and moBase64Decoder objects. The output
+	buffer is allocated once with the final (or maximum) size.
+
+RETURN VALUE
+
+	moBase64Decode() returns false when the input is not valid
+	base64 data; the output buffer is then empty
+
+SEE ALSO
+
+	moBase64Encoder, moBase64Decoder
+
+*/
+void moBase64Encode(moBuffer& out, const moBuffer& in, unsigned long line_length)
+{
+	moBase64Encoder	encoder(line_length);
+	void		*data;
+	char		*d;
+	unsigned long	size, sz;
+
+	in.Get(data, size);
+	out.SetSize(moBase64Encoder::EncodedSize(size, line_length));
+	d = static_cast<char *>(static_cast<void *>(out));
+	sz = encoder.Encode(d, data, size);
+	sz += encoder.Finish(d + sz);
+	out.SetSize(sz);
+}
+
+
+namespace
+{
+template<class C>
+bool base64_decode(moBuffer& out, const C *in, unsigned long size)
+{
+	moBase64Decoder	decoder;
+	unsigned char	*d;
+	long		sz, last;
+
+	out.SetSize(moBase64Decoder::DecodedSize(size));
+	d = static_cast<unsigned char *>(static_cast<void *>(out));
+	sz = decoder.Decode(d, in, size);
+	if(sz >= 0) {
+		last = decoder.Finish(d + sz);
+		if(last >= 0) {
+			out.SetSize(static_cast<unsigned long>(sz + last));
+			return true;
+		}
+	}
+	out.Empty();
+
+	return false;
+}
+}		// no name namespace
+
+
+bool moBase64Decode(moBuffer& out, const moBuffer& in)
+{
+	void		*data;
+	unsigned long	size;
+
+	in.Get(data, size);
+	return base64_decode(out, static_cast<const char *>(data), size);
+}
+
+
+bool moBase64Decode(moBuffer& out, const moWCString& in)
+{
+	return base64_decode(out, in.Data(), static_cast<unsigned long>(in.Length()));
+}
+
+
+
+
+}			// namespace molib;
+
+// vim: ts=8 sw=8
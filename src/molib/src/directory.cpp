@@ -25,6 +25,26 @@
 #include	"mo/mo_directory.h"
 #include 	"mo/mo_dirent.h"
 
+#ifndef MO_THREAD_H
+#include	"mo/mo_thread.h"
+#endif
+
+#include	<algorithm>
+#include	<chrono>
+#include	<string>
+#include	<thread>
+#include	<vector>
+
+#if defined(MO_LINUX) || defined(LINUX)
+#include	<fcntl.h>
+#include	<unistd.h>
+#include	<sys/syscall.h>
+#ifdef SYS_getdents64
+// read the directories with getdents64(2) instead of readdir(3)
+#define	MO_DIRECTORY_GETDENTS	1
+#endif
+#endif
+
 #ifdef _MSC_VER
 #   pragma warning(disable: 4996)
 #endif
@@ -34,6 +54,285 @@ namespace molib
 {
 
 
+namespace
+{
+
+// the literal characters a Glob() pattern starts and ends with,
+// in UTF-8 so the entries can be checked before their conversion
+struct mo_glob_literals_t
+{
+	std::string	f_prefix;
+	std::string	f_suffix;
+	bool		f_exact;	// the pattern has no special characters
+};
+
+
+void mo_glob_literals(const moWCString& pattern, mo_glob_literals_t& literals)
+{
+	moWCString		prefix, suffix;
+
+	literals.f_exact = pattern.GlobLiterals(prefix, suffix);
+	literals.f_prefix = prefix.SavedMBData();
+	literals.f_suffix = suffix.SavedMBData();
+}
+
+
+bool mo_glob_candidate(const char *name, const mo_glob_literals_t& literals)
+{
+	if(literals.f_exact) {
+		return literals.f_prefix == name;
+	}
+
+	const size_t length = strlen(name);
+	const size_t prefix = literals.f_prefix.length();
+	const size_t suffix = literals.f_suffix.length();
+	return length >= prefix + suffix
+		&& memcmp(name, literals.f_prefix.data(), prefix) == 0
+		&& memcmp(name + length - suffix, literals.f_suffix.data(), suffix) == 0;
+}
+
+
+#ifdef MO_DIRECTORY_GETDENTS
+// the kernel does not export this structure in a user header
+struct mo_dirent64_t
+{
+	uint64_t	d_ino;
+	int64_t		d_off;
+	unsigned short	d_reclen;
+	unsigned char	d_type;
+	char		d_name[1];
+};
+
+const size_t	DIR_GETDENTS_BUFFER_SIZE = 32 * 1024;
+#endif
+
+
+// transform the d_type of a directory entry in S_IFMT bits;
+// 0 when the file system does not tell us
+inline unsigned int mo_dirent_type(unsigned char type)
+{
+#if defined(DT_UNKNOWN) && defined(DTTOIF)
+	return DTTOIF(type);
+#else
+	return 0;
+#endif
+}
+
+
+// call callback(name, type) for each entry of the directory at path;
+// the type is 0 or the S_IFMT bits of the entry (not following links)
+template<class C>
+bool mo_read_entries(const char *path, C& callback)
+{
+#ifdef MO_DIRECTORY_GETDENTS
+	int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd < 0) {
+		return false;
+	}
+
+	// one system call returns hundreds of entries
+	union {
+		mo_dirent64_t	align;
+		char		data[DIR_GETDENTS_BUFFER_SIZE];
+	} buffer;
+	for(;;) {
+		long size = syscall(SYS_getdents64, fd, buffer.data, sizeof(buffer.data));
+		if(size <= 0) {
+			int e = errno;
+			close(fd);
+			errno = e;
+			return size == 0;
+		}
+		for(long pos = 0; pos < size;) {
+			const mo_dirent64_t *e = reinterpret_cast<const mo_dirent64_t *>(buffer.data + pos);
+			callback(e->d_name, mo_dirent_type(e->d_type));
+			pos += e->d_reclen;
+		}
+	}
+#else
+	DIR		*d;
+	struct dirent	*e;
+
+	d = opendir(path);
+	if(d == 0) {
+		return false;
+	}
+	errno = 0;
+	e = readdir(d);
+	while(e != 0) {
+#ifdef _DIRENT_HAVE_D_TYPE
+		callback(e->d_name, mo_dirent_type(e->d_type));
+#else
+		callback(e->d_name, 0);
+#endif
+		e = readdir(d);
+	}
+	int r = errno;
+	closedir(d);
+	errno = r;
+
+	return r == 0;
+#endif
+}
+
+
+// the entries of a directory which are always skipped and the
+// hidden entries unless requested
+inline bool mo_skip_entry(const char *name, bool hidden)
+{
+	return name[0] == '.'
+		&& (!hidden || name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+
+// scan directory trees, the sub-directories found are pushed back
+// in the list of jobs so all the runners can work on the same tree
+class dir_scan_runner : public moThread::moRunner
+{
+public:
+	struct job_t {
+		moWCString			path;		// directory to read
+		unsigned long			flags;		// flags with the re-entry counter of that directory
+	};
+
+	struct batch_t {
+		const moDirectory *		dir;		// the entries present before the scan
+		bool				(moDirectory::*contains)(const moDirectory::moEntry& entry) const;
+		moMutex				mutex;		// protects all the following fields
+		std::vector<job_t>		jobs;
+		unsigned long			busy;		// jobs being read
+		int				pending;	// runners still running
+		bool				failed;
+	};
+
+				dir_scan_runner(batch_t& batch)
+					: f_batch(batch)
+				{
+				}
+
+				~dir_scan_runner()
+				{
+					for(size_t idx = 0; idx < f_entries.size(); ++idx) {
+						f_entries[idx]->Release();
+					}
+				}
+
+	virtual bool		Run(void)
+				{
+					std::vector<job_t>	children;
+					job_t			job;
+					bool			found, result;
+
+					for(;;) {
+						{
+							moLockMutex lock(f_batch.mutex);
+							found = !f_batch.jobs.empty();
+							if(found) {
+								job = f_batch.jobs.back();
+								f_batch.jobs.pop_back();
+								++f_batch.busy;
+							}
+							else if(f_batch.busy == 0) {
+								// no more jobs and none can be added
+								break;
+							}
+						}
+						if(!found) {
+							// wait for a busy runner to find more
+							// sub-directories (note: a moMutex
+							// supports a single waiter)
+							std::this_thread::sleep_for(std::chrono::microseconds(200));
+							continue;
+						}
+
+						children.clear();
+						try {
+							result = Scan(job, children);
+						}
+						catch(...) {
+							result = false;
+						}
+
+						moLockMutex lock(f_batch.mutex);
+						f_batch.jobs.insert(f_batch.jobs.end(), children.begin(), children.end());
+						--f_batch.busy;
+						if(!result) {
+							f_batch.failed = true;
+						}
+					}
+
+					moLockMutex lock(f_batch.mutex);
+					--f_batch.pending;
+					f_batch.mutex.Signal();
+					return true;
+				}
+
+	// the entries found, each with one reference
+	std::vector<moDirectory::moEntry *>	f_entries;
+
+private:
+	struct scan_t {
+		dir_scan_runner *		runner;
+		const job_t *			job;
+		std::vector<job_t> *		children;
+		bool				hidden;
+		bool				too_many_subdir;
+		bool				result;
+
+		void			operator () (const char *name, unsigned int type)
+					{
+						if(mo_skip_entry(name, hidden)) {
+							return;
+						}
+						moDirectory::moEntry *entry = new moDirectory::moEntry(job->path, moWCString(name, -1, mowc::MO_ENCODING_UTF8), type);
+						entry->AddRef();
+						runner->f_entries.push_back(entry);
+						if(type == 0) {
+							// the file system did not tell us
+							struct stat st;
+							if(entry->LStat(&st)) {
+								type = st.st_mode & S_IFMT;
+							}
+						}
+						if(S_ISDIR(type) && !(runner->f_batch.dir->*runner->f_batch.contains)(*entry)) {
+							// NOTE: we are testing the re-entry counter
+							//	 here since in the lowest accepted
+							//	 level there may be only regular files!
+							if(too_many_subdir) {
+								result = false;
+								return;
+							}
+							job_t child;
+							child.path = *entry;
+							child.flags = job->flags + moDirectory::DIR_INCR_REENTRY;
+							children->push_back(child);
+						}
+					}
+	};
+
+	bool			Scan(const job_t& job, std::vector<job_t>& children)
+				{
+					scan_t scan;
+					scan.runner = this;
+					scan.job = &job;
+					scan.children = &children;
+					scan.hidden = (job.flags & moDirectory::DIR_FLAG_HIDDEN) != 0;
+					scan.too_many_subdir = (job.flags & moDirectory::DIR_MASK_REENTRY) == moDirectory::DIR_MAX_REENTRY;
+					scan.result = true;
+					if(!mo_read_entries(job.path.SavedMBData(), scan)) {
+						return false;
+					}
+					return scan.result;
+				}
+
+	batch_t&		f_batch;
+};
+
+
+}		// no name namespace
+
+
+
 /** \class moDirectory
  *
  * \brief Read a directory with support of Unix like patterns.
@@ -55,6 +354,7 @@ namespace molib
  * \sa moDirectory::ReadExpand(const moWCString& path, unsigned long flags)
  */
 moDirectory::moDirectory(void)
+	: f_threads(DIR_THREADS_AUTO)
 {
 }
 
@@ -72,6 +372,7 @@ moDirectory::moDirectory(void)
  * \sa moDirectory::ReadExpand(const moWCString& path, unsigned long flags)
  */
 moDirectory::moDirectory(const moWCString& path, unsigned long flags)
+	: f_threads(DIR_THREADS_AUTO)
 {
 	Read(path, flags);
 }
@@ -133,9 +434,11 @@ bool moDirectory::ReadExpand(const moWCString& path, unsigned long flags)
  * are directory. If so, then all the files within are read and included
  * in the moDirectory list.
  *
+ * The sub-directories are read by a pool of threads when available
+ * (see SetThreads()).
+ *
  * \bug
- * Note that the recursivity is limited to 50 levels because it uses the
- * processor stack.
+ * Note that the recursivity is limited to 50 levels.
  */
 
 
@@ -196,8 +499,12 @@ bool moDirectory::ReadExpand(const moWCString& path, unsigned long flags)
  * will not appear in the resulting list unless you call Empty()
  * before you call Read() or ReadExpand().
  * 
- * The RECURSIVE flag uses the stack and thus it should be
- * used with caution. Only 50 levels of sub-directories will
+ * The sub-directories found with the RECURSIVE flag are all
+ * read first (in parallel when threads are available, see
+ * SetThreads()) and the entries are inserted in the list at
+ * once. The type of the entries is taken from the directory
+ * when the file system offers it so no stat(2) is necessary
+ * to find the sub-directories. Only 50 levels of sub-directories will
  * be read. If there are more levels, it is ignored, but the
  * function returns false since it will have failed to read
  * all the possible files.
@@ -239,9 +546,8 @@ bool moDirectory::Read(const moWCString& path, unsigned long flags)
 	moWCString		name, pattern, prefix;
 	moEntrySPtr		entry;
 	moListOfEntries		list;
-	bool			result, too_many_subdir;
+	bool			result;
 	unsigned long		cnt;
-	struct stat		st;
 
 	list += *new moEntry("", "");	// start with an empty entry
 	result = true;
@@ -300,52 +606,35 @@ bool moDirectory::Read(const moWCString& path, unsigned long flags)
 
 done:
 	// now we can move the resulting list of files to our
-	// directory list
+	// directory list; the entries which already exist are
+	// dropped and the others are left in entries
+	std::vector<moEntry *> entries;
 	cnt = list.Count();
-	while(cnt > 0) {
-		cnt--;
-		entry = list.Get(cnt);
-		if(!Insert(entry)) {
-			// we didn't get it inserted because it already
-			// exists in the list! so get rid of it.
-			//delete entry; -- auto-released
-
-			// we've got to remove it from the list object
-			// so we can go through it again as shown below
-			// (NOTE: directories which will be read recursively
-			// are also included in this moDirectory object)
-			list.Delete(cnt);
-		}
+	entries.reserve(cnt);
+	for(unsigned long idx = 0; idx < cnt; ++idx) {
+		entry = list.Get(idx);
+		entry->AddRef();
+		entries.push_back(entry);
 	}
-
-	// entries left in the list were inserted in the moDirectory and
-	// thus we need to check them for directories in case the RECURSIVE
-	// flag is ON
+	entry = 0;
+	list.Empty();
+	cnt = entries.empty() ? 0 : Merge(&entries[0], static_cast<unsigned long>(entries.size()));
+
+	// entries left were inserted in the moDirectory and thus we need
+	// to check them for directories in case the RECURSIVE flag is ON
+	// (NOTE: directories which will be read recursively are also
+	// included in this moDirectory object)
 	if((flags & DIR_FLAG_RECURSIVE) != 0) {
-		// read hidden files in sub-directories?
-		if((flags & DIR_FLAG_HIDDEN_CHILDREN) != 0) {
-			flags |= DIR_FLAG_HIDDEN;
-		}
-		too_many_subdir = (flags & DIR_MASK_REENTRY) == DIR_MAX_REENTRY;
-		flags += DIR_INCR_REENTRY;
-		cnt = list.Count();
-		while(cnt > 0) {
-			cnt--;
-			entry = list.Get(cnt);
-			if(entry->LStat(&st) && S_ISDIR(st.st_mode)) {
-				// NOTE: we are testing the re-entry counter
-				//	 here since in the lowest accepted
-				//	 level there may be only regular files!
-				// too many sub-directories?
-				if(too_many_subdir) {
-					result = false;
-					break;
-				}
-				if(!Read(entry->FilenameChild("*"), flags)) {
-					result = false;
-				}
+		std::vector<moEntry *> roots;
+		for(unsigned long idx = 0; idx < cnt; ++idx) {
+			// like lstat(2), do not follow soft links
+			if(!entries[idx]->IsLnk() && entries[idx]->IsDir()) {
+				roots.push_back(entries[idx]);
 			}
 		}
+		if(!roots.empty() && !ReadTree(&roots[0], static_cast<unsigned long>(roots.size()), flags)) {
+			result = false;
+		}
 	}
 
 	return result;
@@ -373,12 +662,29 @@ done:
  */
 bool moDirectory::ReadDir(const moWCString& path, const moWCString& pattern, unsigned long flags, moList& list)
 {
+	// always skip "." and "..", they are not really useful;
+	// skip Unix hidden files (files starting with '.')
+	// unless the user requested them
+	struct match_t {
+		const moWCString *	path;
+		const moWCString *	pattern;
+		moList *		list;
+		mo_glob_literals_t	literals;
+		bool			hidden;
+
+		void			operator () (const char *name, unsigned int type)
+					{
+						if(!mo_skip_entry(name, hidden)
+						&& mo_glob_candidate(name, literals)) {
+							moWCString n(name, -1, mowc::MO_ENCODING_UTF8);
+							// matching the user specified pattern?
+							if(n.Glob(*pattern)) {
+								*list += *new moEntry(*path, n, type);
+							}
+						}
+					}
+	};
 	const char	*p;
-	DIR		*d;
-	struct dirent	*e;
-	bool		hidden;
-
-	hidden = (flags & DIR_FLAG_HIDDEN) != 0;
 
 	// here, empty strings are taken as the current
 	// directory (which happens in a pattern such
@@ -388,31 +694,254 @@ bool moDirectory::ReadDir(const moWCString& path, const moWCString& pattern, uns
 		p = ".";
 	}
 
-	d = opendir(p);
-	if(d == 0) {
+	match_t match;
+	match.path = &path;
+	match.pattern = &pattern;
+	match.list = &list;
+	match.hidden = (flags & DIR_FLAG_HIDDEN) != 0;
+
+	// names which cannot match are skipped before being converted
+	mo_glob_literals(pattern, match.literals);
+
+	return mo_read_entries(p, match);
+}
+
+
+
+/** \brief Read directory trees.
+ *
+ * This internal function reads all the directories defined in \p roots
+ * and their sub-directories. The sub-directories are added to a list of
+ * jobs shared by a set of runners so large trees get read in parallel.
+ *
+ * Each runner keeps the entries it found in its own vector. Once all the
+ * directories were read, the entries are sorted and merged in this
+ * moDirectory at once (instead of one Insert() per entry.)
+ *
+ * The sub-directories of a directory which was already present in this
+ * moDirectory object are not read.
+ *
+ * \param[in] roots The directories to read, they are already part of this list.
+ * \param[in] count The number of roots.
+ * \param[in] flags The flags as passed to Read().
+ *
+ * \return true if no error occurs; false otherwise.
+ */
+bool moDirectory::ReadTree(moEntry * const *roots, unsigned long count, unsigned long flags)
+{
+	dir_scan_runner::batch_t	batch;
+	unsigned long			idx, workers;
+	bool				too_many_subdir;
+
+	// read hidden files in sub-directories?
+	if((flags & DIR_FLAG_HIDDEN_CHILDREN) != 0) {
+		flags |= DIR_FLAG_HIDDEN;
+	}
+	too_many_subdir = (flags & DIR_MASK_REENTRY) == DIR_MAX_REENTRY;
+	if(too_many_subdir) {
 		return false;
 	}
 
-	errno = 0;
-	e = readdir(d);
-	while(e != 0) {
-		// always skip "." and "..", they are not really useful;
-		// skip Unix hidden files (files starting with '.')
-		// unless the user requested them
-		if(strcmp(e->d_name, ".") != 0
-		&& strcmp(e->d_name, "..") != 0
-		&& (hidden || e->d_name[0] != '.')) {
-			moWCString name(e->d_name, -1, mowc::MO_ENCODING_UTF8);
-			// matching the user specified pattern?
-			if(name.Glob(pattern)) {
-				list += *new moEntry(path, name);
+	batch.dir = this;
+	batch.contains = &moDirectory::Contains;
+	batch.busy = 0;
+	batch.failed = false;
+	for(idx = 0; idx < count; ++idx) {
+		dir_scan_runner::job_t job;
+		job.path = *roots[idx];
+		job.flags = flags + DIR_INCR_REENTRY;
+		batch.jobs.push_back(job);
+	}
+
+	workers = f_threads == DIR_THREADS_AUTO ? std::thread::hardware_concurrency() : f_threads;
+	if(!moThread::ThreadingAvailable() || workers < 2) {
+		workers = 1;
+	}
+	batch.pending = static_cast<int>(workers);
+
+	// the calling thread is one of the runners
+	std::vector<moSmartPtr<dir_scan_runner> > runners;
+	std::vector<moThreadSPtr> threads;
+	for(idx = 0; idx < workers; ++idx) {
+		runners.push_back(new dir_scan_runner(batch));
+	}
+	for(idx = 1; idx < workers; ++idx) {
+		moThreadSPtr thread(new moThread("moDirectory", runners[idx]));
+		if(thread->Start()) {
+			threads.push_back(thread);
+		}
+		else {
+			// this runner will never run
+			moLockMutex lock(batch.mutex);
+			--batch.pending;
+		}
+	}
+	runners[0]->Run();
+	{
+		moLockMutex lock(batch.mutex);
+		while(batch.pending > 0) {
+			batch.mutex.Wait();
+		}
+	}
+	// let the threads finish their cleanup before
+	// the runners get released
+	for(idx = 0; idx < threads.size(); ++idx) {
+		threads[idx]->Wait();
+	}
+
+	// gather all the entries and insert them at once
+	std::vector<moEntry *> entries;
+	size_t total = 0;
+	for(idx = 0; idx < workers; ++idx) {
+		total += runners[idx]->f_entries.size();
+	}
+	entries.reserve(total);
+	for(idx = 0; idx < workers; ++idx) {
+		entries.insert(entries.end(), runners[idx]->f_entries.begin(), runners[idx]->f_entries.end());
+		runners[idx]->f_entries.clear();
+	}
+	if(!entries.empty()) {
+		Merge(&entries[0], static_cast<unsigned long>(entries.size()));
+	}
+
+	return !batch.failed;
+}
+
+
+
+/** \brief Check whether an entry is part of this directory.
+ *
+ * This function searches the list for \p entry. Contrary to the
+ * Find() function, it does not modify any cache so it can be called
+ * by multiple threads as long as the list is not modified.
+ *
+ * \param[in] entry The entry to search.
+ *
+ * \return true if the entry is in the list.
+ */
+bool moDirectory::Contains(const moEntry& entry) const
+{
+	unsigned long		i, j, p;
+	compare_t		r;
+
+	i = 0;
+	j = f_count;
+	while(i < j) {
+		p = i + (j - i) / 2;
+		r = f_order_function == 0 ? f_data[p]->Compare(entry) : (f_data[p]->*f_order_function)(entry);
+		if(r == MO_BASE_COMPARE_EQUAL) {
+			return true;
+		}
+		if(r == MO_BASE_COMPARE_SMALLER) {
+			i = p + 1;
+		}
+		else {
+			j = p;
+		}
+	}
+
+	return false;
+}
+
+
+
+/** \brief Insert a set of entries at once.
+ *
+ * This function sorts the \p entries and merges them with the
+ * entries already present in this list. This is much faster than
+ * calling Insert() for each entry when many entries are added.
+ *
+ * Each one of the entries must come with one reference which is
+ * given to the list. The entries which already exist in the list
+ * (or are duplicated in \p entries) are released. On return, the
+ * first entries of the \p entries array are the ones which were
+ * inserted, in order.
+ *
+ * \param[in,out] entries The entries to insert.
+ * \param[in] count The number of entries.
+ *
+ * \return The number of entries which were inserted.
+ */
+unsigned long moDirectory::Merge(moEntry **entries, unsigned long count)
+{
+	compare_function_t	order;
+	unsigned long		idx, inserted, pos, old_count;
+
+	order = f_order_function;
+	std::stable_sort(entries, entries + count,
+		[order](const moEntry *a, const moEntry *b)
+		{
+			return (order == 0 ? a->Compare(*b) : (a->*order)(*b)) == MO_BASE_COMPARE_SMALLER;
+		});
+
+	// the new list is built in a separate array and then copied
+	// back since the old entries get interleaved
+	old_count = f_count;
+	std::vector<moBase *> merged;
+	merged.reserve(old_count + count);
+	inserted = 0;
+	pos = 0;
+	for(idx = 0; idx < count; ++idx) {
+		moEntry *entry = entries[idx];
+		compare_t r = MO_BASE_COMPARE_GREATER;
+		while(pos < old_count) {
+			r = order == 0 ? f_data[pos]->Compare(*entry) : (f_data[pos]->*order)(*entry);
+			if(r != MO_BASE_COMPARE_SMALLER) {
+				break;
 			}
+			merged.push_back(f_data[pos]);
+			++pos;
 		}
-		e = readdir(d);
+		if((pos < old_count && r == MO_BASE_COMPARE_EQUAL)
+		|| (inserted > 0 && (order == 0 ? entries[inserted - 1]->Compare(*entry) : (entries[inserted - 1]->*order)(*entry)) == MO_BASE_COMPARE_EQUAL)) {
+			// already present
+			entry->Release();
+			continue;
+		}
+		merged.push_back(entry);
+		entries[inserted] = entry;
+		++inserted;
 	}
-	closedir(d);
+	if(inserted == 0) {
+		return 0;
+	}
+	merged.insert(merged.end(), f_data + pos, f_data + old_count);
+
+	SetArraySize(static_cast<unsigned long>(merged.size()));
+	memcpy(f_data, &merged[0], merged.size() * sizeof(moBase *));	/* Flawfinder: ignore */
+	f_count = static_cast<unsigned long>(merged.size());
+	f_last_found = NO_POSITION;
 
-	return errno == 0;
+	return inserted;
+}
+
+
+
+/** \brief Define the number of threads used to read directory trees.
+ *
+ * When the RECURSIVE flag is used, the sub-directories are read by
+ * this number of threads (the calling thread included.) The default,
+ * DIR_THREADS_AUTO, uses one thread per processor. Use 1 to read the
+ * directories in the calling thread only.
+ *
+ * When threads are not available, the directories are always read
+ * by the calling thread.
+ *
+ * \param[in] threads The number of threads or DIR_THREADS_AUTO.
+ */
+void moDirectory::SetThreads(unsigned long threads)
+{
+	f_threads = threads;
+}
+
+
+/** \brief Get the number of threads used to read directory trees.
+ *
+ * \return The number of threads as defined with SetThreads().
+ */
+unsigned long moDirectory::Threads(void) const
+{
+	return f_threads;
 }
 
 
@@ -537,13 +1066,14 @@ NAME
 
 SYNOPSIS
 
-	moEntry(const moWCString& path, const char *name);
+	moEntry(const moWCString& path, const moWCString& name, unsigned int type = 0);
 	moEntry(const moEntry& entry);
 
 PARAMETER
 
 	path - the path where the file was found
 	name - the new filename in UTF-8
+	type - the S_IFMT bits of the file as found in the directory or 0
 	entry - an entry to duplicate
 
 DESCRIPTION
@@ -551,14 +1081,18 @@ DESCRIPTION
 	This function initializes a new directory entry or duplicates
 	and existing entry.
 
+	When the type of the file is known, the IsDir() and similar
+	functions do not need to call stat(2).
+
 SEE ALSO
 
 	Read
 
 */
-moDirectory::moEntry::moEntry(const moWCString& path, const moWCString& name)
+moDirectory::moEntry::moEntry(const moWCString& path, const moWCString& name, unsigned int type)
 	: moWCString(path.FilenameChild(name))
 {
+	f_type = type;
 	f_stat_defined = false;
 	f_lstat_defined = false;
 }
@@ -568,6 +1102,7 @@ moDirectory::moEntry::moEntry(const moWCString& path, const moWCString& name)
 moDirectory::moEntry::moEntry(const moEntry& entry)
 	: moWCString(entry)
 {
+	f_type = entry.f_type;
 	f_stat_defined = entry.f_stat_defined;
 	f_stat = entry.f_stat;
 	f_lstat_defined = entry.f_lstat_defined;
@@ -784,6 +1319,9 @@ DESCRIPTION
 	These functions returns true whenever the type corresponds
 	to the name of the function.
 
+	When the directory gave us the type of the file, it is used
+	as is (except to follow a link) and stat(2) is not called.
+
 RETURNED VALUE
 
 	true whenever the test succeeds
@@ -795,40 +1333,22 @@ SEE ALSO
 */
 bool moDirectory::moEntry::IsReg(void) const
 {
-	struct stat	st;
-
-	if(!Stat(&st)) {
-		// file deleted since or added by the end
-		return false;
-	}
-
-	return S_ISREG(st.st_mode);
+	// 0 when the file was deleted since or added by the end
+	return S_ISREG(FileType(true));
 }
 
 
 bool moDirectory::moEntry::IsDir(void) const
 {
-	struct stat	st;
-
-	if(!Stat(&st)) {
-		// file deleted since or added by the end
-		return false;
-	}
-
-	return S_ISDIR(st.st_mode);
+	// 0 when the file was deleted since or added by the end
+	return S_ISDIR(FileType(true));
 }
 
 
 bool moDirectory::moEntry::IsChr(void) const
 {
-	struct stat	st;
-
-	if(!Stat(&st)) {
-		// file deleted since or added by the end
-		return false;
-	}
-
-	return S_ISCHR(st.st_mode);
+	// 0 when the file was deleted since or added by the end
+	return S_ISCHR(FileType(true));
 }
 
 
@@ -837,28 +1357,16 @@ bool moDirectory::moEntry::IsBlk(void) const
 #ifdef _MSC_VER
 	return false;
 #else
-	struct stat	st;
-
-	if(!Stat(&st)) {
-		// file deleted since or added by the end
-		return false;
-	}
-
-	return S_ISBLK(st.st_mode);
+	// 0 when the file was deleted since or added by the end
+	return S_ISBLK(FileType(true));
 #endif
 }
 
 
 bool moDirectory::moEntry::IsFIFO(void) const
 {
-	struct stat	st;
-
-	if(!Stat(&st)) {
-		// file deleted since or added by the end
-		return false;
-	}
-
-	return S_ISFIFO(st.st_mode);
+	// 0 when the file was deleted since or added by the end
+	return S_ISFIFO(FileType(true));
 }
 
 
@@ -873,14 +1381,8 @@ bool moDirectory::moEntry::IsLnk(void) const
 	// under win32 links end with .lnk
 	return CaseCompare(".lnk", static_cast<unsigned int>(len - 4)) == MO_BASE_COMPARE_EQUAL;
 #else
-	struct stat	st;
-
-	if(!LStat(&st)) {
-		// file deleted since or added in the list by the user
-		return false;
-	}
-
-	return S_ISLNK(st.st_mode);
+	// 0 when the file was deleted since or added in the list by the user
+	return S_ISLNK(FileType(false));
 #endif
 }
 
@@ -890,15 +1392,30 @@ bool moDirectory::moEntry::IsSock(void) const
 #ifdef WIN32
 	return false;
 #else
+	// 0 when the file was deleted since or added by the end
+	return S_ISSOCK(FileType(true));
+#endif
+}
+
+
+// the type of the file as found in the directory or with
+// stat(2) (when follow is true) or lstat(2); 0 on errors
+unsigned int moDirectory::moEntry::FileType(bool follow) const
+{
 	struct stat	st;
 
-	if(!Stat(&st)) {
-		// file deleted since or added by the end
-		return false;
+#ifdef S_IFLNK
+	if(f_type != 0 && (!follow || (f_type & S_IFMT) != S_IFLNK)) {
+#else
+	if(f_type != 0) {
+#endif
+		return f_type;
+	}
+	if(follow ? !Stat(&st) : !LStat(&st)) {
+		return 0;
 	}
 
-	return S_ISSOCK(st.st_mode);
-#endif
+	return st.st_mode & S_IFMT;
 }
 
 
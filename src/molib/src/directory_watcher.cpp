@@ -0,0 +1,745 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma implementation "mo/mo_directory_watcher.h"
+#endif
+
+#include	"mo/mo_directory_watcher.h"
+
+#ifndef MO_FILE_H
+#include	"mo/mo_file.h"
+#endif
+
+#include	<chrono>
+#include	<map>
+#include	<string>
+#include	<thread>
+#include	<vector>
+
+#if defined(MO_LINUX) || defined(LINUX)
+#define	MO_DIRECTORY_WATCHER_INOTIFY	1
+#include	<poll.h>
+#include	<unistd.h>
+#include	<sys/inotify.h>
+#endif
+
+
+namespace molib
+{
+
+
+namespace
+{
+
+// a file changing all the time still gets reported after that many delays
+const long long		WATCH_DELAY_MAX_FACTOR = 4;
+
+// the events the watcher is interested in
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+const uint32_t		WATCH_INOTIFY_MASK = IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE
+					| IN_DELETE | IN_MOVED_FROM | IN_ATTRIB
+					| IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+
+
+long long watch_now(void)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}		// no name namespace
+
+
+
+class moDirectoryWatcher::moWatches
+{
+public:
+	struct watch_t {
+		moWCString		directory;
+		moWCString		pattern;
+	};
+
+	struct pending_t {
+					pending_t(void)
+						: changes(0),
+						  first(0),
+						  deadline(0)
+					{
+					}
+
+		moWCString		directory;
+		moWCString		filename;
+		unsigned long		changes;
+		long long		first;		// when the first change was received
+		long long		deadline;	// when the event gets posted
+	};
+
+	typedef std::map<int, watch_t>				watches_t;
+	typedef std::pair<int, std::string>			key_t;
+	typedef std::map<key_t, pending_t>			pendings_t;
+
+				moWatches(void)
+				{
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+					f_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+					f_fd = -1;
+#endif
+					f_delay = WATCH_DELAY_DEFAULT;
+				}
+
+				~moWatches()
+				{
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+					if(f_fd >= 0) {
+						close(f_fd);
+					}
+#endif
+				}
+
+	// add a change to the pending changes (the mutex is locked)
+	void			Add(int wd, const watch_t& watch, const char *filename, unsigned long changes, long long now)
+				{
+					// the FindFile() results cannot wait for the delay
+					moFile::InvalidateFindFileCache(watch.directory);
+
+					pending_t& pending = f_pending[key_t(wd, filename)];
+					if(pending.changes == 0) {
+						pending.directory = watch.directory;
+						pending.filename = moWCString(filename, -1, mowc::MO_ENCODING_UTF8);
+						pending.first = now;
+					}
+					pending.changes |= changes;
+					// wait for the burst to be over, but not forever
+					pending.deadline = now + static_cast<long long>(f_delay);
+					if(pending.deadline > pending.first + static_cast<long long>(f_delay) * WATCH_DELAY_MAX_FACTOR) {
+						pending.deadline = pending.first + static_cast<long long>(f_delay) * WATCH_DELAY_MAX_FACTOR;
+					}
+				}
+
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+	// transform one inotify event in changes (the mutex is locked)
+	void			Record(const struct inotify_event *event, long long now)
+				{
+					if((event->mask & IN_Q_OVERFLOW) != 0) {
+						// the kernel lost events, everything has to be re-read
+						for(watches_t::const_iterator it = f_watches.begin(); it != f_watches.end(); ++it) {
+							Add(it->first, it->second, "", WATCH_OVERFLOW, now);
+						}
+						return;
+					}
+
+					watches_t::iterator it = f_watches.find(event->wd);
+					if(it == f_watches.end()) {
+						// unwatched since
+						return;
+					}
+					if((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) != 0) {
+						// the directory itself is gone
+						Add(it->first, it->second, "", WATCH_DELETED, now);
+						if((event->mask & IN_IGNORED) != 0) {
+							f_watches.erase(it);
+						}
+						return;
+					}
+
+					const char *filename = event->len > 0 ? event->name : "";
+					if(filename[0] != '\0' && !moWCString(filename, -1, mowc::MO_ENCODING_UTF8).Glob(it->second.pattern)) {
+						return;
+					}
+
+					unsigned long changes = 0;
+					if((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+						changes |= WATCH_CREATED;
+					}
+					if((event->mask & IN_CLOSE_WRITE) != 0) {
+						changes |= WATCH_MODIFIED;
+					}
+					if((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0) {
+						changes |= WATCH_DELETED;
+					}
+					if((event->mask & IN_ATTRIB) != 0) {
+						changes |= WATCH_ATTRIB;
+					}
+					if(changes != 0) {
+						Add(it->first, it->second, filename, changes, now);
+					}
+				}
+#endif
+
+	mutable moMutex		f_mutex;	// protects the following fields
+	int			f_fd;
+	unsigned long		f_delay;
+	watches_t		f_watches;
+	pendings_t		f_pending;
+};
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moDirectoryWatcherEvent
+
+NAME
+
+	DirectoryChanged - a file in a watched directory changed
+
+SYNOPSIS
+
+	virtual void DirectoryChanged(const moWCString& directory,
+		const moWCString& filename, unsigned long changes) = 0;
+
+PARAMETERS
+
+	directory - the directory as passed to moDirectoryWatcher::Watch()
+	filename - the name of the file which changed, empty when the
+		change applies to the directory itself
+	changes - a set of moDirectoryWatcher::WATCH_... flags
+
+DESCRIPTION
+
+	An object which needs to know about changes in a directory
+	derives from moEventReceiver and this class, then adds itself
+	as a receiver of the moEventPipeBroadcast given to the
+	moDirectoryWatcher (usually the moApplication).
+
+	The function is called once per file and burst of changes so
+	a manager can reload only that file (or the entries defined
+	in it.) When the filename is empty and the WATCH_OVERFLOW flag
+	is set, some changes were lost and the whole directory needs
+	to be re-read.
+
+SEE ALSO
+
+	moDirectoryWatcher::Watch
+
+*/
+moDirectoryWatcherEvent::~moDirectoryWatcherEvent()
+{
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moDirectoryWatcher::moEventChange
+
+NAME
+
+	Constructors - initialize a change event
+	GetDirectory - the watched directory
+	GetFilename - the name of the file which changed
+	GetPath - the directory and filename
+	GetChanges - the WATCH_... flags
+
+SYNOPSIS
+
+	moEventChange(const moWCString& directory, const moWCString& filename, unsigned long changes);
+	moEventChange(const moEventChange& event);
+	const moWCString& GetDirectory(void) const;
+	const moWCString& GetFilename(void) const;
+	moWCString GetPath(void) const;
+	unsigned long GetChanges(void) const;
+
+DESCRIPTION
+
+	The moDirectoryWatcher posts these events. It is an
+	moReceiversEvent so an moEventPipeBroadcast calls the
+	DirectoryChanged() function of its receivers; with other
+	pipes, the event can be cast back to an moEventChange
+	to read the information with the Get...() functions.
+
+	The changes are a set of flags since a file can be created,
+	modified and deleted within the same burst. Whether the
+	file still exists has to be checked by the receiver.
+
+SEE ALSO
+
+	moDirectoryWatcherEvent::DirectoryChanged
+
+*/
+moDirectoryWatcher::moEventChange::moEventChange(const moWCString& directory, const moWCString& filename, unsigned long changes)
+	: moReceiversEvent("DirectoryChanged"),
+	  f_directory(directory),
+	  f_filename(filename),
+	  f_changes(changes)
+{
+}
+
+
+moDirectoryWatcher::moEventChange::moEventChange(const moEventChange& event)
+	: moReceiversEvent(event),
+	  f_directory(event.f_directory),
+	  f_filename(event.f_filename),
+	  f_changes(event.f_changes)
+{
+}
+
+
+const char *moDirectoryWatcher::moEventChange::moGetClassName(void) const
+{
+	return "molib::moDirectoryWatcher::moEventChange";
+}
+
+
+moEventSPtr moDirectoryWatcher::moEventChange::Duplicate(void) const
+{
+	return new moEventChange(*this);
+}
+
+
+void moDirectoryWatcher::moEventChange::SendToReceivers(const moSortedList& receivers)
+{
+	moList::position_t		idx, max;
+	moDirectoryWatcherEvent		*r;
+
+	max = receivers.Count();
+	for(idx = 0; idx < max; ++idx) {
+		r = dynamic_cast<moDirectoryWatcherEvent *>(receivers.Get(idx));
+		if(r != 0) {
+			r->DirectoryChanged(f_directory, f_filename, f_changes);
+		}
+	}
+}
+
+
+const moWCString& moDirectoryWatcher::moEventChange::GetDirectory(void) const
+{
+	return f_directory;
+}
+
+
+const moWCString& moDirectoryWatcher::moEventChange::GetFilename(void) const
+{
+	return f_filename;
+}
+
+
+moWCString moDirectoryWatcher::moEventChange::GetPath(void) const
+{
+	if(f_filename.IsEmpty()) {
+		return f_directory;
+	}
+	return f_directory.FilenameChild(f_filename);
+}
+
+
+unsigned long moDirectoryWatcher::moEventChange::GetChanges(void) const
+{
+	return f_changes;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moDirectoryWatcher
+
+NAME
+
+	Constructor - initialize a directory watcher
+	Destructor - stop watching
+
+SYNOPSIS
+
+	moDirectoryWatcher(moEventPipe *pipe);
+	virtual ~moDirectoryWatcher();
+
+PARAMETERS
+
+	pipe - the pipe receiving the moEventChange events
+
+DESCRIPTION
+
+	The directory watcher uses the operating system notifications
+	(inotify(7) under Linux) so nothing needs to be read while
+	the files do not change. Changes made by other processes
+	are reported as well. Note that changes made on another
+	computer to a network file system are usually not reported
+	by the kernel.
+
+	The events are not posted as soon as the kernel reports
+	them. Instead they are merged per file and posted once
+	no new change occurred on that file for the delay defined
+	with SetDelay(). Saving a file usually generates several
+	notifications, a single event is posted.
+
+	The watcher is an moThread::moRunner so it can run in its
+	own thread:
+
+		watcher = new moDirectoryWatcher(app);
+		watcher->Watch(path, "*.conf");
+		thread = new moThread("watcher", watcher);
+		thread->Start(moThread::RUN_COUNT_FOREVER);
+
+	Without threads, call Poll() from time to time or whenever
+	the GetFileDescriptor() is readable.
+
+SEE ALSO
+
+	Watch, Poll, SetDelay
+
+*/
+moDirectoryWatcher::moDirectoryWatcher(moEventPipe *pipe)
+	: f_pipe(pipe),
+	  f_watches(new moWatches)
+{
+}
+
+
+moDirectoryWatcher::~moDirectoryWatcher()
+{
+	delete f_watches;
+}
+
+
+const char *moDirectoryWatcher::moGetClassName(void) const
+{
+	return "molib::moDirectoryWatcher";
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moDirectoryWatcher
+
+NAME
+
+	Watch - start watching a directory
+	Unwatch - stop watching a directory
+	UnwatchAll - stop watching all the directories
+	Count - number of directories being watched
+
+SYNOPSIS
+
+	bool Watch(const moWCString& directory, const moWCString& pattern = "*");
+	bool Unwatch(const moWCString& directory);
+	void UnwatchAll(void);
+	unsigned long Count(void) const;
+
+PARAMETERS
+
+	directory - the directory to watch
+	pattern - only the files matching this pattern are reported
+		(see moWCString::Glob())
+
+DESCRIPTION
+
+	The Watch() function adds a directory to the list of watched
+	directories. Only the changes of the files directly in this
+	directory are reported; the sub-directories need to be
+	watched separately. Watching the same directory again
+	replaces its pattern.
+
+	The Unwatch() function removes a directory from the list.
+	The changes of that directory not yet posted are dropped.
+
+RETURN VALUE
+
+	Watch() and Unwatch() return true when they succeed; false
+	otherwise and errno is set (ENOSYS when the system has no
+	support for directory notifications.)
+
+SEE ALSO
+
+	Poll
+
+*/
+bool moDirectoryWatcher::Watch(const moWCString& directory, const moWCString& pattern)
+{
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+	moLockMutex lock(f_watches->f_mutex);
+
+	if(f_watches->f_fd < 0) {
+		errno = ENOSYS;
+		return false;
+	}
+	int wd = inotify_add_watch(f_watches->f_fd, directory.SavedMBData(), WATCH_INOTIFY_MASK | IN_ONLYDIR);
+	if(wd < 0) {
+		return false;
+	}
+	moWatches::watch_t& watch = f_watches->f_watches[wd];
+	watch.directory = directory;
+	watch.pattern = pattern;
+
+	return true;
+#else
+	errno = ENOSYS;
+	return false;
+#endif
+}
+
+
+bool moDirectoryWatcher::Unwatch(const moWCString& directory)
+{
+	moLockMutex lock(f_watches->f_mutex);
+
+	for(moWatches::watches_t::iterator it = f_watches->f_watches.begin(); it != f_watches->f_watches.end(); ++it) {
+		if(it->second.directory == directory) {
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+			inotify_rm_watch(f_watches->f_fd, it->first);
+#endif
+			moWatches::pendings_t::iterator p = f_watches->f_pending.lower_bound(moWatches::key_t(it->first, std::string()));
+			while(p != f_watches->f_pending.end() && p->first.first == it->first) {
+				f_watches->f_pending.erase(p++);
+			}
+			f_watches->f_watches.erase(it);
+			return true;
+		}
+	}
+
+	errno = ENOENT;
+	return false;
+}
+
+
+void moDirectoryWatcher::UnwatchAll(void)
+{
+	moLockMutex lock(f_watches->f_mutex);
+
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+	for(moWatches::watches_t::const_iterator it = f_watches->f_watches.begin(); it != f_watches->f_watches.end(); ++it) {
+		inotify_rm_watch(f_watches->f_fd, it->first);
+	}
+#endif
+	f_watches->f_watches.clear();
+	f_watches->f_pending.clear();
+}
+
+
+unsigned long moDirectoryWatcher::Count(void) const
+{
+	moLockMutex lock(f_watches->f_mutex);
+
+	return static_cast<unsigned long>(f_watches->f_watches.size());
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moDirectoryWatcher
+
+NAME
+
+	SetDelay - define how long to wait for more changes
+	GetDelay - get the delay
+
+SYNOPSIS
+
+	void SetDelay(unsigned long delay);
+	unsigned long GetDelay(void) const;
+
+PARAMETERS
+
+	delay - the delay in milliseconds
+
+DESCRIPTION
+
+	A change is posted once no other change occurred on the same
+	file for that delay. A file which keeps changing is still
+	reported after a few delays. Use 0 to post the changes as
+	soon as they are read.
+
+	The default is WATCH_DELAY_DEFAULT (100ms).
+
+SEE ALSO
+
+	Poll
+
+*/
+void moDirectoryWatcher::SetDelay(unsigned long delay)
+{
+	moLockMutex lock(f_watches->f_mutex);
+
+	f_watches->f_delay = delay;
+}
+
+
+unsigned long moDirectoryWatcher::GetDelay(void) const
+{
+	moLockMutex lock(f_watches->f_mutex);
+
+	return f_watches->f_delay;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moDirectoryWatcher
+
+NAME
+
+	GetFileDescriptor - the descriptor to wait on
+	Poll - read the changes and post the events
+	Run - wait and post the events in a thread
+
+SYNOPSIS
+
+	int GetFileDescriptor(void) const;
+	unsigned long Poll(long timeout = 0);
+	virtual bool Run(void);
+
+PARAMETERS
+
+	timeout - how long to wait for changes in milliseconds;
+		-1 to wait until an event gets posted
+
+DESCRIPTION
+
+	The GetFileDescriptor() function returns the file descriptor
+	which becomes readable whenever changes are available. It can
+	be added to the main loop of the application (select(2),
+	QSocketNotifier, etc.) which then calls Poll(). It is -1
+	when the system does not support notifications.
+
+	The Poll() function reads the available changes and posts the
+	changes which are due. It waits up to timeout milliseconds
+	for changes, but less when a change is due earlier. Since
+	changes are delayed, Poll() needs to be called again later
+	when it did not post everything; in the main loop, use a
+	timer of GetDelay() milliseconds while changes are pending.
+
+	The Run() function calls Poll() with WATCH_RUN_TIMEOUT; it is
+	used when the watcher runs in its own moThread.
+
+RETURN VALUE
+
+	Poll() returns the number of events posted.
+
+	Run() always returns true.
+
+SEE ALSO
+
+	SetDelay
+
+*/
+int moDirectoryWatcher::GetFileDescriptor(void) const
+{
+	return f_watches->f_fd;
+}
+
+
+unsigned long moDirectoryWatcher::Poll(long timeout)
+{
+	long long now = watch_now();
+	long wait = timeout;
+	{
+		moLockMutex lock(f_watches->f_mutex);
+		for(moWatches::pendings_t::const_iterator it = f_watches->f_pending.begin(); it != f_watches->f_pending.end(); ++it) {
+			long long due = it->second.deadline - now;
+			if(due < 0) {
+				due = 0;
+			}
+			if(wait < 0 || due < wait) {
+				wait = static_cast<long>(due);
+			}
+		}
+	}
+
+	// wait for changes (nothing runs here while the files don't change)
+#ifdef MO_DIRECTORY_WATCHER_INOTIFY
+	if(f_watches->f_fd >= 0) {
+		struct pollfd fds;
+		fds.fd = f_watches->f_fd;
+		fds.events = POLLIN;
+		fds.revents = 0;
+		if(poll(&fds, 1, static_cast<int>(wait)) > 0 && (fds.revents & POLLIN) != 0) {
+			union {
+				struct inotify_event	align;
+				char			data[4096];
+			} buffer;
+			now = watch_now();
+			for(;;) {
+				ssize_t size = read(f_watches->f_fd, buffer.data, sizeof(buffer.data));
+				if(size <= 0) {
+					break;
+				}
+				moLockMutex lock(f_watches->f_mutex);
+				for(ssize_t pos = 0; pos < size;) {
+					const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer.data + pos);
+					f_watches->Record(event, now);
+					pos += sizeof(struct inotify_event) + event->len;
+				}
+			}
+		}
+	}
+	else
+#endif
+	if(wait > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+	}
+
+	// post the changes which are due (the events get posted
+	// without the lock so receivers can call Watch())
+	std::vector<moWatches::pending_t> due;
+	now = watch_now();
+	{
+		moLockMutex lock(f_watches->f_mutex);
+		moWatches::pendings_t::iterator it = f_watches->f_pending.begin();
+		while(it != f_watches->f_pending.end()) {
+			if(it->second.deadline <= now) {
+				due.push_back(it->second);
+				f_watches->f_pending.erase(it++);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+	if(f_pipe) {
+		for(size_t idx = 0; idx < due.size(); ++idx) {
+			moEventChange event(due[idx].directory, due[idx].filename, due[idx].changes);
+			f_pipe->Post(event);
+		}
+	}
+
+	return static_cast<unsigned long>(due.size());
+}
+
+
+bool moDirectoryWatcher::Run(void)
+{
+	Poll(WATCH_RUN_TIMEOUT);
+	return true;
+}
+
+
+
+}			// namespace molib;
+
+// vim: ts=8 sw=8
@@ -26,6 +26,10 @@
 #include	"mo/mo_expr.h"
 #include	"mo/mo_regexpr.h"
 
+#include <list>
+#include <map>
+#include <vector>
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4996)
 #endif
@@ -352,6 +356,12 @@ RETURN VALUE
 	a string with the result
 	or "ERROR" to indicate that some error occured
 
+NOTES
+
+	The expression is compiled by moExprProgram::Compile() which
+	keeps the result in a cache; evaluating the same expression
+	again only runs the compiled program.
+
 BUGS
 
 	You can't distinguish a real error from an expression which
@@ -359,7 +369,7 @@ BUGS
 
 SEE ALSO
 
-	Constructors
+	Constructors, moExprProgram
 
 */
 enum mo_expr_token_t {
@@ -411,15 +421,13 @@ enum mo_expr_token_t {
 
 
 struct mo_expr_value_t {
-	moWCString		name;		// a variable name
-	mo_expr_token_t		value_type;	// one of MO_EXPR_TOKEN_INTEGER, FLOAT or STRING
+	mo_expr_token_t		value_type;	// one of MO_EXPR_TOKEN_INTEGER, FLOAT, STRING or IDENTIFIER
 	long			value_int;	// defined when value_type is MO_EXPR_TOKEN_INTEGER
 	double			value_flt;	// defined when value_type is MO_EXPR_TOKEN_FLOAT
-	moWCString		value_str;	// defined when value_type is MO_EXPR_TOKEN_STRING
+	moWCString		value_str;	// defined when value_type is MO_EXPR_TOKEN_STRING or IDENTIFIER
 
 		mo_expr_value_t(void)
 		{
-			//name -- auto-init
 			value_type = MO_EXPR_TOKEN_UNKNOWN;
 			value_int = 0;
 			value_flt = 0.0;
@@ -428,63 +436,100 @@ struct mo_expr_value_t {
 };
 
 #define	MO_EXPR_VARIABLE_MAX		50
-#define	MO_EXPR_PARAM_MAX		5	// maximum number of parameters for internal functions
+
+
+// The expressions are compiled to a flat list of instructions for a
+// stack machine. There are no jumps since the language evaluates all
+// of its operands (including both sides of a ?:) and stops on the
+// first error.
+enum mo_expr_opcode_t {
+	MO_EXPR_OP_PUSH,		// push constant[arg]
+	MO_EXPR_OP_LOAD,		// push slot[arg]; error if not defined
+	MO_EXPR_OP_POP,			// drop the top item
+	MO_EXPR_OP_DEFINE,		// define slot[arg] if it is not yet
+	MO_EXPR_OP_CHECK_DEFINED,	// error if slot[arg] is not defined
+	MO_EXPR_OP_ASSIGN,		// slot[arg] <arg2> top (top is kept)
+	MO_EXPR_OP_FAIL,		// return the error arg
+	MO_EXPR_OP_UNARY,		// apply the unary operator arg to top
+	MO_EXPR_OP_CAST,		// cast top to the type arg
+	MO_EXPR_OP_INC,			// add arg to top
+	MO_EXPR_OP_CHECK_ARRAY,		// error unless top is a string
+	MO_EXPR_OP_CHECK_INDEX,		// error unless top is an integer
+	MO_EXPR_OP_SUBSTR,		// extract part of a string (arg are MO_EXPR_SUBSTR_... flags)
+	MO_EXPR_OP_CHECK_FUNCTION,	// error unless top is a string or an identifier
+	MO_EXPR_OP_CALL,		// call the internal function arg with arg2 parameters
+	MO_EXPR_OP_CALL_NAMED,		// call the function named below the arg2 parameters
+	MO_EXPR_OP_BINARY,		// apply the binary operator arg to the two top items
+	MO_EXPR_OP_CHOICE,		// transform top in the choice of a ?:
+	MO_EXPR_OP_SELECT,		// choice ? middle : right
+	MO_EXPR_OP_SELECT_NOELSE	// choice ? middle
+};
+
+static const long	MO_EXPR_SUBSTR_FROM	= 0x0001;	// the start index is on the stack
+static const long	MO_EXPR_SUBSTR_TO	= 0x0002;	// the end index is on the stack
+static const long	MO_EXPR_SUBSTR_TO_END	= 0x0004;	// up to the end of the string
+
+struct mo_expr_instruction_t {
+	mo_expr_opcode_t	opcode;
+	long			arg;
+	long			arg2;
+};
+
+struct mo_expr_slot_t {
+	bool			defined;
+	mo_expr_value_t		value;
+
+		mo_expr_slot_t(void)
+		{
+			defined = false;
+		}
+};
+
+class moExprProgram::moCode
+{
+public:
+				moCode(void)
+				{
+					f_locals = 0;
+					f_compile_error = moExpr::MO_EXPR_ERROR_NONE;
+				}
+
+	std::vector<mo_expr_instruction_t>	f_code;
+	std::vector<mo_expr_value_t>		f_constants;
+	std::vector<moWCString>			f_slot_names;
+	std::vector<long>			f_slot_inputs;		// input index or -1 for local variables
+	std::vector<long>			f_inputs;		// slot of each input
+	long					f_locals;
+	moExpr::mo_expr_errno_t			f_compile_error;
+
+	// evaluation buffers, sized once compiled
+	std::vector<mo_expr_value_t>		f_stack;
+	std::vector<mo_expr_slot_t>		f_slots;
+};
+
 
 struct mo_expr_state_t {
 	const mowc::wc_t *	input;		// input stream
 	const mowc::wc_t *	start;		// start of current token
 	const mowc::wc_t *	end;		// end of current token
 	mo_expr_token_t		token;		// current token type
-	mo_expr_value_t		value;		// the current value of this state
-	long			param_count;	// the number of valid parameters
-	mo_expr_value_t		param[MO_EXPR_PARAM_MAX];	// function parameters
-	long			count;		// number of variables
-	mo_expr_value_t *	variable;	// a list of variables (we use a pointer so sub-states access the same variables)
-	mo_expr_state_t *	parent;		// the parent state
+	moExprProgram::moCode *	code;		// the program being compiled
 
 		mo_expr_state_t(void)
 		{
-			// parent structure initialization
 			input = 0;
 			start = 0;
 			end = 0;
 			token = MO_EXPR_TOKEN_UNKNOWN;
-			param_count = 0;
-			count = 0;
-			variable = 0;
-			parent = 0;
-		}
-
-		mo_expr_state_t(const mo_expr_state_t& state)
-		{
-			// any sub-state initialization
-			input = state.input;
-			start = state.start;
-			end = state.end;
-			token = MO_EXPR_TOKEN_UNKNOWN;
-			param_count = 0;
-			count = state.count;
-			variable = state.variable;
-			parent = const_cast<mo_expr_state_t *>(&state);
-		}
-
-		~mo_expr_state_t()
-		{
-			if(parent != 0) {
-				// a sub-state destruction!
-				parent->input = input;
-				parent->start = start;
-				parent->end = end;
-				parent->token = token;
-				parent->count = count;
-			}
+			code = 0;
 		}
 };
 
 
-static	moExpr::mo_expr_errno_t		expr_comma(mo_expr_state_t& state, bool gettoken);
-static	moExpr::mo_expr_errno_t		expr_prefix_inc(mo_expr_state_t& state, bool gettoken);
-static	moExpr::mo_expr_errno_t		expr_assign(mo_expr_state_t& state, bool gettoken);
+static	moExpr::mo_expr_errno_t		expr_comma(mo_expr_state_t& state, bool get_token, long *count = 0);
+static	moExpr::mo_expr_errno_t		expr_prefix_inc(mo_expr_state_t& state, bool get_token);
+static	moExpr::mo_expr_errno_t		expr_assign(mo_expr_state_t& state, bool get_token);
+static	moExpr::mo_expr_errno_t		expr_run(const moExprProgram::moCode& code, unsigned long begin, unsigned long end, mo_expr_value_t *stack, long& sp, mo_expr_slot_t *slots);
 
 
 
@@ -545,16 +590,16 @@ static moExpr::mo_expr_errno_t expr_read_token(mo_expr_state_t& state)
 	case '>':
 		if(*state.input == '=') {
 			state.input++;
-			if(*state.input == '=') {
-				state.input++;
-				state.token = MO_EXPR_TOKEN_ASSIGN_SHR;
-				return moExpr::MO_EXPR_ERROR_NONE;
-			}
 			state.token = MO_EXPR_TOKEN_GREATER_EQUAL;
 			return moExpr::MO_EXPR_ERROR_NONE;
 		}
 		if(*state.input == '>') {
 			state.input++;
+			if(*state.input == '=') {
+				state.input++;
+				state.token = MO_EXPR_TOKEN_ASSIGN_SHR;
+				return moExpr::MO_EXPR_ERROR_NONE;
+			}
 			state.token = MO_EXPR_TOKEN_SHIFT_RIGHT;
 			return moExpr::MO_EXPR_ERROR_NONE;
 		}
@@ -863,1295 +908,1825 @@ static moExpr::mo_expr_errno_t expr_token(mo_expr_state_t& state)
 }
 
 
+struct expr_format_info {
+	long		position;	// position of the parameter
+	long		width;		// max. number of characters
+	long		width_pos;	// get the width there
+	long		precision;	// number of decimals
+	long		precision_pos;	// get the precision there
+	long		flags;		// a set of flags
 
-static moExpr::mo_expr_errno_t expr_unary(mo_expr_state_t& state, bool get_token)
+			expr_format_info(void)
+			{
+				position = 1;
+			}
+};
+
+// flags
+static const long	EXPR_FMT_FORMAT		= 0x0001;	// show type format
+static const long	EXPR_FMT_ZERO		= 0x0002;	// zero padded
+static const long	EXPR_FMT_LEFT		= 0x0004;	// left adjusted
+static const long	EXPR_FMT_SPACE		= 0x0008;	// space for + sign
+static const long	EXPR_FMT_PLUS		= 0x0010;	// use + or -
+static const long	EXPR_FMT_THOUSANDS	= 0x0020;	// show thousands separator
+static const long	EXPR_FMT_UPPERCASE	= 0x0040;	// X, G, etc.
+
+// lengths
+static const long	EXPR_FMT_NOLENGTH	= 0x0000;
+static const long	EXPR_FMT_LENGTH_MASK	= 0xF000;
+static const long	EXPR_FMT_BYTE		= 0x1000;	// hh
+static const long	EXPR_FMT_SHORT		= 0x2000;	// h
+static const long	EXPR_FMT_LONG		= 0x3000;	// l
+static const long	EXPR_FMT_LONGLONG	= 0x4000;	// ll (q)
+static const long	EXPR_FMT_LONGDOUBLE	= 0x5000;	// L
+static const long	EXPR_FMT_INTMAX		= 0x6000;	// j
+static const long	EXPR_FMT_SIZE_T		= 0x7000;	// z (Z)
+static const long	EXPR_FMT_PTRDIFF_T	= 0x8000;	// t
+
+// types
+static const long	EXPR_FMT_NOTYPE		= 0x00000;	// invalid format!
+static const long	EXPR_FMT_TYPE_MASK	= 0xF0000;
+static const long	EXPR_FMT_INTEGER	= 0x10000;	// i, d
+static const long	EXPR_FMT_UNSIGNED	= 0x20000;	// u
+static const long	EXPR_FMT_OCTAL		= 0x30000;	// o
+static const long	EXPR_FMT_HEXA		= 0x40000;	// x, X (always uppercase)
+static const long	EXPR_FMT_EDOUBLE	= 0x50000;	// e, E
+static const long	EXPR_FMT_FDOUBLE	= 0x60000;	// f, F
+static const long	EXPR_FMT_GDOUBLE	= 0x70000;	// g, G
+static const long	EXPR_FMT_ADOUBLE	= 0x80000;	// a, A
+static const long	EXPR_FMT_CHARACTER	= 0x90000;	// c (C)
+static const long	EXPR_FMT_STRING		= 0xA0000;	// s (S)
+static const long	EXPR_FMT_POINTER	= 0xB0000;	// p
+
+
+// The following parse (in order) the possible parameters available
+// in a string format for a printf()
+// The order is as follow:
+//	the position (<value>$)
+//	a flag (#, ,-,...)
+//	field width (possibly indirect: *[<value>$])
+//	precision (possibly indirect: .*[<value>$])
+//	length modifier (hh,h,l,ll,q,...)
+//	format (i,d,f,e,g,a...)
+// returns -1 when an error occurs and s is unchanged
+
+static int expr_func_strf_format(const mowc::wc_t *& s, expr_format_info& info)
 {
-	moExpr::mo_expr_errno_t	r;
-	long			l, idx;
-	char			buf[256];	/* Flawfinder: ignore */
+	mowc::wc_t		c, *end;
+	const mowc::wc_t	*start;
+	bool			more;
+	long			value;
 
-	if(get_token) {
-		r = expr_token(state);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+	start = s;
+
+// reset the info structure
+	// info.position unchanged! must be initialized to 1 by caller the very first time
+	info.width         = -1;
+	info.width_pos     = -1;
+	info.precision     = -1;
+	info.precision_pos = -1;
+	info.flags         = 0;
+
+// position
+	if(*s >= '1' && *s <= '9') {
+		// position of the parameter to use
+		value = mowc::strtol(s, &end, 10);
+		// must be followed by a '$' to be a positioning arg.
+		// otherwise it's probably a width and is ignored here!
+		if(*end == '$') {
+			info.position = value;
+			s = end + 1;
 		}
 	}
 
-	switch(static_cast<int>(state.token)) {
-	case '!':	// logical not
-		r = expr_prefix_inc(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			state.value.value_int = !state.value.value_int;
+// flags
+	more = true;
+	do {
+		c = *s++;
+		switch(c) {
+		case '#':
+			info.flags |= EXPR_FMT_FORMAT;
 			break;
 
-		case MO_EXPR_TOKEN_FLOAT:
-			state.value.value_int = state.value.value_flt == 0.0;
-			state.value.value_type = MO_EXPR_TOKEN_INTEGER;
+		case '0':
+			info.flags |= EXPR_FMT_ZERO;
 			break;
 
-		case MO_EXPR_TOKEN_STRING:
-			state.value.value_str.Reverse();
+		case '-':
+			info.flags |= EXPR_FMT_LEFT;
 			break;
 
-		default:;
-		}
-		break;
+		case ' ':
+			info.flags |= EXPR_FMT_SPACE;
+			break;
 
-	case '~':	// bitwise not
-		r = expr_prefix_inc(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			state.value.value_int = ~state.value.value_int;
+		case '+':
+			info.flags |= EXPR_FMT_PLUS;
 			break;
 
-		case MO_EXPR_TOKEN_FLOAT:
-			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
+		case '\'':
+			info.flags |= EXPR_FMT_THOUSANDS;
+			break;
 
-		case MO_EXPR_TOKEN_STRING:
-			state.value.value_str = state.value.value_str.Switchcase();
+		default:
+			more = false;
 			break;
 
-		default:;
 		}
-		break;
+	} while(more);
 
-	case '+':	// identity (C++ only)
-		r = expr_prefix_inc(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+// width
+	if(c == '*') {
+		// indirect width
+		c = *s;
+		if(c >= '1' && c <= '9') {
+			// specify a position!
+			info.width_pos = mowc::strtol(s, &end, 10);
+			if(end == 0 || *end != '$') {
+				s = start;
+				return -1;
+			}
 		}
-		if(state.value.value_type == MO_EXPR_TOKEN_STRING) {
-			state.value.value_str = state.value.value_str.Uppercase();
+		else {
+			info.width_pos = -2;
 		}
-		break;
+		s = end + 1;
+		c = *s++;
+	}
+	else if(c >= '1' && c <= '9') {
+		// direct width
+		info.width = mowc::strtol(s - 1, &end, 10);
+		s = end;
+		c = *s++;
+	}
 
-	case '-':
-		r = expr_prefix_inc(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+// precision
+	if(c == '.') {
+		c = *s++;
+		if(c == '*') {
+			// indirect precision
+			c = *s;
+			if(c >= '1' && c <= '9') {
+				info.precision_pos = mowc::strtol(s, &end, 10);
+				if(end == 0 || *end != '$') {
+					s = start;
+					return -1;
+				}
+			}
+			else {
+				info.precision_pos = -2;
+			}
+			s = end + 1;
+			c = *s++;
 		}
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			state.value.value_int = -state.value.value_int;
-			break;
-
-		case MO_EXPR_TOKEN_FLOAT:
-			state.value.value_flt = -state.value.value_flt;
-			break;
-
-		case MO_EXPR_TOKEN_STRING:
-			state.value.value_str = state.value.value_str.Lowercase();
-			break;
+		else if(c >= '1' && c <= '9') {
+			// direct precision
+			info.precision = mowc::strtol(s - 1, &end, 10);
+			s = end;
+			c = *s++;
+		}
+	}
 
-		default:;
+// length (only one length can be accepted!)
+	switch(c) {
+	case 'h':
+		if(*s == 'h') {
+			info.flags |= EXPR_FMT_BYTE;
+			s += 2;
+			c = s[-1];
+		}
+		else {
+			info.flags |= EXPR_FMT_SHORT;
+			c = *s++;
 		}
 		break;
 
-	case '(':
-		r = expr_token(state);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		if(state.token == MO_EXPR_TOKEN_IDENTIFIER) {
-			l = static_cast<long>(state.end - state.start);
-			// check for casts
-			if((l == 4 && mowc::strcmp(state.start, "long", l) == 0)
-			|| (l == 3 && mowc::strcmp(state.start, "int",  l) == 0)) {
-				r = expr_token(state);
-				if(r != moExpr::MO_EXPR_ERROR_NONE) {
-					return r;
-				}
-				if(state.token != ')') {
-					return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
-				}
-				r = expr_prefix_inc(state, true);
-				if(r != moExpr::MO_EXPR_ERROR_NONE) {
-					return r;
-				}
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (long) state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					break;
-
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = state.value.value_str.Integer();
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					break;
-
-				default:;
-				}
-				//r = expr_token(state);
-				return moExpr::MO_EXPR_ERROR_NONE;
-			}
-			else if((l == 5 && mowc::strcmp(state.start, "float", l) == 0)
-			     || (l == 6 && mowc::strcmp(state.start, "double", l) == 0)) {
-				r = expr_token(state);
-				if(r != moExpr::MO_EXPR_ERROR_NONE) {
-					return r;
-				}
-				if(state.token != ')') {
-					return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
-				}
-				r = expr_prefix_inc(state, true);
-				if(r != moExpr::MO_EXPR_ERROR_NONE) {
-					return r;
-				}
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_flt = (double) state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_flt = state.value.value_str.Float();
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				default:;
-				}
-				//r = expr_token(state);
-				return moExpr::MO_EXPR_ERROR_NONE;
-			}
-			else if(l == 6 && mowc::strcmp(state.start, "string", l) == 0) {
-				r = expr_token(state);
-				if(r != moExpr::MO_EXPR_ERROR_NONE) {
-					return r;
-				}
-				if(state.token != ')') {
-					return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
-				}
-				r = expr_prefix_inc(state, true);
-				if(r != moExpr::MO_EXPR_ERROR_NONE) {
-					return r;
-				}
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					sprintf(buf, "%ld", state.value.value_int);	/* Flawfinder: ignore */
-					state.value.value_str = buf;
-					state.value.value_type = MO_EXPR_TOKEN_STRING;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					sprintf(buf, "%g", state.value.value_flt);	/* Flawfinder: ignore */
-					state.value.value_str = buf;
-					state.value.value_type = MO_EXPR_TOKEN_STRING;
-					break;
-
-				default:;
-				}
-				return moExpr::MO_EXPR_ERROR_NONE;
-			}
-			else {
-				// an expression with a variable?
-				r = expr_comma(state, false);
-			}
+	case 'l':
+		if(*s == 'l') {
+			info.flags |= EXPR_FMT_LONGLONG;
+			s += 2;
+			c = s[-1];
 		}
 		else {
-			// not a cast, some expression...
-			r = expr_comma(state, false);
+			info.flags |= EXPR_FMT_LONG;
+			c = *s++;
 		}
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+		break;
+
+	case 'L':
+		info.flags |= EXPR_FMT_LONGDOUBLE;
+		c = *s++;
+		break;
+
+	case 'j':
+		info.flags |= EXPR_FMT_INTMAX;
+		c = *s++;
+		break;
+
+	case 'z':
+	case 'Z':
+		info.flags |= EXPR_FMT_SIZE_T;
+		c = *s++;
+		break;
+
+	case 't':
+		info.flags |= EXPR_FMT_PTRDIFF_T;
+		c = *s++;
+		break;
+
+	}
+
+// check the format now (only one format possible!)
+	switch(c) {
+	case 'i':
+	case 'd':
+		info.flags |= EXPR_FMT_INTEGER;
+		break;
+
+	case 'u':
+		info.flags |= EXPR_FMT_UNSIGNED;
+		break;
+
+	case 'o':
+		info.flags |= EXPR_FMT_OCTAL;
+		break;
+
+	case 'x':
+		info.flags |= EXPR_FMT_HEXA;
+		break;
+
+	case 'X':
+		info.flags |= EXPR_FMT_HEXA | EXPR_FMT_UPPERCASE;
+		break;
+
+	case 'e':
+		info.flags |= EXPR_FMT_EDOUBLE;
+		break;
+
+	case 'E':
+		info.flags |= EXPR_FMT_EDOUBLE | EXPR_FMT_UPPERCASE;
+		break;
+
+	case 'f':
+	case 'F':		// that's useless, 'F' is like 'f'
+		info.flags |= EXPR_FMT_FDOUBLE;
+		break;
+
+	case 'g':
+		info.flags |= EXPR_FMT_GDOUBLE;
+		break;
+
+	case 'G':
+		info.flags |= EXPR_FMT_GDOUBLE | EXPR_FMT_UPPERCASE;
+		break;
+
+	case 'a':
+		info.flags |= EXPR_FMT_ADOUBLE;
+		break;
+
+	case 'A':
+		info.flags |= EXPR_FMT_ADOUBLE | EXPR_FMT_UPPERCASE;
+		break;
+
+	case 'c':
+	case 'C':
+		info.flags = (info.flags & ~EXPR_FMT_LENGTH_MASK)
+					| EXPR_FMT_LONGLONG | EXPR_FMT_CHARACTER;
+		break;
+
+	case 's':
+	case 'S':
+		info.flags = (info.flags & ~EXPR_FMT_LENGTH_MASK)
+					| EXPR_FMT_LONGLONG | EXPR_FMT_STRING;
+		break;
+
+	case 'p':
+		info.flags |= EXPR_FMT_POINTER;
+		break;
+
+	default:
+		s = start;
+		return -1;
+
+	}
+
+	return 0;
+}
+
+
+static moWCString expr_func_strf_apply(const mo_expr_value_t *param, long count, expr_format_info& info)
+{
+	char		fmt[256];	/* Flawfinder: ignore */
+	int		r;
+
+	r = 1;
+	fmt[0] = '%';
+	fmt[1] = '\0';
+
+// insert flags
+	if((info.flags & EXPR_FMT_FORMAT) != 0) {
+		fmt[r++] = '#';
+	}
+	if((info.flags & EXPR_FMT_ZERO) != 0) {
+		fmt[r++] = '0';
+	}
+	if((info.flags & EXPR_FMT_LEFT) != 0) {
+		fmt[r++] = '-';
+	}
+	if((info.flags & EXPR_FMT_SPACE) != 0) {
+		fmt[r++] = ' ';
+	}
+	else if((info.flags & EXPR_FMT_PLUS) != 0) {
+		fmt[r++] = '+';
+	}
+	if((info.flags & EXPR_FMT_THOUSANDS) != 0) {
+		fmt[r++] = '\'';
+	}
+
+// check for a width
+	if(info.width_pos > 0) {
+		// get the width from the parameters at the given position
+		if(info.width_pos >= count) {
+			// position out of range
+			return "";
 		}
-		if(state.token != ')') {
-			// invalid expression!
-			return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
+		info.position = info.width_pos;
+		if(param[info.position].value_type != MO_EXPR_TOKEN_INTEGER) {
+			// position need to be an integer
+			return "";
 		}
-		return expr_token(state);
+		info.width = param[info.position].value_int;
+		info.position++;
+	}
+	else if(info.width_pos == -2) {
+		if(info.position >= count) {
+			// position out of range
+			return "";
+		}
+		info.width = param[info.position].value_int;
+		info.position++;
+	}
+	if(info.width > 0) {
+		r += sprintf(fmt + r, "%ld", info.width);	/* Flawfinder: ignore */
+	}
+
+// check for a precision
+	if(info.precision_pos > 0) {
+		// get the width from the parameters at the given position
+		if(info.precision_pos >= count) {
+			// position out of range
+			return "";
+		}
+		info.position = info.precision_pos;
+		if(param[info.position].value_type != MO_EXPR_TOKEN_INTEGER) {
+			// position need to be an integer
+			return "";
+		}
+		info.precision = param[info.position].value_int;
+		info.position++;
+	}
+	else if(info.precision_pos == -2) {
+		if(info.position >= count) {
+			// position out of range
+			return "";
+		}
+		info.precision = param[info.position].value_int;
+		info.position++;
+	}
+	if(info.precision >= 0) {
+		r += sprintf(fmt + r, ".%ld", info.precision);	/* Flawfinder: ignore */
+	}
+
+// insert the length
+#if 0
+	// we really only offer the default types (long, wc_t, wc_t *, ...)
+	switch(info.flags & EXPR_FMT_LENGTH_MASK) {
+	case EXPR_FMT_BYTE:
+		fmt[r++] = 'h';
+		fmt[r++] = 'h';
+		break;
+
+	case EXPR_FMT_SHORT:
+		fmt[r++] = 'h';
+		break;
+
+	case EXPR_FMT_LONG:
+		fmt[r++] = 'l';
+		break;
+
+	case EXPR_FMT_LONGLONG:
+		fmt[r++] = 'l';
+		fmt[r++] = 'l';
+		break;
+
+	case EXPR_FMT_LONGDOUBLE:
+		fmt[r++] = 'L';
+		break;
+
+	case EXPR_FMT_INTMAX:
+		fmt[r++] = 'j';
+		break;
+
+	case EXPR_FMT_SIZE_T:
+		fmt[r++] = 'z';
+		break;
+
+	case EXPR_FMT_PTRDIFF_T:
+		fmt[r++] = 't';
+		break;
+
+	// case EXPR_FMT_UNKNOWN - undefined, keep the default
+	}
+#endif
+
+// insert the type
+	switch(info.flags & EXPR_FMT_TYPE_MASK) {
+	case EXPR_FMT_INTEGER:
+		fmt[r++] = 'l';
+		fmt[r++] = 'd';
+		break;
+
+	case EXPR_FMT_UNSIGNED:
+		fmt[r++] = 'l';
+		fmt[r++] = 'u';
+		break;
+
+	case EXPR_FMT_OCTAL:
+		fmt[r++] = 'l';
+		fmt[r++] = 'o';
+		break;
+
+	case EXPR_FMT_HEXA:
+		fmt[r++] = 'l';
+		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'X' : 'x';
+		break;
+
+	case EXPR_FMT_EDOUBLE:
+		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'E' : 'e';
+		break;
+
+	case EXPR_FMT_FDOUBLE:
+		fmt[r++] = 'f';
+		break;
+
+	case EXPR_FMT_GDOUBLE:
+		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'G' : 'g';
+		break;
+
+	case EXPR_FMT_ADOUBLE:
+		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'A' : 'a';
+		break;
+
+	case EXPR_FMT_CHARACTER:
+		fmt[r++] = 'l';
+		fmt[r++] = 'l';
+		fmt[r++] = 'c';
+		break;
+
+	case EXPR_FMT_STRING:
+		fmt[r++] = 'l';
+		fmt[r++] = 'l';
+		fmt[r++] = 's';
+		break;
+
+	case EXPR_FMT_POINTER:
+		// there is no notion of pointer in this expression!
+		return "<no ptr>";
+
+	}
+
+	if(info.position >= count) {
+		// that parameter doesn't exist!
+		return "";
+	}
+	fmt[r] = '\0';
+
+// get the parameter
+	switch(info.flags & EXPR_FMT_TYPE_MASK) {
+	case EXPR_FMT_INTEGER:
+	case EXPR_FMT_UNSIGNED:
+	case EXPR_FMT_OCTAL:
+	case EXPR_FMT_HEXA:
+	case EXPR_FMT_CHARACTER:
+		if(param[info.position].value_type != MO_EXPR_TOKEN_INTEGER) {
+			// format/type mismatch
+			return "";
+		}
+		return moWCString::Format(fmt, mowc::MO_ENCODING_UTF8, param[info.position++].value_int);
+
+	case EXPR_FMT_EDOUBLE:
+	case EXPR_FMT_FDOUBLE:
+	case EXPR_FMT_GDOUBLE:
+	case EXPR_FMT_ADOUBLE:
+		if(param[info.position].value_type != MO_EXPR_TOKEN_FLOAT) {
+			// format/type mismatch
+			return "";
+		}
+		return moWCString::Format(fmt, mowc::MO_ENCODING_UTF8, param[info.position++].value_flt);
+
+	case EXPR_FMT_STRING:
+		if(param[info.position].value_type != MO_EXPR_TOKEN_STRING) {
+			// format/type mismatch
+			return "";
+		}
+		return moWCString::Format(fmt, mowc::MO_ENCODING_UTF8, param[info.position++].value_str.Data());
+
+	}
+
+	return "";
+}
+
+
+static moExpr::mo_expr_errno_t expr_func_strf(mo_expr_value_t& value, const mo_expr_value_t *param, long count)
+{
+	// here we have to parse the format because the parameters
+	// are not in standard args...
+	// Note that the positioning has to be handled by us also
+	// (see the *.*$ and <value>$ notation of printf().
+
+	const mowc::wc_t	*s;
+	mowc::wc_t		c;
+	int			r;
+	moWCString		result;
+	expr_format_info	info;
+
+	// get the format
+	s = param[0].value_str.Data();
+	while(*s != '\0') {
+		c = *s++;
+		switch(c) {
+		case '%':
+			if(*s != '%') {
+				r = expr_func_strf_format(s, info);
+
+#if 0
+fprintf(stderr, "Checked format [%s] -> %d\n", s, r);
+fprintf(stderr, "  info.position      = %ld\n", info.position);
+fprintf(stderr, "  info.width         = %ld\n", info.width);
+fprintf(stderr, "  info.width_pos     = %ld\n", info.width_pos);
+fprintf(stderr, "  info.precision     = %ld\n", info.precision);
+fprintf(stderr, "  info.precision_pos = %ld\n", info.precision_pos);
+fprintf(stderr, "  info.flags         = 0x%08lX\n", info.flags);
+#endif
+
+				if(r == 0) {	// apply only valid formats
+					result += expr_func_strf_apply(param, count, info);
+				}
+				break;
+			}
+			/*FALLTHROUGH*/
+		default:
+			result += c;
+			break;
+
+		case '\\':
+			c = static_cast<mowc::wc_t>(mowc::backslash_char(s));
+			result += c;
+			break;
+
+		}
+	}
+
+	value.value_type = MO_EXPR_TOKEN_STRING;
+	value.value_str = result;
+
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
+
+
+static moExpr::mo_expr_errno_t expr_func_regexpr(mo_expr_value_t& result, const mo_expr_value_t *param, long /*count*/)
+{
+	moRegularExpression	regexpr(param[0].value_str);
+	moVariableList		vars("regexpr()");
+
+	result.value_type = MO_EXPR_TOKEN_INTEGER;
+	result.value_int = regexpr.MatchExpression(param[1].value_str, &vars);
+
+#if 0
+fprintf(stderr, "\n***\n*** Does [%s] match [%s]? (%d)\n***\n",
+			param[0].value_str.MBData(),
+			param[1].value_str.MBData(),
+			result.value_int);
+#endif
+
+	if(!result.value_int && regexpr.LastError() != moRegularExpression::MO_REGEXPR_ERROR_NONE) {
+		return moExpr::MO_EXPR_ERROR_BADREGEXPR;
+	}
+
+	// TODO: set the vars in the following parameters (variables)
+
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
+
+
+
+static moExpr::mo_expr_errno_t expr_func_reg_replace(mo_expr_value_t& result, const mo_expr_value_t *param, long /*count*/)
+{
+	moRegularExpression	reg_replace(param[0].value_str);
+
+	result.value_type = MO_EXPR_TOKEN_STRING;
+	result.value_str = reg_replace.Replace(param[1].value_str, param[2].value_str);
+
+	if(result.value_str.IsEmpty() && reg_replace.LastError() != moRegularExpression::MO_REGEXPR_ERROR_NONE) {
+		return moExpr::MO_EXPR_ERROR_BADREGEXPR;
+	}
+
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
+
+
+
+static moExpr::mo_expr_errno_t expr_func_replace(mo_expr_value_t& result, const mo_expr_value_t *param, long /*count*/)
+{
+	result.value_type = MO_EXPR_TOKEN_STRING;
+	result.value_str = param[1].value_str.Replace(param[0].value_str);
+
+#if 0
+fprintf(stderr, "\n***\n*** Replacing [%s] using [%s] is [%s]\n***\n",
+			param[1].value_str.SavedMBData(),
+			param[0].value_str.SavedMBData(),
+			result.value_str.SavedMBData());
+#endif
+
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
+
+
+
+static moExpr::mo_expr_errno_t expr_func_included(mo_expr_value_t& result, const mo_expr_value_t *param, long count)
+{
+	long		idx;
 
-	case MO_EXPR_TOKEN_IDENTIFIER:
-		state.value.value_type = MO_EXPR_TOKEN_IDENTIFIER;
-		state.value.value_str = moWCString(state.start, static_cast<int>(state.end - state.start));
-		r = expr_token(state);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		switch(static_cast<int>(state.token)) {
-		case '(':
-		case '=':
-	   	case MO_EXPR_TOKEN_ASSIGN_POW:
-	   	case MO_EXPR_TOKEN_ASSIGN_MUL:
-	   	case MO_EXPR_TOKEN_ASSIGN_DIV:
-	   	case MO_EXPR_TOKEN_ASSIGN_MOD:
-	   	case MO_EXPR_TOKEN_ASSIGN_ADD:
-	   	case MO_EXPR_TOKEN_ASSIGN_SUB:
-	   	case MO_EXPR_TOKEN_ASSIGN_SHL:
-	   	case MO_EXPR_TOKEN_ASSIGN_SHR:
-	   	case MO_EXPR_TOKEN_ASSIGN_AND:
-	   	case MO_EXPR_TOKEN_ASSIGN_OR:
-	   	case MO_EXPR_TOKEN_ASSIGN_XOR:
-			// a function or assignment; don't do anything about this identifier!
-			return moExpr::MO_EXPR_ERROR_NONE;
+/* by default we find the 1st value in the following list */
+	result.value_type = MO_EXPR_TOKEN_INTEGER;
+	result.value_int = true;
 
-		default:
-			// in all other cases, that identifier is a variable name
+	idx = count;
+	while(idx > 1) {
+		idx--;
+		switch(param[0].value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+			switch(param[idx].value_type) {
+			case MO_EXPR_TOKEN_INTEGER:
+				if(param[0].value_int == param[idx].value_int) {
+					return moExpr::MO_EXPR_ERROR_NONE;
+				}
+				break;
+
+			default:
+				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+
+			}
 			break;
 
+		default:
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+
 		}
-		idx = state.count;
-		while(idx > 0) {
-			idx--;
-			if(state.value.value_str == state.variable[idx].name) {
-				// the variable exists, replace with its content
-				state.value.value_type = state.variable[idx].value_type;
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.variable[idx].value_int;
-					break;
+	}
+
+/* unfortunatly we didn't find it... */
+	result.value_int = false;
 
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = state.variable[idx].value_flt;
-					break;
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
 
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_str = state.variable[idx].value_str;
-					break;
 
-				default:;
-				}
-				return moExpr::MO_EXPR_ERROR_NONE;
-			}
+
+/************************************************************ internal functions */
+
+enum mo_expr_function_t {
+	MO_EXPR_FUNCTION_UNKNOWN = -1,
+	MO_EXPR_FUNCTION_ATOL,
+	MO_EXPR_FUNCTION_BASENAME,
+	MO_EXPR_FUNCTION_CAPITALIZE,
+	MO_EXPR_FUNCTION_CAPITALIZE_WORDS,
+	MO_EXPR_FUNCTION_CLIP,
+	MO_EXPR_FUNCTION_INCLUDED,
+	MO_EXPR_FUNCTION_LOWER,
+	MO_EXPR_FUNCTION_REG_REPLACE,
+	MO_EXPR_FUNCTION_REGEXPR,
+	MO_EXPR_FUNCTION_REPLACE,
+	MO_EXPR_FUNCTION_REVERSE,
+	MO_EXPR_FUNCTION_STRF,
+	MO_EXPR_FUNCTION_STRLEN,
+	MO_EXPR_FUNCTION_SWITCH_CASE,
+	MO_EXPR_FUNCTION_TRIM,
+	MO_EXPR_FUNCTION_UPPER,
+	MO_EXPR_FUNCTION_max
+};
+
+static const char *expr_function_names[MO_EXPR_FUNCTION_max] = {
+	"atol",
+	"basename",
+	"capitalize",
+	"capitalize_words",
+	"clip",
+	"included",
+	"lower",
+	"reg_replace",
+	"regexpr",
+	"replace",
+	"reverse",
+	"strf",
+	"strlen",
+	"switch_case",
+	"trim",
+	"upper"
+};
+
+
+static long expr_find_function(const moWCString& name)
+{
+	long		idx;
+
+	for(idx = 0; idx < MO_EXPR_FUNCTION_max; ++idx) {
+		if(name == expr_function_names[idx]) {
+			return idx;
 		}
-		fprintf(stderr, "ERROR: the variable named '%s' is not defined.\n", state.value.value_str.SavedMBData());
-		return moExpr::MO_EXPR_ERROR_VARUNDEFINED;
+	}
+
+	return MO_EXPR_FUNCTION_UNKNOWN;
+}
 
+
+// only the fields defined by the type are copied
+static void expr_copy(mo_expr_value_t& dst, const mo_expr_value_t& src)
+{
+	dst.value_type = src.value_type;
+	switch(src.value_type) {
 	case MO_EXPR_TOKEN_INTEGER:
-	{
-		/*
-		l = state.end - state.start;
-		if((unsigned long) l >= sizeof(buf)) {
-			l = sizeof(buf) - 1;
-		}
-		strncpy(buf, state.start, l);
-		buf[l] = '\0';
-		state.value.value_int = strtol(buf, 0, 0);
-		*/
-		moWCString i(state.start, static_cast<int>(state.end - state.start));
-		state.value.value_int = i.Integer();
-		state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-		return expr_token(state);
-	}
+		dst.value_int = src.value_int;
+		break;
 
 	case MO_EXPR_TOKEN_FLOAT:
-	{
-		/*
-		l = state.end - state.start;
-		if((unsigned long) l >= sizeof(buf)) {
-			l = sizeof(buf) - 1;
-		}
-		strncpy(buf, state.start, l);
-		buf[l] = '\0';
-		state.value.value_flt = strtod(buf, 0);
-		*/
-		moWCString f(state.start, static_cast<int>(state.end - state.start));
-		state.value.value_flt = f.Float();
-		state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-		return expr_token(state);
-	}
+		dst.value_flt = src.value_flt;
+		break;
 
 	case MO_EXPR_TOKEN_STRING:
-		// get the string without the quotes
-		state.value.value_str = moWCString(state.start + 1, static_cast<int>(state.end - state.start - 2)).FromBackslash();
-		state.value.value_type = MO_EXPR_TOKEN_STRING;
+	case MO_EXPR_TOKEN_IDENTIFIER:
+		dst.value_str = src.value_str;
+		break;
 
-		// concatanate all the following strings
-		r = expr_token(state);
-		while(r == moExpr::MO_EXPR_ERROR_NONE
-		   && state.token == MO_EXPR_TOKEN_STRING) {
-			state.value.value_str += moWCString(state.start + 1, static_cast<int>(state.end - state.start - 2));
-			r = expr_token(state);
-		}
-		return r;
+	default:;
+	}
+}
 
-	default:
-		// anything else is an error!
-		return moExpr::MO_EXPR_ERROR_SYNTAX;
 
+static bool expr_string_param(const mo_expr_value_t *param, long count)
+{
+	long		idx;
+
+	for(idx = 0; idx < count; ++idx) {
+		if(param[idx].value_type != MO_EXPR_TOKEN_STRING) {
+			return false;
+		}
 	}
 
-	return moExpr::MO_EXPR_ERROR_NONE;
+	return true;
 }
 
 
-#if 0
-static void expr_substate_init(mo_expr_state_t& state, mo_expr_state_t& sub_state)
+static moExpr::mo_expr_errno_t expr_call(long function, mo_expr_value_t& out, mo_expr_value_t *param, long count)
 {
-	sub_state.input = state.input;
-	sub_state.value.value_type = MO_EXPR_TOKEN_UNKNOWN;
-	sub_state.variable = state.variable;	// keep this pointer!
-}
+	moExpr::mo_expr_errno_t	r;
+	mo_expr_value_t		result;
 
+	r = moExpr::MO_EXPR_ERROR_NONE;
+	switch(function) {
+	case MO_EXPR_FUNCTION_STRF:
+		if(count < 1) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 1)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		r = expr_func_strf(result, param, count);
+		break;
 
-static void expr_substate_done(mo_expr_state_t& state, mo_expr_state_t& sub_state)
-{
-	state.input = sub_state.input;
-	state.token = sub_state.token;
-	state.start = sub_state.start;
-	state.end = sub_state.end;
-	state.value = sub_state.value;
-}
-#endif
+	case MO_EXPR_FUNCTION_STRLEN:
+		if(count != 1) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 1)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		result.value_int = static_cast<long>(param[0].value_str.Length());
+		result.value_type = MO_EXPR_TOKEN_INTEGER;
+		break;
 
+	case MO_EXPR_FUNCTION_BASENAME:
+		if(count < 1 || count > 2) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, count)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		if(count == 2) {
+			result.value_str = param[0].value_str.FilenameBasename(param[1].value_str);
+		}
+		else {
+			result.value_str = param[0].value_str.FilenameBasename("");
+		}
+		result.value_type = MO_EXPR_TOKEN_STRING;
+		break;
 
-struct expr_format_info {
-	long		position;	// position of the parameter
-	long		width;		// max. number of characters
-	long		width_pos;	// get the width there
-	long		precision;	// number of decimals
-	long		precision_pos;	// get the precision there
-	long		flags;		// a set of flags
+	case MO_EXPR_FUNCTION_CLIP:
+	case MO_EXPR_FUNCTION_TRIM:
+	case MO_EXPR_FUNCTION_UPPER:
+	case MO_EXPR_FUNCTION_LOWER:
+	case MO_EXPR_FUNCTION_SWITCH_CASE:
+	case MO_EXPR_FUNCTION_CAPITALIZE_WORDS:
+	case MO_EXPR_FUNCTION_CAPITALIZE:
+	case MO_EXPR_FUNCTION_REVERSE:
+		if(count != 1) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 1)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		switch(function) {
+		case MO_EXPR_FUNCTION_CLIP:
+			result.value_str = param[0].value_str.Clip();
+			break;
 
-			expr_format_info(void)
-			{
-				position = 1;
-			}
-};
+		case MO_EXPR_FUNCTION_TRIM:
+			result.value_str = param[0].value_str.Clip(moWCString::WC_STRING_CLIP_BOTH | moWCString::WC_STRING_CLIP_NEWLINE);
+			break;
 
-// flags
-static const long	EXPR_FMT_FORMAT		= 0x0001;	// show type format
-static const long	EXPR_FMT_ZERO		= 0x0002;	// zero padded
-static const long	EXPR_FMT_LEFT		= 0x0004;	// left adjusted
-static const long	EXPR_FMT_SPACE		= 0x0008;	// space for + sign
-static const long	EXPR_FMT_PLUS		= 0x0010;	// use + or -
-static const long	EXPR_FMT_THOUSANDS	= 0x0020;	// show thousands separator
-static const long	EXPR_FMT_UPPERCASE	= 0x0040;	// X, G, etc.
+		case MO_EXPR_FUNCTION_UPPER:
+			result.value_str = param[0].value_str.Uppercase();
+			break;
 
-// lengths
-static const long	EXPR_FMT_NOLENGTH	= 0x0000;
-static const long	EXPR_FMT_LENGTH_MASK	= 0xF000;
-static const long	EXPR_FMT_BYTE		= 0x1000;	// hh
-static const long	EXPR_FMT_SHORT		= 0x2000;	// h
-static const long	EXPR_FMT_LONG		= 0x3000;	// l
-static const long	EXPR_FMT_LONGLONG	= 0x4000;	// ll (q)
-static const long	EXPR_FMT_LONGDOUBLE	= 0x5000;	// L
-static const long	EXPR_FMT_INTMAX		= 0x6000;	// j
-static const long	EXPR_FMT_SIZE_T		= 0x7000;	// z (Z)
-static const long	EXPR_FMT_PTRDIFF_T	= 0x8000;	// t
+		case MO_EXPR_FUNCTION_LOWER:
+			result.value_str = param[0].value_str.Lowercase();
+			break;
 
-// types
-static const long	EXPR_FMT_NOTYPE		= 0x00000;	// invalid format!
-static const long	EXPR_FMT_TYPE_MASK	= 0xF0000;
-static const long	EXPR_FMT_INTEGER	= 0x10000;	// i, d
-static const long	EXPR_FMT_UNSIGNED	= 0x20000;	// u
-static const long	EXPR_FMT_OCTAL		= 0x30000;	// o
-static const long	EXPR_FMT_HEXA		= 0x40000;	// x, X (always uppercase)
-static const long	EXPR_FMT_EDOUBLE	= 0x50000;	// e, E
-static const long	EXPR_FMT_FDOUBLE	= 0x60000;	// f, F
-static const long	EXPR_FMT_GDOUBLE	= 0x70000;	// g, G
-static const long	EXPR_FMT_ADOUBLE	= 0x80000;	// a, A
-static const long	EXPR_FMT_CHARACTER	= 0x90000;	// c (C)
-static const long	EXPR_FMT_STRING		= 0xA0000;	// s (S)
-static const long	EXPR_FMT_POINTER	= 0xB0000;	// p
+		case MO_EXPR_FUNCTION_SWITCH_CASE:
+			result.value_str = param[0].value_str.Switchcase();
+			break;
 
+		case MO_EXPR_FUNCTION_CAPITALIZE_WORDS:
+			result.value_str = param[0].value_str.CapitalizeWords();
+			break;
 
-// The following parse (in order) the possible parameters available
-// in a string format for a printf()
-// The order is as follow:
-//	the position (<value>$)
-//	a flag (#, ,-,...)
-//	field width (possibly indirect: *[<value>$])
-//	precision (possibly indirect: .*[<value>$])
-//	length modifier (hh,h,l,ll,q,...)
-//	format (i,d,f,e,g,a...)
-// returns -1 when an error occurs and s is unchanged
+		case MO_EXPR_FUNCTION_CAPITALIZE:
+			result.value_str = param[0].value_str.Capitalize();
+			break;
 
-static int expr_func_strf_format(const mowc::wc_t *& s, expr_format_info& info)
-{
-	mowc::wc_t		c, *end;
-	const mowc::wc_t	*start;
-	bool			more;
-	long			value;
+		default: /* MO_EXPR_FUNCTION_REVERSE */
+			result.value_str = param[0].value_str.Reverse();
+			break;
 
-	start = s;
+		}
+		result.value_type = MO_EXPR_TOKEN_STRING;
+		break;
 
-// reset the info structure
-	// info.position unchanged! must be initialized to 1 by caller the very first time
-	info.width         = -1;
-	info.width_pos     = -1;
-	info.precision     = -1;
-	info.precision_pos = -1;
-	info.flags         = 0;
+	case MO_EXPR_FUNCTION_REGEXPR:
+		if(count < 2) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 2)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		r = expr_func_regexpr(result, param, count);
+		break;
 
-// position
-	if(*s >= '1' && *s <= '9') {
-		// position of the parameter to use
-		value = mowc::strtol(s, &end, 10);
-		// must be followed by a '$' to be a positioning arg.
-		// otherwise it's probably a width and is ignored here!
-		if(*end == '$') {
-			info.position = value;
-			s = end + 1;
+	case MO_EXPR_FUNCTION_REG_REPLACE:
+		if(count < 3) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 3)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		r = expr_func_reg_replace(result, param, count);
+		break;
+
+	case MO_EXPR_FUNCTION_REPLACE:
+		if(count < 2) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 2)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		r = expr_func_replace(result, param, count);
+		break;
+
+	case MO_EXPR_FUNCTION_ATOL:
+		if(count != 1) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+		}
+		if(!expr_string_param(param, 1)) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		}
+		result.value_int = param[0].value_str.Integer();
+		result.value_type = MO_EXPR_TOKEN_INTEGER;
+		break;
+
+	case MO_EXPR_FUNCTION_INCLUDED:
+		if(count < 2) {
+			return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
 		}
+		r = expr_func_included(result, param, count);
+		break;
+
+	default:
+		return moExpr::MO_EXPR_ERROR_UNKNOWN_FUNCTION;
+
+	}
+	if(r == moExpr::MO_EXPR_ERROR_NONE) {
+		expr_copy(out, result);
 	}
 
-// flags
-	more = true;
-	do {
-		c = *s++;
-		switch(c) {
-		case '#':
-			info.flags |= EXPR_FMT_FORMAT;
+	return r;
+}
+
+
+
+/************************************************************ operators */
+
+static moExpr::mo_expr_errno_t expr_unary_value(long op, mo_expr_value_t& value)
+{
+	switch(op) {
+	case '!':	// logical not
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+			value.value_int = !value.value_int;
+			break;
+
+		case MO_EXPR_TOKEN_FLOAT:
+			value.value_int = value.value_flt == 0.0;
+			value.value_type = MO_EXPR_TOKEN_INTEGER;
+			break;
+
+		case MO_EXPR_TOKEN_STRING:
+			value.value_str.Reverse();
+			break;
+
+		default:;
+		}
+		break;
+
+	case '~':	// bitwise not
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+			value.value_int = ~value.value_int;
 			break;
 
-		case '0':
-			info.flags |= EXPR_FMT_ZERO;
-			break;
+		case MO_EXPR_TOKEN_FLOAT:
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
 
-		case '-':
-			info.flags |= EXPR_FMT_LEFT;
+		case MO_EXPR_TOKEN_STRING:
+			value.value_str = value.value_str.Switchcase();
 			break;
 
-		case ' ':
-			info.flags |= EXPR_FMT_SPACE;
-			break;
+		default:;
+		}
+		break;
 
-		case '+':
-			info.flags |= EXPR_FMT_PLUS;
+	case '+':	// identity (C++ only)
+		if(value.value_type == MO_EXPR_TOKEN_STRING) {
+			value.value_str = value.value_str.Uppercase();
+		}
+		break;
+
+	case '-':
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+			value.value_int = -value.value_int;
 			break;
 
-		case '\'':
-			info.flags |= EXPR_FMT_THOUSANDS;
+		case MO_EXPR_TOKEN_FLOAT:
+			value.value_flt = -value.value_flt;
 			break;
 
-		default:
-			more = false;
+		case MO_EXPR_TOKEN_STRING:
+			value.value_str = value.value_str.Lowercase();
 			break;
 
+		default:;
 		}
-	} while(more);
+		break;
 
-// width
-	if(c == '*') {
-		// indirect width
-		c = *s;
-		if(c >= '1' && c <= '9') {
-			// specify a position!
-			info.width_pos = mowc::strtol(s, &end, 10);
-			if(end == 0 || *end != '$') {
-				s = start;
-				return -1;
-			}
-		}
-		else {
-			info.width_pos = -2;
-		}
-		s = end + 1;
-		c = *s++;
-	}
-	else if(c >= '1' && c <= '9') {
-		// direct width
-		info.width = mowc::strtol(s - 1, &end, 10);
-		s = end;
-		c = *s++;
 	}
 
-// precision
-	if(c == '.') {
-		c = *s++;
-		if(c == '*') {
-			// indirect precision
-			c = *s;
-			if(c >= '1' && c <= '9') {
-				info.precision_pos = mowc::strtol(s, &end, 10);
-				if(end == 0 || *end != '$') {
-					s = start;
-					return -1;
-				}
-			}
-			else {
-				info.precision_pos = -2;
-			}
-			s = end + 1;
-			c = *s++;
-		}
-		else if(c >= '1' && c <= '9') {
-			// direct precision
-			info.precision = mowc::strtol(s - 1, &end, 10);
-			s = end;
-			c = *s++;
-		}
-	}
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
 
-// length (only one length can be accepted!)
-	switch(c) {
-	case 'h':
-		if(*s == 'h') {
-			info.flags |= EXPR_FMT_BYTE;
-			s += 2;
-			c = s[-1];
-		}
-		else {
-			info.flags |= EXPR_FMT_SHORT;
-			c = *s++;
+
+static void expr_cast_value(long type, mo_expr_value_t& value)
+{
+	char		buf[256];	/* Flawfinder: ignore */
+
+	switch(type) {
+	case MO_EXPR_TOKEN_INTEGER:
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_FLOAT:
+			value.value_int = (long) value.value_flt;
+			value.value_type = MO_EXPR_TOKEN_INTEGER;
+			break;
+
+		case MO_EXPR_TOKEN_STRING:
+			value.value_int = value.value_str.Integer();
+			value.value_type = MO_EXPR_TOKEN_INTEGER;
+			break;
+
+		default:;
 		}
 		break;
 
-	case 'l':
-		if(*s == 'l') {
-			info.flags |= EXPR_FMT_LONGLONG;
-			s += 2;
-			c = s[-1];
-		}
-		else {
-			info.flags |= EXPR_FMT_LONG;
-			c = *s++;
+	case MO_EXPR_TOKEN_FLOAT:
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+			value.value_flt = (double) value.value_int;
+			value.value_type = MO_EXPR_TOKEN_FLOAT;
+			break;
+
+		case MO_EXPR_TOKEN_STRING:
+			value.value_flt = value.value_str.Float();
+			value.value_type = MO_EXPR_TOKEN_FLOAT;
+			break;
+
+		default:;
 		}
 		break;
 
-	case 'L':
-		info.flags |= EXPR_FMT_LONGDOUBLE;
-		c = *s++;
-		break;
+	case MO_EXPR_TOKEN_STRING:
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+			sprintf(buf, "%ld", value.value_int);	/* Flawfinder: ignore */
+			value.value_str = buf;
+			value.value_type = MO_EXPR_TOKEN_STRING;
+			break;
 
-	case 'j':
-		info.flags |= EXPR_FMT_INTMAX;
-		c = *s++;
-		break;
+		case MO_EXPR_TOKEN_FLOAT:
+			sprintf(buf, "%g", value.value_flt);	/* Flawfinder: ignore */
+			value.value_str = buf;
+			value.value_type = MO_EXPR_TOKEN_STRING;
+			break;
 
-	case 'z':
-	case 'Z':
-		info.flags |= EXPR_FMT_SIZE_T;
-		c = *s++;
+		default:;
+		}
 		break;
 
-	case 't':
-		info.flags |= EXPR_FMT_PTRDIFF_T;
-		c = *s++;
-		break;
+	}
+}
+
+
+static bool expr_is_number(const mo_expr_value_t& value)
+{
+	return value.value_type == MO_EXPR_TOKEN_INTEGER
+		|| value.value_type == MO_EXPR_TOKEN_FLOAT;
+}
+
+
+static double expr_to_double(const mo_expr_value_t& value)
+{
+	return value.value_type == MO_EXPR_TOKEN_INTEGER ? (double) value.value_int : value.value_flt;
+}
+
+
+// the truth of a value as used by the logical operators and ?:
+// returns false in valid when the type can't be tested
+static bool expr_truth(const mo_expr_value_t& value, bool& valid)
+{
+	valid = true;
+	switch(value.value_type) {
+	case MO_EXPR_TOKEN_INTEGER:
+		return value.value_int != 0;
+
+	case MO_EXPR_TOKEN_FLOAT:
+		return value.value_flt != 0;
+
+	case MO_EXPR_TOKEN_STRING:
+		return !value.value_str.IsEmpty();
+
+	default:
+		valid = false;
+		return false;
 
 	}
+}
 
-// check the format now (only one format possible!)
-	switch(c) {
-	case 'i':
-	case 'd':
-		info.flags |= EXPR_FMT_INTEGER;
-		break;
 
-	case 'u':
-		info.flags |= EXPR_FMT_UNSIGNED;
-		break;
+// apply a binary operator; the result is saved in left
+static moExpr::mo_expr_errno_t expr_binary_value(long op, mo_expr_value_t& left, const mo_expr_value_t& right)
+{
+	long		v, e;
+	int		c;
+	bool		l, r, lvalid, rvalid;
+
+	switch(op) {
+	case MO_EXPR_TOKEN_POWER:
+		if(left.value_type == MO_EXPR_TOKEN_INTEGER
+		&& right.value_type == MO_EXPR_TOKEN_INTEGER) {
+			// no overflow check...
+			if(right.value_int < 0) {
+				left.value_int = 0;
+			}
+			else {
+				v = left.value_int;
+				left.value_int = 1;
+				for(e = right.value_int; e > 0; --e) {
+					left.value_int *= v;
+				}
+			}
+		}
+		else if(expr_is_number(left) && expr_is_number(right)) {
+			left.value_flt = pow(expr_to_double(left), expr_to_double(right));
+			left.value_type = MO_EXPR_TOKEN_FLOAT;
+		}
+		return moExpr::MO_EXPR_ERROR_NONE;
 
-	case 'o':
-		info.flags |= EXPR_FMT_OCTAL;
-		break;
+	case '*':
+	case '/':
+	case '%':
+	case '+':
+	case '-':
+		if(op == '/' || op == '%') {
+			if((right.value_type == MO_EXPR_TOKEN_INTEGER && right.value_int == 0)
+			|| (right.value_type == MO_EXPR_TOKEN_FLOAT && right.value_flt == 0.0)) {
+				return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
+			}
+		}
+		if(left.value_type == MO_EXPR_TOKEN_INTEGER
+		&& right.value_type == MO_EXPR_TOKEN_INTEGER) {
+			switch(op) {
+			case '*':
+				left.value_int *= right.value_int;
+				break;
 
-	case 'x':
-		info.flags |= EXPR_FMT_HEXA;
-		break;
+			case '/':
+				left.value_int /= right.value_int;
+				break;
 
-	case 'X':
-		info.flags |= EXPR_FMT_HEXA | EXPR_FMT_UPPERCASE;
-		break;
+			case '%':
+				left.value_int %= right.value_int;
+				break;
 
-	case 'e':
-		info.flags |= EXPR_FMT_EDOUBLE;
-		break;
+			case '+':
+				left.value_int += right.value_int;
+				break;
 
-	case 'E':
-		info.flags |= EXPR_FMT_EDOUBLE | EXPR_FMT_UPPERCASE;
-		break;
+			case '-':
+				left.value_int -= right.value_int;
+				break;
 
-	case 'f':
-	case 'F':		// that's useless, 'F' is like 'f'
-		info.flags |= EXPR_FMT_FDOUBLE;
-		break;
+			}
+		}
+		else if(expr_is_number(left) && expr_is_number(right)) {
+			double a = expr_to_double(left);
+			double b = expr_to_double(right);
+			switch(op) {
+			case '*':
+				left.value_flt = a * b;
+				break;
 
-	case 'g':
-		info.flags |= EXPR_FMT_GDOUBLE;
-		break;
+			case '/':
+				left.value_flt = a / b;
+				break;
 
-	case 'G':
-		info.flags |= EXPR_FMT_GDOUBLE | EXPR_FMT_UPPERCASE;
-		break;
+			case '%':
+				left.value_flt = fmod(a, b);
+				break;
 
-	case 'a':
-		info.flags |= EXPR_FMT_ADOUBLE;
-		break;
+			case '+':
+				left.value_flt = a + b;
+				break;
 
-	case 'A':
-		info.flags |= EXPR_FMT_ADOUBLE | EXPR_FMT_UPPERCASE;
-		break;
+			case '-':
+				left.value_flt = a - b;
+				break;
 
-	case 'c':
-	case 'C':
-		info.flags = (info.flags & ~EXPR_FMT_LENGTH_MASK)
-					| EXPR_FMT_LONGLONG | EXPR_FMT_CHARACTER;
-		break;
+			}
+			left.value_type = MO_EXPR_TOKEN_FLOAT;
+		}
+		else if(op == '+'
+		     && left.value_type == MO_EXPR_TOKEN_STRING
+		     && right.value_type == MO_EXPR_TOKEN_STRING) {
+			left.value_str += right.value_str;
+		}
+		// other types are silently ignored
+		return moExpr::MO_EXPR_ERROR_NONE;
+
+	case MO_EXPR_TOKEN_SHIFT_LEFT:
+	case MO_EXPR_TOKEN_SHIFT_RIGHT:
+	case '&':
+	case '^':
+	case '|':
+		if(left.value_type != MO_EXPR_TOKEN_INTEGER
+		|| right.value_type != MO_EXPR_TOKEN_INTEGER) {
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
+		}
+		switch(op) {
+		case MO_EXPR_TOKEN_SHIFT_LEFT:
+			left.value_int <<= right.value_int;
+			break;
+
+		case MO_EXPR_TOKEN_SHIFT_RIGHT:
+			left.value_int >>= right.value_int;
+			break;
+
+		case '&':
+			left.value_int &= right.value_int;
+			break;
 
-	case 's':
-	case 'S':
-		info.flags = (info.flags & ~EXPR_FMT_LENGTH_MASK)
-					| EXPR_FMT_LONGLONG | EXPR_FMT_STRING;
-		break;
+		case '^':
+			left.value_int ^= right.value_int;
+			break;
 
-	case 'p':
-		info.flags |= EXPR_FMT_POINTER;
-		break;
+		case '|':
+			left.value_int |= right.value_int;
+			break;
 
-	default:
-		s = start;
-		return -1;
+		}
+		return moExpr::MO_EXPR_ERROR_NONE;
 
-	}
+	case '<':
+	case '>':
+	case MO_EXPR_TOKEN_LESS_EQUAL:
+	case MO_EXPR_TOKEN_GREATER_EQUAL:
+	case MO_EXPR_TOKEN_EQUAL:
+	case MO_EXPR_TOKEN_NOT_EQUAL:
+		if(left.value_type == MO_EXPR_TOKEN_INTEGER
+		&& right.value_type == MO_EXPR_TOKEN_INTEGER) {
+			c = left.value_int < right.value_int ? -1 : (left.value_int > right.value_int ? 1 : 0);
+		}
+		else if(expr_is_number(left) && expr_is_number(right)) {
+			double a = expr_to_double(left);
+			double b = expr_to_double(right);
+			// NaN compares as "not equal" and nothing else
+			c = a < b ? -1 : (a > b ? 1 : (a == b ? 0 : 2));
+		}
+		else if(left.value_type == MO_EXPR_TOKEN_STRING
+		     && right.value_type == MO_EXPR_TOKEN_STRING) {
+			c = mowc::strcmp(left.value_str.Data(), right.value_str.Data());
+			c = c < 0 ? -1 : (c > 0 ? 1 : 0);
+		}
+		else {
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
+		}
+		switch(op) {
+		case '<':
+			left.value_int = c == -1;
+			break;
 
-	return 0;
-}
+		case '>':
+			left.value_int = c == 1;
+			break;
 
+		case MO_EXPR_TOKEN_LESS_EQUAL:
+			left.value_int = c == -1 || c == 0;
+			break;
 
-static moWCString expr_func_strf_apply(mo_expr_state_t& params, expr_format_info& info)
-{
-	char		fmt[256];	/* Flawfinder: ignore */
-	int		r;
+		case MO_EXPR_TOKEN_GREATER_EQUAL:
+			left.value_int = c == 1 || c == 0;
+			break;
 
-	r = 1;
-	fmt[0] = '%';
-	fmt[1] = '\0';
+		case MO_EXPR_TOKEN_EQUAL:
+			left.value_int = c == 0;
+			break;
 
-// insert flags
-	if((info.flags & EXPR_FMT_FORMAT) != 0) {
-		fmt[r++] = '#';
-	}
-	if((info.flags & EXPR_FMT_ZERO) != 0) {
-		fmt[r++] = '0';
-	}
-	if((info.flags & EXPR_FMT_LEFT) != 0) {
-		fmt[r++] = '-';
-	}
-	if((info.flags & EXPR_FMT_SPACE) != 0) {
-		fmt[r++] = ' ';
-	}
-	else if((info.flags & EXPR_FMT_PLUS) != 0) {
-		fmt[r++] = '+';
-	}
-	if((info.flags & EXPR_FMT_THOUSANDS) != 0) {
-		fmt[r++] = '\'';
-	}
+		default: /* MO_EXPR_TOKEN_NOT_EQUAL */
+			left.value_int = c != 0;
+			break;
 
-// check for a width
-	if(info.width_pos > 0) {
-		// get the width from the parameters at the given position
-		if(info.width_pos >= params.param_count
-		|| info.width_pos >= MO_EXPR_PARAM_MAX) {
-			// position out of range
-			return "";
-		}
-		info.position = info.width_pos;
-		if(params.param[info.position].value_type != MO_EXPR_TOKEN_INTEGER) {
-			// position need to be an integer
-			return "";
-		}
-		info.width = params.param[info.position].value_int;
-		info.position++;
-	}
-	else if(info.width_pos == -2) {
-		if(info.position >= params.param_count
-		|| info.position >= MO_EXPR_PARAM_MAX) {
-			// position out of range
-			return "";
 		}
-		info.width = params.param[info.position].value_int;
-		info.position++;
-	}
-	if(info.width > 0) {
-		r += sprintf(fmt + r, "%ld", info.width);	/* Flawfinder: ignore */
-	}
+		left.value_type = MO_EXPR_TOKEN_INTEGER;
+		return moExpr::MO_EXPR_ERROR_NONE;
 
-// check for a precision
-	if(info.precision_pos > 0) {
-		// get the width from the parameters at the given position
-		if(info.precision_pos >= params.param_count
-		|| info.precision_pos >= MO_EXPR_PARAM_MAX) {
-			// position out of range
-			return "";
-		}
-		info.position = info.precision_pos;
-		if(params.param[info.position].value_type != MO_EXPR_TOKEN_INTEGER) {
-			// position need to be an integer
-			return "";
-		}
-		info.precision = params.param[info.position].value_int;
-		info.position++;
-	}
-	else if(info.precision_pos == -2) {
-		if(info.position >= params.param_count
-		|| info.position >= MO_EXPR_PARAM_MAX) {
-			// position out of range
-			return "";
+	case MO_EXPR_TOKEN_LOGICAL_AND:
+	case MO_EXPR_TOKEN_LOGICAL_XOR:
+	case MO_EXPR_TOKEN_LOGICAL_OR:
+		l = expr_truth(left, lvalid);
+		r = expr_truth(right, rvalid);
+		if(!lvalid || !rvalid) {
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
 		}
-		info.precision = params.param[info.position].value_int;
-		info.position++;
-	}
-	if(info.precision >= 0) {
-		r += sprintf(fmt + r, ".%ld", info.precision);	/* Flawfinder: ignore */
-	}
+		switch(op) {
+		case MO_EXPR_TOKEN_LOGICAL_AND:
+			left.value_int = l && r;
+			break;
 
-// insert the length
-#if 0
-	// we really only offer the default types (long, wc_t, wc_t *, ...)
-	switch(info.flags & EXPR_FMT_LENGTH_MASK) {
-	case EXPR_FMT_BYTE:
-		fmt[r++] = 'h';
-		fmt[r++] = 'h';
-		break;
+		case MO_EXPR_TOKEN_LOGICAL_XOR:
+			left.value_int = l ^ r;
+			break;
 
-	case EXPR_FMT_SHORT:
-		fmt[r++] = 'h';
-		break;
+		default: /* MO_EXPR_TOKEN_LOGICAL_OR */
+			left.value_int = l || r;
+			break;
 
-	case EXPR_FMT_LONG:
-		fmt[r++] = 'l';
-		break;
+		}
+		left.value_type = MO_EXPR_TOKEN_INTEGER;
+		return moExpr::MO_EXPR_ERROR_NONE;
 
-	case EXPR_FMT_LONGLONG:
-		fmt[r++] = 'l';
-		fmt[r++] = 'l';
-		break;
+	}
 
-	case EXPR_FMT_LONGDOUBLE:
-		fmt[r++] = 'L';
-		break;
+	/*NOTREACHED*/
+	return moExpr::MO_EXPR_ERROR_SYNTAX;
+}
 
-	case EXPR_FMT_INTMAX:
-		fmt[r++] = 'j';
-		break;
 
-	case EXPR_FMT_SIZE_T:
-		fmt[r++] = 'z';
-		break;
+// save value in a variable with one of the assignment operators;
+// the compound operators only accept numbers (integers for the
+// shifts and bitwise operators)
+static moExpr::mo_expr_errno_t expr_assign_value(long op, mo_expr_value_t& variable, const mo_expr_value_t& value)
+{
+	long		binary;
+	bool		integer_only;
 
-	case EXPR_FMT_PTRDIFF_T:
-		fmt[r++] = 't';
-		break;
+	if(op == '=') {
+		variable.value_type = value.value_type;
+		switch(value.value_type) {
+		case MO_EXPR_TOKEN_INTEGER:
+		case MO_EXPR_TOKEN_FLOAT:
+		case MO_EXPR_TOKEN_STRING:
+			expr_copy(variable, value);
+			return moExpr::MO_EXPR_ERROR_NONE;
 
-	// case EXPR_FMT_UNKNOWN - undefined, keep the default
+		default:
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
+
+		}
 	}
-#endif
 
-// insert the type
-	switch(info.flags & EXPR_FMT_TYPE_MASK) {
-	case EXPR_FMT_INTEGER:
-		fmt[r++] = 'l';
-		fmt[r++] = 'd';
+	integer_only = false;
+	switch(op) {
+	case MO_EXPR_TOKEN_ASSIGN_POW:
+		binary = MO_EXPR_TOKEN_POWER;
 		break;
 
-	case EXPR_FMT_UNSIGNED:
-		fmt[r++] = 'l';
-		fmt[r++] = 'u';
+	case MO_EXPR_TOKEN_ASSIGN_MUL:
+		binary = '*';
 		break;
 
-	case EXPR_FMT_OCTAL:
-		fmt[r++] = 'l';
-		fmt[r++] = 'o';
+	case MO_EXPR_TOKEN_ASSIGN_DIV:
+		binary = '/';
 		break;
 
-	case EXPR_FMT_HEXA:
-		fmt[r++] = 'l';
-		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'X' : 'x';
+	case MO_EXPR_TOKEN_ASSIGN_MOD:
+		binary = '%';
 		break;
 
-	case EXPR_FMT_EDOUBLE:
-		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'E' : 'e';
+	case MO_EXPR_TOKEN_ASSIGN_ADD:
+		binary = '+';
 		break;
 
-	case EXPR_FMT_FDOUBLE:
-		fmt[r++] = 'f';
+	case MO_EXPR_TOKEN_ASSIGN_SUB:
+		binary = '-';
 		break;
 
-	case EXPR_FMT_GDOUBLE:
-		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'G' : 'g';
+	case MO_EXPR_TOKEN_ASSIGN_SHL:
+		binary = MO_EXPR_TOKEN_SHIFT_LEFT;
+		integer_only = true;
 		break;
 
-	case EXPR_FMT_ADOUBLE:
-		fmt[r++] = (info.flags & EXPR_FMT_UPPERCASE) ? 'A' : 'a';
+	case MO_EXPR_TOKEN_ASSIGN_SHR:
+		binary = MO_EXPR_TOKEN_SHIFT_RIGHT;
+		integer_only = true;
 		break;
 
-	case EXPR_FMT_CHARACTER:
-		fmt[r++] = 'l';
-		fmt[r++] = 'l';
-		fmt[r++] = 'c';
+	case MO_EXPR_TOKEN_ASSIGN_AND:
+		binary = '&';
+		integer_only = true;
 		break;
 
-	case EXPR_FMT_STRING:
-		fmt[r++] = 'l';
-		fmt[r++] = 'l';
-		fmt[r++] = 's';
+	case MO_EXPR_TOKEN_ASSIGN_OR:
+		binary = '|';
+		integer_only = true;
 		break;
 
-	case EXPR_FMT_POINTER:
-		// there is no notion of pointer in this expression!
-		return "<no ptr>";
+	case MO_EXPR_TOKEN_ASSIGN_XOR:
+		binary = '^';
+		integer_only = true;
+		break;
 
-	}
+	default:
+		return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
 
-	if(info.position >= params.param_count
-	|| info.position >= MO_EXPR_PARAM_MAX) {
-		// that parameter doesn't exist!
-		return "";
 	}
-	fmt[r] = '\0';
-
-// get the parameter
-	switch(info.flags & EXPR_FMT_TYPE_MASK) {
-	case EXPR_FMT_INTEGER:
-	case EXPR_FMT_UNSIGNED:
-	case EXPR_FMT_OCTAL:
-	case EXPR_FMT_HEXA:
-	case EXPR_FMT_CHARACTER:
-		if(params.param[info.position].value_type != MO_EXPR_TOKEN_INTEGER) {
-			// format/type mismatch
-			return "";
-		}
-		return moWCString::Format(fmt, mowc::MO_ENCODING_UTF8, params.param[info.position++].value_int);
-
-	case EXPR_FMT_EDOUBLE:
-	case EXPR_FMT_FDOUBLE:
-	case EXPR_FMT_GDOUBLE:
-	case EXPR_FMT_ADOUBLE:
-		if(params.param[info.position].value_type != MO_EXPR_TOKEN_FLOAT) {
-			// format/type mismatch
-			return "";
-		}
-		return moWCString::Format(fmt, mowc::MO_ENCODING_UTF8, params.param[info.position++].value_flt);
 
-	case EXPR_FMT_STRING:
-		if(params.param[info.position].value_type != MO_EXPR_TOKEN_STRING) {
-			// format/type mismatch
-			return "";
+	if(integer_only) {
+		if(variable.value_type != MO_EXPR_TOKEN_INTEGER
+		|| value.value_type != MO_EXPR_TOKEN_INTEGER) {
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
 		}
-		return moWCString::Format(fmt, mowc::MO_ENCODING_UTF8, params.param[info.position++].value_str.Data());
-
+	}
+	else if(!expr_is_number(variable) || !expr_is_number(value)) {
+		return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
 	}
 
-	return "";
+	return expr_binary_value(binary, variable, value);
 }
 
 
-static moExpr::mo_expr_errno_t expr_func_strf(mo_expr_state_t& state, mo_expr_state_t& params)
-{
-	// here we have to parse the format because the parameters
-	// are not in standard args...
-	// Note that the positioning has to be handled by us also
-	// (see the *.*$ and <value>$ notation of printf().
-
-	const mowc::wc_t	*s;
-	mowc::wc_t		c;
-	int			r;
-	moWCString		result;
-	expr_format_info	info;
-
-	// get the format
-	s = params.param[0].value_str.Data();
-	while(*s != '\0') {
-		c = *s++;
-		switch(c) {
-		case '%':
-			if(*s != '%') {
-				r = expr_func_strf_format(s, info);
-
-#if 0
-fprintf(stderr, "Checked format [%s] -> %d\n", s, r);
-fprintf(stderr, "  info.position      = %ld\n", info.position);
-fprintf(stderr, "  info.width         = %ld\n", info.width);
-fprintf(stderr, "  info.width_pos     = %ld\n", info.width_pos);
-fprintf(stderr, "  info.precision     = %ld\n", info.precision);
-fprintf(stderr, "  info.precision_pos = %ld\n", info.precision_pos);
-fprintf(stderr, "  info.flags         = 0x%08lX\n", info.flags);
-#endif
 
-				if(r == 0) {	// apply only valid formats
-					result += expr_func_strf_apply(params, info);
-				}
-				break;
-			}
-			/*FALLTHROUGH*/
-		default:
-			result += c;
-			break;
+/************************************************************ compiler */
 
-		case '\\':
-			c = static_cast<mowc::wc_t>(mowc::backslash_char(s));
-			result += c;
-			break;
+static unsigned long expr_code_size(mo_expr_state_t& state)
+{
+	return static_cast<unsigned long>(state.code->f_code.size());
+}
 
-		}
-	}
 
-	state.value.value_type = MO_EXPR_TOKEN_STRING;
-	state.value.value_str = result;
+static void expr_emit(mo_expr_state_t& state, mo_expr_opcode_t opcode, long arg = 0, long arg2 = 0)
+{
+	mo_expr_instruction_t	instruction;
 
-	return moExpr::MO_EXPR_ERROR_NONE;
+	instruction.opcode = opcode;
+	instruction.arg = arg;
+	instruction.arg2 = arg2;
+	state.code->f_code.push_back(instruction);
 }
 
 
-static moExpr::mo_expr_errno_t expr_func_regexpr(mo_expr_state_t& state, mo_expr_state_t& params)
+static void expr_push(mo_expr_state_t& state, const mo_expr_value_t& value)
 {
-	moRegularExpression	regexpr(params.param[0].value_str);
-	moVariableList		vars("regexpr()");
+	state.code->f_constants.push_back(value);
+	expr_emit(state, MO_EXPR_OP_PUSH, static_cast<long>(state.code->f_constants.size() - 1));
+}
 
-	state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-	state.value.value_int = regexpr.MatchExpression(params.param[1].value_str, &vars);
 
-#if 0
-fprintf(stderr, "\n***\n*** Does [%s] match [%s]? (%d)\n***\n",
-			params.param[0].value_str.MBData(),
-			params.param[1].value_str.MBData(),
-			state.value.value_int);
-#endif
+// whether the code from start on is one constant; if so it is
+// returned in value
+static bool expr_constant_at(mo_expr_state_t& state, unsigned long start, mo_expr_value_t& value)
+{
+	const std::vector<mo_expr_instruction_t>& code = state.code->f_code;
 
-	if(!state.value.value_int && regexpr.LastError() != moRegularExpression::MO_REGEXPR_ERROR_NONE) {
-		return moExpr::MO_EXPR_ERROR_BADREGEXPR;
+	if(code.size() != start + 1 || code[start].opcode != MO_EXPR_OP_PUSH) {
+		return false;
 	}
+	value = state.code->f_constants[code[start].arg];
 
-	// TODO: set the vars in the following parameters (variables)
-
-	return moExpr::MO_EXPR_ERROR_NONE;
+	return true;
 }
 
 
-
-static moExpr::mo_expr_errno_t expr_func_reg_replace(mo_expr_state_t& state, mo_expr_state_t& params)
+static long expr_find_slot(mo_expr_state_t& state, const moWCString& name)
 {
-	moRegularExpression	reg_replace(params.param[0].value_str);
-
-	state.value.value_type = MO_EXPR_TOKEN_STRING;
-	state.value.value_str = reg_replace.Replace(params.param[1].value_str, params.param[2].value_str);
+	long		idx;
 
-	if(state.value.value_str.IsEmpty() && reg_replace.LastError() != moRegularExpression::MO_REGEXPR_ERROR_NONE) {
-		return moExpr::MO_EXPR_ERROR_BADREGEXPR;
+	idx = static_cast<long>(state.code->f_slot_names.size());
+	while(idx > 0) {
+		idx--;
+		if(state.code->f_slot_names[idx] == name) {
+			return idx;
+		}
 	}
 
-	return moExpr::MO_EXPR_ERROR_NONE;
+	return -1;
 }
 
 
-
-static moExpr::mo_expr_errno_t expr_func_replace(mo_expr_state_t& state, mo_expr_state_t& params)
+// names used before they are assigned are inputs of the program
+static long expr_input_slot(mo_expr_state_t& state, const moWCString& name)
 {
-	state.value.value_type = MO_EXPR_TOKEN_STRING;
-	state.value.value_str = params.param[1].value_str.Replace(params.param[0].value_str);
+	long		slot;
 
-#if 0
-fprintf(stderr, "\n***\n*** Replacing [%s] using [%s] is [%s]\n***\n",
-			params.param[1].value_str.SavedMBData(),
-			params.param[0].value_str.SavedMBData(),
-			state.value.value_str.SavedMBData());
-#endif
+	slot = static_cast<long>(state.code->f_slot_names.size());
+	state.code->f_slot_names.push_back(name);
+	state.code->f_slot_inputs.push_back(static_cast<long>(state.code->f_inputs.size()));
+	state.code->f_inputs.push_back(slot);
 
-	return moExpr::MO_EXPR_ERROR_NONE;
+	return slot;
 }
 
 
-
-static moExpr::mo_expr_errno_t expr_func_included(mo_expr_state_t& state, mo_expr_state_t& params)
+static long expr_stack_effect(const mo_expr_instruction_t& instruction)
 {
-	long		idx;
+	switch(instruction.opcode) {
+	case MO_EXPR_OP_PUSH:
+	case MO_EXPR_OP_LOAD:
+		return 1;
+
+	case MO_EXPR_OP_POP:
+	case MO_EXPR_OP_BINARY:
+	case MO_EXPR_OP_SELECT_NOELSE:
+		return -1;
 
-/* by default we find the 1st value in the following list */
-	state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-	state.value.value_int = true;
+	case MO_EXPR_OP_SELECT:
+		return -2;
 
-	idx = params.param_count;
-	while(idx > 1) {
-		idx--;
-		switch(params.param[0].value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(params.param[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				if(params.param[0].value_int == params.param[idx].value_int) {
-					return moExpr::MO_EXPR_ERROR_NONE;
-				}
-				break;
+	case MO_EXPR_OP_SUBSTR:
+		return -((instruction.arg & MO_EXPR_SUBSTR_FROM) != 0 ? 1 : 0)
+			- ((instruction.arg & MO_EXPR_SUBSTR_TO) != 0 ? 1 : 0);
 
-			default:
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+	case MO_EXPR_OP_CALL:
+		return 1 - instruction.arg2;
 
-			}
-			break;
+	case MO_EXPR_OP_CALL_NAMED:
+		return -instruction.arg2;
 
-		default:
-			return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+	default:
+		return 0;
+
+	}
+}
+
+
+static unsigned long expr_stack_size(const std::vector<mo_expr_instruction_t>& code, unsigned long begin, unsigned long end)
+{
+	long		depth, max;
 
+	depth = 0;
+	max = 1;
+	for(; begin < end; ++begin) {
+		depth += expr_stack_effect(code[begin]);
+		if(depth > max) {
+			max = depth;
 		}
 	}
 
-/* unfortunatly we didn't find it... */
-	state.value.value_int = false;
+	return static_cast<unsigned long>(max);
+}
 
-	return moExpr::MO_EXPR_ERROR_NONE;
+
+// Replace the code from start on with its result when it only
+// depends on constants (no variables and no failure); since the
+// operators have no side effects that's always safe.
+static void expr_fold(mo_expr_state_t& state, unsigned long start)
+{
+	std::vector<mo_expr_instruction_t>& code = state.code->f_code;
+	unsigned long				idx, end;
+	long					sp;
+
+	end = static_cast<unsigned long>(code.size());
+	if(end <= start + 1) {
+		return;
+	}
+	for(idx = start; idx < end; ++idx) {
+		switch(code[idx].opcode) {
+		case MO_EXPR_OP_LOAD:
+		case MO_EXPR_OP_DEFINE:
+		case MO_EXPR_OP_CHECK_DEFINED:
+		case MO_EXPR_OP_ASSIGN:
+		case MO_EXPR_OP_FAIL:
+			return;
+
+		default:;
+		}
+	}
+
+	std::vector<mo_expr_value_t> stack(expr_stack_size(code, start, end));
+	sp = 0;
+	if(expr_run(*state.code, start, end, &stack[0], sp, 0) != moExpr::MO_EXPR_ERROR_NONE
+	|| sp != 1) {
+		// errors are reported when the program runs
+		return;
+	}
+	code.resize(start);
+	expr_push(state, stack[0]);
 }
 
 
-static moExpr::mo_expr_errno_t expr_array_func(mo_expr_state_t& state, bool get_token)
+static moExpr::mo_expr_errno_t expr_unary(mo_expr_state_t& state, bool get_token)
 {
 	moExpr::mo_expr_errno_t	r;
-	long			from, to;
+	long			l, op, slot;
+	mo_expr_token_t		cast;
+	unsigned long		start;
+	mo_expr_value_t		value;
 
-	r = expr_unary(state, get_token);
-	if(r != moExpr::MO_EXPR_ERROR_NONE) {
-		return r;
+	if(get_token) {
+		r = expr_token(state);
+		if(r != moExpr::MO_EXPR_ERROR_NONE) {
+			return r;
+		}
 	}
 
-	if(state.token == '[') {
-		// array!
-		if(state.value.value_type != MO_EXPR_TOKEN_STRING) {
-			return moExpr::MO_EXPR_ERROR_ARRAY;
-		}
-		mo_expr_state_t sub_state(state);
-		r = expr_token(sub_state);
+	start = expr_code_size(state);
+	switch(static_cast<int>(state.token)) {
+	case '!':	// logical not
+	case '~':	// bitwise not
+	case '+':	// identity (C++ only)
+	case '-':	// negate
+		op = state.token;
+		r = expr_prefix_inc(state, true);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
 		}
-		if(sub_state.token == MO_EXPR_TOKEN_RANGE) {
-			// from the beginning
-			from = 0;
+		expr_emit(state, MO_EXPR_OP_UNARY, op);
+		expr_fold(state, start);
+		break;
+
+	case '(':
+		r = expr_token(state);
+		if(r != moExpr::MO_EXPR_ERROR_NONE) {
+			return r;
 		}
-		else {
-			r = expr_comma(sub_state, false);
-			if(r != moExpr::MO_EXPR_ERROR_NONE) {
-				return r;
-			}
-			if(sub_state.value.value_type != MO_EXPR_TOKEN_INTEGER) {
-				// we can only index with an integer at this time
-				return moExpr::MO_EXPR_ERROR_INDEX;
+		if(state.token == MO_EXPR_TOKEN_IDENTIFIER) {
+			l = static_cast<long>(state.end - state.start);
+			// check for casts
+			cast = MO_EXPR_TOKEN_UNKNOWN;
+			if((l == 4 && mowc::strcmp(state.start, "long", l) == 0)
+			|| (l == 3 && mowc::strcmp(state.start, "int",  l) == 0)) {
+				cast = MO_EXPR_TOKEN_INTEGER;
 			}
-			from = sub_state.value.value_int;
-		}
-		if(sub_state.token == MO_EXPR_TOKEN_RANGE) {
-			r = expr_token(sub_state);	// get second value
-			if(r != moExpr::MO_EXPR_ERROR_NONE) {
-				return r;
+			else if((l == 5 && mowc::strcmp(state.start, "float", l) == 0)
+			     || (l == 6 && mowc::strcmp(state.start, "double", l) == 0)) {
+				cast = MO_EXPR_TOKEN_FLOAT;
 			}
-			if(sub_state.token == ']') {
-				// up to the end
-				to = static_cast<long>(state.value.value_str.Length() - 1);
+			else if(l == 6 && mowc::strcmp(state.start, "string", l) == 0) {
+				cast = MO_EXPR_TOKEN_STRING;
 			}
-			else {
-				r = expr_comma(sub_state, false);
+			if(cast != MO_EXPR_TOKEN_UNKNOWN) {
+				r = expr_token(state);
 				if(r != moExpr::MO_EXPR_ERROR_NONE) {
 					return r;
 				}
-				if(sub_state.value.value_type != MO_EXPR_TOKEN_INTEGER) {
-					// we can only index with an integer at this time
-					return moExpr::MO_EXPR_ERROR_INDEX;
+				if(state.token != ')') {
+					return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
+				}
+				r = expr_prefix_inc(state, true);
+				if(r != moExpr::MO_EXPR_ERROR_NONE) {
+					return r;
 				}
-				to = sub_state.value.value_int;
+				expr_emit(state, MO_EXPR_OP_CAST, cast);
+				expr_fold(state, start);
+				return moExpr::MO_EXPR_ERROR_NONE;
 			}
 		}
-		else {
-			to = from;
-		}
-
-		if(sub_state.token != ']') {
-			return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
-		}
-		// note that from can be large than to in which case
-		// characters will be inverted automatically
-		if(from < 0) {
-			from += static_cast<long>(state.value.value_str.Length());
-		}
-		if(to < 0) {
-			to += static_cast<long>(state.value.value_str.Length() - 1);
-		}
-		state.value.value_str = state.value.value_str.Get(from, to);
-		// go to the next token now
-		r = expr_token(sub_state);
-	}
-	else if(state.token == '(') {
-		// a function call
-		if(state.value.value_type != MO_EXPR_TOKEN_IDENTIFIER
-		&& state.value.value_type != MO_EXPR_TOKEN_STRING) {
-			return moExpr::MO_EXPR_ERROR_FUNCTION;
-		}
-		// get parameters
-		mo_expr_state_t sub_state(state);
-		r = expr_comma(sub_state, true);
+		// not a cast, some expression...
+		r = expr_comma(state, false);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
 		}
-		if(sub_state.token != ')') {
+		if(state.token != ')') {
+			// invalid expression!
 			return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
 		}
-		if(state.value.value_str == "strf") {
-			if(sub_state.param_count < 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			r = expr_func_strf(state, sub_state);
-		}
-		else if(state.value.value_str == "strlen") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_int = static_cast<long>(sub_state.param[0].value_str.Length());
-			state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-		}
-		else if(state.value.value_str == "basename") {
-			if(sub_state.param_count < 1
-			|| sub_state.param_count > 2) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING
-			|| (sub_state.param_count == 2
-					&& sub_state.param[1].value_type != MO_EXPR_TOKEN_STRING)) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			if(sub_state.param_count == 2) {
-				state.value.value_str = sub_state.param[0].value_str.FilenameBasename(sub_state.param[1].value_str);
-			}
-			else {
-				state.value.value_str = sub_state.param[0].value_str.FilenameBasename("");
-			}
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
-		}
-		else if(state.value.value_str == "clip") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Clip();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
-		}
-		else if(state.value.value_str == "trim") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Clip(moWCString::WC_STRING_CLIP_BOTH | moWCString::WC_STRING_CLIP_NEWLINE);
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
-		}
-		else if(state.value.value_str == "upper") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Uppercase();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
-		}
-		else if(state.value.value_str == "lower") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Lowercase();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
-		}
-		else if(state.value.value_str == "switch_case") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Switchcase();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
+		return expr_token(state);
+
+	case MO_EXPR_TOKEN_IDENTIFIER:
+		value.value_type = MO_EXPR_TOKEN_IDENTIFIER;
+		value.value_str = moWCString(state.start, static_cast<int>(state.end - state.start));
+		r = expr_token(state);
+		if(r != moExpr::MO_EXPR_ERROR_NONE) {
+			return r;
 		}
-		else if(state.value.value_str == "capitalize_words") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.CapitalizeWords();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
+		switch(static_cast<int>(state.token)) {
+		case '(':
+		case '=':
+	   	case MO_EXPR_TOKEN_ASSIGN_POW:
+	   	case MO_EXPR_TOKEN_ASSIGN_MUL:
+	   	case MO_EXPR_TOKEN_ASSIGN_DIV:
+	   	case MO_EXPR_TOKEN_ASSIGN_MOD:
+	   	case MO_EXPR_TOKEN_ASSIGN_ADD:
+	   	case MO_EXPR_TOKEN_ASSIGN_SUB:
+	   	case MO_EXPR_TOKEN_ASSIGN_SHL:
+	   	case MO_EXPR_TOKEN_ASSIGN_SHR:
+	   	case MO_EXPR_TOKEN_ASSIGN_AND:
+	   	case MO_EXPR_TOKEN_ASSIGN_OR:
+	   	case MO_EXPR_TOKEN_ASSIGN_XOR:
+			// a function or assignment; the name itself is the value
+			expr_push(state, value);
+			return moExpr::MO_EXPR_ERROR_NONE;
+
+		default:
+			// in all other cases, that identifier is a variable name
+			break;
+
 		}
-		else if(state.value.value_str == "capitalize") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Capitalize();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
+		slot = expr_find_slot(state, value.value_str);
+		if(slot < 0) {
+			slot = expr_input_slot(state, value.value_str);
 		}
-		else if(state.value.value_str == "reverse") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			state.value.value_str = sub_state.param[0].value_str.Reverse();
-			state.value.value_type = MO_EXPR_TOKEN_STRING;
+		expr_emit(state, MO_EXPR_OP_LOAD, slot);
+		return moExpr::MO_EXPR_ERROR_NONE;
+
+	case MO_EXPR_TOKEN_INTEGER:
+	{
+		moWCString i(state.start, static_cast<int>(state.end - state.start));
+		value.value_int = i.Integer();
+		value.value_type = MO_EXPR_TOKEN_INTEGER;
+		expr_push(state, value);
+		return expr_token(state);
+	}
+
+	case MO_EXPR_TOKEN_FLOAT:
+	{
+		moWCString f(state.start, static_cast<int>(state.end - state.start));
+		value.value_flt = f.Float();
+		value.value_type = MO_EXPR_TOKEN_FLOAT;
+		expr_push(state, value);
+		return expr_token(state);
+	}
+
+	case MO_EXPR_TOKEN_STRING:
+		// get the string without the quotes
+		value.value_str = moWCString(state.start + 1, static_cast<int>(state.end - state.start - 2)).FromBackslash();
+		value.value_type = MO_EXPR_TOKEN_STRING;
+
+		// concatanate all the following strings
+		r = expr_token(state);
+		while(r == moExpr::MO_EXPR_ERROR_NONE
+		   && state.token == MO_EXPR_TOKEN_STRING) {
+			value.value_str += moWCString(state.start + 1, static_cast<int>(state.end - state.start - 2));
+			r = expr_token(state);
 		}
-		else if(state.value.value_str == "regexpr") {
-			if(sub_state.param_count < 2) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING
-			|| sub_state.param[1].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
-			}
-			r = expr_func_regexpr(state, sub_state);
+		expr_push(state, value);
+		return r;
+
+	default:
+		// anything else is an error!
+		return moExpr::MO_EXPR_ERROR_SYNTAX;
+
+	}
+
+	return moExpr::MO_EXPR_ERROR_NONE;
+}
+
+
+static moExpr::mo_expr_errno_t expr_array_func(mo_expr_state_t& state, bool get_token)
+{
+	moExpr::mo_expr_errno_t	r;
+	long			flags, count, function;
+	bool			named;
+	unsigned long		start;
+	mo_expr_value_t		callee;
+
+	start = expr_code_size(state);
+	r = expr_unary(state, get_token);
+	if(r != moExpr::MO_EXPR_ERROR_NONE) {
+		return r;
+	}
+
+	if(state.token == '[') {
+		// array!
+		expr_emit(state, MO_EXPR_OP_CHECK_ARRAY);
+		r = expr_token(state);
+		if(r != moExpr::MO_EXPR_ERROR_NONE) {
+			return r;
 		}
-		else if(state.value.value_str == "reg_replace") {
-			if(sub_state.param_count < 3) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING
-			|| sub_state.param[1].value_type != MO_EXPR_TOKEN_STRING
-			|| sub_state.param[2].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		flags = 0;
+		if(state.token != MO_EXPR_TOKEN_RANGE) {
+			r = expr_comma(state, false);
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
 			}
-			r = expr_func_reg_replace(state, sub_state);
+			// we can only index with an integer at this time
+			expr_emit(state, MO_EXPR_OP_CHECK_INDEX);
+			flags |= MO_EXPR_SUBSTR_FROM;
 		}
-		else if(state.value.value_str == "replace") {
-			if(sub_state.param_count < 2) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING
-			|| sub_state.param[1].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+		if(state.token == MO_EXPR_TOKEN_RANGE) {
+			r = expr_token(state);	// get second value
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
 			}
-			r = expr_func_replace(state, sub_state);
-		}
-		else if(state.value.value_str == "atol") {
-			if(sub_state.param_count != 1) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
+			if(state.token == ']') {
+				// up to the end
+				flags |= MO_EXPR_SUBSTR_TO_END;
 			}
-			if(sub_state.param[0].value_type != MO_EXPR_TOKEN_STRING) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM;
+			else {
+				r = expr_comma(state, false);
+				if(r != moExpr::MO_EXPR_ERROR_NONE) {
+					return r;
+				}
+				expr_emit(state, MO_EXPR_OP_CHECK_INDEX);
+				flags |= MO_EXPR_SUBSTR_TO;
 			}
-			state.value.value_int = sub_state.param[0].value_str.Integer();
-			state.value.value_type = MO_EXPR_TOKEN_INTEGER;
 		}
-		else if(state.value.value_str == "included") {
-			if(sub_state.param_count < 2) {
-				return moExpr::MO_EXPR_ERROR_INVALID_PARAM_COUNT;
-			}
-			r = expr_func_included(state, sub_state);
+
+		if(state.token != ']') {
+			return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
+		}
+		expr_emit(state, MO_EXPR_OP_SUBSTR, flags);
+		expr_fold(state, start);
+		// go to the next token now
+		r = expr_token(state);
+	}
+	else if(state.token == '(') {
+		// a function call; in most cases the name is known now
+		named = !expr_constant_at(state, start, callee);
+		if(named) {
+			function = MO_EXPR_FUNCTION_UNKNOWN;
+			expr_emit(state, MO_EXPR_OP_CHECK_FUNCTION);
 		}
 		else {
-			return moExpr::MO_EXPR_ERROR_UNKNOWN_FUNCTION;
+			if(callee.value_type != MO_EXPR_TOKEN_IDENTIFIER
+			&& callee.value_type != MO_EXPR_TOKEN_STRING) {
+				return moExpr::MO_EXPR_ERROR_FUNCTION;
+			}
+			function = expr_find_function(callee.value_str);
+			state.code->f_code.resize(start);
 		}
+		// get parameters
+		r = expr_comma(state, true, &count);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
 		}
+		if(state.token != ')') {
+			return moExpr::MO_EXPR_ERROR_EXPECTED_CLOSE;
+		}
+		if(named) {
+			expr_emit(state, MO_EXPR_OP_CALL_NAMED, 0, count);
+		}
+		else {
+			expr_emit(state, MO_EXPR_OP_CALL, function, count);
+		}
+		expr_fold(state, start);
 		// go to the next token now
-		r = expr_token(sub_state);
+		r = expr_token(state);
 	}
 
 	return r;
@@ -2161,7 +2736,9 @@ static moExpr::mo_expr_errno_t expr_array_func(mo_expr_state_t& state, bool get_
 static moExpr::mo_expr_errno_t expr_postfix_inc(mo_expr_state_t& state, bool get_token)
 {
 	moExpr::mo_expr_errno_t	r;
+	unsigned long		start;
 
+	start = expr_code_size(state);
 	r = expr_array_func(state, get_token);
 	if(r != moExpr::MO_EXPR_ERROR_NONE) {
 		return r;
@@ -2169,38 +2746,8 @@ static moExpr::mo_expr_errno_t expr_postfix_inc(mo_expr_state_t& state, bool get
 
 	while(state.token == MO_EXPR_TOKEN_INCREMENT
 	   || state.token == MO_EXPR_TOKEN_DECREMENT) {
-		// get the right side expression
-		switch(state.token) {
-		case MO_EXPR_TOKEN_INCREMENT:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int++;
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_flt += 1.0;
-				break;
-
-			default:;
-			}
-			break;
-
-		case MO_EXPR_TOKEN_DECREMENT:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int--;
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_flt -= 1.0;
-				break;
-
-			default:;
-			}
-			break;
-
-		default:;/*NOTREACHED*/
-		}
+		expr_emit(state, MO_EXPR_OP_INC, state.token == MO_EXPR_TOKEN_INCREMENT ? 1 : -1);
+		expr_fold(state, start);
 		r = expr_token(state);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
@@ -2215,6 +2762,7 @@ static moExpr::mo_expr_errno_t expr_prefix_inc(mo_expr_state_t& state, bool get_
 {
 	moExpr::mo_expr_errno_t	r;
 	long			value;
+	unsigned long		start;
 
 	if(get_token) {
 		r = expr_token(state);
@@ -2229,37 +2777,18 @@ static moExpr::mo_expr_errno_t expr_prefix_inc(mo_expr_state_t& state, bool get_
 	value = 0;
 	while(state.token == MO_EXPR_TOKEN_INCREMENT
 	   || state.token == MO_EXPR_TOKEN_DECREMENT) {
-		// get the right side expression
-		switch(state.token) {
-		case MO_EXPR_TOKEN_INCREMENT:
-			value++;
-			break;
-
-		case MO_EXPR_TOKEN_DECREMENT:
-			value--;
-			break;
-
-		default:;/*NOTREACHED*/
-		}
+		value += state.token == MO_EXPR_TOKEN_INCREMENT ? 1 : -1;
 		r = expr_token(state);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
 		}
 	}
 
+	start = expr_code_size(state);
 	r = expr_postfix_inc(state, false);
 	if(r == moExpr::MO_EXPR_ERROR_NONE && value != 0) {
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			state.value.value_int += value;
-			break;
-
-		case MO_EXPR_TOKEN_FLOAT:
-			state.value.value_flt += (double) value;
-			break;
-
-		default:;/*NOTREACHED*/
-		}
+		expr_emit(state, MO_EXPR_OP_INC, value);
+		expr_fold(state, start);
 	}
 
 	return r;
@@ -2269,8 +2798,9 @@ static moExpr::mo_expr_errno_t expr_prefix_inc(mo_expr_state_t& state, bool get_
 static moExpr::mo_expr_errno_t expr_power(mo_expr_state_t& state, bool get_token)
 {
 	moExpr::mo_expr_errno_t	r;
-	long			v;
+	unsigned long		start;
 
+	start = expr_code_size(state);
 	r = expr_prefix_inc(state, get_token);
 	if(r != moExpr::MO_EXPR_ERROR_NONE) {
 		return r;
@@ -2278,378 +2808,43 @@ static moExpr::mo_expr_errno_t expr_power(mo_expr_state_t& state, bool get_token
 
 	if(state.token == MO_EXPR_TOKEN_POWER) {
 		// compute the power (it's right justified)
-		mo_expr_state_t sub_state(state);
-		r = expr_power(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				// no overflow check...
-				if(sub_state.value.value_int < 0) {
-					state.value.value_int = 0;
-				}
-				else {
-					v = state.value.value_int;
-					state.value.value_int = 1;
-					while(sub_state.value.value_int > 0) {
-						sub_state.value.value_int--;
-						state.value.value_int *= v;
-					}
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_flt = pow((double) state.value.value_int, state.value.value_flt);
-				state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-				break;
-
-			default:;
-			}
-			break;
-
-		case MO_EXPR_TOKEN_FLOAT:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_flt = pow(state.value.value_flt, (double) state.value.value_int);
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_flt = pow(state.value.value_flt, state.value.value_flt);
-				break;
-
-			default:;
-			}
-			break;
-
-		default:;
-		}
-	}
-
-	return r;
-}
-
-
-
-
-static moExpr::mo_expr_errno_t expr_multiplicative(mo_expr_state_t& state, bool get_token)
-{
-	moExpr::mo_expr_errno_t	r;
-
-	r = expr_power(state, get_token);
-	if(r != moExpr::MO_EXPR_ERROR_NONE) {
-		return r;
-	}
-
-	while(state.token == '*' || state.token == '/' || state.token == '%') {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_power(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		switch(static_cast<int>(state.token)) {
-		case '*':
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int *= sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = (double) state.value.value_int * sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				default:;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_flt = state.value.value_flt * (double) sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = state.value.value_flt * sub_state.value.value_flt;
-					break;
-
-				default:;
-				}
-				break;
-
-			default:;
-			}
-			break;
-
-		case '/':
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				if(sub_state.value.value_int == 0) {
-					return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				if(sub_state.value.value_flt == 0.0) {
-					return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-				}
-				break;
-
-			default:;
-			}
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int /= sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = (double) state.value.value_int / sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				default:;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_flt = state.value.value_flt / (double) sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = state.value.value_flt / sub_state.value.value_flt;
-					break;
-
-				default:;
-				}
-				break;
-
-			default:;
-			}
-			break;
-
-		case '%':
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				if(sub_state.value.value_int == 0) {
-					return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				if(sub_state.value.value_flt == 0.0) {
-					return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-				}
-				break;
-
-			default:;
-			}
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int %= sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = fmod((double) state.value.value_int, sub_state.value.value_flt);
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				default:;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_flt = fmod(state.value.value_flt, (double) sub_state.value.value_int);
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = fmod(state.value.value_flt, sub_state.value.value_flt);
-					break;
-
-				default:;
-				}
-				break;
-
-			default:;
-			}
-			break;
-
-		default:;/*NOTREACHED*/
-		}
-	}
-
-	return moExpr::MO_EXPR_ERROR_NONE;
-}
-
-
-
-static moExpr::mo_expr_errno_t expr_additive(mo_expr_state_t& state, bool get_token)
-{
-	moExpr::mo_expr_errno_t	r;
-
-	r = expr_multiplicative(state, get_token);
-	if(r != moExpr::MO_EXPR_ERROR_NONE) {
-		return r;
-	}
-
-	while(state.token == '+' || state.token == '-') {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_multiplicative(sub_state, true);
+		r = expr_power(state, true);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
 		}
-		switch(static_cast<int>(state.token)) {
-		case '+':
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int += sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = (double) state.value.value_int + sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				default:;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_flt = state.value.value_flt + (double) sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = state.value.value_flt + sub_state.value.value_flt;
-					break;
-
-				default:;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_str += sub_state.value.value_str;
-					break;
-
-				default:;
-				}
-
-			default:;
-			}
-			break;
-
-		case '-':
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int -= sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = (double) state.value.value_int - sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_FLOAT;
-					break;
-
-				default:;
-				}
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_flt = state.value.value_flt - (double) sub_state.value.value_int;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_flt = state.value.value_flt - sub_state.value.value_flt;
-					break;
-
-				default:;
-				}
-				break;
-
-			default:;
-			}
-			break;
-
-		default:;/*NOTREACHED*/
-		}
+		expr_emit(state, MO_EXPR_OP_BINARY, MO_EXPR_TOKEN_POWER);
+		expr_fold(state, start);
 	}
 
-	return moExpr::MO_EXPR_ERROR_NONE;
-}
-
-
-static moExpr::mo_expr_errno_t expr_shift(mo_expr_state_t& state, bool get_token)
-{
-	moExpr::mo_expr_errno_t	r;
-
-	r = expr_additive(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-		&& (state.token == MO_EXPR_TOKEN_SHIFT_LEFT
-			|| state.token == MO_EXPR_TOKEN_SHIFT_RIGHT)) {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_additive(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.token) {
-		case MO_EXPR_TOKEN_SHIFT_LEFT:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int <<= sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
+	return r;
+}
 
-			default:;/*NOTREACHED*/
-			}
-			break;
 
-		case MO_EXPR_TOKEN_SHIFT_RIGHT:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int -= sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+// All the left to right binary operators are compiled the same way;
+// a level is defined by the function parsing its operands and the
+// list of tokens it accepts.
+typedef moExpr::mo_expr_errno_t (*expr_level_t)(mo_expr_state_t& state, bool get_token);
 
-				default:;
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_binary(mo_expr_state_t& state, bool get_token, expr_level_t operand, const int *operators)
+{
+	moExpr::mo_expr_errno_t	r;
+	unsigned long		start;
+	const int		*op;
+	int			token;
 
-			default:;/*NOTREACHED*/
-			}
+	start = expr_code_size(state);
+	r = (*operand)(state, get_token);
+	while(r == moExpr::MO_EXPR_ERROR_NONE) {
+		token = static_cast<int>(state.token);
+		for(op = operators; *op != 0 && *op != token; ++op);
+		if(*op == 0) {
 			break;
-
-		default:;/*NOTREACHED*/
+		}
+		// get the right side expression
+		r = (*operand)(state, true);
+		if(r == moExpr::MO_EXPR_ERROR_NONE) {
+			expr_emit(state, MO_EXPR_OP_BINARY, token);
+			expr_fold(state, start);
 		}
 	}
 
@@ -2657,427 +2852,251 @@ static moExpr::mo_expr_errno_t expr_shift(mo_expr_state_t& state, bool get_token
 }
 
 
-static moExpr::mo_expr_errno_t expr_relational(mo_expr_state_t& state, bool get_token)
+static moExpr::mo_expr_errno_t expr_multiplicative(mo_expr_state_t& state, bool get_token)
 {
-	moExpr::mo_expr_errno_t	r;
+	static const int operators[] = { '*', '/', '%', 0 };
+	return expr_binary(state, get_token, expr_power, operators);
+}
 
-	r = expr_shift(state, get_token);
 
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	  && (state.token == '<' || state.token == '>'
-	   || state.token == MO_EXPR_TOKEN_LESS_EQUAL
-	   || state.token == MO_EXPR_TOKEN_GREATER_EQUAL)) {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_shift(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(static_cast<int>(state.token)) {
-		case '<':
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_int < sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (double) state.value.value_int < sub_state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_additive(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { '+', '-', 0 };
+	return expr_binary(state, get_token, expr_multiplicative, operators);
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_flt < (double) sub_state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = state.value.value_flt < sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
 
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = mowc::strcmp(state.value.value_str.Data(), sub_state.value.value_str.Data()) < 0;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_shift(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { MO_EXPR_TOKEN_SHIFT_LEFT, MO_EXPR_TOKEN_SHIFT_RIGHT, 0 };
+	return expr_binary(state, get_token, expr_additive, operators);
+}
 
-			default:;/*NOTREACHED*/
-			}
-			break;
 
-		case '>':
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_int > sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (double) state.value.value_int > sub_state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_relational(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { '<', '>', MO_EXPR_TOKEN_LESS_EQUAL, MO_EXPR_TOKEN_GREATER_EQUAL, 0 };
+	return expr_binary(state, get_token, expr_shift, operators);
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_flt > (double) sub_state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = state.value.value_flt > sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
 
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = mowc::strcmp(state.value.value_str.Data(), sub_state.value.value_str.Data()) > 0;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_compare(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { MO_EXPR_TOKEN_EQUAL, MO_EXPR_TOKEN_NOT_EQUAL, 0 };
+	return expr_binary(state, get_token, expr_relational, operators);
+}
 
-			default:;/*NOTREACHED*/
-			}
-			break;
 
-		case MO_EXPR_TOKEN_LESS_EQUAL:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_int <= sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (double) state.value.value_int <= sub_state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_bitwise_and(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { '&', 0 };
+	return expr_binary(state, get_token, expr_compare, operators);
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_flt <= (double) sub_state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = state.value.value_flt <= sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
 
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = mowc::strcmp(state.value.value_str.Data(), sub_state.value.value_str.Data()) <= 0;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_bitwise_xor(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { '^', 0 };
+	return expr_binary(state, get_token, expr_bitwise_and, operators);
+}
 
-			default:;/*NOTREACHED*/
-			}
-			break;
 
-		case MO_EXPR_TOKEN_GREATER_EQUAL:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_int >= sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (double) state.value.value_int >= sub_state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_bitwise_or(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { '|', 0 };
+	return expr_binary(state, get_token, expr_bitwise_xor, operators);
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_flt >= (double) sub_state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = state.value.value_flt >= sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
 
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = mowc::strcmp(state.value.value_str.Data(), sub_state.value.value_str.Data()) >= 0;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+static moExpr::mo_expr_errno_t expr_logical_and(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { MO_EXPR_TOKEN_LOGICAL_AND, 0 };
+	return expr_binary(state, get_token, expr_bitwise_or, operators);
+}
 
-			default:;/*NOTREACHED*/
-			}
-			break;
 
-		default:;/*NOTREACHED*/
-		}
-	}
+static moExpr::mo_expr_errno_t expr_logical_xor(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { MO_EXPR_TOKEN_LOGICAL_XOR, 0 };
+	return expr_binary(state, get_token, expr_logical_and, operators);
+}
 
-	return r;
+
+static moExpr::mo_expr_errno_t expr_logical_or(mo_expr_state_t& state, bool get_token)
+{
+	static const int operators[] = { MO_EXPR_TOKEN_LOGICAL_OR, 0 };
+	return expr_binary(state, get_token, expr_logical_xor, operators);
 }
 
 
-static moExpr::mo_expr_errno_t expr_compare(mo_expr_state_t& state, bool get_token)
+static moExpr::mo_expr_errno_t expr_conditional(mo_expr_state_t& state, bool get_token)
 {
 	moExpr::mo_expr_errno_t	r;
+	unsigned long		start;
 
-	r = expr_relational(state, get_token);
+	start = expr_code_size(state);
+	r = expr_logical_or(state, get_token);
+	// this is a R-L expression
 	while(r == moExpr::MO_EXPR_ERROR_NONE
-	  && (state.token == MO_EXPR_TOKEN_EQUAL
-	   || state.token == MO_EXPR_TOKEN_NOT_EQUAL)) {
+	   && state.token == '?') {
+		// both sides are always evaluated
+		expr_emit(state, MO_EXPR_OP_CHOICE);
+
+		// get the left side expression
+		r = expr_comma(state, true);
+		if(r != moExpr::MO_EXPR_ERROR_NONE) {
+			break;
+		}
+		if(state.token != ':') {
+			expr_emit(state, MO_EXPR_OP_SELECT_NOELSE);
+			expr_fold(state, start);
+			return moExpr::MO_EXPR_ERROR_NONE;
+		}
 		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_relational(sub_state, true);
+		r = expr_assign(state, true);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+			break;
 		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.token) {
-		case MO_EXPR_TOKEN_EQUAL:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_int == sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (double) state.value.value_int == sub_state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+		expr_emit(state, MO_EXPR_OP_SELECT);
+		expr_fold(state, start);
+	}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_flt == (double) sub_state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = state.value.value_flt == sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+	return r;
+}
 
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = mowc::strcmp(state.value.value_str.Data(), sub_state.value.value_str.Data()) == 0;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
 
-			default:;/*NOTREACHED*/
-			}
-			break;
+static moExpr::mo_expr_errno_t expr_assign(mo_expr_state_t& state, bool get_token)
+{
+	moExpr::mo_expr_errno_t	r;
+	mo_expr_token_t		token;
+	long			slot;
+	unsigned long		start;
+	mo_expr_value_t		name;
 
-		case MO_EXPR_TOKEN_NOT_EQUAL:
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_int != sub_state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = (double) state.value.value_int != sub_state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+	start = expr_code_size(state);
+	r = expr_conditional(state, get_token);
+	token = state.token;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.value.value_int = state.value.value_flt != (double) sub_state.value.value_int;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.value.value_int = state.value.value_flt != sub_state.value.value_flt;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
-				}
-				break;
+	// these are a R-L operators
+	while(r == moExpr::MO_EXPR_ERROR_NONE
+	  && (token == '='
+	   || token == MO_EXPR_TOKEN_ASSIGN_POW
+	   || token == MO_EXPR_TOKEN_ASSIGN_MUL
+	   || token == MO_EXPR_TOKEN_ASSIGN_DIV
+	   || token == MO_EXPR_TOKEN_ASSIGN_MOD
+	   || token == MO_EXPR_TOKEN_ASSIGN_ADD
+	   || token == MO_EXPR_TOKEN_ASSIGN_SUB
+	   || token == MO_EXPR_TOKEN_ASSIGN_SHL
+	   || token == MO_EXPR_TOKEN_ASSIGN_SHR
+	   || token == MO_EXPR_TOKEN_ASSIGN_AND
+	   || token == MO_EXPR_TOKEN_ASSIGN_OR
+	   || token == MO_EXPR_TOKEN_ASSIGN_XOR)) {
+		// only identifiers can be used for variable names
+		// we may add the string later if necessary
+		if(!expr_constant_at(state, start, name)
+		|| name.value_type != MO_EXPR_TOKEN_IDENTIFIER) {
+			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
+		}
+		state.code->f_code.resize(start);
 
-			case MO_EXPR_TOKEN_STRING:
-				switch(sub_state.value.value_type) {
-				case MO_EXPR_TOKEN_STRING:
-					state.value.value_int = mowc::strcmp(state.value.value_str.Data(), sub_state.value.value_str.Data()) != 0;
-					state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;/*NOTREACHED*/
+		// search for this variable
+		slot = expr_find_slot(state, name.value_str);
+		if(slot < 0) {
+			if(token != '=') {
+				// we need the variable to be defined before to do +=, *=, etc.
+				// (it may still be given as an input)
+				slot = expr_input_slot(state, name.value_str);
+				expr_emit(state, MO_EXPR_OP_CHECK_DEFINED, slot);
+			}
+			else {
+				if(state.code->f_locals >= MO_EXPR_VARIABLE_MAX) {
+					return moExpr::MO_EXPR_ERROR_VAROVERFLOW;
 				}
-				break;
-
-			default:;/*NOTREACHED*/
+				state.code->f_locals++;
+				slot = static_cast<long>(state.code->f_slot_names.size());
+				state.code->f_slot_names.push_back(name.value_str);
+				state.code->f_slot_inputs.push_back(-1);
+				expr_emit(state, MO_EXPR_OP_DEFINE, slot);
 			}
-			break;
+		}
+		else if(token == '=') {
+			expr_emit(state, MO_EXPR_OP_DEFINE, slot);
+		}
+		else {
+			expr_emit(state, MO_EXPR_OP_CHECK_DEFINED, slot);
+		}
 
-		default:;/*NOTREACHED*/
+		// get the right side expression
+		r = expr_assign(state, true);
+		if(r != moExpr::MO_EXPR_ERROR_NONE) {
+			break;
 		}
+		expr_emit(state, MO_EXPR_OP_ASSIGN, slot, token);
+		token = state.token;
 	}
 
 	return r;
 }
 
 
-static moExpr::mo_expr_errno_t expr_bitwise_and(mo_expr_state_t& state, bool get_token)
+static moExpr::mo_expr_errno_t expr_comma(mo_expr_state_t& state, bool get_token, long *count)
 {
 	moExpr::mo_expr_errno_t	r;
+	unsigned long		start;
+	long			n;
 
-	r = expr_compare(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE && state.token == '&') {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_compare(sub_state, true);
+	start = expr_code_size(state);
+	r = expr_assign(state, get_token);
+	if(r != moExpr::MO_EXPR_ERROR_NONE) {
+		return r;
+	}
+
+	// in a function call each expression is a parameter,
+	// anywhere else only the last expression is kept
+	n = 1;
+	while(state.token == ',') {
+		if(count == 0) {
+			expr_emit(state, MO_EXPR_OP_POP);
+		}
+		// get the next expression
+		r = expr_assign(state, true);
 		if(r != moExpr::MO_EXPR_ERROR_NONE) {
 			return r;
 		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int &= sub_state.value.value_int;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			default:;/*NOTREACHED*/
-			}
-			break;
+		n++;
+	}
 
-		default:;/*NOTREACHED*/
-		}
+	if(count != 0) {
+		*count = n;
+	}
+	else if(n > 1) {
+		expr_fold(state, start);
 	}
 
-	return r;
+	return moExpr::MO_EXPR_ERROR_NONE;
 }
 
 
-static moExpr::mo_expr_errno_t expr_bitwise_xor(mo_expr_state_t& state, bool get_token)
+static moExpr::mo_expr_errno_t expr(mo_expr_state_t& state)
 {
 	moExpr::mo_expr_errno_t	r;
+	bool			first;
 
-	r = expr_bitwise_and(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE && state.token == '^') {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_bitwise_and(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int ^= sub_state.value.value_int;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			default:;
+	first = true;
+	r = expr_token(state);
+	while(r == moExpr::MO_EXPR_ERROR_NONE
+	   && state.token != MO_EXPR_TOKEN_EOS) {
+		if(state.token != ';') {
+			// only the result of the last expression is kept
+			if(!first) {
+				expr_emit(state, MO_EXPR_OP_POP);
 			}
-			break;
-
-		default:;/*NOTREACHED*/
+			first = false;
+			r = expr_comma(state, false);
+		}
+		else {
+			// here we skip the ';'
+			r = expr_token(state);
 		}
 	}
 
@@ -3085,964 +3104,662 @@ static moExpr::mo_expr_errno_t expr_bitwise_xor(mo_expr_state_t& state, bool get
 }
 
 
-static moExpr::mo_expr_errno_t expr_bitwise_or(mo_expr_state_t& state, bool get_token)
+static void expr_compile(moExprProgram::moCode& code, const moWCString& expression)
 {
-	moExpr::mo_expr_errno_t	r;
+	mo_expr_state_t				state;
+	std::vector<mo_expr_value_t>		constants;
+	std::vector<long>			map;
+	std::vector<mo_expr_instruction_t>::iterator	it;
 
-	r = expr_bitwise_xor(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE && state.token == '|') {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_bitwise_xor(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int |= sub_state.value.value_int;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+	state.input = expression.Data();
+	state.code = &code;
 
-			default:;
-			}
-			break;
+	code.f_compile_error = expr(state);
+	if(code.f_compile_error != moExpr::MO_EXPR_ERROR_NONE) {
+		// the code up to the error still runs so the errors
+		// are reported in the same order as they appear
+		expr_emit(state, MO_EXPR_OP_FAIL, code.f_compile_error);
+	}
 
-		default:;/*NOTREACHED*/
+	// drop the constants that were folded
+	map.resize(code.f_constants.size(), -1);
+	for(it = code.f_code.begin(); it != code.f_code.end(); ++it) {
+		if(it->opcode == MO_EXPR_OP_PUSH) {
+			if(map[it->arg] < 0) {
+				map[it->arg] = static_cast<long>(constants.size());
+				constants.push_back(code.f_constants[it->arg]);
+			}
+			it->arg = map[it->arg];
 		}
 	}
+	code.f_constants.swap(constants);
 
-	return r;
+	code.f_stack.resize(expr_stack_size(code.f_code, 0, static_cast<unsigned long>(code.f_code.size())));
+	code.f_slots.resize(code.f_slot_names.size());
 }
 
 
-static moExpr::mo_expr_errno_t expr_logical_and(mo_expr_state_t& state, bool get_token)
+
+/************************************************************ evaluation */
+
+static moExpr::mo_expr_errno_t expr_run(const moExprProgram::moCode& code, unsigned long begin, unsigned long end, mo_expr_value_t *stack, long& sp, mo_expr_slot_t *slots)
 {
 	moExpr::mo_expr_errno_t	r;
+	long			n, from, to, length;
+	bool			valid;
 
-	r = expr_bitwise_or(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	   && state.token == MO_EXPR_TOKEN_LOGICAL_AND) {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_bitwise_or(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = state.value.value_int != 0 && sub_state.value.value_int != 0;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = state.value.value_int != 0 && sub_state.value.value_flt != 0;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+	for(; begin < end; ++begin) {
+		const mo_expr_instruction_t& instruction = code.f_code[begin];
+		switch(instruction.opcode) {
+		case MO_EXPR_OP_PUSH:
+			expr_copy(stack[sp], code.f_constants[instruction.arg]);
+			sp++;
+			break;
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = state.value.value_int != 0 && !sub_state.value.value_str.IsEmpty();
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_LOAD:
+			if(!slots[instruction.arg].defined) {
+				fprintf(stderr, "ERROR: the variable named '%s' is not defined.\n", code.f_slot_names[instruction.arg].SavedMBData());
+				return moExpr::MO_EXPR_ERROR_VARUNDEFINED;
+			}
+			expr_copy(stack[sp], slots[instruction.arg].value);
+			sp++;
+			break;
 
-			default:;
+		case MO_EXPR_OP_POP:
+			sp--;
+			break;
+
+		case MO_EXPR_OP_DEFINE:
+			if(!slots[instruction.arg].defined) {
+				slots[instruction.arg].defined = true;
+				slots[instruction.arg].value.value_type = MO_EXPR_TOKEN_UNKNOWN;
 			}
 			break;
 
-		case MO_EXPR_TOKEN_FLOAT:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = state.value.value_flt != 0 && sub_state.value.value_int != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_CHECK_DEFINED:
+			if(!slots[instruction.arg].defined) {
+				return moExpr::MO_EXPR_ERROR_VARUNDEFINED;
+			}
+			break;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = state.value.value_flt != 0 && sub_state.value.value_flt != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_ASSIGN:
+			r = expr_assign_value(instruction.arg2, slots[instruction.arg].value, stack[sp - 1]);
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
+			}
+			break;
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = state.value.value_flt != 0 && !sub_state.value.value_str.IsEmpty();
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_FAIL:
+			return static_cast<moExpr::mo_expr_errno_t>(instruction.arg);
 
-			default:;
+		case MO_EXPR_OP_UNARY:
+			r = expr_unary_value(instruction.arg, stack[sp - 1]);
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
 			}
 			break;
 
-		case MO_EXPR_TOKEN_STRING:
-			switch(sub_state.value.value_type) {
+		case MO_EXPR_OP_CAST:
+			expr_cast_value(instruction.arg, stack[sp - 1]);
+			break;
+
+		case MO_EXPR_OP_INC:
+			switch(stack[sp - 1].value_type) {
 			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = !state.value.value_str.IsEmpty() && sub_state.value.value_int != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
+				stack[sp - 1].value_int += instruction.arg;
 				break;
 
 			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = !state.value.value_str.IsEmpty() && sub_state.value.value_flt != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = !state.value.value_str.IsEmpty() && !sub_state.value.value_str.IsEmpty();
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
+				stack[sp - 1].value_flt += (double) instruction.arg;
 				break;
 
 			default:;
 			}
 			break;
 
-		default:;
-		}
-	}
-
-	return r;
-}
-
+		case MO_EXPR_OP_CHECK_ARRAY:
+			if(stack[sp - 1].value_type != MO_EXPR_TOKEN_STRING) {
+				return moExpr::MO_EXPR_ERROR_ARRAY;
+			}
+			break;
 
-static moExpr::mo_expr_errno_t expr_logical_xor(mo_expr_state_t& state, bool get_token)
-{
-	moExpr::mo_expr_errno_t	r;
+		case MO_EXPR_OP_CHECK_INDEX:
+			if(stack[sp - 1].value_type != MO_EXPR_TOKEN_INTEGER) {
+				return moExpr::MO_EXPR_ERROR_INDEX;
+			}
+			break;
 
-	r = expr_logical_and(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	   && state.token == MO_EXPR_TOKEN_LOGICAL_XOR) {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_logical_and(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+		case MO_EXPR_OP_SUBSTR:
+		{
+			n = -expr_stack_effect(instruction);
+			mo_expr_value_t& str = stack[sp - n - 1];
+			length = static_cast<long>(str.value_str.Length());
+			from = (instruction.arg & MO_EXPR_SUBSTR_FROM) != 0 ? stack[sp - n].value_int : 0;
+			if((instruction.arg & MO_EXPR_SUBSTR_TO) != 0) {
+				to = stack[sp - 1].value_int;
+			}
+			else if((instruction.arg & MO_EXPR_SUBSTR_TO_END) != 0) {
+				to = length - 1;
+			}
+			else {
+				to = from;
+			}
+			// note that from can be large than to in which case
+			// characters will be inverted automatically
+			if(from < 0) {
+				from += length;
+			}
+			if(to < 0) {
+				to += length - 1;
+			}
+			str.value_str = str.value_str.Get(from, to);
+			sp -= n;
 		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = (state.value.value_int != 0) ^ (sub_state.value.value_int != 0);
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = (state.value.value_int != 0) ^ (sub_state.value.value_flt != 0);
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = (state.value.value_int != 0) ^ !sub_state.value.value_str.IsEmpty();
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+			break;
 
-			default:;
+		case MO_EXPR_OP_CHECK_FUNCTION:
+			if(stack[sp - 1].value_type != MO_EXPR_TOKEN_IDENTIFIER
+			&& stack[sp - 1].value_type != MO_EXPR_TOKEN_STRING) {
+				return moExpr::MO_EXPR_ERROR_FUNCTION;
 			}
 			break;
 
-		case MO_EXPR_TOKEN_FLOAT:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = (state.value.value_flt != 0) ^ (sub_state.value.value_int != 0);
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
-
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = (state.value.value_flt != 0) ^ (sub_state.value.value_flt != 0);
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_CALL:
+			n = instruction.arg2;
+			r = expr_call(instruction.arg, stack[sp - n], stack + sp - n, n);
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
+			}
+			sp -= n - 1;
+			break;
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = (state.value.value_flt != 0) ^ !sub_state.value.value_str.IsEmpty();
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_CALL_NAMED:
+			n = instruction.arg2;
+			r = expr_call(expr_find_function(stack[sp - n - 1].value_str), stack[sp - n - 1], stack + sp - n, n);
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
+			}
+			sp -= n;
+			break;
 
-			default:;
+		case MO_EXPR_OP_BINARY:
+			r = expr_binary_value(instruction.arg, stack[sp - 2], stack[sp - 1]);
+			if(r != moExpr::MO_EXPR_ERROR_NONE) {
+				return r;
 			}
+			sp--;
 			break;
 
-		case MO_EXPR_TOKEN_STRING:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = !state.value.value_str.IsEmpty() ^ (sub_state.value.value_int != 0);
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+		case MO_EXPR_OP_CHOICE:
+			stack[sp - 1].value_int = expr_truth(stack[sp - 1], valid);
+			stack[sp - 1].value_type = MO_EXPR_TOKEN_INTEGER;
+			break;
 
+		case MO_EXPR_OP_SELECT:
+			if(stack[sp - 2].value_type != stack[sp - 1].value_type) {
+				return moExpr::MO_EXPR_ERROR_BAD_TYPE;
+			}
+			switch(stack[sp - 1].value_type) {
+			case MO_EXPR_TOKEN_INTEGER:
 			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = !state.value.value_str.IsEmpty() ^ (sub_state.value.value_flt != 0);
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
+			case MO_EXPR_TOKEN_STRING:
+				// keep the right result when the choice is false
+				expr_copy(stack[sp - 3], stack[sp - (stack[sp - 3].value_int ? 2 : 1)]);
 				break;
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = !state.value.value_str.IsEmpty() ^ !sub_state.value.value_str.IsEmpty();
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
+			default:
+				expr_copy(stack[sp - 3], stack[sp - 2]);
 				break;
 
-			default:;
 			}
+			sp -= 2;
+			break;
+
+		case MO_EXPR_OP_SELECT_NOELSE:
+			expr_copy(stack[sp - 2], stack[sp - 1]);
+			sp--;
 			break;
 
-		default:;
 		}
 	}
 
-	return r;
+	return moExpr::MO_EXPR_ERROR_NONE;
 }
 
 
-static moExpr::mo_expr_errno_t expr_logical_or(mo_expr_state_t& state, bool get_token)
-{
-	moExpr::mo_expr_errno_t	r;
-
-	r = expr_logical_xor(state, get_token);
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	   && state.token == MO_EXPR_TOKEN_LOGICAL_OR) {
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_logical_xor(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = state.value.value_int != 0 || sub_state.value.value_int != 0;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = state.value.value_int != 0 || sub_state.value.value_flt != 0;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+/************************************************************ DOC:
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = state.value.value_int != 0 || !sub_state.value.value_str.IsEmpty();
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+CLASS
 
-			default:;
-			}
-			break;
+	moExprValue
 
-		case MO_EXPR_TOKEN_FLOAT:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = state.value.value_flt != 0 || sub_state.value.value_int != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+NAME
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = state.value.value_flt != 0 || sub_state.value.value_flt != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+	Constructor - create an undefined value
+	Type - the type of the value
+	Integer, Float, String - retrieve the value
+	SetUndefined, SetInteger, SetFloat, SetString - change the value
+	ToString - the value as moExpr::Result() presents it
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = state.value.value_flt != 0 || !sub_state.value.value_str.IsEmpty();
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+SYNOPSIS
 
-			default:;
-			}
-			break;
+	moExprValue(void);
+	mo_expr_value_type_t Type(void) const;
+	long Integer(void) const;
+	double Float(void) const;
+	const moWCString& String(void) const;
+	moWCString ToString(void) const;
+	void SetUndefined(void);
+	void SetInteger(long value);
+	void SetFloat(double value);
+	void SetString(const moWCString& value);
 
-		case MO_EXPR_TOKEN_STRING:
-			switch(sub_state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = !state.value.value_str.IsEmpty() || sub_state.value.value_int != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+DESCRIPTION
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_int = !state.value.value_str.IsEmpty() || sub_state.value.value_flt != 0;
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+	A value is used to give the inputs of a compiled expression
+	and to retrieve its result without going through strings.
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_int = !state.value.value_str.IsEmpty() || !sub_state.value.value_str.IsEmpty();
-				state.value.value_type = MO_EXPR_TOKEN_INTEGER;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+	An undefined input is viewed as a variable which was never
+	assigned.
 
-			default:;
-			}
-			break;
+SEE ALSO
 
-		default:;
-		}
-	}
+	moExprProgram::Evaluate()
 
-	return r;
+*/
+moExprValue::moExprValue(void)
+	: f_type(MO_EXPR_VALUE_UNDEFINED)
+	, f_integer(0)
+	, f_float(0.0)
+	//, f_string -- auto-init
+{
 }
 
 
-static moExpr::mo_expr_errno_t expr_conditional(mo_expr_state_t& state, bool get_token)
+moWCString moExprValue::ToString(void) const
 {
-	moExpr::mo_expr_errno_t	r;
-	long			choice;
+	char		buf[256];	/* Flawfinder: ignore */
 
-	r = expr_logical_or(state, get_token);
-	// this is a R-L expression
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	   && state.token == '?') {
-		// make the selection now!
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			choice = state.value.value_int != 0;
-			break;
+	switch(f_type) {
+	case MO_EXPR_VALUE_INTEGER:
+		sprintf(buf, "%ld", f_integer);	/* Flawfinder: ignore */
+		return buf;
 
-		case MO_EXPR_TOKEN_FLOAT:
-			choice = state.value.value_flt != 0;
-			break;
+	case MO_EXPR_VALUE_FLOAT:
+		sprintf(buf, "%g", f_float);	/* Flawfinder: ignore */
+		return buf;
 
-		case MO_EXPR_TOKEN_STRING:
-			choice = !state.value.value_str.IsEmpty();
-			break;
+	case MO_EXPR_VALUE_STRING:
+		return f_string;
 
-		default:
-			/*NOTREACHED*/
-			choice = false;
-			break;
+	default:
+		return "ERROR";
 
-		}
-		// TODO: if 'choice' is false we need to skip
-		// the following expression up to the ':'; also
-		// if 'choice' is true, we need to skip the
-		// expression after the ':'
+	}
+}
 
-		// get the left side expression
-		r = expr_comma(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			break;
-		}
-		if(state.token != ':') {
-			return moExpr::MO_EXPR_ERROR_NONE;
-		}
-		// get the right side expression
-		mo_expr_state_t sub_state(state);
-		r = expr_assign(sub_state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			break;
-		}
-		if(state.value.value_type != sub_state.value.value_type) {
-			return moExpr::MO_EXPR_ERROR_BAD_TYPE;
-		}
-		if(!choice) {
-			// keep the right result!
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.value.value_int = sub_state.value.value_int;
-				break;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.value.value_flt = sub_state.value.value_flt;
-				break;
+void moExprValue::SetUndefined(void)
+{
+	f_type = MO_EXPR_VALUE_UNDEFINED;
+}
 
-			case MO_EXPR_TOKEN_STRING:
-				state.value.value_str = sub_state.value.value_str;
-				break;
 
-			default:;
-			}
-		}
-	}
+void moExprValue::SetInteger(long value)
+{
+	f_type = MO_EXPR_VALUE_INTEGER;
+	f_integer = value;
+}
 
-	return r;
+
+void moExprValue::SetFloat(double value)
+{
+	f_type = MO_EXPR_VALUE_FLOAT;
+	f_float = value;
 }
 
 
-static moExpr::mo_expr_errno_t expr_assign(mo_expr_state_t& state, bool get_token)
+void moExprValue::SetString(const moWCString& value)
 {
-	moExpr::mo_expr_errno_t	r;
-	mo_expr_token_t		token;
-	long			v, idx;
-	bool			found;
+	f_type = MO_EXPR_VALUE_STRING;
+	f_string = value;
+}
 
-	r = expr_conditional(state, get_token);
-	token = state.token;
 
-	// these are a R-L operators
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	  && (token == '='
-	   || token == MO_EXPR_TOKEN_ASSIGN_POW
-	   || token == MO_EXPR_TOKEN_ASSIGN_MUL
-	   || token == MO_EXPR_TOKEN_ASSIGN_DIV
-	   || token == MO_EXPR_TOKEN_ASSIGN_MOD
-	   || token == MO_EXPR_TOKEN_ASSIGN_ADD
-	   || token == MO_EXPR_TOKEN_ASSIGN_SUB
-	   || token == MO_EXPR_TOKEN_ASSIGN_SHL
-	   || token == MO_EXPR_TOKEN_ASSIGN_SHR
-	   || token == MO_EXPR_TOKEN_ASSIGN_AND
-	   || token == MO_EXPR_TOKEN_ASSIGN_OR
-	   || token == MO_EXPR_TOKEN_ASSIGN_XOR)) {
-		// only identifiers can be used for variable names
-		// we may add the string later if necessary
-		if(state.value.value_type != MO_EXPR_TOKEN_IDENTIFIER) {
-			return moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		}
-		// search for this variable
-		found = false;
-		idx = state.count;
-		while(idx > 0) {
-			idx--;
-			if(state.value.value_str == state.variable[idx].name) {
-				// the variable already exists!
-				found = true;
-				break;
-			}
-		}
-		if(!found) {
-			if(token != '=') {
-				// we need the variable to be defined before to do +=, *=, etc.
-				return moExpr::MO_EXPR_ERROR_VARUNDEFINED;
-			}
-			if(state.count >= MO_EXPR_VARIABLE_MAX) {
-				return moExpr::MO_EXPR_ERROR_VAROVERFLOW;
-			}
-			idx = state.count++;
-			state.variable[idx].name = state.value.value_str;
-		}
-		// get the right side expression
-		r = expr_assign(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			break;
-		}
-		r = moExpr::MO_EXPR_ERROR_OPERATOR_TYPE;
-		switch(static_cast<int>(token)) {
-		case '=':
-			state.variable[idx].value_type = state.value.value_type;
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.variable[idx].value_int = state.value.value_int;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.variable[idx].value_flt = state.value.value_flt;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+/************************************************************ DOC:
+
+CLASS
+
+	moExprProgram
+
+NAME
+
+	Constructor - compile an expression
+	Compile - compile an expression or reuse it from the cache
+
+SYNOPSIS
+
+	moExprProgram(const moWCString& expression);
+	static moExprProgramSPtr Compile(const moWCString& expression);
+	static void SetCacheSize(unsigned long size);
+	static void ClearCache(void);
 
-			case MO_EXPR_TOKEN_STRING:
-				state.variable[idx].value_str = state.value.value_str;
-				r = moExpr::MO_EXPR_ERROR_NONE;
-				break;
+DESCRIPTION
 
-			default:;
-			}
-			break;
+	An moExprProgram is the compiled form of an expression as
+	understood by moExpr::Result(). The expression is parsed once
+	and transformed into a list of instructions; the parts which
+	only depend on constants are computed at that time.
 
-		case MO_EXPR_TOKEN_ASSIGN_POW:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					if(state.value.value_int < 0) {
-						state.variable[idx].value_int = 0;
-					}
-					else {
-						v = state.variable[idx].value_int;
-						state.variable[idx].value_int = 1;
-						while(state.value.value_int > 0) {
-							state.value.value_int--;
-							state.variable[idx].value_int *= v;
-						}
-					}
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+	The Compile() function keeps the last programs it created in
+	a cache so an expression used over and over again is only
+	compiled once. The cache keeps up to 256 programs by default;
+	use SetCacheSize() to change that limit (0 disables the cache)
+	and ClearCache() to release all the programs.
 
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt = pow((double) state.variable[idx].value_int, state.value.value_flt);
-					state.variable[idx].value_type = MO_EXPR_TOKEN_FLOAT;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+	The constructor can be used directly to compile an expression
+	which shouldn't go in the cache.
 
-				default:;
-				}
-				break;
+	Errors found while compiling are not fatal: the program runs
+	up to the place where the error was found, then returns that
+	error, which is what moExpr::Result() always did. The first
+	such error is returned by CompileError().
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_flt = pow(state.variable[idx].value_flt, (double) state.value.value_int);
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt = pow(state.variable[idx].value_flt, state.value.value_flt);
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
+SEE ALSO
 
-			default:;
-			}
-			break;
+	Evaluate(), moExpr::Result()
 
-		case MO_EXPR_TOKEN_ASSIGN_MUL:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int *= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt = (double) state.variable[idx].value_int * state.value.value_flt;
-					state.variable[idx].value_type = MO_EXPR_TOKEN_FLOAT;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
+*/
+moExprProgram::moExprProgram(const moWCString& expression)
+	: f_expression(expression)
+	, f_code(new moCode)
+	//, f_mutex -- auto-init
+{
+	expr_compile(*f_code, f_expression);
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_flt *= (double) state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt *= state.variable[idx].value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
 
-			default:;
-			}
-			break;
+moExprProgram::~moExprProgram()
+{
+	delete f_code;
+}
 
-		case MO_EXPR_TOKEN_ASSIGN_DIV:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int /= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt = (double) state.variable[idx].value_int / state.value.value_flt;
-					state.variable[idx].value_type = MO_EXPR_TOKEN_FLOAT;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_flt /= (double) state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt /= state.variable[idx].value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
+const char *moExprProgram::moGetClassName(void) const
+{
+	return "molib::moBase::moExprProgram";
+}
 
-			default:;
-			}
-			break;
 
-		case MO_EXPR_TOKEN_ASSIGN_MOD:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					if(state.value.value_int == 0) {
-						return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-					}
-					state.variable[idx].value_int %= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+namespace
+{
+typedef std::list<moExprProgramSPtr>				expr_cache_list_t;
+typedef std::map<moWCString, expr_cache_list_t::iterator>	expr_cache_map_t;
 
-				case MO_EXPR_TOKEN_FLOAT:
-					if(state.value.value_flt == 0) {
-						return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-					}
-					state.variable[idx].value_flt = fmod((double) state.variable[idx].value_int, state.value.value_flt);
-					state.variable[idx].value_type = MO_EXPR_TOKEN_FLOAT;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+moMutex			g_expr_cache_mutex;
+unsigned long		g_expr_cache_size = 256;
+expr_cache_list_t	g_expr_cache_list;	// most recently used first
+expr_cache_map_t	g_expr_cache_map;
 
-				default:;
-				}
-				break;
+void expr_cache_trim(void)
+{
+	while(g_expr_cache_list.size() > g_expr_cache_size) {
+		g_expr_cache_map.erase(g_expr_cache_list.back()->Expression());
+		g_expr_cache_list.pop_back();
+	}
+}
+}		// no name namespace
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					if(state.value.value_int == 0) {
-						return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-					}
-					state.variable[idx].value_flt = fmod(state.variable[idx].value_flt, (double) state.value.value_int);
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
 
-				case MO_EXPR_TOKEN_FLOAT:
-					if(state.value.value_flt == 0) {
-						return moExpr::MO_EXPR_ERROR_DIVIDE_BY_ZERO;
-					}
-					state.variable[idx].value_flt = fmod(state.variable[idx].value_flt, state.value.value_flt);
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+moExprProgramSPtr moExprProgram::Compile(const moWCString& expression)
+{
+	moLockMutex lock(g_expr_cache_mutex);
 
-				default:;
-				}
-				break;
+	expr_cache_map_t::iterator it = g_expr_cache_map.find(expression);
+	if(it != g_expr_cache_map.end()) {
+		g_expr_cache_list.splice(g_expr_cache_list.begin(), g_expr_cache_list, it->second);
+		return *it->second;
+	}
 
-			default:;
-			}
-			break;
+	moExprProgramSPtr program(new moExprProgram(expression));
+	if(g_expr_cache_size > 0) {
+		g_expr_cache_list.push_front(program);
+		g_expr_cache_map[expression] = g_expr_cache_list.begin();
+		expr_cache_trim();
+	}
 
-		case MO_EXPR_TOKEN_ASSIGN_ADD:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int += state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt = (double) state.variable[idx].value_int + state.value.value_flt;
-					state.variable[idx].value_type = MO_EXPR_TOKEN_FLOAT;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
+	return program;
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_flt += (double) state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt += state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
 
-			default:;
-			}
-			break;
+void moExprProgram::SetCacheSize(unsigned long size)
+{
+	moLockMutex lock(g_expr_cache_mutex);
 
-		case MO_EXPR_TOKEN_ASSIGN_SUB:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int -= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt = (double) state.variable[idx].value_int - state.value.value_flt;
-					state.variable[idx].value_type = MO_EXPR_TOKEN_FLOAT;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
+	g_expr_cache_size = size;
+	expr_cache_trim();
+}
 
-			case MO_EXPR_TOKEN_FLOAT:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_flt -= (double) state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				case MO_EXPR_TOKEN_FLOAT:
-					state.variable[idx].value_flt -= state.value.value_flt;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
-
-				default:;
-				}
-				break;
 
-			default:;
-			}
-			break;
+void moExprProgram::ClearCache(void)
+{
+	moLockMutex lock(g_expr_cache_mutex);
 
-		case MO_EXPR_TOKEN_ASSIGN_SHL:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int <<= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+	g_expr_cache_map.clear();
+	g_expr_cache_list.clear();
+}
 
-				default:;
-				}
-				break;
 
-			default:;
-			}
-			break;
 
-		case MO_EXPR_TOKEN_ASSIGN_SHR:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int >>= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+/************************************************************ DOC:
 
-				default:;
-				}
-				break;
+CLASS
 
-			default:;
-			}
-			break;
+	moExprProgram
 
-		case MO_EXPR_TOKEN_ASSIGN_AND:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int &= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+NAME
 
-				default:;
-				}
-				break;
+	Expression - the source of this program
+	CompileError - the first error found while compiling
+	IsConstant - whether the program always returns the same result
+	InputCount, InputName, FindInput - the inputs of the program
 
-			default:;
-			}
-			break;
+SYNOPSIS
 
-		case MO_EXPR_TOKEN_ASSIGN_OR:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int |= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+	const moWCString& Expression(void) const;
+	moExpr::mo_expr_errno_t CompileError(void) const;
+	bool IsConstant(void) const;
+	unsigned long InputCount(void) const;
+	const moWCString& InputName(unsigned long index) const;
+	long FindInput(const moWCString& name) const;
 
-				default:;
-				}
-				break;
+DESCRIPTION
 
-			default:;
-			}
-			break;
+	The inputs of a program are the variable names which are
+	read before the expression assigns them. They are numbered
+	in the order they first appear in the expression; the index
+	is used to give their value to Evaluate().
 
-		case MO_EXPR_TOKEN_ASSIGN_XOR:
-			switch(state.variable[idx].value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				switch(state.value.value_type) {
-				case MO_EXPR_TOKEN_INTEGER:
-					state.variable[idx].value_int ^= state.value.value_int;
-					r = moExpr::MO_EXPR_ERROR_NONE;
-					break;
+	FindInput() returns -1 when the name is not an input.
 
-				default:;
-				}
-				break;
+SEE ALSO
 
-			default:;
-			}
-			break;
+	Evaluate()
 
-		default:;/*NOTREACHED*/
-		}
-		token = state.token;
-	}
+*/
+const moWCString& moExprProgram::Expression(void) const
+{
+	return f_expression;
+}
 
-	return r;
+
+moExpr::mo_expr_errno_t moExprProgram::CompileError(void) const
+{
+	return f_code->f_compile_error;
 }
 
 
+bool moExprProgram::IsConstant(void) const
+{
+	return f_code->f_code.size() == 1
+		&& f_code->f_code[0].opcode == MO_EXPR_OP_PUSH;
+}
+
 
-static moExpr::mo_expr_errno_t expr_comma(mo_expr_state_t& state, bool get_token)
+unsigned long moExprProgram::InputCount(void) const
 {
-	moExpr::mo_expr_errno_t	r;
+	return static_cast<unsigned long>(f_code->f_inputs.size());
+}
 
-	r = expr_assign(state, get_token);
-	if(r != moExpr::MO_EXPR_ERROR_NONE) {
-		return r;
-	}
 
-	state.param[0].value_type = state.value.value_type;
-	switch(state.value.value_type) {
-	case MO_EXPR_TOKEN_INTEGER:
-		state.param[0].value_int = state.value.value_int;
-		break;
+const moWCString& moExprProgram::InputName(unsigned long index) const
+{
+	return f_code->f_slot_names[f_code->f_inputs[index]];
+}
 
-	case MO_EXPR_TOKEN_FLOAT:
-		state.param[0].value_flt = state.value.value_flt;
-		break;
 
-	case MO_EXPR_TOKEN_STRING:
-		state.param[0].value_str = state.value.value_str;
-		break;
+long moExprProgram::FindInput(const moWCString& name) const
+{
+	unsigned long	idx;
 
-	default:;// unused... avoid warnings (yet we could receive an invalid identifier!)
-	}
-	state.param_count = 1;
-	while(state.token == ',') {
-		// get the next expression
-		r = expr_assign(state, true);
-		if(r != moExpr::MO_EXPR_ERROR_NONE) {
-			return r;
+	for(idx = 0; idx < f_code->f_inputs.size(); ++idx) {
+		if(f_code->f_slot_names[f_code->f_inputs[idx]] == name) {
+			return static_cast<long>(idx);
 		}
-		// when there are more parameters, we don't generate an error...
-		// this will be done in the <identifier>(...) since in all the
-		// other cases, it doesn't matter
-		if(state.param_count < MO_EXPR_PARAM_MAX) {
-			state.param[state.param_count].value_type = state.value.value_type;
-			switch(state.value.value_type) {
-			case MO_EXPR_TOKEN_INTEGER:
-				state.param[state.param_count].value_int = state.value.value_int;
+	}
+
+	return -1;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moExprProgram
+
+NAME
+
+	Evaluate - run the compiled expression
+
+SYNOPSIS
+
+	moExpr::mo_expr_errno_t Evaluate(moExprValue& result,
+		const moExprValue *inputs = 0, unsigned long count = 0) const;
+
+DESCRIPTION
+
+	Run the program and save its result in result.
+
+	The inputs array gives the value of the inputs (see InputName())
+	as if the expression started with an assignment of each one of
+	them. Missing or undefined inputs are not defined variables.
+
+	The variables assigned by the expression are reset on each call.
+
+	The same program can be evaluated from several threads; the
+	calls are serialized.
+
+RETURN VALUE
+
+	MO_EXPR_ERROR_NONE when the result is valid, an error otherwise
+	(result is then undefined).
+
+SEE ALSO
+
+	moExpr::Result()
+
+*/
+moExpr::mo_expr_errno_t moExprProgram::Evaluate(moExprValue& result, const moExprValue *inputs, unsigned long count) const
+{
+	moExpr::mo_expr_errno_t	r;
+	unsigned long		idx;
+	long			input, sp;
+
+	moLockMutex lock(f_mutex);
+
+	moCode& code = *f_code;
+	for(idx = 0; idx < code.f_slots.size(); ++idx) {
+		mo_expr_slot_t& slot = code.f_slots[idx];
+		input = code.f_slot_inputs[idx];
+		slot.defined = false;
+		slot.value.value_type = MO_EXPR_TOKEN_UNKNOWN;
+		if(input >= 0 && static_cast<unsigned long>(input) < count) {
+			const moExprValue& value = inputs[input];
+			switch(value.Type()) {
+			case moExprValue::MO_EXPR_VALUE_INTEGER:
+				slot.value.value_int = value.Integer();
+				slot.value.value_type = MO_EXPR_TOKEN_INTEGER;
 				break;
 
-			case MO_EXPR_TOKEN_FLOAT:
-				state.param[state.param_count].value_flt = state.value.value_flt;
+			case moExprValue::MO_EXPR_VALUE_FLOAT:
+				slot.value.value_flt = value.Float();
+				slot.value.value_type = MO_EXPR_TOKEN_FLOAT;
 				break;
 
-			case MO_EXPR_TOKEN_STRING:
-				state.param[state.param_count].value_str = state.value.value_str;
+			case moExprValue::MO_EXPR_VALUE_STRING:
+				slot.value.value_str = value.String();
+				slot.value.value_type = MO_EXPR_TOKEN_STRING;
 				break;
 
-			default:;/*NOTREACHED*/
+			default:;
 			}
+			slot.defined = slot.value.value_type != MO_EXPR_TOKEN_UNKNOWN;
 		}
-		// count the number of parameters - the array still has a
-		// maximum of MO_EXPR_PARAM_MAX! - this is to use in another
-		// function to know whether too many parameters were defined
-		state.param_count++;
 	}
 
-	return moExpr::MO_EXPR_ERROR_NONE;
-}
-
+	result.SetUndefined();
+	sp = 0;
+	r = expr_run(code, 0, static_cast<unsigned long>(code.f_code.size()), &code.f_stack[0], sp, code.f_slots.empty() ? 0 : &code.f_slots[0]);
+	if(r != moExpr::MO_EXPR_ERROR_NONE) {
+		return r;
+	}
+	if(sp == 0) {
+		// no expression at all
+		return moExpr::MO_EXPR_ERROR_SYNTAX;
+	}
 
+	const mo_expr_value_t& top = code.f_stack[sp - 1];
+	switch(top.value_type) {
+	case MO_EXPR_TOKEN_INTEGER:
+		result.SetInteger(top.value_int);
+		break;
 
+	case MO_EXPR_TOKEN_FLOAT:
+		result.SetFloat(top.value_flt);
+		break;
 
+	case MO_EXPR_TOKEN_STRING:
+		result.SetString(top.value_str);
+		break;
 
-static moExpr::mo_expr_errno_t expr(mo_expr_state_t& state)
-{
-	moExpr::mo_expr_errno_t	r;
+	default:
+		return moExpr::MO_EXPR_ERROR_SYNTAX;
 
-	r = expr_token(state);
-	while(r == moExpr::MO_EXPR_ERROR_NONE
-	   && state.token != MO_EXPR_TOKEN_EOS) {
-		if(state.token != ';') {
-			r = expr_comma(state, false);
-		}
-		else {
-			// here we skip the ';'
-			r = expr_token(state);
-		}
 	}
 
-	return r;
+	return moExpr::MO_EXPR_ERROR_NONE;
 }
 
 
+
 moWCString moExpr::Result(void) const
 {
-	// by default we assume an error occurs
-	moWCString	result("ERROR");
-	mo_expr_state_t	state;
-	mo_expr_value_t	variables[MO_EXPR_VARIABLE_MAX];
-	char		buf[256];	/* Flawfinder: ignore */
-
-	// initialize the parser state
-	state.input = Data();
-	state.value.value_type = MO_EXPR_TOKEN_UNKNOWN;
-	state.variable = variables;
-
-//fprintf(stderr, "Computing [%s]\nReading -> ", SavedMBData());
-
-#ifdef MO_CONFIG_NO_MUTABLE
-	const_cast<mo_expr_errno_t&>(f_errno) = expr(state);
-#else
-	f_errno = expr(state);
-#endif
-	if(f_errno == MO_EXPR_ERROR_NONE) {
-		switch(state.value.value_type) {
-		case MO_EXPR_TOKEN_INTEGER:
-			sprintf(buf, "%ld", state.value.value_int);	/* Flawfinder: ignore */
-			result = buf;
-			break;
-
-		case MO_EXPR_TOKEN_FLOAT:
-			sprintf(buf, "%g", state.value.value_flt);	/* Flawfinder: ignore */
-			result = buf;
-			break;
+	moExprValue		value;
 
-		case MO_EXPR_TOKEN_STRING:
-			result = state.value.value_str;
-			break;
+	moExprProgramSPtr program(moExprProgram::Compile(*this));
 
-		default:
 #ifdef MO_CONFIG_NO_MUTABLE
-			const_cast<mo_expr_errno_t&>(f_errno) = MO_EXPR_ERROR_SYNTAX;
+	const_cast<mo_expr_errno_t&>(f_errno) = program->Evaluate(value);
 #else
-			f_errno = MO_EXPR_ERROR_SYNTAX;
-#endif
-			break;
-
-		}
-	}
-
-#if 0
-if(f_errno != 0) {
-fprintf(stderr, "\nFrom [%s] remaining [%S] (errno = %d)\n", SavedMBData(), state.input, f_errno);
-}
-else {
-fprintf(stderr, "\nFrom [%s] got result: [%s]\n", SavedMBData(), result.SavedMBData());
-}
+	f_errno = program->Evaluate(value);
 #endif
 
-	return result;
+	// by default we assume an error occurs
+	return f_errno == MO_EXPR_ERROR_NONE ? value.ToString() : moWCString("ERROR");
 }
 
 
@@ -4053,4 +3770,3 @@ fprintf(stderr, "\nFrom [%s] got result: [%s]\n", SavedMBData(), result.SavedMBD
 }			// namespace molib;
 
 // vim: ts=8
-
@@ -33,6 +33,14 @@
 
 #include	"mo/mo_dirent.h"
 
+#ifndef MO_DIRECTORY_WATCHER_H
+#include	"mo/mo_directory_watcher.h"
+#endif
+
+#include	<map>
+#include	<string>
+#include	<vector>
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4996)
 #endif
@@ -51,6 +59,100 @@ namespace molib
 #endif
 
 
+namespace
+{
+
+// a directory of a FindFile() path as it was when searched
+struct find_file_dir_t
+{
+	moWCString		f_directory;
+	bool			f_watched;	// changes get reported by the watcher
+	bool			f_exists;
+	time_t			f_mtime;
+	long			f_mtime_nsec;
+};
+
+struct find_file_entry_t
+{
+	moWCString			f_result;
+	std::vector<find_file_dir_t>	f_dirs;		// directories searched up to the one with the file
+};
+
+typedef std::map<std::string, find_file_entry_t>	find_file_cache_t;
+
+// the cache is cleared when it reaches that many entries
+const size_t		FIND_FILE_CACHE_MAX = 1024;
+
+const int		COPY_FILE_BUFFER_SIZE = 64 * 1024;
+
+struct find_file_state_t
+{
+				find_file_state_t(void)
+					: f_enabled(true),
+					  f_watcher(0),
+					  f_hits(0),
+					  f_misses(0)
+				{
+				}
+
+	moMutex			f_mutex;	// protects all the following fields
+	find_file_cache_t	f_cache;
+	bool			f_enabled;
+	moDirectoryWatcher *	f_watcher;
+	unsigned long		f_hits;
+	unsigned long		f_misses;
+};
+
+
+// never released since FindFile() may be called by objects
+// destroyed after the globals
+find_file_state_t& find_file_state(void)
+{
+	static find_file_state_t *g_state = new find_file_state_t;
+
+	return *g_state;
+}
+
+
+void find_file_stamp(find_file_dir_t& dir)
+{
+	struct stat st;
+
+	// an empty directory in the path is the current directory
+	dir.f_exists = stat(dir.f_directory.IsEmpty() ? "." : dir.f_directory.c_str(), &st) == 0;
+	dir.f_mtime = dir.f_exists ? st.st_mtime : 0;
+#if defined(MO_LINUX) || defined(LINUX)
+	dir.f_mtime_nsec = dir.f_exists ? st.st_mtim.tv_nsec : 0;
+#else
+	dir.f_mtime_nsec = 0;
+#endif
+}
+
+
+// whether the directories did not change since the entry was cached
+bool find_file_valid(const find_file_entry_t& entry)
+{
+	find_file_dir_t		now;
+
+	for(std::vector<find_file_dir_t>::const_iterator it = entry.f_dirs.begin(); it != entry.f_dirs.end(); ++it) {
+		if(it->f_watched) {
+			continue;
+		}
+		now.f_directory = it->f_directory;
+		find_file_stamp(now);
+		if(now.f_exists != it->f_exists
+		|| now.f_mtime != it->f_mtime
+		|| now.f_mtime_nsec != it->f_mtime_nsec) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}		// no name namespace
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -386,6 +488,48 @@ bool moFile::Stat(struct stat& st) const
 }
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moFile
+
+NAME
+
+	FileDescriptor - get the file descriptor of the open file
+
+SYNOPSIS
+
+	int FileDescriptor(void) const;
+
+DESCRIPTION
+
+	This function returns the system file descriptor of the file
+	attached to this moFile object.
+
+	Note that this object buffers its data. Call Flush() before
+	writing directly to the file descriptor and update the
+	position with WritePosition() afterward.
+
+RETURN VALUE
+
+	the file descriptor or -1 when the file isn't open
+
+SEE ALSO
+
+	Attach, Flush, Stat
+
+*/
+int moFile::FileDescriptor(void) const
+{
+	if(f_file == 0) {
+		return -1;
+	}
+
+	return fileno(f_file);
+}
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -1898,20 +2042,53 @@ DESCRIPTION
 	If no file is found, the function returns an empty string, otherwise
 	it returns the concatenation of the path and filename.
 
+	The results are cached so repeated searches do not need to access
+	each file again (see SetFindFileCache()).
+
 RETURNED VALUE
 
 	the path of the first file found to match the given access mode
 
 SEE ALSO
 
-	Access, moWord class
+	Access, moWord class, SetFindFileCache
 
 */
 molib::moWCString moFile::FindFile(const molib::moWCString& path, const moWCString& software, mo_access_t mode, const moWCString& separators)
 {
-	moWords		dirs;
-	moWCString	fullname;
-	int		idx, max;
+	moWords			dirs;
+	moWCString		fullname;
+	int			idx, max;
+	find_file_entry_t	entry;
+	moDirectoryWatcherSPtr	watcher;
+	std::string		key;
+	bool			cache;
+
+	find_file_state_t& state = find_file_state();
+	{
+		moLockMutex lock(state.f_mutex);
+		cache = state.f_enabled;
+		if(cache) {
+			key = path.SavedMBData();
+			key += '\0';
+			key += software.SavedMBData();
+			key += '\0';
+			key += separators.SavedMBData();
+			key += '\0';
+			// the access mode is a small set of flags
+			key += static_cast<char>('0' + mode);
+			find_file_cache_t::const_iterator it = state.f_cache.find(key);
+			if(it != state.f_cache.end()) {
+				if(find_file_valid(it->second)) {
+					++state.f_hits;
+					return it->second.f_result;
+				}
+				state.f_cache.erase(key);
+			}
+			++state.f_misses;
+			watcher = state.f_watcher;
+		}
+	}
 
 	if(separators.IsEmpty()) {
 #ifdef WIN32
@@ -1928,15 +2105,197 @@ molib::moWCString moFile::FindFile(const molib::moWCString& path, const moWCStri
 
 	max = dirs.Count();
 	for(idx = 0; idx < max; ++idx) {
+		if(cache) {
+			// stamp the directory before searching it so a change
+			// happening in between invalidates the entry
+			find_file_dir_t dir;
+			dir.f_directory = dirs[idx];
+			dir.f_watched = false;
+			find_file_stamp(dir);
+			if(watcher) {
+				if(dir.f_exists) {
+					dir.f_watched = watcher->Watch(dir.f_directory);
+				}
+				else {
+					// watch the closest existing parent to know when
+					// the directory gets created
+					find_file_dir_t parent;
+					parent.f_directory = dir.f_directory;
+					parent.f_exists = false;
+					for(;;) {
+						moWCString up = parent.f_directory.FilenameDirname();
+						if(up.IsEmpty()) {
+							up = ".";
+						}
+						if(up == parent.f_directory) {
+							break;
+						}
+						parent.f_directory = up;
+						find_file_stamp(parent);
+						if(parent.f_exists) {
+							break;
+						}
+					}
+					if(parent.f_exists) {
+						parent.f_watched = watcher->Watch(parent.f_directory);
+						dir.f_watched = parent.f_watched;
+						entry.f_dirs.push_back(parent);
+					}
+				}
+			}
+			entry.f_dirs.push_back(dir);
+		}
 		fullname = dirs[idx].FilenameChild(software);
 		if(molib::moFile::Access(fullname, mode)) {
 			// file exists and has proper access
-			return fullname;
+			entry.f_result = fullname;
+			break;
 		}
 	}
 
-	// Oops! not found
-	return "";
+	if(cache) {
+		moLockMutex lock(state.f_mutex);
+		// the watcher may have changed in between
+		if(state.f_enabled && state.f_watcher == static_cast<moDirectoryWatcher *>(watcher)) {
+			if(state.f_cache.size() >= FIND_FILE_CACHE_MAX) {
+				state.f_cache.clear();
+			}
+			state.f_cache[key] = entry;
+		}
+	}
+
+	// empty when not found
+	return entry.f_result;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFile
+
+NAME
+
+	SetFindFileCache - enable or disable the FindFile() cache
+	SetFindFileWatcher - use a watcher to validate the cache
+	InvalidateFindFileCache - forget the cached results
+	FindFileCacheCounters - retrieve the cache statistics
+
+SYNOPSIS
+
+	static void SetFindFileCache(bool enable);
+	static void SetFindFileWatcher(moDirectoryWatcher *watcher);
+	static void InvalidateFindFileCache(const moWCString& directory = "");
+	static void FindFileCacheCounters(unsigned long& hits, unsigned long& misses);
+
+PARAMETERS
+
+	enable - whether the results of FindFile() are cached
+	watcher - the watcher used to know when directories change, or 0
+	directory - a directory which changed (empty for all)
+	hits - the number of FindFile() calls answered by the cache
+	misses - the number of FindFile() calls which searched the path
+
+DESCRIPTION
+
+	The FindFile() function keeps the result of each search keyed
+	on the path, filename, access mode and separators. The cache
+	is enabled by default.
+
+	A result is used again as long as the directories searched to
+	find it did not change. By default, the modification time of
+	these directories is checked with stat(2) on each call. Note
+	that the modification time of a directory does not change
+	when the permissions of one of its files change.
+
+	When a watcher is defined, the directories searched are
+	watched and are not checked anymore; the watcher invalidates
+	the results as soon as it reads a change in one of them (it
+	needs to run in its own thread or be polled.) Directories
+	which do not exist are still checked with stat(2). The
+	watcher should be dedicated to this cache since watching an
+	already watched directory replaces its pattern.
+
+	The InvalidateFindFileCache() function removes all the
+	results which depend on the specified directory, or all of
+	them when directory is empty. Changing the watcher or
+	disabling the cache also removes all the results.
+
+SEE ALSO
+
+	FindFile, moDirectoryWatcher
+
+*/
+void moFile::SetFindFileCache(bool enable)
+{
+	find_file_state_t& state = find_file_state();
+	moLockMutex lock(state.f_mutex);
+
+	state.f_enabled = enable;
+	state.f_cache.clear();
+}
+
+
+void moFile::SetFindFileWatcher(moDirectoryWatcher *watcher)
+{
+	find_file_state_t& state = find_file_state();
+	moDirectoryWatcherSPtr old;
+	{
+		moLockMutex lock(state.f_mutex);
+
+		if(watcher != 0) {
+			watcher->AddRef();
+		}
+		// released once unlocked since the watcher destructor
+		// may invalidate the cache
+		old = state.f_watcher;
+		if(state.f_watcher != 0) {
+			state.f_watcher->Release();
+		}
+		state.f_watcher = watcher;
+		state.f_cache.clear();
+	}
+}
+
+
+void moFile::InvalidateFindFileCache(const moWCString& directory)
+{
+	find_file_state_t& state = find_file_state();
+	moLockMutex lock(state.f_mutex);
+
+	if(directory.IsEmpty()) {
+		state.f_cache.clear();
+		return;
+	}
+
+	find_file_cache_t::iterator it = state.f_cache.begin();
+	while(it != state.f_cache.end()) {
+		bool found = false;
+		for(std::vector<find_file_dir_t>::const_iterator d = it->second.f_dirs.begin(); d != it->second.f_dirs.end(); ++d) {
+			if(d->f_directory == directory) {
+				found = true;
+				break;
+			}
+		}
+		if(found) {
+			state.f_cache.erase(it++);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+
+void moFile::FindFileCacheCounters(unsigned long& hits, unsigned long& misses)
+{
+	find_file_state_t& state = find_file_state();
+	moLockMutex lock(state.f_mutex);
+
+	hits = state.f_hits;
+	misses = state.f_misses;
 }
 
 
@@ -2288,15 +2647,19 @@ bool moFile::CopyFile(const moWCString& source, const moWCString& destination)
 	}
 
 	// a large buffer
-	p = new char[64 * 1024];
+	p = new char[COPY_FILE_BUFFER_SIZE];
 
 	for(;;) {
-		l = s.Read(p, sizeof(p));
+		l = s.Read(p, COPY_FILE_BUFFER_SIZE);
 		if(l <= 0) {
 			break;
 		}
-		d.Write(p, l);
+		if(d.Write(p, l) != l) {
+			l = -1;
+			break;
+		}
 	}
+	delete [] p;
 
 	// get rid of the destination if an error occurs
 	if(l != 0) {
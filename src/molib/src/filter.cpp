@@ -0,0 +1,1471 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+
+
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma implementation "mo/mo_filter.h"
+#endif
+
+#include	"mo/mo_filter.h"
+
+#ifndef MO_TEMPLATE_H
+#include	"mo/mo_template.h"
+#endif
+
+#include	<vector>
+
+
+namespace molib
+{
+
+
+namespace
+{
+
+// a Read() of at least that many bytes has the last stage write
+// directly in the user buffer instead of going through the last span
+const unsigned long	FILTER_DIRECT_READ_SIZE = 1024;
+
+// the part of a pool buffer used by one stage for its output
+struct filter_span_t {
+	unsigned char *		f_data;
+	unsigned long		f_pos;		// start of the data not yet consumed
+	unsigned long		f_size;		// end of the valid data
+
+				filter_span_t(void)
+				{
+					f_data = 0;
+					f_pos = 0;
+					f_size = 0;
+				}
+};
+
+moFilterBufferPool *filter_create_default_pool(void)
+{
+	moFilterBufferPool	*pool;
+
+	pool = new moFilterBufferPool;
+	pool->AddRef();		// never released
+
+	return pool;
+}
+
+}		// no name namespace
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterBufferPool
+
+NAME
+
+	Constructor - initialize a pool of buffers
+	Destructor - free all the buffers of a pool
+
+SYNOPSIS
+
+	moFilterBufferPool(unsigned long buffer_size = FILTER_BUFFER_SIZE_DEFAULT,
+			unsigned long keep = FILTER_BUFFER_KEEP_DEFAULT);
+	virtual ~moFilterBufferPool();
+
+PARAMETERS
+
+	buffer_size - the size of each buffer
+	keep - the maximum number of free buffers kept for reuse
+
+DESCRIPTION
+
+	A buffer pool allocates buffers of one size and keeps them
+	once released so the next filter pipeline can use them again
+	without going through the memory allocator.
+
+	The pool never keeps more than 'keep' free buffers. Extra
+	buffers are freed as they are released.
+
+	All the buffers have to be released before the pool is
+	destroyed. Since the pipelines hold a smart pointer to their
+	pool, that is automatic unless you call AcquireBuffer() yourself.
+
+SEE ALSO
+
+	AcquireBuffer, ReleaseBuffer, DefaultPool
+
+*/
+moFilterBufferPool::moFilterBufferPool(unsigned long buffer_size, unsigned long keep)
+	: f_buffer_size(buffer_size < sizeof(buffer_t) ? sizeof(buffer_t) : buffer_size),
+	  f_keep(keep)
+{
+	f_free_count = 0;
+	f_allocations = 0;
+	f_free = 0;
+}
+
+
+moFilterBufferPool::~moFilterBufferPool()
+{
+	buffer_t	*buffer;
+
+	while(f_free != 0) {
+		buffer = f_free;
+		f_free = buffer->f_next;
+		delete [] reinterpret_cast<unsigned char *>(buffer);
+	}
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterBufferPool
+
+NAME
+
+	static DefaultPool - the pool shared by all the pipelines
+
+SYNOPSIS
+
+	static moFilterBufferPool *DefaultPool(void);
+
+DESCRIPTION
+
+	This function returns the pool used by the filter pipelines
+	created without a pool. It uses buffers of
+	FILTER_BUFFER_SIZE_DEFAULT bytes.
+
+	This pool is never destroyed.
+
+RETURN VALUE
+
+	a pointer to the default pool
+
+SEE ALSO
+
+	moFilterPipeline::moFilterPipeline
+
+*/
+moFilterBufferPool *moFilterBufferPool::DefaultPool(void)
+{
+	static moFilterBufferPool	*g_default_pool = filter_create_default_pool();
+
+	return g_default_pool;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterBufferPool
+
+NAME
+
+	BufferSize - the size of the buffers of this pool
+	Allocations - number of buffers allocated so far
+
+SYNOPSIS
+
+	unsigned long BufferSize(void) const;
+	unsigned long Allocations(void) const;
+
+DESCRIPTION
+
+	The BufferSize() function returns the size in bytes of all
+	the buffers returned by AcquireBuffer().
+
+	The Allocations() function returns the number of times the
+	pool had to allocate a new buffer because no free buffer was
+	available. Once the pipelines run, this number should stay
+	still.
+
+RETURN VALUE
+
+	BufferSize() returns a size in bytes
+	Allocations() returns a counter
+
+*/
+unsigned long moFilterBufferPool::BufferSize(void) const
+{
+	return f_buffer_size;
+}
+
+
+unsigned long moFilterBufferPool::Allocations(void) const
+{
+	moLockMutex	lock(f_mutex);
+
+	return f_allocations;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterBufferPool
+
+NAME
+
+	AcquireBuffer - get a buffer from the pool
+	ReleaseBuffer - give a buffer back to the pool
+
+SYNOPSIS
+
+	unsigned char *AcquireBuffer(void);
+	void ReleaseBuffer(unsigned char *buffer);
+
+PARAMETERS
+
+	buffer - a buffer previously returned by AcquireBuffer()
+
+DESCRIPTION
+
+	The AcquireBuffer() function returns a buffer of BufferSize() bytes.
+	A free buffer is reused when available, otherwise a new buffer
+	is allocated.
+
+	The ReleaseBuffer() function gives a buffer back to the pool. The
+	buffer must have been obtained from the same pool.
+
+	Both functions can be called from any thread.
+
+ERRORS
+
+	AcquireBuffer() throws std::bad_alloc when no more memory is
+	available.
+
+RETURN VALUE
+
+	AcquireBuffer() returns a pointer to a buffer of BufferSize() bytes
+
+SEE ALSO
+
+	BufferSize
+
+*/
+unsigned char *moFilterBufferPool::AcquireBuffer(void)
+{
+	buffer_t	*buffer;
+
+	{
+		moLockMutex	lock(f_mutex);
+
+		buffer = f_free;
+		if(buffer != 0) {
+			f_free = buffer->f_next;
+			f_free_count--;
+			return reinterpret_cast<unsigned char *>(buffer);
+		}
+		f_allocations++;
+	}
+
+	return new unsigned char[f_buffer_size];
+}
+
+
+void moFilterBufferPool::ReleaseBuffer(unsigned char *buffer)
+{
+	buffer_t	*b;
+
+	if(buffer == 0) {
+		return;
+	}
+
+	{
+		moLockMutex	lock(f_mutex);
+
+		if(f_free_count < f_keep) {
+			b = reinterpret_cast<buffer_t *>(buffer);
+			b->f_next = f_free;
+			f_free = b;
+			f_free_count++;
+			return;
+		}
+	}
+
+	delete [] buffer;
+}
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterStage
+
+NAME
+
+	Constructor - initialize a filter stage
+	Destructor - clean up a filter stage
+
+SYNOPSIS
+
+	moFilterStage(void);
+	virtual ~moFilterStage();
+
+DESCRIPTION
+
+	An moFilterStage is one transformation of the data going
+	through an moFilterPipeline. Derive from it and implement
+	at least the Transform() function.
+
+SEE ALSO
+
+	Transform, Finish, Reset
+
+*/
+moFilterStage::moFilterStage(void)
+{
+}
+
+
+moFilterStage::~moFilterStage()
+{
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterStage
+
+NAME
+
+	Transform - transform the input span in the output span
+	Finish - output the data kept in the stage at the end of a stream
+	Reset - forget about the current stream
+
+SYNOPSIS
+
+	virtual int Transform(const void *input, unsigned long& input_size,
+			void *output, unsigned long output_size) = 0;
+	virtual int Finish(void *output, unsigned long output_size);
+	virtual void Reset(void);
+
+PARAMETERS
+
+	input - the data to transform
+	input_size - the number of bytes in input on entry and the
+		number of bytes consumed on return
+	output - where the transformed data is saved
+	output_size - the number of bytes available in output
+
+DESCRIPTION
+
+	The Transform() function reads the input span and writes the
+	result in the output span. Neither span belongs to the stage:
+	the input span is only valid during the call and the output
+	span is owned by the pipeline (or is the user buffer of the
+	Read() call.)
+
+	The function has to consume as much input as it can. It can
+	stop early only when the output span is full. Data which can't
+	be transformed yet (i.e. an incomplete multi-byte character)
+	must be kept within the stage. Note that Transform() can be
+	called with an empty input when the previous call filled the
+	output span; this gives the stage a chance to output data it
+	had to keep.
+
+	The Finish() function is called once all the input of a stream
+	was given to the stage. It saves the remaining data in the
+	output span. It is called repeatedly until it returns zero.
+	The stage is then expected to be ready for a new stream. By
+	default it returns zero.
+
+	The Reset() function drops whatever data and state the stage
+	has so it can be used on a new stream. By default it does
+	nothing.
+
+RETURN VALUE
+
+	Transform() and Finish() return the number of bytes written
+	in the output span or -1 when an error occurs (errno is set)
+
+SEE ALSO
+
+	moFilterPipeline::AddStage
+
+*/
+int moFilterStage::Finish(void *output, unsigned long output_size)
+{
+	return 0;
+}
+
+
+void moFilterStage::Reset(void)
+{
+}
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFIFOFilterStage
+
+NAME
+
+	Constructor - create a stage running an moFIFO filter
+	Destructor - release the FIFO
+
+SYNOPSIS
+
+	moFIFOFilterStage(moFIFO *fifo);
+	virtual ~moFIFOFilterStage();
+
+PARAMETERS
+
+	fifo - the FIFO used as a filter
+
+DESCRIPTION
+
+	This stage is used to chain filters written as an moFIFO
+	(such as the mowc::moIConv convertor) in an moFilterPipeline.
+
+	The data is written in the FIFO and the result read back
+	from it. This costs one more copy than a stage implementing
+	Transform() directly.
+
+SEE ALSO
+
+	FIFO
+
+*/
+moFIFOFilterStage::moFIFOFilterStage(moFIFO *fifo)
+	: f_fifo(fifo)
+{
+}
+
+
+moFIFOFilterStage::~moFIFOFilterStage()
+{
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFIFOFilterStage
+
+NAME
+
+	FIFO - the FIFO used by this stage
+
+SYNOPSIS
+
+	moFIFOSPtr FIFO(void) const;
+
+RETURN VALUE
+
+	the FIFO given to the constructor
+
+*/
+moFIFOSPtr moFIFOFilterStage::FIFO(void) const
+{
+	return f_fifo;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFIFOFilterStage
+
+NAME
+
+	Transform - write the input in the FIFO and read the result
+	Finish - flush the FIFO and read the result
+	Reset - reset the FIFO
+
+SYNOPSIS
+
+	virtual int Transform(const void *input, unsigned long& input_size,
+			void *output, unsigned long output_size);
+	virtual int Finish(void *output, unsigned long output_size);
+	virtual void Reset(void);
+
+PARAMETERS
+
+	input - the data to transform
+	input_size - the number of bytes in input on entry and the
+		number of bytes consumed on return
+	output - where the transformed data is saved
+	output_size - the number of bytes available in output
+
+DESCRIPTION
+
+	These functions run the FIFO as the moIStream and moOStream
+	would: the input is written in the FIFO as space permits and
+	the result read back until the FIFO has nothing more to
+	offer or the output span is full.
+
+RETURN VALUE
+
+	the number of bytes saved in the output span or -1 on errors
+
+SEE ALSO
+
+	moFilterStage::Transform
+
+*/
+int moFIFOFilterStage::Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size)
+{
+	unsigned long	used, total;
+	int		w, r;
+
+	if(!f_fifo) {
+		return -1;
+	}
+
+	used = 0;
+	total = 0;
+	for(;;) {
+		r = f_fifo->Read(static_cast<unsigned char *>(output) + total, output_size - total);
+		if(r < 0) {
+			return -1;
+		}
+		total += r;
+		if(total == output_size || used == input_size) {
+			break;
+		}
+		w = f_fifo->Write(static_cast<const unsigned char *>(input) + used,
+				moMin(f_fifo->FreeSpace(), input_size - used));
+		if(w < 0) {
+			return -1;
+		}
+		if(w == 0 && r == 0) {
+			// the FIFO is stuck
+			break;
+		}
+		used += w;
+	}
+	input_size = used;
+
+	return static_cast<int>(total);
+}
+
+
+int moFIFOFilterStage::Finish(void *output, unsigned long output_size)
+{
+	if(!f_fifo) {
+		return 0;
+	}
+
+	f_fifo->Flush();
+
+	return f_fifo->Read(output, output_size);
+}
+
+
+void moFIFOFilterStage::Reset(void)
+{
+	if(f_fifo) {
+		f_fifo->Reset();
+	}
+}
+
+
+
+
+
+// the stages and the spans between them; span N is the input of
+// stage N and the output of stage N - 1; the last span is the
+// output of the pipeline
+class moFilterPipeline::moChain
+{
+public:
+				moChain(moFilterBufferPool *pool);
+				~moChain();
+
+	unsigned long		Count(void) const;
+	void			Attach(void);
+	void			Detach(void);
+	void			Empty(void);
+
+	filter_span_t&		Span(unsigned long index);
+	unsigned char *		Room(unsigned long index, unsigned long& room);
+	int			Step(unsigned long index, const unsigned char *input, unsigned long& input_size,
+						unsigned char *output, unsigned long output_size, unsigned long& produced);
+	int			Pump(unsigned long count);
+	int			Finish(void);
+
+	std::vector<moFilterStageSPtr>	f_stages;
+
+private:
+	moFilterBufferPool *		f_pool;
+	std::vector<filter_span_t>	f_spans;
+	std::vector<bool>		f_pending;	// the last Transform() filled its output
+	unsigned long			f_finished;	// number of stages which completed their Finish()
+};
+
+
+moFilterPipeline::moChain::moChain(moFilterBufferPool *pool)
+	: f_pool(pool),
+	  f_finished(0)
+{
+}
+
+
+moFilterPipeline::moChain::~moChain()
+{
+	Detach();
+}
+
+
+unsigned long moFilterPipeline::moChain::Count(void) const
+{
+	return static_cast<unsigned long>(f_stages.size());
+}
+
+
+// get one buffer from the pool per span
+void moFilterPipeline::moChain::Attach(void)
+{
+	if(f_spans.size() == f_stages.size() + 1) {
+		return;
+	}
+
+	Detach();
+	f_spans.resize(f_stages.size() + 1);
+	for(std::vector<filter_span_t>::iterator it = f_spans.begin(); it != f_spans.end(); ++it) {
+		it->f_data = f_pool->AcquireBuffer();
+	}
+	f_pending.assign(f_stages.size(), false);
+	f_finished = 0;
+}
+
+
+// give the buffers back to the pool (data still in there is lost)
+void moFilterPipeline::moChain::Detach(void)
+{
+	for(std::vector<filter_span_t>::iterator it = f_spans.begin(); it != f_spans.end(); ++it) {
+		f_pool->ReleaseBuffer(it->f_data);
+	}
+	f_spans.clear();
+	f_pending.clear();
+	f_finished = 0;
+}
+
+
+// drop the data but keep the buffers
+void moFilterPipeline::moChain::Empty(void)
+{
+	for(std::vector<filter_span_t>::iterator it = f_spans.begin(); it != f_spans.end(); ++it) {
+		it->f_pos = 0;
+		it->f_size = 0;
+	}
+	f_pending.assign(f_pending.size(), false);
+	f_finished = 0;
+}
+
+
+filter_span_t& moFilterPipeline::moChain::Span(unsigned long index)
+{
+	return f_spans[index];
+}
+
+
+// the free space at the end of a span; data left at the start of
+// the buffer is moved down when it is in the way
+unsigned char *moFilterPipeline::moChain::Room(unsigned long index, unsigned long& room)
+{
+	filter_span_t&	span = f_spans[index];
+	unsigned long	size;
+
+	size = f_pool->BufferSize();
+	if(span.f_pos == span.f_size) {
+		span.f_pos = 0;
+		span.f_size = 0;
+	}
+	else if(span.f_pos > 0 && size - span.f_size < size / 2) {
+		memmove(span.f_data, span.f_data + span.f_pos, span.f_size - span.f_pos);	/* Flawfinder: ignore */
+		span.f_size -= span.f_pos;
+		span.f_pos = 0;
+	}
+	room = size - span.f_size;
+
+	return span.f_data + span.f_size;
+}
+
+
+// run one stage once; returns 1 when some data was consumed or
+// produced, 0 when the stage can't do anything and -1 on errors
+int moFilterPipeline::moChain::Step(unsigned long index, const unsigned char *input, unsigned long& input_size,
+					unsigned char *output, unsigned long output_size, unsigned long& produced)
+{
+	unsigned long	available;
+	int		r;
+
+	produced = 0;
+	available = input_size;
+	input_size = 0;
+	if(output_size == 0 || (available == 0 && !f_pending[index])) {
+		return 0;
+	}
+
+	input_size = available;
+	r = f_stages[index]->Transform(input, input_size, output, output_size);
+	if(r < 0) {
+		input_size = 0;
+		return -1;
+	}
+	if(input_size > available) {
+		input_size = available;
+	}
+	produced = static_cast<unsigned long>(r) > output_size ? output_size : r;
+	f_pending[index] = produced == output_size;
+
+	return input_size > 0 || produced > 0 ? 1 : 0;
+}
+
+
+// move the data through the first 'count' stages as far as it goes
+int moFilterPipeline::moChain::Pump(unsigned long count)
+{
+	unsigned long	idx, used, room, produced;
+	unsigned char	*out;
+	bool		again;
+	int		r, result;
+
+	result = 0;
+	do {
+		again = false;
+		for(idx = 0; idx < count; ++idx) {
+			for(;;) {
+				filter_span_t& in = f_spans[idx];
+				out = Room(idx + 1, room);
+				used = in.f_size - in.f_pos;
+				r = Step(idx, in.f_data + in.f_pos, used, out, room, produced);
+				if(r < 0) {
+					return -1;
+				}
+				if(r == 0) {
+					break;
+				}
+				in.f_pos += used;
+				f_spans[idx + 1].f_size += produced;
+				again = true;
+				result = 1;
+			}
+		}
+	} while(again);
+
+	return result;
+}
+
+
+// finish the stages one after another; returns 1 once done and 0
+// when the output has to be read before we can go on
+int moFilterPipeline::moChain::Finish(void)
+{
+	unsigned long	count, room;
+	unsigned char	*out;
+	int		r;
+
+	count = Count();
+	while(f_finished < count) {
+		if(Pump(count) < 0) {
+			return -1;
+		}
+		filter_span_t& in = f_spans[f_finished];
+		if(in.f_pos != in.f_size || f_pending[f_finished]) {
+			// blocked by a full output
+			return 0;
+		}
+		out = Room(f_finished + 1, room);
+		if(room == 0) {
+			return 0;
+		}
+		r = f_stages[f_finished]->Finish(out, room);
+		if(r < 0) {
+			return -1;
+		}
+		if(r == 0) {
+			f_finished++;
+		}
+		else {
+			f_spans[f_finished + 1].f_size += r;
+		}
+	}
+	if(Pump(count) < 0) {
+		return -1;
+	}
+	f_finished = 0;
+
+	return 1;
+}
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterPipeline
+
+NAME
+
+	Constructor - create an empty pipeline
+	Destructor - release the stages and buffers
+
+SYNOPSIS
+
+	moFilterPipeline(moFilterBufferPool *pool = 0);
+	virtual ~moFilterPipeline();
+
+PARAMETERS
+
+	pool - the pool used to get the buffers between stages
+
+DESCRIPTION
+
+	A filter pipeline is an moFIFO which runs its data through
+	a list of moFilterStage objects. It can therefore be used
+	anywhere a FIFO filter is accepted, in particular with the
+	moIStream::SetInputFilter() and moOStream::SetOutputFilter()
+	functions (and the scope filter objects.)
+
+	Each stage reads the output of the previous stage in place
+	and writes its own output in a buffer taken from the pool.
+	When the pool is not specified, the default pool is used.
+	The buffers are taken when the data first goes through the
+	pipeline and given back when the pipeline is destroyed or
+	its stages removed.
+
+	The streams recognize pipelines and avoid the intermediate
+	buffers they use with other filters: the raw input is read
+	directly in the first span, the first stage of an output
+	pipeline reads the user buffer in place, and the output of
+	the last stage is written as is to the raw output stream.
+
+	Without any stage, a pipeline is a FIFO of the size of one
+	pool buffer.
+
+SEE ALSO
+
+	AddStage, moFilterBufferPool::DefaultPool
+
+*/
+moFilterPipeline::moFilterPipeline(moFilterBufferPool *pool)
+	: f_pool(pool == 0 ? moFilterBufferPool::DefaultPool() : pool),
+	  f_chain(new moChain(f_pool))
+{
+}
+
+
+moFilterPipeline::~moFilterPipeline()
+{
+	delete f_chain;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterPipeline
+
+NAME
+
+	AddStage - append a stage to the pipeline
+	RemoveAllStages - remove all the stages of the pipeline
+	Count - number of stages
+	GetStage - retrieve a stage
+	Pool - the pool used by this pipeline
+
+SYNOPSIS
+
+	bool AddStage(moFilterStage *stage);
+	void RemoveAllStages(void);
+	unsigned long Count(void) const;
+	moFilterStageSPtr GetStage(unsigned long index) const;
+	moFilterBufferPoolSPtr Pool(void) const;
+
+PARAMETERS
+
+	stage - the stage to append
+	index - the index of the stage to retrieve
+
+DESCRIPTION
+
+	The AddStage() function appends a stage at the end of the
+	pipeline. The data goes through the stages in the order they
+	were added.
+
+	The RemoveAllStages() function removes all the stages and
+	gives the buffers back to the pool. Any data still in the
+	pipeline is lost.
+
+	Stages should only be added or removed while the pipeline
+	is not in use since the data in the pipeline would otherwise
+	be lost.
+
+RETURN VALUE
+
+	AddStage() returns false if the stage is null
+	Count() returns the number of stages
+	GetStage() returns the stage or a null pointer when the index
+	is out of bounds
+	Pool() returns the pool
+
+*/
+bool moFilterPipeline::AddStage(moFilterStage *stage)
+{
+	if(stage == 0) {
+		return false;
+	}
+
+	Lock();
+	f_chain->Detach();
+	f_chain->f_stages.push_back(stage);
+	Unlock();
+
+	return true;
+}
+
+
+void moFilterPipeline::RemoveAllStages(void)
+{
+	Lock();
+	f_chain->Detach();
+	f_chain->f_stages.clear();
+	Unlock();
+}
+
+
+unsigned long moFilterPipeline::Count(void) const
+{
+	return f_chain->Count();
+}
+
+
+moFilterStageSPtr moFilterPipeline::GetStage(unsigned long index) const
+{
+	if(index >= f_chain->Count()) {
+		return 0;
+	}
+
+	return f_chain->f_stages[index];
+}
+
+
+moFilterBufferPoolSPtr moFilterPipeline::Pool(void) const
+{
+	return f_pool;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterPipeline
+
+NAME
+
+	Reset - drop the data and reset all the stages
+	MaxSize - the size of the buffers
+	Size - the number of bytes ready to be read
+	FreeSpace - the number of bytes which can be written
+
+SYNOPSIS
+
+	virtual void Reset(void);
+	virtual unsigned long MaxSize(void) const;
+	virtual unsigned long Size(void) const;
+	virtual unsigned long FreeSpace(void) const;
+
+DESCRIPTION
+
+	These functions overload the moFIFO functions.
+
+	Size() only counts the data which already went through all
+	the stages. A Read() may return more since it runs the stages
+	as required.
+
+	FreeSpace() returns the space left in the input buffer. A
+	Write() may accept more since the first stage reads the user
+	buffer in place.
+
+RETURN VALUE
+
+	a size in bytes
+
+SEE ALSO
+
+	moFIFO::Reset, moFIFO::MaxSize, moFIFO::Size, moFIFO::FreeSpace
+
+*/
+void moFilterPipeline::Reset(void)
+{
+	Lock();
+	f_chain->Empty();
+	for(std::vector<moFilterStageSPtr>::iterator it = f_chain->f_stages.begin(); it != f_chain->f_stages.end(); ++it) {
+		(*it)->Reset();
+	}
+	Unlock();
+}
+
+
+unsigned long moFilterPipeline::MaxSize(void) const
+{
+	return f_pool->BufferSize();
+}
+
+
+unsigned long moFilterPipeline::Size(void) const
+{
+	unsigned long	size;
+
+	const_cast<moFilterPipeline *>(this)->Lock();
+	f_chain->Attach();
+	filter_span_t& span = f_chain->Span(f_chain->Count());
+	size = span.f_size - span.f_pos;
+	const_cast<moFilterPipeline *>(this)->Unlock();
+
+	return size;
+}
+
+
+unsigned long moFilterPipeline::FreeSpace(void) const
+{
+	unsigned long	size;
+
+	const_cast<moFilterPipeline *>(this)->Lock();
+	f_chain->Attach();
+	filter_span_t& span = f_chain->Span(0);
+	size = f_pool->BufferSize() - (span.f_size - span.f_pos);
+	const_cast<moFilterPipeline *>(this)->Unlock();
+
+	return size;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterPipeline
+
+NAME
+
+	Flush - run the data through all the stages
+	WaitData - check whether data can be read
+	Finish - end the stream going through the stages
+
+SYNOPSIS
+
+	virtual bool Flush(int64_t ustime = -1);
+	virtual bool WaitData(int64_t ustime = -1,
+			unsigned long size = static_cast<unsigned long>(-1));
+	bool Finish(void);
+
+PARAMETERS
+
+	ustime - ignored, these functions never block
+	size - the number of bytes expected
+
+DESCRIPTION
+
+	The Flush() function moves the data written so far as far as
+	possible through the stages. It does not end the stream: a
+	stage (a compressor for instance) may keep data until Finish()
+	is called.
+
+	The WaitData() function runs the stages and checks whether at
+	least 'size' bytes are ready to be read (or some bytes when
+	size is -1.)
+
+	The Finish() function tells all the stages, one after another,
+	that the end of the stream was reached so they output the data
+	they kept. When the output of the pipeline gets full, the
+	function returns false. Read the output and call Finish()
+	again until it returns true. Once finished, the pipeline can
+	be used for a new stream.
+
+	The moOStream::SetOutputFilter() function calls Finish() on
+	the pipeline it replaces.
+
+RETURN VALUE
+
+	Flush() returns true unless a stage fails
+	WaitData() returns true when enough data can be read
+	Finish() returns true when all the stages are finished
+
+SEE ALSO
+
+	Read, Write, OutputSpan
+
+*/
+bool moFilterPipeline::Flush(int64_t ustime)
+{
+	int		r;
+
+	if(!Lock()) {
+		return false;
+	}
+	f_chain->Attach();
+	r = f_chain->Pump(f_chain->Count());
+	Unlock();
+
+	return r >= 0;
+}
+
+
+bool moFilterPipeline::WaitData(int64_t ustime, unsigned long size)
+{
+	unsigned long	available;
+
+	if(!Flush(ustime)) {
+		return false;
+	}
+	available = Size();
+
+	return size == static_cast<unsigned long>(-1) ? available > 0 : available >= size;
+}
+
+
+bool moFilterPipeline::Finish(void)
+{
+	int		r;
+
+	if(!Lock()) {
+		return false;
+	}
+	f_chain->Attach();
+	r = f_chain->Finish();
+	Unlock();
+
+	return r > 0;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterPipeline
+
+NAME
+
+	Write - send data through the pipeline
+	Read - read the data which went through the pipeline
+
+SYNOPSIS
+
+	virtual int Write(const void *buffer, unsigned long size);
+	virtual int Read(void *buffer, unsigned long size, bool peek = false);
+
+PARAMETERS
+
+	buffer - the data to write or where the data read is saved
+	size - the size of the buffer
+	peek - whether the data read is kept in the pipeline
+
+DESCRIPTION
+
+	The Write() function gives the user buffer to the first stage
+	as is. The result is then moved through the following stages
+	until the last span is full.
+
+	The Read() function returns the data found in the last span
+	and then runs the stages to get more. When the user buffer is
+	large enough, the last stage writes directly in it.
+
+	A Read() with peek set to true can't return more than one
+	buffer worth of data.
+
+RETURN VALUE
+
+	the number of bytes written or read; it can be zero when
+	the pipeline is full (Write) or empty (Read)
+
+	-1 when a stage fails
+
+SEE ALSO
+
+	InputSpan, OutputSpan, moFIFO::Read, moFIFO::Write
+
+*/
+int moFilterPipeline::Write(const void *buffer, unsigned long size)
+{
+	const unsigned char	*in;
+	unsigned char		*out;
+	unsigned long		count, total, used, room, produced;
+	int			r;
+
+	if(!Lock()) {
+		return -1;
+	}
+	f_chain->Attach();
+
+	count = f_chain->Count();
+	in = static_cast<const unsigned char *>(buffer);
+	total = 0;
+	r = f_chain->Pump(count);
+	while(r >= 0 && size > 0) {
+		filter_span_t& span = f_chain->Span(0);
+		if(count == 0 || span.f_pos != span.f_size) {
+			// data is already waiting, put this data behind
+			out = f_chain->Room(0, room);
+			used = moMin(room, size);
+			memcpy(out, in, used);		/* Flawfinder: ignore */
+			span.f_size += used;
+		}
+		else {
+			// the first stage reads the user buffer in place
+			out = f_chain->Room(1, room);
+			used = size;
+			r = f_chain->Step(0, in, used, out, room, produced);
+			if(r < 0) {
+				break;
+			}
+			f_chain->Span(1).f_size += produced;
+			if(r == 0) {
+				break;
+			}
+		}
+		if(used == 0 && count == 0) {
+			break;
+		}
+		in += used;
+		size -= used;
+		total += used;
+		r = f_chain->Pump(count);
+		if(used == 0 && r == 0) {
+			break;
+		}
+	}
+	Unlock();
+
+	return r < 0 ? -1 : static_cast<int>(total);
+}
+
+
+int moFilterPipeline::Read(void *buffer, unsigned long size, bool peek)
+{
+	unsigned char	*out;
+	unsigned long	count, total, available, used, produced;
+	int		r;
+
+	if(!Lock()) {
+		return -1;
+	}
+	f_chain->Attach();
+
+	count = f_chain->Count();
+	out = static_cast<unsigned char *>(buffer);
+	total = 0;
+	r = 0;
+	if(peek) {
+		r = f_chain->Pump(count);
+	}
+	while(r >= 0 && size > 0) {
+		filter_span_t& last = f_chain->Span(count);
+		available = last.f_size - last.f_pos;
+		if(available > 0) {
+			if(available > size) {
+				available = size;
+			}
+			memcpy(out, last.f_data + last.f_pos, available);	/* Flawfinder: ignore */
+			total += available;
+			if(peek) {
+				break;
+			}
+			last.f_pos += available;
+			out += available;
+			size -= available;
+			continue;
+		}
+		if(peek || count == 0) {
+			break;
+		}
+		if(size >= FILTER_DIRECT_READ_SIZE) {
+			// the last stage writes directly in the user buffer
+			r = f_chain->Pump(count - 1);
+			if(r < 0) {
+				break;
+			}
+			filter_span_t& in = f_chain->Span(count - 1);
+			used = in.f_size - in.f_pos;
+			r = f_chain->Step(count - 1, in.f_data + in.f_pos, used, out, size, produced);
+			if(r <= 0) {
+				break;
+			}
+			in.f_pos += used;
+			out += produced;
+			size -= produced;
+			total += produced;
+		}
+		else {
+			r = f_chain->Pump(count);
+			if(r <= 0) {
+				break;
+			}
+		}
+	}
+	Unlock();
+
+	return r < 0 ? -1 : static_cast<int>(total);
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moFilterPipeline
+
+NAME
+
+	InputSpan - the free space of the input buffer
+	CommitInput - the data was saved in the input buffer
+	OutputSpan - the data which went through the pipeline
+	ConsumeOutput - the output data was used
+
+SYNOPSIS
+
+	void *InputSpan(unsigned long& size);
+	void CommitInput(unsigned long size);
+	const void *OutputSpan(unsigned long& size);
+	void ConsumeOutput(unsigned long size);
+
+PARAMETERS
+
+	size - the size of the span (returned) or the number of
+		bytes used in the span
+
+DESCRIPTION
+
+	These functions give direct access to the buffers at both ends
+	of the pipeline so a stream can fill the pipeline and empty it
+	without an intermediate buffer.
+
+	The InputSpan() function returns a pointer where at most 'size'
+	bytes can be saved. Once the data is there, call CommitInput()
+	with the number of bytes actually saved.
+
+	The OutputSpan() function runs the stages and returns a
+	pointer to the 'size' bytes ready to be read. Once used, call
+	ConsumeOutput() with the number of bytes used.
+
+	No other function of the pipeline should be called between
+	the two calls.
+
+RETURN VALUE
+
+	InputSpan() and OutputSpan() return a pointer to the span;
+	size is set to zero when no space or no data is available
+
+SEE ALSO
+
+	Read, Write
+
+*/
+void *moFilterPipeline::InputSpan(unsigned long& size)
+{
+	void		*span;
+
+	Lock();
+	f_chain->Attach();
+	span = f_chain->Room(0, size);
+	Unlock();
+
+	return span;
+}
+
+
+void moFilterPipeline::CommitInput(unsigned long size)
+{
+	Lock();
+	f_chain->Span(0).f_size += size;
+	Unlock();
+}
+
+
+const void *moFilterPipeline::OutputSpan(unsigned long& size)
+{
+	unsigned long	count;
+
+	Lock();
+	f_chain->Attach();
+	count = f_chain->Count();
+	if(f_chain->Pump(count) < 0) {
+		size = 0;
+		Unlock();
+		return 0;
+	}
+	filter_span_t& span = f_chain->Span(count);
+	size = span.f_size - span.f_pos;
+	Unlock();
+
+	return span.f_data + span.f_pos;
+}
+
+
+void moFilterPipeline::ConsumeOutput(unsigned long size)
+{
+	Lock();
+	filter_span_t& span = f_chain->Span(f_chain->Count());
+	span.f_pos += moMin(size, span.f_size - span.f_pos);
+	Unlock();
+}
+
+
+
+
+};			// namespace molib;
+
+// vim: ts=8
@@ -24,15 +24,442 @@
 
 #include	"mo/mo_gzip.h"
 
+#ifndef MO_THREAD_H
+#include	"mo/mo_thread.h"
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4996)
 #endif
 
+#include <chrono>
+#include <thread>
+#include <vector>
+
 
 namespace molib
 {
 
 
+namespace
+{
+
+// the size of the deflate window and thus of the dictionaries
+const size_t		GZIP_WINDOW_SIZE = 32 * 1024;
+
+// the number of blocks compressed per thread in one batch
+const unsigned long	GZIP_BLOCKS_PER_THREAD = 4;
+
+// the size of the buffer used to read a gzip file
+const size_t		GZIP_CHUNK_SIZE = 64 * 1024;
+
+
+uint64_t gzip_now(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/** \brief One block of a parallel gzip stream.
+ *
+ * Each block is compressed as raw deflate data, independently of the
+ * other blocks except for the dictionary which is the data found just
+ * before the block (up to 32Kb). All the blocks but the last end with
+ * a sync flush so they finish on a byte boundary and the compressed
+ * blocks can simply be concatenated.
+ */
+struct gzip_block_t {
+	const Bytef *		input;
+	size_t			size;
+	const Bytef *		dictionary;
+	size_t			dictionary_size;
+	bool			last;
+	std::vector<Bytef>	output;
+	uLong			crc;
+	uint64_t		usec;
+};
+
+
+/** \brief A raw deflate stream used to compress blocks.
+ *
+ * The stream is reset between blocks so one thread can compress
+ * any number of blocks without reallocating the zlib buffers.
+ */
+class gzip_deflate
+{
+public:
+				gzip_deflate(int level, int strategy)
+				{
+					memset(&f_stream, 0, sizeof(f_stream));
+					// negative window bits: raw deflate, we
+					// write the gzip header and trailer
+					f_valid = deflateInit2(&f_stream, level, Z_DEFLATED,
+							-15, 8, strategy) == Z_OK;
+				}
+
+				~gzip_deflate()
+				{
+					if(f_valid) {
+						deflateEnd(&f_stream);
+					}
+				}
+
+	bool			Compress(gzip_block_t& block)
+				{
+					uint64_t	start;
+					size_t		used;
+					int		r;
+
+					if(!f_valid) {
+						return false;
+					}
+					start = gzip_now();
+
+					block.crc = crc32(crc32(0L, Z_NULL, 0), block.input, static_cast<uInt>(block.size));
+
+					if(deflateReset(&f_stream) != Z_OK) {
+						return false;
+					}
+					if(block.dictionary_size > 0
+					&& deflateSetDictionary(&f_stream, block.dictionary, static_cast<uInt>(block.dictionary_size)) != Z_OK) {
+						return false;
+					}
+
+					// the sync flush adds up to 10 bytes
+					block.output.resize(deflateBound(&f_stream, static_cast<uLong>(block.size)) + 16);
+					f_stream.next_in = const_cast<Bytef *>(block.input);
+					f_stream.avail_in = static_cast<uInt>(block.size);
+					used = 0;
+					for(;;) {
+						f_stream.next_out = &block.output[used];
+						f_stream.avail_out = static_cast<uInt>(block.output.size() - used);
+						r = deflate(&f_stream, block.last ? Z_FINISH : Z_SYNC_FLUSH);
+						used = block.output.size() - f_stream.avail_out;
+						if(r == Z_STREAM_END) {
+							break;
+						}
+						if(r != Z_OK && r != Z_BUF_ERROR) {
+							return false;
+						}
+						if(!block.last && f_stream.avail_in == 0 && f_stream.avail_out != 0) {
+							// the sync flush is complete
+							break;
+						}
+						block.output.resize(block.output.size() * 2);
+					}
+					block.output.resize(used);
+
+					block.usec = gzip_now() - start;
+
+					return true;
+				}
+
+private:
+	z_stream		f_stream;
+	bool			f_valid;
+};
+
+
+/** \brief Compress a batch of blocks in parallel.
+ *
+ * Each runner creates its own deflate stream and compresses the
+ * next block of the batch until all the blocks were compressed.
+ */
+class gzip_block_runner : public moThread::moRunner
+{
+public:
+	struct batch_t {
+		std::vector<gzip_block_t> *	blocks;
+		int				level;
+		int				strategy;
+		moMutex				mutex;
+		size_t				next;		// next block to compress
+		int				pending;	// runners still running
+		bool				failed;
+	};
+
+				gzip_block_runner(batch_t& batch)
+					: f_batch(batch)
+				{
+				}
+
+	virtual bool		Run(void)
+				{
+					gzip_deflate	z(f_batch.level, f_batch.strategy);
+					size_t		idx;
+
+					for(;;) {
+						{
+							moLockMutex lock(f_batch.mutex);
+							if(f_batch.failed || f_batch.next >= f_batch.blocks->size()) {
+								break;
+							}
+							idx = f_batch.next;
+							++f_batch.next;
+						}
+						if(!z.Compress((*f_batch.blocks)[idx])) {
+							moLockMutex lock(f_batch.mutex);
+							f_batch.failed = true;
+						}
+					}
+
+					moLockMutex lock(f_batch.mutex);
+					--f_batch.pending;
+					f_batch.mutex.Signal();
+					return true;
+				}
+
+private:
+	batch_t&		f_batch;
+};
+
+
+}		// no name namespace
+
+
+/** \brief The parallel compressor of an moGZip object.
+ *
+ * When more than one thread is requested, the moGZip object does not
+ * use a gzFile. Instead it accumulates the data in a buffer large
+ * enough for GZIP_BLOCKS_PER_THREAD blocks per thread and compresses
+ * the whole buffer at once, one block per thread at a time. The
+ * resulting blocks are written in order between a gzip header and
+ * trailer, which gives a standard gzip file (one member) that
+ * gunzip and moGunZip can read.
+ *
+ * Since the blocks do not depend on the number of threads, the output
+ * is the same whether the blocks are compressed in parallel or not.
+ */
+class moGZip::moBlocks
+{
+public:
+				moBlocks(FILE *file, int level, int strategy, unsigned long threads, size_t block_size)
+					: f_file(file),
+					  f_level(level),
+					  f_strategy(strategy),
+					  f_threads(threads),
+					  f_block_size(block_size),
+					  f_crc(crc32(0L, Z_NULL, 0)),
+					  f_size(0)
+				{
+					f_input.reserve(f_block_size * f_threads * GZIP_BLOCKS_PER_THREAD);
+				}
+
+				~moBlocks()
+				{
+					if(f_file != 0) {
+						fclose(f_file);
+					}
+				}
+
+	bool			WriteHeader(gzip_statistics_t& statistics)
+				{
+					unsigned char	header[10];
+
+					header[0] = 0x1F;	// magic
+					header[1] = 0x8B;
+					header[2] = Z_DEFLATED;	// method
+					header[3] = 0;		// flags
+					header[4] = 0;		// modification time (none)
+					header[5] = 0;
+					header[6] = 0;
+					header[7] = 0;
+					header[8] = f_level == 9 ? 2 : (f_level == 1 ? 4 : 0);
+					header[9] = 3;		// OS (Unix)
+
+					return Output(header, sizeof(header), statistics);
+				}
+
+	int			Write(const void *buffer, size_t length, gzip_statistics_t& statistics)
+				{
+					const Bytef	*s;
+					size_t		l, left;
+
+					s = reinterpret_cast<const Bytef *>(buffer);
+					left = length;
+					while(left > 0) {
+						l = f_input.capacity() - f_input.size();
+						if(l > left) {
+							l = left;
+						}
+						f_input.insert(f_input.end(), s, s + l);
+						s += l;
+						left -= l;
+						if(f_input.size() == f_input.capacity()
+						&& !Compress(false, statistics)) {
+							return -1;
+						}
+					}
+
+					return static_cast<int>(length);
+				}
+
+	bool			Close(gzip_statistics_t& statistics)
+				{
+					unsigned char	trailer[8];
+					bool		result;
+
+					result = Compress(true, statistics);
+					if(result) {
+						trailer[0] = static_cast<unsigned char>(f_crc);
+						trailer[1] = static_cast<unsigned char>(f_crc >> 8);
+						trailer[2] = static_cast<unsigned char>(f_crc >> 16);
+						trailer[3] = static_cast<unsigned char>(f_crc >> 24);
+						trailer[4] = static_cast<unsigned char>(f_size);
+						trailer[5] = static_cast<unsigned char>(f_size >> 8);
+						trailer[6] = static_cast<unsigned char>(f_size >> 16);
+						trailer[7] = static_cast<unsigned char>(f_size >> 24);
+						result = Output(trailer, sizeof(trailer), statistics);
+					}
+					if(fclose(f_file) != 0) {
+						result = false;
+					}
+					f_file = 0;
+
+					return result;
+				}
+
+private:
+	bool			Output(const void *buffer, size_t length, gzip_statistics_t& statistics)
+				{
+					statistics.f_output_size += length;
+					return fwrite(buffer, 1, length, f_file) == length;
+				}
+
+	bool			Compress(bool last, gzip_statistics_t& statistics)
+				{
+					std::vector<gzip_block_t>	blocks;
+					gzip_block_t			block;
+					size_t				offset, idx;
+					unsigned long			workers;
+					bool				result;
+
+					// cut the input in blocks, each block uses the
+					// previous 32Kb as its dictionary
+					offset = 0;
+					do {
+						block.input = f_input.empty() ? 0 : &f_input[offset];
+						block.size = moMin(f_block_size, f_input.size() - offset);
+						if(offset == 0) {
+							block.dictionary = f_dictionary.empty() ? 0 : &f_dictionary[0];
+							block.dictionary_size = f_dictionary.size();
+						}
+						else {
+							// the block size is at least GZIP_WINDOW_SIZE
+							block.dictionary = &f_input[offset - GZIP_WINDOW_SIZE];
+							block.dictionary_size = GZIP_WINDOW_SIZE;
+						}
+						offset += block.size;
+						block.last = last && offset == f_input.size();
+						block.crc = 0;
+						block.usec = 0;
+						blocks.push_back(block);
+					} while(offset < f_input.size());
+
+					workers = f_threads;
+					if(workers > blocks.size()) {
+						workers = static_cast<unsigned long>(blocks.size());
+					}
+					if(!moThread::ThreadingAvailable() || workers < 2) {
+						gzip_deflate z(f_level, f_strategy);
+						result = true;
+						for(idx = 0; idx < blocks.size() && result; ++idx) {
+							result = z.Compress(blocks[idx]);
+						}
+					}
+					else {
+						result = CompressParallel(blocks, workers);
+					}
+					if(!result) {
+						errno = EIO;
+						return false;
+					}
+
+					// save the blocks in order
+					for(idx = 0; idx < blocks.size(); ++idx) {
+						const gzip_block_t& b = blocks[idx];
+						if(!b.output.empty() && !Output(&b.output[0], b.output.size(), statistics)) {
+							return false;
+						}
+						f_crc = crc32_combine(f_crc, b.crc, static_cast<z_off_t>(b.size));
+						f_size += b.size;
+						statistics.f_input_size += b.size;
+						statistics.f_compress_usec += b.usec;
+						++statistics.f_blocks;
+					}
+
+					// keep the end of the data as the next dictionary
+					if(f_input.size() >= GZIP_WINDOW_SIZE) {
+						f_dictionary.assign(f_input.end() - GZIP_WINDOW_SIZE, f_input.end());
+					}
+					else {
+						f_dictionary.insert(f_dictionary.end(), f_input.begin(), f_input.end());
+						if(f_dictionary.size() > GZIP_WINDOW_SIZE) {
+							f_dictionary.erase(f_dictionary.begin(), f_dictionary.end() - GZIP_WINDOW_SIZE);
+						}
+					}
+					f_input.clear();
+
+					return true;
+				}
+
+	bool			CompressParallel(std::vector<gzip_block_t>& blocks, unsigned long workers)
+				{
+					gzip_block_runner::batch_t	batch;
+					unsigned long			idx;
+
+					batch.blocks = &blocks;
+					batch.level = f_level;
+					batch.strategy = f_strategy;
+					batch.next = 0;
+					batch.pending = static_cast<int>(workers);
+					batch.failed = false;
+
+					std::vector<moSmartPtr<gzip_block_runner> > runners;
+					std::vector<moThreadSPtr> threads;
+					for(idx = 0; idx < workers; ++idx) {
+						runners.push_back(new gzip_block_runner(batch));
+					}
+					for(idx = 0; idx < workers; ++idx) {
+						moThreadSPtr thread(new moThread("moGZip", runners[idx]));
+						if(thread->Start()) {
+							threads.push_back(thread);
+						}
+						else {
+							// compress the remaining blocks from here
+							runners[idx]->Run();
+						}
+					}
+
+					{
+						moLockMutex lock(batch.mutex);
+						while(batch.pending > 0) {
+							batch.mutex.Wait();
+						}
+					}
+					// let the threads finish their cleanup before the
+					// runners get released
+					for(idx = 0; idx < threads.size(); ++idx) {
+						threads[idx]->Wait();
+					}
+
+					return !batch.failed;
+				}
+
+	FILE *			f_file;
+	const int		f_level;
+	const int		f_strategy;
+	const unsigned long	f_threads;
+	const size_t		f_block_size;
+	std::vector<Bytef>	f_input;
+	std::vector<Bytef>	f_dictionary;
+	uLong			f_crc;
+	uint64_t		f_size;
+};
+
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -88,9 +515,12 @@ DESCRIPTION
 	The default mode is to compress everything to the best the
 	library can do.
 
+	By default the data is compressed by one thread. See the
+	SetThreads() function to compress large files in parallel.
+
 SEE ALSO
 
-	Open, Close, moOStream
+	Open, Close, SetThreads, moOStream
 
 */
 moGZip::moGZip(void)
@@ -143,6 +573,9 @@ moGZip::~moGZip()
 void moGZip::Init(void)
 {
 	f_gz_file = 0;
+	f_blocks = 0;
+	f_threads = 1;
+	f_block_size = GZIP_BLOCK_SIZE_DEFAULT;
 }
 
 
@@ -182,26 +615,32 @@ DESCRIPTION
 	The Close() will be called once you have sent all the data
 	via the moOStream functions.
 
+	When more than one thread is requested (see SetThreads()), the
+	Open() function creates the file with a plain fopen(3) and the
+	data is compressed in blocks instead of through a gzFile.
+
+	The Open() function resets the statistics.
+
 SEE ALSO
 
-	Constructor, moOStream
+	Constructor, SetThreads, Statistics, moOStream
 
 */
 bool moGZip::Open(const char *filename, gzip_mode_t mode, mowc::encoding_t encoding)
 {
-	return Open(moWCString(filename, encoding), mode);
+	return Open(moWCString(filename, -1, encoding), mode);
 }
 
 
 bool moGZip::Open(const mowc::mc_t *filename, gzip_mode_t mode, mowc::encoding_t encoding)
 {
-	return Open(moWCString(filename, encoding), mode);
+	return Open(moWCString(filename, -1, encoding), mode);
 }
 
 
 bool moGZip::Open(const mowc::wc_t *filename, gzip_mode_t mode, mowc::encoding_t encoding)
 {
-	return Open(moWCString(filename, encoding), mode);
+	return Open(moWCString(filename, -1, encoding), mode);
 }
 
 
@@ -215,18 +654,26 @@ bool moGZip::Open(const moWCString& filename, gzip_mode_t mode)
 {
 	char		m[10];	/* Flawfinder: ignore */
 	const char	*filter;
+	int		strategy;
+	unsigned long	threads;
+
+	Close();
+	f_statistics = gzip_statistics_t();
 
 	switch(mode.Filter()) {
 	case GZIP_FILTER_DEFAULT:
 		filter = "";
+		strategy = Z_DEFAULT_STRATEGY;
 		break;
 
 	case GZIP_FILTER_FAST:
 		filter = "f";
+		strategy = Z_FILTERED;
 		break;
 
 	case GZIP_FILTER_HUFFMAN:
 		filter = "h";
+		strategy = Z_HUFFMAN_ONLY;
 		break;
 
 	default:
@@ -235,6 +682,35 @@ bool moGZip::Open(const moWCString& filename, gzip_mode_t mode)
 		return false;
 
 	}
+
+	threads = f_threads;
+	if(threads == GZIP_THREADS_AUTO) {
+		threads = std::thread::hardware_concurrency();
+	}
+	if(threads > 1) {
+		if(mode.Level() > GZIP_LEVEL_MAX && mode.Level() != GZIP_LEVEL_DEFAULT) {
+			errno = EINVAL;
+			return false;
+		}
+		FILE *file = fopen(filename.c_str(), "wb");	/* Flawfinder: ignore */
+		if(file == 0) {
+			return false;
+		}
+		f_blocks = new moBlocks(file,
+				mode.Level() == GZIP_LEVEL_DEFAULT ? Z_DEFAULT_COMPRESSION : static_cast<int>(mode.Level()),
+				strategy, threads, f_block_size);
+		f_statistics.f_threads = moThread::ThreadingAvailable() ? threads : 1;
+		if(!f_blocks->WriteHeader(f_statistics)) {
+			delete f_blocks;
+			f_blocks = 0;
+			return false;
+		}
+
+		OutputFilename(filename.c_str());
+
+		return true;
+	}
+
 	if(mode.Level() == GZIP_LEVEL_DEFAULT) {
 		snprintf(m, sizeof(m), "wb%s", filter);				/* Flawfinder: ignore */
 	}
@@ -245,6 +721,7 @@ bool moGZip::Open(const moWCString& filename, gzip_mode_t mode)
 	if(f_gz_file == 0) {
 		return false;
 	}
+	f_statistics.f_threads = 1;
 
 	OutputFilename(filename.c_str());
 
@@ -254,10 +731,180 @@ bool moGZip::Open(const moWCString& filename, gzip_mode_t mode)
 
 void moGZip::Close(void)
 {
+	uint64_t	start;
+
+	start = gzip_now();
 	if(f_gz_file != 0) {
 		gzclose(f_gz_file);
 		f_gz_file = 0;
+
+		struct stat st;
+		if(OutputFilename() != 0 && stat(OutputFilename(), &st) == 0) {
+			f_statistics.f_output_size = st.st_size;
+		}
+	}
+	else if(f_blocks != 0) {
+		f_blocks->Close(f_statistics);
+		delete f_blocks;
+		f_blocks = 0;
+	}
+	else {
+		return;
+	}
+	f_statistics.f_elapsed_usec += gzip_now() - start;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGZip
+
+NAME
+
+	SetThreads - set the number of threads used to compress
+	Threads - get the number of threads used to compress
+	SetBlockSize - set the size of the blocks compressed in parallel
+	BlockSize - get the size of the blocks compressed in parallel
+
+SYNOPSIS
+
+	void SetThreads(unsigned long threads);
+	unsigned long Threads(void) const;
+	void SetBlockSize(size_t size);
+	size_t BlockSize(void) const;
+
+PARAMETERS
+
+	threads - the number of threads or GZIP_THREADS_AUTO
+	size - the size of one block in bytes
+
+DESCRIPTION
+
+	By default, the data written in an moGZip object is compressed
+	by one zlib stream in the thread writing the data.
+
+	When SetThreads() is called with more than 1 thread (or
+	GZIP_THREADS_AUTO on a computer with more than one processor)
+	the next Open() creates a file which gets compressed in
+	parallel: the data is cut in blocks of BlockSize() bytes
+	which are compressed independently, except that the last
+	32Kb of data of the previous block is used as the dictionary
+	of each block (so the compression ratio is close to the one
+	of a single stream). The blocks are then saved in order in
+	one standard gzip member which gunzip and moGunZip can read.
+
+	The output does not depend on the number of threads. It only
+	depends on the block size, level and filter. When threads are
+	not available, the blocks are compressed one after the other.
+
+	The block size is at least GZIP_BLOCK_SIZE_MIN (32Kb) and
+	it defaults to GZIP_BLOCK_SIZE_DEFAULT (128Kb).
+
+	These functions have no effect on an already open file.
+
+SEE ALSO
+
+	Open, Statistics
+
+*/
+void moGZip::SetThreads(unsigned long threads)
+{
+	f_threads = threads;
+}
+
+
+unsigned long moGZip::Threads(void) const
+{
+	return f_threads;
+}
+
+
+void moGZip::SetBlockSize(size_t size)
+{
+	if(size < GZIP_BLOCK_SIZE_MIN) {
+		size = GZIP_BLOCK_SIZE_MIN;
+	}
+	f_block_size = size;
+}
+
+
+size_t moGZip::BlockSize(void) const
+{
+	return f_block_size;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGZip
+
+NAME
+
+	Statistics - get the statistics about the last file compressed
+
+SYNOPSIS
+
+	const gzip_statistics_t& Statistics(void) const;
+	double gzip_statistics_t::Throughput(void) const;
+
+DESCRIPTION
+
+	The Statistics() function returns information about the file
+	being compressed or, after Close() was called, about the last
+	file compressed:
+
+		f_threads		the number of threads compressing
+		f_blocks		the number of blocks compressed
+					in parallel mode (0 otherwise)
+		f_input_size		the number of bytes written
+		f_output_size		the size of the gzip file
+					(known once closed unless
+					in parallel mode)
+		f_compress_usec		the time spent compressing by
+					all the threads (parallel mode)
+		f_elapsed_usec		the time spent in the moGZip
+					writing and closing the file
+
+	The Throughput() function returns the number of input bytes
+	compressed per second of elapsed time.
+
+SEE ALSO
+
+	SetThreads, Open, Close
+
+*/
+const moGZip::gzip_statistics_t& moGZip::Statistics(void) const
+{
+	return f_statistics;
+}
+
+
+moGZip::gzip_statistics_t::gzip_statistics_t(void)
+	: f_threads(0),
+	  f_blocks(0),
+	  f_input_size(0),
+	  f_output_size(0),
+	  f_compress_usec(0),
+	  f_elapsed_usec(0)
+{
+}
+
+
+double moGZip::gzip_statistics_t::Throughput(void) const
+{
+	if(f_elapsed_usec == 0) {
+		return 0.0;
 	}
+
+	return static_cast<double>(f_input_size) * 1000000.0 / static_cast<double>(f_elapsed_usec);
 }
 
 
@@ -295,16 +942,561 @@ SEE ALSO
 */
 int moGZip::RawWrite(const void *buffer, size_t length)
 {
+	uint64_t	start;
+	int		r;
+
 	if(length == 0) {
 		return 0;
 	}
-	// this function returns zero when an error occurs
-	int r = gzwrite(f_gz_file, const_cast<const voidp>(buffer), static_cast<unsigned int>(length));
-	return r == 0 ? -1 : r;
+	start = gzip_now();
+	if(f_blocks != 0) {
+		r = f_blocks->Write(buffer, length, f_statistics);
+	}
+	else {
+		// this function returns zero when an error occurs
+		r = gzwrite(f_gz_file, const_cast<const voidp>(buffer), static_cast<unsigned int>(length));
+		if(r == 0) {
+			r = -1;
+		}
+		else {
+			f_statistics.f_input_size += r;
+		}
+	}
+	f_statistics.f_elapsed_usec += gzip_now() - start;
+
+	return r;
+}
+
+
+
+
+
+
+
+/** \brief The checkpoint index of a gzip file.
+ *
+ * The index is built with a first pass over the entire gzip file
+ * (see BuildIndex()). Every span bytes of uncompressed data, at the
+ * end of a deflate block, it saves a checkpoint with the position
+ * in the compressed and uncompressed data and the last 32Kb of
+ * uncompressed data (the inflate window). A checkpoint is also
+ * possible at the start of a gzip member (files with multiple
+ * members, such as those created by pigz or concatenated gzip files)
+ * in which case it needs no window.
+ *
+ * The Seek() function restarts inflating at the closest checkpoint
+ * and skips the data up to the requested position. From there the
+ * Read() function returns the following data using its own file
+ * and inflate stream (the gzFile of the moGunZip is not used anymore).
+ *
+ * This is the technique of the zran.c example of zlib.
+ */
+class moGunZip::moIndex
+{
+public:
+	struct checkpoint_t {
+		uint64_t			out;		// position in the uncompressed data
+		uint64_t			in;		// position in the gzip file
+		int				bits;		// bits of the previous byte, -1 for a member start
+		std::vector<unsigned char>	window;
+	};
+
+				moIndex(void)
+					: f_size(0),
+					  f_archive_size(0),
+					  f_archive_mtime(0),
+					  f_span(0),
+					  f_file(0),
+					  f_stream_valid(false)
+				{
+					memset(&f_stream, 0, sizeof(f_stream));
+				}
+
+				~moIndex()
+				{
+					Stop();
+				}
+
+	bool			IsEmpty(void) const
+				{
+					return f_checkpoints.empty();
+				}
+
+	bool			IsActive(void) const
+				{
+					return f_file != 0;
+				}
+
+	uint64_t		Size(void) const
+				{
+					return f_size;
+				}
+
+	bool			Build(const char *filename, size_t span);
+	bool			Save(const char *filename) const;
+	bool			Load(const char *filename, const char *archive);
+	bool			Seek(const char *archive, uint64_t position);
+	int			Read(void *buffer, size_t length);
+
+private:
+	static bool		Identify(FILE *file, uint64_t& size, uint64_t& mtime);
+	bool			Restart(const char *archive, const checkpoint_t& checkpoint);
+	void			Stop(void);
+
+	std::vector<checkpoint_t>	f_checkpoints;
+	uint64_t			f_size;
+	uint64_t			f_archive_size;
+	uint64_t			f_archive_mtime;
+	size_t				f_span;
+
+	// the reader once Seek() was called
+	FILE *				f_file;
+	z_stream			f_stream;
+	bool				f_stream_valid;
+	bool				f_raw;		// inflating raw deflate data from a checkpoint
+	bool				f_member_end;	// at the end of a gzip member
+	bool				f_end;		// no more data
+	int				f_trailer;	// bytes of the gzip trailer left to skip
+	uint64_t			f_position;
+	unsigned char			f_input[GZIP_CHUNK_SIZE];
+};
+
+
+bool moGunZip::moIndex::Identify(FILE *file, uint64_t& size, uint64_t& mtime)
+{
+	struct stat	st;
+
+	if(fstat(fileno(file), &st) != 0) {
+		return false;
+	}
+	size = st.st_size;
+	mtime = st.st_mtime;
+
+	return true;
+}
+
+
+bool moGunZip::moIndex::Build(const char *filename, size_t span)
+{
+	std::vector<unsigned char>	window(GZIP_WINDOW_SIZE);
+	checkpoint_t			checkpoint;
+	z_stream			stream;
+	uint64_t			total_in, total_out, last;
+	size_t				pos;
+	uInt				avail_in, avail_out;
+	bool				member_end, result;
+	int				r;
+
+	Stop();
+	f_checkpoints.clear();
+	f_size = 0;
+	f_span = span;
+
+	FILE *file = fopen(filename, "rb");	/* Flawfinder: ignore */
+	if(file == 0) {
+		return false;
+	}
+	if(!Identify(file, f_archive_size, f_archive_mtime)) {
+		fclose(file);
+		return false;
+	}
+
+	memset(&stream, 0, sizeof(stream));
+	// 47 = 15 + 32, the largest window and a gzip header
+	if(inflateInit2(&stream, 47) != Z_OK) {
+		fclose(file);
+		errno = ENOMEM;
+		return false;
+	}
+
+	// the first member starts at the very beginning
+	checkpoint.out = 0;
+	checkpoint.in = 0;
+	checkpoint.bits = -1;
+	f_checkpoints.push_back(checkpoint);
+
+	total_in = 0;
+	total_out = 0;
+	last = 0;
+	member_end = false;
+	result = false;
+	stream.avail_in = 0;
+	stream.avail_out = 0;
+	for(;;) {
+		if(stream.avail_in == 0) {
+			stream.avail_in = static_cast<uInt>(fread(f_input, 1, sizeof(f_input), file));
+			stream.next_in = f_input;
+			if(stream.avail_in == 0) {
+				// a truncated file is an error
+				result = member_end && ferror(file) == 0;
+				errno = ferror(file) != 0 ? EIO : EINVAL;
+				break;
+			}
+		}
+		if(member_end) {
+			// ignore trailing garbage like gzip does
+			if(stream.next_in[0] != 0x1F) {
+				result = true;
+				break;
+			}
+			inflateReset(&stream);
+			member_end = false;
+			if(total_out - last >= span) {
+				checkpoint.out = total_out;
+				checkpoint.in = total_in;
+				checkpoint.bits = -1;
+				f_checkpoints.push_back(checkpoint);
+				last = total_out;
+			}
+		}
+
+		// the window is used as a circular output buffer
+		if(stream.avail_out == 0) {
+			stream.next_out = &window[0];
+			stream.avail_out = GZIP_WINDOW_SIZE;
+		}
+		avail_in = stream.avail_in;
+		avail_out = stream.avail_out;
+		r = inflate(&stream, Z_BLOCK);
+		total_in += avail_in - stream.avail_in;
+		total_out += avail_out - stream.avail_out;
+		if(r == Z_STREAM_END) {
+			member_end = true;
+			continue;
+		}
+		if(r != Z_OK && r != Z_BUF_ERROR) {
+			errno = EINVAL;
+			break;
+		}
+
+		// at the end of a block (but not the last one)?
+		if((stream.data_type & 128) != 0 && (stream.data_type & 64) == 0
+		&& total_out - last >= span) {
+			checkpoint.out = total_out;
+			checkpoint.in = total_in;
+			checkpoint.bits = stream.data_type & 7;
+			pos = GZIP_WINDOW_SIZE - stream.avail_out;
+			checkpoint.window.resize(GZIP_WINDOW_SIZE);
+			memcpy(&checkpoint.window[0], &window[pos], GZIP_WINDOW_SIZE - pos);		/* Flawfinder: ignore */
+			memcpy(&checkpoint.window[GZIP_WINDOW_SIZE - pos], &window[0], pos);	/* Flawfinder: ignore */
+			f_checkpoints.push_back(checkpoint);
+			checkpoint.window.clear();
+			last = total_out;
+		}
+	}
+
+	inflateEnd(&stream);
+	fclose(file);
+
+	if(!result) {
+		f_checkpoints.clear();
+		return false;
+	}
+	f_size = total_out;
+
+	return true;
+}
+
+
+bool moGunZip::moIndex::Save(const char *filename) const
+{
+	const checkpoint_t	*c;
+	size_t			idx;
+	bool			result;
+
+	FILE *file = fopen(filename, "wb");	/* Flawfinder: ignore */
+	if(file == 0) {
+		return false;
+	}
+	fprintf(file, "moGunZip index 1 %llu %llu %llu %llu %lu\n",
+			static_cast<unsigned long long>(f_archive_size),
+			static_cast<unsigned long long>(f_archive_mtime),
+			static_cast<unsigned long long>(f_span),
+			static_cast<unsigned long long>(f_size),
+			static_cast<unsigned long>(f_checkpoints.size()));
+	for(idx = 0; idx < f_checkpoints.size(); ++idx) {
+		c = &f_checkpoints[idx];
+		fprintf(file, "%llu %llu %d %lu\n",
+			static_cast<unsigned long long>(c->out),
+			static_cast<unsigned long long>(c->in),
+			c->bits,
+			static_cast<unsigned long>(c->window.size()));
+		if(!c->window.empty()) {
+			fwrite(&c->window[0], 1, c->window.size(), file);
+		}
+	}
+	result = ferror(file) == 0;
+	if(fclose(file) != 0) {
+		result = false;
+	}
+
+	return result;
+}
+
+
+bool moGunZip::moIndex::Load(const char *filename, const char *archive)
+{
+	std::vector<checkpoint_t>	checkpoints;
+	checkpoint_t			checkpoint;
+	unsigned long long		archive_size, archive_mtime, span, size, out, in;
+	unsigned long			count, idx, window_size;
+	uint64_t			current_size, current_mtime;
+	int				bits;
+
+	FILE *file = fopen(filename, "rb");	/* Flawfinder: ignore */
+	if(file == 0) {
+		return false;
+	}
+	if(fscanf(file, "moGunZip index 1 %llu %llu %llu %llu %lu\n",
+			&archive_size, &archive_mtime, &span, &size, &count) != 5) {
+		fclose(file);
+		errno = EINVAL;
+		return false;
+	}
+
+	// make sure the index is for this very file
+	FILE *input = fopen(archive, "rb");	/* Flawfinder: ignore */
+	if(input == 0) {
+		fclose(file);
+		return false;
+	}
+	if(!Identify(input, current_size, current_mtime)
+	|| current_size != archive_size || current_mtime != archive_mtime) {
+		fclose(input);
+		fclose(file);
+		errno = ESTALE;
+		return false;
+	}
+	fclose(input);
+
+	for(idx = 0; idx < count; ++idx) {
+		if(fscanf(file, "%llu %llu %d %lu", &out, &in, &bits, &window_size) != 4
+		|| fgetc(file) != '\n'
+		|| bits < -1 || bits > 7
+		|| (bits >= 0 && window_size != GZIP_WINDOW_SIZE)
+		|| (bits < 0 && window_size != 0)) {
+			fclose(file);
+			errno = EINVAL;
+			return false;
+		}
+		checkpoint.out = out;
+		checkpoint.in = in;
+		checkpoint.bits = bits;
+		checkpoint.window.resize(window_size);
+		if(window_size > 0
+		&& fread(&checkpoint.window[0], 1, window_size, file) != window_size) {
+			fclose(file);
+			errno = EINVAL;
+			return false;
+		}
+		checkpoints.push_back(checkpoint);
+	}
+	fclose(file);
+	if(checkpoints.empty()) {
+		errno = EINVAL;
+		return false;
+	}
+
+	Stop();
+	f_checkpoints.swap(checkpoints);
+	f_archive_size = archive_size;
+	f_archive_mtime = archive_mtime;
+	f_span = static_cast<size_t>(span);
+	f_size = size;
+
+	return true;
+}
+
+
+bool moGunZip::moIndex::Seek(const char *archive, uint64_t position)
+{
+	unsigned char	buffer[GZIP_CHUNK_SIZE];
+	size_t		lo, hi, mid, l;
+	uint64_t	skip;
+	int		r;
+
+	if(position > f_size || f_checkpoints.empty()) {
+		errno = EINVAL;
+		return false;
+	}
+
+	// the last checkpoint before position
+	lo = 0;
+	hi = f_checkpoints.size();
+	while(hi - lo > 1) {
+		mid = (lo + hi) / 2;
+		if(f_checkpoints[mid].out <= position) {
+			lo = mid;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	const checkpoint_t& checkpoint = f_checkpoints[lo];
+
+	// going forward from the current position may be faster
+	if(f_file != 0 && f_position <= position && f_position >= checkpoint.out) {
+		skip = position - f_position;
+	}
+	else {
+		if(!Restart(archive, checkpoint)) {
+			Stop();
+			return false;
+		}
+		skip = position - checkpoint.out;
+	}
+
+	while(skip > 0) {
+		l = sizeof(buffer);
+		if(l > skip) {
+			l = static_cast<size_t>(skip);
+		}
+		r = Read(buffer, l);
+		if(r <= 0) {
+			Stop();
+			errno = EIO;
+			return false;
+		}
+		skip -= r;
+	}
+
+	return true;
+}
+
+
+bool moGunZip::moIndex::Restart(const char *archive, const checkpoint_t& checkpoint)
+{
+	int		c;
+
+	if(f_file == 0) {
+		f_file = fopen(archive, "rb");	/* Flawfinder: ignore */
+		if(f_file == 0) {
+			return false;
+		}
+	}
+	if(!f_stream_valid) {
+		if(inflateInit2(&f_stream, 47) != Z_OK) {
+			errno = ENOMEM;
+			return false;
+		}
+		f_stream_valid = true;
+	}
+
+	// a checkpoint within a member is in raw deflate data
+	f_raw = checkpoint.bits >= 0;
+	if(inflateReset2(&f_stream, f_raw ? -15 : 47) != Z_OK) {
+		errno = EINVAL;
+		return false;
+	}
+
+#ifdef MO_WIN32
+	if(_fseeki64(f_file, checkpoint.in - (checkpoint.bits > 0 ? 1 : 0), SEEK_SET) != 0) {
+#else
+	if(fseeko(f_file, static_cast<off_t>(checkpoint.in - (checkpoint.bits > 0 ? 1 : 0)), SEEK_SET) != 0) {
+#endif
+		return false;
+	}
+	f_stream.avail_in = 0;
+	if(checkpoint.bits > 0) {
+		c = getc(f_file);
+		if(c == EOF) {
+			errno = EINVAL;
+			return false;
+		}
+		inflatePrime(&f_stream, checkpoint.bits, c >> (8 - checkpoint.bits));
+	}
+	if(f_raw && inflateSetDictionary(&f_stream, &checkpoint.window[0], static_cast<uInt>(checkpoint.window.size())) != Z_OK) {
+		errno = EINVAL;
+		return false;
+	}
+
+	f_member_end = false;
+	f_end = false;
+	f_trailer = 0;
+	f_position = checkpoint.out;
+
+	return true;
 }
 
 
+void moGunZip::moIndex::Stop(void)
+{
+	if(f_stream_valid) {
+		inflateEnd(&f_stream);
+		memset(&f_stream, 0, sizeof(f_stream));
+		f_stream_valid = false;
+	}
+	if(f_file != 0) {
+		fclose(f_file);
+		f_file = 0;
+	}
+}
+
+
+int moGunZip::moIndex::Read(void *buffer, size_t length)
+{
+	size_t		l;
+	int		r;
+
+	f_stream.next_out = reinterpret_cast<Bytef *>(buffer);
+	f_stream.avail_out = static_cast<uInt>(length);
+	while(f_stream.avail_out > 0 && !f_end) {
+		if(f_stream.avail_in == 0) {
+			f_stream.avail_in = static_cast<uInt>(fread(f_input, 1, sizeof(f_input), f_file));
+			f_stream.next_in = f_input;
+			if(f_stream.avail_in == 0) {
+				if(!f_member_end || ferror(f_file) != 0) {
+					// truncated file or I/O error
+					errno = EIO;
+					break;
+				}
+				f_end = true;
+				break;
+			}
+		}
+		if(f_trailer > 0) {
+			// skip the CRC and size of a raw member
+			l = moMin(static_cast<size_t>(f_trailer), static_cast<size_t>(f_stream.avail_in));
+			f_stream.next_in += l;
+			f_stream.avail_in -= static_cast<uInt>(l);
+			f_trailer -= static_cast<int>(l);
+			f_member_end = f_trailer == 0;
+			continue;
+		}
+		if(f_member_end) {
+			// ignore trailing garbage like gzip does
+			if(f_stream.next_in[0] != 0x1F) {
+				f_end = true;
+				break;
+			}
+			inflateReset2(&f_stream, 47);
+			f_raw = false;
+			f_member_end = false;
+		}
+		r = inflate(&f_stream, Z_NO_FLUSH);
+		if(r == Z_STREAM_END) {
+			if(f_raw) {
+				f_trailer = 8;
+			}
+			else {
+				f_member_end = true;
+			}
+			continue;
+		}
+		if(r != Z_OK && r != Z_BUF_ERROR) {
+			errno = EIO;
+			break;
+		}
+	}
 
+	l = length - f_stream.avail_out;
+	f_position += l;
+	if(l == 0 && !f_end) {
+		return -1;
+	}
+
+	return static_cast<int>(l);
+}
 
 
 
@@ -406,6 +1598,7 @@ moGunZip::~moGunZip()
 void moGunZip::Init(void)
 {
 	f_gz_file = 0;
+	f_index = 0;
 }
 
 
@@ -457,19 +1650,19 @@ SEE ALSO
 */
 bool moGunZip::Open(const char *filename, mowc::encoding_t encoding)
 {
-	return Open(moWCString(filename, encoding));
+	return Open(moWCString(filename, -1, encoding));
 }
 
 
 bool moGunZip::Open(const mowc::mc_t *filename, mowc::encoding_t encoding)
 {
-	return Open(moWCString(filename, encoding));
+	return Open(moWCString(filename, -1, encoding));
 }
 
 
 bool moGunZip::Open(const mowc::wc_t *filename, mowc::encoding_t encoding)
 {
-	return Open(moWCString(filename, encoding));
+	return Open(moWCString(filename, -1, encoding));
 }
 
 
@@ -481,6 +1674,8 @@ bool moGunZip::Open(const wchar_t *filename)
 
 bool moGunZip::Open(const moWCString& filename)
 {
+	Close();
+
 	f_gz_file = gzopen(filename.c_str(), "rb");
 	if(f_gz_file == 0) {
 		return false;
@@ -498,6 +1693,10 @@ void moGunZip::Close(void)
 		gzclose(f_gz_file);
 		f_gz_file = 0;
 	}
+	delete f_index;
+	f_index = 0;
+	f_input_position = 0;
+	f_input_unget_position = 0;
 }
 
 
@@ -511,43 +1710,272 @@ CLASS
 
 NAME
 
-	RawRead - overwritten RawRead() function
+	BuildIndex - create a checkpoint index of the GZip file
+	LoadIndex - load the checkpoint index from a file
+	SaveIndex - save the checkpoint index to a file
+	HasIndex - check whether an index is available
 
 SYNOPSIS
 
-	private:
-	int RawRead(void *buffer, size_t length);
+	bool BuildIndex(size_t span = GZIP_INDEX_SPAN_DEFAULT);
+	bool LoadIndex(const moWCString& filename);
+	bool SaveIndex(const moWCString& filename) const;
+	bool HasIndex(void) const;
 
 PARAMETERS
 
-	buffer - a pointer to a buffer where the data is read to
-	length - the number of bytes in buffer which can be used
+	span - the distance between two checkpoints in uncompressed bytes
+	filename - the name of the index (sidecar) file
 
 DESCRIPTION
 
-	This function will be called by any of the functions which
-	read from the moIStream object (Get, Read).
+	A GZip file can only be read sequentially. To read data at
+	the end of the file, everything before it has to be
+	decompressed first. These functions create an index which
+	makes the Seek() function fast.
 
-SEE ALSO
+	The BuildIndex() function decompresses the whole file once
+	and saves a checkpoint about every span bytes of uncompressed
+	data (1Mb by default). Each checkpoint includes the last 32Kb
+	of data before it (the inflate dictionary) so the index takes
+	about 32Kb per checkpoint in memory. Files with multiple
+	members (concatenated GZip files) are supported.
 
-	Constructor, moIStream
+	The SaveIndex() function saves the index in a file so it can
+	be reloaded with the LoadIndex() function the next time the
+	same GZip file is opened. The index file includes the size
+	and modification time of the GZip file; LoadIndex() fails
+	with ESTALE if the GZip file changed since.
 
-*/
-int moGunZip::RawRead(void *buffer, size_t length)
-{
-	if(length == 0) {
-		return 0;
-	}
-	return gzread(f_gz_file, buffer, static_cast<unsigned int>(length));
-}
+	The index is attached to the currently opened file and it is
+	lost when the file is closed.
 
+RETURN VALUE
 
+	BuildIndex(), LoadIndex() and SaveIndex() return true when they
+	succeed; false otherwise and errno is set
 
+	HasIndex() returns true when an index was built or loaded
 
+SEE ALSO
 
-/************************************************************ DOC:
+	Seek, Open
 
-CLASS
+*/
+bool moGunZip::BuildIndex(size_t span)
+{
+	if(InputFilename() == 0) {
+		errno = EBADF;
+		return false;
+	}
+	if(f_index == 0) {
+		f_index = new moIndex;
+	}
+
+	return f_index->Build(InputFilename(), span);
+}
+
+
+bool moGunZip::LoadIndex(const moWCString& filename)
+{
+	if(InputFilename() == 0) {
+		errno = EBADF;
+		return false;
+	}
+	if(f_index == 0) {
+		f_index = new moIndex;
+	}
+
+	return f_index->Load(filename.c_str(), InputFilename());
+}
+
+
+bool moGunZip::SaveIndex(const moWCString& filename) const
+{
+	if(!HasIndex()) {
+		errno = EINVAL;
+		return false;
+	}
+
+	return f_index->Save(filename.c_str());
+}
+
+
+bool moGunZip::HasIndex(void) const
+{
+	return f_index != 0 && !f_index->IsEmpty();
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGunZip
+
+NAME
+
+	Seek - move the read position in the uncompressed data
+	ReadPosition - get or change the read position
+	InputSize - get the size of the uncompressed data
+
+SYNOPSIS
+
+	bool Seek(size_t position);
+	virtual size_t ReadPosition(void) const;
+	virtual size_t ReadPosition(size_t new_pos);
+	virtual size_t InputSize(void) const;
+
+PARAMETERS
+
+	position, new_pos - the new position in the uncompressed data
+
+DESCRIPTION
+
+	The Seek() function changes the position from which the next
+	Read() returns data.
+
+	When the GZip file has an index (see BuildIndex()), the
+	decompression restarts from the closest checkpoint before
+	the position (or continues from the current position when
+	that is closer). Without an index, gzseek() is used which
+	decompresses everything from the start of the file when
+	going backward.
+
+	The ReadPosition() function with a position calls Seek(),
+	which means moITar can read the members of a .tar.gz file
+	at random.
+
+	The InputSize() function returns the size of the uncompressed
+	data when an index is available and 0 otherwise.
+
+RETURN VALUE
+
+	Seek() returns true when the new position is valid
+
+	ReadPosition(new_pos) returns the previous position
+
+SEE ALSO
+
+	BuildIndex, LoadIndex
+
+*/
+bool moGunZip::Seek(size_t position)
+{
+	f_input_unget_position = 0;
+
+	if(HasIndex()) {
+		if(!f_index->Seek(InputFilename(), position)) {
+			return false;
+		}
+	}
+	else {
+		if(f_gz_file == 0) {
+			errno = EBADF;
+			return false;
+		}
+		if(gzseek(f_gz_file, static_cast<z_off_t>(position), SEEK_SET) != static_cast<z_off_t>(position)) {
+			errno = EINVAL;
+			return false;
+		}
+	}
+	f_input_position = position;
+
+	return true;
+}
+
+
+size_t moGunZip::ReadPosition(void) const
+{
+	return moIStream::ReadPosition();
+}
+
+
+size_t moGunZip::ReadPosition(size_t new_pos)
+{
+	size_t		old_position;
+
+	old_position = f_input_position;
+	if(new_pos != old_position || f_input_unget_position > 0UL) {
+		Seek(new_pos);
+	}
+
+	return old_position;
+}
+
+
+size_t moGunZip::InputSize(void) const
+{
+	if(HasIndex()) {
+		return static_cast<size_t>(f_index->Size());
+	}
+
+	return 0;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGunZip
+
+NAME
+
+	RawRead - overwritten RawRead() function
+
+SYNOPSIS
+
+	private:
+	int RawRead(void *buffer, size_t length);
+
+PARAMETERS
+
+	buffer - a pointer to a buffer where the data is read to
+	length - the number of bytes in buffer which can be used
+
+DESCRIPTION
+
+	This function will be called by any of the functions which
+	read from the moIStream object (Get, Read).
+
+SEE ALSO
+
+	Constructor, moIStream
+
+*/
+int moGunZip::RawRead(void *buffer, size_t length)
+{
+	int		r;
+
+	if(length == 0) {
+		return 0;
+	}
+	if(f_index != 0 && f_index->IsActive()) {
+		// since the last Seek() we use our own inflate stream
+		r = f_index->Read(buffer, length);
+	}
+	else {
+		r = gzread(f_gz_file, buffer, static_cast<unsigned int>(length));
+	}
+	if(r > 0) {
+		f_input_position += r;
+	}
+
+	return r;
+}
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
 
 	moGunZip::gzip_mode_t
 
@@ -629,6 +2057,400 @@ unsigned long moGZip::gzip_mode_t::Level(void) const
 }
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moGZipFilterStage
+
+NAME
+
+	Constructor - create a compression stage
+	Destructor - release the zlib stream
+
+SYNOPSIS
+
+	moGZipFilterStage(moGZip::gzip_mode_t mode = moGZip::GZIP_MODE_DEFAULT);
+	virtual ~moGZipFilterStage();
+
+PARAMETERS
+
+	mode - the filter and level of compression as with moGZip
+
+DESCRIPTION
+
+	This stage compresses the data going through an moFilterPipeline
+	in the gzip format. It can be used to compress the output of
+	a stream without a temporary file:
+
+		moFilterPipelineSPtr pipeline = new moFilterPipeline;
+		pipeline->AddStage(new moGZipFilterStage);
+		moOStreamScopeFilter filter(output, pipeline);
+
+	The gzip trailer is written when the pipeline is finished
+	(when the scope filter is released for instance.) A new gzip
+	member starts if more data is written afterward.
+
+SEE ALSO
+
+	moGunZipFilterStage, moFilterPipeline::Finish
+
+*/
+moGZipFilterStage::moGZipFilterStage(moGZip::gzip_mode_t mode)
+	: f_mode(mode),
+	  f_initialized(false),
+	  f_ended(false)
+{
+	memset(&f_stream, 0, sizeof(f_stream));
+}
+
+
+moGZipFilterStage::~moGZipFilterStage()
+{
+	if(f_initialized) {
+		deflateEnd(&f_stream);
+	}
+}
+
+
+bool moGZipFilterStage::Init(void)
+{
+	int		level, strategy;
+
+	if(f_initialized) {
+		return true;
+	}
+
+	switch(f_mode.Filter()) {
+	case moGZip::GZIP_FILTER_DEFAULT:
+		strategy = Z_DEFAULT_STRATEGY;
+		break;
+
+	case moGZip::GZIP_FILTER_FAST:
+		strategy = Z_FILTERED;
+		break;
+
+	case moGZip::GZIP_FILTER_HUFFMAN:
+		strategy = Z_HUFFMAN_ONLY;
+		break;
+
+	default:
+		errno = EINVAL;
+		return false;
+
+	}
+	if(f_mode.Level() == moGZip::GZIP_LEVEL_DEFAULT) {
+		level = Z_DEFAULT_COMPRESSION;
+	}
+	else if(f_mode.Level() <= moGZip::GZIP_LEVEL_MAX) {
+		level = static_cast<int>(f_mode.Level());
+	}
+	else {
+		errno = EINVAL;
+		return false;
+	}
+
+	// 16 + 15 -- the largest window with a gzip header
+	if(deflateInit2(&f_stream, level, Z_DEFLATED, 16 + 15, 8, strategy) != Z_OK) {
+		errno = ENOMEM;
+		return false;
+	}
+	f_initialized = true;
+
+	return true;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGZipFilterStage
+
+NAME
+
+	Transform - compress the input span
+	Finish - write the end of the compressed data
+	Reset - drop the current compressed data
+
+SYNOPSIS
+
+	virtual int Transform(const void *input, unsigned long& input_size,
+			void *output, unsigned long output_size);
+	virtual int Finish(void *output, unsigned long output_size);
+	virtual void Reset(void);
+
+PARAMETERS
+
+	input - the data to compress
+	input_size - the size of input on entry and the number of
+		bytes used on return
+	output - where the compressed data is saved
+	output_size - the space available in output
+
+DESCRIPTION
+
+	See moFilterStage for more information.
+
+RETURN VALUE
+
+	the number of bytes saved in output or -1 on errors
+
+SEE ALSO
+
+	moFilterStage::Transform
+
+*/
+int moGZipFilterStage::Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size)
+{
+	int		r;
+
+	if(f_ended) {
+		// Finish() was not called until it returned zero
+		deflateReset(&f_stream);
+		f_ended = false;
+	}
+	if(!Init()) {
+		input_size = 0;
+		return -1;
+	}
+
+	f_stream.next_in = static_cast<Bytef *>(const_cast<void *>(input));
+	f_stream.avail_in = static_cast<uInt>(input_size);
+	f_stream.next_out = static_cast<Bytef *>(output);
+	f_stream.avail_out = static_cast<uInt>(output_size);
+	r = deflate(&f_stream, Z_NO_FLUSH);
+	if(r != Z_OK && r != Z_BUF_ERROR) {
+		input_size = 0;
+		errno = EINVAL;
+		return -1;
+	}
+	input_size -= f_stream.avail_in;
+
+	return static_cast<int>(output_size - f_stream.avail_out);
+}
+
+
+int moGZipFilterStage::Finish(void *output, unsigned long output_size)
+{
+	int		r;
+
+	if(f_ended) {
+		// ready for another member
+		deflateReset(&f_stream);
+		f_ended = false;
+		return 0;
+	}
+	if(!Init()) {
+		return -1;
+	}
+
+	f_stream.next_in = 0;
+	f_stream.avail_in = 0;
+	f_stream.next_out = static_cast<Bytef *>(output);
+	f_stream.avail_out = static_cast<uInt>(output_size);
+	r = deflate(&f_stream, Z_FINISH);
+	if(r == Z_STREAM_END) {
+		f_ended = true;
+	}
+	else if(r != Z_OK && r != Z_BUF_ERROR) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return static_cast<int>(output_size - f_stream.avail_out);
+}
+
+
+void moGZipFilterStage::Reset(void)
+{
+	if(f_initialized) {
+		deflateReset(&f_stream);
+	}
+	f_ended = false;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGunZipFilterStage
+
+NAME
+
+	Constructor - create a decompression stage
+	Destructor - release the zlib stream
+
+SYNOPSIS
+
+	moGunZipFilterStage(void);
+	virtual ~moGunZipFilterStage();
+
+DESCRIPTION
+
+	This stage decompresses gzip or zlib data going through an
+	moFilterPipeline. Multiple gzip members are decompressed one
+	after another as gunzip does. Data which doesn't look like a
+	gzip member after the first one is ignored.
+
+SEE ALSO
+
+	moGZipFilterStage
+
+*/
+moGunZipFilterStage::moGunZipFilterStage(void)
+	: f_initialized(false),
+	  f_members(0),
+	  f_in_member(false),
+	  f_garbage(false)
+{
+	memset(&f_stream, 0, sizeof(f_stream));
+}
+
+
+moGunZipFilterStage::~moGunZipFilterStage()
+{
+	if(f_initialized) {
+		inflateEnd(&f_stream);
+	}
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moGunZipFilterStage
+
+NAME
+
+	Transform - decompress the input span
+	Finish - check that the compressed data was complete
+	Reset - restart with a new compressed stream
+
+SYNOPSIS
+
+	virtual int Transform(const void *input, unsigned long& input_size,
+			void *output, unsigned long output_size);
+	virtual int Finish(void *output, unsigned long output_size);
+	virtual void Reset(void);
+
+PARAMETERS
+
+	input - the compressed data
+	input_size - the size of input on entry and the number of
+		bytes used on return
+	output - where the decompressed data is saved
+	output_size - the space available in output
+
+DESCRIPTION
+
+	See moFilterStage for more information.
+
+	The Finish() function fails with EIO when the input stopped
+	in the middle of a member.
+
+RETURN VALUE
+
+	the number of bytes saved in output or -1 on errors
+
+SEE ALSO
+
+	moFilterStage::Transform
+
+*/
+int moGunZipFilterStage::Transform(const void *input, unsigned long& input_size, void *output, unsigned long output_size)
+{
+	int		r;
+
+	if(!f_initialized) {
+		// 32 + 15 -- the largest window, gzip or zlib header
+		if(inflateInit2(&f_stream, 32 + 15) != Z_OK) {
+			input_size = 0;
+			errno = ENOMEM;
+			return -1;
+		}
+		f_initialized = true;
+	}
+
+	f_stream.next_in = static_cast<Bytef *>(const_cast<void *>(input));
+	f_stream.avail_in = static_cast<uInt>(input_size);
+	f_stream.next_out = static_cast<Bytef *>(output);
+	f_stream.avail_out = static_cast<uInt>(output_size);
+	while(!f_garbage && f_stream.avail_out > 0) {
+		if(!f_in_member) {
+			if(f_stream.avail_in == 0) {
+				break;
+			}
+			if(f_members > 0 && *f_stream.next_in != 0x1F) {
+				// not another gzip member
+				f_garbage = true;
+				break;
+			}
+			f_in_member = true;
+		}
+		r = inflate(&f_stream, Z_NO_FLUSH);
+		if(r == Z_STREAM_END) {
+			f_in_member = false;
+			f_members++;
+			inflateReset(&f_stream);
+			continue;
+		}
+		if(r == Z_BUF_ERROR) {
+			break;
+		}
+		if(r != Z_OK) {
+			input_size = 0;
+			errno = EINVAL;
+			return -1;
+		}
+		if(f_stream.avail_in == 0) {
+			break;
+		}
+	}
+	if(f_garbage) {
+		f_stream.avail_in = 0;
+	}
+	input_size -= f_stream.avail_in;
+
+	return static_cast<int>(output_size - f_stream.avail_out);
+}
+
+
+int moGunZipFilterStage::Finish(void *output, unsigned long output_size)
+{
+	bool		truncated;
+
+	truncated = f_in_member;
+	Reset();
+	if(truncated) {
+		errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+void moGunZipFilterStage::Reset(void)
+{
+	if(f_initialized) {
+		inflateReset(&f_stream);
+	}
+	f_members = 0;
+	f_in_member = false;
+	f_garbage = false;
+}
+
+
+
 }			// namespace molib;
 
 // vim: ts=8
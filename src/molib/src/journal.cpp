@@ -0,0 +1,672 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma implementation "mo/mo_journal.h"
+#endif
+
+#include	"mo/mo_journal.h"
+
+#include	<fcntl.h>
+#include	<sys/time.h>
+#ifdef WIN32
+#include	<io.h>
+#endif
+
+
+namespace molib
+{
+
+
+namespace
+{
+
+// the journal file starts with "MOJL" and a version number
+const unsigned char	journal_magic[4] = { 'M', 'O', 'J', 'L' };
+const uint32_t		journal_version = 1;
+const unsigned long	journal_header_size = 8;
+
+// each record is: <magic> <size> <sequence> <data> <crc32>
+const uint32_t		record_magic = 0x5245434A;	// "JREC"
+const unsigned long	record_header_size = 16;
+const unsigned long	record_trailer_size = 4;
+
+// all the numbers are saved in little endian
+void put32(unsigned char *p, uint32_t v)
+{
+	p[0] = static_cast<unsigned char>(v);
+	p[1] = static_cast<unsigned char>(v >> 8);
+	p[2] = static_cast<unsigned char>(v >> 16);
+	p[3] = static_cast<unsigned char>(v >> 24);
+}
+
+uint32_t get32(const unsigned char *p)
+{
+	return static_cast<uint32_t>(p[0])
+		| (static_cast<uint32_t>(p[1]) << 8)
+		| (static_cast<uint32_t>(p[2]) << 16)
+		| (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void put64(unsigned char *p, uint64_t v)
+{
+	put32(p, static_cast<uint32_t>(v));
+	put32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+uint64_t get64(const unsigned char *p)
+{
+	return static_cast<uint64_t>(get32(p)) | (static_cast<uint64_t>(get32(p + 4)) << 32);
+}
+
+// the CRC covers the sequence number and the data
+uint32_t record_crc(const unsigned char *record, unsigned long size)
+{
+	uLong crc = crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, record + 8, 8);
+	if(size > 0) {
+		crc = crc32(crc, record + record_header_size, static_cast<uInt>(size));
+	}
+	return static_cast<uint32_t>(crc);
+}
+
+// returns the size of the record at p or 0 if it is invalid or torn
+unsigned long valid_record(const unsigned char *p, unsigned long available)
+{
+	if(available < record_header_size + record_trailer_size
+	|| get32(p) != record_magic) {
+		return 0;
+	}
+	const unsigned long size = get32(p + 4);
+	if(size > available - record_header_size - record_trailer_size) {
+		return 0;
+	}
+	if(get32(p + record_header_size + size) != record_crc(p, size)) {
+		return 0;
+	}
+	return record_header_size + size + record_trailer_size;
+}
+
+}		// no name namespace
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moJournal
+
+NAME
+
+	Constructor - initialize a journal object
+	Destructor - close the journal
+	moGetClassName - get the name of this class
+
+SYNOPSIS
+
+	moJournal(void);
+	virtual ~moJournal();
+	virtual const char *moGetClassName(void) const;
+
+DESCRIPTION
+
+	The moJournal object manages an append-only file of records.
+	It is used as a write-ahead log: the state changes are saved
+	in the journal as they happen and a full save (a checkpoint)
+	is only done once in a while, at which point the journal is
+	truncated with Truncate(). On startup, the records found in
+	the journal are given back with Replay() so the state can be
+	reconstructed after a crash.
+
+	Each record is saved with a header including a sequence number
+	and the size of the data and a trailer with a CRC32. When the
+	journal is opened, a record which was only partially written
+	(i.e. the process or the computer crashed at that time) is
+	detected and removed from the file.
+
+	The records are first buffered by Append() and written to the
+	file all at once by Commit() (group commit). The data sync
+	(fdatasync(2)) is batched: it only happens once every sync
+	interval or once group size records were written since the
+	last sync, or when Commit(true) or Sync() are called. Data
+	which was written but not yet synced survives a crash of the
+	process, only an operating system crash or a power failure
+	can lose it.
+
+	The destructor commits and syncs any pending records.
+
+SEE ALSO
+
+	Open, Append, Commit, Replay, Truncate
+
+*/
+moJournal::moJournal(void)
+	: f_fd(-1),
+	  f_sync_interval(100000),
+	  f_group_size(32)
+{
+}
+
+
+moJournal::~moJournal()
+{
+	Close();
+}
+
+
+const char *moJournal::moGetClassName(void) const
+{
+	return "molib::moBase::moJournal";
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moJournal
+
+NAME
+
+	Open - open or create a journal
+	Close - commit pending records and close the journal
+
+SYNOPSIS
+
+	bool Open(const moWCString& filename);
+	void Close(void);
+
+PARAMETERS
+
+	filename - the name of the journal file
+
+DESCRIPTION
+
+	The Open() function opens the named journal. If the file does
+	not exist, it is created. When it exists, the records are
+	verified and any invalid data found at the end of the file
+	(a torn write) is truncated so new records can be appended.
+	The sequence number continues from the last valid record.
+
+	The Close() function commits and syncs the pending records
+	then closes the file. It is safe to call Close() on a journal
+	which is not open.
+
+RETURN VALUE
+
+	Open() returns true when the journal is ready to be used.
+
+SEE ALSO
+
+	Replay, Truncate
+
+*/
+bool moJournal::Open(const moWCString& filename)
+{
+	Close();
+
+	moLockMutex lock(f_mutex);
+
+	int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0600);	/* Flawfinder: ignore */
+	if(fd == -1) {
+		return false;
+	}
+
+	const off_t file_size = ::lseek(fd, 0, SEEK_END);
+	if(file_size < static_cast<off_t>(journal_header_size)) {
+		// new (or too small to be valid) journal, start over
+		unsigned char header[journal_header_size];
+		memcpy(header, journal_magic, sizeof(journal_magic));
+		put32(header + 4, journal_version);
+		if(::ftruncate(fd, 0) != 0
+		|| ::lseek(fd, 0, SEEK_SET) != 0
+		|| ::write(fd, header, journal_header_size) != static_cast<ssize_t>(journal_header_size)) {
+			::close(fd);
+			return false;
+		}
+		f_size = journal_header_size;
+		f_sequence = 0;
+	}
+	else {
+		moBuffer buffer;
+		buffer.SetSize(static_cast<unsigned long>(file_size));
+		void		*data;
+		unsigned long	size;
+		buffer.Get(data, size);
+		if(::lseek(fd, 0, SEEK_SET) != 0
+		|| ::read(fd, data, size) != static_cast<ssize_t>(size)) {
+			::close(fd);
+			return false;
+		}
+		const unsigned char *p = static_cast<const unsigned char *>(data);
+		if(memcmp(p, journal_magic, sizeof(journal_magic)) != 0
+		|| get32(p + 4) != journal_version) {
+			// not a journal we can use
+			::close(fd);
+			return false;
+		}
+		unsigned long pos = journal_header_size;
+		f_sequence = 0;
+		for(;;) {
+			const unsigned long length = valid_record(p + pos, size - pos);
+			if(length == 0) {
+				break;
+			}
+			f_sequence = get64(p + pos + 8);
+			pos += length;
+		}
+		if(pos < size) {
+			// drop the torn record(s)
+			if(::ftruncate(fd, pos) != 0) {
+				::close(fd);
+				return false;
+			}
+		}
+		f_size = static_cast<uint32_t>(pos);
+		if(::lseek(fd, pos, SEEK_SET) != static_cast<off_t>(pos)) {
+			::close(fd);
+			return false;
+		}
+	}
+
+	f_fd = fd;
+	f_filename = filename;
+	f_pending.Empty();
+	f_pending_records = 0;
+	f_unsynced = 0;
+	f_last_sync = Now();
+
+	return true;
+}
+
+
+void moJournal::Close(void)
+{
+	moLockMutex lock(f_mutex);
+
+	if(f_fd != -1) {
+		Commit(true);
+		::close(f_fd);
+		f_fd = -1;
+	}
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moJournal
+
+NAME
+
+	SetSyncInterval - the maximum time between data syncs
+	SetGroupSize - the maximum number of records between data syncs
+
+SYNOPSIS
+
+	void SetSyncInterval(int64_t usec);
+	void SetGroupSize(unsigned long records);
+
+PARAMETERS
+
+	usec - the interval in microseconds
+	records - the number of records
+
+DESCRIPTION
+
+	These functions define how often Commit() syncs the data
+	to disk. When the last sync happened more than usec
+	microseconds ago or when at least the specified number of
+	records were written since the last sync, Commit() syncs
+	the journal.
+
+	Setting the interval to 0 or the group size to 1 forces a
+	sync on every Commit().
+
+	The defaults are 100ms and 32 records.
+
+SEE ALSO
+
+	Commit, Sync
+
+*/
+void moJournal::SetSyncInterval(int64_t usec)
+{
+	f_sync_interval = usec < 0 ? 0 : usec;
+}
+
+
+void moJournal::SetGroupSize(unsigned long records)
+{
+	f_group_size = records == 0 ? 1 : static_cast<uint32_t>(records);
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moJournal
+
+NAME
+
+	Append - add a record to the journal
+	Commit - write the pending records
+	Sync - sync the written records to disk
+
+SYNOPSIS
+
+	sequence_t Append(const moBuffer& data);
+	bool Commit(bool sync = false);
+	bool Sync(void);
+
+PARAMETERS
+
+	data - the data of the record
+	sync - force a data sync
+
+DESCRIPTION
+
+	The Append() function adds a record to the list of pending
+	records. Nothing is written to the file until Commit() is
+	called. This way a group of records is written with a single
+	write(2).
+
+	The Commit() function writes all the pending records and
+	then syncs the data if requested or if the sync interval or
+	the group size were reached (see SetSyncInterval() and
+	SetGroupSize()).
+
+	The Sync() function syncs the records which were written
+	but not yet synced. It uses fdatasync(2) when available.
+	It is a good idea to call Sync() from a timer so the data
+	does not stay unsynced for long when no other records get
+	committed.
+
+RETURN VALUE
+
+	Append() returns the sequence number of the new record or 0
+	when the journal is not open.
+
+	Commit() and Sync() return false if an I/O error occurs.
+
+SEE ALSO
+
+	SetSyncInterval, SetGroupSize
+
+*/
+moJournal::sequence_t moJournal::Append(const moBuffer& data)
+{
+	moLockMutex lock(f_mutex);
+
+	if(f_fd == -1) {
+		return 0;
+	}
+
+	void		*d;
+	unsigned long	size;
+	data.Get(d, size);
+
+	unsigned long pos = f_pending.GetSize();
+	f_pending.SetSize(pos + record_header_size + size + record_trailer_size);
+
+	void		*buf;
+	unsigned long	buf_size;
+	f_pending.Get(buf, buf_size);
+
+	++f_sequence;
+	unsigned char *p = static_cast<unsigned char *>(buf) + pos;
+	put32(p, record_magic);
+	put32(p + 4, static_cast<uint32_t>(size));
+	put64(p + 8, f_sequence);
+	if(size > 0) {
+		memcpy(p + record_header_size, d, size);
+	}
+	put32(p + record_header_size + size, record_crc(p, size));
+
+	++f_pending_records;
+
+	return f_sequence;
+}
+
+
+bool moJournal::Commit(bool sync)
+{
+	moLockMutex lock(f_mutex);
+
+	if(f_fd == -1) {
+		return false;
+	}
+
+	void		*data;
+	unsigned long	size;
+	f_pending.Get(data, size);
+	if(size > 0) {
+		if(!WriteAll(data, size)) {
+			return false;
+		}
+		f_size += static_cast<uint32_t>(size);
+		f_unsynced += f_pending_records;
+		f_stats.f_records += f_pending_records;
+		f_stats.f_bytes += size;
+		++f_stats.f_commits;
+		f_pending.Empty();
+		f_pending_records = 0;
+	}
+
+	if(f_unsynced == 0) {
+		return true;
+	}
+	if(sync
+	|| f_unsynced >= f_group_size
+	|| Now() - f_last_sync >= f_sync_interval) {
+		return Sync();
+	}
+
+	return true;
+}
+
+
+bool moJournal::Sync(void)
+{
+	moLockMutex lock(f_mutex);
+
+	if(f_fd == -1) {
+		return false;
+	}
+	if(f_unsynced == 0) {
+		return true;
+	}
+
+#if defined(WIN32)
+	const int r = _commit(f_fd);
+#elif defined(MO_LINUX) || defined(LINUX)
+	const int r = fdatasync(f_fd);
+#else
+	const int r = fsync(f_fd);
+#endif
+	if(r != 0) {
+		return false;
+	}
+
+	f_unsynced = 0;
+	f_last_sync = Now();
+	++f_stats.f_syncs;
+
+	return true;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moJournal
+
+NAME
+
+	Replay - send all the records to a handler
+	Truncate - remove all the records from the journal
+
+SYNOPSIS
+
+	bool Replay(moReplayHandler& handler);
+	bool Truncate(void);
+
+PARAMETERS
+
+	handler - the object receiving the records
+
+DESCRIPTION
+
+	The Replay() function commits the pending records and then
+	reads the journal from the start and calls the handler
+	Record() function once per record, in order. If the handler
+	returns false, the replay stops.
+
+	The Truncate() function removes all the records from the
+	journal. It is expected to be called after a checkpoint, when
+	the state saved in the journal was saved somewhere else. The
+	pending records are dropped. The sequence numbers are not
+	reset.
+
+RETURN VALUE
+
+	Both functions return false if the journal is not open or an
+	I/O error occurs. Replay() also returns false if the handler
+	stopped the replay.
+
+SEE ALSO
+
+	Open, Append
+
+*/
+bool moJournal::Replay(moReplayHandler& handler)
+{
+	moLockMutex lock(f_mutex);
+
+	if(!Commit()) {
+		return false;
+	}
+
+	moBuffer buffer;
+	buffer.SetSize(f_size);
+	void		*data;
+	unsigned long	size;
+	buffer.Get(data, size);
+	const ssize_t r = ::pread(f_fd, data, size, 0);
+	if(r != static_cast<ssize_t>(size)) {
+		return false;
+	}
+
+	const unsigned char *p = static_cast<const unsigned char *>(data);
+	unsigned long pos = journal_header_size;
+	moBuffer record;
+	while(pos < size) {
+		const unsigned long length = valid_record(p + pos, size - pos);
+		if(length == 0) {
+			// Open() already removed invalid data
+			return false;
+		}
+		const unsigned long record_size = length - record_header_size - record_trailer_size;
+		record.SetSize(record_size);
+		if(record_size > 0) {
+			void		*rd;
+			unsigned long	rs;
+			record.Get(rd, rs);
+			memcpy(rd, p + pos + record_header_size, record_size);
+		}
+		if(!handler.Record(get64(p + pos + 8), record)) {
+			return false;
+		}
+		pos += length;
+	}
+
+	return true;
+}
+
+
+bool moJournal::Truncate(void)
+{
+	moLockMutex lock(f_mutex);
+
+	if(f_fd == -1) {
+		return false;
+	}
+
+	f_pending.Empty();
+	f_pending_records = 0;
+
+	if(::ftruncate(f_fd, journal_header_size) != 0
+	|| ::lseek(f_fd, journal_header_size, SEEK_SET) != static_cast<off_t>(journal_header_size)) {
+		return false;
+	}
+	f_size = journal_header_size;
+	f_unsynced = 1;		// make sure the truncation gets synced
+
+	return Sync();
+}
+
+
+
+bool moJournal::WriteAll(const void *data, unsigned long size)
+{
+	const char *p = static_cast<const char *>(data);
+	while(size > 0) {
+		const ssize_t r = ::write(f_fd, p, size);
+		if(r <= 0) {
+			if(r < 0 && errno == EINTR) {
+				continue;
+			}
+			// remove the partial record if any
+			if(::ftruncate(f_fd, f_size) == 0) {
+				::lseek(f_fd, f_size, SEEK_SET);
+			}
+			return false;
+		}
+		p += r;
+		size -= static_cast<unsigned long>(r);
+	}
+
+	return true;
+}
+
+
+int64_t moJournal::Now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+
+
+
+};			// namespace molib
+
+// vim: ts=8 sw=8
@@ -27,6 +27,8 @@
 #ifdef WIN32
 #include	<sys/types.h>
 #include	<sys/timeb.h>
+#else
+#include	<sys/time.h>
 #endif
 
 #ifdef _MSC_VER
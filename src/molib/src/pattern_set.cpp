@@ -0,0 +1,599 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma implementation "mo/mo_pattern_set.h"
+#endif
+
+#include	"mo/mo_pattern_set.h"
+
+#include	<map>
+#include	<vector>
+
+
+namespace molib
+{
+
+
+// The automaton
+//
+// The keywords are the literal patterns and the literals the regular
+// expressions require (see moRegularExpression::RequiredLiteral()).
+// They are compiled in an Aho-Corasick automaton: the trie of the
+// keywords where the failure links were resolved in a full transition
+// table, so the scan is one table lookup per character whatever the
+// number of patterns.
+//
+// The characters are first mapped to a class: all the characters
+// which do not appear in any keyword share class 0, which keeps the
+// table small.
+//
+// Each state lists all the keywords ending there (including the ones
+// found through its failure links.) The scan records the first end of
+// each keyword and stops as soon as all of them were found.
+
+namespace
+{
+const int		MO_PATTERN_SET_UNKNOWN = -1;	// regular expression not run yet
+const int		MO_PATTERN_SET_NO = 0;
+const int		MO_PATTERN_SET_YES = 1;
+}		// no name namespace
+
+
+class moPatternSet::moAutomaton
+{
+public:
+				moAutomaton(void);
+
+	int			Add(const moWCString& pattern, mo_pattern_t type);
+	unsigned long		Count(void) const { return static_cast<unsigned long>(f_patterns.size()); }
+
+	void			Scan(const moWCString& subject);
+	bool			MayMatch(int index) const;
+	bool			Matched(int index);
+	int			GetStartPos(int index);
+	int			GetLastPos(int index);
+
+private:
+	struct pattern_t {
+		mo_pattern_t		type;
+		moWCString		literal;	// the literal pattern or the literal the expression requires
+		moRegularExpressionSPtr	regexpr;	// the expression when type is MO_PATTERN_REGEXPR
+		long			keyword;	// keyword of literal or -1 when empty
+		int			matched;	// one of the MO_PATTERN_SET_...
+		int			start;
+		int			end;
+	};
+
+	void			Compile(void);
+	long			Class(mowc::wc_t c) const;
+
+	std::vector<pattern_t>	f_patterns;
+	std::vector<moWCString>	f_keywords;
+	std::map<moWCString, long> f_keyword_index;
+	bool			f_compiled;
+
+	// the automaton
+	long			f_classes;
+	long			f_ascii[256];			// class of characters 0 to 255
+	std::map<mowc::wc_t, long> f_wide;			// class of the other characters
+	std::vector<long>	f_delta;			// next state = f_delta[state * f_classes + class]
+	std::vector<std::vector<long> > f_output;		// keywords ending in each state
+
+	// the result of the last scan
+	moWCString		f_subject;
+	std::vector<long>	f_end;				// first end of each keyword or -1
+};
+
+
+
+
+moPatternSet::moAutomaton::moAutomaton(void)
+	: f_compiled(false)
+	, f_classes(1)
+{
+}
+
+
+int moPatternSet::moAutomaton::Add(const moWCString& pattern, mo_pattern_t type)
+{
+	pattern_t p;
+	p.type = type;
+	p.keyword = -1;
+	p.matched = MO_PATTERN_SET_UNKNOWN;
+	p.start = -1;
+	p.end = -1;
+	if(type == MO_PATTERN_REGEXPR) {
+		p.regexpr = new moRegularExpression(pattern);
+		p.literal = p.regexpr->RequiredLiteral();
+	}
+	else {
+		p.literal = pattern;
+	}
+
+	if(!p.literal.IsEmpty()) {
+		std::map<moWCString, long>::const_iterator it(f_keyword_index.find(p.literal));
+		if(it == f_keyword_index.end()) {
+			p.keyword = static_cast<long>(f_keywords.size());
+			f_keyword_index[p.literal] = p.keyword;
+			f_keywords.push_back(p.literal);
+		}
+		else {
+			p.keyword = it->second;
+		}
+	}
+
+	f_patterns.push_back(p);
+	f_compiled = false;
+
+	return static_cast<int>(f_patterns.size() - 1);
+}
+
+
+long moPatternSet::moAutomaton::Class(mowc::wc_t c) const
+{
+	if(c >= 0 && c < 256) {
+		return f_ascii[c];
+	}
+	std::map<mowc::wc_t, long>::const_iterator it(f_wide.find(c));
+	return it == f_wide.end() ? 0 : it->second;
+}
+
+
+void moPatternSet::moAutomaton::Compile(void)
+{
+	const unsigned long max(f_keywords.size());
+	unsigned long idx, i;
+
+	// give a class to each character used in a keyword
+	f_classes = 1;
+	for(i = 0; i < 256; ++i) {
+		f_ascii[i] = 0;
+	}
+	f_wide.clear();
+	for(idx = 0; idx < max; ++idx) {
+		for(const mowc::wc_t *s = f_keywords[idx].Data(); *s != '\0'; ++s) {
+			if(*s >= 0 && *s < 256) {
+				if(f_ascii[*s] == 0) {
+					f_ascii[*s] = f_classes++;
+				}
+			}
+			else if(f_wide.find(*s) == f_wide.end()) {
+				f_wide[*s] = f_classes++;
+			}
+		}
+	}
+
+	// build the trie, -1 are the missing transitions
+	f_delta.assign(static_cast<size_t>(f_classes), -1);
+	f_output.assign(1, std::vector<long>());
+	for(idx = 0; idx < max; ++idx) {
+		long state(0);
+		for(const mowc::wc_t *s = f_keywords[idx].Data(); *s != '\0'; ++s) {
+			long& next(f_delta[state * f_classes + Class(*s)]);
+			if(next == -1) {
+				next = static_cast<long>(f_output.size());
+				f_output.push_back(std::vector<long>());
+				f_delta.resize(f_delta.size() + static_cast<size_t>(f_classes), -1);
+			}
+			state = f_delta[state * f_classes + Class(*s)];
+		}
+		f_output[state].push_back(static_cast<long>(idx));
+	}
+
+	// breadth first, the failure state of each state is resolved
+	// before its children are reached; the missing transitions are
+	// replaced by the transitions of the failure state
+	std::vector<long> fail(f_output.size(), 0);
+	std::vector<long> queue;
+	for(long c = 0; c < f_classes; ++c) {
+		long& next(f_delta[c]);
+		if(next == -1) {
+			next = 0;
+		}
+		else {
+			queue.push_back(next);
+		}
+	}
+	for(i = 0; i < queue.size(); ++i) {
+		const long state(queue[i]);
+		const std::vector<long>& inherited(f_output[fail[state]]);
+		f_output[state].insert(f_output[state].end(), inherited.begin(), inherited.end());
+		for(long c = 0; c < f_classes; ++c) {
+			const long fallback(f_delta[fail[state] * f_classes + c]);
+			long& next(f_delta[state * f_classes + c]);
+			if(next == -1) {
+				next = fallback;
+			}
+			else {
+				fail[next] = fallback;
+				queue.push_back(next);
+			}
+		}
+	}
+
+	f_compiled = true;
+}
+
+
+void moPatternSet::moAutomaton::Scan(const moWCString& subject)
+{
+	if(!f_compiled) {
+		Compile();
+	}
+
+	f_subject = subject;
+
+	const unsigned long max(f_patterns.size());
+	for(unsigned long idx = 0; idx < max; ++idx) {
+		pattern_t& p(f_patterns[idx]);
+		p.matched = MO_PATTERN_SET_UNKNOWN;
+		p.start = -1;
+		p.end = -1;
+	}
+
+	// the single pass over the subject
+	unsigned long missing(f_keywords.size());
+	f_end.assign(missing, -1);
+	const mowc::wc_t *s(f_subject.Data());
+	long state(0);
+	for(long pos = 0; missing > 0 && s[pos] != '\0'; ++pos) {
+		state = f_delta[state * f_classes + Class(s[pos])];
+		const std::vector<long>& output(f_output[state]);
+		for(std::vector<long>::const_iterator it(output.begin()); it != output.end(); ++it) {
+			if(f_end[*it] == -1) {
+				f_end[*it] = pos + 1;
+				--missing;
+			}
+		}
+	}
+
+	// the literals are known now
+	for(unsigned long idx = 0; idx < max; ++idx) {
+		pattern_t& p(f_patterns[idx]);
+		if(p.type != MO_PATTERN_LITERAL) {
+			if(p.keyword != -1 && f_end[p.keyword] == -1) {
+				// the required literal is missing
+				p.matched = MO_PATTERN_SET_NO;
+			}
+			continue;
+		}
+		if(p.keyword == -1) {
+			// the empty string matches any subject
+			p.matched = MO_PATTERN_SET_YES;
+			p.start = 0;
+			p.end = 0;
+		}
+		else if(f_end[p.keyword] == -1) {
+			p.matched = MO_PATTERN_SET_NO;
+		}
+		else {
+			// the first end of a keyword is also its leftmost start
+			p.matched = MO_PATTERN_SET_YES;
+			p.end = static_cast<int>(f_end[p.keyword]);
+			p.start = p.end - static_cast<int>(p.literal.Length());
+		}
+	}
+}
+
+
+bool moPatternSet::moAutomaton::MayMatch(int index) const
+{
+	return f_patterns[static_cast<size_t>(index)].matched != MO_PATTERN_SET_NO;
+}
+
+
+bool moPatternSet::moAutomaton::Matched(int index)
+{
+	pattern_t& p(f_patterns[static_cast<size_t>(index)]);
+	if(p.matched == MO_PATTERN_SET_UNKNOWN && p.type == MO_PATTERN_REGEXPR) {
+		if(p.regexpr->MatchExpression(f_subject)) {
+			p.matched = MO_PATTERN_SET_YES;
+			p.start = p.regexpr->GetStartPos();
+			p.end = p.regexpr->GetLastPos();
+		}
+		else {
+			p.matched = MO_PATTERN_SET_NO;
+		}
+	}
+
+	return p.matched == MO_PATTERN_SET_YES;
+}
+
+
+int moPatternSet::moAutomaton::GetStartPos(int index)
+{
+	return Matched(index) ? f_patterns[static_cast<size_t>(index)].start : -1;
+}
+
+
+int moPatternSet::moAutomaton::GetLastPos(int index)
+{
+	return Matched(index) ? f_patterns[static_cast<size_t>(index)].end : -1;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPatternSet
+
+NAME
+
+	Constructor - create an empty set of patterns
+	Destructor - release the automaton
+
+SYNOPSIS
+
+	moPatternSet(void);
+	virtual ~moPatternSet();
+
+DESCRIPTION
+
+	An moPatternSet is used to test one subject against many patterns
+	at once. The patterns are literal strings or moRegularExpression
+	expressions added with the Add() function.
+
+	The literals and the literal each expression requires are searched
+	all at once with an Aho-Corasick automaton. This means a single
+	pass over the subject tells which patterns cannot match, however
+	many patterns the set includes. The expressions which found their
+	literal (or which do not require any) are run only when their
+	result is requested with Matched().
+
+	The set cannot be copied.
+
+SEE ALSO
+
+	Add, Scan, Matched, moRegularExpression::RequiredLiteral
+
+*/
+moPatternSet::moPatternSet(void)
+	: f_automaton(new moAutomaton)
+{
+}
+
+
+moPatternSet::~moPatternSet()
+{
+	delete f_automaton;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPatternSet
+
+NAME
+
+	Add - add a pattern to the set
+	Empty - remove all the patterns
+	Count - returns the number of patterns
+
+SYNOPSIS
+
+	int Add(const moWCString& pattern, mo_pattern_t type = MO_PATTERN_REGEXPR);
+	void Empty(void);
+	unsigned long Count(void) const;
+
+PARAMETERS
+
+	pattern - the literal or regular expression
+	type - MO_PATTERN_LITERAL or MO_PATTERN_REGEXPR
+
+DESCRIPTION
+
+	The Add() function appends a pattern to the set. The automaton is
+	compiled again on the next call to Scan().
+
+	An invalid regular expression never matches, however, Scan()
+	always considers it as a possible match so the caller sees the
+	error when it runs the expression itself.
+
+	The Empty() function removes all the patterns.
+
+RETURN VALUE
+
+	Add() returns the index of the new pattern; the indexes start
+	at 0 and are used to query the results
+
+	Count() returns the number of patterns in the set
+
+SEE ALSO
+
+	Scan, Matched
+
+*/
+int moPatternSet::Add(const moWCString& pattern, mo_pattern_t type)
+{
+	return f_automaton->Add(pattern, type);
+}
+
+
+void moPatternSet::Empty(void)
+{
+	moAutomaton *automaton(new moAutomaton);
+	delete f_automaton;
+	f_automaton = automaton;
+}
+
+
+unsigned long moPatternSet::Count(void) const
+{
+	return f_automaton->Count();
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPatternSet
+
+NAME
+
+	Scan - search all the literals in one pass
+	Match - scan and run all the possible expressions
+
+SYNOPSIS
+
+	void Scan(const moWCString& subject);
+	unsigned long Match(const moWCString& subject);
+
+PARAMETERS
+
+	subject - the string to check against the patterns
+
+DESCRIPTION
+
+	The Scan() function searches the subject for all the literals of
+	the set in a single pass. Once it returns, the literal patterns are
+	known to match or not and the expressions which cannot match are
+	known. The other expressions are run by Matched() the first time
+	their result is requested.
+
+	Each call scans the subject again and drops the results of the
+	previous subject; scan a line once and then query all the
+	patterns.
+
+	The Match() function scans the subject and then checks all the
+	patterns.
+
+RETURN VALUE
+
+	Match() returns the number of patterns matching the subject
+
+SEE ALSO
+
+	MayMatch, Matched, GetStartPos
+
+*/
+void moPatternSet::Scan(const moWCString& subject)
+{
+	f_automaton->Scan(subject);
+}
+
+
+unsigned long moPatternSet::Match(const moWCString& subject)
+{
+	unsigned long	idx, max, count;
+
+	f_automaton->Scan(subject);
+
+	count = 0;
+	max = f_automaton->Count();
+	for(idx = 0; idx < max; ++idx) {
+		if(f_automaton->Matched(static_cast<int>(idx))) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPatternSet
+
+NAME
+
+	MayMatch - whether a pattern passed the scan
+	Matched - whether a pattern matches
+	GetStartPos - returns the start of the first match of a pattern
+	GetLastPos - returns the end of the first match of a pattern
+
+SYNOPSIS
+
+	bool MayMatch(int index) const;
+	bool Matched(int index);
+	int GetStartPos(int index);
+	int GetLastPos(int index);
+
+PARAMETERS
+
+	index - the index returned by Add()
+
+DESCRIPTION
+
+	These functions return the results for the subject of the last
+	call to Scan() or Match().
+
+	MayMatch() only uses the result of the scan. When it returns false
+	the pattern does not match. When it returns true a literal pattern
+	matches and an expression may match.
+
+	Matched() runs the expression if necessary (only once per subject)
+	and returns the exact result.
+
+	The positions are the same as moRegularExpression::GetStartPos()
+	and GetLastPos() would return: the first character of the match
+	and the position just after the last character. A literal matches
+	at its leftmost occurrence.
+
+RETURN VALUE
+
+	The positions are -1 when the pattern does not match
+
+SEE ALSO
+
+	Scan, moRegularExpression::MatchExpression
+
+*/
+bool moPatternSet::MayMatch(int index) const
+{
+	return f_automaton->MayMatch(index);
+}
+
+
+bool moPatternSet::Matched(int index)
+{
+	return f_automaton->Matched(index);
+}
+
+
+int moPatternSet::GetStartPos(int index)
+{
+	return f_automaton->GetStartPos(index);
+}
+
+
+int moPatternSet::GetLastPos(int index)
+{
+	return f_automaton->GetLastPos(index);
+}
+
+
+
+
+};			// namespace molib;
+
+// vim: ts=8 sw=8
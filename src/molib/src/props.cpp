@@ -24,7 +24,12 @@
 
 #include	"mo/mo_props.h"
 
+#include <atomic>
+#include <thread>
 #include <typeinfo>
+#include <exception>
+#include <set>
+#include <vector>
 
 namespace molib
 {
@@ -451,9 +456,35 @@ const char *moProp::moGetClassName(void) const
 }
 
 
+namespace
+{
+// every property creation and modification bumps this counter
+std::atomic<moProp::generation_t>	g_generation(0);
+
+moProp::generation_t next_generation(void)
+{
+	return ++g_generation;
+}
+
+// generations only grow: when two threads touch the same bag, the
+// bag keeps the larger of the two generations
+void raise_generation(std::atomic<moProp::generation_t>& current, moProp::generation_t generation)
+{
+	moProp::generation_t value = current.load();
+	while(value < generation && !current.compare_exchange_weak(value, generation)) {
+		// value was reloaded, try again
+	}
+}
+}		// no name namespace
+
+
 moProp::moProp(mo_name_t name)
 	: f_name(name),
-	  f_lock_type(true)
+	  f_lock_type(true),
+	  f_parent(0),
+	  f_generation(next_generation()),
+	  f_removal_generation(0),
+	  f_frozen(false)
 {
 //fprintf(stderr, "Created prop 0x%08X\n", (int)name);
 }
@@ -462,10 +493,14 @@ moProp::moProp(mo_name_t name)
 moProp::moProp(const moProp& prop)
 	: moBase(*this),
 	  f_name(prop.GetName()),
-	  f_lock_type(prop.IsTypeLocked())
+	  f_lock_type(prop.IsTypeLocked()),
 	  // It seems that we never want another property handlers!
 	  //f_handlers(prop.f_handlers),
 	  //f_new_handlers(prop.f_new_handlers)
+	  f_parent(0),
+	  f_generation(next_generation()),
+	  f_removal_generation(0),
+	  f_frozen(false)
 {
 }
 
@@ -941,6 +976,16 @@ fprintf(stderr, "Holder RC = %ld\n", h->ReferenceCount());
 	} // UNLOCKING
 #endif
 
+	if(moPropSignalBatch::IsActive()) {
+		// the batch will call each handler once when it ends
+		moLockMutex lock(f_mutex);
+		max = f_handlers.Count();
+		for(pos = 0; pos < max; pos++) {
+			moPropSignalBatch::Defer(this, f_handlers.Get(pos));
+		}
+		return;
+	}
+
 	f_mutex.Lock();
 	do {
 		f_signal_list_changed = false;
@@ -957,6 +1002,356 @@ fprintf(stderr, "Holder RC = %ld\n", h->ReferenceCount());
 
 
 
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPropSignalBatch
+
+NAME
+
+	Constructor - start a batch of property signals
+	Destructor - end the batch and send the queued signals
+	Flush - send the signals queued so far
+	IsActive - check whether a batch is active in this thread
+	GetStats - retrieve the batch counters
+	ResetStats - reset the batch counters to zero
+
+SYNOPSIS
+
+	moPropSignalBatch(void);
+	~moPropSignalBatch();
+	void Flush(void);
+	static bool IsActive(void);
+	static void GetStats(stats_t& stats);
+	static void ResetStats(void);
+
+	private:
+	static bool Defer(moProp *prop, moProp::moHandler *holder);
+	static void Deliver(bool silent);
+
+PARAMETERS
+
+	stats - the structure receiving the counters
+	prop - the property being signaled
+	holder - one of the handlers of that property
+	silent - ignore the errors generated by the handlers
+
+DESCRIPTION
+
+	Bulk updates (loading a bag, applying an effect to many
+	stats, etc.) would normally call the handlers of a property
+	each time one of its values changes. By creating an
+	moPropSignalBatch object on the stack, the moProp::Signal()
+	calls made by the current thread are instead queued. Each
+	(property, handler) pair is queued only once, in the order
+	of the first change, and the handlers are called when the
+	outermost batch of the thread is destroyed. The value the
+	handlers see is therefore the final value.
+
+	Batches can be nested; the inner batches have no effect
+	other than increasing the depth. Other threads are not
+	affected by the batches of the current thread.
+
+	A handler which was removed from its property before the
+	end of the batch is not called. Signals generated by the
+	handlers while the queue is being sent are queued and sent
+	before the delivery returns.
+
+	The Flush() function sends the signals queued so far without
+	ending the batch. The destructor never throws; the exceptions
+	raised by the handlers it calls are ignored. Call Flush() just
+	before the end of the batch to handle them.
+
+	The GetStats() function returns the number of handler calls
+	which were queued, the number which were suppressed because
+	the pair was already queued and the number which were sent.
+	These counters are global to all the threads.
+
+RETURN VALUE
+
+	IsActive() returns true when a batch exists in this thread
+
+	Defer() returns true when the call was queued and false if
+	that pair was already queued
+
+SEE ALSO
+
+	moProp::Signal, moProp::AddHandler
+
+*/
+struct moPropSignalBatch::batch_t
+{
+	typedef std::pair<const moProp *, const moProp::moHandler *>	key_t;
+
+	struct pending_t
+	{
+		moPropSPtr		f_prop;
+		moProp::moHandlerSPtr	f_holder;
+	};
+
+				batch_t(void)
+					: f_depth(0),
+					  f_delivering(false)
+				{
+				}
+
+	long			f_depth;
+	bool			f_delivering;
+	std::vector<pending_t>	f_pending;
+	std::set<key_t>		f_queued;
+};
+
+
+namespace
+{
+// the batches of all the threads update these counters; they are
+// atomic so queuing a signal never waits on another thread
+std::atomic<uint64_t>		g_batch_deferred(0);
+std::atomic<uint64_t>		g_batch_suppressed(0);
+std::atomic<uint64_t>		g_batch_delivered(0);
+}		// no name namespace
+
+
+moPropSignalBatch::moPropSignalBatch(void)
+{
+	++Batch().f_depth;
+}
+
+
+moPropSignalBatch::~moPropSignalBatch()
+{
+	batch_t& batch = Batch();
+	if(batch.f_depth == 1) {
+		// a destructor must not throw; use Flush() to get the errors
+		Deliver(true);
+	}
+	--batch.f_depth;
+}
+
+
+void moPropSignalBatch::Flush(void)
+{
+	Deliver(false);
+}
+
+
+bool moPropSignalBatch::IsActive(void)
+{
+	return Batch().f_depth > 0;
+}
+
+
+void moPropSignalBatch::GetStats(stats_t& stats)
+{
+	stats.f_deferred = g_batch_deferred.load(std::memory_order_relaxed);
+	stats.f_suppressed = g_batch_suppressed.load(std::memory_order_relaxed);
+	stats.f_delivered = g_batch_delivered.load(std::memory_order_relaxed);
+}
+
+
+void moPropSignalBatch::ResetStats(void)
+{
+	g_batch_deferred.store(0, std::memory_order_relaxed);
+	g_batch_suppressed.store(0, std::memory_order_relaxed);
+	g_batch_delivered.store(0, std::memory_order_relaxed);
+}
+
+
+moPropSignalBatch::batch_t& moPropSignalBatch::Batch(void)
+{
+	static thread_local batch_t batch;
+	return batch;
+}
+
+
+bool moPropSignalBatch::Defer(moProp *prop, moProp::moHandler *holder)
+{
+	batch_t& batch = Batch();
+	bool queued = batch.f_queued.insert(batch_t::key_t(prop, holder)).second;
+	if(queued) {
+		batch_t::pending_t pending;
+		pending.f_prop = prop;
+		pending.f_holder = holder;
+		batch.f_pending.push_back(pending);
+	}
+
+	g_batch_deferred.fetch_add(1, std::memory_order_relaxed);
+	if(!queued) {
+		g_batch_suppressed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return queued;
+}
+
+
+void moPropSignalBatch::Deliver(bool silent)
+{
+	batch_t& batch = Batch();
+	if(batch.f_delivering) {
+		// a handler flushed; the outer loop sends everything
+		return;
+	}
+	batch.f_delivering = true;
+
+	try {
+		while(!batch.f_pending.empty()) {
+			std::vector<batch_t::pending_t> pending;
+			pending.swap(batch.f_pending);
+			batch.f_queued.clear();
+
+			std::vector<batch_t::pending_t>::iterator it;
+			for(it = pending.begin(); it != pending.end(); ++it) {
+				moProp *prop = static_cast<moProp *>(it->f_prop);
+				{
+					moLockMutex lock(prop->f_mutex);
+					if(prop->f_handlers.Find(it->f_holder) == moList::NO_POSITION) {
+						// removed since it was queued
+						continue;
+					}
+				}
+				g_batch_delivered.fetch_add(1, std::memory_order_relaxed);
+				if(silent) {
+					try {
+						it->f_holder->Call(prop);
+					}
+					catch(...) {
+					}
+				}
+				else {
+					it->f_holder->Call(prop);
+				}
+			}
+		}
+	}
+	catch(...) {
+		batch.f_pending.clear();
+		batch.f_queued.clear();
+		batch.f_delivering = false;
+		throw;
+	}
+
+	batch.f_delivering = false;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moProp
+
+NAME
+
+	CurrentGeneration - get the latest generation number
+	GetGeneration - get the generation of the last modification
+	GetRemovalGeneration - get the generation of the last removal
+	Touch - mark this property and its parents as modified
+
+SYNOPSIS
+
+	static generation_t CurrentGeneration(void);
+	generation_t GetGeneration(void) const;
+	generation_t GetRemovalGeneration(void) const;
+	void Touch(bool removal = false);
+
+	private:
+	void SetParent(moProp *parent);
+	void ClearParent(const moProp *parent);
+
+PARAMETERS
+
+	removal - whether the modification removed properties
+	parent - the bag or array holding this property
+
+DESCRIPTION
+
+	Each property is assigned a generation number when created
+	and each time its value really changes (i.e. setting a value
+	equal to the current value is not a modification). The
+	generation numbers come from a single process wide counter
+	so they can be compared between any two properties.
+
+	The Touch() function assigns a new generation number to this
+	property and to all the bags and arrays holding it, up to the
+	root bag. Thus, comparing the generation of a bag against the
+	value CurrentGeneration() returned at the time of the last save
+	tells whether anything changed in that bag since then. The
+	moPropIO delta mode uses this to write only modified sub-bags.
+
+	When the modification removes properties (Delete(), Empty(),
+	a Copy() over a bag or an array) the removal generation is
+	also updated. A delta cannot express removals so in that
+	case the whole tree needs to be saved again.
+
+	The parent pointer is set by the moPropBag and moPropArray
+	objects when a property is added to them. It is not reference
+	counted and is cleared whenever the parent releases the
+	property. When a property is shared between multiple parents
+	only the last one is notified.
+
+RETURN VALUE
+
+	CurrentGeneration() returns the last generation number assigned.
+
+	GetGeneration() and GetRemovalGeneration() return the generation
+	of the last modification and removal respectively. The removal
+	generation is zero when nothing was ever removed.
+
+SEE ALSO
+
+	moPropIO::SetDeltaGeneration
+
+*/
+moProp::generation_t moProp::CurrentGeneration(void)
+{
+	return g_generation.load();
+}
+
+
+void moProp::Touch(bool removal)
+{
+	generation_t generation = next_generation();
+
+	for(moProp *p = this; p != 0; p = p->f_parent) {
+		raise_generation(p->f_generation, generation);
+		if(removal) {
+			raise_generation(p->f_removal_generation, generation);
+		}
+	}
+}
+
+
+void moProp::Freeze(void)
+{
+	f_frozen = true;
+}
+
+
+void moProp::ThrowFrozen(void) const
+{
+	throw moError("moProp: property \"%s\" is part of a snapshot and cannot be modified", moNamePool::GetNamePool().Get(f_name).c_str());
+}
+
+
+void moProp::SetParent(moProp *parent)
+{
+	f_parent = parent;
+}
+
+
+void moProp::ClearParent(const moProp *parent)
+{
+	if(f_parent == parent) {
+		f_parent = 0;
+	}
+}
+
+
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -1066,20 +1461,24 @@ const char *moPropBag::moGetClassName(void) const
 
 
 moPropBag::moPropBag(mo_name_t name)
-	: moProp(name)
+	: moProp(name),
+	  f_snapshot(0)
 {
 }
 
 
 moPropBag::moPropBag(const moPropBag& bag, bool recursive)
-	: moProp(bag)
+	: moProp(bag),
+	  f_snapshot(0)
 {
 	moList::position_t	idx, max;
 
 	max = bag.Count();
 	if(recursive) {
 		for(idx = 0; idx < max; ++idx) {
-			f_props += *bag.f_props[idx].Duplicate();
+			moPropSPtr p = bag.f_props[idx].Duplicate();
+			p->SetParent(this);
+			f_props += *p;
 		}
 	}
 	else {
@@ -1090,6 +1489,22 @@ moPropBag::moPropBag(const moPropBag& bag, bool recursive)
 }
 
 
+moPropBag::~moPropBag()
+{
+	moList::position_t	idx, max;
+
+	moPropBag *snapshot = f_snapshot.load();
+	if(snapshot != 0) {
+		snapshot->Release();
+	}
+
+	max = f_props.Count();
+	for(idx = 0; idx < max; ++idx) {
+		f_props.Get(idx)->ClearParent(this);
+	}
+}
+
+
 void moPropBag::Copy(const moProp& prop)
 {
 	moList::position_t	idx, max;
@@ -1098,18 +1513,27 @@ void moPropBag::Copy(const moProp& prop)
 		return;
 	}
 
+	CheckWritable();
+
 	// lower level copy first
 	moProp::Copy(prop);
 
 	// in this case it's a total overwrite!
-	// (but for now it's not a recursive copy...)
-	f_props.Empty();
+	Empty();
 
+	// the copy is recursive: a property has a single parent
+	// so the Touch() of a modification reaches all the bags
+	// holding it (sharing would only dirty the last bag)
 	const moPropBag& bag = dynamic_cast<const moPropBag&>(prop);
+	moLockMutex lock(f_mutex);
+	moLockMutex bag_lock(bag.f_mutex);
 	max = bag.Count();
 	for(idx = 0; idx < max; ++idx) {
-		f_props += bag.f_props[idx];
+		moPropSPtr p = MergeDuplicate(*bag.f_props.Get(idx));
+		p->SetParent(this);
+		f_props += *p;
 	}
+	Touch(true);
 
 	return;
 }
@@ -1402,8 +1826,19 @@ SEE ALSO
 */
 moPropSPtr moPropBag::Get(int index_or_name) const
 {
+	// a snapshot cannot change, no need to lock it
+	if(IsFrozen()) {
+		return InternalGet(index_or_name);
+	}
+
 	moLockMutex lock(f_mutex);
 
+	return InternalGet(index_or_name);
+}
+
+
+moPropSPtr moPropBag::InternalGet(int index_or_name) const
+{
 	if(moNamePool::IsUser(index_or_name)) {
 		return &f_props[index_or_name];
 	}
@@ -1424,6 +1859,8 @@ moPropSPtr moPropBag::Get(int index_or_name) const
 
 bool moPropBag::Set(int index_or_name, const moProp& prop, bool overwrite)
 {
+	CheckWritable();
+
 	if(&prop == 0) {
 		throw moError("moPropBag::Set(): trying to add a null pointer property");
 	}
@@ -1460,7 +1897,10 @@ bool moPropBag::Set(int index_or_name, const moProp& prop, bool overwrite)
 	// of that type available
 	if(p == 0) {
 		// create new prop
-		f_props += *static_cast<moProp *>(prop.Duplicate());
+		moPropSPtr n = prop.Duplicate();
+		n->SetParent(this);
+		f_props += *n;
+		Touch();
 	}
 	else if(p->GetType() != prop.GetType()) {
 		if(p->IsTypeLocked()) {
@@ -1468,12 +1908,18 @@ bool moPropBag::Set(int index_or_name, const moProp& prop, bool overwrite)
 		}
 		// create a new prop with proper type
 		if(static_cast<moList::position_t>(index_or_name) != moList::NO_POSITION) {
+			p->ClearParent(this);
 			f_props.Delete(index_or_name);
 		}
-		f_props += * static_cast<moProp *>(prop.Duplicate());
+		moPropSPtr n = prop.Duplicate();
+		n->SetParent(this);
+		f_props += *n;
+		Touch();
 	}
 	else {
 		// just overwrite value of existing property
+		// (it touches itself and thus us if the value changes)
+		p->SetParent(this);
 		p->Copy(prop);
 	}
 
@@ -1484,6 +1930,8 @@ bool moPropBag::Set(int index_or_name, const moProp& prop, bool overwrite)
 
 void moPropBag::Delete(int index_or_name)
 {
+	CheckWritable();
+
 	moLockMutex	lock(f_mutex);
 
 	if(moNamePool::IsUser(index_or_name)) {
@@ -1502,12 +1950,176 @@ void moPropBag::Delete(int index_or_name)
 		throw moError("moPropBag::Delete(): invalid index or name, this looks more like an error number");
 	}
 
+	f_props.Get(index_or_name)->ClearParent(this);
 	f_props.Delete(index_or_name);
+	Touch(true);
 
 	return;
 }
 
 
+void moPropBag::Empty(void)
+{
+	moList::position_t	idx, max;
+
+	CheckWritable();
+
+	moLockMutex	lock(f_mutex);
+
+	max = f_props.Count();
+	if(max == 0) {
+		return;
+	}
+	for(idx = 0; idx < max; ++idx) {
+		f_props.Get(idx)->ClearParent(this);
+	}
+	f_props.Empty();
+	Touch(true);
+}
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPropBag
+
+NAME
+
+	Merge - update this bag with the content of another bag
+
+SYNOPSIS
+
+	void Merge(const moPropBag& bag, bool remove_missing = false);
+
+	private:
+	static moPropSPtr MergeDuplicate(const moProp& prop);
+
+PARAMETERS
+
+	bag - the bag with the new values
+	remove_missing - whether properties not found in bag get deleted
+
+DESCRIPTION
+
+	The Merge() function copies the values of the source bag in
+	this bag, recursively. Contrary to Copy() and Set(), the
+	existing sub-bags and arrays are kept and their content is
+	merged. Thus the properties which do not change value keep
+	their generation number and only the modified branches of
+	the tree are marked as modified (see moProp::Touch()).
+
+	When a property exists in both bags with a different type,
+	it is replaced whether its type is locked or not.
+
+	Properties which exist in this bag and not in the source bag
+	are kept unless remove_missing is true. With remove_missing
+	set to true, the function makes this bag equal to the source
+	bag; this is used to keep a long lived copy of a tree which is
+	regenerated on each save. With remove_missing set to false,
+	the source bag is applied over this bag; this is used to
+	load a delta over the main file.
+
+	The MergeDuplicate() function creates a deep copy of a
+	property so the new properties are not shared with the
+	source bag.
+
+SEE ALSO
+
+	moPropArray::Merge, moProp::Touch, Copy, Set
+
+*/
+moPropSPtr moPropBag::MergeDuplicate(const moProp& prop)
+{
+	switch(prop.GetType()) {
+	case MO_PROP_TYPE_PROP_BAG:
+	{
+		moPropBagSPtr bag = new moPropBag(prop.GetName());
+		bag->Merge(dynamic_cast<const moPropBag&>(prop));
+		return static_cast<moPropBag *>(bag);
+	}
+
+	case MO_PROP_TYPE_ARRAY:
+	{
+		const moPropArray& src = dynamic_cast<const moPropArray&>(prop);
+		moSmartPtr<moPropArray> array = new moPropArray(prop.GetName(), src.GetElementsType());
+		array->Merge(src);
+		return static_cast<moPropArray *>(array);
+	}
+
+	default:
+		return prop.Duplicate();
+
+	}
+}
+
+
+void moPropBag::Merge(const moPropBag& bag, bool remove_missing)
+{
+	moList::position_t	idx, max, pos;
+
+	if(this == &bag) {
+		return;
+	}
+
+	CheckWritable();
+
+	moLockMutex	lock(f_mutex);
+	moLockMutex	bag_lock(bag.f_mutex);
+
+	if(remove_missing) {
+		idx = f_props.Count();
+		while(idx > 0) {
+			--idx;
+			moProp *p = f_props.Get(idx);
+			moPropFind n(p->GetName());
+			if(bag.f_props.Find(&n) == moList::NO_POSITION) {
+				p->ClearParent(this);
+				f_props.Delete(idx);
+				Touch(true);
+			}
+		}
+	}
+
+	max = bag.f_props.Count();
+	for(idx = 0; idx < max; ++idx) {
+		const moProp *src = bag.f_props.Get(idx);
+		moPropFind n(src->GetName());
+		pos = f_props.Find(&n);
+		if(pos != moList::NO_POSITION) {
+			moProp *p = f_props.Get(pos);
+			if(p->GetType() == src->GetType()) {
+				p->SetParent(this);
+				switch(p->GetType()) {
+				case MO_PROP_TYPE_PROP_BAG:
+					dynamic_cast<moPropBag *>(p)->Merge(dynamic_cast<const moPropBag&>(*src), remove_missing);
+					break;
+
+				case MO_PROP_TYPE_ARRAY:
+					dynamic_cast<moPropArray *>(p)->Merge(dynamic_cast<const moPropArray&>(*src), remove_missing);
+					break;
+
+				default:
+					p->Copy(*src);
+					break;
+
+				}
+				continue;
+			}
+			p->ClearParent(this);
+			f_props.Delete(pos);
+		}
+		moPropSPtr d = MergeDuplicate(*src);
+		d->SetParent(this);
+		f_props += *d;
+		Touch();
+	}
+}
+
+
 
 
 
@@ -1515,109 +2127,515 @@ void moPropBag::Delete(int index_or_name)
 
 CLASS
 
+	moPropBag
+
+NAME
+
+	Snapshot - get an immutable copy of this bag
+	IsFrozen - check whether a property is part of a snapshot
+
+SYNOPSIS
+
+	moSmartPtr<moPropBag> Snapshot(void) const;
+	bool IsFrozen(void) const;
+
 	private:
-	moPropArray::moItem
+	static moPropSPtr SnapshotDuplicate(const moProp& prop,
+		const moProp *previous, generation_t previous_generation);
+	virtual void Freeze(void);
+
+DESCRIPTION
+
+	The Snapshot() function returns a copy of this bag which is
+	frozen: it and all the properties it holds cannot be modified
+	anymore (the functions modifying a property throw an moError
+	when called on a frozen property). Because a snapshot cannot
+	change, reading it does not require any lock. Reading a large
+	tree from a snapshot thus costs one copy instead of one mutex
+	round trip per property read, and a background thread (i.e. a
+	saver) gets a consistent view of the tree without blocking the
+	threads modifying it.
+
+	The bag keeps the last snapshot it created. A snapshot has the
+	generation this bag had when it was taken (see moProp::Touch())
+	so as long as this bag is not modified, Snapshot() returns that
+	same snapshot. Reading it is lock free: the pointer is loaded
+	atomically while the thread is counted as a reader of the
+	current epoch.
+
+	Once a modification happens, the next call creates a new
+	version with SnapshotDuplicate(). The properties which were not
+	modified since the previous version (their generation is not
+	larger than the generation of that version) are frozen already
+	and shared with it; only the modified branches get copied,
+	each value being read under the lock of its property. The
+	generation of this bag is checked before and after the copy
+	and a copy which was modified meanwhile is never returned; the
+	next attempt shares what that copy got, so it only copies what
+	changed in the meantime. When the writers keep winning, the
+	previous version is returned instead (it is older, but it is
+	consistent.) The very first version is attempted until it
+	succeeds.
+
+	The new version is published by swapping the pointer. The
+	older version is released once the readers of the current
+	epoch are gone; a reader which started after the swap can
+	only see the new pointer. The readers holding the older
+	version keep it alive with their smart pointer (the reference
+	counters are atomic).
+
+	Generations only grow, so a bag never appears older than one
+	of its properties. Because the generation of a property only
+	reaches the bags of its parent chain, the properties of a bag
+	are not shared with other live bags (see Copy()).
+
+	Calling Snapshot() on a snapshot returns the snapshot itself.
+
+	The IsFrozen() function returns true when the property is
+	part of a snapshot.
+
+RETURN VALUE
+
+	Snapshot() returns a smart pointer to the frozen copy.
+
+SEE ALSO
+
+	moPropBagRef::Snapshot, moProp::Touch, Merge
+
+*/
+namespace
+{
+// the snapshot readers count themselves in the counter of the
+// current epoch while they load the snapshot pointer of a bag
+std::atomic<unsigned long>	g_snapshot_epoch(0);
+std::atomic<unsigned long>	g_snapshot_readers[2] = { {0}, {0} };
+moMutex				g_snapshot_epoch_mutex;
+
+class moSnapshotReader
+{
+public:
+	moSnapshotReader(void)
+	{
+		for(;;) {
+			f_epoch = g_snapshot_epoch.load() & 1;
+			++g_snapshot_readers[f_epoch];
+			if((g_snapshot_epoch.load() & 1) == f_epoch) {
+				break;
+			}
+			// the epoch changed meanwhile, count ourself in the new one
+			--g_snapshot_readers[f_epoch];
+		}
+	}
+
+	~moSnapshotReader()
+	{
+		--g_snapshot_readers[f_epoch];
+	}
+
+	// wait until the readers which may have loaded a pointer
+	// which was just replaced are gone
+	static void WaitForReaders(void)
+	{
+		moLockMutex lock(g_snapshot_epoch_mutex);
+
+		const unsigned long epoch = g_snapshot_epoch++ & 1;
+		while(g_snapshot_readers[epoch].load() != 0) {
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	unsigned long		f_epoch;
+};
+}		// no name namespace
+
+
+moPropSPtr moPropBag::SnapshotDuplicate(const moProp& prop, const moProp *previous, generation_t previous_generation)
+{
+	if(previous != 0
+	&& previous->GetType() == prop.GetType()
+	&& prop.GetGeneration() <= previous_generation) {
+		// not modified since the previous version
+		return const_cast<moProp *>(previous);
+	}
+
+	if(prop.GetType() != MO_PROP_TYPE_PROP_BAG) {
+		return MergeDuplicate(prop);
+	}
+
+	const moPropBag& bag = dynamic_cast<const moPropBag&>(prop);
+	const moPropBag *previous_bag = dynamic_cast<const moPropBag *>(previous);
+	moPropBagSPtr copy = new moPropBag(bag.GetName());
+
+	moList::position_t	idx, max, pos;
+
+	moLockMutex lock(bag.f_mutex);
+
+	max = bag.f_props.Count();
+	for(idx = 0; idx < max; ++idx) {
+		const moProp *src = bag.f_props.Get(idx);
+		const moProp *old = 0;
+		if(previous_bag != 0) {
+			moPropFind n(src->GetName());
+			pos = previous_bag->f_props.Find(&n);
+			if(pos != moList::NO_POSITION) {
+				old = previous_bag->f_props.Get(pos);
+			}
+		}
+		moPropSPtr p = SnapshotDuplicate(*src, old, previous_generation);
+		if(!p->IsFrozen()) {
+			// shared properties keep their first parent
+			p->SetParent(copy);
+		}
+		copy->f_props += *p;
+	}
+
+	return static_cast<moPropBag *>(copy);
+}
+
+
+moSmartPtr<moPropBag> moPropBag::Snapshot(void) const
+{
+	if(IsFrozen()) {
+		return const_cast<moPropBag *>(this);
+	}
+
+	{
+		moSnapshotReader reader;
+		moPropBag *snapshot = f_snapshot.load();
+		if(snapshot != 0 && snapshot->GetGeneration() == GetGeneration()) {
+			return snapshot;
+		}
+	}
+
+	// one new version at a time; f_snapshot does not change
+	// unless we hold this mutex
+	moLockMutex lock(f_snapshot_mutex);
+
+	moSmartPtr<moPropBag> previous(f_snapshot.load());
+	if(previous != 0 && previous->GetGeneration() == GetGeneration()) {
+		return previous;
+	}
+
+	const int max_attempts = 5;
+	moSmartPtr<moPropBag> copy;
+	moSmartPtr<moPropBag> base(previous);
+	for(int attempt = 0; copy == 0; ++attempt) {
+		if(attempt >= max_attempts && previous != 0) {
+			// too busy, the previous version is still consistent
+			return previous;
+		}
+		if(attempt > 0) {
+			std::this_thread::yield();
+		}
+		const generation_t generation = GetGeneration();
+		moPropSPtr p = SnapshotDuplicate(*this, base, base != 0 ? base->GetGeneration() : 0);
+		moSmartPtr<moPropBag> candidate = dynamic_cast<moPropBag *>(static_cast<moProp *>(p));
+		candidate->Freeze();
+		candidate->f_generation = generation;
+		if(GetGeneration() == generation) {
+			copy = candidate;
+		}
+		else {
+			base = candidate;
+		}
+	}
+
+	// publish the new version
+	copy->AddRef();
+	moPropBag *old = f_snapshot.exchange(copy);
+	if(old != 0) {
+		moSnapshotReader::WaitForReaders();
+		old->Release();
+	}
+
+	return copy;
+}
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPropBag
+
+NAME
+
+	Pack -- pack the arrays of this bag
+
+SYNOPSIS
+
+	void Pack(void);
+
+DESCRIPTION
+
+	The Pack() function calls moPropArray::Pack() on all the
+	arrays found in this bag and its sub-bags. The properties
+	of the bag itself are not modified.
+
+SEE ALSO
+
+	moPropArray::Pack
+
+*/
+void moPropBag::Pack(void)
+{
+	moList::position_t	idx, max;
+
+	if(IsFrozen()) {
+		return;
+	}
+
+	moLockMutex lock(f_mutex);
+
+	max = f_props.Count();
+	for(idx = 0; idx < max; ++idx) {
+		moProp *p = f_props.Get(idx);
+		switch(p->GetType()) {
+		case MO_PROP_TYPE_PROP_BAG:
+			dynamic_cast<moPropBag *>(p)->Pack();
+			break;
+
+		case MO_PROP_TYPE_ARRAY:
+			dynamic_cast<moPropArray *>(p)->Pack();
+			break;
+
+		default:
+			break;
+
+		}
+	}
+}
+
+
+void moPropBag::Freeze(void)
+{
+	moList::position_t	idx, max;
+
+	// properties shared with an older snapshot are already frozen
+	if(IsFrozen()) {
+		return;
+	}
+
+	moProp::Freeze();
+
+	max = f_props.Count();
+	for(idx = 0; idx < max; ++idx) {
+		f_props.Get(idx)->Freeze();
+	}
+}
+
+
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	private:
+	moPropArray::slot_t
 
 NAME
 
-	moItem -- constructor which initializes an moItem
-	Compare -- compare two items by item number
-	operator = -- copy an item in another with the same number
-	GetItemNo -- get the item number
-	Get -- get the item property
+	FindSlot -- search the slot of an item number
+	SlotProp -- get the property of a slot, creating it if packed
+	PackSlot -- replace the property of a slot by its value
 
 SYNOPSIS
 
 	private:
-	moItem(int item_no, const moProp *prop);
-	virtual compare_t Compare(const moBase& object) const;
-	moItem& operator = (const moItem& item);
-	int GetItemNo(void) const;
-	moPropSPtr Get(void) const;
+	slots_t::size_type FindSlot(int item_no, bool& found) const;
+	moPropSPtr SlotProp(slots_t::size_type pos) const;
+	bool PackSlot(slot_t& slot) const;
 
 PARAMETERS
 
-	item_no - this item number
-	prop - this item property
-	object - another item
-	item - another item
+	item_no - the item number to search
+	found - set to true when the item number exists
+	pos - the position of the slot
+	slot - the slot to pack
+
+DESCRIPTION
+
+	An array defines a vector of slots sorted by item number.
+	A slot either holds a pointer to a property, or, for the
+	simple numeric types (int, long long, float and double),
+	the value and name of the property which then does not
+	exist as an object. A packed integer uses the size of a
+	slot instead of a complete moProp object (mutexes, list
+	of handlers, etc.) and an moItem.
+
+	The FindSlot() function runs a binary search and returns
+	the position of the item or where it would be inserted.
+
+	The SlotProp() function returns the property of a slot.
+	A packed slot gets its property created at that time with
+	the generation of the array (the item may have been
+	modified at that time, never later). Since the caller may
+	keep the property and modify it, the property stays in the
+	slot. The item created by the previous call is packed back
+	if nobody else kept it so enumerating a large array does
+	not recreate all of its objects.
+
+	The PackSlot() function replaces the property of the slot
+	by its value if the slot is the only reference to that
+	property (no smart pointer, reference or handler) and the
+	property is of a simple numeric type.
+
+RETURN VALUES
+
+	FindSlot() returns a position between 0 and the number of
+	slots inclusive
+
+	SlotProp() returns a smart pointer to the property
+
+	PackSlot() returns true if the slot is now packed
+
+SEE ALSO
+
+	Pack, Get, GetAtIndex
+
+*/
+namespace
+{
+const size_t	NO_SLOT = static_cast<size_t>(-1);
+}		// no name namespace
+
+
+moPropArray::slots_t::size_type moPropArray::FindSlot(int item_no, bool& found) const
+{
+	slots_t::size_type lo = 0;
+	slots_t::size_type hi = f_slots.size();
+
+	// items are most often appended
+	if(hi > 0 && f_slots[hi - 1].f_item_no < item_no) {
+		lo = hi;
+	}
+
+	while(lo < hi) {
+		slots_t::size_type mid = lo + (hi - lo) / 2;
+		if(f_slots[mid].f_item_no < item_no) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
 
-DESCRIPTION
+	found = lo < f_slots.size() && f_slots[lo].f_item_no == item_no;
 
-	An array defines a list of properties internally. This list
-	has items named moItem. These items are sorted using their
-	item number (item_no) and they hold a pointer to a property.
+	return lo;
+}
 
-	The type of the property held by an array item can be
-	anything.
 
-RETURN VALUES
+moPropSPtr moPropArray::SlotProp(slots_t::size_type pos) const
+{
+	slot_t& slot = f_slots[pos];
+	if(!slot.IsPacked()) {
+		return slot.Prop();
+	}
 
-	The Compare() returns one of the moBase compare values
-	comparing the item number of the two specified items.
+	if(f_last_materialized < f_slots.size()
+	&& f_last_materialized != pos) {
+		PackSlot(f_slots[f_last_materialized]);
+	}
 
-	The copy operator return a reference to this item.
+	moPropSPtr p;
+	switch(slot.f_type) {
+	case MO_PROP_TYPE_INT:
+	{
+		moPropInt *v = new moPropInt(slot.f_name);
+		p = v;
+		v->Set(slot.f_value.f_int);
+	}
+		break;
 
-	The GetItemNo() function returns the item number which is
-	the one used to sort the items in the array.
+	case MO_PROP_TYPE_LONG_LONG:
+	{
+		moPropLongLong *v = new moPropLongLong(slot.f_name);
+		p = v;
+		v->Set(slot.f_value.f_long_long);
+	}
+		break;
 
-	The Get() returns a smart pointer to the property saved
-	in this item.
+	case MO_PROP_TYPE_FLOAT:
+	{
+		moPropFloat *v = new moPropFloat(slot.f_name);
+		p = v;
+		v->Set(slot.f_value.f_float);
+	}
+		break;
 
-BUGS
+	case MO_PROP_TYPE_DOUBLE:
+	{
+		moPropDouble *v = new moPropDouble(slot.f_name);
+		p = v;
+		v->Set(slot.f_value.f_double);
+	}
+		break;
 
-	This class is private mainly for safety. It would be nice
-	if we could return an item to the end user to use directly.
+	default:
+		throw moError("moPropArray::SlotProp(): invalid packed type %d", slot.f_type);
 
-SEE ALSO
+	}
 
-	moPropArray class
+	p->f_generation = f_generation.load();
+	p->SetParent(const_cast<moPropArray *>(this));
+	slot.SetProp(p);
+	f_last_materialized = pos;
 
-*/
-moPropArray::moItem::moItem(int item_no, const moProp *prop)
-	: f_item_no(item_no),
-	  f_prop(const_cast<moProp *>(prop))
-{
+	return p;
 }
 
 
-moPropArray::moItem::~moItem()
+bool moPropArray::PackSlot(slot_t& slot) const
 {
-}
-
+	if(slot.IsPacked()) {
+		return true;
+	}
 
-const char *moPropArray::moItem::moGetClassName(void) const
-{
-	return "moBase::moProp::moPropArray.moBase::moItem";
-}
+	moProp *p = slot.Prop();
+	if(p == 0
+	|| p->ReferenceCount() != 1
+	|| p->IsFrozen()
+	|| !p->IsTypeLocked()) {
+		return false;
+	}
 
+	slot_t packed;
+	switch(p->GetType()) {
+	case MO_PROP_TYPE_INT:
+		packed.f_value.f_int = dynamic_cast<const moPropInt&>(*p).Get();
+		break;
 
-moBase::compare_t moPropArray::moItem::Compare(const moBase& object) const
-{
-	const moItem& item = static_cast<const moItem&>(object);
-	return CompareInt(f_item_no, item.f_item_no);
-}
+	case MO_PROP_TYPE_LONG_LONG:
+		packed.f_value.f_long_long = dynamic_cast<const moPropLongLong&>(*p).Get();
+		break;
 
+	case MO_PROP_TYPE_FLOAT:
+		packed.f_value.f_float = dynamic_cast<const moPropFloat&>(*p).Get();
+		break;
 
-moPropArray::moItem& moPropArray::moItem::operator = (const moItem& item)
-{
-	if(f_item_no != item.f_item_no) {
-		throw moError("moPropArray::moItem::operator = (): only expects items with the same item number.");
-	}
-	f_prop = item.f_prop;
-	return *this;
-}
+	case MO_PROP_TYPE_DOUBLE:
+		packed.f_value.f_double = dynamic_cast<const moPropDouble&>(*p).Get();
+		break;
 
+	default:
+		return false;
 
-int moPropArray::moItem::GetItemNo(void) const
-{
-	return f_item_no;
-}
+	}
+	packed.f_type = static_cast<unsigned char>(p->GetType());
+	packed.f_item_no = slot.f_item_no;
+	packed.f_name = p->GetName();
 
+	// this releases (deletes) the property
+	p->ClearParent(this);
+	slot = packed;
 
-moPropSPtr moPropArray::moItem::Get(void) const
-{
-	return const_cast<moProp *>(static_cast<const moProp *>(f_prop));
+	return true;
 }
 
 
@@ -1667,6 +2685,7 @@ SEE ALSO
 */
 moPropArray::moPropArray(mo_name_t name, moProp::prop_type_t type)
 	: moProp(name),
+	  f_last_materialized(NO_SLOT),
 	  f_type(type)
 {
 }
@@ -1674,6 +2693,12 @@ moPropArray::moPropArray(mo_name_t name, moProp::prop_type_t type)
 
 moPropArray::~moPropArray()
 {
+	slots_t::iterator it;
+	for(it = f_slots.begin(); it != f_slots.end(); ++it) {
+		if(it->Prop() != 0) {
+			it->Prop()->ClearParent(this);
+		}
+	}
 }
 
 
@@ -1776,25 +2801,39 @@ void moPropArray::Copy(const moProp& prop)
 		return;
 	}
 
+	CheckWritable();
+
 	moProp::Copy(prop);
 
 	// we want a complete overwrite
 	Empty();
 
 	const moPropArray& object = dynamic_cast<const moPropArray&>(prop);
-	moList::position_t idx, max;
 	if(f_type == MO_PROP_TYPE_UNKNOWN
 	|| f_type == object.f_type) {
-		f_array = object.f_array;
+		// packed items are copied, the others are duplicated
+		// so each property keeps a single parent
+		moLockMutex lock(object.f_mutex);
+		f_slots = object.f_slots;
+		f_last_materialized = NO_SLOT;
+		slots_t::iterator it;
+		for(it = f_slots.begin(); it != f_slots.end(); ++it) {
+			if(it->Prop() != 0) {
+				moPropSPtr p = moPropBag::MergeDuplicate(*it->Prop());
+				p->SetParent(this);
+				it->SetProp(p);
+			}
+		}
 	}
 	else {
 		// in this case we want all the types to be checked
-		max = object.f_array.Count();
+		unsigned long idx, max;
+		max = object.CountIndexes();
 		for(idx = 0; idx < max; ++idx) {
-			moItem *item = object.f_array.Get(idx);
-			Set(item->GetItemNo(), item->Get());
+			Set(object.ItemNoAtIndex(idx), object.GetAtIndex(idx));
 		}
 	}
+	Touch(true);
 }
 
 
@@ -1806,6 +2845,26 @@ moPropSPtr moPropArray::Duplicate(void) const
 }
 
 
+void moPropArray::Freeze(void)
+{
+	slots_t::size_type	pos, max;
+
+	if(IsFrozen()) {
+		return;
+	}
+
+	moProp::Freeze();
+
+	// frozen arrays are read without locks so all the items
+	// are created now (frozen items never get packed back)
+	max = f_slots.size();
+	for(pos = 0; pos < max; ++pos) {
+		SlotProp(pos)->Freeze();
+	}
+	f_last_materialized = NO_SLOT;
+}
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -1845,6 +2904,13 @@ DESCRIPTION
 	The Delete() function searches for the specified item number
 	and deletes it.
 
+	The Get() function may create the property object of an item
+	which was packed (see Pack()). The Set() function never packs
+	the specified property; it is shared with the caller. When the
+	property already belongs to another bag or array, a copy is
+	saved instead since a property can only have one parent (the
+	one its modifications mark as modified, see moProp::Touch()).
+
 	Note that all of these operations use the item number and
 	not an index. This enables you to create arrays of items
 	with holes and yet not use huge amounts of memory. The
@@ -1888,55 +2954,243 @@ SEE ALSO
 */
 void moPropArray::Empty(void)
 {
-	f_array.Empty();
+	CheckWritable();
+
+	moLockMutex lock(f_mutex);
+	if(f_slots.empty()) {
+		return;
+	}
+	slots_t::iterator it;
+	for(it = f_slots.begin(); it != f_slots.end(); ++it) {
+		if(it->Prop() != 0) {
+			it->Prop()->ClearParent(this);
+		}
+	}
+	f_slots.clear();
+	f_last_materialized = NO_SLOT;
+	Touch(true);
 }
 
 
 moPropSPtr moPropArray::Get(int item_no) const
 {
-	moItem item(item_no, 0);
-	moList::position_t pos = f_array.Find(&item);
-	if(pos == moList::NO_POSITION) {
+	bool found;
+
+	if(IsFrozen()) {
+		// all the items of a frozen array exist
+		slots_t::size_type pos = FindSlot(item_no, found);
+		return found ? f_slots[pos].Prop() : 0;
+	}
+
+	moLockMutex lock(f_mutex);
+	slots_t::size_type pos = FindSlot(item_no, found);
+	if(!found) {
 		return 0;
 	}
-	return f_array.Get(pos)->Get();
+	return SlotProp(pos);
 }
 
 
 bool moPropArray::Set(int item_no, const moProp *prop)
 {
+	CheckWritable();
+
 	if(f_type != MO_PROP_TYPE_UNKNOWN
 	&& f_type != prop->GetType()) {
 		throw moError("moPropArray::Set(): expected type %d, received %d", f_type, prop->GetType());
 	}
 
-	moItem item(item_no, prop);
-	moList::position_t pos = f_array.Find(&item);
-	if(pos == moList::NO_POSITION) {
-		moItemSPtr item = new moItem(item_no, prop);
-		f_array += item;
+	moLockMutex lock(f_mutex);
+
+	moPropSPtr item(ItemProp(prop));
+	item->SetParent(this);
+	Touch();
+
+	bool found;
+	slots_t::size_type pos = FindSlot(item_no, found);
+	if(!found) {
+		slot_t slot;
+		slot.f_item_no = item_no;
+		slot.f_name = item->GetName();
+		slot.SetProp(item);
+		f_slots.insert(f_slots.begin() + pos, slot);
+		f_last_materialized = NO_SLOT;
 		return true;
 	}
 
-	*f_array.Get(pos) = item;
+	slot_t& old = f_slots[pos];
+	if(old.Prop() != 0 && old.Prop() != static_cast<moProp *>(item)) {
+		old.Prop()->ClearParent(this);
+	}
+	old.f_name = item->GetName();
+	old.SetProp(item);
 
 	return false;
 }
 
 
+moPropSPtr moPropArray::ItemProp(const moProp *prop) const
+{
+	if(prop->f_parent != 0 && prop->f_parent != this) {
+		// a property has a single parent
+		return moPropBag::MergeDuplicate(*prop);
+	}
+	return const_cast<moProp *>(prop);
+}
+
+
 bool moPropArray::Delete(int item_no)
 {
-	moItem item(item_no, 0);
-	moList::position_t pos = f_array.Find(&item);
-	if(pos != moList::NO_POSITION) {
-		f_array.Delete(pos);
-		return true;
+	CheckWritable();
+
+	moLockMutex lock(f_mutex);
+
+	bool found;
+	slots_t::size_type pos = FindSlot(item_no, found);
+	if(found) {
+		return DeleteAtIndex(static_cast<int>(pos));
 	}
 
 	return false;
 }
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moPropArray
+
+NAME
+
+	Merge -- update this array with the items of another array
+
+SYNOPSIS
+
+	void Merge(const moPropArray& array, bool remove_missing = false);
+
+PARAMETERS
+
+	array - the array with the new items
+	remove_missing - whether items not found in array get deleted
+
+DESCRIPTION
+
+	The Merge() function works like the moPropBag::Merge()
+	function using the item numbers instead of the names.
+	Existing bags and arrays are merged recursively, other
+	items get their value copied so only the modified items
+	are marked as modified.
+
+	The items of the source array are not shared with this
+	array; new items are deep copies.
+
+ERRORS
+
+	If the source array includes properties which aren't
+	compatible with this array, then the function throws an
+	exception.
+
+SEE ALSO
+
+	moPropBag::Merge, Copy, Set
+
+*/
+void moPropArray::Merge(const moPropArray& array, bool remove_missing)
+{
+	slots_t::size_type idx, max, pos;
+	bool found;
+
+	if(this == &array) {
+		return;
+	}
+
+	CheckWritable();
+
+	moLockMutex lock(f_mutex);
+	moLockMutex array_lock(array.f_mutex);
+
+	if(remove_missing) {
+		idx = f_slots.size();
+		while(idx > 0) {
+			--idx;
+			array.FindSlot(f_slots[idx].f_item_no, found);
+			if(!found) {
+				DeleteAtIndex(static_cast<int>(idx));
+			}
+		}
+	}
+
+	max = array.f_slots.size();
+	for(idx = 0; idx < max; ++idx) {
+		const slot_t& src = array.f_slots[idx];
+		const int item_no = src.f_item_no;
+		pos = FindSlot(item_no, found);
+		if(src.IsPacked()) {
+			// packed values are merged without creating objects
+			if(!found) {
+				f_slots.insert(f_slots.begin() + pos, src);
+				f_last_materialized = NO_SLOT;
+				Touch();
+				continue;
+			}
+			slot_t& dst = f_slots[pos];
+			if(dst.IsPacked() && dst.f_type == src.f_type) {
+				bool same;
+				switch(src.f_type) {
+				case MO_PROP_TYPE_INT:
+					same = dst.f_value.f_int == src.f_value.f_int;
+					break;
+
+				case MO_PROP_TYPE_LONG_LONG:
+					same = dst.f_value.f_long_long == src.f_value.f_long_long;
+					break;
+
+				case MO_PROP_TYPE_FLOAT:
+					same = dst.f_value.f_float == src.f_value.f_float;
+					break;
+
+				default:
+					same = dst.f_value.f_double == src.f_value.f_double;
+					break;
+
+				}
+				if(!same) {
+					dst.f_value = src.f_value;
+					Touch();
+				}
+				dst.f_name = src.f_name;
+				continue;
+			}
+		}
+		moPropSPtr src_prop = array.SlotProp(idx);
+		if(found) {
+			moPropSPtr p = SlotProp(pos);
+			if(p->GetType() == src_prop->GetType()) {
+				p->SetParent(this);
+				switch(p->GetType()) {
+				case MO_PROP_TYPE_PROP_BAG:
+					dynamic_cast<moPropBag&>(*p).Merge(dynamic_cast<const moPropBag&>(*src_prop), remove_missing);
+					break;
+
+				case MO_PROP_TYPE_ARRAY:
+					dynamic_cast<moPropArray&>(*p).Merge(dynamic_cast<const moPropArray&>(*src_prop), remove_missing);
+					break;
+
+				default:
+					p->Copy(*src_prop);
+					break;
+
+				}
+				continue;
+			}
+		}
+		moPropSPtr d = moPropBag::MergeDuplicate(*src_prop);
+		Set(item_no, d);
+	}
+}
+
+
 
 
 /************************************************************ DOC:
@@ -2031,48 +3285,72 @@ SEE ALSO
 */
 unsigned long moPropArray::CountIndexes(void) const
 {
-	return f_array.Count();
+	return f_slots.size();
 }
 
 
 int moPropArray::ItemNoAtIndex(int index) const
 {
-	if((uint32_t) index >= f_array.Count()) {
+	if((uint32_t) index >= f_slots.size()) {
 		// invalid index
 		throw moError("moPropArray::Item(): trying to get an item with an invalid index of %d", index);
 	}
-	return f_array.Get(index)->GetItemNo();
+	return f_slots[index].f_item_no;
 }
 
 
 moPropSPtr moPropArray::GetAtIndex(int index) const
 {
-	if((uint32_t) index >= f_array.Count()) {
+	if((uint32_t) index >= f_slots.size()) {
 		return 0;
 	}
-	return f_array.Get(index)->Get();
+	if(IsFrozen()) {
+		return f_slots[index].Prop();
+	}
+
+	moLockMutex lock(f_mutex);
+	return SlotProp(index);
 }
 
 
 void moPropArray::SetAtIndex(int index, const moProp *prop)
 {
-	if((uint32_t) index >= f_array.Count()) {
+	CheckWritable();
+
+	moLockMutex lock(f_mutex);
+
+	if((uint32_t) index >= f_slots.size()) {
 		throw moError("moPropArray::Replace(): no item defined at index %d", index);
 	}
 	if(f_type != MO_PROP_TYPE_UNKNOWN
 	&& f_type != prop->GetType()) {
 		throw moError("moPropArray::SetAtIndex(): expected type %d, recevied %d", f_type, prop->GetType());
 	}
-	moItemSPtr item = f_array.Get(index);
-	moItem new_item(item->GetItemNo(), prop);
-	*item = new_item;
+	moPropSPtr item(ItemProp(prop));
+	slot_t& slot = f_slots[index];
+	if(slot.Prop() != 0 && slot.Prop() != static_cast<moProp *>(item)) {
+		slot.Prop()->ClearParent(this);
+	}
+	item->SetParent(this);
+	slot.f_name = item->GetName();
+	slot.SetProp(item);
+	Touch();
 }
 
 
 bool moPropArray::DeleteAtIndex(int index)
 {
-	if((uint32_t) index < f_array.Count()) {
-		f_array.Delete(index);
+	CheckWritable();
+
+	moLockMutex lock(f_mutex);
+
+	if((uint32_t) index < f_slots.size()) {
+		if(f_slots[index].Prop() != 0) {
+			f_slots[index].Prop()->ClearParent(this);
+		}
+		f_slots.erase(f_slots.begin() + index);
+		f_last_materialized = NO_SLOT;
+		Touch(true);
 		return true;
 	}
 
@@ -2082,6 +3360,101 @@ bool moPropArray::DeleteAtIndex(int index)
 
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moPropArray
+
+NAME
+
+	Pack -- pack the items nobody references
+	CountPacked -- count the items currently packed
+
+SYNOPSIS
+
+	void Pack(void);
+	unsigned long CountPacked(void) const;
+
+DESCRIPTION
+
+	The Pack() function replaces the int, long long, float and
+	double items which are only referenced by this array by
+	their value. Such an item costs a few bytes instead of a
+	complete property object. The property object is created
+	again the next time the item is accessed. The items of the
+	sub-arrays and sub-bags of this array are packed too.
+
+	Items which are referenced by a smart pointer, a property
+	reference or which have a handler are never packed. Note
+	that a bare pointer to an item is not a reference; it is
+	invalid once the array is packed.
+
+	The moPropIO::Load() function packs the bags it loads.
+
+	The CountPacked() function returns the number of items
+	which are packed in this array (not counting sub-arrays).
+
+RETURN VALUE
+
+	CountPacked() returns a number between 0 and CountIndexes()
+
+SEE ALSO
+
+	moPropBag::Pack, Get, GetAtIndex
+
+*/
+void moPropArray::Pack(void)
+{
+	if(IsFrozen()) {
+		return;
+	}
+
+	moLockMutex lock(f_mutex);
+
+	slots_t::iterator it;
+	for(it = f_slots.begin(); it != f_slots.end(); ++it) {
+		if(PackSlot(*it)) {
+			continue;
+		}
+		switch(it->Prop()->GetType()) {
+		case MO_PROP_TYPE_PROP_BAG:
+			dynamic_cast<moPropBag *>(it->Prop())->Pack();
+			break;
+
+		case MO_PROP_TYPE_ARRAY:
+			dynamic_cast<moPropArray *>(it->Prop())->Pack();
+			break;
+
+		default:
+			break;
+
+		}
+	}
+	f_last_materialized = NO_SLOT;
+}
+
+
+unsigned long moPropArray::CountPacked(void) const
+{
+	unsigned long		count;
+
+	moLockMutex lock(f_mutex);
+
+	count = 0;
+	slots_t::const_iterator it;
+	for(it = f_slots.begin(); it != f_slots.end(); ++it) {
+		if(it->IsPacked()) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+
+
+
 
 
 
@@ -2459,6 +3832,13 @@ void moPropBagRef::NewProp(void)
 }
 
 
+moPropBagRef moPropBagRef::Snapshot(void) const
+{
+	moPropBagSPtr snapshot = PropBag().Snapshot();
+	return moPropBagRef(moPropRef(0, snapshot));
+}
+
+
 void moPropBagRef::Empty(void)
 {
 	PropBag().Empty();
@@ -3612,6 +4992,58 @@ void moPropIO::SetSavePointers(bool save_pointers)
 
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moPropIO
+
+NAME
+
+	SetDeltaGeneration - only save what changed since a generation
+	GetDeltaGeneration - get the current delta generation
+
+SYNOPSIS
+
+	void SetDeltaGeneration(moProp::generation_t generation = 0);
+	moProp::generation_t GetDeltaGeneration(void) const;
+
+PARAMETERS
+
+	generation - the generation of the last complete save
+
+DESCRIPTION
+
+	By default the Save() function writes all the properties of
+	the bag. Once a delta generation is defined (not zero), the
+	InternalSave() implementations skip all the properties which
+	were not modified after that generation. Sub-bags and arrays
+	are written with only their modified children.
+
+	The result is a sparse bag which, once loaded, needs to be
+	applied over the complete bag with moPropBag::Merge().
+	Removed properties cannot be represented in a delta; check
+	the GetRemovalGeneration() of the bag and do a complete save
+	when it is larger than the delta generation.
+
+	The generation to use is the value returned by the
+	moProp::CurrentGeneration() function just before the last
+	complete save.
+
+SEE ALSO
+
+	moProp::Touch, moProp::CurrentGeneration, moPropBag::Merge
+
+*/
+void moPropIO::SetDeltaGeneration(moProp::generation_t generation)
+{
+	f_delta_generation = generation;
+}
+
+
+
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -3700,6 +5132,10 @@ int moPropIO::Load(moPropBagRef& prop_bag)
 		prop_bag.NewProp();
 	}
 
+	// the handlers are called once per property once the
+	// whole bag is loaded
+	moPropSignalBatch batch;
+
 	// call the user function
 	if(InternalLoad(prop_bag)) {
 		if(f_errno == 0) {
@@ -3709,6 +5145,9 @@ int moPropIO::Load(moPropBagRef& prop_bag)
 		return -1;
 	}
 
+	// loaded arrays of numbers are kept packed
+	dynamic_cast<moPropBag&>(*prop_bag.GetProperty()).Pack();
+
 	SetError(MO_ERROR_UNDEFINED);
 
 	return 0;
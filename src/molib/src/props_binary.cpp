@@ -0,0 +1,728 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+// 
+// All Rights Reserved.
+// 
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+// 
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+// 
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+
+
+
+#ifdef MO_PRAGMA_INTERFACE
+#pragma implementation "mo/mo_props_binary.h"
+#endif
+
+#include	"mo/mo_props_binary.h"
+
+#ifndef MO_MEMFILE_H
+#include	"mo/mo_memfile.h"
+#endif
+
+#include	<map>
+#include	<vector>
+
+
+namespace molib
+{
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPropIO_Binary
+
+NAME
+
+	Contructor - initialize the moPropIO_Binary object
+	moGetClassName - get the name of this class as a string
+
+SYNOPSIS
+
+	moPropIO_Binary(void);
+	virtual const char *moGetClassName(void) const;
+
+DESCRIPTION
+
+	The moPropIO_Binary object saves and loads property bags in a
+	compact binary format. It is much faster than the XML format
+	and it does not need any character conversion, which makes it
+	the format of choice for data which is saved very often such
+	as journal records. It is not meant to be edited by humans.
+
+	The format is defined as follows (all numbers are saved in
+	little endian):
+
+		"MOPB" <version:uchar> <name> <props>
+
+		<props>: { <type:uchar> <name> [<item:int32>] <value> } 0
+
+	The <item> number is only present for array items. The
+	<name> is a uint32; when the most significant bit is set,
+	the other bits represent the index of a name which was
+	already saved; otherwise it is the number of UTF-8 bytes
+	which follow and the name is added to the table of names.
+
+	The <value> depends on the type of the property: an int32
+	for integers, an int64 for long longs, a float, a double,
+	an int64 for pointers (only saved along their address when
+	SetSavePointers(true) was called, these cannot be reloaded),
+	a uint32 size followed by the UTF-8 bytes for strings, a
+	uint32 size followed by the data for binary buffers, the
+	<props> for a bag and <element type:uchar> followed by the
+	<props> for an array.
+
+	The delta generation (see moPropIO::SetDeltaGeneration())
+	is honored the same way as with the XML format.
+
+	The moGetClassName() function returns the name of this class.
+
+RETURN VALUE
+
+	The moGetClassName() function returns a string with the
+	name of this class.
+
+SEE ALSO
+
+	moPropIO_XML, moBinaryLoadPropBag, moBinarySavePropBag
+
+*/
+moPropIO_Binary::moPropIO_Binary(void)
+{
+}
+
+
+const char *moPropIO_Binary::moGetClassName(void) const
+{
+	return "molib::moBase::moPropIO::moPropIO_Binary";
+}
+
+
+
+namespace
+{
+
+const char		binary_magic[4] = { 'M', 'O', 'P', 'B' };
+const unsigned char	binary_version = 1;
+const uint32_t		binary_name_index = 0x80000000;
+
+
+
+class binary_save_t
+{
+public:
+	binary_save_t(moOStream& out, bool save_pointers, moProp::generation_t delta_generation)
+		: f_out(out),
+		  f_np(&moNamePool::GetNamePool()),
+		  f_save_pointers(save_pointers),
+		  f_delta_generation(delta_generation)
+	{
+	}
+
+	int SaveBag(const moPropBag& bag);
+	int SaveProp(const moProp& prop, bool array_item, int item_no);
+	int SaveName(mo_name_t name);
+	int SaveData(const void *data, unsigned long size);
+
+	bool Skip(const moProp *p) const
+	{
+		return f_delta_generation != 0 && p->GetGeneration() <= f_delta_generation;
+	}
+
+private:
+	typedef std::map<mo_name_t, uint32_t>	name_map_t;
+
+	moOStream&		f_out;
+	const moNamePoolSPtr	f_np;
+	bool			f_save_pointers;
+	moProp::generation_t	f_delta_generation;
+	name_map_t		f_names;
+	zint32_t		f_errcnt;
+};
+
+
+int binary_save_t::SaveName(mo_name_t name)
+{
+	name_map_t::const_iterator it(f_names.find(name));
+	if(it != f_names.end()) {
+		return f_out.Put(static_cast<uint32_t>(it->second | binary_name_index)) == sizeof(uint32_t) ? 0 : -1;
+	}
+
+	const uint32_t idx = static_cast<uint32_t>(f_names.size());
+	f_names[name] = idx;
+
+	const char *mb = f_np->Get(name).SavedMBData();
+	return SaveData(mb, static_cast<unsigned long>(strlen(mb)));
+}
+
+
+int binary_save_t::SaveData(const void *data, unsigned long size)
+{
+	if(f_out.Put(static_cast<uint32_t>(size)) != sizeof(uint32_t)) {
+		return -1;
+	}
+	if(size > 0 && f_out.Write(data, size) != static_cast<int>(size)) {
+		return -1;
+	}
+	return 0;
+}
+
+
+int binary_save_t::SaveBag(const moPropBag& bag)
+{
+	int		r;
+	unsigned long	idx, max;
+
+	r = 0;
+	max = bag.Count();
+	for(idx = 0; idx < max; ++idx) {
+		moPropSPtr p(bag.Get(static_cast<int>(idx)));
+		if(Skip(p)) {
+			continue;
+		}
+		if(SaveProp(*p, false, 0) != 0) {
+			r = -1;
+		}
+	}
+
+	if(f_out.Put(static_cast<unsigned char>(moProp::MO_PROP_TYPE_UNKNOWN)) != 1) {
+		r = -1;
+	}
+
+	return r;
+}
+
+
+int binary_save_t::SaveProp(const moProp& prop, bool array_item, int item_no)
+{
+	const moProp::prop_type_t type = prop.GetType();
+	if(type == moProp::MO_PROP_TYPE_POINTER && !f_save_pointers) {
+		return 0;
+	}
+
+	if(f_out.Put(static_cast<unsigned char>(type)) != 1
+	|| SaveName(prop.GetName()) != 0) {
+		return -1;
+	}
+	if(array_item) {
+		if(f_out.Put(static_cast<int32_t>(item_no)) != sizeof(int32_t)) {
+			return -1;
+		}
+	}
+
+	switch(type) {
+	case moProp::MO_PROP_TYPE_PROP_BAG:
+		return SaveBag(dynamic_cast<const moPropBag&>(prop));
+
+	case moProp::MO_PROP_TYPE_INT:
+		return f_out.Put(static_cast<int32_t>(dynamic_cast<const moPropInt&>(prop).Get())) == sizeof(int32_t) ? 0 : -1;
+
+	case moProp::MO_PROP_TYPE_LONG_LONG:
+		return f_out.Put(static_cast<int64_t>(dynamic_cast<const moPropLongLong&>(prop).Get())) == sizeof(int64_t) ? 0 : -1;
+
+	case moProp::MO_PROP_TYPE_FLOAT:
+		return f_out.Put(static_cast<float>(dynamic_cast<const moPropFloat&>(prop).Get())) == sizeof(float) ? 0 : -1;
+
+	case moProp::MO_PROP_TYPE_DOUBLE:
+		return f_out.Put(static_cast<double>(dynamic_cast<const moPropDouble&>(prop).Get())) == sizeof(double) ? 0 : -1;
+
+	case moProp::MO_PROP_TYPE_POINTER:
+	{
+		const moBase *ptr = dynamic_cast<const moPropPointer&>(prop).Get();
+		return f_out.Put(static_cast<int64_t>(reinterpret_cast<intptr_t>(ptr))) == sizeof(int64_t) ? 0 : -1;
+	}
+
+	case moProp::MO_PROP_TYPE_STRING:
+	{
+		const char *mb = dynamic_cast<const moPropString&>(prop).Get().SavedMBData();
+		return SaveData(mb, static_cast<unsigned long>(strlen(mb)));
+	}
+
+	case moProp::MO_PROP_TYPE_BINARY:
+	{
+		void		*data;
+		unsigned long	size;
+
+		dynamic_cast<const moPropBinary&>(prop).Get().Get(data, size);
+		return SaveData(data, size);
+	}
+
+	case moProp::MO_PROP_TYPE_ARRAY:
+	{
+		const moPropArray& array = dynamic_cast<const moPropArray&>(prop);
+		int r = 0;
+		if(f_out.Put(static_cast<unsigned char>(array.GetElementsType())) != 1) {
+			r = -1;
+		}
+		const int max = static_cast<int>(array.CountIndexes());
+		for(int idx = 0; idx < max; ++idx) {
+			moPropSPtr item(array.GetAtIndex(idx));
+			if(Skip(item)) {
+				continue;
+			}
+			if(SaveProp(*item, true, array.ItemNoAtIndex(idx)) != 0) {
+				r = -1;
+			}
+		}
+		if(f_out.Put(static_cast<unsigned char>(moProp::MO_PROP_TYPE_UNKNOWN)) != 1) {
+			r = -1;
+		}
+		return r;
+	}
+
+	default:
+		throw moError("moPropIO_Binary: cannot save unknown property type %d", type);
+
+	}
+	/*NOTREACHED*/
+}
+
+
+
+
+class binary_load_t
+{
+public:
+	binary_load_t(moIStream& in)
+		: f_in(in)
+	{
+	}
+
+	int LoadName(mo_name_t& name);
+	int LoadData(moBuffer& buffer);
+	int LoadString(moWCString& str);
+	int LoadProps(moProp& container);
+
+private:
+	moPropSPtr LoadProp(unsigned char type, mo_name_t name);
+
+	moIStream&		f_in;
+	std::vector<mo_name_t>	f_names;
+};
+
+
+int binary_load_t::LoadData(moBuffer& buffer)
+{
+	uint32_t size;
+	if(f_in.Get(size) != sizeof(uint32_t)) {
+		return -1;
+	}
+	buffer.SetSize(size);
+	if(size > 0) {
+		void		*data;
+		unsigned long	sz;
+
+		buffer.Get(data, sz);
+		if(f_in.Read(data, size) != static_cast<int>(size)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+int binary_load_t::LoadString(moWCString& str)
+{
+	moBuffer	buffer;
+	void		*data;
+	unsigned long	size;
+
+	if(LoadData(buffer) != 0) {
+		return -1;
+	}
+	buffer.Get(data, size);
+	str.Set(static_cast<const char *>(data), static_cast<int>(size));
+
+	return 0;
+}
+
+
+int binary_load_t::LoadName(mo_name_t& name)
+{
+	uint32_t n;
+	if(f_in.Get(n) != sizeof(uint32_t)) {
+		return -1;
+	}
+	if((n & binary_name_index) != 0) {
+		n &= ~binary_name_index;
+		if(n >= f_names.size()) {
+			return -1;
+		}
+		name = f_names[n];
+		return 0;
+	}
+
+	moBuffer	buffer;
+	void		*data;
+	unsigned long	size;
+
+	buffer.SetSize(n);
+	buffer.Get(data, size);
+	if(n > 0 && f_in.Read(data, n) != static_cast<int>(n)) {
+		return -1;
+	}
+	name = moNamePool::GetNamePool()[moWCString(static_cast<const char *>(data), static_cast<int>(n))];
+	f_names.push_back(name);
+
+	return 0;
+}
+
+
+moPropSPtr binary_load_t::LoadProp(unsigned char type, mo_name_t name)
+{
+	switch(type) {
+	case moProp::MO_PROP_TYPE_PROP_BAG:
+	{
+		moPropBagRef bag((moName(name)));
+		bag.NewProp();
+		if(LoadProps(*bag.GetProperty()) != 0) {
+			return 0;
+		}
+		return bag.GetProperty();
+	}
+
+	case moProp::MO_PROP_TYPE_INT:
+	{
+		int32_t value;
+		if(f_in.Get(value) != sizeof(int32_t)) {
+			return 0;
+		}
+		moPropIntSPtr p = new moPropInt(name);
+		p->Set(value);
+		return static_cast<moProp *>(p);
+	}
+
+	case moProp::MO_PROP_TYPE_LONG_LONG:
+	{
+		int64_t value;
+		if(f_in.Get(value) != sizeof(int64_t)) {
+			return 0;
+		}
+		moPropLongLongSPtr p = new moPropLongLong(name);
+		p->Set(value);
+		return static_cast<moProp *>(p);
+	}
+
+	case moProp::MO_PROP_TYPE_FLOAT:
+	{
+		float value;
+		if(f_in.Get(value) != sizeof(float)) {
+			return 0;
+		}
+		moPropFloatSPtr p = new moPropFloat(name);
+		p->Set(value);
+		return static_cast<moProp *>(p);
+	}
+
+	case moProp::MO_PROP_TYPE_DOUBLE:
+	{
+		double value;
+		if(f_in.Get(value) != sizeof(double)) {
+			return 0;
+		}
+		moPropDoubleSPtr p = new moPropDouble(name);
+		p->Set(value);
+		return static_cast<moProp *>(p);
+	}
+
+	case moProp::MO_PROP_TYPE_POINTER:
+	{
+		// pointers cannot be restored; we keep a null pointer
+		int64_t value;
+		if(f_in.Get(value) != sizeof(int64_t)) {
+			return 0;
+		}
+		return new moPropPointer(name);
+	}
+
+	case moProp::MO_PROP_TYPE_STRING:
+	{
+		moWCString value;
+		if(LoadString(value) != 0) {
+			return 0;
+		}
+		moSmartPtr<moPropString> p = new moPropString(name);
+		p->Set(value);
+		return static_cast<moProp *>(p);
+	}
+
+	case moProp::MO_PROP_TYPE_BINARY:
+	{
+		moBuffer value;
+		if(LoadData(value) != 0) {
+			return 0;
+		}
+		moSmartPtr<moPropBinary> p = new moPropBinary(name);
+		p->Set(value);
+		return static_cast<moProp *>(p);
+	}
+
+	case moProp::MO_PROP_TYPE_ARRAY:
+	{
+		unsigned char elements_type;
+		if(f_in.Get(elements_type) != 1
+		|| elements_type >= moProp::MO_PROP_TYPE_max) {
+			return 0;
+		}
+		moPropSPtr array = new moPropArray(name, static_cast<moProp::prop_type_t>(elements_type));
+		if(LoadProps(*array) != 0) {
+			return 0;
+		}
+		return array;
+	}
+
+	default:
+		return 0;
+
+	}
+	/*NOTREACHED*/
+}
+
+
+int binary_load_t::LoadProps(moProp& container)
+{
+	moPropBag *bag = dynamic_cast<moPropBag *>(&container);
+	moPropArray *array = bag == 0 ? dynamic_cast<moPropArray *>(&container) : 0;
+
+	for(;;) {
+		unsigned char type;
+		if(f_in.Get(type) != 1) {
+			return -1;
+		}
+		if(type == moProp::MO_PROP_TYPE_UNKNOWN) {
+			return 0;
+		}
+
+		mo_name_t name;
+		if(LoadName(name) != 0) {
+			return -1;
+		}
+		int32_t item_no = 0;
+		if(array != 0 && f_in.Get(item_no) != sizeof(int32_t)) {
+			return -1;
+		}
+
+		moPropSPtr p = LoadProp(type, name);
+		if(!p) {
+			return -1;
+		}
+		if(array != 0) {
+			// arrays keep the pointer as is
+			array->Set(item_no, p);
+		}
+		else {
+			bag->Set(name, *p);
+		}
+	}
+	/*NOTREACHED*/
+}
+
+
+}		// no name namespace
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPropIO_Binary
+
+NAME
+
+	private:
+	InternalLoad - load a property bag from the input stream
+	InternalSave - save a property bag to the output stream
+
+SYNOPSIS
+
+	virtual int InternalLoad(moPropBagRef& prop_bag);
+	virtual int InternalSave(const moPropBagRef& prop_bag);
+
+PARAMETERS
+
+	prop_bag - the property bag to load or save
+
+DESCRIPTION
+
+	These functions implement the moPropIO interface for the
+	binary format. They are called by the moPropIO::Load()
+	and moPropIO::Save() functions respectively.
+
+	The loader adds or overwrites properties in prop_bag; it
+	does not empty the bag first. The name of prop_bag is not
+	changed either.
+
+	Both functions force the endianess of the stream to
+	little endian and restore it before returning.
+
+RETURN VALUE
+
+	0 when the property bag was loaded/saved successfully
+	-1 when an error occurs
+
+SEE ALSO
+
+	moPropIO::Load, moPropIO::Save
+
+*/
+int moPropIO_Binary::InternalLoad(moPropBagRef& prop_bag)
+{
+	char		magic[sizeof(binary_magic)];
+	unsigned char	version;
+	mo_name_t	name;
+	int		r;
+
+	const int old_endian = f_input->SetInputEndianess(LITTLE_ENDIAN);
+
+	binary_load_t load(*f_input);
+	if(f_input->Read(magic, sizeof(magic)) != static_cast<int>(sizeof(magic))
+	|| memcmp(magic, binary_magic, sizeof(magic)) != 0
+	|| f_input->Get(version) != 1
+	|| version != binary_version
+	|| load.LoadName(name) != 0) {
+		SetError(MO_ERROR_INVALID);
+		r = -1;
+	}
+	else {
+		r = load.LoadProps(*prop_bag.GetProperty());
+		if(r != 0) {
+			SetError(MO_ERROR_INVALID);
+		}
+	}
+
+	f_input->SetInputEndianess(old_endian);
+
+	return r;
+}
+
+
+int moPropIO_Binary::InternalSave(const moPropBagRef& prop_bag)
+{
+	int		r;
+
+	const int old_endian = f_output->SetOutputEndianess(LITTLE_ENDIAN);
+
+	binary_save_t save(*f_output, f_save_pointers, f_delta_generation);
+	if(f_output->Write(binary_magic, sizeof(binary_magic)) != static_cast<int>(sizeof(binary_magic))
+	|| f_output->Put(binary_version) != 1
+	|| save.SaveName(prop_bag.GetName()) != 0) {
+		r = -1;
+	}
+	else {
+		r = save.SaveBag(*dynamic_cast<const moPropBag *>(static_cast<moProp *>(prop_bag.GetProperty())));
+	}
+
+	f_output->SetOutputEndianess(old_endian);
+
+	return r;
+}
+
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moPropIO_Binary
+
+NAME
+
+	Helper functions:
+
+	moBinaryLoadPropBag - load a property bag from a buffer
+	moBinarySavePropBag - save a property bag in a buffer
+
+SYNOPSIS
+
+	extern int moBinaryLoadPropBag(const moBuffer& buffer, moPropBagRef& prop_bag);
+	extern int moBinarySavePropBag(moBuffer& buffer, const moPropBagRef& prop_bag,
+				moProp::generation_t delta_generation = 0);
+
+PARAMETERS
+
+	buffer - the buffer with the binary data
+	prop_bag - the property bag to load or save
+	delta_generation - only save properties modified after this generation
+
+DESCRIPTION
+
+	These functions are used to convert a property bag to and
+	from a memory buffer without having to create a memory file
+	and an moPropIO_Binary object.
+
+	The moBinarySavePropBag() function replaces the content of
+	the buffer.
+
+RETURN VALUE
+
+	Both functions return 0 when they succeed and -1 on errors.
+
+SEE ALSO
+
+	moPropIO, moPropIO_Binary
+
+*/
+int moBinaryLoadPropBag(const moBuffer& buffer, moPropBagRef& prop_bag)
+{
+	void		*data;
+	unsigned long	size;
+
+	moMemFile input;
+	buffer.Get(data, size);
+	if(size > 0) {
+		input.Write(data, size);
+	}
+
+	moPropIO_Binary prop_io;
+	prop_io.SetInput(&input);
+
+	return prop_io.Load(prop_bag);
+}
+
+
+int moBinarySavePropBag(moBuffer& buffer, const moPropBagRef& prop_bag, moProp::generation_t delta_generation)
+{
+	moMemFile output;
+
+	moPropIO_Binary prop_io;
+	prop_io.SetOutput(&output);
+	prop_io.SetDeltaGeneration(delta_generation);
+	if(prop_io.Save(prop_bag) != 0) {
+		return -1;
+	}
+
+	const size_t size = static_cast<const moIStream&>(output).InputSize();
+	buffer.SetSize(static_cast<unsigned long>(size));
+	if(size > 0) {
+		void		*data;
+		unsigned long	sz;
+
+		buffer.Get(data, sz);
+		if(output.Read(data, size) != static_cast<int>(size)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+
+
+};			// namespace molib
+
+// vim: ts=8 sw=8
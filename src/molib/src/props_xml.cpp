@@ -27,6 +27,9 @@
 #ifndef MO_UUENCODE_H
 #include	"mo/mo_uuencode.h"
 #endif
+#ifndef MO_BASE64_H
+#include	"mo/mo_base64.h"
+#endif
 #ifndef MO_FILE_H
 #include	"mo/mo_file.h"
 #endif
@@ -107,6 +110,7 @@ PARAMETERS
 		MO_XML_BINARY_MODE_UUENCODE
 		MO_XML_BINARY_MODE_HEX
 		MO_XML_BINARY_MODE_COMPACT
+		MO_XML_BINARY_MODE_BASE64
 
 DESCRIPTION
 
@@ -116,7 +120,13 @@ DESCRIPTION
 	The valid modes are "uuencode" (compatible with the tool
 	of the same name), "hex" (pairs of hexadecimal digits for
 	each byte), "compact" (using characters 21 to 255 except
-	38, 60, 62 and 127 to 160 inclusive).
+	38, 60, 62 and 127 to 160 inclusive) and "rfc4648" (the
+	standard base64 encoding; note that the uuencode mode is
+	named "base64" for historical reasons).
+
+	The RFC 4648 base64 mode is the fastest. The data is
+	encoded in small blocks while written to the output
+	stream so the encoded data never exists as a whole.
 
 BUGS
 
@@ -141,6 +151,10 @@ void moPropIO_XML::BinaryMode(binary_mode_t mode)
 		f_binary_mode_name = "hex";
 		break;
 
+	case MO_XML_BINARY_MODE_BASE64:
+		f_binary_mode_name = "rfc4648";
+		break;
+
 	default:	// case MO_XML_BINARY_MODE_UUENCODE:
 		// we only support base 64 uuencoding, no others
 		// (more or less, UTF-7)
@@ -468,11 +482,20 @@ int moPropIO_XML::LoadBag(moXMLParser& parser, moPropBagRef& prop_bag)
 			{
 				moPropBinaryRef p_binary(name);
 				p_binary.NewProp();
-				err = moUUDecode(dynamic_cast<const moXMLParser::moXMLData *>(static_cast<const moXMLParser::moXMLType *>(ln))->GetData(),
-						const_cast<moBuffer&>(p_binary.Get()), filemode, filename);
- 				if(err != 0) {
-					SetError(MO_ERROR_INVALID);
-					return -1;
+				const moWCString& data = dynamic_cast<const moXMLParser::moXMLData *>(static_cast<const moXMLParser::moXMLType *>(ln))->GetData();
+				if(mode == "rfc4648") {
+					// decoded directly from the wide characters
+					if(!moBase64Decode(const_cast<moBuffer&>(p_binary.Get()), data)) {
+						SetError(MO_ERROR_INVALID);
+						return -1;
+					}
+				}
+				else {
+					err = moUUDecode(data, const_cast<moBuffer&>(p_binary.Get()), filemode, filename);
+					if(err != 0) {
+						SetError(MO_ERROR_INVALID);
+						return -1;
+					}
 				}
 				if(array.IsNull()) {
 					prop_bag += p_binary;
@@ -567,6 +590,10 @@ DESCRIPTION
 	The SaveBag() is called recursively by the SaveProp()
 	function whenever it needs to save a property bag.
 
+	When a delta generation is defined (see
+	moPropIO::SetDeltaGeneration()) the properties which were
+	not modified since that generation are skipped.
+
 NOTES
 
 	At this time, there is no safe guard agains looping
@@ -624,7 +651,7 @@ const char propbag_dtd[] =
 	"	<!ELEMENT binary (#PCDATA)>\n"
 	"	<!ATTLIST binary"
 			" name CDATA #REQUIRED"
-			" mode (hex|base64) #REQUIRED>\n"
+			" mode (hex|base64|rfc4648) #REQUIRED>\n"
 	"	<!ELEMENT external EMPTY>\n"
 	"	<!ATTLIST external"
 			" name CDATA #REQUIRED"
@@ -663,7 +690,7 @@ const char propbag_dtd[] =
 	"	<!ELEMENT binary_item (#PCDATA)>\n"
 	"	<!ATTLIST binary_item"
 			" name CDATA #REQUIRED"
-			" mode (hex|base64) #REQUIRED"
+			" mode (hex|base64|rfc4648) #REQUIRED"
 			" item CDATA #REQUIRED>\n"
 	"	<!ELEMENT external_item EMPTY>\n"
 	"	<!ATTLIST external_item"
@@ -707,13 +734,15 @@ public:
 	save_info_t(const moPropBagRef& prop_bag, moOStreamSPtr output,
 				moPropIO_XML::binary_mode_t binary_mode,
 				const moWCString& binary_mode_name,
-				bool save_pointers)
+				bool save_pointers,
+				moProp::generation_t delta_generation)
 		: f_prop_bag(prop_bag),
 		  f_np(&moNamePool::GetNamePool()),
 		  f_out(0, output),
 		  f_binary_mode(binary_mode),
 		  f_binary_mode_name(binary_mode_name),
-		  f_save_pointers(save_pointers)
+		  f_save_pointers(save_pointers),
+		  f_delta_generation(delta_generation)
 	{
 		f_out.Print("%s", propbag_dtd);
 		f_out.Print("<propbag name=\"%S\">\n", f_np->Get(f_prop_bag.GetName()).Data());
@@ -727,6 +756,12 @@ public:
 	int SaveBag(const moPropBagRef& prop_bag);
 	int SaveProp(const moPropRef& p);
 
+	// in delta mode, skip the properties not modified since the last complete save
+	bool Skip(const moProp *p) const
+	{
+		return f_delta_generation != 0 && p->GetGeneration() <= f_delta_generation;
+	}
+
 	const moPropBagRef	f_prop_bag;
 	const moNamePoolSPtr	f_np;
 	moTextStream		f_out;
@@ -736,6 +771,7 @@ public:
 	moPropIO_XML::binary_mode_t f_binary_mode;
 	const moWCString&	f_binary_mode_name;
 	zbool_t			f_save_pointers;
+	moProp::generation_t	f_delta_generation;
 };
 
 
@@ -749,7 +785,11 @@ int save_info_t::SaveBag(const moPropBagRef& prop_bag)
 
 	max = prop_bag.Count();
 	for(idx = 0; idx < max; ++idx) {
-		r = SaveProp(prop_bag.Get(idx));
+		moPropRef p(prop_bag.Get(idx));
+		if(Skip(p.GetProperty())) {
+			continue;
+		}
+		r = SaveProp(p);
 		if(r != 0) {
 			rc = -1;
 		}
@@ -858,7 +898,9 @@ int save_info_t::SaveProp(const moPropRef& p)
 				f_binary_mode_name.Data());
 		void *buffer;
 		unsigned long size;
-		static_cast<const moBuffer&>(p_binary).Get(buffer, size);
+		// Get() returns a reference; the cast operator returns a
+		// temporary copy which would be gone on the next line
+		p_binary.Get().Get(buffer, size);
 		if(f_binary_mode == moPropIO_XML::MO_XML_BINARY_MODE_HEX) {
 			unsigned char *data = static_cast<unsigned char *>(buffer);
 			if(size > 16) {
@@ -884,6 +926,26 @@ int save_info_t::SaveProp(const moPropRef& p)
 		//else if(f_binary_mode == moPropIO_XML::MO_XML_BINARY_MODE_COMPACT) {
 		//	NOT IMPLEMENTED YET
 		//}
+		else if(f_binary_mode == moPropIO_XML::MO_XML_BINARY_MODE_BASE64) {
+			// encode one block at a time; base64 has no XML
+			// special characters so no escaping is necessary
+			const unsigned long	BLOCK_SIZE = 57 * 64;	// 64 lines
+			char			encoded[BLOCK_SIZE / 3 * 4 + 64 + 8];	/* Flawfinder: ignore */
+			moBase64Encoder		encoder;
+			const unsigned char	*data = static_cast<const unsigned char *>(buffer);
+			unsigned long		sz;
+
+			f_out.Print("\n");
+			while(size > 0) {
+				sz = size > BLOCK_SIZE ? BLOCK_SIZE : size;
+				encoded[encoder.Encode(encoded, data, sz)] = '\0';
+				f_out.Print("%s", encoded);
+				data += sz;
+				size -= sz;
+			}
+			encoded[encoder.Finish(encoded)] = '\0';
+			f_out.Print("%s", encoded);
+		}
 		else /* if(f_binary_mode == moPropIO_XML::MO_XML_BINARY_MODE_UUENCODE)*/ {
 			// NOTE: UUENCODE is the default mode
 			moWCString uuencode;
@@ -957,8 +1019,12 @@ int save_info_t::SaveProp(const moPropRef& p)
 		f_array_item = true;
 		int max = array.CountIndexes();
 		for(int idx = 0; idx < max; ++idx) {
+			moPropSPtr item_prop = array.GetAtIndex(idx);
+			if(Skip(item_prop)) {
+				continue;
+			}
 			f_item = array.ItemNoAtIndex(idx);
-			moPropRef array_prop(0, array.GetAtIndex(idx));
+			moPropRef array_prop(0, item_prop);
 			SaveProp(array_prop);
 		}
 		f_indent -= 2;
@@ -994,7 +1060,7 @@ int moPropIO_XML::InternalSave(const moPropBagRef& prop_bag)
 	{
 		save_info_t info(prop_bag, f_output,
 				f_binary_mode, f_binary_mode_name,
-				f_save_pointers);
+				f_save_pointers, f_delta_generation);
 
 		r = info.SaveBag(prop_bag);
 	}
@@ -1102,6 +1168,332 @@ int moXMLSavePropBag(const moWCString& filename, moPropBagRef& prop_bag, moPropI
 }
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moXMLPropBagFile
+
+NAME
+
+	Constructor - initialize an incremental property bag file
+	GetFilename - get the name of the main file
+	GetDeltaFilename - get the name of the sidecar file
+	SetCompactInterval - define how often the sidecar gets compacted
+	Load - load the main file and apply the sidecar
+	Save - save the modifications since the last compaction
+	Compact - save the complete bag in the main file
+	DiscardDelta - delete the sidecar
+
+SYNOPSIS
+
+	moXMLPropBagFile(const moWCString& filename);
+
+	const moWCString& GetFilename(void) const;
+	moWCString GetDeltaFilename(void) const;
+	void SetCompactInterval(int saves);
+
+	int Load(moPropBagRef& prop_bag);
+	int Save(const moPropBagRef& prop_bag);
+	int Compact(const moPropBagRef& prop_bag);
+	int DiscardDelta(void);
+
+PARAMETERS
+
+	filename - the name of the main XML file
+	saves - the number of delta saves between two compactions
+	prop_bag - the property bag to load or save
+
+DESCRIPTION
+
+	Saving a large property bag each time a single value changes
+	is expensive. Only the sub-bags and arrays modified since the
+	last compaction are written to a sidecar file named
+	"<filename>.delta" (see moPropIO::SetDeltaGeneration()). When
+	nothing changed, no file is written at all.
+
+	When Save() receives the same bag as the previous Save() or
+	Compact(), the generations of that bag tell what changed and
+	the save costs time proportional to the modifications. This
+	is the preferred use: keep the bag alive and modify it.
+
+	When Save() receives another bag (i.e. the caller rebuilds its
+	bag before each save), the moXMLPropBagFile keeps its own copy
+	of the last saved bag and merges the new bag in that copy (see
+	moPropBag::Merge()) which marks only the properties with a new
+	value as modified. That merge visits the whole bag.
+
+	The sidecar always holds all the modifications since the
+	last compaction so it can be written atomically (it is first
+	written to a temporary file which is then renamed).
+
+	The Compact() function saves the complete bag in the main
+	file and deletes the sidecar. It is called automatically by
+	Save() on the first save, after SetCompactInterval() delta
+	saves (10 by default) and whenever a property was removed
+	since the last compaction since removals cannot be
+	represented in a delta.
+
+	The sidecar only makes sense over the main file it was saved
+	against, so Compact() never leaves a sidecar next to a newer
+	main file, even when it gets interrupted: the bag is first
+	saved in "<filename>.tmp", then the sidecar is renamed
+	"<filename>.delta.old", the temporary file is renamed over the
+	main file and finally the old sidecar is deleted.
+
+	The Load() function first cleans up after an interrupted
+	Compact(): when "<filename>.delta.old" exists along the
+	temporary file, that file was completely saved and it is
+	renamed over the main file; the old sidecar is then deleted.
+	Load() then loads the main file and, when it exists, applies
+	the sidecar over it. The next Save() compacts the result so
+	the main file is again self sufficient.
+
+	The DiscardDelta() function deletes the sidecar and forgets
+	the last saved bag so the next Save() compacts. It is used
+	when another program rewrote the main file: the sidecar was
+	saved against the previous main file and applying it would
+	overwrite the new values with older ones.
+
+RETURN VALUE
+
+	The Load(), Save(), Compact() and DiscardDelta() functions
+	return 0 when they succeed and -1 otherwise.
+
+SEE ALSO
+
+	moXMLLoadPropBag, moXMLSavePropBag, moPropBag::Merge,
+	moPropIO::SetDeltaGeneration
+
+*/
+const char *moXMLPropBagFile::moGetClassName(void) const
+{
+	return "molib::moBase::moXMLPropBagFile";
+}
+
+
+moXMLPropBagFile::moXMLPropBagFile(const moWCString& filename)
+	: f_filename(filename),
+	  f_compact_interval(10)
+{
+}
+
+
+const moWCString& moXMLPropBagFile::GetFilename(void) const
+{
+	return f_filename;
+}
+
+
+moWCString moXMLPropBagFile::GetDeltaFilename(void) const
+{
+	return f_filename + ".delta";
+}
+
+
+void moXMLPropBagFile::SetCompactInterval(int saves)
+{
+	f_compact_interval = saves;
+}
+
+
+void moXMLPropBagFile::RecoverCompact(void)
+{
+	const moWCString old_delta_filename(GetDeltaFilename() + ".old");
+	if(!moFile::Access(old_delta_filename)) {
+		return;
+	}
+
+	// the temporary file is complete once the sidecar was renamed
+	const moWCString tmp_filename(f_filename + ".tmp");
+	if(moFile::Access(tmp_filename)
+	&& rename(tmp_filename.c_str(), f_filename.c_str()) != 0) {
+		// keep the old main file and its sidecar
+		rename(old_delta_filename.c_str(), GetDeltaFilename().c_str());
+		return;
+	}
+	moFile::Remove(old_delta_filename);
+}
+
+
+int moXMLPropBagFile::Load(moPropBagRef& prop_bag)
+{
+	RecoverCompact();
+
+	if(moXMLLoadPropBag(f_filename, prop_bag) != 0) {
+		return -1;
+	}
+
+	// whatever we had is not in sync with the file anymore
+	f_bag = 0;
+	f_source = 0;
+
+	const moWCString delta_filename(GetDeltaFilename());
+	if(moFile::Access(delta_filename)) {
+		moPropBagRef delta(moName(prop_bag.GetName()));
+		if(moXMLLoadPropBag(delta_filename, delta) == 0) {
+			dynamic_cast<moPropBag&>(*prop_bag.GetProperty()).Merge(
+					dynamic_cast<const moPropBag&>(*delta.GetProperty()));
+		}
+		else {
+			// a partial sidecar is never renamed so this
+			// should not happen; keep what the main file has
+			fprintf(stderr, "warning: moXMLPropBagFile::Load(): could not load \"%s\"; ignored\n", delta_filename.c_str());
+		}
+	}
+
+	return 0;
+}
+
+
+int moXMLPropBagFile::Save(const moPropBagRef& prop_bag)
+{
+	if(!prop_bag) {
+		return -1;
+	}
+
+	if(!f_bag && !f_source) {
+		return Compact(prop_bag);
+	}
+
+	const moPropBag& bag = dynamic_cast<const moPropBag&>(*prop_bag.GetProperty());
+	moPropBag *saved;
+	if(&bag == static_cast<moPropBag *>(f_source)) {
+		// the caller modifies the bag we saved last time;
+		// its generations tell us what changed
+		saved = f_source;
+	}
+	else {
+		if(!f_bag) {
+			// the caller switched to another bag, from now on
+			// keep our own copy to compare against
+			moPropBagRef copy(moName(prop_bag.GetName()));
+			copy.NewProp();
+			f_bag = dynamic_cast<moPropBag *>(static_cast<moProp *>(copy.GetProperty()));
+			f_bag->Merge(*f_source);
+			f_source = 0;
+		}
+		if(&bag != static_cast<moPropBag *>(f_bag)) {
+			f_bag->Merge(bag, true);
+		}
+		saved = f_bag;
+	}
+
+	if(saved->GetRemovalGeneration() > f_base_generation
+	|| f_delta_count >= f_compact_interval) {
+		return Compact(prop_bag);
+	}
+
+	if(saved->GetGeneration() <= f_saved_generation) {
+		// nothing changed since the last save
+		return 0;
+	}
+
+	const moProp::generation_t generation = moProp::CurrentGeneration();
+
+	const moWCString delta_filename(GetDeltaFilename());
+	const moWCString tmp_filename(delta_filename + ".tmp");
+	{
+		moFile output;
+		if(!output.Open(tmp_filename, moFile::MO_FILE_MODE_WRITE | moFile::MO_FILE_MODE_CREATE)) {
+			return -1;
+		}
+		moPropIO_XML prop_io_xml;
+		prop_io_xml.SetOutput(&output);
+		prop_io_xml.SetDeltaGeneration(f_base_generation);
+		moPropBagRef ref(moPropRef(0, saved));
+		if(prop_io_xml.Save(ref) != 0) {
+			return -1;
+		}
+	}
+	if(rename(tmp_filename.c_str(), delta_filename.c_str()) != 0) {
+		return -1;
+	}
+
+	f_saved_generation = generation;
+	++f_delta_count;
+
+	return 0;
+}
+
+
+int moXMLPropBagFile::Compact(const moPropBagRef& prop_bag)
+{
+	if(!prop_bag) {
+		return -1;
+	}
+
+	const moPropBag& bag = dynamic_cast<const moPropBag&>(*prop_bag.GetProperty());
+	moPropBag *saved;
+	if(f_bag) {
+		if(&bag != static_cast<moPropBag *>(f_bag)) {
+			f_bag->Merge(bag, true);
+		}
+		saved = f_bag;
+	}
+	else {
+		// no copy: the next Save() with the same bag only
+		// looks at its generations
+		f_source = const_cast<moPropBag *>(&bag);
+		saved = f_source;
+	}
+
+	const moProp::generation_t generation = moProp::CurrentGeneration();
+
+	// a stale "<filename>.delta.old" would make Load() use a
+	// partially saved temporary file
+	RecoverCompact();
+
+	const moWCString tmp_filename(f_filename + ".tmp");
+	moPropBagRef ref(moPropRef(0, saved));
+	if(moXMLSavePropBag(tmp_filename, ref) != 0) {
+		moFile::Remove(tmp_filename);
+		return -1;
+	}
+
+	// the sidecar was saved against the old main file; move it
+	// out of the way first so it never gets applied over the new one
+	const moWCString delta_filename(GetDeltaFilename());
+	const moWCString old_delta_filename(delta_filename + ".old");
+	const bool has_delta = moFile::Access(delta_filename);
+	if(has_delta && rename(delta_filename.c_str(), old_delta_filename.c_str()) != 0) {
+		moFile::Remove(tmp_filename);
+		return -1;
+	}
+	if(rename(tmp_filename.c_str(), f_filename.c_str()) != 0) {
+		if(has_delta) {
+			rename(old_delta_filename.c_str(), delta_filename.c_str());
+		}
+		moFile::Remove(tmp_filename);
+		return -1;
+	}
+	if(has_delta) {
+		moFile::Remove(old_delta_filename);
+	}
+
+	f_base_generation = generation;
+	f_saved_generation = generation;
+	f_delta_count = 0;
+
+	return 0;
+}
+
+
+int moXMLPropBagFile::DiscardDelta(void)
+{
+	f_bag = 0;
+	f_source = 0;
+
+	const moWCString delta_filename(GetDeltaFilename());
+	if(moFile::Access(delta_filename) && !moFile::Remove(delta_filename)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+
 // vim: ts=8
 }		// namespace molib
 
@@ -25,11 +25,126 @@
 
 #include	"mo/mo_regexpr.h"
 
+#include <map>
+#include <set>
+#include <vector>
+
 
 namespace molib
 {
 
 
+// The lazy DFA
+//
+// The NFA is the node graph itself: a thread is a node and the number
+// of characters of that node already matched (only EXACT nodes match
+// more than one character.) The last position of a node means that
+// its action is done and the thread follows nd_left/nd_right.
+//
+// A DFA state is the list of threads ordered by priority, which is the
+// order in which the backtracking matcher would try them. This gives
+// the exact same match (leftmost, then first found) without any
+// backtracking. The states and their transitions are created the first
+// time they are needed and the cache is flushed when it gets full.
+//
+// Some of the epsilon moves depend on the current character ($ and
+// the "\r\n" sequence, the right branch of a loop which is not taken
+// at the end of the string) so the closure is computed as part of the
+// transition on each character.
+
+namespace
+{
+const long		MO_REGEXPR_DFA_MAX_STATES = 256;	// bounded cache size
+const long		MO_REGEXPR_DFA_TABLE = 257;		// 0 to 255 plus "\r\n"
+const long		MO_REGEXPR_DFA_CRLF = 256;		// "\r" followed by "\n"
+const long		MO_REGEXPR_DFA_EOS = -1;		// end of string
+const long		MO_REGEXPR_DFA_DEAD = 0;		// state without threads
+const long		MO_REGEXPR_DFA_START = 1;		// state with the first node
+}		// no name namespace
+
+
+// the symbol of the character at position p, the end of the string
+// is handled separately
+static inline long regexpr_dfa_symbol(const mowc::wc_t *string, long p)
+{
+	const mowc::wc_t c(string[p]);
+	if(c == '\r' && string[p + 1] == '\n') {
+		return MO_REGEXPR_DFA_CRLF;
+	}
+	if(c < 0 || c > 255) {
+		return MO_REGEXPR_DFA_TABLE;
+	}
+	return c;
+}
+
+
+class moRegularExpression::moDFA
+{
+public:
+				moDFA(moRegularExpression& regexpr);
+
+	bool			Valid(void) const { return f_valid; }
+	bool			Anchored(void) const { return f_anchored; }
+	bool			HasRecords(void) const { return f_records; }
+	bool			CannotMatch(const mowc::wc_t *string) const;
+	moWCString		Literal(void) const;
+	long			Search(const mowc::wc_t *string, long& start);
+
+private:
+	typedef std::vector<unsigned long>	threads_t;
+
+	struct dfa_node_t {
+		mo_regexpr_t		type;
+		unsigned long		left;
+		unsigned long		right;
+		const mowc::wc_t *	pattern;
+		unsigned long		length;
+		unsigned long		base;		// first thread of this node
+		unsigned long		done;		// thread once the node action is done
+	};
+
+	struct dfa_state_t {
+		threads_t		threads;
+		std::vector<long>	next;		// (state << 1) | matched, -1 when not computed yet
+		std::map<mowc::wc_t, long> wide;	// same for characters over 255
+		int			eos;		// -1 not computed yet, 0 no match, 1 match
+	};
+
+	void			FindLiteral(void);
+	bool			Closure(const threads_t& threads, long symbol, mowc::wc_t c);
+	bool			Eats(unsigned long thread, mowc::wc_t c) const;
+	bool			CanStart(long symbol, mowc::wc_t c);
+	void			FindStartChar(void);
+	long			Transition(long state, long symbol, mowc::wc_t c);
+	bool			MatchAtEnd(long state);
+	long			Intern(const threads_t& threads);
+	void			Flush(void);
+
+	bool			f_valid;
+	bool			f_anchored;
+	bool			f_records;
+	bool			f_after;
+	std::vector<mowc::wc_t>	f_literal;		// a string all the matches include (null terminated)
+	std::vector<signed char> f_first;		// whether a character can start a match, -1 when not known yet
+	long			f_start_char;		// the only character which can start a match or -1
+	bool			f_start_char_known;
+	unsigned long		f_start;
+	std::vector<dfa_node_t>	f_nodes;
+	std::vector<unsigned long> f_owner;		// node of each thread
+	std::vector<dfa_state_t> f_states;
+	std::map<threads_t, long> f_index;
+	unsigned long		f_generation;		// incremented on each flush
+
+	// work buffers
+	threads_t		f_stack;
+	threads_t		f_consumers;
+	threads_t		f_next;
+	std::vector<unsigned long> f_seen;
+	unsigned long		f_mark;
+};
+
+
+
 
 /************************************************************ DOC:
 
@@ -132,6 +247,7 @@ moRegularExpression::moRegularExpression(const moRegularExpression& regexpr, int
 	: moWCString(static_cast<const moWCString&>(regexpr), length)
 {
 	Init();
+	f_engine = regexpr.f_engine;
 }
 
 
@@ -190,6 +306,7 @@ moRegularExpression::~moRegularExpression(void)
 {
 	delete f_copy_string;
 	delete f_buffer;
+	delete f_dfa;
 }
 
 
@@ -358,6 +475,108 @@ int moRegularExpression::GetLastPos(void) const
 
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moRegularExpression
+
+NAME
+
+	SetEngine - select the matcher used by MatchExpression()
+	GetEngine - returns the current matcher
+
+SYNOPSIS
+
+	void SetEngine(mo_regexpr_engine_t engine);
+	mo_regexpr_engine_t GetEngine(void) const;
+
+PARAMETERS
+
+	engine - one of MO_REGEXPR_ENGINE_AUTO or MO_REGEXPR_ENGINE_BACKTRACK
+
+DESCRIPTION
+
+	By default (MO_REGEXPR_ENGINE_AUTO) the expression is run by a lazy
+	DFA which matches in a time linear to the length of the input. The
+	states of the DFA are built on demand and kept in a bounded cache.
+
+	The backtracking matcher is still used when the expression makes
+	use of a feature the DFA does not support: the r/t trailing
+	context, counted repeats (r{n,m}) and a ^ which is not the very
+	first character. When parameters are requested and the expression
+	records variables (\(r\) and {<name>=r}) the DFA only searches for
+	the match and the backtracking matcher records the variables from
+	the position it found.
+
+	MO_REGEXPR_ENGINE_BACKTRACK forces the use of the backtracking matcher
+	in all cases. This is mainly useful to compare both engines.
+
+SEE ALSO
+
+	MatchExpression
+
+*/
+void moRegularExpression::SetEngine(mo_regexpr_engine_t engine)
+{
+	f_engine = engine;
+}
+
+
+moRegularExpression::mo_regexpr_engine_t moRegularExpression::GetEngine(void) const
+{
+	return f_engine;
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moRegularExpression
+
+NAME
+
+	RequiredLiteral - returns a string all the matches include
+
+SYNOPSIS
+
+	moWCString RequiredLiteral(void);
+
+DESCRIPTION
+
+	This function returns the longest literal string which has to
+	appear in any string this expression matches. A subject which
+	does not include that literal cannot match.
+
+	This is used by moPatternSet to search the literals of many
+	expressions in a single pass.
+
+RETURN VALUE
+
+	The literal or an empty string when the expression is invalid,
+	uses the r/t trailing context or does not require any specific
+	string (i.e. "a|b" or "x*")
+
+SEE ALSO
+
+	MatchExpression, moPatternSet
+
+*/
+moWCString moRegularExpression::RequiredLiteral(void)
+{
+	if(Analyze()) {
+		return moWCString();
+	}
+	if(f_dfa == 0) {
+		f_dfa = new moDFA(*this);
+	}
+	return f_dfa->Literal();
+}
+
+
+
 
 
 /************************************************************ DOC:
@@ -396,6 +615,9 @@ void moRegularExpression::Init(void)
 	//f_free -- auto-init to zero
 	//f_node -- auto-init to zero
 	f_errno = MO_REGEXPR_ERROR_NONE;
+
+	f_engine = MO_REGEXPR_ENGINE_AUTO;
+	f_dfa = 0;
 }
 
 
@@ -1117,6 +1339,10 @@ bool moRegularExpression::Analyze()
 	mowc::strcpy(f_copy_string, Data());	/* Flawfinder: ignore */
 	mowc::strcpy(f_buffer, f_copy_string);	/* Flawfinder: ignore */
 
+	// the DFA refers to the old nodes
+	delete f_dfa;
+	f_dfa = 0;
+
 	NodeReset();	// restart with first available node
 	memset(&state, 0, sizeof(state));
 	state.an_input = f_buffer;
@@ -1137,6 +1363,166 @@ bool moRegularExpression::Analyze()
 }
 
 
+/** \brief Check a character against the set of an ANY or NONE node.
+ *
+ * The pattern is the content of the [...] as written in the expression
+ * (a list of characters, ranges and [:class:] names.)
+ *
+ * \param[in] c         the character to check
+ * \param[in] pattern   the set of characters
+ * \param[in] length    the number of characters in pattern
+ *
+ * \return true if c is part of the set
+ */
+static bool regexpr_class_match(mowc::wc_t c, const mowc::wc_t *pattern, long length)
+{
+	mowc::wc_t		from, to;
+	bool			found;
+
+	found = false;
+	while(length > 0) {
+		// do we have a range?
+		if(length > 8
+		&& pattern[0] == '['
+		&& pattern[1] == ':') {
+			// a class!
+			if(mowc::strcmp(pattern, "[:alnum:]", 9) == 0) {
+				if(mowc::isalnum(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:alpha:]", 9) == 0) {
+				if(mowc::isalpha(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+#ifdef __USE_GNU
+			else if(mowc::strcmp(pattern, "[:blank:]", 9) == 0) {
+				if(mowc::isblank(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+#endif
+			else if(mowc::strcmp(pattern, "[:cntrl:]", 9) == 0) {
+				if(mowc::iscntrl(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:digit:]", 9) == 0) {
+				if(mowc::isdigit(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:graph:]", 9) == 0) {
+				if(mowc::isgraph(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:lower:]", 9) == 0) {
+				if(mowc::islower(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:print:]", 9) == 0) {
+				if(mowc::isprint(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:punct:]", 9) == 0) {
+				if(mowc::ispunct(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:space:]", 9) == 0) {
+				if(mowc::isspace(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:upper:]", 9) == 0) {
+				if(mowc::isupper(c)) {
+					found = true;
+					break;
+				}
+				pattern += 9;
+				length -= 9;
+			}
+			else if(mowc::strcmp(pattern, "[:xdigit:]", 10) == 0) {
+				if(mowc::isxdigit(c)) {
+					found = true;
+					break;
+				}
+				pattern += 10;
+				length -= 10;
+			}
+			else if(mowc::strcmp(pattern, "[:odigit:]", 10) == 0) {
+				if(mowc::isodigit(c)) {
+					found = true;
+					break;
+				}
+				pattern += 10;
+				length -= 10;
+			}
+			else {
+				// if we are getting here,
+				// there is a mismatch with the analyzer!
+				throw moError(MO_ERROR_INVALID, "Invalid pattern name");
+			}
+		}
+		else {
+			if(length > 2
+			&& pattern[1] == '-') {
+				from = pattern[0];
+				to = pattern[2];
+				pattern += 3;
+				length -= 3;
+			}
+			else {
+				from = pattern[0];
+				to = from;
+				pattern++;
+				length--;
+			}
+			if(c >= from && c <= to) {
+				found = true;
+				break;
+			}
+		}
+	}
+
+	return found;
+}
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -1271,7 +1657,7 @@ bool moRegularExpression::MatchMore(mo_regexpr_match_t& state)
 	mo_regexpr_node_t	*node, *reset, *start_node;
 	const mowc::wc_t	*pattern, *start;
 	long			length;
-	mowc::wc_t		c, from, to;
+	mowc::wc_t		c;
 	bool			found;
 
 //const mowc::wc_t *string, unsigned long n, unsigned long level
@@ -1368,147 +1754,7 @@ fprintf(stderr, "\n");
 			if(c != '\0') {
 				state.ma_string++;
 			}
-			found = false;
-			pattern = node->nd_pattern;
-			length = node->nd_length;
-			while(length > 0) {
-				// do we have a range?
-				if(length > 8
-				&& pattern[0] == '['
-				&& pattern[1] == ':') {
-					// a class!
-					if(mowc::strcmp(pattern, "[:alnum:]", 9) == 0) {
-						if(mowc::isalnum(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:alpha:]", 9) == 0) {
-						if(mowc::isalpha(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-#ifdef __USE_GNU
-					else if(mowc::strcmp(pattern, "[:blank:]", 9) == 0) {
-						if(mowc::isblank(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-#endif
-					else if(mowc::strcmp(pattern, "[:cntrl:]", 9) == 0) {
-						if(mowc::iscntrl(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:digit:]", 9) == 0) {
-						if(mowc::isdigit(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:graph:]", 9) == 0) {
-						if(mowc::isgraph(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:lower:]", 9) == 0) {
-						if(mowc::islower(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:print:]", 9) == 0) {
-						if(mowc::isprint(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:punct:]", 9) == 0) {
-						if(mowc::ispunct(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:space:]", 9) == 0) {
-						if(mowc::isspace(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:upper:]", 9) == 0) {
-						if(mowc::isupper(c)) {
-							found = true;
-							break;
-						}
-						pattern += 9;
-						length -= 9;
-					}
-					else if(mowc::strcmp(pattern, "[:xdigit:]", 10) == 0) {
-						if(mowc::isxdigit(c)) {
-							found = true;
-							break;
-						}
-						pattern += 10;
-						length -= 10;
-					}
-					else if(mowc::strcmp(pattern, "[:odigit:]", 10) == 0) {
-						if(mowc::isodigit(c)) {
-							found = true;
-							break;
-						}
-						pattern += 10;
-						length -= 10;
-					}
-					else {
-						// if we are getting here,
-						// there is a mismatch with the analyzer!
-						throw moError(MO_ERROR_INVALID, "Invalid pattern name");
-					}
-				}
-				else {
-					if(length > 2
-					&& pattern[1] == '-') {
-						from = pattern[0];
-						to = pattern[2];
-						pattern += 3;
-						length -= 3;
-					}
-					else {
-						from = pattern[0];
-						to = from;
-						pattern++;
-						length--;
-					}
-					if(c >= from && c <= to) {
-						found = true;
-						break;
-					}
-				}
-			}
+			found = regexpr_class_match(c, node->nd_pattern, static_cast<long>(node->nd_length));
 
 //fprintf(stderr, "Checked ANY (?) and got: %d ^ %d\n",
 //			found, node->nd_type == MO_REGEXPR_ANY);
@@ -1637,6 +1883,538 @@ fprintf(stderr, "\n");
 }
 
 
+moRegularExpression::moDFA::moDFA(moRegularExpression& regexpr)
+	: f_valid(true)
+	, f_anchored(false)
+	, f_records(false)
+	, f_after(false)
+	, f_start_char(-1)
+	, f_start_char_known(false)
+	, f_start(regexpr.f_start)
+	, f_generation(0)
+	, f_mark(0)
+{
+	const unsigned long max(regexpr.f_free);
+	unsigned long threads(0);
+	for(unsigned long idx = 0; idx < max; ++idx) {
+		const mo_regexpr_node_t *node = regexpr.Node(static_cast<int>(idx));
+
+		switch(node->nd_type) {
+		case MO_REGEXPR_START:
+			// only a leading ^ is supported; the backtracking
+			// matcher accepts others at the start of the search only
+			if(idx != f_start) {
+				f_valid = false;
+			}
+			else {
+				f_anchored = true;
+			}
+			break;
+
+		case MO_REGEXPR_STARTRECORD:
+		case MO_REGEXPR_ENDRECORD:
+			f_records = true;
+			break;
+
+		case MO_REGEXPR_LINK:
+		case MO_REGEXPR_EXACT:
+		case MO_REGEXPR_ANY:
+		case MO_REGEXPR_NONE:
+		case MO_REGEXPR_END:
+		case MO_REGEXPR_EXIT:
+			break;
+
+		case MO_REGEXPR_AFTER:
+			f_after = true;
+			f_valid = false;
+			break;
+
+		default:
+			// invalid nodes
+			f_valid = false;
+			break;
+
+		}
+		// counters are attached to the nodes, not the threads
+		if(node->nd_min != 0 || node->nd_max != 0 || node->nd_reset != 0) {
+			f_valid = false;
+		}
+
+		dfa_node_t n;
+		n.type = node->nd_type;
+		n.left = node->nd_left;
+		n.right = node->nd_right;
+		n.pattern = node->nd_pattern;
+		n.length = node->nd_length;
+		n.base = threads;
+		n.done = threads + (n.type == MO_REGEXPR_EXACT ? n.length : 1);
+		threads = n.done + 1;
+		f_nodes.push_back(n);
+		f_owner.resize(threads, idx);
+	}
+	if(f_start >= max) {
+		f_valid = false;
+		return;
+	}
+
+	// the backtracking matcher does not support r/t, keep its errors
+	if(!f_after) {
+		FindLiteral();
+	}
+
+	if(f_valid) {
+		f_seen.resize(threads, 0);
+		f_first.resize(MO_REGEXPR_DFA_TABLE, -1);
+		Flush();
+	}
+}
+
+
+/** \brief Search the longest string which all the matches include.
+ *
+ * An EXACT node is required when there is no path from the first node
+ * to the end of the expression which avoids it. The graphs are small
+ * so each candidate is simply checked with a walk of the graph.
+ *
+ * This works with the graphs the DFA cannot run too since the counters
+ * can only remove paths.
+ */
+void moRegularExpression::moDFA::FindLiteral(void)
+{
+	const unsigned long max(f_nodes.size());
+	std::vector<char> seen;
+	std::vector<unsigned long> stack;
+	unsigned long best(MO_REGEXPR_NO_NODE);
+
+	for(unsigned long x = 0; x < max; ++x) {
+		const dfa_node_t& candidate(f_nodes[x]);
+		if(candidate.type != MO_REGEXPR_EXACT
+		|| candidate.length == 0
+		|| (best != MO_REGEXPR_NO_NODE && f_nodes[best].length >= candidate.length)) {
+			continue;
+		}
+		if(x == f_start) {
+			// all the paths start here
+			best = x;
+			continue;
+		}
+
+		// can we reach the end without going through x?
+		bool avoidable(false);
+		seen.assign(max, 0);
+		stack.push_back(f_start);
+		seen[f_start] = 1;
+		while(!stack.empty() && !avoidable) {
+			const dfa_node_t& n(f_nodes[stack.back()]);
+			stack.pop_back();
+			const unsigned long next[2] = { n.left, n.right };
+			if(n.left == MO_REGEXPR_NO_NODE && n.right == MO_REGEXPR_NO_NODE) {
+				avoidable = true;
+				break;
+			}
+			for(int i = 0; i < 2; ++i) {
+				if(next[i] != MO_REGEXPR_NO_NODE && next[i] != x && !seen[next[i]]) {
+					seen[next[i]] = 1;
+					stack.push_back(next[i]);
+				}
+			}
+		}
+		stack.clear();
+		if(!avoidable) {
+			best = x;
+		}
+	}
+
+	if(best != MO_REGEXPR_NO_NODE) {
+		const dfa_node_t& n(f_nodes[best]);
+		f_literal.assign(n.pattern, n.pattern + n.length);
+		f_literal.push_back('\0');
+	}
+}
+
+
+/** \brief Check whether string lacks the literal all the matches include.
+ *
+ * This is a fast scan which avoids running the matcher at all on
+ * most of the strings which do not match.
+ *
+ * \return true when the string cannot match
+ */
+bool moRegularExpression::moDFA::CannotMatch(const mowc::wc_t *string) const
+{
+	return !f_literal.empty() && mowc::strstr(string, &f_literal[0]) == 0;
+}
+
+
+moWCString moRegularExpression::moDFA::Literal(void) const
+{
+	if(f_literal.empty()) {
+		return moWCString();
+	}
+	return moWCString(&f_literal[0]);
+}
+
+
+void moRegularExpression::moDFA::Flush(void)
+{
+	f_states.clear();
+	f_index.clear();
+	++f_generation;
+
+	threads_t threads;
+	Intern(threads);			// MO_REGEXPR_DFA_DEAD
+	threads.push_back(f_nodes[f_start].base);
+	Intern(threads);			// MO_REGEXPR_DFA_START
+}
+
+
+long moRegularExpression::moDFA::Intern(const threads_t& threads)
+{
+	std::map<threads_t, long>::const_iterator it(f_index.find(threads));
+	if(it != f_index.end()) {
+		return it->second;
+	}
+
+	if(static_cast<long>(f_states.size()) >= MO_REGEXPR_DFA_MAX_STATES) {
+		Flush();
+	}
+
+	dfa_state_t state;
+	state.threads = threads;
+	state.next.resize(MO_REGEXPR_DFA_TABLE, -1);
+	state.eos = -1;
+	f_states.push_back(state);
+
+	const long id(static_cast<long>(f_states.size() - 1));
+	f_index[threads] = id;
+
+	return id;
+}
+
+
+/** \brief Follow the epsilon moves of all the threads.
+ *
+ * This function walks the threads in order of priority, exactly like
+ * the backtracking matcher would, and saves the threads which need to
+ * eat a character in f_consumers.
+ *
+ * As soon as a thread reaches the end of the expression, the threads
+ * of lower priority are dropped since the backtracking matcher would
+ * have stopped there.
+ *
+ * \param[in] threads   the threads of the current state
+ * \param[in] symbol    the current character, MO_REGEXPR_DFA_CRLF or MO_REGEXPR_DFA_EOS
+ * \param[in] c         the current character or '\0' at the end
+ *
+ * \return true if the expression matched here
+ */
+bool moRegularExpression::moDFA::Closure(const threads_t& threads, long symbol, mowc::wc_t c)
+{
+	f_consumers.clear();
+	++f_mark;
+
+	const threads_t::size_type max(threads.size());
+	for(threads_t::size_type idx = 0; idx < max; ++idx) {
+		f_stack.clear();
+		f_stack.push_back(threads[idx]);
+		while(!f_stack.empty()) {
+			const unsigned long t(f_stack.back());
+			f_stack.pop_back();
+			if(f_seen[t] == f_mark) {
+				continue;
+			}
+			f_seen[t] = f_mark;
+
+			const dfa_node_t& n(f_nodes[f_owner[t]]);
+			if(t == n.done) {
+				if(n.left == MO_REGEXPR_NO_NODE) {
+					if(n.right == MO_REGEXPR_NO_NODE) {
+						// end of the expression
+						return true;
+					}
+					f_stack.push_back(f_nodes[n.right].base);
+				}
+				else if(n.right != MO_REGEXPR_NO_NODE) {
+					// the right branch is tried first but not
+					// at the end of the string (pushed last)
+					f_stack.push_back(f_nodes[n.left].base);
+					if(symbol != MO_REGEXPR_DFA_EOS) {
+						f_stack.push_back(f_nodes[n.right].base);
+					}
+				}
+				else {
+					f_stack.push_back(f_nodes[n.left].base);
+				}
+				continue;
+			}
+
+			switch(n.type) {
+			case MO_REGEXPR_END:
+				if(symbol == MO_REGEXPR_DFA_CRLF) {
+					// eat the "\r" of "\r\n"
+					f_consumers.push_back(t);
+				}
+				else if(symbol == MO_REGEXPR_DFA_EOS || c == '\n' || c == '\r') {
+					f_stack.push_back(n.done);
+				}
+				break;
+
+			case MO_REGEXPR_EXACT:
+				if(symbol != MO_REGEXPR_DFA_EOS) {
+					f_consumers.push_back(t);
+				}
+				break;
+
+			case MO_REGEXPR_ANY:
+			case MO_REGEXPR_NONE:
+				if(symbol != MO_REGEXPR_DFA_EOS) {
+					f_consumers.push_back(t);
+				}
+				else if(regexpr_class_match('\0', n.pattern, static_cast<long>(n.length)) == (n.type == MO_REGEXPR_ANY)) {
+					// a set which accepts '\0' matches the end
+					// of the string without moving
+					f_stack.push_back(n.done);
+				}
+				break;
+
+			default:
+				// LINK, EXIT, START and the records have no action
+				f_stack.push_back(n.done);
+				break;
+
+			}
+		}
+	}
+
+	return false;
+}
+
+
+/** \brief Compute (or retrieve) the transition of a state on a character.
+ *
+ * \return the next state shifted by one, bit 0 is set when the expression
+ *	matched before the character
+ */
+long moRegularExpression::moDFA::Transition(long state, long symbol, mowc::wc_t c)
+{
+	long *cache;
+	if(symbol < MO_REGEXPR_DFA_TABLE) {
+		cache = &f_states[state].next[symbol];
+	}
+	else {
+		std::map<mowc::wc_t, long>::iterator it(f_states[state].wide.find(c));
+		cache = it == f_states[state].wide.end() ? 0 : &it->second;
+	}
+	if(cache != 0 && *cache != -1) {
+		return *cache;
+	}
+
+	const bool matched(Closure(f_states[state].threads, symbol, c));
+
+	++f_mark;
+	f_next.clear();
+	const threads_t::size_type max(f_consumers.size());
+	for(threads_t::size_type idx = 0; idx < max; ++idx) {
+		const unsigned long t(f_consumers[idx]);
+		if(Eats(t, c) && f_seen[t + 1] != f_mark) {
+			f_seen[t + 1] = f_mark;
+			f_next.push_back(t + 1);
+		}
+	}
+
+	const unsigned long generation(f_generation);
+	const long next((Intern(f_next) << 1) | (matched ? 1 : 0));
+	if(generation == f_generation) {
+		// save in the cache unless it was just flushed
+		if(symbol < MO_REGEXPR_DFA_TABLE) {
+			f_states[state].next[symbol] = next;
+		}
+		else {
+			f_states[state].wide[c] = next;
+		}
+	}
+
+	return next;
+}
+
+
+/** \brief Check whether a thread which needs a character accepts c.
+ */
+bool moRegularExpression::moDFA::Eats(unsigned long thread, mowc::wc_t c) const
+{
+	const dfa_node_t& n(f_nodes[f_owner[thread]]);
+	switch(n.type) {
+	case MO_REGEXPR_EXACT:
+		return n.pattern[thread - n.base] == c;
+
+	case MO_REGEXPR_ANY:
+	case MO_REGEXPR_NONE:
+		return regexpr_class_match(c, n.pattern, static_cast<long>(n.length)) == (n.type == MO_REGEXPR_ANY);
+
+	default:	// MO_REGEXPR_END on "\r\n"
+		return true;
+
+	}
+}
+
+
+/** \brief Check whether a match can start on this character.
+ *
+ * This is the start state transition without creating the next
+ * state. The result is cached for the first 256 characters.
+ */
+bool moRegularExpression::moDFA::CanStart(long symbol, mowc::wc_t c)
+{
+	if(symbol < MO_REGEXPR_DFA_TABLE && f_first[symbol] != -1) {
+		return f_first[symbol] != 0;
+	}
+
+	bool start(Closure(f_states[MO_REGEXPR_DFA_START].threads, symbol, c));
+	const threads_t::size_type max(f_consumers.size());
+	for(threads_t::size_type idx = 0; idx < max && !start; ++idx) {
+		start = Eats(f_consumers[idx], c);
+	}
+
+	if(symbol < MO_REGEXPR_DFA_TABLE) {
+		f_first[symbol] = start ? 1 : 0;
+	}
+	return start;
+}
+
+
+/** \brief Determine whether a single character starts all the matches.
+ *
+ * When that is the case (i.e. the expression starts with a literal)
+ * the search jumps from one instance of that character to the next
+ * with mowc::memchr() instead of trying each position.
+ */
+void moRegularExpression::moDFA::FindStartChar(void)
+{
+	f_start_char_known = true;
+
+	// any character other than "\r" and "\n" gives the same closure
+	if(Closure(f_states[MO_REGEXPR_DFA_START].threads, 1, 1)) {
+		// an empty match is possible
+		return;
+	}
+	long c(-1);
+	const threads_t::size_type max(f_consumers.size());
+	for(threads_t::size_type idx = 0; idx < max; ++idx) {
+		const unsigned long t(f_consumers[idx]);
+		const dfa_node_t& n(f_nodes[f_owner[t]]);
+		if(n.type != MO_REGEXPR_EXACT
+		|| (c != -1 && c != n.pattern[t - n.base])) {
+			return;
+		}
+		c = n.pattern[t - n.base];
+	}
+	if(c == -1
+	|| CanStart('\n', '\n') != (c == '\n')
+	|| CanStart('\r', '\r') != (c == '\r')
+	|| CanStart(MO_REGEXPR_DFA_CRLF, '\r') != (c == '\r')) {
+		return;
+	}
+	f_start_char = c;
+}
+
+
+bool moRegularExpression::moDFA::MatchAtEnd(long state)
+{
+	dfa_state_t& s(f_states[state]);
+	if(s.eos == -1) {
+		s.eos = Closure(s.threads, MO_REGEXPR_DFA_EOS, '\0') ? 1 : 0;
+	}
+	return s.eos == 1;
+}
+
+
+/** \brief Search the leftmost match in string.
+ *
+ * The DFA is run anchored from each start position in turn, like the
+ * backtracking matcher does. A state reached at a given position by a
+ * run which failed cannot lead to a match, so these pairs are saved
+ * and later runs stop as soon as they reach one of them. This keeps
+ * the search linear in the length of the string.
+ *
+ * \param[in] string    the null terminated string to search
+ * \param[out] start    the position where the match starts
+ *
+ * \return the position where the match ends or -1 when there is no match
+ */
+long moRegularExpression::moDFA::Search(const mowc::wc_t *string, long& start)
+{
+	std::set<std::pair<long, long> >	dead;
+	std::vector<std::pair<long, long> >	visited;
+	unsigned long				generation(f_generation);
+	long					length(-1);
+
+	if(!f_anchored && !f_start_char_known) {
+		FindStartChar();
+	}
+	if(f_start_char != -1 && !f_anchored) {
+		length = mowc::strlen(string);
+	}
+
+	for(long s = 0; f_anchored ? s == 0 : string[s] != '\0'; ++s) {
+		if(!f_anchored) {
+			// skip the positions where no match can start
+			if(length != -1) {
+				const mowc::wc_t *next = mowc::memchr(string + s, static_cast<mowc::wc_t>(f_start_char), static_cast<size_t>(length - s));
+				if(next == 0) {
+					break;
+				}
+				s = static_cast<long>(next - string);
+			}
+			else if(!CanStart(regexpr_dfa_symbol(string, s), string[s])) {
+				continue;
+			}
+		}
+		if(dead.find(std::make_pair(s, MO_REGEXPR_DFA_START)) != dead.end()) {
+			continue;
+		}
+		visited.clear();
+
+		long state(MO_REGEXPR_DFA_START);
+		long end(-1);
+		for(long p = s;; ++p) {
+			mowc::wc_t c(string[p]);
+			if(c == '\0') {
+				if(MatchAtEnd(state)) {
+					end = p;
+				}
+				break;
+			}
+
+			const long next(Transition(state, regexpr_dfa_symbol(string, p), c));
+			if((next & 1) != 0) {
+				end = p;
+			}
+			if(generation != f_generation) {
+				// the cache was flushed, the state numbers changed
+				generation = f_generation;
+				dead.clear();
+				visited.clear();
+			}
+
+			state = next >> 1;
+			if(state == MO_REGEXPR_DFA_DEAD
+			|| dead.find(std::make_pair(p + 1, state)) != dead.end()) {
+				break;
+			}
+			visited.push_back(std::make_pair(p + 1, state));
+		}
+
+		if(end >= 0) {
+			start = s;
+			return end;
+		}
+		dead.insert(visited.begin(), visited.end());
+	}
+
+	return -1;
+}
+
+
 bool moRegularExpression::MatchNow(mo_regexpr_match_t& state)
 {
 	// the end is at least equal to the start
@@ -1667,6 +2445,50 @@ bool moRegularExpression::Match(mo_regexpr_match_t& state)
 	f_end_pos = 0;
 	string = state.ma_string;
 
+	if(f_engine == MO_REGEXPR_ENGINE_AUTO) {
+		if(f_dfa == 0) {
+			f_dfa = new moDFA(*this);
+		}
+		if(f_dfa->CannotMatch(string)) {
+			if(state.ma_parameters != 0
+			&& (f_dfa->Anchored() || *string != '\0')) {
+				state.ma_parameters->Empty();
+			}
+			f_start_pos = -1;
+			f_end_pos = -1;
+			return false;
+		}
+		if(f_dfa->Valid()) {
+			long start;
+			const long end = f_dfa->Search(string, start);
+			if(state.ma_parameters != 0
+			&& (f_dfa->Anchored() || *string != '\0')) {
+				// the backtracking matcher empties the list on each attempt
+				state.ma_parameters->Empty();
+			}
+			if(end < 0) {
+				f_start_pos = -1;
+				f_end_pos = -1;
+				return false;
+			}
+			f_start_pos = static_cast<int32_t>(start);
+			if(state.ma_parameters == 0 || !f_dfa->HasRecords()) {
+				f_end_pos = static_cast<int32_t>(end);
+				return true;
+			}
+			// record the variables from the position the DFA found
+			state.ma_string = string + start;
+			if(MatchNow(state)) {
+				f_end_pos = static_cast<int32_t>(state.ma_string - string);
+				return true;
+			}
+			// we should never get here; let the backtracking
+			// matcher search the whole string again
+			f_start_pos = 0;
+			state.ma_string = string;
+		}
+	}
+
 	node = Node(f_start);
 	if(node->nd_type == MO_REGEXPR_START) {
 		// it has to match from the start
@@ -28,6 +28,13 @@
 #ifndef MO_MEMFILE_H
 #include	"mo/mo_memfile.h"
 #endif
+#ifndef MO_THREAD_H
+#include	"mo/mo_thread.h"
+#endif
+
+#include	<string>
+#include	<thread>
+#include	<vector>
 
 
 
@@ -66,6 +73,11 @@ namespace molib
  *	sed.Parse(in3, out3);
  * \endcode
  *
+ * The instructions are compiled on the first Parse() and the result
+ * is reused until AddInstruction() or ClearInstructions() is called.
+ * To run the same instructions against many files, use ParseFiles()
+ * which parses them in parallel when threads are available.
+ *
  * Note that address matching can be applied to all instructions, though
  * the address matching of labels is always ignored.
  *
@@ -1293,6 +1305,27 @@ bool moSimpleEditor::moSedInstruction::Callback(moSimpleEditor& sed)
 
 
 
+/** \class moSimpleEditor::moCompiled
+ *
+ * \brief The instructions ready to be executed.
+ *
+ * Compile() saves the list of instructions in an array, resolves
+ * the label of each branch. This is done once and reused by all the
+ * following calls to Parse() until the list of instructions changes.
+ */
+class moSimpleEditor::moCompiled
+{
+public:
+				moCompiled(void)
+				{
+					f_uses_files = false;
+				}
+
+	std::vector<moSedInstruction *>	f_code;		// f_instructions as an array
+	bool				f_uses_files;	// whether the script reads or writes other files
+};
+
+
 /** \brief Initializes the simple editor.
  *
  * This function initializes the simple editor by initializes the
@@ -1300,6 +1333,7 @@ bool moSimpleEditor::moSedInstruction::Callback(moSimpleEditor& sed)
  * moSedInstruction::ACTION_APPEND_NEXT in the list of instructions.
  */
 moSimpleEditor::moSimpleEditor()
+	: f_compiled(0)
 {
 	f_input_convertor.SetEncodings("UTF-8", mowc::g_ucs4_internal);
 	f_output_convertor.SetEncodings(mowc::g_ucs4_internal, "UTF-8");
@@ -1310,6 +1344,16 @@ moSimpleEditor::moSimpleEditor()
 }
 
 
+/** \brief Clean up the simple editor.
+ *
+ * This function releases the compiled instructions.
+ */
+moSimpleEditor::~moSimpleEditor()
+{
+	delete f_compiled;
+}
+
+
 /** \brief Change the input encoding
  *
  * This function lets you change the input encoding to what it really
@@ -1325,6 +1369,7 @@ moSimpleEditor::moSimpleEditor()
  */
 int moSimpleEditor::SetInputEncoding(const char *encoding)
 {
+	f_input_encoding = encoding;
 	return f_input_convertor.SetEncodings(encoding, "UTF-32");
 }
 
@@ -1341,6 +1386,7 @@ int moSimpleEditor::SetInputEncoding(const char *encoding)
  */
 int moSimpleEditor::SetOutputEncoding(const char *encoding)
 {
+	f_output_encoding = encoding;
 	return f_output_convertor.SetEncodings("UTF-32", encoding);
 }
 
@@ -1362,6 +1408,10 @@ int moSimpleEditor::SetOutputEncoding(const char *encoding)
 void moSimpleEditor::AddInstruction(const moSedInstruction& inst)
 {
 	f_instructions += *new moSedInstruction(inst);
+
+	// compile again on the next Parse()
+	delete f_compiled;
+	f_compiled = 0;
 }
 
 
@@ -1377,6 +1427,9 @@ void moSimpleEditor::ClearInstructions()
 {
 	// note that we never delete the very first instruction
 	f_instructions.SetSize(1);
+
+	delete f_compiled;
+	f_compiled = 0;
 }
 
 
@@ -1479,6 +1532,317 @@ int moSimpleEditor::FindLabel(const moWCString& name)
 }
 
 
+/** \brief Compile the list of instructions.
+ *
+ * This function transforms the list of instructions in an moCompiled
+ * object. It is called by Parse() and does nothing if the current
+ * instructions were already compiled.
+ *
+ * Each expression is run on its own: an moPatternSet scan of the line
+ * followed by the candidate expressions is slower at any number of
+ * expressions (see tests/pattern_set_bench.cpp).
+ */
+void moSimpleEditor::Compile(void)
+{
+	moSedInstruction	*inst;
+	int			ip, max;
+
+	if(f_compiled != 0) {
+		return;
+	}
+
+	moCompiled *compiled = new moCompiled;
+	try {
+		max = f_instructions.Count();
+		compiled->f_code.reserve(max);
+		for(ip = 0; ip < max; ++ip) {
+			inst = f_instructions.Get(ip);
+			compiled->f_code.push_back(inst);
+
+			inst->f_branch = 0;
+			switch(inst->f_action) {
+			case moSedInstruction::ACTION_READ_FROM_FILE:
+			case moSedInstruction::ACTION_READ_ONE_LINE_FROM_FILE:
+			case moSedInstruction::ACTION_WRITE_TO_FILE:
+			case moSedInstruction::ACTION_WRITE_FIRST_LINE_TO_FILE:
+			case moSedInstruction::ACTION_WRITE_LAST_LINE_TO_FILE:
+				compiled->f_uses_files = true;
+				break;
+
+			case moSedInstruction::ACTION_BRANCH:
+			case moSedInstruction::ACTION_BRANCH_IF_MATCHED:
+			case moSedInstruction::ACTION_BRANCH_IF_NOT_MATCHED:
+			case moSedInstruction::ACTION_BRANCH_IF_REPLACED:
+			case moSedInstruction::ACTION_BRANCH_IF_NOT_REPLACED:
+				inst->f_branch = FindLabel(inst->f_text);
+				break;
+
+			default:
+				break;
+
+			}
+		}
+	}
+	catch(...) {
+		delete compiled;
+		throw;
+	}
+
+	f_compiled = compiled;
+}
+
+
+/** \class moSimpleEditor::moSedStream
+ *
+ * \brief The input and output of the simple editor.
+ *
+ * When created with an moTextStream, the lines are read with
+ * moTextStream::NextLine() and printed with moTextStream::Print().
+ *
+ * When created with an input and an output stream (which include
+ * the convertors to and from UCS-4) the input is read in large
+ * blocks and the lines are cut directly from these blocks instead
+ * of being read one character at a time. The output is buffered
+ * and written in large blocks as well. The lines and line numbers
+ * are the same as with moTextStream::NextLine() and its default
+ * separators ("\r\n?, \n").
+ */
+class moSimpleEditor::moSedStream
+{
+public:
+	static const size_t	BLOCK_SIZE = 64 * 1024;		// in characters
+
+				moSedStream(moTextStream& text_stream);
+				moSedStream(moIStream& input, moOStream& output);
+				~moSedStream();
+
+	bool			NextLine(moWCString& line);
+	long			Line(void) const;
+	void			Print(const moWCString& str);
+	void			Flush(void);
+
+private:
+	bool			Fill(void);
+
+	moTextStream *		f_text_stream;
+	moIStream *		f_input;
+	moOStream *		f_output;
+	bool			f_swap_input;
+	bool			f_swap_output;
+	bool			f_eof;
+	long			f_line;
+	std::vector<mowc::wc_t>	f_block;	// last block read
+	size_t			f_pos;		// next character to read in f_block
+	size_t			f_size;		// number of characters in f_block
+	size_t			f_partial;	// bytes of an incomplete character after f_size
+	std::vector<mowc::wc_t>	f_line_buffer;	// a line which spans multiple blocks
+	std::vector<mowc::wc_t>	f_output_block;
+};
+
+
+moSimpleEditor::moSedStream::moSedStream(moTextStream& text_stream)
+	: f_text_stream(&text_stream),
+	  f_input(0),
+	  f_output(0),
+	  f_swap_input(false),
+	  f_swap_output(false),
+	  f_eof(false),
+	  f_line(0),
+	  f_pos(0),
+	  f_size(0),
+	  f_partial(0)
+{
+}
+
+
+moSimpleEditor::moSedStream::moSedStream(moIStream& input, moOStream& output)
+	: f_text_stream(0),
+	  f_input(&input),
+	  f_output(&output),
+	  f_eof(false),
+	  f_line(0),
+	  f_pos(0),
+	  f_size(0),
+	  f_partial(0)
+{
+	// the streams do not tell us their endianess otherwise
+	int endian = input.SetInputEndianess(BYTE_ORDER);
+	input.SetInputEndianess(endian);
+	f_swap_input = endian != BYTE_ORDER;
+	endian = output.SetOutputEndianess(BYTE_ORDER);
+	output.SetOutputEndianess(endian);
+	f_swap_output = endian != BYTE_ORDER;
+
+	f_block.resize(BLOCK_SIZE);
+	f_output_block.reserve(BLOCK_SIZE);
+}
+
+
+moSimpleEditor::moSedStream::~moSedStream()
+{
+	Flush();
+}
+
+
+// read the next block of characters; false at the end of the input
+bool moSimpleEditor::moSedStream::Fill(void)
+{
+	char		*buffer;
+	int		r;
+
+	if(f_eof) {
+		return false;
+	}
+
+	// keep the incomplete character, if any
+	buffer = reinterpret_cast<char *>(&f_block[0]);
+	if(f_partial > 0) {
+		memmove(buffer, buffer + f_size * sizeof(mowc::wc_t), f_partial);
+	}
+	f_pos = 0;
+	f_size = 0;
+
+	do {
+		r = f_input->Read(buffer + f_partial, BLOCK_SIZE * sizeof(mowc::wc_t) - f_partial);
+		if(r <= 0) {
+			// an incomplete character at the end is ignored
+			// like moIStream::Get() does
+			f_eof = true;
+			f_partial = 0;
+			return false;
+		}
+		f_partial += r;
+	} while(f_partial < sizeof(mowc::wc_t));
+
+	f_size = f_partial / sizeof(mowc::wc_t);
+	f_partial %= sizeof(mowc::wc_t);
+	if(f_swap_input) {
+		for(size_t idx = 0; idx < f_size; ++idx) {
+			f_block[idx] = static_cast<mowc::wc_t>(moSwap32Bits(f_block[idx]));
+		}
+	}
+
+	return true;
+}
+
+
+bool moSimpleEditor::moSedStream::NextLine(moWCString& line)
+{
+	mowc::wc_t		*s, *start, *end, c;
+
+	if(f_text_stream != 0) {
+		return f_text_stream->NextLine(line);
+	}
+
+	f_line_buffer.clear();
+	for(;;) {
+		if(f_pos >= f_size && !Fill()) {
+			break;
+		}
+		start = &f_block[f_pos];
+		end = start + (f_size - f_pos);
+		s = start;
+		while(s < end && *s != '\n' && *s != '\r' && *s != '\0') {
+			++s;
+		}
+		f_pos += s - start;
+		if(s == end) {
+			f_line_buffer.insert(f_line_buffer.end(), start, s);
+			continue;
+		}
+		++f_pos;
+		c = *s;
+		if(c == '\0') {
+			// null characters are always skipped
+			f_line_buffer.insert(f_line_buffer.end(), start, s);
+			continue;
+		}
+
+		// we found a separator; in most cases the line is within
+		// one block and is copied from there (moWCString::Set()
+		// wants a null terminated string)
+		++f_line;
+		if(f_line_buffer.empty()) {
+			*s = '\0';
+			line.Set(start);
+		}
+		else {
+			f_line_buffer.insert(f_line_buffer.end(), start, s);
+			f_line_buffer.push_back('\0');
+			line.Set(&f_line_buffer[0]);
+		}
+		if(c == '\r' && (f_pos < f_size || Fill())) {
+			// like moTextStream::NextLine(), check the next
+			// character at once
+			switch(f_block[f_pos]) {
+			case '\n':
+				// "\r\n" is one separator
+			case '\0':
+				// not pushed back
+				++f_pos;
+				break;
+
+			case '\r':
+				// moTextStream counts this line twice
+				++f_line;
+				break;
+
+			}
+		}
+		return true;
+	}
+
+	if(f_line_buffer.empty()) {
+		line.Empty();
+		return false;
+	}
+	f_line_buffer.push_back('\0');
+	line.Set(&f_line_buffer[0]);
+
+	return true;
+}
+
+
+long moSimpleEditor::moSedStream::Line(void) const
+{
+	return f_text_stream != 0 ? f_text_stream->Line() : f_line;
+}
+
+
+// print str followed by a newline
+void moSimpleEditor::moSedStream::Print(const moWCString& str)
+{
+	const mowc::wc_t	*s;
+
+	if(f_text_stream != 0) {
+		f_text_stream->Print("%S\n", str.Data());
+		return;
+	}
+
+	for(s = str.Data(); *s != '\0'; ++s) {
+		f_output_block.push_back(*s);
+	}
+	f_output_block.push_back('\n');
+	if(f_output_block.size() >= BLOCK_SIZE) {
+		Flush();
+	}
+}
+
+
+void moSimpleEditor::moSedStream::Flush(void)
+{
+	if(!f_output_block.empty()) {
+		if(f_swap_output) {
+			for(size_t idx = 0; idx < f_output_block.size(); ++idx) {
+				f_output_block[idx] = static_cast<mowc::wc_t>(moSwap32Bits(f_output_block[idx]));
+			}
+		}
+		f_output->Write(&f_output_block[0], f_output_block.size() * sizeof(mowc::wc_t));
+		f_output_block.clear();
+	}
+}
+
+
 /** \brief Parse a text file
  *
  * This function is the actual simple editor. It takes a
@@ -1504,6 +1868,23 @@ int moSimpleEditor::FindLabel(const moWCString& name)
  * \param[in] text_stream The stream used to read and write text
  */
 void moSimpleEditor::Parse(moTextStream& text_stream)
+{
+	moSedStream stream(text_stream);
+
+	Execute(stream);
+}
+
+
+/** \brief Execute the instructions against a stream.
+ *
+ * This function compiles the instructions if necessary and then
+ * runs them against the lines read from the stream until an
+ * moSedInstruction::ACTION_QUIT or equivalent is found or the
+ * input was exhausted.
+ *
+ * \param[in] stream The stream used to read and write text
+ */
+void moSimpleEditor::Execute(moSedStream& stream)
 {
 	moWCString		line, uppercase, match_uppercase, str, extra;
 	moListOfWCStrings	pattern;
@@ -1512,16 +1893,19 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 	int			ip, idx, max, line_no;
 	bool			eof, match, replace, new_address_match, consumed;
 
-	ip = 0;		// instruction pointer
+	Compile();
+
+	moSedInstruction * const *code = &f_compiled->f_code[0];
+	const int count = static_cast<int>(f_compiled->f_code.size());
+
 	match = false;
 	replace = false;
 	eof = false;
 	consumed = true;
 
 	// reset address matching
-	max = f_instructions.Count();
-	for(ip = 0; ip < max; ++ip) {
-		inst = f_instructions.Get(ip);
+	for(ip = 0; ip < count; ++ip) {
+		inst = code[ip];
 		if(inst->f_start_line <= 0
 		|| inst->f_start_pattern.IsEmpty()) {
 			inst->f_matched_line = 1;
@@ -1530,16 +1914,17 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 			inst->f_matched_line = 0;
 		}
 	}
+	ip = 0;
 
 	for(;;) {
 		// automatically loop around
-		if(ip >= static_cast<int>(f_instructions.Count())) {
+		if(ip >= count) {
 			ip = 0;
 		}
-		inst = f_instructions.Get(ip);
+		inst = code[ip];
 
 		// if there is an address, we need a match
-		line_no = text_stream.Line();
+		line_no = stream.Line();
 		new_address_match = inst->f_matched_line != 0;
 		if(!new_address_match) {
 			// check the start
@@ -1648,7 +2033,7 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 			}
 			// lose pattern and read next line
 			pattern.Empty();
-			eof = !text_stream.NextLine(line);
+			eof = !stream.NextLine(line);
 			// TODO: what shall we do at the end of file?
 			match = false;
 			replace = false;
@@ -1662,7 +2047,7 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 			if(!consumed) {
 				pattern += *new moWCString(line);
 			}
-			eof = !text_stream.NextLine(line);
+			eof = !stream.NextLine(line);
 			// TODO: what shall we do at the end of file?
 			match = false;
 			replace = false;
@@ -1703,26 +2088,26 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 		case moSedInstruction::ACTION_PRINT:
 			max = pattern.Count();
 			for(idx = 0; idx < max; ++idx) {
-				text_stream.Print("%S\n", pattern.Get(idx)->Data());
+				stream.Print(*pattern.Get(idx));
 			}
-			text_stream.Print("%S\n", line.Data());
+			stream.Print(line);
 			pattern.Empty();
 			consumed = true;
 			break;
 
 		case moSedInstruction::ACTION_PRINT_FIRST_LINE:
 			if(!pattern.IsEmpty()) {
-				text_stream.Print("%S\n", pattern.Get(0)->Data());
+				stream.Print(*pattern.Get(0));
 				pattern.Delete(0);
 			}
 			else {
-				text_stream.Print("%S\n", line.Data());
+				stream.Print(line);
 				consumed = true;
 			}
 			break;
 
 		case moSedInstruction::ACTION_PRINT_LAST_LINE:
-			text_stream.Print("%S\n", line.Data());
+			stream.Print(line);
 			consumed = true;
 			break;
 
@@ -1733,7 +2118,7 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 				moIStreamScopeFilter input_convertor(inst->f_file, &conv);
 				moTextStream input(&inst->f_file, 0, 0);
 				while(input.NextLine(str)) {
-					text_stream.Print("%S\n", str.Data());
+					stream.Print(str);
 				}
 				// avoid leaking resources
 				inst->f_file.Close();
@@ -1753,7 +2138,7 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 				moIStreamScopeFilter input_convertor(inst->f_file, &conv);
 				moTextStream input(&inst->f_file, 0, 0);
 				if(input.NextLine(str)) {
-					text_stream.Print("%S\n", str.Data());
+					stream.Print(str);
 				}
 			}
 			break;
@@ -1846,19 +2231,19 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 			return;
 
 		case moSedInstruction::ACTION_BRANCH:
-			ip = FindLabel(inst->f_text) - 1;
+			ip = inst->f_branch - 1;
 			break;
 
 		case moSedInstruction::ACTION_BRANCH_IF_MATCHED:
 			if(match) {
 				match = false;
-				ip = FindLabel(inst->f_text) - 1;
+				ip = inst->f_branch - 1;
 			}
 			break;
 
 		case moSedInstruction::ACTION_BRANCH_IF_NOT_MATCHED:
 			if(!match) {
-				ip = FindLabel(inst->f_text) - 1;
+				ip = inst->f_branch - 1;
 			}
 			else {
 				match = false;
@@ -1868,13 +2253,13 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
 		case moSedInstruction::ACTION_BRANCH_IF_REPLACED:
 			if(replace) {
 				replace = false;
-				ip = FindLabel(inst->f_text) - 1;
+				ip = inst->f_branch - 1;
 			}
 			break;
 
 		case moSedInstruction::ACTION_BRANCH_IF_NOT_REPLACED:
 			if(!replace) {
-				ip = FindLabel(inst->f_text) - 1;
+				ip = inst->f_branch - 1;
 			}
 			else {
 				replace = false;
@@ -1905,8 +2290,11 @@ void moSimpleEditor::Parse(moTextStream& text_stream)
  *
  * This function initializes the input and output streams
  * with the correct convertors as defined internally.
- * Then it calls the Parse(moTextStream& text_stream)
- * function.
+ * Then it runs the instructions against the input.
+ *
+ * The input is read and the output written in large blocks
+ * instead of one character at a time as an moTextStream
+ * would do.
  *
  * The input and output streams are expected to be text
  * files.
@@ -1923,9 +2311,10 @@ void moSimpleEditor::Parse(moIStream& input, moOStream& output)
 	moIStreamScopeFilter input_convertor(input, &f_input_convertor);
 	moOStreamScopeFilter output_convertor(output, &f_output_convertor);
 
-	moTextStream text_stream(&input, &output, 0);
+	// the stream flushes its output before the convertors are removed
+	moSedStream stream(input, output);
 
-	Parse(text_stream);
+	Execute(stream);
 }
 
 
@@ -1989,6 +2378,179 @@ void moSimpleEditor::Parse(const moWCString& input_filename, const moWCString& o
 }
 
 
+namespace
+{
+
+// the state shared by the runners of ParseFiles()
+struct sed_batch_t
+{
+	const moListOfWCStrings *	inputs;
+	const moListOfWCStrings *	outputs;
+	moMutex				mutex;
+	unsigned long			next;		// next file to parse
+	int				pending;	// runners still running
+	bool				failed;
+	int				error_number;
+	std::string			error_message;
+};
+
+
+// parse files with one editor until none are left
+class moSedBatchRunner : public moThread::moRunner
+{
+public:
+				moSedBatchRunner(moSimpleEditor& editor, sed_batch_t& batch)
+					: f_editor(editor),
+					  f_batch(batch)
+				{
+				}
+
+	virtual bool		Run(void)
+				{
+					unsigned long idx;
+
+					for(;;) {
+						{
+							moLockMutex lock(f_batch.mutex);
+							if(f_batch.failed || f_batch.next >= f_batch.inputs->Count()) {
+								break;
+							}
+							idx = f_batch.next;
+							++f_batch.next;
+						}
+						try {
+							f_editor.Parse(*f_batch.inputs->Get(idx), *f_batch.outputs->Get(idx));
+						}
+						catch(const moException& e) {
+							moLockMutex lock(f_batch.mutex);
+							if(!f_batch.failed) {
+								f_batch.failed = true;
+								f_batch.error_number = e.Errno();
+								f_batch.error_message = e.Message();
+							}
+						}
+					}
+
+					moLockMutex lock(f_batch.mutex);
+					--f_batch.pending;
+					f_batch.mutex.Signal();
+					return true;
+				}
+
+private:
+	moSimpleEditor&		f_editor;
+	sed_batch_t&		f_batch;
+};
+
+typedef moSmartPtr<moSedBatchRunner>	moSedBatchRunnerSPtr;
+
+}		// no name namespace
+
+
+/** \brief Parse many files with the same instructions.
+ *
+ * This function parses each input file to the output file at the
+ * same position in the other list as Parse(input_filename,
+ * output_filename) would, including the case where both names are
+ * the same.
+ *
+ * The instructions are compiled once. When threads are available
+ * the files are spread between one editor per core, each with its
+ * own copy of the instructions, and parsed in parallel. Otherwise
+ * (or when the instructions read or write other files which the
+ * threads would then share) the files are parsed one after another.
+ *
+ * When a file cannot be parsed, the files not yet started are
+ * skipped and the error is thrown once all the threads are done.
+ *
+ * \param[in] input_filenames The files to parse
+ * \param[in] output_filenames Where to save the result of each file
+ *
+ * \exception moError
+ * The number of input and output filenames differ.
+ */
+void moSimpleEditor::ParseFiles(const moListOfWCStrings& input_filenames, const moListOfWCStrings& output_filenames)
+{
+	unsigned long	idx, max, workers, ip;
+
+	max = input_filenames.Count();
+	if(output_filenames.Count() != max) {
+		throw moError(MO_ERROR_INVALID, "moSimpleEditor::ParseFiles(): the number of input and output filenames differ");
+	}
+
+	Compile();
+
+	workers = std::thread::hardware_concurrency();
+	if(workers > max) {
+		workers = max;
+	}
+	if(!moThread::ThreadingAvailable() || f_compiled->f_uses_files || workers < 2) {
+		for(idx = 0; idx < max; ++idx) {
+			Parse(*input_filenames.Get(idx), *output_filenames.Get(idx));
+		}
+		return;
+	}
+
+	sed_batch_t batch;
+	batch.inputs = &input_filenames;
+	batch.outputs = &output_filenames;
+	batch.next = 0;
+	batch.pending = static_cast<int>(workers);
+	batch.failed = false;
+	batch.error_number = 0;
+
+	// the instructions keep their state and the convertors have
+	// their own iconv handles so each thread needs its own editor;
+	// these are all created and compiled here since the lists are
+	// not thread safe
+	std::vector<moSimpleEditorSPtr> editors;
+	std::vector<moSedBatchRunnerSPtr> runners;
+	std::vector<moThreadSPtr> threads;
+	for(idx = 0; idx < workers; ++idx) {
+		moSimpleEditorSPtr editor(new moSimpleEditor);
+		if(!f_input_encoding.IsEmpty()) {
+			editor->SetInputEncoding(f_input_encoding.c_str());
+		}
+		if(!f_output_encoding.IsEmpty()) {
+			editor->SetOutputEncoding(f_output_encoding.c_str());
+		}
+		// skip the ACTION_APPEND_NEXT the constructor adds
+		for(ip = 1; ip < f_instructions.Count(); ++ip) {
+			editor->AddInstruction(*f_instructions.Get(ip));
+		}
+		editor->Compile();
+		editors.push_back(editor);
+		runners.push_back(new moSedBatchRunner(*editor, batch));
+	}
+	for(idx = 0; idx < workers; ++idx) {
+		moThreadSPtr thread(new moThread("moSimpleEditor", runners[idx]));
+		if(thread->Start()) {
+			threads.push_back(thread);
+		}
+		else {
+			// parse the remaining files from here
+			runners[idx]->Run();
+		}
+	}
+
+	{
+		moLockMutex lock(batch.mutex);
+		while(batch.pending > 0) {
+			batch.mutex.Wait();
+		}
+	}
+	// let the threads finish their cleanup before the
+	// editors and runners get released
+	for(idx = 0; idx < threads.size(); ++idx) {
+		threads[idx]->Wait();
+	}
+
+	if(batch.failed) {
+		throw moError(batch.error_number, "%s", batch.error_message.c_str());
+	}
+}
+
+
 }			// namespace molib
 
 // vim: ts=8
@@ -29,6 +29,8 @@
 #include	"mo/mo_buffer.h"
 #endif
 
+#include	<wchar.h>
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4996)
 #endif
@@ -1547,7 +1549,7 @@ mowc::wc_t *mowc::strrchr(const wc_t *s, wc_t c)
 	const wc_t	*e;
 
 	e = 0;
-	while(s != '\0') {
+	while(*s != '\0') {
 		if(*s == c) {
 			e = s;
 		}
@@ -1562,6 +1564,97 @@ mowc::wc_t *mowc::strrchr(const wc_t *s, wc_t c)
 
 
 
+/************************************************************ DOC:
+
+NAMESPACE
+
+	mowc
+
+NAME
+
+	memchr - find the first instance of a character in a buffer
+	strstr - find the first instance of a string in a string
+
+SYNOPSIS
+
+	wc_t *memchr(const wc_t *s, wc_t c, size_t length);
+	wc_t *strstr(const wc_t *s, const wc_t *needle);
+
+PARAMETER
+
+	s - the string to scan
+	c - the character searched
+	length - the number of characters in s
+	needle - the string searched
+
+DESCRIPTION
+
+	memchr() searches the first instance of c in the length
+	characters at s. The '\0' character is not special.
+
+	strstr() searches the first instance of the null terminated
+	needle in the null terminated string s. An empty needle is
+	found at the start of s.
+
+	When the system wchar_t is 32 bits these functions use the
+	wmemchr() and wcsstr() functions of the C library which are
+	much faster than a simple loop.
+
+	These functions are used to skip the parts of a string which
+	cannot match a pattern (see moRegularExpression and Glob.)
+
+RETURNED VALUE
+
+	A pointer on the first found character or string or NULL.
+
+*/
+mowc::wc_t *mowc::memchr(const wc_t *s, wc_t c, size_t length)
+{
+#if WCHAR_MAX == 65535
+	while(length > 0) {
+		if(*s == c) {
+			return const_cast<wc_t *>(s);
+		}
+		s++;
+		length--;
+	}
+	return 0;
+#else
+	return reinterpret_cast<wc_t *>(const_cast<wchar_t *>(wmemchr(reinterpret_cast<const wchar_t *>(s), static_cast<wchar_t>(c), length)));
+#endif
+}
+
+
+mowc::wc_t *mowc::strstr(const wc_t *s, const wc_t *needle)
+{
+#if WCHAR_MAX == 65535
+	const wc_t	*a, *b;
+
+	for(;;) {
+		a = s;
+		b = needle;
+		while(*b != '\0' && *a == *b) {
+			a++;
+			b++;
+		}
+		if(*b == '\0') {
+			return const_cast<wc_t *>(s);
+		}
+		if(*s == '\0') {
+			return 0;
+		}
+		s++;
+	}
+#else
+	return reinterpret_cast<wc_t *>(const_cast<wchar_t *>(wcsstr(reinterpret_cast<const wchar_t *>(s), reinterpret_cast<const wchar_t *>(needle))));
+#endif
+}
+
+
+
+
+
+
 /************************************************************ DOC:
 
 NAMESPACE
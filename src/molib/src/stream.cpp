@@ -29,6 +29,9 @@
 #ifndef MO_TEMPLATE_H
 #include	"mo/mo_template.h"
 #endif
+#ifndef MO_FILTER_H
+#include	"mo/mo_filter.h"
+#endif
 
 
 
@@ -70,6 +73,7 @@ moIStream::moIStream(void)
 {
 	//f_input_position -- auto-init
 	//f_input_filter -- auto-init
+	f_input_pipeline = 0;
 	f_input_filename = 0;
 	f_input_unget_position = 0;
 	//f_input_unget[] --- since the position is zero, there's nothing here!
@@ -183,6 +187,38 @@ int moIStream::Read(void *buffer, size_t length)
 		return total > 0 || l == 0 ? total : -1;
 	}
 
+	if(f_input_pipeline != 0) {
+		// the raw data is read directly in the pipeline and the
+		// last stage writes in the user buffer
+		for(;;) {
+			l = f_input_pipeline->Read(buffer, static_cast<unsigned long>(length));
+			if(l < 0) {
+				return -1;
+			}
+			total += l;
+			length -= l;
+			if(length == 0) {
+				return total;
+			}
+			buffer = static_cast<unsigned char *>(buffer) + l;
+			unsigned long size;
+			void *span = f_input_pipeline->InputSpan(size);
+			if(size == 0) {
+				// the stages are stuck
+				return total;
+			}
+			l = RawRead(span, size);
+			if(l < 0) {
+				return -1;
+			}
+			if(l == 0) {
+				return total;
+			}
+			f_input_pipeline->CommitInput(l);
+		}
+		/*NOTREACHED*/
+	}
+
 	for(;;) {
 		l = f_input_filter->Read(buffer, static_cast<unsigned long>(length));
 
@@ -196,6 +232,7 @@ int moIStream::Read(void *buffer, size_t length)
 		if(length == 0) {
 			return total;
 		}
+		buffer = static_cast<unsigned char *>(buffer) + l;
 		// we need more raw data
 		l = RawRead(buf, moMin(f_input_filter->FreeSpace(), sizeof(buf)));
 		if(l < 0) {
@@ -1137,6 +1174,10 @@ DESCRIPTION
 
 	You can stop the filtering by setting the filter pointer to 0.
 
+	When the filter is an moFilterPipeline, the raw data is read
+	directly in the pipeline input buffer and the last stage writes
+	in the user buffer.
+
 NOTES
 
 	The default FIFO definition is transparent to the data (it isn't
@@ -1158,6 +1199,7 @@ moFIFOSPtr moIStream::SetInputFilter(moFIFO *filter)
 
 	old_filter = f_input_filter;
 	f_input_filter = filter;
+	f_input_pipeline = dynamic_cast<moFilterPipeline *>(filter);
 
 	return old_filter;
 }
@@ -1283,6 +1325,7 @@ moOStream::moOStream(void)
 {
 	//f_output_position -- auto-init
 	//f_output_filter -- auto-init
+	f_output_pipeline = 0;
 	f_output_filename = 0;
 }
 
@@ -1359,6 +1402,30 @@ int moOStream::Write(const void *buffer, size_t length)
 	}
 
 	total = 0;
+	if(f_output_pipeline != 0) {
+		// the first stage reads the user buffer in place and
+		// the output of the last stage is written as is
+		do {
+			l = f_output_pipeline->Write(buffer, length);
+			if(l < 0) {
+				return -1;
+			}
+			buffer = static_cast<const char *>(buffer) + l;
+			length -= l;
+			total += l;
+			sz = WritePipelineOutput();
+			if(sz < 0) {
+				return -1;
+			}
+			if(l == 0 && sz == 0) {
+				// nothing moves anymore
+				break;
+			}
+		} while(length != 0);
+
+		return total;
+	}
+
 	do {
 		l = f_output_filter->Write(buffer, moMin(f_output_filter->FreeSpace(), length));
 		if(l < 0) {
@@ -1757,6 +1824,11 @@ DESCRIPTION
 	It is possible to stop the filtering by setting the filter pointer
 	to 0.
 
+	When the filter is an moFilterPipeline, the data goes through its
+	stages without intermediate buffers. When such a filter gets
+	replaced, the pipeline is first finished (see
+	moFilterPipeline::Finish()) and its output written.
+
 NOTES
 
 	The default FIFO definition is transparent to the data (it isn't
@@ -1775,15 +1847,61 @@ SEE ALSO
 moFIFOSPtr moOStream::SetOutputFilter(moFIFO *filter)
 {
 	moFIFOSPtr	old_filter;
+	bool		done;
+
+	if(f_output_pipeline != 0) {
+		// end the stream going through the pipeline
+		do {
+			done = f_output_pipeline->Finish();
+		} while(WritePipelineOutput() > 0 && !done);
+	}
 
 	old_filter = f_output_filter;
 	f_output_filter = filter;
+	f_output_pipeline = dynamic_cast<moFilterPipeline *>(filter);
 
 	return old_filter;
 }
 
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moOStream
+
+NAME
+
+	OutputFilter - get the current output filter
+
+SYNOPSIS
+
+	moFIFOSPtr OutputFilter(void) const;
+
+DESCRIPTION
+
+	This function returns the filter currently installed on this
+	output stream. This is useful to know whether the data written
+	in the stream will be transformed before it reaches its
+	destination.
+
+RETURN VALUE
+
+	The current filter pointer or 0 when none is defined.
+
+SEE ALSO
+
+	moOStream::SetOutputFilter()
+
+*/
+moFIFOSPtr moOStream::OutputFilter(void) const
+{
+	return f_output_filter;
+}
+
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -1829,6 +1947,64 @@ int moOStream::Flush(void)
 
 
 
+/************************************************************ DOC:
+
+CLASS
+
+	moOStream
+
+NAME
+
+	private:
+	WritePipelineOutput - write the output of the pipeline filter
+
+SYNOPSIS
+
+	int WritePipelineOutput(void);
+
+DESCRIPTION
+
+	This function writes the data available at the end of the
+	output pipeline directly in the raw output stream.
+
+	Note that Flush() does not call this function since the raw
+	stream may itself call Flush() from its RawWrite(). The Write()
+	function always empties the pipeline anyway.
+
+RETURN VALUE
+
+	the number of bytes written or -1 when an error occurs
+
+SEE ALSO
+
+	Write(), Flush(), SetOutputFilter()
+
+*/
+int moOStream::WritePipelineOutput(void)
+{
+	const void	*span;
+	unsigned long	size;
+	int		l, total;
+
+	total = 0;
+	for(;;) {
+		span = f_output_pipeline->OutputSpan(size);
+		if(size == 0) {
+			return total;
+		}
+		l = RawWrite(span, size);
+		if(l <= 0) {
+			return l < 0 ? -1 : total;
+		}
+		f_output_pipeline->ConsumeOutput(l);
+		total += l;
+	}
+	/*NOTREACHED*/
+}
+
+
+
+
 /************************************************************ DOC:
 
 CLASS
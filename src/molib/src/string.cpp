@@ -859,8 +859,16 @@ void moWCString::Set(const mowc::wc_t *str, int length, mowc::encoding_t encodin
 {
 	int		len;
 
-	len = mowc::strlen(str);			/* Flawfinder: ignore */
-	if(len < length || length == -1) {
+	if(length == -1) {
+		length = mowc::strlen(str);		/* Flawfinder: ignore */
+	}
+	else if(str == 0) {
+		length = 0;
+	}
+	else {
+		// don't scan past the requested length; str may be a
+		// small part of a very large string
+		for(len = 0; len < length && str[len] != '\0'; ++len);
 		length = len;
 	}
 	Size(length);
@@ -3111,8 +3119,72 @@ moWCString& moWCString::Reverse()
 
 
 
+// internal function computing the number of literal characters a
+// Glob() pattern starts with (before the first special character) and
+// ends with (after the last '*' when only literals follow it); the [...]
+// classes are read the same way moWCStringGlob() reads them so a '*' or
+// a '?' in a class is not taken as a wildcard
+static void moWCStringGlobLiterals(const mowc::wc_t *p, size_t length, size_t& prefix, size_t& suffix)
+{
+	size_t		pos, star;
+	bool		tail;
+
+	for(prefix = 0; prefix < length; ++prefix) {
+		if(p[prefix] == '*' || p[prefix] == '?' || p[prefix] == '[') {
+			break;
+		}
+	}
+
+	star = 0;
+	tail = false;
+	pos = prefix;
+	while(pos < length) {
+		switch(p[pos]) {
+		case '*':
+			star = pos + 1;
+			tail = true;
+			++pos;
+			break;
+
+		case '?':
+			tail = false;
+			++pos;
+			break;
+
+		case '[':
+			tail = false;
+			++pos;
+			if(pos < length && (p[pos] == '!' || p[pos] == '^')) {
+				++pos;
+			}
+			if(pos < length) {
+				do {
+					if(pos + 1 < length && p[pos + 1] == '-') {
+						pos += pos + 2 >= length || p[pos + 2] != ']' ? 3 : 2;
+					}
+					else {
+						++pos;
+					}
+				} while(pos < length && p[pos] != ']');
+				if(pos < length) {
+					++pos;
+				}
+			}
+			break;
+
+		default:
+			++pos;
+			break;
+
+		}
+	}
+
+	suffix = tail ? length - star : 0;
+}
+
+
 // internal function applying the Glob feature.
-static bool moWCStringGlob(const mowc::wc_t *s, const mowc::wc_t *p)
+static bool moWCStringGlob(const mowc::wc_t *s, const mowc::wc_t *e, const mowc::wc_t *p)
 {
 	bool			invert;
 	mowc::wc_t	from, to;
@@ -3126,8 +3198,21 @@ static bool moWCStringGlob(const mowc::wc_t *s, const mowc::wc_t *p)
 			if(*p == '\0') {
 				return true;
 			}
+			if(*p != '?' && *p != '[') {
+				// only try where the next literal character appears
+				for(;;) {
+					s = mowc::memchr(s, *p, static_cast<size_t>(e - s));
+					if(s == 0) {
+						return false;
+					}
+					if(moWCStringGlob(s, e, p)) {
+						return true;
+					}
+					s++;
+				}
+			}
 			while(*s != '\0') {
-				if(moWCStringGlob(s, p)) {
+				if(moWCStringGlob(s, e, p)) {
 					return true;
 				}
 				s++;
@@ -3233,7 +3318,62 @@ cont:;
  */
 bool moWCString::Glob(const moWCString& pattern) const
 {
-	return moWCStringGlob(f_string, pattern.f_string);
+	size_t		prefix, suffix, idx;
+
+	// reject the strings which do not start and end with the
+	// literals of the pattern before running the matcher
+	moWCStringGlobLiterals(pattern.f_string, pattern.f_length, prefix, suffix);
+	if(prefix == pattern.f_length) {
+		// no special characters at all
+		return f_length == pattern.f_length
+			&& mowc::strcmp(f_string, pattern.f_string, static_cast<long>(prefix)) == 0;
+	}
+	if(f_length < prefix + suffix) {
+		return false;
+	}
+	for(idx = 0; idx < prefix; ++idx) {
+		if(f_string[idx] != pattern.f_string[idx]) {
+			return false;
+		}
+	}
+	for(idx = 1; idx <= suffix; ++idx) {
+		if(f_string[f_length - idx] != pattern.f_string[pattern.f_length - idx]) {
+			return false;
+		}
+	}
+
+	return moWCStringGlob(f_string, f_string + f_length, pattern.f_string);
+}
+
+
+/** \brief Get the literals a Glob() pattern starts and ends with.
+ *
+ * This function returns the characters any string matching this
+ * Glob() pattern starts with (the characters before the first '*',
+ * '?' or '[') and ends with (the characters after the last '*' when
+ * no '?' nor [...] follow it). A '*' within a [...] class is not
+ * a wildcard.
+ *
+ * This lets a caller reject many strings (i.e. the names of the
+ * files in a directory) before converting them and calling Glob().
+ *
+ * \param[out] prefix   The literal characters at the start.
+ * \param[out] suffix   The literal characters at the end.
+ *
+ * \return true when this pattern has no special characters; a string
+ *	then matches only if it equals \p prefix.
+ *
+ * \sa Glob
+ */
+bool moWCString::GlobLiterals(moWCString& prefix, moWCString& suffix) const
+{
+	size_t		prefix_length, suffix_length;
+
+	moWCStringGlobLiterals(f_string, f_length, prefix_length, suffix_length);
+	prefix = moWCString(f_string, static_cast<int>(prefix_length));
+	suffix = moWCString(f_string + f_length - suffix_length, static_cast<int>(suffix_length));
+
+	return prefix_length == f_length;
 }
 
 
@@ -3284,6 +3424,18 @@ bool moWCString::Match(const moWCString& pattern) const
 	regex_t		re;
 	int		ec;
 	char		p[256], q[256];		/* Flawfinder: ignore */
+	const mowc::wc_t *s;
+
+	// a pattern without any special character is searched as is
+	// which is much faster than compiling it
+	for(s = pattern.f_string; *s != '\0'; ++s) {
+		if(*s < 0x80 && strchr(".[]()|*+?{}^$\\", static_cast<char>(*s)) != 0) {
+			break;
+		}
+	}
+	if(*s == '\0' && s != pattern.f_string) {
+		return mowc::strstr(f_string, pattern.f_string) != 0;
+	}
 
 	// TODO: we probably want a way to test case insensitive!
 
@@ -27,6 +27,9 @@
 #ifndef MO_FILE_H
 #include	"mo/mo_file.h"
 #endif
+#ifndef MO_THREAD_H
+#include	"mo/mo_thread.h"
+#endif
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4996)
@@ -36,7 +39,29 @@
 #include <time.h>
 #endif
 
+#ifndef MO_WIN32
+#include <sys/mman.h>
+#endif
+
+#if defined(MO_LINUX) || defined(LINUX)
+// major(), minor() and makedev()
+#include <sys/sysmacros.h>
+#endif
+
+#if (defined(MO_LINUX) || defined(LINUX)) && defined(__GLIBC__) \
+	&& (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+// copy_file_range() and sendfile()
+#define	MO_TAR_COPY_FILE	1
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
 #include <cstddef>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 
 namespace molib
@@ -874,7 +899,7 @@ bool moTar::tar_header_t::ConvertFrom(const moTarHeader& header)
 
 		}
 	}
-	snprintf(f_size, sizeof(f_size), "%0*o", static_cast<int>(sizeof(f_size - 1)), (unsigned int) size);	/* Flawfinder: ignore */
+	snprintf(f_size, sizeof(f_size), "%0*llo", static_cast<int>(sizeof(f_size) - 1), static_cast<unsigned long long>(size));	/* Flawfinder: ignore */
 
 	time(&now);
 	header.GetModifTime(now);
@@ -933,17 +958,35 @@ bool moTar::tar_header_t::ConvertTo(moTarHeader& header) const
 		return false;
 	}
 
+	// the strings are not nul terminated when they use the whole field
+	char name[sizeof(f_name) + 1], prefix[sizeof(f_prefix) + 1];	/* Flawfinder: ignore */
+	char linkname[sizeof(f_linkname) + 1];				/* Flawfinder: ignore */
+	char uname[sizeof(f_uname) + 1], gname[sizeof(f_gname) + 1];	/* Flawfinder: ignore */
+	memcpy(name, f_name, sizeof(f_name));				/* Flawfinder: ignore */
+	name[sizeof(f_name)] = '\0';
+	memcpy(prefix, f_prefix, sizeof(f_prefix));			/* Flawfinder: ignore */
+	prefix[sizeof(f_prefix)] = '\0';
+	memcpy(linkname, f_linkname, sizeof(f_linkname));		/* Flawfinder: ignore */
+	linkname[sizeof(f_linkname)] = '\0';
+	memcpy(uname, f_uname, sizeof(f_uname));			/* Flawfinder: ignore */
+	uname[sizeof(f_uname)] = '\0';
+	memcpy(gname, f_gname, sizeof(f_gname));			/* Flawfinder: ignore */
+	gname[sizeof(f_gname)] = '\0';
+
 	// now we take the data
 	header.SetType(f_typeflag);
-	if(f_prefix[0] == '\0') {
-		header.SetName(f_name);
+	if(prefix[0] == '\0') {
+		header.SetName(name);
 	}
 	else {
-		header.SetName(moWCString(f_prefix).FilenameChild(f_name));
+		header.SetName(moWCString(prefix).FilenameChild(name));
 	}
-	header.SetLinkTo(f_linkname);
-	header.SetUserName(f_uname);
-	header.SetGroupName(f_gname);
+	if(linkname[0] != '\0') {
+		// an empty link would prevent saving the header as a file
+		header.SetLinkTo(linkname);
+	}
+	header.SetUserName(uname);
+	header.SetGroupName(gname);
 	header.SetID(mowc::strtol(f_uid, 0, 8, sizeof(f_uid)), mowc::strtol(f_gid, 0, 8, sizeof(f_gid)));
 	header.SetMode(mowc::strtol(f_mode, 0, 8, sizeof(f_mode)));
 	header.SetSize(mowc::strtol(f_size, 0, 8, sizeof(f_size)));
@@ -1116,6 +1159,225 @@ moOStreamSPtr moOTar::Output(void) const
 
 
 
+namespace
+{
+
+// regular files up to this size are read ahead by the AppendDir() workers
+const size_t		TAR_PREFETCH_SIZE = 1024 * 1024;
+
+// number of entries the AppendDir() workers can be ahead of the writer
+const unsigned long	TAR_PREFETCH_WINDOW = 64;
+
+// the maximum number of AppendDir() workers
+const unsigned long	TAR_PREFETCH_WORKERS = 8;
+
+// files of at least that size get copied by the kernel when possible
+const size_t		TAR_DIRECT_COPY_SIZE = 1024 * 1024;
+
+
+/** \brief Copy a file to another without going through user space.
+ *
+ * This function copies size bytes from the current position of the
+ * input file descriptor to the output file descriptor at the specified
+ * offset. It first tries copy_file_range(2) and then sendfile(2).
+ *
+ * The input offset is moved by the number of bytes copied.
+ *
+ * \param[in] in_fd  The file descriptor to read from.
+ * \param[in] out_fd  The file descriptor to write to.
+ * \param[in] offset  The position where the data is written in out_fd.
+ * \param[in] size  The number of bytes to copy.
+ *
+ * \return The number of bytes copied, less than size when the system
+ *	cannot copy the rest (i.e. 0 when the files can't be copied
+ *	this way at all).
+ */
+size_t tar_copy_file(int in_fd, int out_fd, size_t offset, size_t size)
+{
+	size_t		total;
+
+	total = 0;
+
+#ifdef MO_TAR_COPY_FILE
+	ssize_t		r;
+	loff_t		out_offset;
+
+	out_offset = offset;
+	while(total < size) {
+		r = copy_file_range(in_fd, 0, out_fd, &out_offset, size - total, 0);
+		if(r <= 0) {
+			break;
+		}
+		total += r;
+	}
+
+	// older kernels do not support copies between file systems
+	if(total < size
+	&& lseek(out_fd, static_cast<off_t>(offset + total), SEEK_SET) == static_cast<off_t>(offset + total)) {
+		while(total < size) {
+			r = sendfile(out_fd, in_fd, 0, size - total);
+			if(r <= 0) {
+				break;
+			}
+			total += r;
+		}
+	}
+#endif
+
+	return total;
+}
+
+
+/** \brief Read ahead the entries saved by AppendDir().
+ *
+ * The AppendDir() function uses these runners to define the headers
+ * of the directory entries and read the small files while it writes
+ * the entries which are ready in the output tar file.
+ *
+ * The entries are saved in a window of TAR_PREFETCH_WINDOW slots.
+ * A runner only defines an entry which is at most that far from the
+ * last entry written so the memory used remains bounded.
+ */
+class tar_prefetch_runner : public moThread::moRunner
+{
+public:
+	struct slot_t {
+		moDirectory::moEntrySPtr	entry;
+		moTar::moTarHeader		header;
+		std::vector<char>		data;
+		bool				defined;	// header was defined by the runner
+		bool				prefetched;	// data holds the entire file
+		bool				ready;		// protected by batch_t::ready
+	};
+
+	struct batch_t {
+		const moDirectory *		dir;
+		const moTar::moTarHeader *	header;
+		moWCString			root;
+		std::vector<slot_t>		slots;
+		moMutex				mutex;		// protects next, written and stop
+		moMutex				ready;		// protects slot_t::ready and pending
+		unsigned long			count;
+		unsigned long			next;		// next entry to define
+		unsigned long			written;	// entries already written
+		int				pending;	// runners still running
+		bool				stop;
+	};
+
+				tar_prefetch_runner(batch_t& batch)
+					: f_batch(batch)
+				{
+				}
+
+	virtual bool		Run(void)
+				{
+					unsigned long	pos;
+
+					for(;;) {
+						{
+							moLockMutex lock(f_batch.mutex);
+							if(f_batch.stop || f_batch.next >= f_batch.count) {
+								break;
+							}
+							if(f_batch.next >= f_batch.written + TAR_PREFETCH_WINDOW) {
+								// the window is full, the writer is
+								// the bottleneck (note: a moMutex
+								// supports a single waiter)
+								pos = f_batch.count;
+							}
+							else {
+								pos = f_batch.next;
+								++f_batch.next;
+								f_batch.slots[pos % TAR_PREFETCH_WINDOW].entry = f_batch.dir->Get(pos);
+							}
+						}
+						if(pos == f_batch.count) {
+							std::this_thread::sleep_for(std::chrono::microseconds(200));
+							continue;
+						}
+
+						slot_t& slot = f_batch.slots[pos % TAR_PREFETCH_WINDOW];
+						try {
+							Prefetch(slot);
+						}
+						catch(...) {
+							// let the writer reproduce the error
+							slot.defined = false;
+							slot.prefetched = false;
+							slot.data.clear();
+						}
+
+						moLockMutex lock(f_batch.ready);
+						slot.ready = true;
+						f_batch.ready.Signal();
+					}
+
+					moLockMutex lock(f_batch.ready);
+					--f_batch.pending;
+					f_batch.ready.Signal();
+					return true;
+				}
+
+	static void		Wait(batch_t& batch, const std::vector<moThreadSPtr>& threads)
+				{
+					{
+						moLockMutex lock(batch.mutex);
+						batch.stop = true;
+					}
+					{
+						moLockMutex lock(batch.ready);
+						while(batch.pending > 0) {
+							batch.ready.Wait();
+						}
+					}
+					// let the threads finish their cleanup before
+					// the runners get released
+					for(size_t idx = 0; idx < threads.size(); ++idx) {
+						threads[idx]->Wait();
+					}
+				}
+
+private:
+	void			Prefetch(slot_t& slot)
+				{
+					moFile		input;
+					size_t		size;
+					char		type;
+
+					slot.defined = false;
+					slot.prefetched = false;
+					slot.header.Define(slot.entry, f_batch.root);
+					slot.header.CopyMost(*f_batch.header);
+					slot.defined = true;
+
+					type = REGTYPE;
+					slot.header.GetType(type);
+					if(type != REGTYPE && type != AREGTYPE && type != CONTTYPE) {
+						return;
+					}
+					if(!slot.header.GetSize(size) || size > TAR_PREFETCH_SIZE) {
+						return;
+					}
+					if(!input.Open(*slot.entry)) {
+						return;
+					}
+					slot.data.resize(size);
+					if(size > 0 && input.Read(&slot.data[0], size) != static_cast<int>(size)) {
+						// the writer will report the error
+						slot.data.clear();
+						return;
+					}
+					slot.prefetched = true;
+				}
+
+	batch_t&		f_batch;
+};
+
+
+}		// no name namespace
+
+
+
 
 
 
@@ -1229,21 +1491,7 @@ bool moOTar::AppendBuffer(const moTarHeader& header, const void *data, size_t si
 	}
 
 	// save the necessary zeroes at the end of the file
-	size_t l = sizeof(tar_header_t) - (size & -sizeof(tar_header_t));
-	if(l != sizeof(tar_header_t)) {
-#ifdef _MSC_VER
-		std::auto_ptr<char> end(new char[l]);
-		memset(end.get(), 0, l);
-		f_output->Write(end.get(), l);
-#else
-		// avoid malloc+free with g++
-		char end[l];
-		memset(end, 0, l);
-		f_output->Write(end, l);
-#endif
-	}
-
-	return true;
+	return WritePadding(size);
 }
 
 
@@ -1306,10 +1554,8 @@ SEE ALSO
 */
 bool moOTar::AppendStream(const moTarHeader& header, moIStream& input)
 {
-#define	BSZ		(BUFSIZ > sizeof(tar_header_t) ? BUFSIZ : sizeof(tar_header_t))
 	tar_header_t	h;
-	char		buffer[BSZ];	/* Flawfinder: ignore */
-	size_t		l, m, size;
+	size_t		size;
 
 	if(!header.GetSize(size)) {
 		errno = EINVAL;
@@ -1324,7 +1570,56 @@ bool moOTar::AppendStream(const moTarHeader& header, moIStream& input)
 		return false;
 	}
 
-	// save the data
+	return WriteData(input, size);
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moOTar
+
+NAME
+
+	private:
+	WriteData - copy the data of a tar member
+	WritePadding - align the output on the next tar block
+
+SYNOPSIS
+
+	bool WriteData(moIStream& input, size_t size);
+	bool WritePadding(size_t size);
+
+PARAMETERS
+
+	input - the input stream to read from
+	size - the size of the data of the tar member
+
+DESCRIPTION
+
+	The WriteData() function reads size bytes from the input
+	stream and writes them in the output tar file followed by
+	the zeroes necessary to end the member on a block boundary.
+
+	The WritePadding() function only writes these zeroes.
+
+RETURN VALUE
+
+	true when all the data was copied, false otherwise
+
+SEE ALSO
+
+	AppendBuffer, AppendStream
+
+*/
+bool moOTar::WriteData(moIStream& input, size_t size)
+{
+#define	BSZ		(BUFSIZ > sizeof(tar_header_t) ? BUFSIZ : sizeof(tar_header_t))
+	char		buffer[BSZ];	/* Flawfinder: ignore */
+	size_t		l, m;
+
 	while(size > 0) {
 		l = moMin(size, BSZ);
 		if(input.Read(buffer, l) != static_cast<int>(l)) {
@@ -1347,6 +1642,21 @@ bool moOTar::AppendStream(const moTarHeader& header, moIStream& input)
 }
 
 
+bool moOTar::WritePadding(size_t size)
+{
+	char		end[sizeof(tar_header_t)];	/* Flawfinder: ignore */
+	size_t		l;
+
+	l = (sizeof(tar_header_t) - size % sizeof(tar_header_t)) % sizeof(tar_header_t);
+	if(l == 0) {
+		return true;
+	}
+	memset(end, 0, l);
+
+	return f_output->Write(end, l) == static_cast<int>(l);
+}
+
+
 
 /************************************************************ DOC:
 
@@ -1379,6 +1689,11 @@ DESCRIPTION
 	It just opens the file for you before to call the
 	AppendStream() function.
 
+	When the output is an unfiltered moFile and the file is
+	large (at least 1Mb), the data is copied by the kernel
+	(copy_file_range(2) or sendfile(2)) when the system supports
+	it. The result is the same as with AppendStream().
+
 NOTE
 
 	The header isn't modified by the function, thus it has to
@@ -1402,7 +1717,38 @@ bool moOTar::AppendFile(const moTarHeader& header, const moWCString& filename)
 	if(!input.Open(filename)) {
 		return false;
 	}
-	return AppendStream(header, input);
+
+	moFile *output = dynamic_cast<moFile *>(static_cast<moOStream *>(f_output));
+	size_t size;
+	if(output == 0 || output->OutputFilter() != 0
+	|| !header.GetSize(size) || size < TAR_DIRECT_COPY_SIZE) {
+		return AppendStream(header, input);
+	}
+
+	tar_header_t h;
+	if(!h.ConvertFrom(header)) {
+		return false;
+	}
+	if(f_output->Write(&h, sizeof(h)) != sizeof(h)) {
+		return false;
+	}
+	if(output->Flush() < 0) {
+		return false;
+	}
+
+	// the kernel may copy only part of the file; restart from the
+	// last complete block so WriteData() pads the end properly
+	size_t pos = f_output->WritePosition();
+	size_t copied = tar_copy_file(input.FileDescriptor(), output->FileDescriptor(), pos, size);
+	copied &= -static_cast<long>(sizeof(tar_header_t));
+	if(copied == size) {
+		f_output->WritePosition(pos + size);
+		return true;
+	}
+	f_output->WritePosition(pos + copied);
+	input.ReadPosition(copied);
+
+	return WriteData(input, size - copied);
 }
 
 
@@ -1463,6 +1809,12 @@ DESCRIPTION
 	overwritten is AcceptFile(). This can also be reached by
 	creating your own moDirectory list.
 
+	When threads are available, worker threads define the headers
+	and read the small files (up to 1Mb) ahead of the writer. The
+	entries are still written in the directory order and
+	AcceptFile() is still called from the calling thread, thus
+	the output is exactly the same as without threads.
+
 NOTE
 
 	Please, see the AppendStream() and moTarHeader::Define
@@ -1498,6 +1850,18 @@ bool moOTar::AppendDir(const moTarHeader& header, const moDirectory& dir, const
 	char			type;
 
 	max = dir.Count();
+
+	unsigned long workers = std::thread::hardware_concurrency();
+	if(workers > TAR_PREFETCH_WORKERS) {
+		workers = TAR_PREFETCH_WORKERS;
+	}
+	if(workers > max) {
+		workers = max;
+	}
+	if(moThread::ThreadingAvailable() && workers >= 2) {
+		return AppendDirParallel(header, dir, root, workers);
+	}
+
 	pos = 0;
 	while(pos < max) {
 		moDirectory::moEntrySPtr entry = dir.Get(pos);
@@ -1533,6 +1897,107 @@ bool moOTar::AppendDir(const moTarHeader& header, const moDirectory& dir, const
 
 
 
+bool moOTar::AppendDirParallel(const moTarHeader& header, const moDirectory& dir, const moWCString& root, unsigned long workers)
+{
+	tar_prefetch_runner::batch_t	batch;
+	unsigned long			idx, pos;
+	char				type;
+	bool				result;
+
+	batch.dir = &dir;
+	batch.header = &header;
+	batch.root = root;
+	batch.slots.resize(TAR_PREFETCH_WINDOW);
+	for(idx = 0; idx < TAR_PREFETCH_WINDOW; ++idx) {
+		batch.slots[idx].defined = false;
+		batch.slots[idx].prefetched = false;
+		batch.slots[idx].ready = false;
+	}
+	batch.count = dir.Count();
+	batch.next = 0;
+	batch.written = 0;
+	batch.pending = static_cast<int>(workers);
+	batch.stop = false;
+
+	std::vector<moSmartPtr<tar_prefetch_runner> > runners;
+	std::vector<moThreadSPtr> threads;
+	for(idx = 0; idx < workers; ++idx) {
+		runners.push_back(new tar_prefetch_runner(batch));
+	}
+	for(idx = 0; idx < workers; ++idx) {
+		moThreadSPtr thread(new moThread("moOTar", runners[idx]));
+		if(thread->Start()) {
+			threads.push_back(thread);
+		}
+		else {
+			// this runner will never run
+			moLockMutex lock(batch.ready);
+			--batch.pending;
+		}
+	}
+	// write the entries in order as they become ready
+	result = true;
+	try {
+		for(pos = 0; pos < batch.count && result; ++pos) {
+			tar_prefetch_runner::slot_t& slot = batch.slots[pos % TAR_PREFETCH_WINDOW];
+			{
+				moLockMutex lock(batch.ready);
+				while(!slot.ready && batch.pending > 0) {
+					batch.ready.Wait();
+				}
+				if(!slot.ready) {
+					// no runner is left to define this entry
+					slot.entry = dir.Get(pos);
+					slot.defined = false;
+					slot.prefetched = false;
+				}
+			}
+			if(!slot.defined) {
+				// the runner failed, redo the work here
+				slot.header.Define(slot.entry, root);
+				slot.header.CopyMost(header);
+			}
+			if(AcceptFile(slot.header, slot.entry)) {
+				type = REGTYPE;
+				slot.header.GetType(type);
+				switch(type) {
+				case REGTYPE:
+				case AREGTYPE:
+				case CONTTYPE:
+					if(slot.prefetched) {
+						result = AppendBuffer(slot.header, slot.data.empty() ? 0 : &slot.data[0], slot.data.size());
+					}
+					else {
+						result = AppendFile(slot.header, slot.entry);
+					}
+					break;
+
+				default:
+					result = AppendHeader(slot.header);
+					break;
+
+				}
+			}
+
+			// release the slot for the next entries
+			slot.entry = 0;
+			std::vector<char>().swap(slot.data);
+			{
+				moLockMutex lock(batch.ready);
+				slot.ready = false;
+			}
+			moLockMutex lock(batch.mutex);
+			batch.written = pos + 1;
+		}
+	}
+	catch(...) {
+		tar_prefetch_runner::Wait(batch, threads);
+		throw;
+	}
+	tar_prefetch_runner::Wait(batch, threads);
+
+	return result;
+}
 bool moOTar::AcceptFile(const moTarHeader& header, const moWCString& filename)
 {
 	// accept all the files by default
@@ -1541,6 +2006,1307 @@ bool moOTar::AcceptFile(const moTarHeader& header, const moWCString& filename)
 
 
 
+
+/************************************************************ DOC:
+
+CLASS
+
+	moITar
+
+NAME
+
+	Constructor - creates an moITar object
+	Destructor - cleans up an moITar object
+
+SYNOPSIS
+
+	moITar(void);
+	moITar(moIStream *input);
+	~moITar();
+
+	private:
+	void Init(void);
+
+PARAMETERS
+
+	input - the tar input stream
+
+DESCRIPTION
+
+	The constructors initialize an input tar object. The input
+	stream can also be defined later with SetInput() or OpenFile().
+
+	The moITar object reads the headers of the archive only once
+	and saves the position and size of each member in an index.
+	A member can then be found by name in constant time and read
+	without going through the other members.
+
+	The input stream must support ReadPosition() (i.e. a file or
+	a memory file); a compressed archive has to be decompressed
+	first.
+
+SEE ALSO
+
+	SetInput, OpenFile, ReadIndex
+
+*/
+namespace
+{
+
+// the size of the blocks of a tar file
+const size_t		TAR_BLOCK_SIZE = 512;
+
+// the size of the buffer used to copy data
+const size_t		TAR_COPY_SIZE = 64 * 1024;
+
+
+struct tar_member_t {
+	size_t			header;		// offset of the ustar header
+	size_t			offset;		// offset of the data
+	size_t			size;
+	char			type;
+	moWCString		name;
+	moWCString		link_to;	// empty unless a link
+};
+
+
+// read part of a member from a stream seeked to the position
+class moTarMemberStream : public moIStream
+{
+public:
+				moTarMemberStream(moIStream *archive, const unsigned char *data, size_t offset, size_t size)
+					: f_archive(archive),
+					  f_data(data),
+					  f_offset(offset),
+					  f_size(size)
+				{
+				}
+
+	virtual size_t		InputSize(void) const
+				{
+					return f_size;
+				}
+
+protected:
+	virtual int		RawRead(void *buffer, size_t length)
+				{
+					int		r;
+
+					if(f_input_position >= f_size) {
+						return 0;
+					}
+					if(length > f_size - f_input_position) {
+						length = f_size - f_input_position;
+					}
+					if(f_data != 0) {
+						// mapped archive, no system call
+						memcpy(buffer, f_data + f_offset + f_input_position, length);	/* Flawfinder: ignore */
+						r = static_cast<int>(length);
+					}
+					else {
+						f_archive->ReadPosition(f_offset + f_input_position);
+						r = f_archive->Read(buffer, length);
+					}
+					if(r > 0) {
+						f_input_position += r;
+					}
+					return r;
+				}
+
+private:
+	moIStreamSPtr		f_archive;
+	const unsigned char *	f_data;
+	size_t			f_offset;
+	size_t			f_size;
+};
+
+
+// whether a member name stays within the extraction directory
+bool tar_safe_name(const moWCString& name)
+{
+	const mowc::wc_t	*s;
+
+	s = name.Data();
+	if(*s == '\0') {
+		return false;
+	}
+	while(*s != '\0') {
+		if(s[0] == '.' && s[1] == '.' && (s[2] == '/' || s[2] == '\0')) {
+			return false;
+		}
+		while(*s != '/' && *s != '\0') {
+			s++;
+		}
+		while(*s == '/') {
+			s++;
+		}
+	}
+
+	return true;
+}
+
+
+// the key used to search a member by name
+std::string tar_key(const moWCString& name)
+{
+	std::string		key(name.c_str());
+
+	while(key.length() > 1 && key[key.length() - 1] == '/') {
+		key.erase(key.length() - 1);
+	}
+	while(key.length() > 2 && key[0] == '.' && key[1] == '/') {
+		key.erase(0, 2);
+	}
+
+	return key;
+}
+
+}		// no name namespace
+
+
+/** \brief The index of the members of an input tar file.
+ *
+ * The index saves the position of the header and the data of each
+ * member along with its full name (which may come from a GNU long
+ * name or a pax extended header) and a hash map from the names to
+ * the members.
+ *
+ * When the archive was opened with OpenFile(), the whole file is also
+ * mapped in memory so the members can be accessed without a copy and
+ * read from any number of threads at once.
+ */
+class moITar::moIndex
+{
+public:
+	class moExtractRunner;
+
+				moIndex(void)
+				{
+					f_indexed = false;
+					f_map = 0;
+					f_map_size = 0;
+					f_archive_size = 0;
+					f_archive_mtime = 0;
+				}
+
+				~moIndex()
+				{
+					Unmap();
+				}
+
+	void			Clear(void);
+	void			Unmap(void);
+	bool			Map(const moWCString& filename);
+	bool			ReadBlock(moIStream *input, size_t position, void *buffer, size_t size) const;
+	bool			Scan(moIStream *input);
+	void			Add(const tar_member_t& member);
+	bool			Extract(unsigned long index, const moWCString& path, moIStream *input, bool directory_mode) const;
+
+	bool				f_indexed;
+	std::vector<tar_member_t>	f_members;
+	std::unordered_map<std::string, unsigned long>	f_names;
+
+	moWCString			f_filename;	// set by OpenFile()
+	unsigned char *			f_map;
+	size_t				f_map_size;
+	size_t				f_archive_size;	// 0 when unknown
+	time_t				f_archive_mtime;
+};
+
+
+void moITar::moIndex::Clear(void)
+{
+	f_indexed = false;
+	f_members.clear();
+	f_names.clear();
+}
+
+
+void moITar::moIndex::Unmap(void)
+{
+#ifndef MO_WIN32
+	if(f_map != 0) {
+		munmap(f_map, f_map_size);
+	}
+#endif
+	f_map = 0;
+	f_map_size = 0;
+}
+
+
+bool moITar::moIndex::Map(const moWCString& filename)
+{
+	struct stat	st;
+
+	Unmap();
+	f_archive_size = 0;
+	f_archive_mtime = 0;
+	if(stat(filename.c_str(), &st) != 0) {
+		return false;
+	}
+	f_archive_size = st.st_size;
+	f_archive_mtime = st.st_mtime;
+
+#ifndef MO_WIN32
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	if(st.st_size > 0) {
+		void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(map != MAP_FAILED) {
+			f_map = static_cast<unsigned char *>(map);
+			f_map_size = st.st_size;
+		}
+	}
+	close(fd);
+#endif
+
+	return true;
+}
+
+
+bool moITar::moIndex::ReadBlock(moIStream *input, size_t position, void *buffer, size_t size) const
+{
+	if(f_map != 0) {
+		if(position > f_map_size || size > f_map_size - position) {
+			return false;
+		}
+		memcpy(buffer, f_map + position, size);		/* Flawfinder: ignore */
+		return true;
+	}
+
+	if(input == 0) {
+		return false;
+	}
+	input->ReadPosition(position);
+	return input->Read(buffer, size) == static_cast<int>(size);
+}
+
+
+void moITar::moIndex::Add(const tar_member_t& member)
+{
+	// like tar, the last member with a given name wins
+	f_names[tar_key(member.name)] = static_cast<unsigned long>(f_members.size());
+	f_members.push_back(member);
+}
+
+
+bool moITar::moIndex::Scan(moIStream *input)
+{
+	tar_header_t		h;
+	moTarHeader		header;
+	tar_member_t		member;
+	moWCString		long_name, long_link;
+	size_t			position, size, pax_size, l;
+	char			type;
+	const unsigned char	*s;
+
+	Clear();
+	f_indexed = true;
+
+	position = 0;
+	pax_size = static_cast<size_t>(-1);
+	for(;;) {
+		if(!ReadBlock(input, position, &h, sizeof(h))) {
+			// missing end block
+			break;
+		}
+		s = reinterpret_cast<const unsigned char *>(&h);
+		for(l = 0; l < sizeof(h) && s[l] == 0; ++l);
+		if(l == sizeof(h)) {
+			// end of the archive
+			break;
+		}
+		if(!h.ConvertTo(header)) {
+			return false;
+		}
+		type = REGTYPE;
+		size = 0;
+		header.GetType(type);
+		header.GetSize(size);
+		if(pax_size != static_cast<size_t>(-1)) {
+			size = pax_size;
+		}
+
+		switch(type) {
+		case 'L':		// GNU long name of the next member
+		case 'K':		// GNU long link of the next member
+		case 'x':		// pax extended header of the next member
+			{
+				std::vector<char> data(size + 1);
+				if(!ReadBlock(input, position + TAR_BLOCK_SIZE, &data[0], size)) {
+					errno = EINVAL;
+					return false;
+				}
+				data[size] = '\0';
+				if(type == 'L') {
+					long_name = moWCString(&data[0], -1, mowc::MO_ENCODING_UTF8);
+				}
+				else if(type == 'K') {
+					long_link = moWCString(&data[0], -1, mowc::MO_ENCODING_UTF8);
+				}
+				else {
+					// records are "<length> <keyword>=<value>\n"
+					const char *r = &data[0];
+					const char *end = r + size;
+					while(r < end) {
+						char *e;
+						l = strtoul(r, &e, 10);
+						if(l == 0 || e == r || *e != ' ' || l > static_cast<size_t>(end - r)) {
+							break;
+						}
+						const char *keyword = e + 1;
+						const char *value = strchr(keyword, '=');
+						const char *last = r + l - 1;	// the '\n'
+						if(value != 0 && value < last) {
+							std::string key(keyword, value - keyword);
+							std::string v(value + 1, last - value - 1);
+							if(key == "path") {
+								long_name = moWCString(v.c_str(), -1, mowc::MO_ENCODING_UTF8);
+							}
+							else if(key == "linkpath") {
+								long_link = moWCString(v.c_str(), -1, mowc::MO_ENCODING_UTF8);
+							}
+							else if(key == "size") {
+								pax_size = strtoull(v.c_str(), 0, 10);
+							}
+						}
+						r += l;
+					}
+				}
+				// the pax size does not apply to the extension itself
+				if(type != 'x') {
+					break;
+				}
+				header.GetSize(size);
+			}
+			break;
+
+		case 'g':		// pax global header, ignored
+			break;
+
+		default:
+			member.header = position;
+			member.offset = position + TAR_BLOCK_SIZE;
+			member.size = size;
+			member.type = type == '\0' ? REGTYPE : type;
+			member.name = long_name;
+			if(member.name.IsEmpty()) {
+				header.GetName(member.name);
+			}
+			member.link_to = long_link;
+			if(member.link_to.IsEmpty()) {
+				header.GetLinkTo(member.link_to);
+			}
+			switch(member.type) {
+			case REGTYPE:
+			case CONTTYPE:
+				break;
+
+			default:
+				// only regular files have data (a hard link
+				// may have a size which is not saved in the
+				// archive)
+				size = 0;
+				break;
+
+			}
+			member.size = size;
+			Add(member);
+
+			long_name.Empty();
+			long_link.Empty();
+			pax_size = static_cast<size_t>(-1);
+			break;
+
+		}
+
+		position += TAR_BLOCK_SIZE + ((size + TAR_BLOCK_SIZE - 1) & -TAR_BLOCK_SIZE);
+	}
+
+	return true;
+}
+
+
+bool moITar::moIndex::Extract(unsigned long index, const moWCString& path, moIStream *input, bool directory_mode) const
+{
+	const tar_member_t	*member;
+	moWCString		filename;
+	moFile			output;
+	size_t			size, offset, l;
+	mode_t			mode;
+	int			r;
+
+	member = &f_members[index];
+	if(!tar_safe_name(member->name)) {
+		errno = EACCES;
+		return false;
+	}
+	filename = path.FilenameChild(member->name);
+
+	// the modes are saved in the header, not the index
+	mode = member->type == DIRTYPE ? 0755 : 0644;
+	{
+		tar_header_t	h;
+		moTarHeader	header;
+		if(ReadBlock(input, member->header, &h, sizeof(h)) && h.ConvertTo(header)) {
+			header.GetMode(mode);
+		}
+	}
+	mode &= 07777;
+
+	switch(member->type) {
+	case DIRTYPE:
+		if(!moFile::CreateDir(filename, 0700) && errno != EEXIST) {
+			return false;
+		}
+		if(directory_mode) {
+			chmod(filename.c_str(), mode);
+		}
+		return true;
+
+	case REGTYPE:
+	case CONTTYPE:
+		break;
+
+#ifndef MO_WIN32
+	case SYMTYPE:
+	case LNKTYPE:
+		if(!moFile::CreateDir(filename.FilenameDirname(), 0755) && errno != EEXIST) {
+			return false;
+		}
+		unlink(filename.c_str());
+		if(member->type == SYMTYPE) {
+			return symlink(member->link_to.c_str(), filename.c_str()) == 0;
+		}
+		if(!tar_safe_name(member->link_to)) {
+			errno = EACCES;
+			return false;
+		}
+		return link(path.FilenameChild(member->link_to).c_str(), filename.c_str()) == 0;
+#endif
+
+	default:
+		// devices, FIFOs, etc. are not created
+		return true;
+
+	}
+
+	if(!output.Open(filename, moFile::MO_FILE_MODE_WRITE | moFile::MO_FILE_MODE_CREATE | moFile::MO_FILE_MODE_CREATEDIR)) {
+		return false;
+	}
+	size = member->size;
+	offset = member->offset;
+	if(f_map != 0) {
+		// write straight from the mapped archive
+		while(size > 0) {
+			l = moMin(size, TAR_COPY_SIZE);
+			if(offset > f_map_size || l > f_map_size - offset) {
+				errno = EINVAL;
+				return false;
+			}
+			if(output.Write(f_map + offset, l) != static_cast<int>(l)) {
+				return false;
+			}
+			offset += l;
+			size -= l;
+		}
+	}
+	else {
+		std::vector<char> buffer(moMin(size, TAR_COPY_SIZE) + 1);
+		input->ReadPosition(offset);
+		while(size > 0) {
+			l = moMin(size, TAR_COPY_SIZE);
+			r = input->Read(&buffer[0], l);
+			if(r != static_cast<int>(l)) {
+				errno = EINVAL;
+				return false;
+			}
+			if(output.Write(&buffer[0], l) != static_cast<int>(l)) {
+				return false;
+			}
+			size -= l;
+		}
+	}
+	if(output.Flush() < 0) {
+		return false;
+	}
+	output.Close();
+	chmod(filename.c_str(), mode);
+
+	return true;
+}
+
+
+// extract regular files until none are left
+class moITar::moIndex::moExtractRunner : public moThread::moRunner
+{
+public:
+	struct batch_t {
+		const moIndex *			index;
+		const std::vector<unsigned long> *	files;
+		moWCString			path;
+		moMutex				mutex;
+		unsigned long			next;		// next file to extract
+		int				pending;	// runners still running
+		bool				failed;
+		int				error_number;
+	};
+
+				moExtractRunner(batch_t& batch)
+					: f_batch(batch)
+				{
+				}
+
+	virtual bool		Run(void)
+				{
+					moFileSPtr	input;
+					unsigned long	idx;
+					bool		result;
+
+					// each thread needs its own file position
+					if(f_batch.index->f_map == 0) {
+						input = new moFile;
+						if(!input->Open(f_batch.index->f_filename)) {
+							Fail(errno);
+						}
+					}
+					for(;;) {
+						{
+							moLockMutex lock(f_batch.mutex);
+							if(f_batch.failed || f_batch.next >= f_batch.files->size()) {
+								break;
+							}
+							idx = (*f_batch.files)[f_batch.next];
+							++f_batch.next;
+						}
+						try {
+							result = f_batch.index->Extract(idx, f_batch.path, input, false);
+						}
+						catch(const moException& e) {
+							errno = e.Errno();
+							result = false;
+						}
+						if(!result) {
+							Fail(errno);
+						}
+					}
+
+					moLockMutex lock(f_batch.mutex);
+					--f_batch.pending;
+					f_batch.mutex.Signal();
+					return true;
+				}
+
+private:
+	void			Fail(int error_number)
+				{
+					moLockMutex lock(f_batch.mutex);
+					if(!f_batch.failed) {
+						f_batch.failed = true;
+						f_batch.error_number = error_number;
+					}
+				}
+
+	batch_t&		f_batch;
+};
+
+moITar::moITar(void)
+{
+	Init();
+}
+
+
+moITar::moITar(moIStream *input)
+{
+	Init();
+	SetInput(input);
+}
+
+
+void moITar::Init(void)
+{
+	//f_input -- auto-init to 0
+	f_index = new moIndex;
+}
+
+
+moITar::~moITar()
+{
+	delete f_index;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moITar
+
+NAME
+
+	SetInput - sets the input to the specified stream
+	OpenFile - open a tar file
+	Input - get the current input stream
+
+SYNOPSIS
+
+	void SetInput(moIStream *input);
+	bool OpenFile(const moWCString& filename);
+	moIStreamSPtr Input(void) const;
+
+PARAMETERS
+
+	input - the new input stream
+	filename - the name of the tar file to read
+
+DESCRIPTION
+
+	The SetInput() function assigns an input stream to the input
+	tar object. The stream has to support ReadPosition().
+
+	The OpenFile() function opens the named file and uses it as
+	the input. The file is also mapped in memory (when the system
+	supports it) which makes MemberData() available, lets the
+	index be built without reading the file blocks through the
+	stream and lets ExtractAll() extract the files from several
+	threads.
+
+	Either function clears the current index. It is built again
+	from the new input the first time it is needed unless
+	LoadIndex() is called first.
+
+	The Input() function returns the current input stream.
+
+RETURN VALUE
+
+	OpenFile() returns false when the file cannot be opened.
+
+SEE ALSO
+
+	ReadIndex, LoadIndex, MemberData, ExtractAll
+
+*/
+void moITar::SetInput(moIStream *input)
+{
+	f_index->Clear();
+	f_index->Unmap();
+	f_index->f_filename.Empty();
+	f_index->f_archive_size = input == 0 ? 0 : input->InputSize();
+	f_index->f_archive_mtime = 0;
+
+	f_input = input;
+}
+
+
+bool moITar::OpenFile(const moWCString& filename)
+{
+	moFileSPtr	file;
+
+	file = new moFile;
+	if(!file->Open(filename)) {
+		return false;
+	}
+	SetInput(file);
+
+	f_index->f_filename = filename;
+	f_index->Map(filename);
+
+	return true;
+}
+
+
+moIStreamSPtr moITar::Input(void) const
+{
+	return f_input;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moITar
+
+NAME
+
+	ReadIndex - read the headers of the archive
+	LoadIndex - load a previously saved index
+	SaveIndex - save the index in a sidecar file
+
+SYNOPSIS
+
+	bool ReadIndex(void);
+	bool LoadIndex(const moWCString& filename);
+	bool SaveIndex(const moWCString& filename) const;
+
+PARAMETERS
+
+	filename - the name of the index file
+
+DESCRIPTION
+
+	The ReadIndex() function reads all the headers of the input
+	archive (skipping the data of the members) and saves the
+	position of each member in the index. It is automatically
+	called the first time a member is searched, so it only needs
+	to be called to read the headers at a specific time or
+	again once the archive changed.
+
+	The GNU long names and links and the pax path, linkpath
+	and size records are applied to the member they precede.
+
+	The SaveIndex() function saves the index in a file so the
+	next time the same archive is opened, LoadIndex() can be
+	used instead of reading all the headers.
+
+	The saved index includes the size of the archive (and its
+	modification time when it was opened with OpenFile()) and
+	LoadIndex() fails when these do not match the current input.
+
+RETURN VALUE
+
+	ReadIndex() returns false when an invalid header is found,
+	the members found before that header are still available.
+
+	LoadIndex() returns false when the file cannot be read, is
+	not an index or does not correspond to the current input.
+	The index is then cleared.
+
+	SaveIndex() returns false when the file cannot be written.
+
+SEE ALSO
+
+	SetInput, OpenFile, Find
+
+*/
+bool moITar::ReadIndex(void)
+{
+	return f_index->Scan(f_input);
+}
+
+
+bool moITar::LoadIndex(const moWCString& filename)
+{
+	moFile		file;
+	tar_member_t	member;
+	unsigned long	archive_size, archive_mtime, name_length, link_length, type;
+	size_t		size;
+	const char	*s, *end;
+	char		*e;
+
+	f_index->Clear();
+
+	if(!file.Open(filename)) {
+		return false;
+	}
+	size = file.Size();
+	std::vector<char> data(size + 1);
+	if(size > 0 && file.Read(&data[0], size) != static_cast<int>(size)) {
+		return false;
+	}
+	data[size] = '\0';
+
+	s = &data[0];
+	end = s + size;
+	if(sscanf(s, "moITar index 1 %lu %lu\n", &archive_size, &archive_mtime) != 2) {
+		errno = EINVAL;
+		return false;
+	}
+	if((f_index->f_archive_size != 0 && archive_size != f_index->f_archive_size)
+	|| (f_index->f_archive_mtime != 0 && static_cast<time_t>(archive_mtime) != f_index->f_archive_mtime)) {
+		// the archive changed
+		errno = EINVAL;
+		return false;
+	}
+	s = strchr(s, '\n');
+
+	// one member per line:
+	// <header> <offset> <size> <type> <name length> <link length> <name><link>
+	while(s != 0 && ++s < end) {
+		member.header = strtoul(s, &e, 10);
+		member.offset = strtoul(e, &e, 10);
+		member.size = strtoul(e, &e, 10);
+		type = strtoul(e, &e, 10);
+		name_length = strtoul(e, &e, 10);
+		link_length = strtoul(e, &e, 10);
+		if(*e != ' ' || name_length + link_length > static_cast<unsigned long>(end - e - 1)) {
+			f_index->Clear();
+			errno = EINVAL;
+			return false;
+		}
+		e++;
+		member.type = static_cast<char>(type);
+		member.name = moWCString(e, static_cast<int>(name_length), mowc::MO_ENCODING_UTF8);
+		member.link_to = moWCString(e + name_length, static_cast<int>(link_length), mowc::MO_ENCODING_UTF8);
+		f_index->Add(member);
+		s = e + name_length + link_length;
+		if(*s != '\n') {
+			f_index->Clear();
+			errno = EINVAL;
+			return false;
+		}
+	}
+	f_index->f_indexed = true;
+
+	return true;
+}
+
+
+bool moITar::SaveIndex(const moWCString& filename) const
+{
+	moFile			file;
+	unsigned long		idx, max;
+	std::string		data;
+	char			buf[256];	/* Flawfinder: ignore */
+
+	if(!f_index->f_indexed) {
+		f_index->Scan(f_input);
+	}
+
+	snprintf(buf, sizeof(buf), "moITar index 1 %lu %lu\n",			/* Flawfinder: ignore */
+			static_cast<unsigned long>(f_index->f_archive_size),
+			static_cast<unsigned long>(f_index->f_archive_mtime));
+	data = buf;
+	max = static_cast<unsigned long>(f_index->f_members.size());
+	for(idx = 0; idx < max; ++idx) {
+		const tar_member_t& member = f_index->f_members[idx];
+		std::string name(member.name.c_str());
+		std::string link_to(member.link_to.c_str());
+		snprintf(buf, sizeof(buf), "%lu %lu %lu %d %lu %lu ",			/* Flawfinder: ignore */
+				static_cast<unsigned long>(member.header),
+				static_cast<unsigned long>(member.offset),
+				static_cast<unsigned long>(member.size),
+				static_cast<int>(static_cast<unsigned char>(member.type)),
+				static_cast<unsigned long>(name.length()),
+				static_cast<unsigned long>(link_to.length()));
+		data += buf;
+		data += name;
+		data += link_to;
+		data += '\n';
+	}
+
+	if(!file.Open(filename, moFile::MO_FILE_MODE_WRITE | moFile::MO_FILE_MODE_CREATE)) {
+		return false;
+	}
+	if(file.Write(data.data(), data.length()) != static_cast<int>(data.length())) {
+		return false;
+	}
+
+	return file.Flush() >= 0;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moITar
+
+NAME
+
+	Count - the number of members in the archive
+	Find - search a member by name
+	GetName - the name of a member
+	GetSize - the size of a member
+	GetHeader - the header of a member
+
+SYNOPSIS
+
+	unsigned long Count(void) const;
+	long Find(const moWCString& name) const;
+	const moWCString& GetName(unsigned long index) const;
+	size_t GetSize(unsigned long index) const;
+	bool GetHeader(unsigned long index, moTarHeader& header) const;
+
+PARAMETERS
+
+	name - the name of the member to search
+	index - the index of a member, from 0 to Count() - 1
+	header - the header receiving the member information
+
+DESCRIPTION
+
+	These functions give access to the index of the archive. The
+	first call reads the index unless ReadIndex() or LoadIndex()
+	was called first.
+
+	The Find() function uses a hash table and thus does not depend
+	on the number of members. A "./" at the start and a "/" at the
+	end of the name are ignored. When the same name appears more
+	than once, the last member is returned (as tar would extract
+	it last.)
+
+	The GetHeader() function reads the header of the member (one
+	block read) to return all the information available. The
+	name, link and size are the ones found in the index.
+
+RETURN VALUE
+
+	Find() returns the index of the member or -1 when not found.
+
+	GetHeader() returns false when the header cannot be read.
+
+ERRORS
+
+	An moError(MO_ERROR_OVERFLOW) is thrown when the index is out
+	of bounds.
+
+SEE ALSO
+
+	ReadIndex, OpenMember, MemberData, Extract
+
+*/
+unsigned long moITar::Count(void) const
+{
+	if(!f_index->f_indexed) {
+		f_index->Scan(f_input);
+	}
+
+	return static_cast<unsigned long>(f_index->f_members.size());
+}
+
+
+long moITar::Find(const moWCString& name) const
+{
+	if(!f_index->f_indexed) {
+		f_index->Scan(f_input);
+	}
+
+	std::unordered_map<std::string, unsigned long>::const_iterator it(f_index->f_names.find(tar_key(name)));
+	if(it == f_index->f_names.end()) {
+		return -1;
+	}
+
+	return static_cast<long>(it->second);
+}
+
+
+const moWCString& moITar::GetName(unsigned long index) const
+{
+	if(index >= Count()) {
+		throw moError(MO_ERROR_OVERFLOW, "moITar::GetName(): index %lu out of bounds", index);
+	}
+
+	return f_index->f_members[index].name;
+}
+
+
+size_t moITar::GetSize(unsigned long index) const
+{
+	if(index >= Count()) {
+		throw moError(MO_ERROR_OVERFLOW, "moITar::GetSize(): index %lu out of bounds", index);
+	}
+
+	return f_index->f_members[index].size;
+}
+
+
+bool moITar::GetHeader(unsigned long index, moTarHeader& header) const
+{
+	tar_header_t	h;
+
+	if(index >= Count()) {
+		throw moError(MO_ERROR_OVERFLOW, "moITar::GetHeader(): index %lu out of bounds", index);
+	}
+
+	const tar_member_t& member = f_index->f_members[index];
+	if(!f_index->ReadBlock(f_input, member.header, &h, sizeof(h))
+	|| !h.ConvertTo(header)) {
+		return false;
+	}
+	header.SetName(member.name);
+	if(!member.link_to.IsEmpty()) {
+		header.SetLinkTo(member.link_to);
+	}
+	header.SetSize(member.size);
+
+	return true;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moITar
+
+NAME
+
+	OpenMember - read a member as a stream
+	MemberData - get a pointer to the data of a member
+
+SYNOPSIS
+
+	moIStreamSPtr OpenMember(unsigned long index) const;
+	const void *MemberData(unsigned long index, size_t& size) const;
+
+PARAMETERS
+
+	index - the index of a member, from 0 to Count() - 1
+	size - receives the size of the member
+
+DESCRIPTION
+
+	The OpenMember() function returns a stream limited to the data
+	of the specified member. Its InputSize() is the size of the
+	member and it returns the end of the file once all the data
+	was read.
+
+	When the archive is mapped in memory, the stream reads from the
+	map. Otherwise it reads from the input stream of this archive,
+	which thus should not be used by more than one thread at a time.
+
+	The MemberData() function returns a pointer to the data of the
+	member directly in the mapped archive. It is valid until the
+	input of this moITar object changes or the object is destroyed.
+
+RETURN VALUE
+
+	MemberData() returns a null pointer when the archive is not
+	mapped in memory (i.e. it was not opened with OpenFile() or
+	the system cannot map it.)
+
+ERRORS
+
+	An moError(MO_ERROR_OVERFLOW) is thrown when the index is out
+	of bounds.
+
+SEE ALSO
+
+	OpenFile, Find
+
+*/
+moIStreamSPtr moITar::OpenMember(unsigned long index) const
+{
+	if(index >= Count()) {
+		throw moError(MO_ERROR_OVERFLOW, "moITar::OpenMember(): index %lu out of bounds", index);
+	}
+
+	const tar_member_t& member = f_index->f_members[index];
+	if(f_index->f_map != 0 && (member.offset > f_index->f_map_size || member.size > f_index->f_map_size - member.offset)) {
+		// truncated archive
+		return new moTarMemberStream(f_input, 0, member.offset, member.size);
+	}
+
+	return new moTarMemberStream(f_input, f_index->f_map, member.offset, member.size);
+}
+
+
+const void *moITar::MemberData(unsigned long index, size_t& size) const
+{
+	if(index >= Count()) {
+		throw moError(MO_ERROR_OVERFLOW, "moITar::MemberData(): index %lu out of bounds", index);
+	}
+
+	const tar_member_t& member = f_index->f_members[index];
+	size = member.size;
+	if(f_index->f_map == 0
+	|| member.offset > f_index->f_map_size
+	|| member.size > f_index->f_map_size - member.offset) {
+		return 0;
+	}
+
+	return f_index->f_map + member.offset;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moITar
+
+NAME
+
+	Extract - extract one member
+	ExtractAll - extract all the members
+
+SYNOPSIS
+
+	bool Extract(unsigned long index, const moWCString& path) const;
+	bool ExtractAll(const moWCString& path) const;
+
+PARAMETERS
+
+	index - the index of a member, from 0 to Count() - 1
+	path - the directory where the members are created
+
+DESCRIPTION
+
+	The Extract() function creates the specified member under the
+	path directory, creating the missing parent directories.
+
+	The ExtractAll() function extracts all the members. The
+	directories are created first, then the regular files and
+	finally the links. The mode of the directories is set last so
+	read-only directories can be extracted.
+
+	When threads are available and the archive was opened with
+	OpenFile(), the regular files are extracted by one thread per
+	core, each reading from the mapped archive (or its own file
+	when it could not be mapped.)
+
+	Regular files, directories and (except under MS-Windows)
+	symbolic and hard links are extracted; the other types of
+	members are skipped. The modes are restored, not the owners.
+
+	A member with ".." in its name is not extracted.
+
+RETURN VALUE
+
+	Both functions return false if a member cannot be extracted
+	and errno is set accordingly. ExtractAll() stops on the first
+	error.
+
+ERRORS
+
+	An moError(MO_ERROR_OVERFLOW) is thrown when the index is out
+	of bounds.
+
+SEE ALSO
+
+	OpenFile, Find
+
+*/
+bool moITar::Extract(unsigned long index, const moWCString& path) const
+{
+	if(index >= Count()) {
+		throw moError(MO_ERROR_OVERFLOW, "moITar::Extract(): index %lu out of bounds", index);
+	}
+
+	return f_index->Extract(index, path, f_input, true);
+}
+
+
+bool moITar::ExtractAll(const moWCString& path) const
+{
+	unsigned long		idx, max, workers;
+	std::vector<unsigned long> files;
+
+	max = Count();
+
+	// directories first so the threads do not race to create them
+	for(idx = 0; idx < max; ++idx) {
+		switch(f_index->f_members[idx].type) {
+		case DIRTYPE:
+			if(!f_index->Extract(idx, path, f_input, false)) {
+				return false;
+			}
+			break;
+
+		case REGTYPE:
+		case CONTTYPE:
+			if(tar_safe_name(f_index->f_members[idx].name)
+			&& !moFile::CreateDir(path.FilenameChild(f_index->f_members[idx].name).FilenameDirname(), 0755)
+			&& errno != EEXIST) {
+				return false;
+			}
+			files.push_back(idx);
+			break;
+
+		}
+	}
+
+	workers = std::thread::hardware_concurrency();
+	if(workers > files.size()) {
+		workers = static_cast<unsigned long>(files.size());
+	}
+	if(!moThread::ThreadingAvailable() || workers < 2
+	|| (f_index->f_map == 0 && f_index->f_filename.IsEmpty())) {
+		for(idx = 0; idx < files.size(); ++idx) {
+			if(!f_index->Extract(files[idx], path, f_input, false)) {
+				return false;
+			}
+		}
+	}
+	else {
+		moIndex::moExtractRunner::batch_t batch;
+		batch.index = f_index;
+		batch.files = &files;
+		batch.path = path;
+		batch.next = 0;
+		batch.pending = static_cast<int>(workers);
+		batch.failed = false;
+		batch.error_number = 0;
+
+		std::vector<moSmartPtr<moIndex::moExtractRunner> > runners;
+		std::vector<moThreadSPtr> threads;
+		for(idx = 0; idx < workers; ++idx) {
+			runners.push_back(new moIndex::moExtractRunner(batch));
+		}
+		for(idx = 0; idx < workers; ++idx) {
+			moThreadSPtr thread(new moThread("moITar", runners[idx]));
+			if(thread->Start()) {
+				threads.push_back(thread);
+			}
+			else {
+				// extract the remaining files from here
+				runners[idx]->Run();
+			}
+		}
+
+		{
+			moLockMutex lock(batch.mutex);
+			while(batch.pending > 0) {
+				batch.mutex.Wait();
+			}
+		}
+		// let the threads finish their cleanup before the
+		// runners get released
+		for(idx = 0; idx < threads.size(); ++idx) {
+			threads[idx]->Wait();
+		}
+
+		if(batch.failed) {
+			errno = batch.error_number;
+			return false;
+		}
+	}
+
+	// links once their target exists
+	for(idx = 0; idx < max; ++idx) {
+		switch(f_index->f_members[idx].type) {
+		case DIRTYPE:
+		case REGTYPE:
+		case CONTTYPE:
+			break;
+
+		default:
+			if(!f_index->Extract(idx, path, f_input, false)) {
+				return false;
+			}
+			break;
+
+		}
+	}
+
+	// the directory modes last in case some are read-only
+	for(idx = max; idx > 0; --idx) {
+		if(f_index->f_members[idx - 1].type == DIRTYPE) {
+			if(!f_index->Extract(idx - 1, path, f_input, true)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+
+
 };			// namespace molib;
 
 // vim: ts=8
@@ -284,6 +284,7 @@ NAME
 	IsRunning - check whether this thread is currently running
 	Start - start the thread
 	Stop - stop the thread and eventually wait for it to be stopped
+	Wait - wait for the thread to end
 	Continue - whether the Stop() function was called
 
 SYNOPSIS
@@ -291,6 +292,7 @@ SYNOPSIS
 	virtual bool IsRunning(void) const;
 	bool Start(run_count_t run_count = RUN_COUNT_DEFAULT);
 	void Stop(bool wait = false);
+	void Wait(void) const;
 	bool Continue(void) const;
 
 PARAMETERS
@@ -354,6 +356,13 @@ DESCRIPTION
 	it really exits. This will block the new parent thread until
 	the child is finished posting events.
 
+	The Wait() function blocks until the thread ends on its own
+	(i.e. its run_count reaches zero or Run() returns false) which
+	is the equivalent of a join. It returns immediately when the
+	thread is not running or when called from the thread itself.
+	Once Wait() returned, the thread does not access the moThread
+	object anymore so it can be released.
+
 	The Continue() function returns true until the Stop() function
 	is called or the run_count counter reaches zero
 	(i.e. RUN_COUNT_STOP). This function is usually called from
@@ -371,9 +380,10 @@ BUGS
 	When the parameter 'wait' is to be set to 'true' you need
 	to make sure only one single thread calls the Stop()
 	function. This is because only one thread can be waiting
-	for the other until it dies. If you need to know when the
-	thread dies, use the death event facility instead (see the
-	AddDeathEventPipe() function).
+	for the other until it dies. The same applies to the Wait()
+	function. If you need to know when the thread dies, use the
+	death event facility instead (see the AddDeathEventPipe()
+	function).
 
 RETURN VALUE
 
@@ -419,7 +429,9 @@ void moThread::InternalRun(void)
 			if(!f_runner->Run()) {
 				break;
 			}
-			if(f_run_count != RUN_COUNT_FOREVER) {
+			// Stop() may have been called while Run() was running
+			// and decrementing RUN_COUNT_STOP gives RUN_COUNT_FOREVER
+			if(f_run_count != RUN_COUNT_FOREVER && f_run_count != RUN_COUNT_STOP) {
 				--f_run_count;
 			}
 		}
@@ -429,6 +441,9 @@ void moThread::InternalRun(void)
 	f_running = false;
 	PostToDeathEventPipes(f_runner->GetResult());
 
+	// wake up the thread blocked in Wait(), if any
+	f_death_mutex.Signal();
+
 	// signal our death if someone is waiting on it
 	if(f_wait_ended) {
 		f_ended_signal.Signal();
@@ -503,6 +518,21 @@ fprintf(stderr, "WARNING: waiting for the death of thread %d in Stop()\n", (int)
 }
 
 
+void moThread::Wait(void) const
+{
+#ifdef MO_THREAD
+	moLockMutex lock(f_death_mutex);
+
+	if(!f_running || pthread_equal(f_thread, pthread_self())) {
+		return;
+	}
+	while(f_running) {
+		f_death_mutex.Wait();
+	}
+#endif
+}
+
+
 bool moThread::Continue(void) const
 {
 	return f_run_count != RUN_COUNT_STOP;
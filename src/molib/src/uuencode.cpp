@@ -74,6 +74,8 @@ void moUUEncode(moWCString& out, const moBuffer& in, int mode, const moWCString&
 	void			*buffer;
 	unsigned long		size, sz;
 	const unsigned char	*data;
+	moBuffer		ascii;
+	char			*d;
 
 	out = moWCString::Format("begin %o ", mode);
 	out += name;
@@ -82,46 +84,60 @@ void moUUEncode(moWCString& out, const moBuffer& in, int mode, const moWCString&
 	in.Get(buffer, size);
 	data = static_cast<const unsigned char *>(buffer);
 
+	// encode in a plain buffer, appending characters one by
+	// one to the string was the bottleneck; each line of 45
+	// bytes uses 62 characters
+	ascii.SetSize((size + 44) / 45 * 62 + 2);
+	d = static_cast<char *>(static_cast<void *>(ascii));
+
 	while(size > 0) {
 		// at most, save 45 bytes on a single line
 		sz = size >= 45 ? 45 : size;
 		size -= sz;
 		// first put the size of this line
-		out += moEncodeChar(static_cast<unsigned char>(sz));
+		*d++ = moEncodeChar(static_cast<unsigned char>(sz));
 		// then encode the line
 		while(sz >= 3) {
-			out += moEncodeChar(data[0] >> 2);
-			out += moEncodeChar((data[0] << 4) | (data[1] >> 4) & 0x0F);
-			out += moEncodeChar((data[1] << 2) | (data[2] >> 6) & 0x03);
-			out += moEncodeChar(data[2]);
+			d[0] = moEncodeChar(data[0] >> 2);
+			d[1] = moEncodeChar((data[0] << 4) | (data[1] >> 4) & 0x0F);
+			d[2] = moEncodeChar((data[1] << 2) | (data[2] >> 6) & 0x03);
+			d[3] = moEncodeChar(data[2]);
+			d += 4;
 			data += 3;
 			sz -= 3;
 		}
 		switch(sz) {
 		case 1:
 			// only data[0] is accessible
-			out += moEncodeChar(data[0] >> 2);
-			out += moEncodeChar(data[0] << 4);
-			out += moEncodeChar(0);
-			out += moEncodeChar(0);
+			d[0] = moEncodeChar(data[0] >> 2);
+			d[1] = moEncodeChar(data[0] << 4);
+			d[2] = moEncodeChar(0);
+			d[3] = moEncodeChar(0);
+			d += 4;
+			data += 1;
 			break;
 
 		case 2:
 			// only data[0] and data[1] are accessible
-			out += moEncodeChar(data[0] >> 2);
-			out += moEncodeChar((data[0] << 4) | (data[1] >> 4) & 0x0F);
-			out += moEncodeChar(data[1] << 2);
-			out += moEncodeChar(0);
+			d[0] = moEncodeChar(data[0] >> 2);
+			d[1] = moEncodeChar((data[0] << 4) | (data[1] >> 4) & 0x0F);
+			d[2] = moEncodeChar(data[1] << 2);
+			d[3] = moEncodeChar(0);
+			d += 4;
+			data += 2;
 			break;
 
 		}
 		// end the line
-		out += '\n';
+		*d++ = '\n';
 	}
 
 	// the end of the buffer is marked with an empty line
 	// (and empty lines have a size of 0)
-	out += moEncodeChar(0);
+	*d++ = moEncodeChar(0);
+	out += moWCString(static_cast<const char *>(static_cast<const void *>(ascii)),
+			static_cast<int>(d - static_cast<char *>(static_cast<void *>(ascii))),
+			mowc::MO_ENCODING_ISO8859_1);
 	out += "\nend\n";
 }
 
@@ -216,7 +232,8 @@ inline static bool IsSpace(mowc::wc_t c)
 mo_uudecode_error_t moUUDecode(const moWCString& in, moBuffer& out, int& mode, moWCString& name)
 {
 	const mowc::wc_t	*s, *n;
-	unsigned char		buf[4], tmp[3], sz;	/* Flawfinder: ignore */
+	unsigned char		buf[4], sz;	/* Flawfinder: ignore */
+	unsigned char		*d, *start;
 	int			idx;
 
 //fprintf(stderr, "Decoding: [%s]\n", in.MBData());
@@ -271,6 +288,12 @@ mo_uudecode_error_t moUUDecode(const moWCString& in, moBuffer& out, int& mode, m
 
 	name.Set(n, static_cast<int>(s - n));
 
+	// the output is at most 3 bytes per group of 4 characters;
+	// allocate it once, appending 3 bytes at a time reallocated
+	// the buffer each time
+	out.SetSize(static_cast<unsigned long>(in.Length() / 4 * 3 + 3));
+	start = d = static_cast<unsigned char *>(static_cast<void *>(out));
+
 	// now we can read the lines of data
 	// these are composed of one character which defines the size
 	// followed by that many characters * 4 / 3 defining the data
@@ -294,6 +317,7 @@ mo_uudecode_error_t moUUDecode(const moWCString& in, moBuffer& out, int& mode, m
 		}
 		// get the length
 		if(!moDecodeChar(*s, sz)) {
+			out.Empty();
 			return MO_UUDECODE_ERROR_BADCHAR;
 		}
 		s++;
@@ -303,46 +327,49 @@ mo_uudecode_error_t moUUDecode(const moWCString& in, moBuffer& out, int& mode, m
 		while(sz >= 3) {
 			for(idx = 0; idx < 4; ++idx, ++s) {
 				if(!moDecodeChar(*s, buf[idx])) {
+					out.Empty();
 					return MO_UUDECODE_ERROR_BADCHAR;
 				}
 			}
-			tmp[0] = (buf[0] << 2) | (buf[1] >> 4);
-			tmp[1] = (buf[1] << 4) | (buf[2] >> 2);
-			tmp[2] = (buf[2] << 6) | buf[3];
-			out.Append(tmp, 3);
+			d[0] = (buf[0] << 2) | (buf[1] >> 4);
+			d[1] = (buf[1] << 4) | (buf[2] >> 2);
+			d[2] = (buf[2] << 6) | buf[3];
+			d += 3;
 			sz -= 3;
 		}
 
+		// the last group of a line still has 4 characters
+		// (it used to read the same character over and over)
 		switch(sz) {
 		case 1:
-			if(!moDecodeChar(*s, buf[0])) {
+			if(!moDecodeChar(s[0], buf[0])
+			|| !moDecodeChar(s[1], buf[1])) {
+				out.Empty();
 				return MO_UUDECODE_ERROR_BADCHAR;
 			}
-			if(!moDecodeChar(*s, buf[1])) {
-				return MO_UUDECODE_ERROR_BADCHAR;
-			}
-			tmp[0] = (buf[0] << 2) | (buf[1] >> 4);
-			out.Append(tmp, 1);
+			d[0] = (buf[0] << 2) | (buf[1] >> 4);
+			d += 1;
+			s += 4;
 			break;
 
 		case 2:
-			if(!moDecodeChar(*s, buf[0])) {
+			if(!moDecodeChar(s[0], buf[0])
+			|| !moDecodeChar(s[1], buf[1])
+			|| !moDecodeChar(s[2], buf[2])) {
+				out.Empty();
 				return MO_UUDECODE_ERROR_BADCHAR;
 			}
-			if(!moDecodeChar(*s, buf[1])) {
-				return MO_UUDECODE_ERROR_BADCHAR;
-			}
-			if(!moDecodeChar(*s, buf[2])) {
-				return MO_UUDECODE_ERROR_BADCHAR;
-			}
-			tmp[0] = (buf[0] << 2) | (buf[1] >> 4);
-			tmp[1] = (buf[1] << 4) | (buf[2] >> 2);
-			out.Append(tmp, 2);
+			d[0] = (buf[0] << 2) | (buf[1] >> 4);
+			d[1] = (buf[1] << 4) | (buf[2] >> 2);
+			d += 2;
+			s += 4;
 			break;
 
 		}
 	}
 
+	out.SetSize(static_cast<unsigned long>(d - start));
+
 	while(IsSpace(*s)) {
 		s++;
 	}
@@ -29,6 +29,8 @@
 #include	"mo/mo_expr.h"
 #endif
 
+#include	<vector>
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4996)
 #endif
@@ -96,6 +98,11 @@ public:
 						return 2;
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_basename;
 
 
@@ -167,6 +174,11 @@ public:
 						return 2;
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_capitalize;
 
 
@@ -220,6 +232,11 @@ public:
 						return "dirname";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_dirname;
 
 
@@ -331,6 +348,11 @@ public:
 						return "expr";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_expr;
 
 
@@ -383,6 +405,11 @@ public:
 						return "extension";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_extension;
 
 
@@ -433,6 +460,11 @@ public:
 						return "lowercase";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_lowercase;
 
 
@@ -483,6 +515,11 @@ public:
 						return "reverse";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_reverse;
 
 
@@ -626,6 +663,11 @@ public:
 						return "switchcase";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_switchcase;
 
 
@@ -676,6 +718,11 @@ public:
 						return "uppercase";
 					}
 
+	virtual bool			IsPure(void) const
+					{
+						return true;
+					}
+
 } mo_variable_reducer_command_uppercase;
 
 
@@ -973,6 +1020,530 @@ next:
 
 
 
+// Compiled templates
+//
+// Compile() reads the input exactly like Reduce() does (same grammar,
+// same calls to GetC() with the same depths) but instead of replacing
+// each $(...) by its value it saves it as a segment. A piece is a list
+// of literal runs and segments: the template is one piece and each
+// segment has one piece for its name and one per parameter.
+//
+// Expand() evaluates the pieces. Each segment and piece keeps the
+// value of the last expansion. The variables are read again since
+// GetVariable() cannot tell whether they changed, but a pure command
+// is executed again only when its name or one of its parameters
+// changed and a piece is concatenated again only when one of its
+// segments changed.
+
+namespace
+{
+
+struct mo_vr_item_t {
+	long			segment;	// index of a $(...) or -1 for a literal run
+	moWCString		text;
+};
+
+struct mo_vr_piece_t {
+	std::vector<mo_vr_item_t> items;
+	bool			valid;		// value is the result of the last expansion
+	moWCString		value;
+
+				mo_vr_piece_t(void)
+				{
+					valid = false;
+				}
+
+	void			Empty(void)
+				{
+					items.clear();
+					valid = false;
+				}
+
+	moWCString&		Literal(void)
+				{
+					if(items.empty() || items.back().segment != -1) {
+						mo_vr_item_t item;
+						item.segment = -1;
+						items.push_back(item);
+					}
+					return items.back().text;
+				}
+
+	void			Append(const mo_vr_piece_t& piece)
+				{
+					for(std::vector<mo_vr_item_t>::const_iterator it(piece.items.begin()); it != piece.items.end(); ++it) {
+						if(it->segment == -1) {
+							Literal() += it->text;
+						}
+						else {
+							items.push_back(*it);
+						}
+					}
+				}
+
+	void			AppendSegment(long segment)
+				{
+					mo_vr_item_t item;
+					item.segment = segment;
+					items.push_back(item);
+				}
+};
+
+}		// no name namespace
+
+
+class moVariableReducer::moTemplate::moCompiled
+{
+public:
+				moCompiled(void);
+
+	void			Empty(void);
+	bool			IsEmpty(void) const { return f_root.items.empty(); }
+
+	bool			Compile(moVariableReducer& reducer);
+	void			Expand(moVariableReducer& reducer, moWCString& result);
+
+private:
+	struct segment_t {
+		bool			command;
+		mo_vr_piece_t		name;
+		std::vector<mo_vr_piece_t> parameters;
+		bool			valid;		// value is the result of the last expansion
+		moWCString		value;
+		unsigned long		generation;	// expansion which computed value
+		bool			changed;	// whether value changed in that expansion
+	};
+
+	void			Reducing(moVariableReducer& reducer, mo_vr_piece_t& piece);
+	mowc::wc_t		SkipSpaces(moVariableReducer& reducer);
+	mowc::wc_t		ReadWord(moVariableReducer& reducer, mowc::wc_t c, mo_vr_piece_t& word, bool accept_spaces);
+
+	bool			Evaluate(moVariableReducer& reducer, mo_vr_piece_t& piece);
+	bool			EvaluateSegment(moVariableReducer& reducer, long index);
+
+	mo_vr_piece_t		f_root;
+	std::vector<segment_t>	f_segments;
+	unsigned long		f_depth;
+	moVariableReducer *	f_reducer;	// the reducer of the last expansion
+	unsigned long		f_generation;	// incremented on each expansion
+};
+
+
+moVariableReducer::moTemplate::moCompiled::moCompiled(void)
+	: f_depth(0)
+	, f_reducer(0)
+	, f_generation(0)
+{
+}
+
+
+void moVariableReducer::moTemplate::moCompiled::Empty(void)
+{
+	f_root.Empty();
+	f_segments.clear();
+	f_reducer = 0;
+}
+
+
+bool moVariableReducer::moTemplate::moCompiled::Compile(moVariableReducer& reducer)
+{
+	mowc::wc_t	c;
+
+	Empty();
+	f_depth = 0;
+
+	// see moVariableReducer::Reduce()
+	for(;;) {
+		c = reducer.GetC(f_depth);
+		if(c == MO_VR_EOF) {
+			return !f_root.items.empty();
+		}
+		if(c == '\\') {
+			c = reducer.GetC(f_depth);
+			if(c == '$') {
+				c = reducer.GetC(f_depth);
+				if(c != '(') {
+					f_root.Literal() += '\\';
+				}
+				f_root.Literal() += '$';
+			}
+			else {
+				f_root.Literal() += '\\';
+			}
+			f_root.Literal() += c;
+		}
+		else if(c == '$') {
+			c = reducer.GetC(f_depth);
+			while(c == '$') {
+				f_root.Literal() += '$';
+				c = reducer.GetC(f_depth);
+			}
+			if(c == '(') {
+				Reducing(reducer, f_root);
+			}
+			else {
+				f_root.Literal() += '$';
+				f_root.Literal() += c;
+			}
+		}
+		else {
+			f_root.Literal() += c;
+		}
+	}
+}
+
+
+void moVariableReducer::moTemplate::moCompiled::Reducing(moVariableReducer& reducer, mo_vr_piece_t& piece)
+{
+	mowc::wc_t		c;
+	mo_vr_piece_t		word, sub_word;
+	segment_t		segment;
+	int			count;
+
+	// see moVariableReducer::Reducing()
+	c = SkipSpaces(reducer);
+	if(c == MO_VR_EOF) {
+		return;
+	}
+
+	f_depth++;
+
+	c = ReadWord(reducer, c, segment.name, false);
+
+	if(c == ',' || mowc::isspace(c)) {
+		c = SkipSpaces(reducer);
+	}
+
+	segment.command = c != ')' && c != MO_VR_EOF;
+	if(segment.command) {
+		do {
+			if(c == ',') {
+				c = reducer.GetC(f_depth);
+			}
+			if(c != '(') {
+				c = ReadWord(reducer, c, word, true);
+			}
+			while(c == '(') {
+				count = 1;
+				do {
+					c = ReadWord(reducer, c, sub_word, true);
+					word.Append(sub_word);
+					if(c == '(') {
+						++count;
+					}
+					else if(c == ')') {
+						--count;
+					}
+				} while(count > 0 && c != MO_VR_EOF);
+				if(c != MO_VR_EOF) {
+					c = ReadWord(reducer, c, sub_word, true);
+					word.Append(sub_word);
+				}
+			}
+			segment.parameters.push_back(word);
+		} while(c != ')' && c != MO_VR_EOF);
+	}
+
+	f_depth--;
+
+	segment.valid = false;
+	segment.generation = 0;
+	segment.changed = false;
+	f_segments.push_back(segment);
+	piece.AppendSegment(static_cast<long>(f_segments.size() - 1));
+}
+
+
+mowc::wc_t moVariableReducer::moTemplate::moCompiled::SkipSpaces(moVariableReducer& reducer)
+{
+	mowc::wc_t	c;
+
+	do {
+		c = reducer.GetC(f_depth);
+	} while(mowc::isspace(c) || c == ',');
+
+	return c;
+}
+
+
+mowc::wc_t moVariableReducer::moTemplate::moCompiled::ReadWord(moVariableReducer& reducer, mowc::wc_t c, mo_vr_piece_t& word, bool accept_spaces)
+{
+	// see moVariableReducer::ReadWord()
+	word.Empty();
+
+	do {
+		while(c == '$') {
+			c = reducer.GetC(f_depth);
+
+			while(c == '$') {
+				word.Literal() += '$';
+				c = reducer.GetC(f_depth);
+			}
+			if(c == '(') {
+				Reducing(reducer, word);
+				goto next;
+			}
+			else {
+				word.Literal() += '$';
+			}
+		}
+		if(c == '\\') {
+			c = reducer.GetC(f_depth);
+			if(c != MO_VR_EOF) {
+				word.Literal() += c;
+			}
+		}
+		else {
+			word.Literal() += c;
+		}
+next:
+		c = reducer.GetC(f_depth);
+	} while((accept_spaces || !mowc::isspace(c)) && c != '(' && c != ')' && c != ',' && c != MO_VR_EOF);
+
+	return c;
+}
+
+
+void moVariableReducer::moTemplate::moCompiled::Expand(moVariableReducer& reducer, moWCString& result)
+{
+	if(f_reducer != &reducer) {
+		// another reducer may have other commands and variables
+		f_root.valid = false;
+		for(std::vector<segment_t>::iterator it(f_segments.begin()); it != f_segments.end(); ++it) {
+			it->valid = false;
+			it->name.valid = false;
+			for(std::vector<mo_vr_piece_t>::iterator p(it->parameters.begin()); p != it->parameters.end(); ++p) {
+				p->valid = false;
+			}
+		}
+		f_reducer = &reducer;
+	}
+
+	++f_generation;
+	Evaluate(reducer, f_root);
+	result += f_root.value;
+}
+
+
+// returns true when the value of the piece changed
+bool moVariableReducer::moTemplate::moCompiled::Evaluate(moVariableReducer& reducer, mo_vr_piece_t& piece)
+{
+	bool changed(!piece.valid);
+	for(std::vector<mo_vr_item_t>::const_iterator it(piece.items.begin()); it != piece.items.end(); ++it) {
+		if(it->segment != -1 && EvaluateSegment(reducer, it->segment)) {
+			changed = true;
+		}
+	}
+	if(!changed) {
+		return false;
+	}
+
+	piece.value.Empty();
+	for(std::vector<mo_vr_item_t>::const_iterator it(piece.items.begin()); it != piece.items.end(); ++it) {
+		piece.value += it->segment == -1 ? it->text : f_segments[it->segment].value;
+	}
+	piece.valid = true;
+
+	return true;
+}
+
+
+// returns true when the value of the segment changed
+bool moVariableReducer::moTemplate::moCompiled::EvaluateSegment(moVariableReducer& reducer, long index)
+{
+	segment_t& segment(f_segments[index]);
+	bool same(segment.valid);
+	moWCString value;
+
+	// a parameter following a parenthesized one repeats it (see
+	// Reducing()) so the same segment can be referenced twice
+	if(segment.generation == f_generation) {
+		return segment.changed;
+	}
+	segment.generation = f_generation;
+	segment.changed = false;
+
+	// in the same order as Reduce(): name, parameters, command
+	if(Evaluate(reducer, segment.name)) {
+		same = false;
+	}
+	if(!segment.command) {
+		value = reducer.GetVariable(segment.name.value);
+	}
+	else {
+		for(std::vector<mo_vr_piece_t>::iterator it(segment.parameters.begin()); it != segment.parameters.end(); ++it) {
+			if(Evaluate(reducer, *it)) {
+				same = false;
+			}
+		}
+		if(same && reducer.IsPureCommand(segment.name.value)) {
+			// memoized
+			return false;
+		}
+		moListOfWCStrings parameters;
+		for(std::vector<mo_vr_piece_t>::const_iterator it(segment.parameters.begin()); it != segment.parameters.end(); ++it) {
+			parameters += *new moWCString(it->value);
+		}
+		if(reducer.Command(segment.name.value, parameters, value) != 0) {
+			// never reuse a failure
+			segment.changed = !segment.valid || value != segment.value;
+			segment.value = value;
+			segment.valid = false;
+			return segment.changed;
+		}
+	}
+
+	if(segment.valid && value == segment.value) {
+		return false;
+	}
+	segment.value = value;
+	segment.valid = true;
+	segment.changed = true;
+
+	return true;
+}
+
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moVariableReducer::moTemplate
+
+NAME
+
+	Constructor - create an empty template
+	Destructor - release the compiled template
+	Empty - forget the compiled template
+	IsEmpty - check whether the template includes anything
+
+SYNOPSIS
+
+	moTemplate(void);
+	virtual ~moTemplate();
+	void Empty(void);
+	bool IsEmpty(void) const;
+
+DESCRIPTION
+
+	An moTemplate object holds the input of an moVariableReducer in
+	a compiled form: a list of literal strings, variable references
+	and commands. It is filled by moVariableReducer::Compile() and
+	expanded any number of times with moVariableReducer::Expand().
+
+	The template also keeps the values of its last expansion. This
+	is what lets Expand() skip the work when the variables did not
+	change. Templates cannot be copied.
+
+SEE ALSO
+
+	moVariableReducer::Compile, moVariableReducer::Expand
+
+*/
+moVariableReducer::moTemplate::moTemplate(void)
+	: f_compiled(new moCompiled)
+{
+}
+
+
+moVariableReducer::moTemplate::~moTemplate()
+{
+	delete f_compiled;
+}
+
+
+void moVariableReducer::moTemplate::Empty(void)
+{
+	f_compiled->Empty();
+}
+
+
+bool moVariableReducer::moTemplate::IsEmpty(void) const
+{
+	return f_compiled->IsEmpty();
+}
+
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moVariableReducer
+
+NAME
+
+	Compile - read the input and save it in a template
+	Expand - reduce a compiled template
+
+SYNOPSIS
+
+	int Compile(moTemplate& tmpl);
+	int Expand(moTemplate& tmpl, moWCString& result);
+
+PARAMETERS
+
+	tmpl - the compiled template
+	result - the string where the reduced template is appended
+
+DESCRIPTION
+
+	The Compile() function reads the whole input with GetC() exactly
+	like Reduce() does. However, instead of reducing the variables and
+	commands at once, it saves the input in the template as a list of
+	literal strings, variable references and commands. The previous
+	content of the template is lost.
+
+	The Expand() function then reduces the template. The result is the
+	same as Reduce() would give with the same input, but the input does
+	not need to be read and parsed again. This is useful when the same
+	input is reduced many times with different variables.
+
+	The template remembers the values of its last expansion. On the
+	next call, the variables are read again with GetVariable() but the
+	commands which are pure (see moVariableReducerCommand::IsPure())
+	are not executed again unless one of their parameters changed.
+	The other commands are always executed.
+
+	A template can be expanded by another reducer than the one which
+	compiled it. In that case nothing of the previous expansion is
+	reused.
+
+BUGS
+
+	Since the input is read before any variable gets reduced, an
+	implementation of GetC() which depends on the values of the
+	variables would not work with compiled templates.
+
+RETURN VALUE
+
+	Compile() returns -1 when the input is empty, 0 otherwise.
+
+	Expand() returns -1 when the result is empty, 0 otherwise (this is
+	what Reduce() returns.)
+
+SEE ALSO
+
+	Reduce, moTemplate
+
+*/
+int moVariableReducer::Compile(moTemplate& tmpl)
+{
+	return tmpl.f_compiled->Compile(*this) ? 0 : -1;
+}
+
+
+int moVariableReducer::Expand(moTemplate& tmpl, moWCString& result)
+{
+	tmpl.f_compiled->Expand(*this, result);
+	return result.IsEmpty() ? -1 : 0;
+}
+
+
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -1117,12 +1688,14 @@ NAME
 	RegisterCommand - add a command to the internal list of commands
 	UnregisterCommand - remove a command previous registered
 	Command - execute the named command with the specified parameters
+	IsPureCommand - check whether the named command is pure
 
 SYNOPSIS
 
 	bool RegisterCommand(const moVariableReducerCommand& command);
 	bool UnregisterCommand(const moVariableReducerCommand& command);
 	int Command(const moWCString& command, const moList& parameters, moWCString& result);
+	bool IsPureCommand(const moWCString& command);
 
 DESCRIPTION
 
@@ -1161,6 +1734,10 @@ RETURN VALUE
 	0 when nothing goes wrong, the errno otherwise (Warning: the current errno may
 	be different than the returned errno value)
 
+	IsPureCommand():
+
+	true when the command exists and its IsPure() function returns true
+
 SEE ALSO
 
 	?
@@ -1283,6 +1860,21 @@ int moVariableReducer::Command(const moWCString& command, const moListOfWCString
 
 
 
+bool moVariableReducer::IsPureCommand(const moWCString& command)
+{
+	moList::position_t	pos;
+
+	moVariableReducerCommand_FindCommand cmd(command);
+	pos = f_commands.Find(&cmd);
+	if(pos == moList::NO_POSITION) {
+		return false;
+	}
+
+	return f_commands.Get(pos)->IsPure();
+}
+
+
+
 
 /************************************************************ DOC:
 
@@ -1297,6 +1889,7 @@ NAME
 	MinimumParameterCount - the minimum number of parameters necessary
 	MaximumParameterCount - the maximum number of parameters
 	ParameterType - a function used to ensure the correct type of each parameter
+	IsPure - whether the result only depends on the parameters
 
 SYNOPSIS
 
@@ -1305,6 +1898,7 @@ SYNOPSIS
 	virtual	unsigned long MinimumParameterCount(void) const;
 	virtual	unsigned long MaximumParameterCount(void) const;
 	virtual mo_vr_param_t ParameterType(unsigned long index) const;
+	virtual bool IsPure(void) const;
 
 	private:
 	virtual compare_t Compare(const moBase& object) const;
@@ -1382,6 +1976,13 @@ DESCRIPTION
 	it needs to return MO_VR_PARAM_ERROR. Usually, this happens when
 	the function is called with an index out of bounds.
 
+	The IsPure() function returns true when the result of the command
+	only depends on its name and parameters and running it has no
+	side effect. The Expand() function of the moVariableReducer then
+	keeps the result of such a command and does not execute it again
+	as long as its parameters do not change. By default, a command is
+	not pure ($(shell ...) and $(echo ...) are not).
+
 	The private Compare() function is used to ensure that these objects
 	are sorted alphabetically in the list of commands of an
 	moVariableReducer object.
@@ -1421,6 +2022,12 @@ RETURN VALUE
 	If a specialized parameter is required, then return the type
 	of data you expect with one of the mo_vr_param_t values.
 
+	IsPure():
+
+	By default, this function returns false. Return true if the
+	result of Execute() can be reused when it is called with the
+	same parameters.
+
 	Compare():
 
 	The comparison result. It needs to not be redefined. This is
@@ -1448,6 +2055,11 @@ moVariableReducer::moVariableReducerCommand::mo_vr_param_t moVariableReducer::mo
 	return MO_VR_PARAM_ANY;
 }
 
+bool moVariableReducer::moVariableReducerCommand::IsPure(void) const
+{
+	return false;
+}
+
 moBase::compare_t moVariableReducer::moVariableReducerCommand::Compare(const moBase& object) const
 {
 	return Name().Compare(dynamic_cast<const moVariableReducerCommand&>(object).Name());
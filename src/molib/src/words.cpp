@@ -25,12 +25,255 @@
 
 #include	"mo/mo_words.h"
 
+#include	<algorithm>
+#include	<vector>
+
 
 
 namespace molib
 {
 
 
+namespace
+{
+
+// character classes of the tokenizer
+const unsigned char	MO_WORDS_SEPARATOR = 0x01;	// a character separator
+const unsigned char	MO_WORDS_STRING = 0x02;		// may start a string separator
+const unsigned char	MO_WORDS_QUOTE = 0x04;		// an opening quote
+
+struct mo_words_span_t {
+	unsigned long		offset;		// in f_words
+	unsigned long		length;
+};
+
+struct mo_words_node_t {
+	std::vector<std::pair<mowc::wc_t, long> >	children;
+	long						separator;	// first separator ending here or -1
+};
+
+struct mo_words_quote_t {
+	mowc::wc_t		open;
+	mowc::wc_t		close;
+	bool			backslash;	// whether \\ escapes characters
+};
+
+}		// no name namespace
+
+
+/** \brief The compiled separators and the lazy words.
+ *
+ * The separators and quotes are compiled on the first AddWords()
+ * which follows a change: the characters below 256 are classified
+ * with one table lookup, the string separators are saved in a trie
+ * walked from the current position and the quotes in an array.
+ *
+ * The words are first saved as spans of f_words. With LazyWords()
+ * a string is only created when Get() is called, otherwise all the
+ * strings are created at the end of AddWords().
+ */
+class moWords::moTokenizer
+{
+public:
+				moTokenizer(void)
+				{
+					f_compiled = false;
+				}
+
+	void			Compile(const moWCString& char_separators, const moList& str_separators, const moWCString& quotes);
+	unsigned char		Class(mowc::wc_t c) const;
+	unsigned long		MatchString(const mowc::wc_t *s) const;
+	const mo_words_quote_t *Quote(mowc::wc_t c) const;
+
+	bool				f_compiled;
+	unsigned char			f_class[256];
+	bool				f_spaces;	// mowc::isspace() characters are separators
+	std::vector<mowc::wc_t>		f_wide;		// other separators (sorted)
+	std::vector<mo_words_node_t>	f_trie;		// the string separators, [0] is the root
+	std::vector<mo_words_quote_t>	f_quotes;
+
+	std::vector<mo_words_span_t>	f_spans;
+	mutable std::vector<moWCStringSPtr> f_cache;	// the strings Get() created
+};
+
+
+void moWords::moTokenizer::Compile(const moWCString& char_separators, const moList& str_separators, const moWCString& quotes)
+{
+	const mowc::wc_t	*seps;
+	mowc::wc_t		c;
+	unsigned long		idx, max, node, child, pos;
+	bool			backslash;
+
+	memset(f_class, 0, sizeof(f_class));
+	f_wide.clear();
+	f_trie.clear();
+	f_quotes.clear();
+
+	// the character separators with their backslash sequences
+	f_spaces = char_separators.IsEmpty() && str_separators.IsEmpty();
+	seps = char_separators.Data();
+	while(*seps != '\0') {
+		c = *seps++;
+		if(c == '\\') {
+			if(*seps == 's') {
+				f_spaces = true;
+				seps++;
+				continue;
+			}
+			c = mowc::backslash_char(seps);
+			if(c == '\0') {
+				continue;
+			}
+		}
+		if(static_cast<unsigned long>(c) < 256) {
+			f_class[c] |= MO_WORDS_SEPARATOR;
+		}
+		else {
+			f_wide.push_back(c);
+		}
+	}
+	if(f_spaces) {
+		for(idx = 0; idx < 256; ++idx) {
+			if(mowc::isspace(static_cast<mowc::wc_t>(idx))) {
+				f_class[idx] |= MO_WORDS_SEPARATOR;
+			}
+		}
+	}
+	std::sort(f_wide.begin(), f_wide.end());
+
+	// the string separators; when one is the prefix of another, the
+	// first one in the list wins (not the longest)
+	f_trie.resize(1);
+	f_trie[0].separator = -1;
+	max = str_separators.Count();
+	for(idx = 0; idx < max; ++idx) {
+		const moWCString& str = dynamic_cast<const moWCString&>(*str_separators.Get(idx));
+		node = 0;
+		for(seps = str.Data(); *seps != '\0'; ++seps) {
+			child = 0;
+			for(pos = 0; pos < f_trie[node].children.size(); ++pos) {
+				if(f_trie[node].children[pos].first == *seps) {
+					child = f_trie[node].children[pos].second;
+					break;
+				}
+			}
+			if(child == 0) {
+				child = f_trie.size();
+				f_trie.resize(child + 1);
+				f_trie[child].separator = -1;
+				f_trie[node].children.push_back(std::make_pair(*seps, static_cast<long>(child)));
+			}
+			node = child;
+		}
+		if(f_trie[node].separator == -1) {
+			f_trie[node].separator = static_cast<long>(idx);
+		}
+	}
+	for(pos = 0; pos < f_trie[0].children.size(); ++pos) {
+		c = f_trie[0].children[pos].first;
+		if(static_cast<unsigned long>(c) < 256) {
+			f_class[c] |= MO_WORDS_STRING;
+		}
+	}
+
+	// the quotes, the first pair with a given opening quote is used
+	backslash = false;
+	for(seps = quotes.Data(); seps[0] != '\0' && seps[1] != '\0'; seps += 2) {
+		if(seps[0] == '\\') {
+			backslash = true;
+			continue;
+		}
+		if(Quote(seps[0]) == 0) {
+			mo_words_quote_t quote;
+			quote.open = seps[0];
+			quote.close = seps[1];
+			quote.backslash = backslash;
+			f_quotes.push_back(quote);
+			if(static_cast<unsigned long>(seps[0]) < 256) {
+				f_class[seps[0]] |= MO_WORDS_QUOTE;
+			}
+		}
+	}
+
+	f_compiled = true;
+}
+
+
+// the MO_WORDS_... flags of character c
+unsigned char moWords::moTokenizer::Class(mowc::wc_t c) const
+{
+	unsigned char	result;
+	unsigned long	pos;
+
+	if(static_cast<unsigned long>(c) < 256) {
+		return f_class[c];
+	}
+
+	result = 0;
+	if((f_spaces && mowc::isspace(c))
+	|| std::binary_search(f_wide.begin(), f_wide.end(), c)) {
+		result |= MO_WORDS_SEPARATOR;
+	}
+	for(pos = 0; pos < f_trie[0].children.size(); ++pos) {
+		if(f_trie[0].children[pos].first == c) {
+			result |= MO_WORDS_STRING;
+			break;
+		}
+	}
+	if(Quote(c) != 0) {
+		result |= MO_WORDS_QUOTE;
+	}
+
+	return result;
+}
+
+
+// the length of the string separator found at s or 0
+unsigned long moWords::moTokenizer::MatchString(const mowc::wc_t *s) const
+{
+	unsigned long	node, pos, depth, length;
+	long		best;
+
+	best = -1;
+	length = 0;
+	node = 0;
+	for(depth = 0; s[depth] != '\0'; ++depth) {
+		const std::vector<std::pair<mowc::wc_t, long> >& children = f_trie[node].children;
+		for(pos = 0; pos < children.size(); ++pos) {
+			if(children[pos].first == s[depth]) {
+				break;
+			}
+		}
+		if(pos >= children.size()) {
+			break;
+		}
+		node = children[pos].second;
+		if(f_trie[node].separator != -1
+		&& (best == -1 || f_trie[node].separator < best)) {
+			best = f_trie[node].separator;
+			length = depth + 1;
+		}
+	}
+
+	return length;
+}
+
+
+const mo_words_quote_t *moWords::moTokenizer::Quote(mowc::wc_t c) const
+{
+	unsigned long	idx;
+
+	for(idx = 0; idx < f_quotes.size(); ++idx) {
+		if(f_quotes[idx].open == c) {
+			return &f_quotes[idx];
+		}
+	}
+
+	return 0;
+}
+
+
+
 
 /************************************************************ DOC:
 
@@ -68,6 +311,8 @@ SEE ALSO
 */
 void moWords::Init(void)
 {
+	f_tokenizer = new moTokenizer;
+	f_lazy_words = false;
 	f_auto_clip = false;
 	f_empty_words = false;
 }
@@ -86,9 +331,42 @@ moWords::moWords(const moWCString& char_separators)
 }
 
 
+moWords::moWords(const moWords& words)
+	: moList(words),
+	  f_tokenizer(new moTokenizer(*words.f_tokenizer)),
+	  f_lazy_words(words.f_lazy_words),
+	  f_auto_clip(words.f_auto_clip),
+	  f_empty_words(words.f_empty_words),
+	  f_quotes(words.f_quotes),
+	  f_char_separators(words.f_char_separators),
+	  f_str_separators(words.f_str_separators),
+	  f_words(words.f_words)
+{
+}
+
+
 moWords::~moWords(void)
 {
 	ClearSeparators();
+	delete f_tokenizer;
+}
+
+
+moWords& moWords::operator = (const moWords& words)
+{
+	if(this != &words) {
+		moList::operator = (words);
+		*f_tokenizer = *words.f_tokenizer;
+		f_lazy_words = words.f_lazy_words;
+		f_auto_clip = words.f_auto_clip;
+		f_empty_words = words.f_empty_words;
+		f_quotes = words.f_quotes;
+		f_char_separators = words.f_char_separators;
+		f_str_separators = words.f_str_separators;
+		f_words = words.f_words;
+	}
+
+	return *this;
 }
 
 
@@ -262,6 +540,8 @@ void moWords::ClearSeparators(void)
 
 	// get rid of the string separators
 	f_str_separators.Empty();
+
+	f_tokenizer->f_compiled = false;
 }
 
 
@@ -269,6 +549,7 @@ void moWords::CharSeparators(const moWCString& seps)
 {
 	// replace any previous separators with these once
 	f_char_separators = seps;
+	f_tokenizer->f_compiled = false;
 }
 
 
@@ -280,6 +561,7 @@ void moWords::StringSeparators(const moWCString& separator)
 	if(!separator.IsEmpty()) {
 		str = new moWCString(separator);
 		f_str_separators += *str;
+		f_tokenizer->f_compiled = false;
 	}
 }
 
@@ -330,6 +612,7 @@ void moWords::Quotes(const moWCString& quotes)
 	}
 
 	f_quotes = quotes;
+	f_tokenizer->f_compiled = false;
 }
 
 
@@ -371,10 +654,15 @@ unsigned long moWords::SetWords(const moWCString& words)
  */
 unsigned long moWords::AddWords(const moWCString& words)
 {
-	moWCString		str, *cmp;
-	const mowc::wc_t	*s, *start, *seps;
-	long			idx, max, skip;
-	bool			found, accepts_backslash;
+	const mowc::wc_t	*base, *s, *start, *b, *e;
+	const mo_words_quote_t	*quote;
+	unsigned long		offset, skip, first, idx, max;
+	unsigned char		cls;
+	bool			found;
+
+	if(!f_tokenizer->f_compiled) {
+		f_tokenizer->Compile(f_char_separators, f_str_separators, f_quotes);
+	}
 
 	if(!f_words.IsEmpty()) {
 		if(!f_char_separators.IsEmpty()) {
@@ -388,84 +676,49 @@ unsigned long moWords::AddWords(const moWCString& words)
 			f_words += " ";
 		}
 	}
+	offset = f_words.Length();
 	f_words += words;
 
-	s = words.Data();
+	// the words are first saved as spans of f_words
+	std::vector<mo_words_span_t>& spans = f_tokenizer->f_spans;
+	first = spans.size();
+	base = f_words.Data() + offset;
+	s = base;
 	while(*s != '\0') {
 		// start of this new word
 		start = s;
 		found = false;
 		do {
 			skip = 1;
-
-			// 1. test with strings
-			max = f_str_separators.Count();
-			idx = 0;
-			while(idx < max) {
-				cmp = dynamic_cast<moWCString *>(f_str_separators.Get(idx));
-				if(cmp->Compare(s, 0, static_cast<int>(cmp->Length())) == MO_BASE_COMPARE_EQUAL) {
-					// we found a separator
-					found = true;
-					skip = static_cast<long>(cmp->Length());
-					break;
-				}
-				idx++;
-			}
-
-			// 2. test with characters (if not found yet)
-			if(!found && !f_char_separators.IsEmpty()) {
-				seps = f_char_separators.Data();
-				while(*seps != '\0' && !found) {
-					if(*seps == '\\') {
-						seps++;
-						if(*seps == 's') {
-							found = mowc::isspace(*s);
-							seps++;
-						}
-						else {
-							found = *s == mowc::backslash_char(seps);
-						}
-					}
-					else if(*seps == *s) {
-						// we found a separator
-						found = true;
-						break;
-					}
-					else {
-						seps++;
-					}
+			cls = f_tokenizer->Class(*s);
+
+			// 1. test with strings (the first match, not the longest)
+			if((cls & MO_WORDS_STRING) != 0) {
+				skip = f_tokenizer->MatchString(s);
+				found = skip != 0;
+				if(!found) {
+					skip = 1;
 				}
 			}
 
-			// 3. test with the default separators (spaces)
-			if(!found && f_char_separators.IsEmpty() && f_str_separators.IsEmpty() && mowc::isspace(*s)) {
-				// we found the default separator
+			// 2. test with characters (including the default spaces)
+			if(!found && (cls & MO_WORDS_SEPARATOR) != 0) {
 				found = true;
 			}
 
-			// 4. check for quoted information
-			if(!found) {
-				accepts_backslash = false;
-				seps = f_quotes.Data();
-				while(*seps != '\0') {
-					if(*seps == '\\') {
-						accepts_backslash = true;
+			// 3. check for quoted information
+			if(!found && (cls & MO_WORDS_QUOTE) != 0) {
+				// we found a quoted part - quoted parts can include separators
+				quote = f_tokenizer->Quote(*s);
+				s++;		// skip starting quote
+				while(*s != quote->close && *s != '\0') {
+					if(quote->backslash && *s == '\\' && s[1] != '\0') {
+						s++;
 					}
-					else if(*s == *seps) {
-						// we found a quoted part - quoted parts can include separators
-						s++;		// skip starting quote
-						while(*s != seps[1] && *s != '\0') {
-							if(accepts_backslash && *s == '\\' && s[1] != '\0') {
-								s++;
-							}
-							s++;
-						}
-						if(*s == '\0') {
-							s--;	// make sure the following s++ doesn't make the system crash
-						}
-						break;
-					}
-					seps += 2;		// the size of f_quotes is always even
+					s++;
+				}
+				if(*s == '\0') {
+					s--;	// make sure the following s++ doesn't make the system crash
 				}
 			}
 
@@ -474,13 +727,22 @@ unsigned long moWords::AddWords(const moWCString& words)
 		if(found) {
 			s--;	// this character is part of the separator, not the word
 		}
-		str = moWCString(start, static_cast<int>(s - start));
+		b = start;
+		e = s;
 		if(f_auto_clip) {
-			str = str.Clip();
+			while(b < e && mowc::isspace(*b)) {
+				b++;
+			}
+			while(e > b && mowc::isspace(e[-1])) {
+				e--;
+			}
 		}
-		if(f_empty_words || !str.IsEmpty()) {
+		if(f_empty_words || b < e) {
 			// word accepted
-			Insert(new moWCString(str));
+			mo_words_span_t span;
+			span.offset = offset + (b - base);
+			span.length = e - b;
+			spans.push_back(span);
 		}
 		// skip the word separator
 		if(*s != '\0') {
@@ -488,10 +750,183 @@ unsigned long moWords::AddWords(const moWCString& words)
 		}
 	}
 
+	if(!f_lazy_words) {
+		// create all the strings at once; enlarging the list
+		// only once is much faster with a large number of words
+		max = spans.size();
+		if(max > first) {
+			SetArraySize(Count() + max - first);
+			for(idx = first; idx < max; ++idx) {
+				Insert(new moWCString(f_words.Data() + spans[idx].offset, static_cast<int>(spans[idx].length)));
+			}
+		}
+		spans.resize(first);
+	}
+
+	return WordCount();
+}
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moWords
+
+NAME
+
+	LazyWords - whether the words are saved as strings
+
+SYNOPSIS
+
+	void LazyWords(bool status = true);
+
+PARAMETERS
+
+	status - new value of the lazy words flag
+
+DESCRIPTION
+
+	By default, the AddWords() function creates one string per
+	word and appends it to this list. When this flag is set to
+	'true', AddWords() instead saves the position and length of
+	each word in AllWords() and no string is created until Get()
+	or the [] operator is used on that word.
+
+	This is much faster when a large input is split and only a
+	few of its words are read, or when WordOffset() and
+	WordLength() are enough to the caller.
+
+	In lazy mode the moList functions (Count(), moList::Get(),
+	etc.) do not see the words; use WordCount() instead.
+
+	Changing this flag removes the existing words.
+
+SEE ALSO
+
+	WordCount, WordOffset, WordLength, Get
+
+*/
+void moWords::LazyWords(bool status)
+{
+	if(f_lazy_words != status) {
+		Empty();
+		f_words.Empty();
+		f_lazy_words = status;
+	}
+}
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moWords
+
+NAME
+
+	Empty - remove all the words
+
+SYNOPSIS
+
+	virtual void Empty(void);
+
+DESCRIPTION
+
+	Remove all the words from this list, including the words saved
+	in lazy mode. The separators, quotes and flags are kept.
+
+	Note that AllWords() is not modified.
+
+*/
+void moWords::Empty(void)
+{
+	moList::Empty();
+	f_tokenizer->f_spans.clear();
+	f_tokenizer->f_cache.clear();
+}
+
+
+/************************************************************ DOC:
+
+CLASS
+
+	moWords
+
+NAME
+
+	WordCount - the number of words
+	WordOffset - the position of a word in AllWords()
+	WordLength - the length of a word
+
+SYNOPSIS
+
+	unsigned long WordCount(void) const;
+	unsigned long WordOffset(int index) const;
+	unsigned long WordLength(int index) const;
+
+PARAMETERS
+
+	index - the word to be checked
+
+DESCRIPTION
+
+	WordCount() returns the number of words in this object
+	whether LazyWords() is used or not.
+
+	In lazy mode, WordOffset() and WordLength() return the
+	position and length of the specified word within the
+	AllWords() string without creating a string. Otherwise
+	WordOffset() returns 0 and WordLength() the length of the
+	word string.
+
+ERRORS
+
+	An moError(MO_ERROR_OVERFLOW) is thrown when the index is
+	out of bounds.
+
+SEE ALSO
+
+	LazyWords, AllWords, Get
+
+*/
+unsigned long moWords::WordCount(void) const
+{
+	if(f_lazy_words) {
+		return static_cast<unsigned long>(f_tokenizer->f_spans.size());
+	}
+
 	return Count();
 }
 
 
+unsigned long moWords::WordOffset(int index) const
+{
+	if(f_lazy_words) {
+		if(index < 0 || static_cast<unsigned long>(index) >= f_tokenizer->f_spans.size()) {
+			throw moError(MO_ERROR_OVERFLOW, "moWords::WordOffset(): index %d out of bounds", index);
+		}
+		return f_tokenizer->f_spans[index].offset;
+	}
+
+	Get(index);
+	return 0;
+}
+
+
+unsigned long moWords::WordLength(int index) const
+{
+	if(f_lazy_words) {
+		if(index < 0 || static_cast<unsigned long>(index) >= f_tokenizer->f_spans.size()) {
+			throw moError(MO_ERROR_OVERFLOW, "moWords::WordLength(): index %d out of bounds", index);
+		}
+		return f_tokenizer->f_spans[index].length;
+	}
+
+	return Get(index).Length();
+}
+
+
 /************************************************************ DOC:
 
 CLASS
@@ -543,13 +978,28 @@ SEE ALSO
 */
 const moWCString& moWords::Get(int index) const
 {
+	if(f_lazy_words) {
+		std::vector<moWCStringSPtr>& cache = f_tokenizer->f_cache;
+		if(index < 0 || static_cast<unsigned long>(index) >= f_tokenizer->f_spans.size()) {
+			throw moError(MO_ERROR_OVERFLOW, "moWords::Get(): index %d out of bounds", index);
+		}
+		if(cache.size() <= static_cast<unsigned long>(index)) {
+			cache.resize(f_tokenizer->f_spans.size());
+		}
+		if(!cache[index]) {
+			const mo_words_span_t& span = f_tokenizer->f_spans[index];
+			cache[index] = new moWCString(f_words.Data() + span.offset, static_cast<int>(span.length));
+		}
+		return *cache[index];
+	}
+
 	return dynamic_cast<moWCString&>(*moList::Get(index));
 }
 
 
 const moWCString& moWords::operator [] (int index) const
 {
-	return dynamic_cast<moWCString&>(*moList::Get(index));
+	return Get(index);
 }
 
 
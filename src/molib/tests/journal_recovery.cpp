@@ -0,0 +1,289 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+// Crash recovery of an moJournal: a record torn by a crash is dropped when
+// the journal is reopened and the records before it are replayed; a state
+// journaled as one full record followed by delta records (the way the combat
+// journal works) is rebuilt by the replay.
+//
+// Usage: journal_recovery [<directory>]
+// The journal is created in <directory> (default: the current directory)
+// and removed on success.
+
+#include	"mo/mo_journal.h"
+#include	"mo/mo_props_binary.h"
+
+#include	<stdio.h>
+#include	<string.h>
+#include	<unistd.h>
+#include	<sys/stat.h>
+
+#include	<string>
+#include	<vector>
+
+using namespace molib;
+
+
+namespace
+{
+int		g_errors = 0;
+
+void check(bool condition, const char *what)
+{
+	if(!condition) {
+		fprintf(stderr, "journal_recovery: FAILED: %s\n", what);
+		++g_errors;
+	}
+}
+
+
+off_t file_size(const moWCString& filename)
+{
+	struct stat st;
+	if(stat(filename.c_str(), &st) != 0) {
+		return -1;
+	}
+	return st.st_size;
+}
+
+
+moBuffer make_record(const std::string& text)
+{
+	moBuffer buffer;
+	buffer.Append(text.c_str(), text.length());
+	return buffer;
+}
+
+
+class Collect : public moJournal::moReplayHandler
+{
+public:
+	virtual bool Record(moJournal::sequence_t sequence, const moBuffer& data)
+	{
+		void		*ptr;
+		unsigned long	size;
+		data.Get(ptr, size);
+		f_sequences.push_back(sequence);
+		f_records.push_back(std::string(static_cast<const char *>(ptr), size));
+		return true;
+	}
+
+	std::vector<moJournal::sequence_t>	f_sequences;
+	std::vector<std::string>		f_records;
+};
+
+
+// same record layout as Transactions::CombatJournal
+class StateReplay : public moJournal::moReplayHandler
+{
+public:
+	StateReplay() : f_state("STATE") {}
+
+	virtual bool Record(moJournal::sequence_t sequence, const moBuffer& data)
+	{
+		void		*ptr;
+		unsigned long	size;
+		data.Get(ptr, size);
+		if(size < 1) {
+			return false;
+		}
+		const unsigned char *p = static_cast<const unsigned char *>(ptr);
+		moBuffer bag_data;
+		bag_data.Append(p + 1, size - 1);
+		moPropBagRef bag("STATE");
+		bag.NewProp();
+		if(moBinaryLoadPropBag(bag_data, bag) != 0) {
+			return false;
+		}
+		if(p[0] == 'F') {
+			f_state = bag;
+		}
+		else if(p[0] == 'D' && f_state.HasProp()) {
+			dynamic_cast<moPropBag&>(*f_state.GetProperty()).Merge(
+				dynamic_cast<const moPropBag&>(*bag.GetProperty()));
+		}
+		else {
+			return false;
+		}
+		return true;
+	}
+
+	moPropBagRef		f_state;
+};
+
+
+bool append_state(moJournal& journal, const moPropBagRef& state, unsigned char type, moProp::generation_t generation)
+{
+	moBuffer bag_data;
+	if(moBinarySavePropBag(bag_data, state, generation) != 0) {
+		return false;
+	}
+	moBuffer record;
+	record.Append(&type, 1);
+	record.Append(static_cast<const void *>(bag_data), bag_data.GetSize());
+	journal.Append(record);
+	return journal.Commit(true);
+}
+
+
+void test_torn_tail(const moWCString& filename)
+{
+	unlink(filename.c_str());
+
+	off_t good_size;
+	{
+		moJournal journal;
+		check(journal.Open(filename), "open a new journal");
+		journal.Append(make_record("one"));
+		journal.Append(make_record("two"));
+		journal.Append(make_record("three"));
+		check(journal.Commit(true), "commit three records");
+		good_size = file_size(filename);
+		journal.Append(make_record("four, torn by the crash"));
+		check(journal.Commit(true), "commit a fourth record");
+		journal.Close();
+	}
+
+	// simulate a crash in the middle of the write(2) of record four
+	const off_t full_size = file_size(filename);
+	check(full_size > good_size, "the fourth record was written");
+	check(truncate(filename.c_str(), full_size - 5) == 0, "tear the last record");
+
+	{
+		moJournal journal;
+		check(journal.Open(filename), "reopen the torn journal");
+		check(file_size(filename) == good_size, "the torn record is truncated");
+		check(journal.GetLastSequence() == 3, "the last valid sequence is 3");
+
+		Collect collect;
+		check(journal.Replay(collect), "replay the journal");
+		check(collect.f_records.size() == 3, "three records replayed");
+		if(collect.f_records.size() == 3) {
+			check(collect.f_records[0] == "one"
+			   && collect.f_records[1] == "two"
+			   && collect.f_records[2] == "three", "the records are intact");
+			check(collect.f_sequences[0] == 1
+			   && collect.f_sequences[2] == 3, "the sequences are intact");
+		}
+
+		// the journal is usable again after the recovery
+		journal.Append(make_record("four again"));
+		check(journal.Commit(true), "commit after the recovery");
+		check(journal.GetLastSequence() == 4, "the sequence continues");
+		journal.Close();
+	}
+
+	// garbage after the last record (i.e. a block of zeroes left by
+	// the file system) is dropped as well
+	{
+		FILE *f = fopen(filename.c_str(), "ab");
+		check(f != 0, "open the journal to append garbage");
+		if(f != 0) {
+			const char zeroes[64] = { 0 };
+			fwrite(zeroes, sizeof(zeroes), 1, f);
+			fclose(f);
+		}
+		moJournal journal;
+		check(journal.Open(filename), "reopen the journal with garbage");
+		Collect collect;
+		journal.Replay(collect);
+		check(collect.f_records.size() == 4 && collect.f_records[3] == "four again", "four records after the garbage");
+
+		check(journal.Truncate(), "truncate the journal");
+		Collect empty;
+		journal.Replay(empty);
+		check(empty.f_records.empty(), "no records after a truncate");
+		journal.Close();
+	}
+
+	unlink(filename.c_str());
+}
+
+
+void test_state_replay(const moWCString& filename)
+{
+	unlink(filename.c_str());
+
+	moPropBagRef state("STATE");
+	state.NewProp();
+	moPropIntRef hp("HP");
+	hp.NewProp();
+	hp = 30;
+	state += hp;
+	moPropStringRef name("NAME");
+	name.NewProp();
+	name = "Errol";
+	state += name;
+
+	{
+		moJournal journal;
+		check(journal.Open(filename), "open the state journal");
+		check(append_state(journal, state, 'F', 0), "append the full record");
+		moProp::generation_t generation = moProp::CurrentGeneration();
+
+		moPropIntRef live_hp(state.Get("HP"));
+		live_hp = 25;
+		check(append_state(journal, state, 'D', generation), "append the first delta");
+		generation = moProp::CurrentGeneration();
+
+		live_hp = 12;
+		check(append_state(journal, state, 'D', generation), "append the second delta");
+		generation = moProp::CurrentGeneration();
+
+		// this one never makes it to the disk completely
+		live_hp = 1;
+		check(append_state(journal, state, 'D', generation), "append the third delta");
+		journal.Close();
+	}
+	check(truncate(filename.c_str(), file_size(filename) - 1) == 0, "tear the third delta");
+
+	moJournal journal;
+	check(journal.Open(filename), "reopen the state journal");
+	StateReplay replay;
+	check(journal.Replay(replay), "replay the state journal");
+	check(replay.f_state.HasProp(), "a state was rebuilt");
+	if(replay.f_state.HasProp()) {
+		moPropIntRef r_hp(replay.f_state.Get("HP"));
+		moPropStringRef r_name(replay.f_state.Get("NAME"));
+		check(r_hp.HasProp() && static_cast<int>(r_hp) == 12, "the state is the one of the last complete delta");
+		check(r_name.HasProp() && moWCString(r_name) == "Errol", "the values not in the deltas come from the full record");
+	}
+	journal.Close();
+
+	unlink(filename.c_str());
+}
+}		// no name namespace
+
+
+int main(int argc, char *argv[])
+{
+	const moWCString directory(argc > 1 ? argv[1] : ".");
+	const moWCString filename(directory.FilenameChild(moWCString::Format("journal_recovery_%d.journal", static_cast<int>(getpid()))));
+
+	test_torn_tail(filename);
+	test_state_replay(filename);
+
+	if(g_errors != 0) {
+		fprintf(stderr, "journal_recovery: %d error(s)\n", g_errors);
+		return 1;
+	}
+	printf("journal_recovery: all tests passed\n");
+	return 0;
+}
+
+// vim: ts=8 sw=8
@@ -0,0 +1,158 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+// Compare the time it takes to match N expressions against a line when
+// each moRegularExpression runs on its own and when the line is scanned
+// once by an moPatternSet holding all of them. moSimpleEditor runs the
+// expressions on their own; run this again when the pattern set or the
+// regular expressions change to see whether the set became faster.
+//
+// Usage: pattern_set_bench [<lines>]
+// Prints one row per number of expressions with the time per line.
+
+#include	"mo/mo_pattern_set.h"
+#include	"mo/mo_regexpr.h"
+
+#include	<stdio.h>
+#include	<stdlib.h>
+
+#include	<chrono>
+#include	<vector>
+
+using namespace molib;
+
+
+namespace
+{
+typedef std::chrono::steady_clock	clock_type;
+
+// the kind of expressions found in sed scripts: literals, classes,
+// anchors and a few repetitions
+const char * const	g_patterns[] =
+{
+	"@PATH@",
+	"^#",
+	"ba[rz]",
+	"key[0-9]+=(on|off)",
+	"version",
+	"[ \t]+$",
+	"^[a-z_]+:",
+	"foo",
+	"\\.conf$",
+	"user=[a-z]+",
+	"^include ",
+	"0x[0-9a-f]+",
+	"TODO",
+	"^$",
+	"[A-Z][A-Z]+",
+	"=>"
+};
+const int		g_pattern_count = static_cast<int>(sizeof(g_patterns) / sizeof(g_patterns[0]));
+
+const char * const	g_lines[] =
+{
+	"# turnwatcher configuration file",
+	"datadir=@PATH@/share/turnwatcher",
+	"key1=on",
+	"key22=off  ",
+	"bar baz foo",
+	"version 4.2.1 (stable)",
+	"section_name: value",
+	"include stats.conf",
+	"address=0x7fff5a3c",
+	"user=alexis",
+	"",
+	"TODO: remove the legacy stat ids => after the next release"
+};
+const int		g_line_count = static_cast<int>(sizeof(g_lines) / sizeof(g_lines[0]));
+
+
+double bench_expressions(std::vector<moRegularExpression>& exprs, const std::vector<moWCString>& lines, int repeat, int& matches)
+{
+	const clock_type::time_point start(clock_type::now());
+	for(int r = 0; r < repeat; ++r) {
+		for(size_t l = 0; l < lines.size(); ++l) {
+			for(size_t e = 0; e < exprs.size(); ++e) {
+				if(exprs[e].MatchExpression(lines[l])) {
+					++matches;
+				}
+			}
+		}
+	}
+	return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+
+
+// one scan per line, then the result of each expression
+double bench_pattern_set(moPatternSet& patterns, int count, const std::vector<moWCString>& lines, int repeat, int& matches)
+{
+	const clock_type::time_point start(clock_type::now());
+	for(int r = 0; r < repeat; ++r) {
+		for(size_t l = 0; l < lines.size(); ++l) {
+			patterns.Scan(lines[l]);
+			for(int e = 0; e < count; ++e) {
+				if(patterns.Matched(e)) {
+					++matches;
+				}
+			}
+		}
+	}
+	return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+}		// no name namespace
+
+
+int main(int argc, char *argv[])
+{
+	const long total_lines = argc > 1 ? atol(argv[1]) : 100000;
+	if(total_lines <= 0) {
+		fprintf(stderr, "pattern_set_bench: the number of lines must be positive\n");
+		return 1;
+	}
+	const int repeat = static_cast<int>((total_lines + g_line_count - 1) / g_line_count);
+
+	std::vector<moWCString> lines;
+	for(int l = 0; l < g_line_count; ++l) {
+		lines.push_back(g_lines[l]);
+	}
+
+	printf("%d lines per run\n", repeat * g_line_count);
+	printf("exprs  separate (us/line)  pattern set (us/line)  faster\n");
+	for(int count = 1; count <= g_pattern_count; ++count) {
+		std::vector<moRegularExpression> exprs(count);
+		moPatternSet patterns;
+		for(int e = 0; e < count; ++e) {
+			exprs[e] = g_patterns[e];
+			patterns.Add(g_patterns[e]);
+		}
+
+		int separate_matches = 0, set_matches = 0;
+		const double separate = bench_expressions(exprs, lines, repeat, separate_matches) / (repeat * g_line_count);
+		const double set = bench_pattern_set(patterns, count, lines, repeat, set_matches) / (repeat * g_line_count);
+		if(separate_matches != set_matches) {
+			fprintf(stderr, "pattern_set_bench: %d expressions: %d matches on their own, %d with the pattern set\n",
+					count, separate_matches, set_matches);
+			return 1;
+		}
+		printf("%5d  %19.3f  %21.3f  %s\n", count, separate, set, set < separate ? "pattern set" : "separate");
+	}
+
+	return 0;
+}
+
+// vim: ts=8 sw=8
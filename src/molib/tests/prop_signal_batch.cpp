@@ -0,0 +1,284 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+// Signal batches: each (property, handler) pair is called once with the
+// final value when the outermost batch ends, handlers removed meanwhile
+// are not called, and the destructor swallows the exceptions of the
+// handlers while Flush() lets them through.
+//
+// Usage: prop_signal_batch
+
+#include	"mo/mo_props.h"
+
+#include	<stdio.h>
+
+#include	<string>
+
+using namespace molib;
+
+
+namespace
+{
+int		g_errors = 0;
+
+void check(bool condition, const char *what)
+{
+	if(!condition) {
+		fprintf(stderr, "prop_signal_batch: FAILED: %s\n", what);
+		++g_errors;
+	}
+}
+
+
+// records the calls it receives as "<name>=<value>;"
+class Recorder : public moPropSignalHandler
+{
+public:
+	virtual void		SignalValueChanged(moPropRef& prop, moBase *data)
+				{
+					moPropIntRef value(prop);
+					f_calls += moNamePool::GetNamePool().Get(prop.GetName()).c_str();
+					f_calls += "=" + std::to_string(static_cast<int>(value)) + ";";
+				}
+
+	std::string		f_calls;
+};
+
+typedef moSmartPtr<Recorder>	RecorderSPtr;
+
+
+// removes another handler from another property when called
+class Remover : public moPropSignalHandler
+{
+public:
+				Remover(const moPropIntRef& prop, moBase& handler)
+					: f_prop(prop),
+					  f_handler(handler)
+				{
+				}
+
+	virtual void		SignalValueChanged(moPropRef& prop, moBase *data)
+				{
+					f_prop.RemoveHandler(f_handler);
+				}
+
+private:
+	moPropIntRef		f_prop;
+	moBase&			f_handler;
+};
+
+
+// modifies another property when called
+class Setter : public moPropSignalHandler
+{
+public:
+				Setter(const moPropIntRef& prop)
+					: f_prop(prop)
+				{
+				}
+
+	virtual void		SignalValueChanged(moPropRef& prop, moBase *data)
+				{
+					f_prop = 100;
+				}
+
+private:
+	moPropIntRef		f_prop;
+};
+
+
+class Thrower : public moPropSignalHandler
+{
+public:
+	virtual void		SignalValueChanged(moPropRef& prop, moBase *data)
+				{
+					throw moError("prop_signal_batch: handler failure");
+				}
+};
+
+
+moPropIntRef new_int(const char *name)
+{
+	moPropIntRef prop(name);
+	prop.NewProp();
+	prop = 0;
+	return prop;
+}
+
+
+void test_coalescing(void)
+{
+	moPropIntRef a(new_int("A"));
+	moPropIntRef b(new_int("B"));
+	RecorderSPtr recorder(new Recorder);
+	a.AddHandler(*recorder);
+	b.AddHandler(*recorder);
+
+	moPropSignalBatch::ResetStats();
+	{
+		moPropSignalBatch batch;
+		a = 1;
+		b = 1;
+		a = 2;
+		a = 3;
+		b = 2;
+		check(recorder->f_calls.empty(), "no handler is called within a batch");
+	}
+	check(recorder->f_calls == "A=3;B=2;", "each pair is called once with the final value, in the order of the first change");
+
+	moPropSignalBatch::stats_t stats;
+	moPropSignalBatch::GetStats(stats);
+	check(stats.f_deferred == 5, "five calls were deferred");
+	check(stats.f_suppressed == 3, "three calls were suppressed");
+	check(stats.f_delivered == 2, "two calls were delivered");
+
+	recorder->f_calls.clear();
+	a = 4;
+	check(recorder->f_calls == "A=4;", "without a batch the handler is called immediately");
+}
+
+
+void test_nested(void)
+{
+	moPropIntRef a(new_int("A"));
+	RecorderSPtr recorder(new Recorder);
+	a.AddHandler(*recorder);
+
+	check(!moPropSignalBatch::IsActive(), "no batch is active");
+	{
+		moPropSignalBatch outer;
+		{
+			moPropSignalBatch inner;
+			check(moPropSignalBatch::IsActive(), "the batch is active");
+			a = 1;
+		}
+		check(recorder->f_calls.empty(), "the end of an inner batch sends nothing");
+		check(moPropSignalBatch::IsActive(), "the outer batch is still active");
+		a = 2;
+	}
+	check(!moPropSignalBatch::IsActive(), "no batch is active anymore");
+	check(recorder->f_calls == "A=2;", "the outer batch sends the final value once");
+}
+
+
+void test_removal(void)
+{
+	moPropIntRef a(new_int("A"));
+	moPropIntRef b(new_int("B"));
+	moPropIntRef c(new_int("C"));
+	RecorderSPtr recorder(new Recorder);
+	moBaseSPtr remover(new Remover(b, *recorder));
+	a.AddHandler(*remover);
+	b.AddHandler(*recorder);
+	c.AddHandler(*recorder);
+
+	{
+		moPropSignalBatch batch;
+		a = 1;
+		b = 1;
+		c = 1;
+	}
+	check(recorder->f_calls == "C=1;", "a handler removed during the delivery is not called");
+
+	recorder->f_calls.clear();
+	{
+		moPropSignalBatch batch;
+		c = 2;
+		c.RemoveHandler(*recorder);
+	}
+	check(recorder->f_calls.empty(), "a handler removed before the end of the batch is not called");
+}
+
+
+void test_cascade(void)
+{
+	moPropIntRef a(new_int("A"));
+	moPropIntRef b(new_int("B"));
+	moBaseSPtr setter(new Setter(b));
+	RecorderSPtr recorder(new Recorder);
+	a.AddHandler(*setter);
+	b.AddHandler(*recorder);
+
+	{
+		moPropSignalBatch batch;
+		a = 1;
+	}
+	check(recorder->f_calls == "B=100;", "the signals of the handlers are sent before the batch ends");
+}
+
+
+void test_exceptions(void)
+{
+	moPropIntRef a(new_int("A"));
+	moPropIntRef b(new_int("B"));
+	moBaseSPtr thrower(new Thrower);
+	RecorderSPtr recorder(new Recorder);
+	a.AddHandler(*thrower);
+	b.AddHandler(*recorder);
+
+	bool thrown = false;
+	try {
+		moPropSignalBatch batch;
+		a = 1;
+		b = 1;
+	}
+	catch(...) {
+		thrown = true;
+	}
+	check(!thrown, "the destructor does not throw");
+	check(recorder->f_calls == "B=1;", "the destructor calls the handlers after the one which threw");
+	check(!moPropSignalBatch::IsActive(), "the batch ended");
+
+	recorder->f_calls.clear();
+	{
+		moPropSignalBatch batch;
+		a = 2;
+		b = 2;
+		thrown = false;
+		try {
+			batch.Flush();
+		}
+		catch(const moError&) {
+			thrown = true;
+		}
+		check(thrown, "Flush() lets the exceptions through");
+		check(recorder->f_calls.empty(), "Flush() stops at the exception and drops the queue");
+		b = 3;
+	}
+	check(recorder->f_calls == "B=3;", "the batch still works after a failed Flush()");
+}
+}		// no name namespace
+
+
+int main(int argc, char *argv[])
+{
+	test_coalescing();
+	test_nested();
+	test_removal();
+	test_cascade();
+	test_exceptions();
+
+	if(g_errors != 0) {
+		fprintf(stderr, "prop_signal_batch: %d error(s)\n", g_errors);
+		return 1;
+	}
+	printf("prop_signal_batch: all tests passed\n");
+	return 0;
+}
+
+// vim: ts=8 sw=8
@@ -0,0 +1,146 @@
+//===============================================================================
+// Copyright (c) 2005-2017 by Made to Order Software Corporation
+//
+// All Rights Reserved.
+//
+// The source code in this file ("Source Code") is provided by Made to Order Software Corporation
+// to you under the terms of the GNU General Public License, version 2.0
+// ("GPL").  Terms of the GPL can be found in doc/GPL-license.txt in this distribution.
+//
+// By copying, modifying or distributing this software, you acknowledge
+// that you have read and understood your obligations described above,
+// and agree to abide by those obligations.
+//
+// ALL SOURCE CODE IN THIS DISTRIBUTION IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+// WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+// COMPLETENESS OR PERFORMANCE.
+//===============================================================================
+
+// Compare the two engines of moRegularExpression: the default
+// MO_REGEXPR_ENGINE_AUTO (lazy DFA) and MO_REGEXPR_ENGINE_BACKTRACK.
+// Each case is run with both engines, the results (match and positions)
+// must be the same.
+//
+// Usage: regexpr_bench [<iterations>]
+// Prints one row per case with the time per match of each engine.
+
+#include	"mo/mo_regexpr.h"
+
+#include	<stdio.h>
+#include	<stdlib.h>
+
+#include	<chrono>
+#include	<string>
+
+using namespace molib;
+
+
+namespace
+{
+typedef std::chrono::steady_clock	clock_type;
+
+struct bench_case_t
+{
+	const char *		name;
+	const char *		pattern;
+	std::string		subject;
+};
+
+
+std::string repeat_string(const char *s, int count)
+{
+	std::string result;
+	for(int i = 0; i < count; ++i) {
+		result += s;
+	}
+	return result;
+}
+
+
+struct result_t
+{
+	bool			matched;
+	int			start;
+	int			last;
+	double			usec;
+};
+
+
+result_t run(const bench_case_t& c, moRegularExpression::mo_regexpr_engine_t engine, int iterations)
+{
+	moRegularExpression re(c.pattern);
+	re.SetEngine(engine);
+	const moWCString subject(c.subject.c_str());
+
+	result_t result;
+	result.matched = re.MatchExpression(subject);	// also warms up the DFA cache
+	result.start = re.GetStartPos();
+	result.last = re.GetLastPos();
+
+	const clock_type::time_point start(clock_type::now());
+	for(int i = 0; i < iterations; ++i) {
+		re.MatchExpression(subject);
+	}
+	result.usec = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / iterations;
+
+	return result;
+}
+}		// no name namespace
+
+
+int main(int argc, char *argv[])
+{
+	const int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+	if(iterations <= 0) {
+		fprintf(stderr, "regexpr_bench: the number of iterations must be positive\n");
+		return 1;
+	}
+
+	const std::string sentence("the quick brown fox jumps over the lazy dog; ");
+	const std::string text(repeat_string(sentence.c_str(), 40));
+	const bench_case_t cases[] =
+	{
+		{ "literal, no match",		"turnwatcher",			text },
+		{ "literal at the end",		"turnwatcher",			text + "turnwatcher" },
+		{ "class repeat",		"[0-9]+\\.[0-9]+",		text + "version 4.21" },
+		{ "alternation",		"(cat|cow|crow|camel)s?",	text + "camels" },
+		{ "anchored line",		"^[a-z_]+=[^;]*$",		"datadir=/usr/share/turnwatcher" },
+		// the backtracking engine recurses once per character matched by
+		// .* and runs out of stack on the whole text, use a short subject
+		{ "dot star",			"q.*z.*g",			sentence },
+		{ "nested repeat",		"(a|aa)*b",			repeat_string("a", 18) },
+		{ "nested plus",		"(x+x+)+y",			repeat_string("x", 16) }
+	};
+	const int count = static_cast<int>(sizeof(cases) / sizeof(cases[0]));
+
+	printf("%d iterations per case\n", iterations);
+	printf("%-20s  %14s  %14s  %8s\n", "case", "auto (us)", "backtrack (us)", "speedup");
+	int errors = 0;
+	for(int idx = 0; idx < count; ++idx) {
+		result_t dfa, backtrack;
+		try {
+			dfa = run(cases[idx], moRegularExpression::MO_REGEXPR_ENGINE_AUTO, iterations);
+			backtrack = run(cases[idx], moRegularExpression::MO_REGEXPR_ENGINE_BACKTRACK, iterations);
+		}
+		catch(const moError& e) {
+			fprintf(stderr, "regexpr_bench: %s: %s\n", cases[idx].name, e.Message());
+			++errors;
+			continue;
+		}
+		if(dfa.matched != backtrack.matched
+		|| (dfa.matched && (dfa.start != backtrack.start || dfa.last != backtrack.last))) {
+			fprintf(stderr, "regexpr_bench: %s: the engines disagree (auto %d [%d, %d], backtrack %d [%d, %d])\n",
+					cases[idx].name,
+					dfa.matched, dfa.start, dfa.last,
+					backtrack.matched, backtrack.start, backtrack.last);
+			++errors;
+			continue;
+		}
+		printf("%-20s  %14.3f  %14.3f  %7.1fx\n", cases[idx].name, dfa.usec, backtrack.usec,
+				dfa.usec > 0.0 ? backtrack.usec / dfa.usec : 0.0);
+	}
+
+	return errors == 0 ? 0 : 1;
+}
+
+// vim: ts=8 sw=8